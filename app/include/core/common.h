@@ -30,6 +30,13 @@ extern "C"
 #define LMDB_EML_WARN(tag, where, ret) \
     EML_WARN(tag, "%s: ret=%d (%s)", where, (ret), mdb_strerror(ret))
 
+/* Debug log on the per-op path: gone unless DB_LMDB_HOT_DBG */
+#if DB_LMDB_HOT_DBG
+#define DB_HOT_DBG(tag, ...) EML_DBG(tag, __VA_ARGS__)
+#else
+#define DB_HOT_DBG(tag, ...) ((void)0)
+#endif
+
 /****************************************************************************
  * PUBLIC STRUCTURED VARIABLES
  ****************************************************************************
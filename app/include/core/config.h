@@ -23,15 +23,121 @@
 /* Maximum LMDB map size */
 #define DB_MAP_SIZE_MAX           GiB(1)
 
+/* Map growth step: grow once less than a step is free (runtime: db_env_cfg_t) */
+#define DB_MAP_GROW_STEP          MiB(64)
+
+/* Max wait for open txns to drain before a map growth */
+#define DB_LMDB_MAP_GROW_WAIT_MS  200u
+
 /* max sub-dbis */
 #define DB_MAX_DBIS               16
 
+/* FAST_ASYNC profile: period of the background mdb_env_sync */
+#define DB_LMDB_ENV_SYNC_MS       1000u
+
+/* READ_MOSTLY profile: reader slots (LMDB default is 126) */
+#define DB_LMDB_ENV_READERS_RO    512u
+
 /* operation batch retry times */
 #define DB_LMDB_RETRY_OPS_EXEC    3
 
-/* operation batch RW cache size */
+/* operation batch initial op slots (pool grows on demand) */
+#define DB_LMDB_BATCH_OPS_INIT    8
+
+/* operation batch default max ops (runtime: db_core_set_batch_max_ops) */
+#define DB_LMDB_BATCH_OPS_MAX     4096
+
+/* write batch savepoint: ops per child txn, retried alone (runtime: per batch) */
+#define DB_LMDB_EXEC_SEGMENT_OPS  1024u
+
+/* reuse parked read-only txns (mdb_txn_reset/renew) by default */
+#define DB_LMDB_RO_TXN_REUSE      1
+
+/* bulk loader default commit thresholds (records / key + value bytes) */
+#define DB_LMDB_BULK_COMMIT_RECORDS 65536u
+#define DB_LMDB_BULK_COMMIT_BYTES   MiB(64)
+
+/* group-commit writer: max batches merged into one write txn */
+#define DB_LMDB_GROUP_MAX_BATCHES 64u
+
+/* async submission: read worker threads, batches in flight */
+#define DB_LMDB_ASYNC_READERS 4u
+#define DB_LMDB_ASYNC_DEPTH   1024u
+
+/* sharded envs (db_core_shards_open): most shards per handle */
+#define DB_LMDB_SHARDS_MAX    16u
+
+/* hot backups (db_core_backup): bytes per copy chunk, pipe buffer asked for, map headroom
+   per DB_LMDB_BACKUP_HEADROOM_S seconds of throttled copy */
+#define DB_LMDB_BACKUP_CHUNK      (64u * 1024u)
+#define DB_LMDB_BACKUP_PIPE       (1u << 20)
+#define DB_LMDB_BACKUP_HEADROOM   DB_MAP_GROW_STEP
+#define DB_LMDB_BACKUP_HEADROOM_S 10u
+
+/* warm start (db_env_cfg_t.warm): entries walked per read txn of a prefetch walk */
+#define DB_LMDB_WARM_STEP     4096u
+
+/* per-DBI value cache (db_core_cache_enable): budget, lock shards, max value size */
+#define DB_LMDB_VCACHE_BYTES      MiB(8)
+#define DB_LMDB_VCACHE_SHARDS     8u
+#define DB_LMDB_VCACHE_MAX_VAL    KiB(4)
+/* expected bytes per cached entry, sizes the hash buckets */
+#define DB_LMDB_VCACHE_AVG_ENTRY  128u
+
+/* DBI_TYPE_BLOOM: filter bits per key, headroom over the keys found at build,
+   fewest keys sized for */
+#define DB_LMDB_BLOOM_BITS_PER_KEY 12u
+#define DB_LMDB_BLOOM_HEADROOM     2u
+#define DB_LMDB_BLOOM_MIN_KEYS     4096u
+
+/* secondary indexes (db_core_index_add): total, per source DBI, max index key size */
+#define DB_LMDB_INDEX_MAX          16u
+#define DB_LMDB_INDEX_PER_DBI      4u
+#define DB_LMDB_INDEX_KEY_MAX      511u
+
+/* TTL keys (db_core_ttl_start): sweep period, expired keys per write txn and per
+   period, max key size (511 minus the 10 byte queue prefix) */
+#define DB_LMDB_TTL_PERIOD_MS      1000u
+#define DB_LMDB_TTL_BATCH          256u
+#define DB_LMDB_TTL_MAX_PER_TICK   4096u
+#define DB_LMDB_TTL_KEY_MAX        501u
+/* pause between two sweeper write txns, hands the writer lock to waiting batches */
+#define DB_LMDB_TTL_PAUSE_US       200u
+
+/* DBI_TYPE_ZIP values: smallest value compressed, zstd level, trained dictionaries
+   per DBI, dictionary size and values sampled to train one */
+#define DB_LMDB_ZIP_MIN_SIZE       256u
+#define DB_LMDB_ZIP_ZSTD_LEVEL     3
+#define DB_LMDB_ZIP_DICTS          8u
+#define DB_LMDB_ZIP_DICT_SIZE      KiB(16)
+#define DB_LMDB_ZIP_TRAIN_SAMPLES  1024u
+
+/* codecs of DBI_TYPE_ZIP, set by the build when liblz4 / libzstd are found */
+#ifndef DB_LMDB_LZ4
+#define DB_LMDB_LZ4                0
+#endif
+#ifndef DB_LMDB_ZSTD
+#define DB_LMDB_ZSTD               0
+#endif
+
+/* operation batch RW cache slab size (the cache chains more slabs on demand) */
 #define DB_LMDB_RW_OPS_CACHE_SIZE KiB(2)
 
+/* runtime metrics (db_core_stats): per-thread counters, latency histograms */
+#ifndef DB_LMDB_METRICS
+#define DB_LMDB_METRICS           1
+#endif
+
+/* USDT probes (sys/sdt.h) around batch phases, nops until a tracer attaches */
+#ifndef DB_LMDB_USDT
+#define DB_LMDB_USDT              0
+#endif
+
+/* per-op / per-txn debug logs, compiled in by Debug builds only */
+#ifndef DB_LMDB_HOT_DBG
+#define DB_LMDB_HOT_DBG           0
+#endif
+
 /* Default filesystem mode for LMDB environment files (data.mdb/lock.mdb). */
 #define DB_LMDB_ENV_MODE          0600u
 
@@ -10,6 +10,7 @@
 #define DB_LMDB_CORE_H
 
 #include <stddef.h>                /* size_t */
+#include <stdint.h>                /* uint64_t */
 #include "dbi_ext.h"               /* dbi_type_t */
 #include "operations/ops_facade.h" /* op_type_t */
 
@@ -44,6 +45,23 @@ extern "C"
  * @p n_dbis. On success, the global `DataBase` pointer is populated and
  * ready for use by higher-level operations.
  *
+ * DBIs typed with DBI_TYPE_BLOOM get an in-memory blocked Bloom filter of
+ * their keys: GETs of keys it has never seen fail with -ENOENT without a
+ * B-tree descent (a read batch of them without any txn). The filter is
+ * loaded from `<path>/<name>.bloom`, written by @ref db_core_shutdown,
+ * when no commit happened since; otherwise it is rebuilt by a key scan.
+ * Deleted keys stay in the filter until that rebuild.
+ *
+ * DBI_TYPE_INTEGERKEY keys (DBI_TYPE_INTEGERDUP dups) are unsigned int
+ * or size_t in native byte order, compared as numbers. All keys of such
+ * a DBI must have the same size; ops with other sizes fail with -EINVAL
+ * when queued. Keep their buffers aligned on strict-alignment CPUs.
+ *
+ * DBI_TYPE_ZIP values are stored compressed, LZ4 by default (zstd when
+ * LZ4 is not built in), see @ref db_core_zip_enable. Reads decode them
+ * transparently; such DBIs cannot have dups and refuse reserved puts and
+ * patches with -EOPNOTSUPP. Keep the type across restarts.
+ *
  * @param path       Filesystem path to the database directory.
  * @param mode       Filesystem mode (owner/group/other bits) used when
  *                   creating directories or files.
@@ -55,6 +73,68 @@ extern "C"
 int db_core_init(const char* const path, const unsigned int mode, const char* const* dbi_names,
                  const dbi_type_t* dbi_types, unsigned n_dbis);
 
+/**
+ * @brief @ref db_core_init with a runtime environment setup.
+ *
+ * @p cfg selects a durability / performance profile and optional overrides
+ * (open flags, map sizes and growth step, reader slots, DBI count). With
+ * MDB_NOSYNC or MDB_NOMETASYNC in effect a background thread calls
+ * `mdb_env_sync` every `sync_ms`, and @ref db_core_shutdown syncs once
+ * more; a crash loses at most that window of commits, never consistency.
+ *
+ * `key_cmps` / `dup_cmps` install a custom key / dup order on the DBIs
+ * with a non-NULL entry, e.g. @ref db_core_cmp_be64 for big-endian
+ * numbers. Sorted batches, range DELs and scans follow it. Integer DBIs
+ * already compare as numbers and refuse one (-EINVAL).
+ *
+ * `warm` speeds up the reopen of an existing database: DB_WARM_READER_CHECK
+ * frees the reader slots of crashed processes, DB_WARM_PREFETCH_MAP asks
+ * the kernel to read the used part of the file ahead, DB_WARM_SCHEMA opens
+ * the DBIs in a read txn when they match the schema record saved by the
+ * last open. `prefetch_dbis` walks the chosen DBIs on background threads
+ * so that their pages are cached before the first queries reach them; see
+ * @ref db_core_warm_stats.
+ *
+ * @param cfg Environment setup, NULL for the durable profile (as
+ *            @ref db_core_init).
+ * @return 0 on success; negative POSIX-style errno on failure (-EINVAL for
+ *         an unknown profile, map_size_init > map_size_max or a
+ *         `prefetch_dbis` bit past the DBIs).
+ */
+int db_core_init_ex(const char* const path, const unsigned int mode,
+                    const char* const* dbi_names, const dbi_type_t* dbi_types, unsigned n_dbis,
+                    const db_env_cfg_t* cfg);
+
+/**
+ * @brief Fill @p out_cfg with the settings of @p profile, to be tweaked and
+ *        passed to @ref db_core_init_ex.
+ *
+ * @return 0 on success, -EINVAL for NULL @p out_cfg or an unknown profile.
+ */
+int db_core_env_profile(const db_env_profile_t profile, db_env_cfg_t* out_cfg);
+
+/**
+ * @brief Wait for the prefetch walks started by @ref db_core_init_ex.
+ *
+ * @return 0, or the first error of a walk. Walks still running at
+ *         @ref db_core_shutdown are stopped.
+ */
+int db_core_warm_wait(void);
+
+/**
+ * @brief Read what the warm start of the open database did.
+ */
+void db_core_warm_stats(db_warm_stats_t* out_stats);
+
+/**
+ * @brief Order of 8-byte big-endian unsigned integers (timestamps, counters),
+ *        for db_env_cfg_t.key_cmps / dup_cmps.
+ *
+ * Same order as the LMDB default, in one 64-bit compare; values of other
+ * sizes compare as bytes, shorter first.
+ */
+int db_core_cmp_be64(const db_view_t* a, const db_view_t* b);
+
 /**
  * @brief Queue a single database operation into the current batch.
  *
@@ -62,12 +142,21 @@ int db_core_init(const char* const path, const unsigned int mode, const char* co
  * it into an internal op_t and caches it until @ref db_core_exec_ops
  * is called.
  *
- * For now only DB_OPERATION_PUT and DB_OPERATION_GET are supported; other
- * values will return -EINVAL.
+ * Supported kinds are DB_OPERATION_PUT, DB_OPERATION_GET and
+ * DB_OPERATION_DEL; other values return -EINVAL (scans are queued with
+ * @ref db_core_batch_add_scan). A DEL removes the key
+ * (every duplicate on DUPSORT DBIs), or only the (key, value) pair when
+ * @p val_data is given on a DUPSORT DBI. A missing key fails the batch
+ * with -ENOENT. A NULL @p key_data means "key of the op @p key_size
+ * positions back", as for GET.
  *
  * The data pointers in @p key and @p val must remain valid until
  * after db_core_exec_ops has been called.
  *
+ * The operation goes into the process-wide default batch, which is not
+ * thread-safe; concurrent callers should use @ref db_core_batch_create
+ * and @ref db_core_batch_add_op with their own handle.
+ *
  * @param dbi_idx  Index of the target DBI (0-based).
  * @param type     Operation kind (DB_OPERATION_*).
  * @param key_data Pointer to key bytes.
@@ -90,6 +179,813 @@ int db_core_add_op(const unsigned dbi_idx, const op_type_t type, const void* key
  */
 int db_core_exec_ops(void);
 
+/**
+ * @brief Allocate a new, empty operations batch handle.
+ *
+ * Each handle carries its own queued operations and result cache, so
+ * several threads can build and execute batches at the same time as long
+ * as every thread uses its own handle. Read-only batches then run in
+ * parallel LMDB read transactions; write batches are serialized by LMDB's
+ * single writer lock.
+ *
+ * @param[out] out_batch Receives the new handle on success.
+ * @return 0 on success, -EINVAL on NULL output, -ENOMEM on allocation
+ *         failure.
+ */
+int db_core_batch_create(db_batch_t** out_batch);
+
+/**
+ * @brief Queue a single database operation into @p batch.
+ *
+ * Same contract as @ref db_core_add_op, but targets an explicit batch
+ * handle. Passing NULL as @p batch selects the default batch used by
+ * db_core_add_op / db_core_exec_ops.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based).
+ * @param type     Operation kind (DB_OPERATION_*).
+ * @param key_data Pointer to key bytes.
+ * @param key_size Size of key buffer in bytes.
+ * @param val_data Pointer to value bytes (for PUT).
+ * @param val_size Size of value buffer in bytes (for PUT).
+ * @return 0 on success, negative errno-style code on failure.
+ */
+int db_core_batch_add_op(db_batch_t* batch, const unsigned dbi_idx, const op_type_t type,
+                         const void* key_data, const size_t key_size, const void* val_data,
+                         const size_t val_size);
+
+/**
+ * @brief Queue the deletion of every key in [start, end) into @p batch.
+ *
+ * Executed as one cursor walk inside the batch's RW transaction, using
+ * the DBI's key order; duplicates of a deleted key go with it. A NULL
+ * bound leaves that side open, so (NULL, NULL) empties the DBI. Deleting
+ * an empty range succeeds.
+ *
+ * @param batch      Target batch handle (NULL for the default batch).
+ * @param dbi_idx    Index of the target DBI (0-based).
+ * @param start_key  First key to delete (inclusive), or NULL.
+ * @param start_size Size of @p start_key in bytes.
+ * @param end_key    First key to keep (exclusive), or NULL.
+ * @param end_size   Size of @p end_key in bytes.
+ * @return 0 on success, negative errno-style code on failure.
+ */
+int db_core_batch_add_del_range(db_batch_t* batch, const unsigned dbi_idx,
+                                const void* start_key, const size_t start_size,
+                                const void* end_key, const size_t end_size);
+
+/**
+ * @brief Queue a cursor scan into @p batch.
+ *
+ * The scan walks the DBI inside the batch's transaction (read-only unless
+ * the batch also writes) and streams each record to @p scan->cb, or copies
+ * it into @p scan->page when no callback is set, so results never need one
+ * big allocation. All scans of a batch on the same DBI share one cursor,
+ * and read cursors are renewed across batches.
+ *
+ * - DB_SCAN_RANGE: keys in [start, end), empty bounds are open.
+ * - DB_SCAN_PREFIX: keys beginning with start.
+ * - DB_SCAN_DUPS: all values of the key start.
+ *
+ * Delivery stops at @p scan->limit records, when the page is full or when
+ * the callback returns > 0; then @p scan->more is set. To resume a RANGE
+ * or PREFIX scan, start again from the last key with a 0x00 byte
+ * appended. A retried transaction restarts the scan, so a callback may
+ * see records twice. @p scan and its bounds must stay valid until the
+ * batch runs.
+ *
+ * @param batch   Target batch handle (NULL for the default batch).
+ * @param dbi_idx Index of the target DBI (0-based).
+ * @param scan    Scan request; its out fields are written during exec.
+ * @return 0 on success, -EINVAL for a malformed request, -ENOMEM when the
+ *         batch is full. At exec time a page too small for one record
+ *         fails with -ENOBUFS.
+ */
+int db_core_batch_add_scan(db_batch_t* batch, const unsigned dbi_idx, db_scan_t* scan);
+
+/**
+ * @brief Iterate over the records a scan copied into @p page.
+ *
+ * @param page Page filled by a scan.
+ * @param pos  Iterator, set to 0 before the first call.
+ * @param key  Receives a view of the record key (inside the page).
+ * @param val  Receives a view of the record value (inside the page).
+ * @return 1 when a record was returned, 0 at the end.
+ */
+int db_core_page_next(const db_scan_page_t* page, size_t* pos, db_view_t* key, db_view_t* val);
+
+/**
+ * @brief Queue a read of every duplicate of @p key into @p multi (DUPFIXED DBIs).
+ *
+ * The dups are fetched a page at a time (MDB_GET_MULTIPLE /
+ * MDB_NEXT_MULTIPLE) and copied back to back into @p multi->buf, so the
+ * result is one packed array of @p multi->n_items items of
+ * @p multi->elem_size bytes. When @p multi->cap is too small the array
+ * stops at the last whole dup that fits and @p multi->more is set; a
+ * missing key yields 0 items. Not for leased batches, see
+ * @ref db_core_batch_exec_leased.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based), opened DUPSORT|DUPFIXED.
+ * @param key      Key bytes.
+ * @param key_size Key size in bytes.
+ * @param multi    Buffer (buf, cap); out fields are written during exec.
+ * @return 0 on success, -EINVAL on bad input or a non DUPFIXED DBI, -ENOMEM
+ *         when the batch is full. At exec time a buffer too small for one
+ *         dup fails with -ENOBUFS.
+ */
+int db_core_batch_add_get_multiple(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                   const size_t key_size, db_multi_t* multi);
+
+/**
+ * @brief Queue a put of @p multi->n_items duplicates of @p key (DUPFIXED DBIs).
+ *
+ * The packed array in @p multi->buf is stored with a single MDB_MULTIPLE
+ * cursor put instead of one PUT per dup. Dups already present are kept.
+ * These puts are never reordered by a sorted batch.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based), opened DUPSORT|DUPFIXED.
+ * @param key      Key bytes.
+ * @param key_size Key size in bytes.
+ * @param multi    Dups to store (buf, elem_size, n_items), read during exec.
+ * @return 0 on success, -EINVAL on bad input or a non DUPFIXED DBI, -ENOMEM
+ *         when the batch is full.
+ */
+int db_core_batch_add_put_multiple(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                   const size_t key_size, db_multi_t* multi);
+
+/**
+ * @brief Queue a PUT whose value is serialized straight into the page.
+ *
+ * At exec time @p reserve->size bytes are reserved for @p key with
+ * MDB_RESERVE and @p reserve->write fills them before the next op of the
+ * batch runs, so the value is never staged in a caller buffer. A writer
+ * error aborts the batch with that error. The writer runs again if the
+ * batch is retried (MAP_FULL / MAP_RESIZED). Not available on DUPSORT
+ * DBIs; such puts are never reordered by a sorted batch and the value
+ * cannot be looked up by later ops.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based), not DUPSORT.
+ * @param key      Key bytes.
+ * @param key_size Key size in bytes.
+ * @param reserve  Value size and writer, read during exec.
+ * @return 0 on success, -EINVAL on bad input or a DUPSORT DBI, -ENOMEM
+ *         when the batch is full.
+ */
+int db_core_batch_add_put_reserve(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                  const size_t key_size, db_reserve_t* reserve);
+
+/**
+ * @brief Queue a PUT of a key that expires @p ttl_ms after the batch runs.
+ *
+ * The deadline goes to the expiry queue (see @ref db_core_ttl_start) in
+ * the write txn of the PUT, so the record and its deadline commit
+ * together. The deadline belongs to the last write of the key: a new TTL
+ * put moves it, a plain PUT or a DEL drops it in its own write txn and a
+ * REP keeps it. On a DUPSORT DBI a DEL of one dup keeps it while other dups
+ * of the key remain. Expired records stay readable until the sweeper
+ * deletes them.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based), not the queue.
+ * @param key      Key bytes, at most DB_LMDB_TTL_KEY_MAX.
+ * @param key_size Key size in bytes.
+ * @param val      Value bytes, valid until the batch has run.
+ * @param val_size Value size in bytes.
+ * @param ttl_ms   Lifetime in milliseconds, not 0.
+ * @return 0 on success, -EINVAL on bad input or when no sweeper runs,
+ *         -ENOMEM when the batch is full.
+ */
+int db_core_batch_add_put_ttl(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                              const size_t key_size, const void* val, const size_t val_size,
+                              const uint64_t ttl_ms);
+
+/**
+ * @brief Queue an in-place patch of the value stored under @p key.
+ *
+ * At exec time the value is located with the batch cursor and rewritten
+ * at the same size with MDB_CURRENT | MDB_RESERVE; then either
+ * @p patch->size bytes from @p patch->bytes are copied at
+ * @p patch->offset, or @p patch->mutate edits the value. The value is
+ * never staged through a GET and a full PUT. The callback runs again if
+ * the batch is retried. Not available on DUPSORT DBIs.
+ *
+ * @param batch    Target batch handle (NULL for the default batch).
+ * @param dbi_idx  Index of the target DBI (0-based), not DUPSORT.
+ * @param key      Key bytes.
+ * @param key_size Key size in bytes.
+ * @param patch    Patch request, read during exec.
+ * @return 0 on success, -EINVAL on bad input or a DUPSORT DBI, -ENOMEM
+ *         when the batch is full. At exec time a missing key fails with
+ *         -ENOENT and a patch past the end of the value with -ERANGE.
+ */
+int db_core_batch_add_patch(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                            const size_t key_size, db_patch_t* patch);
+
+/**
+ * @brief Compile the ops queued in @p batch into a plan run many times.
+ *
+ * Queue the shape once (placeholder keys and vals are fine), then prepare
+ * it: DBI indices and lookup references are checked here, and lookup
+ * chains are resolved to direct references. Afterwards every exec re-arms
+ * the same ops instead of emptying the batch, so a fixed request shape
+ * costs one copy per run; only the bound pointers change, through
+ * @ref db_core_batch_bind. Adding ops fails with -EBUSY until
+ * @ref db_core_batch_unprepare.
+ *
+ * @param batch Batch handle (NULL for the default batch).
+ * @return 0 on success, -EINVAL on an empty batch or a lookup that points
+ *         at itself, past the first op or at a val nothing fills, -EBUSY
+ *         when leased or already prepared, -ENOMEM.
+ */
+int db_core_batch_prepare(db_batch_t* batch);
+
+/**
+ * @brief Bind new key and/or value bytes to op @p op_idx of a prepared batch.
+ *
+ * NULL @p key or @p val keeps the current binding. Only ops queued with
+ * explicit bytes can be rebound, plus the buffer of a GET queued without
+ * one; lookups stay wired to their source. Bytes are not copied and must
+ * stay valid until the next exec.
+ *
+ * @param batch  Prepared batch (NULL for the default batch).
+ * @param op_idx Op position in queue order.
+ * @return 0 on success, -EINVAL on bad input, a slot that cannot be
+ *         rebound or a key / dup size of neither unsigned int nor size_t on
+ *         an integer DBI (the old binding is kept), -EBUSY while a read
+ *         lease is held.
+ */
+int db_core_batch_bind(db_batch_t* batch, const size_t op_idx, const void* key,
+                       const size_t key_size, const void* val, const size_t val_size);
+
+/**
+ * @brief Drop the plan of @p batch; the batch is empty and takes ops again.
+ *
+ * @param batch Batch handle (NULL for the default batch).
+ */
+void db_core_batch_unprepare(db_batch_t* batch);
+
+/**
+ * @brief Execute all operations queued in @p batch as a single transaction.
+ *
+ * The batch is emptied afterwards, whatever the outcome, and can be
+ * reused; a prepared batch is re-armed with its plan instead. Passing
+ * NULL selects the default batch.
+ *
+ * @param batch Batch handle (NULL for the default batch).
+ * @return 0 on success; -EBUSY for a batch with writes while the calling
+ *         thread holds a read lease; negative errno-style code on failure.
+ */
+int db_core_batch_exec(db_batch_t* batch);
+
+/**
+ * @brief Execute a GET-only batch and lease the results without copying.
+ *
+ * GETs queued without a buffer (val_data NULL) yield views straight into
+ * the LMDB memory map; GETs with a buffer yield a view of that buffer.
+ * Compressed values of DBI_TYPE_ZIP DBIs are decoded into memory of the
+ * batch instead, valid for the same time.
+ * @p out_views[i] matches the i-th queued op. The read snapshot stays open,
+ * and the views valid, until @ref db_core_release_read is called on the
+ * same batch; until then the batch cannot be executed again (-EBUSY).
+ * A held lease pins the snapshot's pages and holds off map growth, so keep
+ * it short. Until it is released the calling thread cannot write: write
+ * batches (also through @ref db_core_group_exec or the bulk loader) fail
+ * with -EBUSY, as the map could not grow past the lease.
+ *
+ * @param batch     Batch handle (NULL for the default batch).
+ * @param out_views Output array, one entry per queued op.
+ * @param n_views   Number of entries in @p out_views.
+ * @return 0 on success; -EINVAL for bad input or a batch with anything
+ *         but single GETs (writes, scans, multi-dup reads), which is
+ *         then emptied; -EBUSY when a lease is already held; otherwise as
+ *         @ref db_core_batch_exec.
+ */
+int db_core_batch_exec_leased(db_batch_t* batch, db_view_t* out_views, const size_t n_views);
+
+/**
+ * @brief End the read lease of a batch; its views become invalid.
+ *
+ * No-op when the batch holds no lease. Leases of caller-owned batches
+ * must be released (or the batch destroyed) before db_core_shutdown.
+ *
+ * @param batch Batch handle (NULL for the default batch).
+ */
+void db_core_release_read(db_batch_t* batch);
+
+/**
+ * @brief Free a batch handle created with @ref db_core_batch_create.
+ *
+ * Any queued, non-executed operations are discarded and a held read lease
+ * is released. NULL is a no-op.
+ *
+ * @param batch Batch handle to free.
+ */
+void db_core_batch_destroy(db_batch_t* batch);
+
+/**
+ * @brief Execute the PUTs of @p batch in key order (opt-in).
+ *
+ * Consecutive PUTs with explicit key and value are reordered by (DBI,
+ * key, value) before execution; any other op (GET, DEL, scan, PUT with a
+ * lookup) stays in place and splits the runs. Repeated keys keep their
+ * relative order, so the stored result is the same as in insertion order.
+ * When a run starts past the last key of its DBI it is written with
+ * MDB_APPEND / MDB_APPENDDUP, which is the fast path for time-ordered IDs.
+ *
+ * @param batch  Target batch handle (NULL for the default batch).
+ * @param enable Non-zero to sort, 0 for insertion order (the default).
+ * @return 0 on success.
+ */
+int db_core_batch_set_sorted(db_batch_t* batch, const int enable);
+
+/**
+ * @brief Split long write executions of @p batch into savepoints.
+ *
+ * Every @p segment_ops ops run in a child txn of the batch txn. A transient
+ * LMDB error inside a segment replays that segment only; MDB_MAP_FULL still
+ * restarts the whole txn once the map has grown. Not used under WRITEMAP.
+ *
+ * @param batch       Target batch handle (NULL for the default batch).
+ * @param segment_ops Ops per segment, 0 for DB_LMDB_EXEC_SEGMENT_OPS.
+ * @return 0 on success.
+ */
+int db_core_batch_set_segment_ops(db_batch_t* batch, const size_t segment_ops);
+
+/**
+ * @brief Read the attempt, segment and replay counters of the last execution.
+ *
+ * @param batch     Batch handle (NULL for the default batch).
+ * @param out_stats Destination.
+ */
+void db_core_batch_stats(const db_batch_t* batch, db_exec_stats_t* out_stats);
+
+/**
+ * @brief Start a bulk load.
+ *
+ * The loader copies each record, queues it on a private key-sorted batch
+ * (see @ref db_core_batch_set_sorted, so monotonic keys use MDB_APPEND)
+ * and commits every @p cfg->commit_records records or
+ * @p cfg->commit_bytes key + value bytes, whichever comes first. Before
+ * each commit the map is grown towards the configured maximum if the
+ * chunk may not fit, instead of relying on MAP_FULL retries.
+ *
+ * Commits happen from db_core_bulk_put / db_core_bulk_flush, so the
+ * calling thread must not hold a lease or a batch under execution.
+ *
+ * @param out_bulk Out: loader handle.
+ * @param cfg      Thresholds (NULL or zero fields for the defaults).
+ * @return 0 on success, -EINVAL on bad input, -ENOMEM on allocation failure.
+ */
+int db_core_bulk_begin(db_bulk_t** out_bulk, const db_bulk_cfg_t* cfg);
+
+/**
+ * @brief Queue one PUT on a bulk loader, committing the chunk when full.
+ *
+ * Key and value are copied: the caller may reuse its buffers on return.
+ * The DBI's put flags apply, as for @ref db_core_add_op.
+ *
+ * @param bulk     Loader handle.
+ * @param dbi_idx  Index of the target sub-DB.
+ * @param key      Key bytes (non-empty).
+ * @param key_size Key size in bytes.
+ * @param val      Value bytes (non-empty).
+ * @param val_size Value size in bytes.
+ * @return 0 on success, -EINVAL on bad input, -ENOMEM when the record cannot
+ *         be stored, or the error of the commit it triggered. A failed
+ *         chunk is dropped; earlier chunks stay committed.
+ */
+int db_core_bulk_put(db_bulk_t* bulk, const unsigned dbi_idx, const void* key,
+                     const size_t key_size, const void* val, const size_t val_size);
+
+/**
+ * @brief Commit the records queued on @p bulk so far.
+ *
+ * @return 0 on success (or nothing queued), negative errno otherwise.
+ */
+int db_core_bulk_flush(db_bulk_t* bulk);
+
+/**
+ * @brief Read the committed counters and throughput of @p bulk.
+ */
+void db_core_bulk_stats(const db_bulk_t* bulk, db_bulk_stats_t* out_stats);
+
+/**
+ * @brief Flush the pending records and free the loader.
+ *
+ * The loader is freed even when the final flush fails.
+ *
+ * @param bulk      Loader handle (NULL is a no-op).
+ * @param out_stats Out (optional): final counters, taken after the flush.
+ * @return Result of the final flush.
+ */
+int db_core_bulk_end(db_bulk_t* bulk, db_bulk_stats_t* out_stats);
+
+/**
+ * @brief Start the group-commit writer thread.
+ *
+ * While it runs, write batches passed to @ref db_core_group_exec from any
+ * number of threads are merged: the writer takes everything pending, runs
+ * up to @p cfg->max_batches batches in child txns of one write txn and
+ * commits (and syncs) once for all of them. Each batch gets its own
+ * result: a failing batch only rolls back its own child txn. When a group
+ * hits MAP_FULL or another retryable error it is redone one batch per txn
+ * through the usual retry path.
+ *
+ * @param cfg Tuning (NULL or zero fields for the defaults).
+ * @return 0 on success, -EALREADY when running, -EINVAL when the database
+ *         is not initialized, -ENOTSUP with DB_ENV_OPT_WRITEMAP (no child
+ *         txns), negative errno when the thread cannot start.
+ */
+int db_core_group_start(const db_group_cfg_t* cfg);
+
+/**
+ * @brief Execute @p batch through the group-commit writer.
+ *
+ * Blocks until the txn holding the batch has committed (or the batch
+ * failed) and returns the result of this batch alone, like
+ * @ref db_core_batch_exec. Read-only batches, and all batches when the
+ * writer is not running, are executed directly by the caller.
+ *
+ * @param batch Batch handle (NULL for the default batch).
+ * @return 0 on success, -EBUSY for writes while the caller holds a read
+ *         lease, negative errno otherwise.
+ */
+int db_core_group_exec(db_batch_t* batch);
+
+/**
+ * @brief Stop the group-commit writer after the pending batches.
+ *
+ * No-op when not running. Also done by @ref db_core_shutdown.
+ */
+void db_core_group_stop(void);
+
+/**
+ * @brief Read the group-commit counters since the last start.
+ */
+void db_core_group_stats(db_group_stats_t* out_stats);
+
+/**
+ * @brief Start async submission: worker threads and @p cfg->depth job slots.
+ *
+ * Lets one thread keep many batches in flight. Read-only batches run on
+ * the workers, each renewing its own parked read txn; write batches go to
+ * the group-commit writer when it runs (@ref db_core_group_start), to the
+ * workers otherwise. With @p cfg->eventfd set, @ref db_core_async_fd gives
+ * a descriptor to watch in an event loop.
+ *
+ * @param cfg Tuning (NULL or zero fields for the defaults).
+ * @return 0 on success, -EALREADY when running, -EINVAL when the database
+ *         is not initialized, -ENOMEM, or a negative errno.
+ */
+int db_core_async_start(const db_async_cfg_t* cfg);
+
+/**
+ * @brief Queue @p batch for execution and return without waiting.
+ *
+ * Do not touch the batch until it completes. With @p cb, the callback gets
+ * the batch, its result and @p ctx on a worker or writer thread: keep it
+ * short, it may submit again but must not stop async submission. Without,
+ * the completion waits for @ref db_core_async_poll. Either way the batch
+ * is emptied, as after @ref db_core_batch_exec.
+ *
+ * @param batch Batch handle; the default batch is not accepted.
+ * @return 0 when queued, -EINVAL, -ENOTCONN when not started, -EAGAIN when
+ *         `depth` batches are in flight or waiting to be polled.
+ */
+int db_core_async_submit(db_batch_t* batch, db_async_cb_t cb, void* ctx);
+
+/**
+ * @brief Take up to @p max completions of batches submitted without callback.
+ *
+ * Never blocks. The eventfd is reset once no completion is left.
+ *
+ * @return Completions written to @p out (0 when none), -EINVAL.
+ */
+int db_core_async_poll(db_async_done_t* out, const size_t max);
+
+/**
+ * @brief Eventfd readable while completions wait, -1 when not asked for.
+ */
+int db_core_async_fd(void);
+
+/**
+ * @brief Wait for the batches in flight and stop the workers.
+ *
+ * Completions not polled are dropped. No-op when not running. Also done by
+ * @ref db_core_shutdown.
+ */
+void db_core_async_stop(void);
+
+/**
+ * @brief Read the async submission counters since the last start.
+ */
+void db_core_async_stats(db_async_stats_t* out_stats);
+
+/**
+ * @brief Start a hot backup of the database to @p fd and return at once.
+ *
+ * The copy runs on a background thread from one read txn: it holds the
+ * last commit before the call while writes go on. With DB_BACKUP_COMPACT
+ * it skips free pages, so the copy is compacted and never larger than the
+ * data file. `rate_mb_s` caps the write rate; `progress` is called on the
+ * backup thread and must not wait for the backup. The map does not grow
+ * while the copy runs, as with a lease: it is first grown to `headroom`
+ * bytes past the data, capped at `map_size_max`. By default that is one
+ * DB_LMDB_BACKUP_HEADROOM per DB_LMDB_BACKUP_HEADROOM_S seconds the copy
+ * takes at `rate_mb_s`. Writes past that headroom fail with -ENOSPC until
+ * the copy ends, without waiting for it; the status reports the headroom,
+ * the growths put off and the writes refused. The caller keeps @p fd open
+ * until @ref db_core_backup_wait and syncs or closes it afterwards.
+ * Cancelled by @ref db_core_shutdown.
+ *
+ * @param cfg Flags and throttle (NULL for a plain copy at full speed).
+ * @return 0 when started, -EINVAL (bad fd or flags, database not
+ *         initialized), -EALREADY while a backup runs, or a negative errno.
+ */
+int db_core_backup(const int fd, const db_backup_cfg_t* cfg);
+
+/**
+ * @brief Wait for the backup started last.
+ *
+ * @return Its result: 0, -ECANCELED, the negative errno of a write to the
+ *         fd or of the copy; -ENOENT when no backup was started.
+ */
+int db_core_backup_wait(void);
+
+/**
+ * @brief Read the progress of the current or last backup.
+ */
+void db_core_backup_status(db_backup_status_t* out_status);
+
+/**
+ * @brief Read the page usage of the database.
+ *
+ * `pages_free` against `pages_last` tells how much a compacting backup
+ * (`compact_bytes`) would reclaim over a plain copy of the file.
+ *
+ * @return 0 on success, -EINVAL when the database is not initialized, or a
+ *         negative errno.
+ */
+int db_core_space_stats(db_space_stats_t* out_stats);
+
+/**
+ * @brief Open a sharded set of envs, one per path of @p cfg.
+ *
+ * Every shard holds the same DBIs; a key lives on the shard picked by its
+ * hash (@ref db_core_shards_of), so shards on distinct devices write in
+ * parallel, each with its own writer thread and group commit. The handle
+ * does not use db_core_init(): with one shard it is simply another,
+ * independent database. Caches, Bloom filters, indexes, TTL and
+ * compression stay features of the global database.
+ *
+ * @param[out] out Receives the handle on success.
+ * @return 0 on success, -EINVAL, -ENOTSUP (WRITEMAP, custom orders, BLOOM
+ *         or ZIP DBIs), -ENOMEM, or a negative errno of an env open.
+ */
+int db_core_shards_open(db_shards_t** out, const db_shards_cfg_t* cfg);
+
+/**
+ * @brief Wait for the queued writes and close every shard (NULL is a no-op).
+ */
+void db_core_shards_close(db_shards_t* shards);
+
+/**
+ * @brief Shard holding @p key in every DBI.
+ *
+ * @return The shard index (0-based), -EINVAL.
+ */
+int db_core_shards_of(const db_shards_t* shards, const void* key, const size_t key_size);
+
+/**
+ * @brief Allocate a batch for @ref db_core_shards_exec.
+ *
+ * One per thread, like @ref db_core_batch_create.
+ *
+ * @return 0 on success, -EINVAL on NULL output, -ENOMEM.
+ */
+int db_core_shard_batch_create(db_shard_batch_t** out_batch);
+
+/**
+ * @brief Free a shard batch (NULL is a no-op).
+ */
+void db_core_shard_batch_destroy(db_shard_batch_t* batch);
+
+/**
+ * @brief Queue a PUT, GET or DEL into @p batch.
+ *
+ * Keys and PUT values are copied. A GET copies the value into @p val_data,
+ * of @p val_size bytes (-ENOBUFS at exec when too small).
+ *
+ * @return 0 on success, -EINVAL, -ENOMEM.
+ */
+int db_core_shard_batch_add_op(db_shard_batch_t* batch, const unsigned dbi_idx,
+                               const op_type_t type, const void* key_data, const size_t key_size,
+                               const void* val_data, const size_t val_size);
+
+/**
+ * @brief Execute @p batch on @p shards and empty it.
+ *
+ * A batch whose keys share a shard runs in one txn of it. Over several
+ * shards there is no common txn: with @p atomic the batch is refused,
+ * otherwise each shard commits its part on its own, in parallel, and a
+ * failure leaves the other parts committed.
+ *
+ * @return 0 on success, -EINVAL, -EXDEV (atomic over several shards), or the
+ *         first negative errno in shard order.
+ */
+int db_core_shards_exec(db_shards_t* shards, db_shard_batch_t* batch, const int atomic);
+
+/**
+ * @brief Read the counters of @p shards since it was opened.
+ */
+void db_core_shards_stats(const db_shards_t* shards, db_shards_stats_t* out_stats);
+
+/**
+ * @brief Read the map size, pages in use and growth counters.
+ *
+ * The map grows by `map_grow_step` after a commit that leaves less than one
+ * step free, once no other txn is open, so writers rarely hit MDB_MAP_FULL;
+ * the ceiling is `map_size_max`. Once less than half a step is left the
+ * commit waits for the open txns instead; new txns queue behind a waiting
+ * growth. A lease held long delays it.
+ */
+void db_core_map_stats(db_map_stats_t* out_stats);
+
+/**
+ * @brief Snapshot the runtime metrics, summed over every thread.
+ *
+ * Latency histograms of GET / PUT / DEL ops and of txn begin / commit, the
+ * ops per batch, txns begun, retries by LMDB code, GET bytes copied into
+ * write batch caches and the map counters of @ref db_core_map_stats. Each
+ * thread counts into its own slot without locks; counters are cumulative
+ * for the process, so diff two snapshots for a window. Zero (map aside)
+ * when built with DB_LMDB_METRICS 0.
+ */
+void db_core_stats(db_stats_t* out_stats);
+
+/**
+ * @brief Call @p cb after every batch execution, NULL to stop.
+ *
+ * The callback runs on the executing thread, after the txn ended, with the
+ * begin / execute / commit timestamps, retries, op count and an estimate
+ * of the pages the commit appended (see db_trace_t); it must be quick and
+ * must not execute batches itself. With no callback set a batch costs one
+ * relaxed load, and the same phases are exposed as USDT probes (provider
+ * `db_lmdb`) when built with DB_LMDB_USDT.
+ */
+void db_core_set_trace(db_trace_cb_t cb, void* ctx);
+
+/**
+ * @brief Cache the values of DBI @p dbi_idx in process memory.
+ *
+ * GETs into a caller buffer (val_data given) are then served from a
+ * sharded CLOCK cache of at most `cfg->bytes` before LMDB is asked, and a
+ * read batch whose GETs all hit runs without any txn. Values read by
+ * read-only batches fill the cache; every PUT / DEL / REP committed
+ * through this library drops the keys it wrote (a whole DBI for range
+ * deletes and looked up keys), so a GET never returns a value older than
+ * its snapshot. Writes made by another process bypass it: only enable it
+ * for DBIs this process alone writes. Enabling again resets the cache.
+ * Must not be called while batches are being executed.
+ *
+ * @param dbi_idx DBI index (not DUPSORT).
+ * @param cfg     Tuning (NULL or zero fields for the defaults).
+ * @return 0 on success, -EINVAL for an unknown or DUPSORT DBI, -ENOMEM.
+ */
+int db_core_cache_enable(const unsigned dbi_idx, const db_cache_cfg_t* cfg);
+
+/**
+ * @brief Drop the value cache of DBI @p dbi_idx, no-op when it has none.
+ *
+ * Must not be called while batches are being executed.
+ */
+void db_core_cache_disable(const unsigned dbi_idx);
+
+/**
+ * @brief Read the value cache counters of DBI @p dbi_idx.
+ *
+ * @return 0 on success, -ENOENT when the DBI has no cache, -EINVAL.
+ */
+int db_core_cache_stats(const unsigned dbi_idx, db_cache_stats_t* out_stats);
+
+/**
+ * @brief Read the Bloom filter counters of DBI_TYPE_BLOOM DBI @p dbi_idx.
+ *
+ * @return 0 on success, -ENOENT when the DBI has no filter, -EINVAL.
+ */
+int db_core_bloom_stats(const unsigned dbi_idx, db_bloom_stats_t* out_stats);
+
+/**
+ * @brief Maintain a secondary index of DBI @p index->src_dbi.
+ *
+ * From now on every PUT, DEL and REP on the source DBI also writes, in the
+ * same txn, `index_key(key, val) -> key` into @p index->idx_dbi and drops
+ * the entry of the previous value: callers queue the record op only, no
+ * GET of the old value. Register after db_core_init, before any batch
+ * runs; records already stored are not indexed. Range DELs on an indexed
+ * DBI fail with -EOPNOTSUPP.
+ *
+ * @return 0 on success, -EINVAL (unknown, equal or DUPSORT source DBI, a
+ *         DBI both source and index, no callback), -EEXIST, -ENOSPC.
+ */
+int db_core_index_add(const db_index_t* index);
+
+/**
+ * @brief Set how new values of DBI_TYPE_ZIP DBI @p dbi_idx are compressed.
+ *
+ * Values below @p cfg->min_size, or that do not shrink, are stored raw.
+ * With @p cfg->dict, zstd dictionaries trained by @ref db_core_zip_train
+ * are kept in DBI @p cfg->meta_dbi and loaded here: enable with the same
+ * meta DBI after each db_core_init before reading older values. Values
+ * already stored keep their codec. Call it between batches.
+ *
+ * @return 0 on success, -EINVAL (not a ZIP DBI, bad meta DBI, dictionary
+ *         without zstd), -ENOTSUP (codec not built in), or a negative
+ *         errno of the dictionary load.
+ */
+int db_core_zip_enable(const unsigned dbi_idx, const db_zip_cfg_t* cfg);
+
+/**
+ * @brief Train a zstd dictionary and compress new values of @p dbi_idx with it.
+ *
+ * The dictionary is trained on @p samples, or on up to
+ * DB_LMDB_ZIP_TRAIN_SAMPLES stored values when @p samples is NULL, then
+ * written to the meta DBI in a txn of its own. Small values that look
+ * alike (JSON, protobuf records) gain the most. Older dictionaries stay
+ * loaded for the values that use them.
+ *
+ * @return The dictionary id (> 0) on success, -EINVAL (no dictionary set
+ *         up, too few samples), -ENOTSUP (no zstd), -ENOSPC (after
+ *         DB_LMDB_ZIP_DICTS dictionaries), or a negative errno.
+ */
+int db_core_zip_train(const unsigned dbi_idx, const db_view_t* samples, const size_t n_samples);
+
+/**
+ * @brief Read the compression counters of DBI_TYPE_ZIP DBI @p dbi_idx.
+ *
+ * @return 0 on success, -ENOENT when the DBI is not a ZIP one, -EINVAL.
+ */
+int db_core_zip_stats(const unsigned dbi_idx, db_zip_stats_t* out_stats);
+
+/**
+ * @brief Reserve DBI @p cfg->queue_dbi for deadlines and start the expiry sweeper.
+ *
+ * Every @p cfg->period_ms the sweeper walks the queue from the oldest
+ * deadline and deletes the due records, with their index entries, in
+ * write txns of at most @p cfg->batch keys, pausing between two so
+ * batches waiting on the writer lock get it. A sweep stops after
+ * @p cfg->max_per_tick keys, the rest waits for the next one. Deadlines
+ * use the wall clock and survive restarts: start the sweeper with the
+ * same queue after each db_core_init. The sweeper stops in
+ * db_core_shutdown.
+ *
+ * @return 0 on success, -EINVAL (unknown or DUPSORT queue DBI), -EALREADY,
+ *         -ENOMEM.
+ */
+int db_core_ttl_start(const db_ttl_cfg_t* cfg);
+
+/**
+ * @brief Delete every record due now, without waiting for the sweeper.
+ *
+ * @return Records deleted, -ENOTCONN when no sweeper runs, or a negative errno.
+ */
+long db_core_ttl_sweep(void);
+
+/**
+ * @brief Read the expiry sweeper counters.
+ *
+ * @return 0 on success, -ENOTCONN when no sweeper runs, -EINVAL.
+ */
+int db_core_ttl_stats(db_ttl_stats_t* out_stats);
+
+/**
+ * @brief Set the maximum number of operations a single batch may hold.
+ *
+ * Batches grow on demand (starting at DB_LMDB_BATCH_OPS_INIT slots) up to
+ * this limit; once reached, adding an operation fails with -ENOMEM.
+ * The limit applies to every batch, including the default one, and
+ * defaults to DB_LMDB_BATCH_OPS_MAX. It can be changed at any time.
+ *
+ * @param max_ops New limit (must be > 0).
+ * @return 0 on success, -EINVAL when @p max_ops is 0.
+ */
+int db_core_set_batch_max_ops(const size_t max_ops);
+
+/**
+ * @brief Enable or disable reuse of read-only transactions.
+ *
+ * With reuse on (DB_LMDB_RO_TXN_REUSE), each thread parks the txn of its
+ * last read-only batch with `mdb_txn_reset` and renews it for the next one
+ * instead of allocating a fresh txn. Disabling it aborts all parked txns.
+ * Must not be called while batches are being executed.
+ *
+ * @param enable Non-zero to enable reuse, 0 to disable it.
+ */
+void db_core_set_ro_txn_reuse(const int enable);
+
 /**
  * @brief Gracefully shut down the LMDB environment and free DB resources.
  *
@@ -6,6 +6,8 @@
 #ifndef DB_OPERATIONS_OPS_FACADE_H_
 #define DB_OPERATIONS_OPS_FACADE_H_
 
+#include <stddef.h>  /* size_t */
+#include <stdint.h>  /* uint64_t */
 #include "dbi_ext.h" /* dbi_type_t */
 
 #ifdef __cplusplus
@@ -23,7 +25,669 @@ extern "C"
  * PUBLIC STRUCTURED TYPES
  ****************************************************************************
  */
-/* None */
+
+/**
+ * @brief Opaque handle to an operations batch.
+ *
+ * Created with db_core_batch_create(); must be used by one thread at a time.
+ */
+typedef struct ops_batch db_batch_t;
+
+/**
+ * @brief Read-only view of a key or value returned by a leased read or
+ *        a scan.
+ *
+ * Points either into the caller's buffer or straight into the memory map;
+ * valid until the lease is released (leased reads) or the callback
+ * returns (scans). Never write through @ref data.
+ */
+typedef struct
+{
+    size_t      size; /**< Size of value bytes. */
+    const void* data; /**< Pointer to value bytes. */
+} db_view_t;
+
+/**
+ * @brief Per-record scan callback.
+ *
+ * @p key and @p val point into the memory map and are only valid during
+ * the call. Return 0 to continue, a positive value to stop the scan
+ * (success), or a negative errno to fail the whole batch with it.
+ */
+typedef int (*db_scan_cb_t)(const db_view_t* key, const db_view_t* val, void* ctx);
+
+/**
+ * @brief How a scan walks the DBI.
+ */
+typedef enum
+{
+    DB_SCAN_RANGE = 0, /**< Keys in [start, end); an empty bound is open. */
+    DB_SCAN_PREFIX,    /**< Keys starting with start. */
+    DB_SCAN_DUPS       /**< Duplicates of the key start (DUPSORT DBIs). */
+} db_scan_mode_t;
+
+/**
+ * @brief Caller-owned buffer receiving copied scan records.
+ *
+ * Records are packed back to back, each one 8-byte aligned: a
+ * db_scan_rec_t header followed by the key bytes then the value bytes.
+ * Walk them with db_core_page_next().
+ */
+typedef struct
+{
+    void*  buf;     /**< Caller memory for the records. */
+    size_t cap;     /**< Size of buf in bytes. */
+    size_t used;    /**< Out: bytes written. */
+    size_t n_items; /**< Out: records written. */
+} db_scan_page_t;
+
+/**
+ * @brief Header of one record in a db_scan_page_t.
+ */
+typedef struct
+{
+    unsigned int key_size; /**< Key bytes following the header. */
+    unsigned int val_size; /**< Value bytes following the key. */
+} db_scan_rec_t;
+
+/**
+ * @brief Scan request, see db_core_batch_add_scan().
+ *
+ * Must stay valid until the batch has been executed; the out fields are
+ * written during execution.
+ */
+typedef struct
+{
+    db_scan_mode_t  mode;   /**< Walk mode. */
+    db_view_t       start;  /**< RANGE: first key; PREFIX: prefix; DUPS: key. */
+    db_view_t       end;    /**< RANGE only: first key past the range. */
+    size_t          limit;  /**< Max records delivered, 0 = unlimited. */
+    db_scan_cb_t    cb;     /**< Per-record callback, or NULL to fill page. */
+    void*           ctx;    /**< Passed to cb. */
+    db_scan_page_t* page;   /**< Used when cb is NULL. */
+    size_t          n_seen; /**< Out: records delivered. */
+    int             more;   /**< Out: non-zero if stopped before the end. */
+} db_scan_t;
+
+/**
+ * @brief Packed array of fixed-size duplicates of one key (DUPFIXED DBIs).
+ *
+ * The dups sit back to back with no header, in DBI order for reads, so
+ * item i is at `(char*)buf + i * elem_size`. Used by
+ * db_core_batch_add_get_multiple() and db_core_batch_add_put_multiple();
+ * must stay valid until the batch has been executed.
+ */
+typedef struct
+{
+    void*  buf;       /**< GET: caller memory receiving the dups; PUT: the dups. */
+    size_t cap;       /**< GET: size of buf in bytes; unused by PUT. */
+    size_t elem_size; /**< PUT: size of one dup; GET out: size of one dup. */
+    size_t n_items;   /**< PUT: dups in buf; GET out: dups written. */
+    int    more;      /**< GET out: non-zero if buf filled before the last dup. */
+} db_multi_t;
+
+/**
+ * @brief Serializer for a reserved PUT.
+ *
+ * Called inside the write txn with @p dst pointing at @p size bytes
+ * reserved in the target page; it must fill all of them and must not
+ * call back into the database. @p dst is only valid during the call.
+ *
+ * @return 0 on success, a negative errno to abort the batch.
+ */
+typedef int (*db_reserve_cb_t)(void* dst, size_t size, void* ctx);
+
+/**
+ * @brief Reserved PUT request, see db_core_batch_add_put_reserve().
+ *
+ * Must stay valid until the batch has been executed.
+ */
+typedef struct
+{
+    size_t          size;  /**< Value size in bytes reserved in the page. */
+    db_reserve_cb_t write; /**< Serializer filling the reserved bytes. */
+    void*           ctx;   /**< Passed to write. */
+} db_reserve_t;
+
+/**
+ * @brief Mutation callback for a patch (DB_OPERATION_REP).
+ *
+ * Called inside the write txn on the stored value itself, @p size bytes
+ * at @p val; the size cannot change. It must not call back into the
+ * database and @p val is only valid during the call.
+ *
+ * @return 0 on success, a negative errno to abort the batch.
+ */
+typedef int (*db_patch_cb_t)(void* val, size_t size, void* ctx);
+
+/**
+ * @brief In-place patch of an existing value, see db_core_batch_add_patch().
+ *
+ * Either @p bytes is copied over the value at @p offset, or, when
+ * @p mutate is set, the callback edits the value. Must stay valid until
+ * the batch has been executed.
+ */
+typedef struct
+{
+    size_t        offset; /**< First byte patched (bytes mode). */
+    const void*   bytes;  /**< New bytes, NULL in callback mode. */
+    size_t        size;   /**< Number of bytes at bytes. */
+    db_patch_cb_t mutate; /**< Callback mode: edits the whole value. */
+    void*         ctx;    /**< Passed to mutate. */
+} db_patch_t;
+
+/**
+ * @brief Opaque handle to a bulk loader.
+ *
+ * Created with db_core_bulk_begin(); must be used by one thread at a time.
+ */
+typedef struct ops_bulk db_bulk_t;
+
+/**
+ * @brief Bulk loader tuning, zero fields select the defaults.
+ */
+typedef struct
+{
+    size_t commit_records; /**< Commit every N records (DB_LMDB_BULK_COMMIT_RECORDS). */
+    size_t commit_bytes;   /**< Or every M key + value bytes (DB_LMDB_BULK_COMMIT_BYTES). */
+} db_bulk_cfg_t;
+
+/**
+ * @brief Bulk loader progress, counting committed records only.
+ */
+typedef struct
+{
+    size_t records;       /**< Records committed. */
+    size_t bytes;         /**< Key + value bytes committed. */
+    size_t commits;       /**< Write transactions committed. */
+    size_t map_grows;     /**< Map size increases done ahead of a commit. */
+    double seconds;       /**< Wall time since the loader was created. */
+    double records_per_s; /**< records / seconds. */
+    double mib_per_s;     /**< bytes / seconds, in MiB. */
+} db_bulk_stats_t;
+
+/**
+ * @brief Group-commit writer tuning, zero fields select the defaults.
+ */
+typedef struct
+{
+    size_t max_batches; /**< Batches merged into one txn (DB_LMDB_GROUP_MAX_BATCHES). */
+} db_group_cfg_t;
+
+/**
+ * @brief Group-commit writer counters since db_core_group_start().
+ */
+typedef struct
+{
+    size_t batches;   /**< Write batches completed, successful or not. */
+    size_t failed;    /**< Batches completed with an error. */
+    size_t commits;   /**< Group txns committed. */
+    size_t fallbacks; /**< Groups redone one batch per txn (MAP_FULL, retries). */
+} db_group_stats_t;
+
+/**
+ * @brief Async submission tuning, zero fields select the defaults.
+ */
+typedef struct
+{
+    size_t readers; /**< Worker threads executing batches (DB_LMDB_ASYNC_READERS). */
+    size_t depth;   /**< Batches in flight before -EAGAIN (DB_LMDB_ASYNC_DEPTH). */
+    int    eventfd; /**< Non-zero: signal completions on an eventfd (db_core_async_fd()). */
+} db_async_cfg_t;
+
+/**
+ * @brief Completion callback of an async batch, called on a worker or writer thread.
+ */
+typedef void (*db_async_cb_t)(db_batch_t* batch, int res, void* ctx);
+
+/**
+ * @brief Completion of an async batch submitted without callback (db_core_async_poll()).
+ */
+typedef struct
+{
+    db_batch_t* batch; /**< Batch submitted, emptied as after an execution. */
+    int         res;   /**< 0 or the negative errno of the batch. */
+    void*       ctx;   /**< Context given at submit. */
+} db_async_done_t;
+
+/**
+ * @brief Async submission counters since db_core_async_start().
+ */
+typedef struct
+{
+    size_t submitted;     /**< Batches accepted. */
+    size_t completed;     /**< Batches done, successful or not. */
+    size_t failed;        /**< Batches done with an error. */
+    size_t reads;         /**< Read-only batches run by the workers. */
+    size_t writes;        /**< Write batches, through the group writer or the workers. */
+    size_t rejected;      /**< Submits refused with -EAGAIN (queue full). */
+    size_t peak_inflight; /**< Most batches in flight at once. */
+} db_async_stats_t;
+
+/**
+ * @brief Value cache of one DBI, zero fields select the defaults.
+ */
+typedef struct
+{
+    size_t bytes;        /**< Budget, keys + values + entry overhead (DB_LMDB_VCACHE_BYTES). */
+    size_t shards;       /**< Lock shards, rounded up to a power of 2 (DB_LMDB_VCACHE_SHARDS). */
+    size_t max_val_size; /**< Larger values are never cached (DB_LMDB_VCACHE_MAX_VAL). */
+} db_cache_cfg_t;
+
+/**
+ * @brief Value cache counters of one DBI since it was enabled.
+ */
+typedef struct
+{
+    size_t hits;          /**< GETs served from the cache. */
+    size_t misses;        /**< GETs that went to LMDB. */
+    size_t fills;         /**< Values inserted after a read. */
+    size_t evictions;     /**< Entries dropped by CLOCK to make room. */
+    size_t invalidations; /**< Entries dropped by committed writes. */
+    size_t entries;       /**< Entries cached now. */
+    size_t bytes;         /**< Bytes charged now. */
+} db_cache_stats_t;
+
+/**
+ * @brief Bloom filter of a DBI_TYPE_BLOOM DBI.
+ */
+typedef struct
+{
+    size_t bits;            /**< Filter size. */
+    size_t keys;            /**< Keys added since the build (a re-added key may count). */
+    size_t capacity;        /**< Keys before the filter saturates. */
+    size_t negatives;       /**< GETs answered -ENOENT by the filter (DB_LMDB_METRICS). */
+    size_t false_positives; /**< GETs it let through that LMDB did not find (DB_LMDB_METRICS). */
+    int    loaded;          /**< Non-zero when read from the sidecar file, 0 when scanned. */
+    int    saturated;       /**< Non-zero once full: bypassed until the next rebuild. */
+} db_bloom_stats_t;
+
+/**
+ * @brief Derives the index key of a record, see db_index_t.
+ *
+ * Called inside the write txn with the record as stored before and after
+ * each write to the source DBI. Write at most @p *out_size bytes to @p out
+ * and set @p *out_size to the key size. Must not call back into the
+ * database.
+ *
+ * @return 0 with a key, a positive value when the record is not indexed,
+ *         or a negative errno to fail the batch with it.
+ */
+typedef int (*db_index_key_cb_t)(const db_view_t* key, const db_view_t* val, void* out,
+                                 size_t* out_size, void* ctx);
+
+/**
+ * @brief Secondary index, see db_core_index_add().
+ *
+ * Every record `key -> val` of @ref src_dbi is mirrored as
+ * `index_key(key, val) -> key` in @ref idx_dbi by the write txn that
+ * changes it. A NOOVERWRITE @ref idx_dbi makes the index unique (-EEXIST),
+ * a DUPSORT one lets several records share an index key.
+ */
+typedef struct
+{
+    unsigned          src_dbi;   /**< Indexed DBI, not DUPSORT. */
+    unsigned          idx_dbi;   /**< DBI holding index key -> source key. */
+    db_index_key_cb_t index_key; /**< Index key of a record. */
+    void*             ctx;       /**< Passed to index_key. */
+} db_index_t;
+
+/**
+ * @brief Expiry sweeper settings, see db_core_ttl_start(). Zero fields take
+ *        the DB_LMDB_TTL_* defaults.
+ */
+typedef struct
+{
+    unsigned queue_dbi;    /**< Plain DBI reserved for the expiry queue. */
+    unsigned period_ms;    /**< Time between two sweeps. */
+    size_t   batch;        /**< Expired keys deleted per write txn. */
+    size_t   max_per_tick; /**< Expired keys deleted per sweep, the rest waits. */
+} db_ttl_cfg_t;
+
+/**
+ * @brief Counters of the expiry sweeper.
+ */
+typedef struct
+{
+    size_t armed;    /**< Deadlines written by TTL puts. */
+    size_t disarmed; /**< Deadlines dropped by a DEL or a plain PUT of the key. */
+    size_t expired;  /**< Records deleted because their deadline passed. */
+    size_t stale;    /**< Queue entries dropped without a delete (deadline moved). */
+    size_t txns;     /**< Write txns committed by the sweeper. */
+    size_t sweeps;   /**< Sweeps run, by the thread or db_core_ttl_sweep(). */
+} db_ttl_stats_t;
+
+/**
+ * @brief Codec of the values written to a DBI_TYPE_ZIP DBI.
+ */
+typedef enum
+{
+    DB_ZIP_AUTO = 0, /**< LZ4 when built in, else zstd, else raw. */
+    DB_ZIP_NONE = 1, /**< Raw values. */
+    DB_ZIP_LZ4  = 2, /**< LZ4 blocks: fastest. */
+    DB_ZIP_ZSTD = 3  /**< zstd frames, with a trained dictionary when dict is set. */
+} db_zip_codec_t;
+
+/**
+ * @brief Compression of a DBI_TYPE_ZIP DBI, see db_core_zip_enable(). Zero
+ *        fields take the DB_LMDB_ZIP_* defaults.
+ */
+typedef struct
+{
+    db_zip_codec_t codec;    /**< Codec of new values. */
+    int            level;    /**< zstd level. */
+    size_t         min_size; /**< Smaller values are stored raw. */
+    int            dict;     /**< zstd: use the dictionaries kept in meta_dbi. */
+    unsigned       meta_dbi; /**< Plain DBI of the dictionaries, read when dict is set. */
+} db_zip_cfg_t;
+
+/**
+ * @brief Counters of a DBI_TYPE_ZIP DBI.
+ */
+typedef struct
+{
+    size_t   packed;    /**< Values written compressed. */
+    size_t   raw;       /**< Values written raw (small or incompressible). */
+    size_t   bytes_in;  /**< Value bytes of those writes. */
+    size_t   bytes_out; /**< Bytes stored for them, headers included. */
+    unsigned dict_id;   /**< Dictionary of new values, 0 = none. */
+} db_zip_stats_t;
+
+/**
+ * @brief Counters of the last execution of a batch.
+ *
+ * Write batches longer than one segment run each segment in a child txn
+ * (savepoint): a retryable failure rolls back and redoes that segment only.
+ * MAP_FULL still restarts the whole txn once the map has grown.
+ */
+typedef struct
+{
+    size_t attempts;     /**< Top-level txns begun, 1 when nothing was retried. */
+    size_t segments;     /**< Savepoint segments committed into the last txn. */
+    size_t seg_retries;  /**< Segments rolled back and redone alone. */
+    size_t replayed_ops; /**< Ops executed again because of retries. */
+} db_exec_stats_t;
+
+/**
+ * @brief Environment durability / performance profile for db_core_init_ex().
+ */
+typedef enum
+{
+    DB_ENV_PROFILE_DURABLE = 0, /**< fsync data and meta page at every commit (db_core_init). */
+    DB_ENV_PROFILE_FAST_ASYNC,  /**< No fsync at commit, a background thread syncs every N ms. */
+    DB_ENV_PROFILE_READ_MOSTLY, /**< Durable, no OS readahead, more reader slots. */
+    DB_ENV_PROFILE_MAX
+} db_env_profile_t;
+
+/**
+ * @brief Environment options, OR'ed onto the ones of the profile.
+ */
+typedef enum
+{
+    DB_ENV_OPT_NONE       = 0,
+    DB_ENV_OPT_NOSYNC     = 1u << 0, /**< MDB_NOSYNC: no fsync at commit. */
+    DB_ENV_OPT_NOMETASYNC = 1u << 1, /**< MDB_NOMETASYNC: fsync data, meta page lazily. */
+    DB_ENV_OPT_WRITEMAP   = 1u << 2, /**< MDB_WRITEMAP: write through a writable map. */
+    DB_ENV_OPT_NORDAHEAD  = 1u << 3, /**< MDB_NORDAHEAD: no OS readahead. */
+} db_env_opt_t;
+
+/**
+ * @brief Warm start options of db_core_init_ex(), for a reopen after a crash
+ *        or a restart on cold storage.
+ */
+typedef enum
+{
+    DB_WARM_NONE         = 0,
+    DB_WARM_READER_CHECK = 1u << 0, /**< mdb_reader_check: free slots of dead processes. */
+    DB_WARM_PREFETCH_MAP = 1u << 1, /**< madvise(MADV_WILLNEED) over the used part of the map. */
+    DB_WARM_SCHEMA       = 1u << 2, /**< Keep a schema record in the env: when it matches,
+                                         open the DBIs in a read txn with its flags. */
+} db_warm_opt_t;
+
+/**
+ * @brief Key (or dup) order of a DBI, see db_env_cfg_t.key_cmps.
+ *
+ * Returns < 0, 0 or > 0 as memcmp. LMDB calls it for every comparison in
+ * a txn: keep it pure and fast. Every process and run opening the env
+ * must install the same order, or the B-tree reads as unsorted.
+ */
+typedef int (*db_cmp_fn_t)(const db_view_t* a, const db_view_t* b);
+
+/**
+ * @brief Environment setup for db_core_init_ex().
+ *
+ * Start from db_core_env_profile() and override what is needed; zero
+ * fields select the profile value (and then the config.h defaults).
+ */
+typedef struct
+{
+    db_env_profile_t   profile;       /**< Base profile. */
+    unsigned           opts;          /**< Extra db_env_opt_t bits. */
+    size_t             map_size_init; /**< Initial map size (DB_MAP_SIZE_INIT). */
+    size_t             map_size_max;  /**< Map growth limit (DB_MAP_SIZE_MAX). */
+    size_t             map_grow_step; /**< Bytes added per map growth (DB_MAP_GROW_STEP). */
+    unsigned           max_readers;   /**< Reader slots (LMDB default 126). */
+    unsigned           max_dbis;      /**< Named DBIs the env can hold (DB_MAX_DBIS). */
+    unsigned           sync_ms;       /**< Background sync period when NOSYNC/NOMETASYNC. */
+    const db_cmp_fn_t* key_cmps;      /**< Key order of each DBI (n_dbis entries, NULL for
+                                           memcmp order), NULL for none. */
+    const db_cmp_fn_t* dup_cmps;      /**< Dup order of each DUPSORT DBI, as key_cmps. */
+    unsigned           warm;          /**< db_warm_opt_t bits. */
+    unsigned           prefetch_dbis; /**< Bit i: walk DBI i in the background after the
+                                           open, one thread per DBI. */
+} db_env_cfg_t;
+
+/**
+ * @brief Opaque handle to a set of environments, keys routed by hash.
+ */
+typedef struct ops_shards db_shards_t;
+
+/**
+ * @brief Opaque handle to a batch of a db_shards_t.
+ */
+typedef struct ops_shard_batch db_shard_batch_t;
+
+/**
+ * @brief Setup of db_core_shards_open(), zero fields select the defaults.
+ */
+typedef struct
+{
+    const char* const*  paths;       /**< Env directory of each shard, e.g. on distinct devices. */
+    unsigned            n_shards;    /**< Shards, 1 to DB_LMDB_SHARDS_MAX. */
+    const char* const*  dbi_names;   /**< DBIs opened in every shard. */
+    const dbi_type_t*   dbi_types;   /**< Their types (no BLOOM or ZIP). */
+    unsigned            n_dbis;      /**< Number of DBIs, up to DB_MAX_DBIS. */
+    unsigned            mode;        /**< Mode of the env files (DB_LMDB_ENV_MODE). */
+    const db_env_cfg_t* env;         /**< Setup of every shard env, NULL for the durable
+                                          profile; no WRITEMAP, no custom orders. */
+    size_t              max_batches; /**< Batches merged per shard txn
+                                          (DB_LMDB_GROUP_MAX_BATCHES). */
+} db_shards_cfg_t;
+
+/**
+ * @brief Counters of a db_shards_t since it was opened.
+ */
+typedef struct
+{
+    size_t batches; /**< Batches executed, successful or not. */
+    size_t single;  /**< Batches on one shard, atomic. */
+    size_t split;   /**< Batches split over several shards, atomic per shard. */
+    size_t refused; /**< Atomic batches over several shards, refused with -EXDEV. */
+    size_t failed;  /**< Batches with an error. */
+    size_t commits; /**< Write txns committed over all shards. */
+    size_t grows;   /**< Map growths over all shards. */
+} db_shards_stats_t;
+
+/**
+ * @brief db_core_backup() flags.
+ */
+typedef enum
+{
+    DB_BACKUP_COMPACT = 1u << 0 /**< MDB_CP_COMPACT: drop free pages, renumber the others. */
+} db_backup_flag_t;
+
+/**
+ * @brief Backup progress, called on the backup thread after each chunk.
+ *
+ * @p total is estimated at start: the copy may end below it.
+ */
+typedef void (*db_backup_progress_cb_t)(size_t written, size_t total, void* ctx);
+
+/**
+ * @brief Setup of db_core_backup(), zero fields for full speed and no callback.
+ */
+typedef struct
+{
+    unsigned                flags;     /**< db_backup_flag_t bits. */
+    unsigned                rate_mb_s; /**< Throttle in MB/s, 0 for none. */
+    db_backup_progress_cb_t progress;  /**< Progress callback, NULL for none. */
+    void*                   ctx;       /**< Context of progress. */
+    size_t                  headroom;  /**< Map bytes free before the copy, 0: sized by rate. */
+} db_backup_cfg_t;
+
+/**
+ * @brief State of the current or last backup since db_core_init().
+ */
+typedef struct
+{
+    int      running;    /**< A backup is copying. */
+    int      res;        /**< 0 or the negative errno of the last finished backup. */
+    size_t   written;    /**< Bytes written to the fd by the current or last backup. */
+    size_t   total;      /**< Its expected size, estimated at start. */
+    uint64_t elapsed_ms; /**< Its duration so far. */
+    size_t   backups;    /**< Backups finished, successful or not. */
+    size_t   reserved;   /**< Map bytes grown for it before the copy. */
+    size_t   headroom;   /**< Map bytes free for writes while its copy holds the map. */
+    size_t   deferred;   /**< Map growths put off while its copy held the map. */
+    size_t   refused;    /**< Writes failed on a full map while its copy held the map. */
+} db_backup_status_t;
+
+/**
+ * @brief Page usage of the env, to tell when a compacting copy is worth it.
+ */
+typedef struct
+{
+    size_t   page_size;     /**< Bytes per page. */
+    size_t   map_size;      /**< Current map size. */
+    size_t   pages_last;    /**< Pages up to the high-water mark: size of a plain copy. */
+    size_t   pages_free;    /**< Pages on the freelist, reused by later writes. */
+    size_t   pages_tree;    /**< Branch, leaf and overflow pages of the main tree and DBIs. */
+    size_t   entries;       /**< Records over the DBIs. */
+    unsigned depth;         /**< Depth of the main tree. */
+    size_t   compact_bytes; /**< Estimated size of a compacting copy. */
+} db_space_stats_t;
+
+/**
+ * @brief What the warm start of the open database did.
+ */
+typedef struct
+{
+    unsigned readers_cleared; /**< Stale reader slots freed by mdb_reader_check. */
+    int      schema_hit;      /**< Non-zero when the DBIs were opened from the schema record. */
+    size_t   advised_bytes;   /**< Bytes of the map passed to madvise(MADV_WILLNEED). */
+    unsigned walkers;         /**< Prefetch walks still running. */
+    size_t   walked;          /**< Entries visited by the walks. */
+    size_t   walked_bytes;    /**< Key and value bytes touched by the walks. */
+    uint64_t walk_ms;         /**< From the open to the end of the last walk. */
+    int      walk_res;        /**< First walk error, 0 when none. */
+} db_warm_stats_t;
+
+/**
+ * @brief Map size and growth counters since db_core_init().
+ */
+typedef struct
+{
+    size_t map_size;   /**< Current map size in bytes. */
+    size_t used;       /**< Bytes of pages in use (last page number * page size). */
+    size_t map_max;    /**< Growth ceiling. */
+    size_t grows;      /**< Proactive growths done after a commit. */
+    size_t full_grows;   /**< Growths after a txn hit MDB_MAP_FULL. */
+    size_t deferred;     /**< Proactive growths put off while txns were open. */
+    size_t full_refused; /**< MDB_MAP_FULL growths the busy gate refused: the write failed. */
+} db_map_stats_t;
+
+/* Buckets of a db_hist_t: bucket b counts values in [2^(b-1), 2^b), 0 in 0 */
+#define DB_STATS_BUCKETS 32u
+
+/**
+ * @brief Latency histograms of db_stats_t.
+ */
+typedef enum
+{
+    DB_STATS_LAT_GET = 0,    /**< One GET op, lookup and copy included. */
+    DB_STATS_LAT_PUT,        /**< One PUT op (plain, multi, reserved or patch). */
+    DB_STATS_LAT_DEL,        /**< One DEL op, ranges included. */
+    DB_STATS_LAT_TXN_BEGIN,  /**< mdb_txn_begin / renew of a top-level txn. */
+    DB_STATS_LAT_TXN_COMMIT, /**< mdb_txn_commit, children included. */
+    DB_STATS_LAT_MAX
+} db_stats_lat_t;
+
+/**
+ * @brief LMDB codes counted when security_check() asks for a retry.
+ */
+typedef enum
+{
+    DB_STATS_RETRY_MAP_FULL = 0, /**< MDB_MAP_FULL. */
+    DB_STATS_RETRY_MAP_RESIZED,  /**< MDB_MAP_RESIZED. */
+    DB_STATS_RETRY_TXN_FULL,     /**< MDB_TXN_FULL. */
+    DB_STATS_RETRY_PAGE_FULL,    /**< MDB_PAGE_FULL. */
+    DB_STATS_RETRY_CURSOR_FULL,  /**< MDB_CURSOR_FULL. */
+    DB_STATS_RETRY_READERS,      /**< MDB_READERS_FULL / MDB_BAD_RSLOT. */
+    DB_STATS_RETRY_MAX
+} db_stats_retry_t;
+
+/**
+ * @brief Log2-bucketed histogram.
+ */
+typedef struct
+{
+    size_t count;                     /**< Samples. */
+    size_t sum;                       /**< Sum of the samples. */
+    size_t buckets[DB_STATS_BUCKETS]; /**< See DB_STATS_BUCKETS. */
+} db_hist_t;
+
+/**
+ * @brief Process-wide counters, summed over every thread (db_core_stats()).
+ *
+ * Counters only grow; diff two snapshots for a rate. All zero when the
+ * library is built with DB_LMDB_METRICS 0.
+ */
+typedef struct
+{
+    db_hist_t      lat_ns[DB_STATS_LAT_MAX];    /**< Latencies in ns, see db_stats_lat_t. */
+    db_hist_t      batch_ops;                   /**< Ops per executed batch. */
+    size_t         txn_rw;                      /**< Top-level write txns begun. */
+    size_t         txn_ro;                      /**< Read txns begun or renewed. */
+    size_t         retries[DB_STATS_RETRY_MAX]; /**< Retries by LMDB code. */
+    size_t         rw_cache_bytes;              /**< GET bytes copied into write batch caches. */
+    db_map_stats_t map;                         /**< Map size and expansions. */
+} db_stats_t;
+
+/**
+ * @brief Phase timings of one batch execution, see db_core_set_trace().
+ *
+ * Timestamps are CLOCK_MONOTONIC ns. t_begun and t_executed are those of
+ * the last attempt; time lost to earlier attempts shows between t_start and
+ * t_begun.
+ */
+typedef struct
+{
+    const void* batch;       /**< Batch executed, to correlate events. */
+    int         rw;          /**< Non-zero for a write txn. */
+    int         result;      /**< 0 or the negative errno of the execution. */
+    size_t      n_ops;       /**< Ops queued in the batch. */
+    unsigned    retries;     /**< Attempts beyond the first. */
+    size_t      dirty_pages; /**< Pages the commit appended to the map, reused pages not seen. */
+    uint64_t    t_start;     /**< Execution entered. */
+    uint64_t    t_begun;     /**< Txn begun, the writer lock held for RW. */
+    uint64_t    t_executed;  /**< Ops done, before the commit. */
+    uint64_t    t_end;       /**< Committed / released, or failed. */
+} db_trace_t;
+
+/**
+ * @brief Trace callback, called on the executing thread after each batch.
+ */
+typedef void (*db_trace_cb_t)(const db_trace_t* trace, void* ctx);
 
 /**
  * @brief Operation kind.
@@ -33,9 +697,9 @@ typedef enum
     DB_OPERATION_NONE = 0, /**< Uninitialized placeholder. */
     DB_OPERATION_PUT,      /**< Insert/replace value; honors MDB flags. */
     DB_OPERATION_GET,      /**< Lookup by key; fills op->dst/op->dst_len. */
-    // DB_OPERATION_REP,      /**< In-place patch of existing value (cursor + RESERVE). */
-    // DB_OPERATION_LST,      /**< Reserved for future list/scan helpers. */
-    DB_OPERATION_DEL, /**< Delete by key or (key, dup-value). */
+    DB_OPERATION_REP,      /**< In-place patch of existing value (cursor + RESERVE). */
+    DB_OPERATION_DEL,      /**< Delete by key or (key, dup-value). */
+    DB_OPERATION_LST,      /**< Cursor scan, see db_scan_t. */
     DB_OPERATION_MAX
 } op_type_t;
 
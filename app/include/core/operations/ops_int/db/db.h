@@ -34,6 +34,7 @@ typedef struct
     dbi_t*   dbis;               /* array of DBI descriptors */
     size_t   n_dbis;             /* number of DBIs in array */
     size_t   map_size_bytes_max; /* maximum map size */
+    unsigned env_flags;          /* MDB_* flags the env was opened with */
 } DataBase_t;
 
 /************************************************************************
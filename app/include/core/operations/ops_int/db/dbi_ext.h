@@ -29,7 +29,12 @@ typedef enum
     DBI_TYPE_DEFAULT     = 0,      /* no special flags */
     DBI_TYPE_NOOVERWRITE = 1 << 0, /* disallow overwrites */
     DBI_TYPE_DUPSORT     = 1 << 1, /* sorted duplicate keys */
-    DBI_TYPE_DUPFIXED    = 1 << 2  /* fixed-size duplicate keys */
+    DBI_TYPE_DUPFIXED    = 1 << 2, /* fixed-size duplicate keys */
+    DBI_TYPE_BLOOM       = 1 << 3, /* in-memory Bloom filter of the keys, see db_core_init */
+    DBI_TYPE_INTEGERKEY  = 1 << 4, /* native unsigned int or size_t keys, numeric order */
+    DBI_TYPE_INTEGERDUP  = 1 << 5, /* native integer dups, numeric order (implies
+                                      DUPSORT | DUPFIXED) */
+    DBI_TYPE_ZIP         = 1 << 6  /* compressed values, see db_core_zip_enable */
 } dbi_type_t;
 
 /****************************************************************************
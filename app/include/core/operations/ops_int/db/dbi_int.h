@@ -6,6 +6,8 @@
 #ifndef DB_LMDB_DBI_INT_H
 #define DB_LMDB_DBI_INT_H
 
+#include <stddef.h>  /* size_t */
+
 #include "dbi_ext.h" /* dbi_type_t and other external DBI types */
 
 #ifdef __cplusplus
@@ -37,6 +39,8 @@ typedef struct
     unsigned     put_flags;   /**< Default flags to OR into mdb_put calls. */
     unsigned     is_dupsort;  /**< Non-zero if DB uses MDB_DUPSORT. */
     unsigned     is_dupfixed; /**< Non-zero if DB uses MDB_DUPFIXED. */
+    unsigned     is_intkey;   /**< Non-zero if DB uses MDB_INTEGERKEY. */
+    unsigned     is_intdup;   /**< Non-zero if DB uses MDB_INTEGERDUP. */
 } dbi_t;
 
 /****************************************************************************
@@ -60,6 +64,15 @@ unsigned int dbi_open_flags_from_type(dbi_type_t type);
  */
 unsigned int dbi_put_flags_from_type(dbi_type_t type);
 
+/**
+ * @brief Check the size of a key of an MDB_INTEGERKEY DBI (or a dup of an
+ *        MDB_INTEGERDUP one).
+ *
+ * @param size Size in bytes.
+ * @return Non-zero for sizeof(unsigned int) or sizeof(size_t), 0 otherwise.
+ */
+int dbi_int_size_ok(const size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,7 @@
 #ifndef DB_OPERATIONS_OPS_ACTIONS_H_
 #define DB_OPERATIONS_OPS_ACTIONS_H_
 
+#include "ops_arena.h"     /* ops_arena_t */
 #include "ops_internals.h" /* op_t etc */
 
 #ifdef __cplusplus
@@ -42,15 +43,30 @@ extern "C"
  */
 db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, int* const out_err);
 
+/**
+ * @brief Begin a child write transaction of @p parent.
+ *
+ * Aborting the child leaves @p parent usable; committing it merges its
+ * writes into @p parent. Nothing reaches disk before @p parent commits.
+ *
+ * @param[in]  parent  Active RW LMDB transaction.
+ * @param[out] out_txn Child transaction handle.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_txn_begin.
+ */
+db_security_ret_code_t act_txn_nested_begin(MDB_txn* parent, MDB_txn** out_txn,
+                                            int* const out_err);
+
 /**
  * @brief Commit a transaction and map LMDB results to the safety policy.
  *
  * @details
  * This helper commits the provided transaction and interprets LMDB's return
  * value through the `security_check` policy. On recoverable situations the
- * function may return `DB_SAFETY_RETRY` (for example when mapsize expansion
- * was performed and a retry is suggested). On failure the transaction will
- * be aborted if required by the policy.
+ * function may return `DB_SAFETY_RETRY` (for example on MDB_MAP_FULL, with
+ * `-ENOSPC`, once the caller has grown the map). On failure the transaction
+ * will be aborted if required by the policy.
  *
  * @param[in] txn      Active transaction previously returned from
  *                    `act_txn_begin`.
@@ -62,17 +78,74 @@ db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, in
  */
 db_security_ret_code_t act_txn_commit(MDB_txn* const txn, int* const out_err);
 
+/**
+ * @brief Obtain a read-only transaction, reusing the thread's parked one.
+ *
+ * @details
+ * When reuse is enabled each thread keeps at most one read-only txn parked
+ * after @ref act_txn_ro_end. This function renews it (`mdb_txn_renew`),
+ * which is far cheaper than allocating a new txn; otherwise, or when the
+ * renew fails, it falls back to `act_txn_begin(MDB_RDONLY)`.
+ * The environment must be opened with `MDB_NOTLS` so that reader slots
+ * belong to txn handles rather than threads.
+ *
+ * @param[out] out_txn Receives the txn on success.
+ * @param[out] out_err Optional pointer to receive a negative errno.
+ *
+ * @return Same as @ref act_txn_begin.
+ */
+db_security_ret_code_t act_txn_ro_begin(MDB_txn** out_txn, int* const out_err);
+
+/**
+ * @brief Finish a read-only transaction obtained with @ref act_txn_ro_begin.
+ *
+ * The txn is reset (`mdb_txn_reset`) and parked for the next read of the
+ * calling thread, or aborted when reuse is disabled or a txn is already
+ * parked. NULL is a no-op.
+ */
+void act_txn_ro_end(MDB_txn* txn);
+
+/**
+ * @brief Abort every parked read-only transaction of every thread.
+ *
+ * Must be called before the environment is closed; no batch may be
+ * executing concurrently.
+ */
+void act_txn_ro_flush(void);
+
+/**
+ * @brief Enable or disable parking of read-only transactions.
+ *
+ * Disabling also flushes all parked txns. Defaults to DB_LMDB_RO_TXN_REUSE.
+ */
+void act_txn_ro_set_reuse(const int enable);
+
+/**
+ * @brief Resolve the key of @p op, following lookups into earlier ops.
+ *
+ * @return The key, NULL when the descriptor is invalid.
+ */
+MDB_val* act_op_key(op_t* op);
+
+/**
+ * @brief Resolve the value of @p op, see @ref act_op_key.
+ */
+MDB_val* act_op_val(op_t* op);
+
 /**
  * @brief Execute a single GET operation.
  *
  * @param[in]  txn  Active LMDB transaction.
  * @param[in,out]  op   Operation descriptor.
+ * @param[in]  arena Holds compressed values of ZIP DBIs read without a user
+ *                   buffer; NULL refuses them with -ENOBUFS.
  * @param[out] out_err Optional pointer to errno-style error code.
  *
  * @return DB_SAFETY_SUCCESS on success; DB_SAFETY_RETRY if the operation should
- *         be retried; DB_SAFETY_FAIL on permanent failure.
+ *         be retried; DB_SAFETY_FAIL on permanent failure. On anything but
+ *         success @p txn has been aborted and must not be used again.
  */
-db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err);
+db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, ops_arena_t* arena, int* const out_err);
 
 /**
  * @brief Execute a single PUT operation.
@@ -82,10 +155,163 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err);
  * @param[out] out_err Optional pointer to errno-style error code.
  *
  * @return DB_SAFETY_SUCCESS on success; DB_SAFETY_RETRY if the operation should
- *         be retried; DB_SAFETY_FAIL on permanent failure.
+ *         be retried; DB_SAFETY_FAIL on permanent failure. On anything but
+ *         success @p txn has been aborted and must not be used again.
  */
 db_security_ret_code_t act_put(MDB_txn* txn, op_t* op, int* const out_err);
 
+/**
+ * @brief Execute a PUT known to land at the end of its DBI.
+ *
+ * Writes through @p cur with MDB_APPEND (OP_FLAG_APPEND) or MDB_APPENDDUP
+ * (OP_FLAG_APPENDDUP) on top of the DBI put flags, which skips the tree
+ * search and fills leaf pages instead of splitting them. If LMDB refuses
+ * the append (key or duplicate not past the end), the put is redone
+ * without it and the flag is cleared from `op->flags`.
+ *
+ * @param[in]  txn     Active RW LMDB transaction.
+ * @param[in,out] op   PUT descriptor with PRESENT key and val.
+ * @param[in,out] cur  Cursor slot for `op->dbi`, opened when NULL.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put.
+ */
+db_security_ret_code_t act_put_append(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                      int* const out_err);
+
+/**
+ * @brief Compare two PUT ops in the order LMDB stores them.
+ *
+ * Orders by DBI index, then key (DBI key comparator), then value on
+ * DUPSORT DBIs (DBI dup comparator). Both ops need PRESENT key and val.
+ *
+ * @return 0 when equal; -1/+1 when only the value differs; -2/+2 when the
+ *         DBI or the key differs.
+ */
+int act_put_cmp(MDB_txn* txn, const op_t* a, const op_t* b);
+
+/**
+ * @brief Tell whether the key of @p op sorts after the last key of its DBI.
+ *
+ * @param[in]  txn     Active LMDB transaction.
+ * @param[in]  op      Operation with a PRESENT key.
+ * @param[in,out] cur  Cursor slot for `op->dbi`, opened when NULL.
+ * @param[out] out_after 1 when the DBI is empty or its last key is smaller.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put.
+ */
+db_security_ret_code_t act_put_after_last(MDB_txn* txn, const op_t* op, MDB_cursor** cur,
+                                          int* const out_after, int* const out_err);
+
+/**
+ * @brief Execute a single DEL operation.
+ *
+ * - Without a value, deletes the key (all its duplicates on DUPSORT DBIs).
+ * - With a value, deletes only that (key, value) pair; DUPSORT DBIs only.
+ * - With OP_FLAG_RANGE, deletes every key in [key, val) with one cursor
+ *   walk; an empty range is not an error.
+ *
+ * Keys may be LOOKUP descriptors, e.g. a GET followed by a DEL of the same
+ * key in one RW txn.
+ *
+ * @param[in]  txn  Active RW LMDB transaction.
+ * @param[in,out]  op   Operation descriptor.
+ * @param[out] out_err Optional pointer to errno-style error code
+ *                     (-ENOENT when a single key or pair is missing).
+ *
+ * @return Same as @ref act_put.
+ */
+db_security_ret_code_t act_del(MDB_txn* txn, op_t* op, int* const out_err);
+
+/**
+ * @brief Execute a single LST (cursor scan) operation.
+ *
+ * Walks the DBI as described by `op->scan` and delivers every record to
+ * the scan callback, or copies it into the scan page. The scan bounds
+ * come from `op->key` (start/prefix/dup key, NONE = open) and `op->val`
+ * (RANGE end, NONE = open), so they may be LOOKUP descriptors.
+ *
+ * @param[in]  txn     Active LMDB transaction.
+ * @param[in,out] op   Operation descriptor; `op->scan` out fields are set.
+ * @param[in,out] cur  Cursor slot for `op->dbi`: used when non-NULL and
+ *                     bound to @p txn, otherwise a cursor is opened into it.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put. A page too small for the first record
+ *         fails with -ENOBUFS; a negative callback result fails with it.
+ */
+db_security_ret_code_t act_lst(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err);
+
+/**
+ * @brief Copy every duplicate of a key into `op->multi` (DUPFIXED DBIs).
+ *
+ * Reads the dups a page at a time with MDB_GET_MULTIPLE / MDB_NEXT_MULTIPLE
+ * and packs them into `op->multi->buf`. When the buffer fills up, only
+ * whole dups are kept and `op->multi->more` is set. A missing key yields
+ * zero dups. On success `op->val` is PRESENT over the packed bytes.
+ *
+ * @param[in]  txn     Active LMDB transaction.
+ * @param[in,out] op   Operation descriptor; `op->multi` out fields are set.
+ * @param[in,out] cur  Cursor slot for `op->dbi`, opened when NULL.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put. A non DUPFIXED DBI fails with -EINVAL; a
+ *         buffer too small for one dup fails with -ENOBUFS.
+ */
+db_security_ret_code_t act_get_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err);
+
+/**
+ * @brief Store `op->multi->n_items` dups of one key with one MDB_MULTIPLE put.
+ *
+ * The dups are read from `op->multi->buf`, `op->multi->elem_size` bytes
+ * each, on top of the DBI put flags. DUPFIXED DBIs only.
+ *
+ * @param[in]  txn     Active RW LMDB transaction.
+ * @param[in]  op      Operation descriptor with a key and `op->multi`.
+ * @param[in,out] cur  Cursor slot for `op->dbi`, opened when NULL.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put. A non DUPFIXED DBI fails with -EINVAL.
+ */
+db_security_ret_code_t act_put_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err);
+
+/**
+ * @brief Reserve `op->reserve->size` bytes for the key and let the writer fill them.
+ *
+ * The value is put with MDB_RESERVE on top of the DBI put flags, then
+ * `op->reserve->write` is called on the reserved bytes before returning.
+ * Not for DUPSORT DBIs.
+ *
+ * @param[in]  txn     Active RW LMDB transaction.
+ * @param[in]  op      Operation descriptor with a key and `op->reserve`.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put. A DUPSORT DBI fails with -EINVAL, a writer
+ *         error fails with the writer's code (-ECANCELED if not negative).
+ */
+db_security_ret_code_t act_put_reserve(MDB_txn* txn, op_t* op, int* const out_err);
+
+/**
+ * @brief Patch the value of an existing key in place.
+ *
+ * Positions `cur` on the key, rewrites the value at the same size with
+ * MDB_CURRENT | MDB_RESERVE and applies `op->patch` to the reserved bytes,
+ * which hold the old value. Not for DUPSORT DBIs.
+ *
+ * @param[in]  txn     Active RW LMDB transaction.
+ * @param[in]  op      Operation descriptor with a key and `op->patch`.
+ * @param[in,out] cur  Cursor slot for `op->dbi`, opened when NULL.
+ * @param[out] out_err Optional pointer to errno-style error code.
+ *
+ * @return Same as @ref act_put. A missing key fails with -ENOENT, a patch
+ *         past the end of the value with -ERANGE, a callback error with
+ *         its code (-ECANCELED if not negative).
+ */
+db_security_ret_code_t act_rep(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err);
+
 #ifdef __cplusplus
 }
 #endif
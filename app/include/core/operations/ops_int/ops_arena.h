@@ -0,0 +1,98 @@
+/**
+ * @file ops_arena.h
+ * @brief Chained-slab bump allocator for per-batch scratch memory.
+ */
+
+#ifndef DB_OPERATIONS_OPS_ARENA_H_
+#define DB_OPERATIONS_OPS_ARENA_H_
+
+#include <stddef.h> /* size_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC STRUCTURED TYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief One slab of an arena (private layout, see ops_arena.c).
+ */
+typedef struct ops_arena_slab ops_arena_slab_t;
+
+/**
+ * @brief Bump allocator made of a chain of slabs.
+ *
+ * Allocations are carved from the current slab; when it is exhausted the
+ * next slab in the chain is reused or a new one is linked in. Slabs are
+ * never freed by a reset: the arena only rewinds its offsets, so a batch
+ * that has reached its steady-state size no longer allocates.
+ *
+ * A zero-initialized arena is valid and empty.
+ */
+typedef struct
+{
+    ops_arena_slab_t* head;      /**< First slab of the chain. */
+    ops_arena_slab_t* cur;       /**< Slab currently allocated from. */
+    size_t            slab_size; /**< Minimum size of a new slab (0 = default). */
+    size_t            used;      /**< Bytes handed out since the last reset. */
+} ops_arena_t;
+
+/**
+ * @brief Position of an arena, see @ref ops_arena_mark.
+ */
+typedef struct
+{
+    ops_arena_slab_t* cur;  /**< Slab allocated from at the mark, NULL if none. */
+    size_t            off;  /**< Its offset at the mark. */
+    size_t            used; /**< Arena bytes at the mark. */
+} ops_arena_mark_t;
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Allocate @p size bytes from the arena.
+ *
+ * The returned memory is aligned for any scalar type and not zeroed.
+ * It stays valid until the next @ref ops_arena_reset or
+ * @ref ops_arena_release.
+ *
+ * @return Pointer to the bytes, NULL when @p size is 0 or on allocation
+ *         failure.
+ */
+void* ops_arena_alloc(ops_arena_t* arena, size_t size);
+
+/**
+ * @brief Rewind the arena to empty, keeping all slabs for reuse.
+ */
+void ops_arena_reset(ops_arena_t* arena);
+
+/**
+ * @brief Return the current position of the arena.
+ */
+ops_arena_mark_t ops_arena_mark(const ops_arena_t* arena);
+
+/**
+ * @brief Give back everything allocated since @p mark.
+ *
+ * Allocations made before the mark stay valid. The mark must come from the
+ * same arena with no reset in between.
+ */
+void ops_arena_rewind(ops_arena_t* arena, const ops_arena_mark_t* mark);
+
+/**
+ * @brief Free every slab and leave the arena zero-initialized.
+ */
+void ops_arena_release(ops_arena_t* arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_ARENA_H_ */
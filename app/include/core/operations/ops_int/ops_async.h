@@ -0,0 +1,81 @@
+/**
+ * @file ops_async.h
+ * @brief Async batch submission: read worker pool, completion callbacks or queue.
+ */
+
+#ifndef DB_OPERATIONS_OPS_ASYNC_H_
+#define DB_OPERATIONS_OPS_ASYNC_H_
+
+#include <stddef.h> /* size_t */
+
+#include "ops_exec.h"   /* batch_t */
+#include "ops_facade.h" /* db_async_cfg_t, db_async_cb_t, db_async_done_t, db_async_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Start the worker threads and allocate @p cfg->depth job slots.
+ *
+ * Read-only batches are executed by the workers, each keeping its own
+ * parked read txn. Write batches go to the group-commit writer when it
+ * runs, to the workers otherwise.
+ *
+ * @param cfg Tuning, NULL or zero fields select the config.h defaults.
+ * @return 0 on success, -EALREADY when running, -EINVAL without a database,
+ *         -ENOMEM, or the negative errno of eventfd / pthread_create.
+ */
+int ops_async_start(const db_async_cfg_t* cfg);
+
+/**
+ * @brief Queue @p batch and return at once.
+ *
+ * The batch belongs to the pool until it completes: with @p cb, which is
+ * called on a worker or writer thread and must return quickly; without,
+ * until its completion is taken by @ref ops_async_poll. A slot stays used
+ * until then, so un-polled completions count against the depth.
+ *
+ * @return 0 when queued, -EINVAL, -ENOTCONN when not started, -EAGAIN when
+ *         every slot is in use.
+ */
+int ops_async_submit(batch_t* batch, db_async_cb_t cb, void* ctx);
+
+/**
+ * @brief Take up to @p max completions of batches submitted without callback.
+ *
+ * Resets the eventfd once the queue is empty.
+ *
+ * @return Completions written to @p out, -EINVAL.
+ */
+int ops_async_poll(db_async_done_t* out, const size_t max);
+
+/**
+ * @brief Eventfd readable while completions wait, -1 without one.
+ */
+int ops_async_fd(void);
+
+/**
+ * @brief Wait for the batches in flight, then stop the workers.
+ *
+ * Completions not polled yet are dropped. No-op when not running; must
+ * not be called from a completion callback.
+ */
+void ops_async_stop(void);
+
+/**
+ * @brief Snapshot the counters (kept after stop until the next start).
+ */
+void ops_async_stats(db_async_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_ASYNC_H_ */
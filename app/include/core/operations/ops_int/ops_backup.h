@@ -0,0 +1,64 @@
+/**
+ * @file ops_backup.h
+ * @brief Online backup of the env to a file descriptor, and page usage stats.
+ */
+
+#ifndef DB_OPERATIONS_OPS_BACKUP_H_
+#define DB_OPERATIONS_OPS_BACKUP_H_
+
+#include "ops_facade.h" /* db_backup_cfg_t, db_backup_status_t, db_space_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Start copying the env to @p fd on a background thread.
+ *
+ * LMDB copies from one read txn, so the copy is the state of the last
+ * commit before the start while writers keep going. It streams through a
+ * pipe to a pump thread that writes @p fd, throttles and reports progress.
+ * The fd stays the caller's: keep it open until @ref ops_backup_wait.
+ *
+ * @return 0 when started, -EINVAL (bad fd or flags, no database),
+ *         -EALREADY while a backup runs, or the negative errno of pipe /
+ *         pthread_create.
+ */
+int ops_backup_start(const int fd, const db_backup_cfg_t* cfg);
+
+/**
+ * @brief Wait for the backup started last.
+ *
+ * @return Its result: 0, -ECANCELED when stopped, the negative errno of a
+ *         write to the fd or of the copy; -ENOENT when none was started.
+ */
+int ops_backup_wait(void);
+
+/**
+ * @brief Cancel the running backup and wait for it. No-op when none runs.
+ */
+void ops_backup_stop(void);
+
+/**
+ * @brief Snapshot the progress of the current or last backup.
+ */
+void ops_backup_status(db_backup_status_t* out);
+
+/**
+ * @brief Read the page usage of the env in a read txn.
+ *
+ * @return 0 on success, -EINVAL without a database, or a negative errno.
+ */
+int ops_backup_space(db_space_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_BACKUP_H_ */
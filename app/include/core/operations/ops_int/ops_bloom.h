@@ -0,0 +1,72 @@
+/**
+ * @file ops_bloom.h
+ * @brief Blocked Bloom filters of DBI_TYPE_BLOOM keys, persisted in sidecar files.
+ */
+
+#ifndef DB_OPERATIONS_OPS_BLOOM_H_
+#define DB_OPERATIONS_OPS_BLOOM_H_
+
+#include <stddef.h> /* size_t */
+
+#include "dbi_ext.h"    /* dbi_type_t */
+#include "ops_facade.h" /* db_bloom_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Build the filters of the DBI_TYPE_BLOOM DBIs of the open env.
+ *
+ * Each filter is loaded from `<dir>/<name>.bloom` when the file matches
+ * the env (last txn id and key count), otherwise sized from the key count
+ * and filled by a cursor scan. Call once the DBIs are open.
+ *
+ * @return 0 on success, -ENOMEM, or a negative errno of the scan.
+ */
+int ops_bloom_open(const char* dir, const char* const* names, const dbi_type_t* types,
+                   const unsigned n_dbis);
+
+/**
+ * @brief Write the filters to their sidecar files and free them.
+ *
+ * Call while the env is still open and no batch runs. Saturated filters
+ * are not written, the next open rebuilds them at the right size.
+ */
+void ops_bloom_close(void);
+
+/**
+ * @brief Add @p key to the filter of DBI @p dbi, before the txn writing it commits.
+ */
+void ops_bloom_add(const unsigned dbi, const void* key, const size_t key_size);
+
+/**
+ * @brief Zero when @p key is definitely not in DBI @p dbi.
+ *
+ * Non-zero when it may be, or when the DBI has no usable filter.
+ */
+int ops_bloom_maybe(const unsigned dbi, const void* key, const size_t key_size);
+
+/**
+ * @brief Count a key the filter let through and LMDB did not find.
+ */
+void ops_bloom_false_positive(const unsigned dbi);
+
+/**
+ * @brief Read the filter counters of DBI @p dbi.
+ *
+ * @return 0 on success, -ENOENT when the DBI has no filter.
+ */
+int ops_bloom_stats(const unsigned dbi, db_bloom_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_BLOOM_H_ */
@@ -0,0 +1,81 @@
+/**
+ * @file ops_bulk.h
+ * @brief Bulk loader: sorted PUT batches committed in bounded chunks.
+ */
+
+#ifndef DB_OPERATIONS_OPS_BULK_H_
+#define DB_OPERATIONS_OPS_BULK_H_
+
+#include <stddef.h> /* size_t */
+
+#include "ops_facade.h" /* db_bulk_cfg_t, db_bulk_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC STRUCTURED TYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Bulk loader (private layout, see ops_bulk.c).
+ *
+ * Records are copied into a loader-owned arena and queued on a private
+ * sorted batch; every time the pending chunk reaches the record or byte
+ * threshold it is executed as one write transaction. Sorting turns runs
+ * of monotonic keys into MDB_APPEND puts.
+ */
+typedef struct ops_bulk bulk_t;
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Allocate a bulk loader.
+ *
+ * @param cfg Thresholds, NULL or zero fields select the config.h defaults.
+ *
+ * @return Pointer to the loader, or NULL on allocation failure.
+ */
+bulk_t* ops_bulk_create(const db_bulk_cfg_t* cfg);
+
+/**
+ * @brief Copy one record into the pending chunk, flushing it when full.
+ *
+ * @return 0 on success, -EINVAL on bad input, -ENOMEM when the copy cannot
+ *         be stored, or the ops_bulk_flush error of an automatic flush.
+ */
+int ops_bulk_put(bulk_t* bulk, const unsigned dbi, const void* key, const size_t key_size,
+                 const void* val, const size_t val_size);
+
+/**
+ * @brief Commit the pending chunk, growing the map first if needed.
+ *
+ * Must be called with no transaction open on this thread: the map can only
+ * be resized while the environment has no active write transaction. A
+ * failed chunk is dropped; chunks committed before it stay committed.
+ *
+ * @return 0 on success (or nothing pending), negative errno otherwise.
+ */
+int ops_bulk_flush(bulk_t* bulk);
+
+/**
+ * @brief Snapshot the loader counters, computing the rates.
+ */
+void ops_bulk_stats(const bulk_t* bulk, db_bulk_stats_t* out);
+
+/**
+ * @brief Free the loader, dropping anything not yet flushed.
+ */
+void ops_bulk_destroy(bulk_t* bulk);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_BULK_H_ */
@@ -17,20 +17,214 @@ extern "C"
  * PUBLIC STRUCTURED TYPES
  ****************************************************************************
  */
-/* None */
+
+/**
+ * @brief Operations batch (private layout, see ops_exec.c).
+ *
+ * A batch owns its queued operations and its RW result cache. One batch
+ * must only be used by one thread at a time; distinct batches can be
+ * built and executed concurrently from different threads.
+ */
+typedef struct ops_batch batch_t;
 
 /****************************************************************************
  * PUBLIC FUNCTION PROTOTYPES
 ****************************************************************************
 */
 
-op_t* ops_get_next_op(void);
+/**
+ * @brief Allocate a new, empty operations batch.
+ *
+ * @return Pointer to the batch, or NULL on allocation failure.
+ */
+batch_t* ops_batch_create(void);
+
+/**
+ * @brief Free a batch created with @ref ops_batch_create.
+ *
+ * Passing NULL is a no-op. For the default batch only its ops pool is
+ * released (and queued ops are dropped).
+ */
+void ops_batch_destroy(batch_t* batch);
+
+/**
+ * @brief Return the process-wide default batch used by db_core_add_op /
+ *        db_core_exec_ops.
+ *
+ * The default batch is NOT thread-safe; concurrent callers must use their
+ * own batch handles.
+ */
+batch_t* ops_batch_default(void);
+
+/**
+ * @brief Set the maximum number of operations a single batch may hold.
+ *
+ * Batches grow their op array on demand up to this limit. The limit is
+ * process-wide and defaults to DB_LMDB_BATCH_OPS_MAX.
+ *
+ * @return 0 on success, -EINVAL when @p max_ops is 0.
+ */
+int ops_set_batch_max_ops(const size_t max_ops);
 
-int ops_add_operation(const op_t* operation);
+/**
+ * @brief Current per-batch operation limit.
+ */
+size_t ops_get_batch_max_ops(void);
+
+/**
+ * @brief Override the operation limit for @p batch only.
+ *
+ * Used by batches that are sized by their owner, e.g. the bulk loader.
+ *
+ * @param max_ops Limit for this batch, 0 to follow the process-wide one.
+ * @return 0 on success, -EINVAL when @p batch is NULL.
+ */
+int ops_batch_set_max_ops(batch_t* batch, const size_t max_ops);
+
+/**
+ * @brief Enable or disable key-sorted execution of the writes of @p batch.
+ *
+ * When enabled, every run of consecutive PUTs with PRESENT key and value
+ * (no LOOKUP on either side) is executed in (DBI, key, value) order
+ * instead of insertion order. Other ops stay in place and bound the runs.
+ * The sort is stable, so repeated keys keep their relative order. A run
+ * whose first key sorts past the last key of its DBI is written with
+ * MDB_APPEND / MDB_APPENDDUP through one cursor.
+ *
+ * The setting is kept until changed or until the batch is destroyed.
+ *
+ * @return 0 on success, -EINVAL when @p batch is NULL.
+ */
+int ops_batch_set_sorted(batch_t* batch, const int enable);
+
+/**
+ * @brief Set how many ops of a write batch run in one savepoint (child txn).
+ *
+ * A retryable error inside a segment aborts and replays only that segment.
+ * Batches not longer than one segment, and WRITEMAP envs, run flat.
+ *
+ * @param segment_ops Ops per segment, 0 for DB_LMDB_EXEC_SEGMENT_OPS.
+ * @return 0 on success, -EINVAL when @p batch is NULL.
+ */
+int ops_batch_set_segment_ops(batch_t* batch, const size_t segment_ops);
+
+/**
+ * @brief Copy the counters of the last execution of @p batch.
+ *
+ * Zeroed when @p batch is NULL.
+ */
+void ops_batch_exec_stats(const batch_t* batch, db_exec_stats_t* out_stats);
+
+/**
+ * @brief Return the next free op slot of @p batch, growing the pool if needed.
+ *
+ * @return Pointer to the slot, or NULL when the batch limit is reached or
+ *         the pool cannot grow.
+ */
+op_t* ops_get_next_op(batch_t* batch);
 
-int ops_execute_operations(void);
+int ops_add_operation(batch_t* batch, const op_t* operation);
 
-static db_security_ret_code_t _exec_ops(MDB_txn* txn, int* const out_err);
+int ops_execute_operations(batch_t* batch);
+
+/**
+ * @brief Execute a read-only batch and keep its snapshot open.
+ *
+ * Every queued op must be a GET. On success @p out_views[i] describes the
+ * value of the i-th op: the user buffer when one was given, otherwise the
+ * bytes inside the memory map (no copy). Views stay valid until
+ * @ref ops_release_leased; meanwhile the batch rejects execution with
+ * -EBUSY. The batch is emptied in every case.
+ *
+ * @param batch     Batch to execute.
+ * @param out_views Output array with at least one entry per queued op.
+ * @param n_views   Number of entries in @p out_views.
+ * @return 0 on success; -EINVAL on bad input or a batch with writes;
+ *         -EBUSY when a lease is already held; otherwise as
+ *         @ref ops_execute_operations.
+ */
+int ops_execute_leased(batch_t* batch, db_view_t* out_views, const size_t n_views);
+
+/**
+ * @brief End the read lease of @p batch, invalidating its views.
+ *
+ * No-op when the batch holds no lease.
+ */
+void ops_release_leased(batch_t* batch);
+
+/**
+ * @brief Non-zero when @p batch holds at least one write op.
+ */
+int ops_batch_has_writes(const batch_t* batch);
+
+/**
+ * @brief Announce the writes of @p batch to the value cache, before its txn.
+ *
+ * Done by the batch executors; the group writer, which commits for them,
+ * calls it itself, paired with ops_batch_cache_end().
+ */
+void ops_batch_cache_begin(const batch_t* batch);
+
+/**
+ * @brief Drop the cached values the writes of @p batch touched, after the
+ *        commit (or the failure) of their txn.
+ */
+void ops_batch_cache_end(const batch_t* batch);
+
+/**
+ * @brief Execute @p batch in a child txn of @p parent (group commit).
+ *
+ * The ops run in their usual order (sorted plan included) inside a nested
+ * write txn, which is committed into @p parent on success and aborted on
+ * failure, leaving @p parent usable either way. Nothing is durable until
+ * @p parent commits. The batch is NOT reset: it can be executed again if
+ * @p parent is aborted, and must be released with @ref ops_batch_clear.
+ *
+ * @param batch   Batch to execute (non-empty, no lease held).
+ * @param parent  Active RW LMDB transaction.
+ * @param out_err Optional pointer to errno-style error code.
+ * @return DB_SAFETY_SUCCESS, DB_SAFETY_RETRY when the whole txn should be
+ *         redone (MAP_RESIZED, TXN_FULL...), DB_SAFETY_FAIL otherwise.
+ */
+db_security_ret_code_t ops_execute_nested(batch_t* batch, MDB_txn* parent, int* const out_err);
+
+/**
+ * @brief Empty @p batch after @ref ops_execute_nested, keeping its pools.
+ */
+void ops_batch_clear(batch_t* batch);
+
+/**
+ * @brief Freeze the queued ops of @p batch into a reusable plan.
+ *
+ * DBI indices and lookup references are checked once, and every lookup
+ * chain is rewritten to point straight at the descriptor that ends it.
+ * From then on each execution re-arms the same ops with one copy instead
+ * of emptying the batch; callers only change the PRESENT keys and vals
+ * with @ref ops_batch_bind between runs. New ops are refused with -EBUSY
+ * until @ref ops_batch_unprepare.
+ *
+ * @return 0 on success, -EINVAL on an empty batch or a bad reference,
+ *         -EBUSY when leased or already prepared, -ENOMEM.
+ */
+int ops_batch_prepare(batch_t* batch);
+
+/**
+ * @brief Rebind the key and/or val of op @p op_idx of a prepared batch.
+ *
+ * NULL leaves that side as it is. Only PRESENT descriptors can be rebound
+ * (and an empty GET val, which becomes a user buffer); lookups, scans and
+ * multi / reserve / patch vals are refused. Bindings persist across runs.
+ *
+ * @return 0 on success, -EINVAL on bad input or a key / dup size an integer
+ *         DBI refuses (the old binding is kept), -EBUSY while leased.
+ */
+int ops_batch_bind(batch_t* batch, const size_t op_idx, const void* key, const size_t key_size,
+                   const void* val, const size_t val_size);
+
+/**
+ * @brief Drop the plan of @p batch and empty it.
+ */
+void ops_batch_unprepare(batch_t* batch);
 
 #ifdef __cplusplus
 }
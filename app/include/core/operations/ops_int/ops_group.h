@@ -0,0 +1,82 @@
+/**
+ * @file ops_group.h
+ * @brief Group-commit writer: write batches of many threads in one txn.
+ */
+
+#ifndef DB_OPERATIONS_OPS_GROUP_H_
+#define DB_OPERATIONS_OPS_GROUP_H_
+
+#include "ops_exec.h"   /* batch_t */
+#include "ops_facade.h" /* db_group_cfg_t, db_group_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Completion of an async request, called on the writer thread.
+ */
+typedef void (*ops_group_done_fn)(batch_t* batch, int res, void* ctx);
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Start the writer thread.
+ *
+ * Producers hand their write batches to @ref ops_group_submit, which pushes
+ * them on a lock-free list. The writer takes everything pending at once,
+ * runs up to @p cfg->max_batches of them in child txns of one write txn and
+ * commits it once. A failing batch only aborts its own child txn.
+ *
+ * @param cfg Tuning, NULL or zero fields select the config.h defaults.
+ * @return 0 on success, -EALREADY when running, -EINVAL without a database,
+ *         -ENOTSUP on an MDB_WRITEMAP env (no child txns), or the negative
+ *         pthread_create error.
+ */
+int ops_group_start(const db_group_cfg_t* cfg);
+
+/**
+ * @brief Execute @p batch through the writer and wait for its own result.
+ *
+ * Read-only batches, and every batch while the writer is not running, are
+ * executed by the calling thread with @ref ops_execute_operations. The
+ * batch is emptied in every case, as after @ref ops_execute_operations.
+ *
+ * @return 0 on success, negative errno of this batch otherwise.
+ */
+int ops_group_submit(batch_t* batch);
+
+/**
+ * @brief Queue write batch @p batch to the writer without waiting.
+ *
+ * @p on_done gets the result of this batch on the writer thread once its
+ * group has committed, and must return quickly: the next group waits.
+ * The batch is emptied before the call. Stop waits for these requests too.
+ *
+ * @return 0 when queued, -EINVAL, -ENOTCONN when the writer is not
+ *         running (the caller executes the batch itself), -ENOMEM.
+ */
+int ops_group_submit_async(batch_t* batch, ops_group_done_fn on_done, void* ctx);
+
+/**
+ * @brief Stop the writer once the batches already submitted are done.
+ *
+ * No-op when the writer is not running. Must not be called from a
+ * producer that is waiting in @ref ops_group_submit.
+ */
+void ops_group_stop(void);
+
+/**
+ * @brief Snapshot the writer counters (kept after stop until the next start).
+ */
+void ops_group_stats(db_group_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_GROUP_H_ */
@@ -0,0 +1,89 @@
+/**
+ * @file ops_index.h
+ * @brief Secondary indexes written in the txn of the record they mirror.
+ */
+
+#ifndef DB_OPERATIONS_OPS_INDEX_H_
+#define DB_OPERATIONS_OPS_INDEX_H_
+
+#include <stddef.h> /* size_t */
+
+#include "config.h"        /* DB_LMDB_INDEX_* */
+#include "ops_facade.h"    /* db_index_t */
+#include "ops_internals.h" /* MDB_txn, MDB_val, db_security_ret_code_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC STRUCTURED TYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Index keys of a record before a write, one per index of its DBI.
+ */
+typedef struct
+{
+    size_t        n;                                                    /**< Indexes. */
+    size_t        size[DB_LMDB_INDEX_PER_DBI];                          /**< Key sizes. */
+    int           has[DB_LMDB_INDEX_PER_DBI];                           /**< Key present. */
+    unsigned char key[DB_LMDB_INDEX_PER_DBI][DB_LMDB_INDEX_KEY_MAX]; /**< Key bytes. */
+} ops_index_keys_t;
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Register a secondary index.
+ *
+ * Not thread safe against running batches: call it between them, usually
+ * right after db_core_init. Existing records are not indexed.
+ *
+ * @return 0 on success, -EINVAL (unknown, equal or DUPSORT source DBI, a
+ *         DBI both source and index, no callback), -EEXIST, -ENOSPC.
+ */
+int ops_index_add(const db_index_t* index);
+
+/**
+ * @brief Drop every index (shutdown).
+ */
+void ops_index_reset(void);
+
+/**
+ * @brief Index DBIs fed by DBI @p dbi, one bit per DBI index, 0 when none.
+ */
+unsigned ops_index_targets(const unsigned dbi);
+
+/**
+ * @brief Read the record @p key of DBI @p dbi and derive its index keys.
+ *
+ * Call right before a write to it. An absent record has no index key.
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_index_before(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                        ops_index_keys_t* old, int* const out_err);
+
+/**
+ * @brief Move the index entries of @p key from @p old to its new index keys.
+ *
+ * Call right after the write. @p val is the value written, NULL to read
+ * the record back (reserved puts, patches, deletes).
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted: -EEXIST
+ *         when a unique index already maps the key to another record.
+ */
+db_security_ret_code_t ops_index_after(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                       const MDB_val* val, const ops_index_keys_t* old,
+                                       int* const out_err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_INDEX_H_ */
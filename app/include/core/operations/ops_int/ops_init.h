@@ -19,7 +19,8 @@
 #define DB_OPERATIONS_OPS_SETUP_H_
 
 #include "db.h"
-#include "security.h" /* expose security policy and helpers */
+#include "ops_facade.h" /* db_env_cfg_t, db_env_profile_t */
+#include "security.h"   /* expose security policy and helpers */
 
 /****************************************************************************
  * PUBLIC FUNCTIONS PROTOTYPES
@@ -34,7 +35,8 @@
  * configure the LMDB environment used by the database subsystem. Typical
  * actions include creating the directory, opening the LMDB environment via
  * `mdb_env_create`/`mdb_env_open`, setting map size, max DBs and reader
- * parameters according to compiled configuration and runtime input.
+ * parameters, and the open flags derived from the profile and options of
+ * @p cfg.
  *
  * On failure the function will return `DB_SAFETY_RETRY` for transient
  * or retryable conditions (for example when `security_check` indicates the
@@ -42,7 +44,9 @@
  * When `out_err` is provided it will contain a negative POSIX-style errno
  * or LMDB return code mapped by the security layer.
  *
- * @param[in]  max_dbis  Maximum number of named sub-databases to support.
+ * @param[in]  cfg       Resolved environment setup (see @ref ops_env_profile);
+ *                       only map_size_init, max_readers, max_dbis and opts
+ *                       are used here.
  * @param[in]  path      Filesystem path to the database directory.
  * @param[in]  mode      Filesystem mode (owner/group/other bits) used when
  *                       creating directories or files.
@@ -53,7 +57,7 @@
  *         caller may retry the operation, or `DB_SAFETY_FAIL` on a
  *         non-recoverable error.
  */
-db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* const path,
+db_security_ret_code_t ops_init_env(const db_env_cfg_t* const cfg, const char* const path,
                                     const unsigned int mode, int* const out_err);
 
 /**
@@ -75,4 +79,88 @@ db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* con
 db_security_ret_code_t ops_init_dbi(MDB_txn* const txn, const char* const name,
                                     unsigned int dbi_idx, dbi_type_t dbi_type, int* const out_err);
 
+/**
+ * @brief Derive the put flags and the dup / integer bits of DBI @p dbi_idx
+ *        from @p dbi_type and its cached db_flags.
+ *
+ * Called by @ref ops_init_dbi; the warm start calls it once db_flags is
+ * taken from the schema record.
+ */
+void ops_init_dbi_derive(const unsigned int dbi_idx, const dbi_type_t dbi_type);
+
+/**
+ * @brief Install the key and dup order of an opened DBI.
+ *
+ * Call in the txn that opened it, before any data access. Both
+ * comparators stay in effect until the env is closed.
+ *
+ * @param[in]  txn     Txn that opened the DBI.
+ * @param[in]  dbi_idx DBI index, below DB_MAX_DBIS.
+ * @param[in]  key_cmp Key order, NULL to keep the default one.
+ * @param[in]  dup_cmp Dup order of a DUPSORT DBI, NULL to keep the default one.
+ * @param[out] out_err -EINVAL for an integer DBI, a non DUPSORT one with
+ *                     @p dup_cmp or an index out of range; NULL to ignore.
+ * @return DB_SAFETY_SUCCESS, else a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_init_dbi_order(MDB_txn* const txn, const unsigned int dbi_idx,
+                                          const db_cmp_fn_t key_cmp, const db_cmp_fn_t dup_cmp,
+                                          int* const out_err);
+
+/**
+ * @brief Fill @p out with the full setup of @p profile.
+ *
+ * Every field is set, from the profile and the config.h defaults.
+ *
+ * @return 0 on success, -EINVAL for a NULL @p out or an unknown profile.
+ */
+int ops_env_profile(const db_env_profile_t profile, db_env_cfg_t* const out);
+
+/**
+ * @brief Resolve a caller setup: profile values for its zero fields, and
+ *        the profile options OR'ed with its own.
+ *
+ * @param[in]  cfg Caller setup, NULL for the durable profile.
+ * @param[out] out Resolved setup.
+ * @return 0 on success, -EINVAL for an unknown profile, or when the initial
+ *         map size exceeds the maximum.
+ */
+int ops_env_cfg_resolve(const db_env_cfg_t* const cfg, db_env_cfg_t* const out);
+
+/**
+ * @brief Ensure that the LMDB directory @p path exists with restrictive permissions.
+ *
+ * The directory is created when missing with owner-only permissions
+ * (0700). When it already exists, the function verifies that it is a
+ * directory and that no group/other bits are set; it does not relax
+ * permissions if they are tighter.
+ *
+ * @return 0 on success, negative errno-style value on failure.
+ */
+int ops_init_env_dir(const char* const path);
+
+/**
+ * @brief Map db_env_opt_t bits to MDB_* open flags.
+ */
+unsigned int ops_env_flags(const unsigned opts);
+
+/**
+ * @brief Start the background syncer: `mdb_env_sync(force)` every
+ *        @p period_ms.
+ *
+ * Only meaningful for environments opened with MDB_NOSYNC or
+ * MDB_NOMETASYNC, where commits no longer reach the disk on their own.
+ *
+ * @return 0 on success, -EALREADY when running, -EINVAL for a zero period
+ *         or no environment, or the negative pthread error.
+ */
+int ops_env_sync_start(const unsigned period_ms);
+
+/**
+ * @brief Stop the background syncer and sync one last time.
+ *
+ * No-op when it is not running. Must be called before the environment is
+ * closed.
+ */
+void ops_env_sync_stop(void);
+
 #endif /* DB_OPERATIONS_OPS_SETUP_H_ */
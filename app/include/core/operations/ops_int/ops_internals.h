@@ -6,6 +6,7 @@
 #define DB_OPERATIONS_OPS_INTERNALS_H_
 
 #include <stddef.h>   /* size_t */
+#include <stdint.h>   /* uint64_t */
 #include "db.h"       /* MDB_txn etc */
 #include "ops_facade.h"
 #include "security.h" /* db_security_ret_code_t */
@@ -90,12 +91,37 @@ typedef struct
 
 } op_key_t;
 
+/**
+ * @brief Modifiers of an operation, OR-ed into op_t.flags.
+ */
+typedef enum
+{
+    OP_FLAG_NONE      = 0,      /**< Plain operation. */
+    OP_FLAG_RANGE     = 1 << 0, /**< DEL: key is the inclusive start, val the exclusive
+                                     end; NONE on either side leaves it open. */
+    OP_FLAG_APPEND    = 1 << 1, /**< PUT: key sorts after the last key (sorted batches). */
+    OP_FLAG_APPENDDUP = 1 << 2, /**< PUT: same key as the previous PUT, value sorts
+                                     after its last duplicate (sorted batches). */
+    OP_FLAG_MULTIPLE  = 1 << 3, /**< GET/PUT: all dups of the key as one packed array
+                                     (DUPFIXED DBIs), see op_t.multi. */
+    OP_FLAG_RESERVE   = 1 << 4, /**< PUT: value serialized in place by a writer
+                                     (MDB_RESERVE), see op_t.reserve. */
+    OP_FLAG_TTL       = 1 << 5  /**< PUT: key expires op_t.ttl_ms after the exec. */
+} op_flag_t;
+
 typedef struct
 {
-    unsigned int dbi;  /**< Target DBI handle. */
-    op_type_t    type; /**< Operation type. */
-    op_key_t     key;  /**< Key descriptor. */
-    op_key_t     val;  /**< Value descriptor. */
+    unsigned int  dbi;     /**< Target DBI handle. */
+    op_type_t     type;    /**< Operation type. */
+    op_key_t      key;     /**< Key descriptor. */
+    op_key_t      val;     /**< Value descriptor. */
+    unsigned int  flags;   /**< OR of op_flag_t. */
+    db_scan_t*    scan;    /**< LST: scan request (caller-owned), NULL otherwise. */
+    db_multi_t*   multi;   /**< OP_FLAG_MULTIPLE: packed dups (caller-owned), NULL otherwise. */
+    db_reserve_t* reserve; /**< OP_FLAG_RESERVE: size and writer (caller-owned), NULL
+                                otherwise. */
+    db_patch_t*   patch;   /**< REP: patch request (caller-owned), NULL otherwise. */
+    uint64_t      ttl_ms;  /**< OP_FLAG_TTL: lifetime from the exec of the op. */
 } op_t;
 
 /****************************************************************************
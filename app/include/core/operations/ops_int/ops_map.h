@@ -0,0 +1,106 @@
+/**
+ * @file ops_map.h
+ * @brief Map size policy: proactive growth and the resize gate.
+ */
+
+#ifndef DB_OPERATIONS_OPS_MAP_H_
+#define DB_OPERATIONS_OPS_MAP_H_
+
+#include <stddef.h> /* size_t */
+
+#include "ops_facade.h" /* db_map_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Set the growth step of the open environment and reset the counters.
+ *
+ * @param step Bytes added per growth, 0 for DB_MAP_GROW_STEP.
+ */
+void ops_map_configure(const size_t step);
+
+/**
+ * @brief Enter the resize gate (shared): no resize while any thread is in.
+ *
+ * Every txn of the environment lives inside the gate, from its begin to
+ * its commit or abort. Re-entrant per thread. A resize waiting for the
+ * gate holds off the threads not yet inside.
+ */
+void ops_map_enter(void);
+
+/**
+ * @brief Leave the resize gate.
+ */
+void ops_map_leave(void);
+
+/**
+ * @brief Whether the calling thread is inside the gate, e.g. holding a lease.
+ *
+ * Such a thread cannot grow the map, so it must not start a write txn.
+ */
+int ops_map_held(void);
+
+/**
+ * @brief Enter the gate for a hold of unbounded length (a backup copy).
+ *
+ * Until @ref ops_map_leave_long growths only try the gate once: waiting
+ * for the hold would stall every new txn for the whole wait.
+ */
+void ops_map_enter_long(void);
+
+/**
+ * @brief Leave the gate after @ref ops_map_enter_long.
+ */
+void ops_map_leave_long(void);
+
+/**
+ * @brief Proactive check after a write commit, outside the gate.
+ *
+ * When less than one step of the map is left free the map grows by one
+ * step, if no thread is inside the gate right now; otherwise the growth
+ * is deferred to the next commit. Once less than half a step is left it
+ * waits for the gate like @ref ops_map_on_full instead.
+ */
+void ops_map_after_commit(void);
+
+/**
+ * @brief Grow after MDB_MAP_FULL, outside the gate.
+ *
+ * Adds `step << attempt` bytes, capped at DataBase->map_size_bytes_max,
+ * waiting up to DB_LMDB_MAP_GROW_WAIT_MS for the threads in the gate.
+ *
+ * @param attempt Consecutive MAP_FULL retries of the caller, from 0.
+ * @return 0 on success, -ENOSPC at the ceiling, -EBUSY when the gate did
+ *         not empty in time, or a negative errno from LMDB.
+ */
+int ops_map_on_full(const unsigned attempt);
+
+/**
+ * @brief Grow the map to at least @p size bytes, outside the gate.
+ *
+ * Waits like @ref ops_map_on_full. No-op when the map is already large
+ * enough.
+ *
+ * @return 0 on success, -ENOSPC when @p size exceeds the ceiling, -EBUSY
+ *         on timeout, or a negative errno from LMDB.
+ */
+int ops_map_reserve(const size_t size);
+
+/**
+ * @brief Snapshot the map size, pages in use and the growth counters.
+ */
+void ops_map_stats(db_map_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_MAP_H_ */
@@ -0,0 +1,112 @@
+/**
+ * @file ops_shard.h
+ * @brief Sets of environments with keys routed by hash, one writer per shard.
+ */
+
+#ifndef DB_OPERATIONS_OPS_SHARD_H_
+#define DB_OPERATIONS_OPS_SHARD_H_
+
+#include <stddef.h> /* size_t */
+
+#include "config.h"      /* DB_LMDB_SHARDS_MAX */
+#include "ops_facade.h"  /* db_shards_cfg_t, db_shards_stats_t, op_type_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC STRUCTURED TYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Set of shard envs; safe to execute batches on from many threads.
+ */
+typedef struct ops_shards shards_t;
+
+/**
+ * @brief Ops queued for @ref ops_shards_exec, one thread at a time.
+ */
+typedef struct ops_shard_batch shard_batch_t;
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Open one env per path of @p cfg and start one writer thread per env.
+ *
+ * The envs do not depend on db_core_init(): several handles, and the
+ * global database, can be open at once.
+ *
+ * @return 0 on success, -EINVAL (bad setup), -ENOTSUP (WRITEMAP, custom
+ *         orders, BLOOM or ZIP DBIs), -ENOMEM, or a negative errno of the
+ *         env open.
+ */
+int ops_shards_open(shards_t** out, const db_shards_cfg_t* cfg);
+
+/**
+ * @brief Stop the writers after the batches queued and close every env.
+ *
+ * NULL is a no-op. No batch may be executing on the handle.
+ */
+void ops_shards_close(shards_t* shards);
+
+/**
+ * @brief Shard of @p key, the same for every DBI.
+ *
+ * @return The shard index, -EINVAL.
+ */
+int ops_shards_of(const shards_t* shards, const void* key, const size_t key_size);
+
+/**
+ * @brief Allocate an empty batch, usable with any handle.
+ *
+ * @return The batch, NULL on allocation failure.
+ */
+shard_batch_t* ops_shard_batch_create(void);
+
+/**
+ * @brief Free @p batch (NULL is a no-op).
+ */
+void ops_shard_batch_destroy(shard_batch_t* batch);
+
+/**
+ * @brief Queue a PUT, GET or DEL.
+ *
+ * Keys and PUT values are copied. GET copies the value into @p val, of
+ * @p val_size bytes. DEL with a value removes that dup only.
+ *
+ * @return 0 on success, -EINVAL, -ENOMEM.
+ */
+int ops_shard_batch_add(shard_batch_t* batch, const unsigned dbi, const op_type_t type,
+                        const void* key, const size_t key_size, const void* val,
+                        const size_t val_size);
+
+/**
+ * @brief Execute @p batch and empty it.
+ *
+ * Ops are routed to the shard of their key. A batch on one shard runs in
+ * one txn of that shard. Over several shards it is refused with @p atomic,
+ * otherwise each shard runs its part in its own txn, in parallel: parts
+ * may commit while others fail. Reads run on the calling thread, writes on
+ * the shard writers, which commit the parts of many callers at once.
+ *
+ * @return 0 on success, -EXDEV (atomic over several shards), or the first
+ *         negative errno in shard order.
+ */
+int ops_shards_exec(shards_t* shards, shard_batch_t* batch, const int atomic);
+
+/**
+ * @brief Snapshot the counters of @p shards.
+ */
+void ops_shards_stats(const shards_t* shards, db_shards_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_SHARD_H_ */
@@ -0,0 +1,99 @@
+/**
+ * @file ops_stats.h
+ * @brief Runtime metrics: per-thread counters and log2 latency histograms.
+ */
+
+#ifndef DB_OPERATIONS_OPS_STATS_H_
+#define DB_OPERATIONS_OPS_STATS_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "config.h"     /* DB_LMDB_METRICS */
+#include "ops_facade.h" /* db_stats_t, db_stats_lat_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+/**
+ * @brief Monotonic clock in ns, the start of a latency sample.
+ */
+uint64_t ops_stats_now(void);
+
+/**
+ * @brief Record a latency sample of @p which started at @p t0.
+ */
+void ops_stats_lat(const db_stats_lat_t which, const uint64_t t0);
+
+/**
+ * @brief Record the op count of a batch about to execute.
+ */
+void ops_stats_batch(const size_t n_ops);
+
+/**
+ * @brief Count a txn begun, read (@p ro non-zero) or write.
+ */
+void ops_stats_txn(const int ro);
+
+/**
+ * @brief Count a retry asked for LMDB code @p mdb_rc (see db_stats_retry_t).
+ */
+void ops_stats_retry(const int mdb_rc);
+
+/**
+ * @brief Count @p bytes of GET results copied into a write batch cache.
+ */
+void ops_stats_rw_cache(const size_t bytes);
+
+#else /* !DB_LMDB_METRICS: every hook compiles to nothing */
+
+static inline uint64_t ops_stats_now(void)
+{
+    return 0;
+}
+static inline void ops_stats_lat(const db_stats_lat_t which, const uint64_t t0)
+{
+    (void)which;
+    (void)t0;
+}
+static inline void ops_stats_batch(const size_t n_ops)
+{
+    (void)n_ops;
+}
+static inline void ops_stats_txn(const int ro)
+{
+    (void)ro;
+}
+static inline void ops_stats_retry(const int mdb_rc)
+{
+    (void)mdb_rc;
+}
+static inline void ops_stats_rw_cache(const size_t bytes)
+{
+    (void)bytes;
+}
+
+#endif /* DB_LMDB_METRICS */
+
+/**
+ * @brief Sum the counters of every thread into @p out (out->map left zero).
+ *
+ * Lock-free: each thread only writes its own slot, so a snapshot taken
+ * while threads run may miss their last few samples.
+ */
+void ops_stats_snapshot(db_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_STATS_H_ */
@@ -0,0 +1,114 @@
+/**
+ * @file ops_trace.h
+ * @brief Batch trace hooks: a user callback and USDT probes per phase.
+ *
+ * Probes (provider db_lmdb), all with the batch pointer first:
+ *   batch_start(batch, rw, n_ops)
+ *   txn_begun(batch, attempt)
+ *   ops_done(batch, attempt)
+ *   batch_end(batch, rw, result, retries, dirty_pages)
+ * A tracer takes its own timestamps at each probe; dirty_pages is only
+ * measured while a callback is set or a probe is attached.
+ */
+
+#ifndef DB_OPERATIONS_OPS_TRACE_H_
+#define DB_OPERATIONS_OPS_TRACE_H_
+
+#include <stdatomic.h> /* atomic_load_explicit */
+#include <stdint.h>    /* uint64_t */
+#include <time.h>      /* clock_gettime */
+
+#include "config.h"     /* DB_LMDB_USDT */
+#include "ops_facade.h" /* db_trace_t, db_trace_cb_t */
+
+#if DB_LMDB_USDT
+/* Probes carry a semaphore the tracer raises while attached */
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC DEFINES
+ ****************************************************************************
+ */
+
+#if DB_LMDB_USDT
+#define OPS_TRACE_PROBE(name, ...) STAP_PROBEV(db_lmdb, name, __VA_ARGS__)
+#define OPS_TRACE_ATTACHED()                                                               \
+    (db_lmdb_batch_start_semaphore | db_lmdb_txn_begun_semaphore |                         \
+     db_lmdb_ops_done_semaphore | db_lmdb_batch_end_semaphore)
+#else
+#define OPS_TRACE_PROBE(name, ...) ((void)0)
+#define OPS_TRACE_ATTACHED()       0
+#endif
+
+/****************************************************************************
+ * PUBLIC VARIABLES
+ ****************************************************************************
+ */
+
+/* Set callback, NULL when tracing is off (read on every batch) */
+extern _Atomic(db_trace_cb_t) ops_trace_cb;
+
+#if DB_LMDB_USDT
+extern volatile unsigned short db_lmdb_batch_start_semaphore;
+extern volatile unsigned short db_lmdb_txn_begun_semaphore;
+extern volatile unsigned short db_lmdb_ops_done_semaphore;
+extern volatile unsigned short db_lmdb_batch_end_semaphore;
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Install @p cb (NULL to stop tracing), called with @p ctx.
+ *
+ * Not synchronized with running batches: a batch in flight may still
+ * call the previous callback once.
+ */
+void ops_trace_set(db_trace_cb_t cb, void* ctx);
+
+/**
+ * @brief Hand @p trace to the callback, if one is still set.
+ */
+void ops_trace_emit(const db_trace_t* trace);
+
+/**
+ * @brief Non-zero when a batch should collect its phase timings.
+ */
+static inline int ops_trace_on(void)
+{
+    return atomic_load_explicit(&ops_trace_cb, memory_order_relaxed) != NULL ||
+           OPS_TRACE_ATTACHED();
+}
+
+/**
+ * @brief Monotonic clock in ns.
+ */
+static inline uint64_t ops_trace_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Store the time in @p at when @p on, nothing otherwise.
+ */
+static inline void ops_trace_mark(const int on, uint64_t* at)
+{
+    if(on) *at = ops_trace_now();
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_TRACE_H_ */
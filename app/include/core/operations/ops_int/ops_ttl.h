@@ -0,0 +1,119 @@
+/**
+ * @file ops_ttl.h
+ * @brief Expiring keys: an expiry queue DBI written with the record and a sweeper thread.
+ */
+
+#ifndef DB_OPERATIONS_OPS_TTL_H_
+#define DB_OPERATIONS_OPS_TTL_H_
+
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "config.h"        /* DB_LMDB_TTL_* */
+#include "ops_facade.h"    /* db_ttl_cfg_t, db_ttl_stats_t */
+#include "ops_internals.h" /* MDB_txn, MDB_val, db_security_ret_code_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Take @p cfg->queue_dbi as the expiry queue and start the sweeper.
+ *
+ * @return 0 on success, -EINVAL (unknown or DUPSORT queue DBI), -EALREADY,
+ *         -ENOMEM, or the pthread_create error.
+ */
+int ops_ttl_start(const db_ttl_cfg_t* cfg);
+
+/**
+ * @brief Stop the sweeper and forget the queue (shutdown). No-op when not started.
+ */
+void ops_ttl_stop(void);
+
+/**
+ * @brief DBI index of the expiry queue, -1 when TTL keys are off.
+ */
+int ops_ttl_queue(void);
+
+/**
+ * @brief Milliseconds since the epoch, the clock of the deadlines.
+ */
+uint64_t ops_ttl_now_ms(void);
+
+/**
+ * @brief Move the deadline of @p key of DBI @p dbi to @p expires.
+ *
+ * Call in the write txn of the PUT, right after it: the old queue entry
+ * of the key is dropped, so only the last deadline counts.
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_ttl_arm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                   const uint64_t expires, int* const out_err);
+
+/**
+ * @brief Whether writes to DBI @p dbi may have a deadline to drop.
+ *
+ * Not for the queue itself, and 0 when TTL keys are off.
+ */
+int ops_ttl_armed(const unsigned dbi);
+
+/**
+ * @brief Drop the deadline of @p key of DBI @p dbi, if it has one.
+ *
+ * Call in the write txn of a DEL or a plain PUT of the key: the deadline
+ * belongs to the TTL put that wrote it, not to the next record.
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_ttl_disarm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                      int* const out_err);
+
+/**
+ * @brief Same as @ref ops_ttl_disarm after a DEL of @p key.
+ *
+ * On a DUPSORT DBI the DEL may have removed one dup only: the deadline
+ * stays while the key has dups left.
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_ttl_disarm_del(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                          int* const out_err);
+
+/**
+ * @brief Drop the deadlines of the keys of DBI @p dbi in [@p start, @p end).
+ *
+ * Same as @ref ops_ttl_disarm for a range DEL. A NULL bound is open.
+ *
+ * @return DB_SAFETY_SUCCESS, or a failure with @p txn aborted.
+ */
+db_security_ret_code_t ops_ttl_disarm_range(MDB_txn* txn, const unsigned dbi,
+                                            const MDB_val* start, const MDB_val* end,
+                                            int* const out_err);
+
+/**
+ * @brief Delete up to @p max records whose deadline is at or before @p now.
+ *
+ * Runs write txns of at most the configured batch, oldest deadlines
+ * first. Serialized with the sweeper thread.
+ *
+ * @return Records deleted, -ENOTCONN when TTL keys are off, or a negative errno.
+ */
+long ops_ttl_sweep(const uint64_t now, const size_t max);
+
+/**
+ * @brief Snapshot the sweeper counters.
+ */
+void ops_ttl_stats(db_ttl_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_TTL_H_ */
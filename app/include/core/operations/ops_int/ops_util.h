@@ -0,0 +1,71 @@
+/**
+ * @file ops_util.h
+ * @brief Small helpers shared by the ops modules: LMDB errno and key hashing.
+ */
+
+#ifndef DB_OPERATIONS_OPS_UTIL_H_
+#define DB_OPERATIONS_OPS_UTIL_H_
+
+#include <errno.h>  /* EIO */
+#include <stddef.h> /* size_t */
+#include <stdint.h> /* uint64_t */
+
+#include "security.h" /* security_check */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Negative errno of LMDB code @p mdb_rc, outside of any txn.
+ *
+ * @return The security_check() mapping, -EIO when it has none.
+ */
+static inline int ops_errno(const int mdb_rc)
+{
+    int err = -EIO;
+    (void)security_check(mdb_rc, NULL, &err);
+    return err;
+}
+
+/**
+ * @brief 64-bit FNV-1a of @p size bytes at @p data.
+ */
+static inline uint64_t ops_fnv1a(const void* data, const size_t size)
+{
+    const unsigned char* p = data;
+    uint64_t             h = 14695981039346656037ull;
+    for(size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/**
+ * @brief FNV-1a with a final mix, so that the high bits depend on every byte.
+ *
+ * Stable across runs and builds: Bloom filter files and shard routing
+ * depend on it.
+ */
+static inline uint64_t ops_hash(const void* data, const size_t size)
+{
+    uint64_t h = ops_fnv1a(data, size);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_UTIL_H_ */
@@ -0,0 +1,100 @@
+/**
+ * @file ops_vcache.h
+ * @brief Per-DBI value cache: sharded CLOCK, sized in bytes, invalidated on commit.
+ */
+
+#ifndef DB_OPERATIONS_OPS_VCACHE_H_
+#define DB_OPERATIONS_OPS_VCACHE_H_
+
+#include <stddef.h> /* size_t */
+
+#include "ops_facade.h" /* db_cache_cfg_t, db_cache_stats_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Cache the values of DBI @p dbi, replacing its cache if any.
+ *
+ * Not thread safe against running batches: call it between them.
+ *
+ * @param cfg Tuning (NULL or zero fields for the defaults).
+ * @return 0 on success, -EINVAL for an unknown or DUPSORT DBI, -ENOMEM.
+ */
+int ops_vcache_enable(const unsigned dbi, const db_cache_cfg_t* cfg);
+
+/**
+ * @brief Drop the cache of DBI @p dbi, no-op when it has none.
+ */
+void ops_vcache_disable(const unsigned dbi);
+
+/**
+ * @brief Drop every cache (shutdown).
+ */
+void ops_vcache_reset(void);
+
+/**
+ * @brief Open the read window of the calling thread, before its RO txn begins.
+ *
+ * Lookups and fills are only done inside a window, and only while no
+ * write to the DBI has finished since the window opened nor is in flight:
+ * the cache then holds nothing newer or older than the snapshot.
+ */
+void ops_vcache_read_begin(void);
+
+/**
+ * @brief Close the read window of the calling thread.
+ */
+void ops_vcache_read_end(void);
+
+/**
+ * @brief Copy the cached value of @p key into @p dst.
+ *
+ * @param inout_size Capacity of @p dst in, value size out (on a hit).
+ * @param count_miss Non-zero to count a miss.
+ * @return 0 on a hit, -ENOENT otherwise (no window, no cache, not cached,
+ *         @p dst too small, or a write in the way).
+ */
+int ops_vcache_get(const unsigned dbi, const void* key, const size_t key_size, void* dst,
+                   size_t* inout_size, const int count_miss);
+
+/**
+ * @brief Offer the value just read by the calling thread to the cache.
+ */
+void ops_vcache_fill(const unsigned dbi, const void* key, const size_t key_size,
+                     const void* val, const size_t val_size);
+
+/**
+ * @brief Announce a write to DBI @p dbi, before its write txn begins.
+ *
+ * Until the matching ops_vcache_write_end() no lookup or fill of the DBI
+ * is done. Returns quickly for DBIs without a cache.
+ */
+void ops_vcache_write_begin(const unsigned dbi);
+
+/**
+ * @brief End a write announced by ops_vcache_write_begin(), committed or not.
+ *
+ * @param key Key written, NULL when unknown (the whole DBI is dropped).
+ */
+void ops_vcache_write_end(const unsigned dbi, const void* key, const size_t key_size);
+
+/**
+ * @brief Read the counters of DBI @p dbi.
+ *
+ * @return 0 on success, -ENOENT when the DBI has no cache.
+ */
+int ops_vcache_stats(const unsigned dbi, db_cache_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_VCACHE_H_ */
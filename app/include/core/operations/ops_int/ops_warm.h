@@ -0,0 +1,108 @@
+/**
+ * @file ops_warm.h
+ * @brief Warm start of an existing env: stale readers, page-cache prefetch,
+ *        DBI open from a persisted schema record.
+ */
+
+#ifndef DB_OPERATIONS_OPS_WARM_H_
+#define DB_OPERATIONS_OPS_WARM_H_
+
+#include "db.h"         /* MDB_txn */
+#include "ops_facade.h" /* db_env_cfg_t, db_warm_stats_t, dbi_type_t */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Clear the counters for a new open of the env.
+ */
+void ops_warm_reset(void);
+
+/**
+ * @brief Free the reader slots of processes that died holding them.
+ *
+ * A slot left by a crash pins its snapshot: the pages freed since then
+ * cannot be reused and the file grows.
+ *
+ * @return Slots cleared, or a negative errno.
+ */
+int ops_warm_readers(void);
+
+/**
+ * @brief madvise(MADV_WILLNEED) over the used part of the map.
+ *
+ * The kernel reads the pages ahead in the background; nothing is waited
+ * for. On a map larger than RAM this only evicts, prefer walking the hot
+ * DBIs with @ref ops_warm_walk_start.
+ *
+ * @return 0, or a negative errno.
+ */
+int ops_warm_prefetch_map(void);
+
+/**
+ * @brief Open the DBIs from the schema record when it matches.
+ *
+ * The record lists the name, type and LMDB flags of every DBI of the last
+ * open that saved it. When @p names and @p types match it, the DBIs are
+ * opened without MDB_CREATE in a read txn (no writer lock, no commit) and
+ * their flags are taken from the record instead of mdb_dbi_flags.
+ *
+ * @return 1 when opened this way, 0 when the caller must open them in a
+ *         write txn (no record, another schema, a DBI gone), or a negative
+ *         errno (custom order refused, txn failure).
+ */
+int ops_warm_schema_open(const char* const* names, const dbi_type_t* types, const unsigned n,
+                         const db_env_cfg_t* cfg);
+
+/**
+ * @brief Write the schema record of the DBIs just opened in @p txn.
+ *
+ * Stored in the main DBI under a key no DBI name can take (it starts
+ * with a NUL byte), so it travels with the env in copies and backups.
+ *
+ * @return 0, or a negative errno.
+ */
+int ops_warm_schema_save(MDB_txn* txn, const char* const* names, const dbi_type_t* types,
+                         const unsigned n);
+
+/**
+ * @brief Walk the DBIs of @p mask (bit i for DBI i) in the background.
+ *
+ * One thread per DBI reads every entry through a cursor, DB_LMDB_WARM_STEP
+ * entries per read txn so that the map can still grow. Dups of a DUPSORT
+ * DBI are skipped (MDB_NEXT_NODUP).
+ *
+ * @return 0 when started, -EINVAL for a bit past the DBIs, -EALREADY while
+ *         walks run, or the negative errno of pthread_create.
+ */
+int ops_warm_walk_start(const unsigned mask);
+
+/**
+ * @brief Wait for the walks.
+ *
+ * @return 0, or the first error of a walk.
+ */
+int ops_warm_wait(void);
+
+/**
+ * @brief Stop the walks and wait for them. No-op when none runs.
+ */
+void ops_warm_stop(void);
+
+/**
+ * @brief Snapshot what the warm start did.
+ */
+void ops_warm_stats(db_warm_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_WARM_H_ */
@@ -0,0 +1,115 @@
+/**
+ * @file ops_zip.h
+ * @brief Compressed values of DBI_TYPE_ZIP DBIs: LZ4, or zstd with dictionaries kept in a DBI.
+ */
+
+#ifndef DB_OPERATIONS_OPS_ZIP_H_
+#define DB_OPERATIONS_OPS_ZIP_H_
+
+#include <stddef.h> /* size_t */
+
+#include "config.h"        /* DB_LMDB_ZIP_* */
+#include "dbi_ext.h"       /* dbi_type_t */
+#include "ops_facade.h"    /* db_view_t, db_zip_cfg_t, db_zip_stats_t */
+#include "ops_internals.h" /* MDB_val */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/****************************************************************************
+ * PUBLIC FUNCTION PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Mark the DBI_TYPE_ZIP DBIs, with the default codec.
+ *
+ * Every value of such a DBI is stored as a frame: a tag byte, then the
+ * raw bytes or a compressed block and its size.
+ *
+ * @return 0 on success, -EINVAL for a ZIP DBI with dups (frames would
+ *         break their order).
+ */
+int ops_zip_open(const dbi_type_t* types, const unsigned n_dbis);
+
+/**
+ * @brief Free the dictionaries and forget the ZIP DBIs (shutdown).
+ */
+void ops_zip_close(void);
+
+/**
+ * @brief Non-zero when the values of DBI @p dbi are frames.
+ */
+int ops_zip_on(const unsigned dbi);
+
+/**
+ * @brief Set the codec of new values of DBI @p dbi, loading its dictionaries.
+ *
+ * Not thread safe against running batches: call it between them.
+ *
+ * @return 0 on success, -EINVAL (not a ZIP DBI, bad meta DBI), -ENOTSUP
+ *         (codec not built in), -ENOMEM, or a negative errno of the load.
+ */
+int ops_zip_enable(const unsigned dbi, const db_zip_cfg_t* cfg);
+
+/**
+ * @brief Train a zstd dictionary on @p samples, or on values of DBI @p dbi
+ *        when NULL, store it in the meta DBI and compress new values with it.
+ *
+ * @return The dictionary id (> 0), -EINVAL (no dictionary setup, too few
+ *         samples), -ENOTSUP, -ENOSPC (DB_LMDB_ZIP_DICTS reached),
+ *         -ENOMEM, or a negative errno of the txns.
+ */
+int ops_zip_train(const unsigned dbi, const db_view_t* samples, const size_t n_samples);
+
+/**
+ * @brief Frame @p in for DBI @p dbi.
+ *
+ * @p out points into a buffer of the calling thread, valid until its
+ * next ops_zip_pack().
+ *
+ * @return 0 on success, -ENOMEM.
+ */
+int ops_zip_pack(const unsigned dbi, const MDB_val* in, MDB_val* out);
+
+/**
+ * @brief Size of the value held by @p frame.
+ *
+ * @return 0 on success, -EIO for a malformed frame.
+ */
+int ops_zip_size(const MDB_val* frame, size_t* out);
+
+/**
+ * @brief Decode @p frame of DBI @p dbi into the @p size bytes at @p dst.
+ *
+ * @p size must be the ops_zip_size() of the frame.
+ *
+ * @return 0 on success, -EIO (corrupt frame), -ENOKEY (dictionary not
+ *         loaded), -ENOTSUP (codec not built in).
+ */
+int ops_zip_unpack(const unsigned dbi, const MDB_val* frame, void* dst, const size_t size);
+
+/**
+ * @brief View of the value held by @p frame.
+ *
+ * Raw frames are viewed in place, compressed ones are decoded into a
+ * buffer of the calling thread, valid until its next ops_zip_view().
+ *
+ * @return 0 on success, -ENOMEM, or an ops_zip_unpack() error.
+ */
+int ops_zip_view(const unsigned dbi, const MDB_val* frame, MDB_val* out);
+
+/**
+ * @brief Read the counters of DBI @p dbi.
+ *
+ * @return 0 on success, -ENOENT when the DBI is not a ZIP one.
+ */
+int ops_zip_stats(const unsigned dbi, db_zip_stats_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_OPERATIONS_OPS_ZIP_H_ */
@@ -56,9 +56,8 @@ typedef enum
  * - MDB_SUCCESS -> `DB_SAFETY_SUCCESS`
  * - Resizable or transient conditions (e.g. `MDB_MAP_RESIZED`, `MDB_MAP_FULL`,
  *   `MDB_PAGE_FULL`, `MDB_TXN_FULL`, `MDB_CURSOR_FULL`, `MDB_BAD_RSLOT`,
- *   `MDB_READERS_FULL`) -> abort supplied txn (if any) and either attempt map
- *   expansion (on `MDB_MAP_FULL`) or return `DB_SAFETY_RETRY` to indicate the
- *   caller may retry the operation.
+ *   `MDB_READERS_FULL`) -> abort supplied txn (if any) and return
+ *   `DB_SAFETY_RETRY` to indicate the caller may retry the operation.
  * - Logic-level results (e.g. `MDB_NOTFOUND`, `MDB_KEYEXIST`) -> `DB_SAFETY_FAIL`
  *   (transaction is not necessarily invalidated for these cases).
  * - Any other LMDB error -> log, abort the txn (if any) and return
@@ -67,9 +66,8 @@ typedef enum
  * Side effects:
  * - The function may call `mdb_txn_abort(txn)` when `txn` is non-NULL and the
  *   error requires transaction invalidation.
- * - On `MDB_MAP_FULL` it will attempt `_expand_env_mapsize()`; if expansion
- *   succeeds the function returns `DB_SAFETY_RETRY` to indicate the caller may
- *   retry the operation.
+ * - It never resizes the map: on `MDB_MAP_FULL` (`-ENOSPC`) the caller grows
+ *   it with `ops_map_on_full()` once out of the resize gate, then retries.
  *
  * @param mdb_rc The raw LMDB return code to evaluate.
  * @param txn Optional pointer to an LMDB transaction. If provided and the
@@ -83,6 +81,25 @@ typedef enum
  */
 db_security_ret_code_t security_check(const int mdb_rc, MDB_txn* txn, int* const out_errno);
 
+/**
+ * @brief Map an LMDB failure and make sure the txn does not outlive it.
+ *
+ * Same as @ref security_check, but the logic failures (NOTFOUND, KEYEXIST)
+ * abort @p txn too: for write paths that drop the txn on any failure, so
+ * that no reader slot or writer lock leaks.
+ *
+ * @return One of db_security_ret_code_t, with @p txn aborted unless
+ *         `mdb_rc` is MDB_SUCCESS.
+ */
+db_security_ret_code_t security_fail_txn(const int mdb_rc, MDB_txn* txn, int* const out_errno);
+
+/**
+ * @brief Abort @p txn (if any) on a non-LMDB failure and report @p err.
+ *
+ * @return DB_SAFETY_FAIL.
+ */
+db_security_ret_code_t security_abort_txn(MDB_txn* txn, const int err, int* const out_errno);
+
 #ifdef __cplusplus
 }
 #endif
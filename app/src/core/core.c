@@ -2,18 +2,33 @@
  * @file db_lmdb_core.c
  */
 
-#include <errno.h>         /* EINVAL, ENOMEM, EALREADY */
-#include <stdint.h>        /* uint8_t */
+#include <errno.h>         /* EINVAL, ENOMEM, EALREADY, ENOTCONN */
+#include <stdint.h>        /* uint8_t, SIZE_MAX */
 #include <stdlib.h>        /* calloc, free */
+#include <string.h>        /* memset, memcpy, memcmp */
 
 #include "common.h"        /* EML_* macros, LMDB_EML_* */
 #include "core.h"
 #include "db.h"            /* DataBase_t, MDB_envinfo */
 #include "dbi_int.h"       /* dbi_t */
-#include "ops_actions.h"   /* act_txn_begin, act_txn_commit */
+#include "ops_actions.h"   /* act_txn_begin, act_txn_ro_flush */
+#include "ops_async.h"     /* ops_async_* */
+#include "ops_backup.h"    /* ops_backup_* */
+#include "ops_bloom.h"     /* ops_bloom_* */
+#include "ops_bulk.h"      /* ops_bulk_* */
 #include "ops_exec.h"      /* ops_add_operation, ops_execute_operations */
+#include "ops_group.h"     /* ops_group_* */
+#include "ops_index.h"     /* ops_index_* */
 #include "ops_facade.h"    /* DB_OPERATION_* */
 #include "ops_init.h"      /* ops_init_env, ops_init_dbi */
+#include "ops_map.h"       /* ops_map_* */
+#include "ops_shard.h"     /* ops_shards_*, ops_shard_batch_* */
+#include "ops_stats.h"     /* ops_stats_snapshot */
+#include "ops_trace.h"     /* ops_trace_set */
+#include "ops_ttl.h"       /* ops_ttl_* */
+#include "ops_vcache.h"    /* ops_vcache_* */
+#include "ops_warm.h"      /* ops_warm_* */
+#include "ops_zip.h"       /* ops_zip_* */
 #include "ops_internals.h" /* op_t, op_key_t, op_type_t */
 
 /* Definition of the global DB handle declared in db.h */
@@ -51,6 +66,13 @@ static int _prepare_op_key_and_val(op_t* op, const op_type_t type, const void* k
         return -EINVAL;
     }
 
+    /* Slots are reused across batches, drop stale modifiers */
+    op->flags   = OP_FLAG_NONE;
+    op->scan    = NULL;
+    op->multi   = NULL;
+    op->reserve = NULL;
+    op->patch   = NULL;
+
     /* switch the operation type */
     switch(type)
     {
@@ -140,6 +162,46 @@ static int _prepare_op_key_and_val(op_t* op, const op_type_t type, const void* k
 
             break;
 
+        case DB_OPERATION_DEL:
+            /* Key is given by the user or looked up like for GET */
+            if(key_data)
+            {
+                op->key.kind         = OP_KEY_KIND_PRESENT;
+                op->key.present.ptr  = (void*)key_data;
+                op->key.present.size = key_size;
+            }
+            else
+            {
+                op->key.kind            = OP_KEY_KIND_LOOKUP;
+                op->key.lookup.op_index = key_size;
+                op->key.lookup.src_type = OP_KEY_SRC_KEY;
+            }
+
+            /* Optional value: delete only this duplicate (DUPSORT DBIs) */
+            if(val_data)
+            {
+                if(val_size == 0)
+                {
+                    EML_ERROR(LOG_TAG,
+                              "_prepare_op_key_and_val: invalid val_size=0 for DEL with val_data");
+                    return -EINVAL;
+                }
+                op->val.kind         = OP_KEY_KIND_PRESENT;
+                op->val.present.ptr  = (void*)val_data;
+                op->val.present.size = val_size;
+            }
+            else
+            {
+                op->val.kind = OP_KEY_KIND_NONE;
+            }
+
+            break;
+
+        case DB_OPERATION_REP:
+            /* Needs an offset or a callback, see db_core_batch_add_patch() */
+            EML_ERROR(LOG_TAG, "_prepare_op_key_and_val: REP needs db_core_batch_add_patch");
+            return -EINVAL;
+
         default:
             EML_ERROR(LOG_TAG, "db_core_add_op: unsupported operation type=%d", type);
             return -EINVAL;
@@ -151,6 +213,112 @@ static int _prepare_op_key_and_val(op_t* op, const op_type_t type, const void* k
     return 0;
 }
 
+/* Queue a GET/PUT over all dups of one key, packed in multi */
+static int _add_multi_op(db_batch_t* batch, const unsigned dbi_idx, const op_type_t type,
+                         const void* key, const size_t key_size, db_multi_t* multi)
+{
+    /* Validate global DB, DBI index and key */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !key || key_size == 0)
+    {
+        EML_ERROR(LOG_TAG, "_add_multi_op: invalid input (db=%p idx=%u key=%p)",
+                  (void*)DataBase, dbi_idx, key);
+        return -EINVAL;
+    }
+
+    if(!DataBase->dbis[dbi_idx].is_dupfixed)
+    {
+        EML_ERROR(LOG_TAG, "_add_multi_op: dbi %u is not DUPFIXED", dbi_idx);
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "_add_multi_op: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi              = dbi_idx;
+    op->type             = type;
+    op->flags            = OP_FLAG_MULTIPLE;
+    op->multi            = multi;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = key_size;
+
+    return ops_add_operation(batch, op);
+}
+
+/* Open or create the DBIs in one write txn, saving the schema record if asked */
+static int _open_dbis(const char* const* dbi_names, const dbi_type_t* dbi_types,
+                      const unsigned n_dbis, const db_env_cfg_t* env_cfg)
+{
+    int      out_err_val = -EINVAL;
+    int*     out_err     = &out_err_val;
+    MDB_txn* txn         = NULL;
+
+    switch(act_txn_begin(&txn, 0, out_err))
+    {
+        case DB_SAFETY_SUCCESS:
+            break;
+        default:
+            EML_ERROR(LOG_TAG, "_init_db: _txn_begin failed, err=%d", out_err_val);
+            return out_err_val;
+    }
+
+    /* Initialize all requested DBIs */
+    for(unsigned i = 0; i < n_dbis; ++i)
+    {
+        const char*      name = dbi_names[i];
+        const dbi_type_t type = dbi_types[i];
+
+        switch(ops_init_dbi(txn, name, i, type, out_err))
+        {
+            case DB_SAFETY_SUCCESS:
+                break;
+            default:
+                EML_ERROR(LOG_TAG, "_init_db: _init_dbi failed for dbi %s, err=%d", name,
+                          (out_err) ? *out_err : -1);
+                return out_err_val;
+        }
+
+        /* Custom orders go in before any access to the DBI */
+        const db_cmp_fn_t key_cmp = env_cfg->key_cmps ? env_cfg->key_cmps[i] : NULL;
+        const db_cmp_fn_t dup_cmp = env_cfg->dup_cmps ? env_cfg->dup_cmps[i] : NULL;
+        if((key_cmp || dup_cmp) &&
+           ops_init_dbi_order(txn, i, key_cmp, dup_cmp, out_err) != DB_SAFETY_SUCCESS)
+        {
+            EML_ERROR(LOG_TAG, "_init_db: order of dbi %s refused, err=%d", name, out_err_val);
+            return out_err_val;
+        }
+    }
+
+    /* The next open can skip this txn */
+    if(env_cfg->warm & DB_WARM_SCHEMA)
+    {
+        out_err_val = ops_warm_schema_save(txn, dbi_names, dbi_types, n_dbis);
+        if(out_err_val != 0)
+        {
+            mdb_txn_abort(txn);
+            return out_err_val;
+        }
+    }
+
+    switch(act_txn_commit(txn, out_err))
+    {
+        case DB_SAFETY_SUCCESS:
+            break;
+        default:
+            EML_ERROR(LOG_TAG, "_init_db: _txn_commit failed err=%d", *out_err);
+            return out_err_val;
+    }
+    return 0;
+}
+
 /****************************************************************************
  * PUBLIC FUNCTIONS DEFINITIONS
  ****************************************************************************
@@ -158,6 +326,13 @@ static int _prepare_op_key_and_val(op_t* op, const op_type_t type, const void* k
 
 int db_core_init(const char* const path, const unsigned int mode, const char* const* dbi_names,
                  const dbi_type_t* dbi_types, unsigned n_dbis)
+{
+    return db_core_init_ex(path, mode, dbi_names, dbi_types, n_dbis, NULL);
+}
+
+int db_core_init_ex(const char* const path, const unsigned int mode,
+                    const char* const* dbi_names, const dbi_type_t* dbi_types, unsigned n_dbis,
+                    const db_env_cfg_t* cfg)
 {
     if(DataBase)
     {
@@ -171,6 +346,31 @@ int db_core_init(const char* const path, const unsigned int mode, const char* co
         EML_ERROR(LOG_TAG, "_init_db: invalid input");
         return -EINVAL;
     }
+    for(unsigned i = 0; i < n_dbis; ++i)
+    {
+        if(!dbi_names[i] || !(*dbi_names[i]))
+        {
+            EML_ERROR(LOG_TAG, "_init_db: invalid dbi name at index %u", i);
+            return -EINVAL;
+        }
+    }
+
+    /* Profile defaults under the caller overrides */
+    db_env_cfg_t env_cfg;
+    int          cfg_rc = ops_env_cfg_resolve(cfg, &env_cfg);
+    if(cfg_rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "_init_db: invalid env config");
+        return cfg_rc;
+    }
+
+    /* One prefetch walker per DBI, checked before the env is touched */
+    const unsigned walk_lim = n_dbis < DB_MAX_DBIS ? n_dbis : DB_MAX_DBIS;
+    if((env_cfg.prefetch_dbis >> walk_lim) != 0)
+    {
+        EML_ERROR(LOG_TAG, "_init_db: prefetch_dbis 0x%x past the dbis", env_cfg.prefetch_dbis);
+        return -EINVAL;
+    }
 
     /* Prepare error output */
     int  out_err_val = -EINVAL;
@@ -186,7 +386,7 @@ int db_core_init(const char* const path, const unsigned int mode, const char* co
     }
 
     /* Set max map size */
-    new_DataBase->map_size_bytes_max = (size_t)DB_MAP_SIZE_MAX;
+    new_DataBase->map_size_bytes_max = env_cfg.map_size_max;
 
     /* Allocate DBI descriptor array */
     new_DataBase->dbis = calloc(n_dbis, sizeof(dbi_t));
@@ -202,7 +402,7 @@ int db_core_init(const char* const path, const unsigned int mode, const char* co
     DataBase = new_DataBase;
 
     /* Do not allow retry on init */
-    switch(ops_init_env(DB_MAX_DBIS, path, mode, out_err))
+    switch(ops_init_env(&env_cfg, path, mode, out_err))
     {
         case DB_SAFETY_SUCCESS:
             break;
@@ -211,52 +411,80 @@ int db_core_init(const char* const path, const unsigned int mode, const char* co
             goto fail;
     }
 
-    /* Init a transaction */
-    MDB_txn* txn = NULL;
+    /* Growth policy of the new env, counters from zero */
+    ops_map_configure(env_cfg.map_grow_step);
 
-    switch(act_txn_begin(&txn, 0, out_err))
+    /* Counters of this open */
+    ops_warm_reset();
+
+    /* Slots of readers that died with their process pin old snapshots */
+    if(env_cfg.warm & DB_WARM_READER_CHECK)
     {
-        case DB_SAFETY_SUCCESS:
-            break;
-        default:
-            EML_ERROR(LOG_TAG, "_init_db: _txn_begin failed, err=%d", out_err_val);
-            goto fail;
+        out_err_val = ops_warm_readers();
+        if(out_err_val < 0) goto fail;
     }
 
-    /* Initialize all requested DBIs */
-    for(unsigned i = 0; i < n_dbis; ++i)
-    {
-        const char*      name = dbi_names[i];
-        const dbi_type_t type = dbi_types[i];
+    /* Best effort: the kernel reads the map ahead while the DBIs open */
+    if(env_cfg.warm & DB_WARM_PREFETCH_MAP) (void)ops_warm_prefetch_map();
 
-        if(!name || !(*name))
+    /* Same DBIs as the last open: no write txn */
+    int warm = 0;
+    if(env_cfg.warm & DB_WARM_SCHEMA)
+    {
+        warm = ops_warm_schema_open(dbi_names, dbi_types, n_dbis, &env_cfg);
+        if(warm < 0)
         {
-            EML_ERROR(LOG_TAG, "_init_db: invalid dbi name at index %u", i);
-            out_err_val = -EINVAL;
+            out_err_val = warm;
             goto fail;
         }
+    }
 
-        switch(ops_init_dbi(txn, name, i, type, out_err))
+    if(!warm)
+    {
+        out_err_val = _open_dbis(dbi_names, dbi_types, n_dbis, &env_cfg);
+        if(out_err_val != 0) goto fail;
+    }
+
+    /* Key filters of the DBI_TYPE_BLOOM DBIs: sidecar or key scan */
+    out_err_val = ops_bloom_open(path, dbi_names, dbi_types, n_dbis);
+    if(out_err_val != 0)
+    {
+        EML_ERROR(LOG_TAG, "_init_db: ops_bloom_open failed, err=%d", out_err_val);
+        goto fail;
+    }
+
+    /* Values of the DBI_TYPE_ZIP DBIs are frames from now on */
+    out_err_val = ops_zip_open(dbi_types, n_dbis);
+    if(out_err_val != 0)
+    {
+        EML_ERROR(LOG_TAG, "_init_db: ops_zip_open failed, err=%d", out_err_val);
+        goto fail;
+    }
+
+    /* Commits no longer reach the disk on their own */
+    if(env_cfg.opts & (DB_ENV_OPT_NOSYNC | DB_ENV_OPT_NOMETASYNC))
+    {
+        out_err_val = ops_env_sync_start(env_cfg.sync_ms);
+        if(out_err_val != 0)
         {
-            case DB_SAFETY_SUCCESS:
-                break;
-            default:
-                EML_ERROR(LOG_TAG, "_init_db: _init_dbi failed for dbi %s, err=%d", name,
-                          (out_err) ? *out_err : -1);
-                goto fail;
+            EML_ERROR(LOG_TAG, "_init_db: ops_env_sync_start failed, err=%d", out_err_val);
+            goto fail;
         }
     }
 
-    switch(act_txn_commit(txn, out_err))
+    /* Hot DBIs paged in behind the first requests */
+    if(env_cfg.prefetch_dbis)
     {
-        case DB_SAFETY_SUCCESS:
-            break;
-        default:
-            EML_ERROR(LOG_TAG, "_init_db: _txn_commit failed err=%d", *out_err);
+        out_err_val = ops_warm_walk_start(env_cfg.prefetch_dbis);
+        if(out_err_val != 0)
+        {
+            EML_ERROR(LOG_TAG, "_init_db: ops_warm_walk_start failed, err=%d", out_err_val);
             goto fail;
+        }
     }
 
-    EML_INFO(LOG_TAG, "_init_db: database initialized with %u dbis, with size %llu", n_dbis, DB_MAP_SIZE_MAX);
+    EML_INFO(LOG_TAG, "_init_db: database initialized with %u dbis, with size %zu", n_dbis,
+             env_cfg.map_size_max);
     return 0;
 
 fail:
@@ -265,29 +493,86 @@ fail:
     return out_err_val;
 }
 
-int db_core_add_op(const unsigned dbi_idx, const op_type_t type, const void* key_data,
-                   const size_t key_size, const void* val_data, const size_t val_size)
+int db_core_env_profile(const db_env_profile_t profile, db_env_cfg_t* out_cfg)
+{
+    return ops_env_profile(profile, out_cfg);
+}
+
+int db_core_warm_wait(void)
+{
+    return ops_warm_wait();
+}
+
+void db_core_warm_stats(db_warm_stats_t* out_stats)
+{
+    ops_warm_stats(out_stats);
+}
+
+int db_core_cmp_be64(const db_view_t* a, const db_view_t* b)
+{
+    /* One load and compare instead of a byte loop, other sizes as LMDB */
+    if(a->size == sizeof(uint64_t) && b->size == sizeof(uint64_t))
+    {
+        uint64_t x, y;
+        memcpy(&x, a->data, sizeof(x));
+        memcpy(&y, b->data, sizeof(y));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        x = __builtin_bswap64(x);
+        y = __builtin_bswap64(y);
+#endif
+        return (x > y) - (x < y);
+    }
+
+    const size_t n = a->size < b->size ? a->size : b->size;
+    const int    c = memcmp(a->data, b->data, n);
+    return c ? c : (a->size > b->size) - (a->size < b->size);
+}
+
+int db_core_batch_create(db_batch_t** out_batch)
+{
+    if(!out_batch)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_create: invalid input");
+        return -EINVAL;
+    }
+
+    *out_batch = ops_batch_create();
+    if(!*out_batch)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_create: ops_batch_create failed");
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+int db_core_batch_add_op(db_batch_t* batch, const unsigned dbi_idx, const op_type_t type,
+                         const void* key_data, const size_t key_size, const void* val_data,
+                         const size_t val_size)
 {
     /* Validate global DB and DBI index */
     if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis)
     {
-        EML_ERROR(LOG_TAG, "db_core_add_op: invalid db/dbi (db=%p idx=%u n_dbis=%zu)",
+        EML_ERROR(LOG_TAG, "db_core_batch_add_op: invalid db/dbi (db=%p idx=%u n_dbis=%zu)",
                   (void*)DataBase, dbi_idx, DataBase ? DataBase->n_dbis : 0);
         return -EINVAL;
     }
 
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
     /* Get nex op */
-    op_t* op = ops_get_next_op();
+    op_t* op = ops_get_next_op(batch);
     if(!op)
     {
-        EML_ERROR(LOG_TAG, "db_core_add_op: ops_get_next_op failed");
+        EML_ERROR(LOG_TAG, "db_core_batch_add_op: ops_get_next_op failed");
         return -ENOMEM;
     }
 
     int res = _prepare_op_key_and_val(op, type, key_data, key_size, val_data, val_size);
     if(res != 0)
     {
-        EML_ERROR(LOG_TAG, "db_core_add_op: _prepare_op_key_and_val failed");
+        EML_ERROR(LOG_TAG, "db_core_batch_add_op: _prepare_op_key_and_val failed");
         return res;
     }
 
@@ -295,28 +580,718 @@ int db_core_add_op(const unsigned dbi_idx, const op_type_t type, const void* key
     op->dbi  = dbi_idx;
     op->type = type;
 
-    EML_DBG(LOG_TAG, "db_core_add_op: queued op (dbi=%u type=%d key_size=%zu val_size=%zu)",
-            dbi_idx, (int)type, key_size, val_size);
+    DB_HOT_DBG(LOG_TAG,
+               "db_core_batch_add_op: queued op (dbi=%u type=%d key_size=%zu val_size=%zu)",
+               dbi_idx, (int)type, key_size, val_size);
 
-    return ops_add_operation(op);
+    return ops_add_operation(batch, op);
 }
 
-int db_core_exec_ops(void)
+int db_core_batch_add_del_range(db_batch_t* batch, const unsigned dbi_idx,
+                                const void* start_key, const size_t start_size,
+                                const void* end_key, const size_t end_size)
 {
-    int rc = ops_execute_operations();
-    if(rc != 0)
+    /* Validate global DB and DBI index */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis)
     {
-        EML_ERROR(LOG_TAG, "db_core_exec_ops: batch failed, rc=%d", rc);
+        EML_ERROR(LOG_TAG, "db_core_batch_add_del_range: invalid db/dbi (db=%p idx=%u)",
+                  (void*)DataBase, dbi_idx);
+        return -EINVAL;
     }
-    return rc;
+
+    /* A bound is either absent or fully given */
+    if((start_key && start_size == 0) || (end_key && end_size == 0))
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_del_range: zero-size bound");
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_del_range: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi   = dbi_idx;
+    op->type  = DB_OPERATION_DEL;
+    op->flags = OP_FLAG_RANGE;
+    if(start_key)
+    {
+        op->key.kind         = OP_KEY_KIND_PRESENT;
+        op->key.present.ptr  = (void*)start_key;
+        op->key.present.size = start_size;
+    }
+    if(end_key)
+    {
+        op->val.kind         = OP_KEY_KIND_PRESENT;
+        op->val.present.ptr  = (void*)end_key;
+        op->val.present.size = end_size;
+    }
+
+    return ops_add_operation(batch, op);
 }
 
-size_t db_core_shutdown(void)
+int db_core_batch_add_scan(db_batch_t* batch, const unsigned dbi_idx, db_scan_t* scan)
 {
-    /* No database initialized: idempotent no-op. */
-    if(!DataBase) return 0;
+    /* Validate global DB and DBI index */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !scan)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_scan: invalid input (db=%p idx=%u scan=%p)",
+                  (void*)DataBase, dbi_idx, (void*)scan);
+        return -EINVAL;
+    }
 
-    size_t final_mapsize = 0;
+    /* Exactly one sink, and a key for the keyed modes */
+    const int has_start = scan->start.data && scan->start.size;
+    const int has_end   = scan->end.data && scan->end.size;
+    if((!scan->cb && (!scan->page || !scan->page->buf)) ||
+       (scan->mode != DB_SCAN_RANGE && (!has_start || has_end)) || scan->mode > DB_SCAN_DUPS)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_scan: bad scan (mode=%d)", (int)scan->mode);
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_scan: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi  = dbi_idx;
+    op->type = DB_OPERATION_LST;
+    op->scan = scan;
+    if(has_start)
+    {
+        op->key.kind         = OP_KEY_KIND_PRESENT;
+        op->key.present.ptr  = (void*)scan->start.data;
+        op->key.present.size = scan->start.size;
+    }
+    if(has_end)
+    {
+        op->val.kind         = OP_KEY_KIND_PRESENT;
+        op->val.present.ptr  = (void*)scan->end.data;
+        op->val.present.size = scan->end.size;
+    }
+
+    return ops_add_operation(batch, op);
+}
+
+int db_core_page_next(const db_scan_page_t* page, size_t* pos, db_view_t* key, db_view_t* val)
+{
+    if(!page || !pos || !key || !val || *pos >= page->used) return 0;
+
+    const unsigned char* rec = (const unsigned char*)page->buf + *pos;
+    db_scan_rec_t        hdr;
+    memcpy(&hdr, rec, sizeof(hdr));
+
+    key->size = hdr.key_size;
+    key->data = rec + sizeof(hdr);
+    val->size = hdr.val_size;
+    val->data = rec + sizeof(hdr) + hdr.key_size;
+
+    /* Records are 8-byte aligned, see act_lst */
+    *pos += (sizeof(hdr) + hdr.key_size + hdr.val_size + 7u) & ~(size_t)7u;
+    return 1;
+}
+
+int db_core_batch_add_get_multiple(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                   const size_t key_size, db_multi_t* multi)
+{
+    if(!multi || !multi->buf || multi->cap == 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_get_multiple: invalid buffer");
+        return -EINVAL;
+    }
+
+    return _add_multi_op(batch, dbi_idx, DB_OPERATION_GET, key, key_size, multi);
+}
+
+int db_core_batch_add_put_multiple(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                   const size_t key_size, db_multi_t* multi)
+{
+    if(!multi || !multi->buf || multi->elem_size == 0 || multi->n_items == 0 ||
+       multi->n_items > (size_t)-1 / multi->elem_size)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_multiple: invalid array");
+        return -EINVAL;
+    }
+
+    return _add_multi_op(batch, dbi_idx, DB_OPERATION_PUT, key, key_size, multi);
+}
+
+int db_core_batch_add_put_reserve(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                                  const size_t key_size, db_reserve_t* reserve)
+{
+    /* Validate global DB, DBI index, key and writer */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !key || key_size == 0 ||
+       !reserve || !reserve->write || reserve->size == 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_reserve: invalid input (db=%p idx=%u key=%p)",
+                  (void*)DataBase, dbi_idx, key);
+        return -EINVAL;
+    }
+
+    /* LMDB cannot reserve a dup: its bytes are the sort key */
+    if(DataBase->dbis[dbi_idx].is_dupsort)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_reserve: dbi %u is DUPSORT", dbi_idx);
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_reserve: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi              = dbi_idx;
+    op->type             = DB_OPERATION_PUT;
+    op->flags            = OP_FLAG_RESERVE;
+    op->reserve          = reserve;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = key_size;
+
+    return ops_add_operation(batch, op);
+}
+
+int db_core_batch_add_put_ttl(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                              const size_t key_size, const void* val, const size_t val_size,
+                              const uint64_t ttl_ms)
+{
+    /* Validate global DB, DBI index, key, value and lifetime */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !key || key_size == 0 ||
+       key_size > DB_LMDB_TTL_KEY_MAX || !val || val_size == 0 || ttl_ms == 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_ttl: invalid input (db=%p idx=%u key=%p)",
+                  (void*)DataBase, dbi_idx, key);
+        return -EINVAL;
+    }
+
+    /* Deadlines need the queue, which never expires itself */
+    const int queue = ops_ttl_queue();
+    if(queue < 0 || (unsigned)queue == dbi_idx)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_ttl: no expiry queue for dbi %u", dbi_idx);
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_put_ttl: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi              = dbi_idx;
+    op->type             = DB_OPERATION_PUT;
+    op->flags            = OP_FLAG_TTL;
+    op->ttl_ms           = ttl_ms;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = key_size;
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = (void*)val;
+    op->val.present.size = val_size;
+
+    return ops_add_operation(batch, op);
+}
+
+int db_core_batch_add_patch(db_batch_t* batch, const unsigned dbi_idx, const void* key,
+                            const size_t key_size, db_patch_t* patch)
+{
+    /* Validate global DB, DBI index and key */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !key || key_size == 0 ||
+       !patch)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_patch: invalid input (db=%p idx=%u key=%p)",
+                  (void*)DataBase, dbi_idx, key);
+        return -EINVAL;
+    }
+
+    /* Exactly one of bytes or callback; the bounds are checked against the
+    stored value at exec time */
+    const int bad_bytes =
+        !patch->bytes || patch->size == 0 || patch->offset > SIZE_MAX - patch->size;
+    if(patch->mutate ? patch->bytes != NULL : bad_bytes)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_patch: bad patch (offset=%zu size=%zu)",
+                  patch->offset, patch->size);
+        return -EINVAL;
+    }
+
+    /* A dup is its own sort key, it cannot be edited in place */
+    if(DataBase->dbis[dbi_idx].is_dupsort)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_patch: dbi %u is DUPSORT", dbi_idx);
+        return -EINVAL;
+    }
+
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    op_t* op = ops_get_next_op(batch);
+    if(!op)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_add_patch: ops_get_next_op failed");
+        return -ENOMEM;
+    }
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi              = dbi_idx;
+    op->type             = DB_OPERATION_REP;
+    op->patch            = patch;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = key_size;
+
+    return ops_add_operation(batch, op);
+}
+
+int db_core_batch_prepare(db_batch_t* batch)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    int rc = ops_batch_prepare(batch);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_prepare: prepare failed, rc=%d", rc);
+    }
+    return rc;
+}
+
+int db_core_batch_bind(db_batch_t* batch, const size_t op_idx, const void* key,
+                       const size_t key_size, const void* val, const size_t val_size)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+    return ops_batch_bind(batch, op_idx, key, key_size, val, val_size);
+}
+
+void db_core_batch_unprepare(db_batch_t* batch)
+{
+    ops_batch_unprepare(batch ? batch : ops_batch_default());
+}
+
+int db_core_batch_exec(db_batch_t* batch)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    int rc = ops_execute_operations(batch);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_exec: batch failed, rc=%d", rc);
+    }
+    return rc;
+}
+
+int db_core_batch_exec_leased(db_batch_t* batch, db_view_t* out_views, const size_t n_views)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    int rc = ops_execute_leased(batch, out_views, n_views);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_batch_exec_leased: batch failed, rc=%d", rc);
+    }
+    return rc;
+}
+
+void db_core_release_read(db_batch_t* batch)
+{
+    ops_release_leased(batch ? batch : ops_batch_default());
+}
+
+void db_core_batch_destroy(db_batch_t* batch)
+{
+    ops_batch_destroy(batch);
+}
+
+int db_core_batch_set_sorted(db_batch_t* batch, const int enable)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+    return ops_batch_set_sorted(batch, enable);
+}
+
+int db_core_batch_set_segment_ops(db_batch_t* batch, const size_t segment_ops)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+    return ops_batch_set_segment_ops(batch, segment_ops);
+}
+
+void db_core_batch_stats(const db_batch_t* batch, db_exec_stats_t* out_stats)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+    ops_batch_exec_stats(batch, out_stats);
+}
+
+int db_core_bulk_begin(db_bulk_t** out_bulk, const db_bulk_cfg_t* cfg)
+{
+    if(!out_bulk)
+    {
+        EML_ERROR(LOG_TAG, "db_core_bulk_begin: invalid input");
+        return -EINVAL;
+    }
+
+    *out_bulk = ops_bulk_create(cfg);
+    return *out_bulk ? 0 : -ENOMEM;
+}
+
+int db_core_bulk_put(db_bulk_t* bulk, const unsigned dbi_idx, const void* key,
+                     const size_t key_size, const void* val, const size_t val_size)
+{
+    /* Validate global DB and DBI index */
+    if(!DataBase || !DataBase->dbis || dbi_idx >= DataBase->n_dbis || !bulk)
+    {
+        EML_ERROR(LOG_TAG, "db_core_bulk_put: invalid input (db=%p idx=%u bulk=%p)",
+                  (void*)DataBase, dbi_idx, (void*)bulk);
+        return -EINVAL;
+    }
+
+    return ops_bulk_put(bulk, dbi_idx, key, key_size, val, val_size);
+}
+
+int db_core_bulk_flush(db_bulk_t* bulk)
+{
+    return ops_bulk_flush(bulk);
+}
+
+void db_core_bulk_stats(const db_bulk_t* bulk, db_bulk_stats_t* out_stats)
+{
+    ops_bulk_stats(bulk, out_stats);
+}
+
+int db_core_bulk_end(db_bulk_t* bulk, db_bulk_stats_t* out_stats)
+{
+    if(!bulk) return 0;
+
+    int rc = ops_bulk_flush(bulk);
+    if(out_stats) ops_bulk_stats(bulk, out_stats);
+    ops_bulk_destroy(bulk);
+    return rc;
+}
+
+int db_core_group_start(const db_group_cfg_t* cfg)
+{
+    return ops_group_start(cfg);
+}
+
+int db_core_group_exec(db_batch_t* batch)
+{
+    /* NULL selects the default batch */
+    if(!batch) batch = ops_batch_default();
+
+    int rc = ops_group_submit(batch);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_group_exec: batch failed, rc=%d", rc);
+    }
+    return rc;
+}
+
+void db_core_group_stop(void)
+{
+    ops_group_stop();
+}
+
+void db_core_group_stats(db_group_stats_t* out_stats)
+{
+    ops_group_stats(out_stats);
+}
+
+int db_core_async_start(const db_async_cfg_t* cfg)
+{
+    return ops_async_start(cfg);
+}
+
+int db_core_async_submit(db_batch_t* batch, db_async_cb_t cb, void* ctx)
+{
+    /* The default batch is shared with the blocking calls */
+    if(!batch || batch == ops_batch_default())
+    {
+        EML_ERROR(LOG_TAG, "db_core_async_submit: invalid batch");
+        return -EINVAL;
+    }
+
+    return ops_async_submit(batch, cb, ctx);
+}
+
+int db_core_async_poll(db_async_done_t* out, const size_t max)
+{
+    return ops_async_poll(out, max);
+}
+
+int db_core_async_fd(void)
+{
+    return ops_async_fd();
+}
+
+void db_core_async_stop(void)
+{
+    ops_async_stop();
+}
+
+void db_core_async_stats(db_async_stats_t* out_stats)
+{
+    ops_async_stats(out_stats);
+}
+
+int db_core_backup(const int fd, const db_backup_cfg_t* cfg)
+{
+    return ops_backup_start(fd, cfg);
+}
+
+int db_core_backup_wait(void)
+{
+    return ops_backup_wait();
+}
+
+void db_core_backup_status(db_backup_status_t* out_status)
+{
+    ops_backup_status(out_status);
+}
+
+int db_core_space_stats(db_space_stats_t* out_stats)
+{
+    return ops_backup_space(out_stats);
+}
+
+int db_core_shards_open(db_shards_t** out, const db_shards_cfg_t* cfg)
+{
+    return ops_shards_open(out, cfg);
+}
+
+void db_core_shards_close(db_shards_t* shards)
+{
+    ops_shards_close(shards);
+}
+
+int db_core_shards_of(const db_shards_t* shards, const void* key, const size_t key_size)
+{
+    return ops_shards_of(shards, key, key_size);
+}
+
+int db_core_shard_batch_create(db_shard_batch_t** out_batch)
+{
+    if(!out_batch)
+    {
+        EML_ERROR(LOG_TAG, "db_core_shard_batch_create: invalid input");
+        return -EINVAL;
+    }
+
+    *out_batch = ops_shard_batch_create();
+    return *out_batch ? 0 : -ENOMEM;
+}
+
+void db_core_shard_batch_destroy(db_shard_batch_t* batch)
+{
+    ops_shard_batch_destroy(batch);
+}
+
+int db_core_shard_batch_add_op(db_shard_batch_t* batch, const unsigned dbi_idx,
+                               const op_type_t type, const void* key_data, const size_t key_size,
+                               const void* val_data, const size_t val_size)
+{
+    return ops_shard_batch_add(batch, dbi_idx, type, key_data, key_size, val_data, val_size);
+}
+
+int db_core_shards_exec(db_shards_t* shards, db_shard_batch_t* batch, const int atomic)
+{
+    return ops_shards_exec(shards, batch, atomic);
+}
+
+void db_core_shards_stats(const db_shards_t* shards, db_shards_stats_t* out_stats)
+{
+    ops_shards_stats(shards, out_stats);
+}
+
+void db_core_map_stats(db_map_stats_t* out_stats)
+{
+    ops_map_stats(out_stats);
+}
+
+void db_core_stats(db_stats_t* out_stats)
+{
+    if(!out_stats) return;
+
+    ops_stats_snapshot(out_stats);
+    ops_map_stats(&out_stats->map);
+}
+
+void db_core_set_trace(db_trace_cb_t cb, void* ctx)
+{
+    ops_trace_set(cb, ctx);
+}
+
+int db_core_cache_enable(const unsigned dbi_idx, const db_cache_cfg_t* cfg)
+{
+    return ops_vcache_enable(dbi_idx, cfg);
+}
+
+void db_core_cache_disable(const unsigned dbi_idx)
+{
+    ops_vcache_disable(dbi_idx);
+}
+
+int db_core_cache_stats(const unsigned dbi_idx, db_cache_stats_t* out_stats)
+{
+    if(!out_stats)
+    {
+        EML_ERROR(LOG_TAG, "db_core_cache_stats: invalid input");
+        return -EINVAL;
+    }
+
+    return ops_vcache_stats(dbi_idx, out_stats);
+}
+
+int db_core_bloom_stats(const unsigned dbi_idx, db_bloom_stats_t* out_stats)
+{
+    if(!out_stats)
+    {
+        EML_ERROR(LOG_TAG, "db_core_bloom_stats: invalid input");
+        return -EINVAL;
+    }
+
+    return ops_bloom_stats(dbi_idx, out_stats);
+}
+
+int db_core_index_add(const db_index_t* index)
+{
+    return ops_index_add(index);
+}
+
+int db_core_zip_enable(const unsigned dbi_idx, const db_zip_cfg_t* cfg)
+{
+    return ops_zip_enable(dbi_idx, cfg);
+}
+
+int db_core_zip_train(const unsigned dbi_idx, const db_view_t* samples, const size_t n_samples)
+{
+    return ops_zip_train(dbi_idx, samples, n_samples);
+}
+
+int db_core_zip_stats(const unsigned dbi_idx, db_zip_stats_t* out_stats)
+{
+    if(!out_stats)
+    {
+        EML_ERROR(LOG_TAG, "db_core_zip_stats: invalid input");
+        return -EINVAL;
+    }
+
+    return ops_zip_stats(dbi_idx, out_stats);
+}
+
+int db_core_ttl_start(const db_ttl_cfg_t* cfg)
+{
+    return ops_ttl_start(cfg);
+}
+
+long db_core_ttl_sweep(void)
+{
+    return ops_ttl_sweep(ops_ttl_now_ms(), (size_t)-1);
+}
+
+int db_core_ttl_stats(db_ttl_stats_t* out_stats)
+{
+    if(!out_stats)
+    {
+        EML_ERROR(LOG_TAG, "db_core_ttl_stats: invalid input");
+        return -EINVAL;
+    }
+    if(ops_ttl_queue() < 0) return -ENOTCONN;
+
+    ops_ttl_stats(out_stats);
+    return 0;
+}
+
+int db_core_set_batch_max_ops(const size_t max_ops)
+{
+    int rc = ops_set_batch_max_ops(max_ops);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "db_core_set_batch_max_ops: invalid limit %zu", max_ops);
+    }
+    return rc;
+}
+
+void db_core_set_ro_txn_reuse(const int enable)
+{
+    act_txn_ro_set_reuse(enable);
+    EML_INFO(LOG_TAG, "db_core_set_ro_txn_reuse: read txn reuse %s", enable ? "on" : "off");
+}
+
+int db_core_add_op(const unsigned dbi_idx, const op_type_t type, const void* key_data,
+                   const size_t key_size, const void* val_data, const size_t val_size)
+{
+    return db_core_batch_add_op(NULL, dbi_idx, type, key_data, key_size, val_data, val_size);
+}
+
+int db_core_exec_ops(void)
+{
+    return db_core_batch_exec(NULL);
+}
+
+size_t db_core_shutdown(void)
+{
+    /* No database initialized: idempotent no-op. */
+    if(!DataBase) return 0;
+
+    size_t final_mapsize = 0;
+
+    /* Background threads run batches: the async workers before the writer,
+       which may still hold their writes, the expiry sweeper first. A backup
+       still copying is cancelled, prefetch walks are stopped. */
+    ops_warm_stop();
+    ops_backup_stop();
+    ops_ttl_stop();
+    ops_async_stop();
+    ops_group_stop();
+
+    /* Last sync of a NOSYNC env, while it is still open. */
+    ops_env_sync_stop();
+
+    /* Drop queued ops and the pool of the default batch. */
+    ops_batch_destroy(ops_batch_default());
+
+    /* Parked read txns hold reader slots of this env, abort them first. */
+    act_txn_ro_flush();
+
+    /* Cached values belong to this env. */
+    ops_vcache_reset();
+
+    /* Key filters go to their sidecars, stamped with the env as it is now. */
+    ops_bloom_close();
+
+    /* Indexes name DBIs of this env. */
+    ops_index_reset();
+
+    /* So do codecs and dictionaries. */
+    ops_zip_close();
 
     /* Best-effort: ask LMDB for the current mapsize. */
     if(DataBase->env)
@@ -13,6 +13,8 @@ unsigned int dbi_open_flags_from_type(dbi_type_t type)
 
     if(type & DBI_TYPE_DUPSORT) flags |= MDB_DUPSORT;
     if(type & DBI_TYPE_DUPFIXED) flags |= MDB_DUPFIXED;
+    if(type & DBI_TYPE_INTEGERKEY) flags |= MDB_INTEGERKEY;
+    if(type & DBI_TYPE_INTEGERDUP) flags |= MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP;
 
     return flags;
 }
@@ -26,3 +28,8 @@ unsigned int dbi_put_flags_from_type(dbi_type_t type)
 
     return 0U;
 }
+
+int dbi_int_size_ok(const size_t size)
+{
+    return size == sizeof(unsigned int) || size == sizeof(size_t);
+}
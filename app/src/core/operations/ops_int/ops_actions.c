@@ -1,8 +1,16 @@
 
 #include "ops_actions.h"
-#include <stddef.h> /* NULL */
-#include <string.h> /* memset, memcpy */
-#include "common.h" /* EML_* macros, LMDB_EML_* */
+#include <pthread.h>   /* pthread_key_t, pthread_once_t, pthread_mutex_t */
+#include <stdatomic.h> /* atomic_exchange, atomic_store */
+#include <limits.h>    /* UINT_MAX */
+#include <stddef.h>    /* NULL */
+#include <stdlib.h>    /* calloc, free */
+#include <string.h>    /* memset, memcpy */
+#include "common.h"    /* EML_* macros, LMDB_EML_* */
+#include "ops_bloom.h" /* ops_bloom_add, ops_bloom_maybe */
+#include "ops_stats.h" /* ops_stats_* */
+#include "ops_vcache.h" /* ops_vcache_get, ops_vcache_fill */
+#include "ops_zip.h"    /* ops_zip_on, ops_zip_pack, ops_zip_view */
 
 /****************************************************************************
  * PRIVATE DEFINES
@@ -15,13 +23,37 @@
  * PRIVATE STUCTURED VARIABLES
  ****************************************************************************
  */
-/* None */
+
+/**
+ * @brief Per-thread slot holding one parked (reset) read-only transaction.
+ *
+ * Slots are linked in a registry so that shutdown can abort the parked
+ * transactions of every thread before the environment is closed.
+ */
+typedef struct ro_txn_slot
+{
+    _Atomic(MDB_txn*)   txn;  /**< Parked txn, NULL when none (or in use). */
+    MDB_env*            env;  /**< Environment the parked txn belongs to. */
+    struct ro_txn_slot* prev; /**< Registry links. */
+    struct ro_txn_slot* next;
+} ro_txn_slot_t;
 
 /****************************************************************************
  * PRIVATE VARIABLES
  ****************************************************************************
  */
-/* None */
+
+/* Reuse parked RO txns (runtime toggle, see act_txn_ro_set_reuse) */
+static atomic_int ro_txn_reuse = DB_LMDB_RO_TXN_REUSE;
+
+/* Thread-specific slot key, created once */
+static pthread_once_t ro_txn_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t  ro_txn_key;
+static int            ro_txn_key_ok   = 0;
+
+/* Registry of all live slots */
+static pthread_mutex_t ro_txn_lock    = PTHREAD_MUTEX_INITIALIZER;
+static ro_txn_slot_t*  ro_txn_slots   = NULL;
 
 /****************************************************************************
  * PRIVATE FUNCTIONS PROTOTYPES
@@ -69,6 +101,42 @@ static inline MDB_val* _get_val(op_t* op)
 {
     return _resolve_desc(op, &op->val);
 }
+
+/**
+ * @brief Return the calling thread's parked-txn slot, creating it on demand.
+ */
+static ro_txn_slot_t* _ro_slot_get(void);
+
+/**
+ * @brief pthread key destructor: abort the parked txn and drop the slot.
+ */
+static void _ro_slot_free(void* arg);
+
+static void _ro_key_create(void);
+
+/**
+ * @brief Delete [key, val) of @p op with a single cursor walk.
+ */
+static db_security_ret_code_t _del_range(MDB_txn* txn, op_t* op, const dbi_t* dbi,
+                                         int* const out_err);
+
+/**
+ * @brief Check that cursor record @p k is still inside the scan bounds.
+ */
+static int _scan_in_bounds(MDB_txn* txn, const op_t* op, const MDB_val* k, const MDB_val* bound);
+
+/**
+ * @brief Hand one record to the scan callback or copy it into the page.
+ *
+ * @return 0 to continue, 1 to stop (page full / callback stop), negative
+ *         errno on failure.
+ */
+static int _scan_emit(db_scan_t* scan, const MDB_val* k, const MDB_val* v);
+
+/**
+ * @brief Decode the frame @p frame of a ZIP DBI into op->val, see act_get.
+ */
+static int _unpack(op_t* op, const MDB_val* frame, ops_arena_t* arena);
 /****************************************************************************
  * PUBLIC FUNCTIONS DEFINITIONS
  ****************************************************************************
@@ -84,7 +152,8 @@ db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, in
     }
 
     /* loosing const correctness */
-    int mdb_res = mdb_txn_begin(DataBase->env, NULL, flags, out_txn);
+    const uint64_t t0      = ops_stats_now();
+    int            mdb_res = mdb_txn_begin(DataBase->env, NULL, flags, out_txn);
 
     /* keep this light check to avoid jumping into 
     security_check on hot path */
@@ -93,6 +162,27 @@ db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, in
         EML_ERROR(LOG_TAG, "_txn_begin: mdb_txn_begin failed, mdb_rc=%d", mdb_res);
         return security_check(mdb_res, NULL, out_err);
     }
+    ops_stats_lat(DB_STATS_LAT_TXN_BEGIN, t0);
+    ops_stats_txn(flags & MDB_RDONLY);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_txn_nested_begin(MDB_txn* parent, MDB_txn** out_txn,
+                                            int* const out_err)
+{
+    /* Check input */
+    if(!DataBase || !DataBase->env || !parent || !out_txn)
+    {
+        EML_ERROR(LOG_TAG, "act_txn_nested_begin: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    int mdb_res = mdb_txn_begin(DataBase->env, parent, 0, out_txn);
+    if(mdb_res != 0)
+    {
+        EML_ERROR(LOG_TAG, "act_txn_nested_begin: mdb_txn_begin failed, mdb_rc=%d", mdb_res);
+        return security_check(mdb_res, NULL, out_err);
+    }
     return DB_SAFETY_SUCCESS;
 }
 
@@ -105,18 +195,102 @@ db_security_ret_code_t act_txn_commit(MDB_txn* const txn, int* const out_err)
         return DB_SAFETY_FAIL;
     }
 
-    int mdb_res = mdb_txn_commit(txn);
+    const uint64_t t0      = ops_stats_now();
+    int            mdb_res = mdb_txn_commit(txn);
     /* keep this light check to avoid jumping into 
     security_check on hot path */
     if(mdb_res != 0)
     {
         EML_ERROR(LOG_TAG, "_txn_commit: mdb_txn_commit failed, mdb_rc=%d", mdb_res);
-        return security_check(mdb_res, txn, out_err);
+        /* mdb_txn_commit frees the txn on failure too: never abort it */
+        return security_check(mdb_res, NULL, out_err);
     }
-    EML_DBG(LOG_TAG, "act_txn_commit: txn committed");
+    ops_stats_lat(DB_STATS_LAT_TXN_COMMIT, t0);
+    DB_HOT_DBG(LOG_TAG, "act_txn_commit: txn committed");
     return DB_SAFETY_SUCCESS;
 }
 
+db_security_ret_code_t act_txn_ro_begin(MDB_txn** out_txn, int* const out_err)
+{
+    /* Check input */
+    if(!DataBase || !DataBase->env || !out_txn)
+    {
+        EML_ERROR(LOG_TAG, "act_txn_ro_begin: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    ro_txn_slot_t* slot = atomic_load(&ro_txn_reuse) ? _ro_slot_get() : NULL;
+    if(slot)
+    {
+        /* Take the parked txn, if any; the slot stays empty while in use */
+        MDB_txn* parked = atomic_exchange(&slot->txn, NULL);
+        if(parked)
+        {
+            /* Renew grabs a reader slot and a fresh snapshot */
+            const uint64_t t0 = ops_stats_now();
+            if(slot->env == DataBase->env && mdb_txn_renew(parked) == MDB_SUCCESS)
+            {
+                ops_stats_lat(DB_STATS_LAT_TXN_BEGIN, t0);
+                ops_stats_txn(1);
+                *out_txn = parked;
+                return DB_SAFETY_SUCCESS;
+            }
+
+            /* Unusable: drop it and fall back to a fresh txn */
+            EML_WARN(LOG_TAG, "act_txn_ro_begin: parked txn not renewable, dropping it");
+            mdb_txn_abort(parked);
+        }
+    }
+
+    return act_txn_begin(out_txn, MDB_RDONLY, out_err);
+}
+
+void act_txn_ro_end(MDB_txn* txn)
+{
+    if(!txn) return;
+
+    ro_txn_slot_t* slot = atomic_load(&ro_txn_reuse) ? _ro_slot_get() : NULL;
+    if(slot && DataBase && atomic_load(&slot->txn) == NULL)
+    {
+        /* Release the snapshot and reader slot, keep the handle */
+        mdb_txn_reset(txn);
+        slot->env = DataBase->env;
+        atomic_store(&slot->txn, txn);
+        return;
+    }
+
+    mdb_txn_abort(txn);
+}
+
+void act_txn_ro_flush(void)
+{
+    pthread_mutex_lock(&ro_txn_lock);
+    for(ro_txn_slot_t* slot = ro_txn_slots; slot; slot = slot->next)
+    {
+        MDB_txn* parked = atomic_exchange(&slot->txn, NULL);
+        if(parked) mdb_txn_abort(parked);
+    }
+    pthread_mutex_unlock(&ro_txn_lock);
+}
+
+void act_txn_ro_set_reuse(const int enable)
+{
+    atomic_store(&ro_txn_reuse, enable ? 1 : 0);
+
+    /* Parked txns are useless once reuse is off */
+    if(!enable) act_txn_ro_flush();
+}
+
+MDB_val* act_op_key(op_t* op)
+{
+    return op ? _get_key(op) : NULL;
+}
+
+MDB_val* act_op_val(op_t* op)
+{
+    return op ? _get_val(op) : NULL;
+}
+
 db_security_ret_code_t act_put(MDB_txn* txn, op_t* op, int* const out_err)
 {
     /* Check input */
@@ -131,7 +305,7 @@ db_security_ret_code_t act_put(MDB_txn* txn, op_t* op, int* const out_err)
     if(!k_ptr)
     {
         EML_ERROR(LOG_TAG, "_op_get: failed to retrieve key");
-        return DB_SAFETY_FAIL;
+        return security_abort_txn(txn, -EINVAL, out_err);
     }
 
     /* Get val pointer */
@@ -139,20 +313,129 @@ db_security_ret_code_t act_put(MDB_txn* txn, op_t* op, int* const out_err)
     if(!v_ptr)
     {
         EML_ERROR(LOG_TAG, "_op_get: failed to retrieve val");
-        return DB_SAFETY_FAIL;
+        return security_abort_txn(txn, -EINVAL, out_err);
     }
 
     dbi_t* dbi = &DataBase->dbis[op->dbi];
+    ops_bloom_add(op->dbi, k_ptr->mv_data, k_ptr->mv_size);
+
+    /* ZIP DBIs store the frame of the value */
+    MDB_val frame;
+    if(ops_zip_on(op->dbi))
+    {
+        int rc = ops_zip_pack(op->dbi, v_ptr, &frame);
+        if(rc != 0) return security_abort_txn(txn, rc, out_err);
+        v_ptr = &frame;
+    }
 
     /* Put val */
-    /* DO NOT add MDB_RESERVE here */
+    /* DO NOT add MDB_RESERVE here, reserved puts go through act_put_reserve */
     /* Use the put flags in the Database */
     int mdb_res = mdb_put(txn, dbi->dbi, k_ptr, v_ptr, dbi->put_flags);
-    if(mdb_res != MDB_SUCCESS) return security_check(mdb_res, txn, out_err);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
     return DB_SAFETY_SUCCESS;
 }
 
-db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
+db_security_ret_code_t act_put_append(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                      int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !cur || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_put_append: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    MDB_val* k_ptr = _get_key(op);
+    MDB_val* v_ptr = _get_val(op);
+    if(!k_ptr || !v_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_put_append: failed to retrieve key/val");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    dbi_t* dbi     = &DataBase->dbis[op->dbi];
+    int    mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+    ops_bloom_add(op->dbi, k_ptr->mv_data, k_ptr->mv_size);
+
+    MDB_val frame;
+    if(ops_zip_on(op->dbi))
+    {
+        int rc = ops_zip_pack(op->dbi, v_ptr, &frame);
+        if(rc != 0) return security_abort_txn(txn, rc, out_err);
+        v_ptr = &frame;
+    }
+
+    const unsigned append = (op->flags & OP_FLAG_APPENDDUP) ? MDB_APPENDDUP : MDB_APPEND;
+    mdb_res = mdb_cursor_put(*cur, k_ptr, v_ptr, dbi->put_flags | append);
+
+    /* Not past the end after all: LMDB refused before touching the tree */
+    if(mdb_res == MDB_KEYEXIST)
+    {
+        DB_HOT_DBG(LOG_TAG, "act_put_append: append refused, plain put");
+        op->flags &= ~(unsigned)(OP_FLAG_APPEND | OP_FLAG_APPENDDUP);
+        mdb_res = mdb_cursor_put(*cur, k_ptr, v_ptr, dbi->put_flags);
+    }
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    return DB_SAFETY_SUCCESS;
+}
+
+int act_put_cmp(MDB_txn* txn, const op_t* a, const op_t* b)
+{
+    if(a->dbi != b->dbi) return (a->dbi < b->dbi) ? -2 : 2;
+
+    const dbi_t* dbi = &DataBase->dbis[a->dbi];
+
+    /* op_val_t is layout compatible with MDB_val */
+    int c = mdb_cmp(txn, dbi->dbi, (const MDB_val*)&a->key.present,
+                    (const MDB_val*)&b->key.present);
+    if(c) return (c < 0) ? -2 : 2;
+    if(!dbi->is_dupsort) return 0;
+
+    c = mdb_dcmp(txn, dbi->dbi, (const MDB_val*)&a->val.present,
+                 (const MDB_val*)&b->val.present);
+    return (c > 0) - (c < 0);
+}
+
+db_security_ret_code_t act_put_after_last(MDB_txn* txn, const op_t* op, MDB_cursor** cur,
+                                          int* const out_after, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !cur || !out_after || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_put_after_last: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    const dbi_t* dbi     = &DataBase->dbis[op->dbi];
+    int          mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    MDB_val last = { 0 };
+    MDB_val data = { 0 };
+    mdb_res      = mdb_cursor_get(*cur, &last, &data, MDB_LAST);
+    if(mdb_res == MDB_NOTFOUND)
+    {
+        /* Empty DBI: everything appends */
+        *out_after = 1;
+        return DB_SAFETY_SUCCESS;
+    }
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    *out_after = mdb_cmp(txn, dbi->dbi, (const MDB_val*)&op->key.present, &last) > 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, ops_arena_t* arena, int* const out_err)
 {
     /* Check input */
     if(!txn || !op)
@@ -166,7 +449,21 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
     if(!k_ptr)
     {
         EML_ERROR(LOG_TAG, "_op_get: failed to retrieve key");
-        return DB_SAFETY_FAIL;
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    /* Definitely absent: no B-tree descent either */
+    if(!ops_bloom_maybe(op->dbi, k_ptr->mv_data, k_ptr->mv_size))
+    {
+        return security_abort_txn(txn, -ENOENT, out_err);
+    }
+
+    /* Hot values are copied from the cache, no B-tree descent */
+    if(op->val.kind == OP_KEY_KIND_PRESENT &&
+       ops_vcache_get(op->dbi, k_ptr->mv_data, k_ptr->mv_size, op->val.present.ptr,
+                      &op->val.present.size, 1) == 0)
+    {
+        return DB_SAFETY_SUCCESS;
     }
 
     /* Get immediately the result, then decide what to do with it. */
@@ -175,6 +472,17 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
     int     mdb_res = mdb_get(txn, dbi->dbi, k_ptr, &tmp_val);
     if(mdb_res != 0) goto fail;
 
+    /* Frames are decoded straight into the user buffer or the arena */
+    if(ops_zip_on(op->dbi))
+    {
+        int rc = _unpack(op, &tmp_val, arena);
+        if(rc != 0) return security_abort_txn(txn, rc, out_err);
+        ops_vcache_fill(op->dbi, k_ptr->mv_data, k_ptr->mv_size, op->val.present.ptr,
+                        op->val.present.size);
+        return DB_SAFETY_SUCCESS;
+    }
+    ops_vcache_fill(op->dbi, k_ptr->mv_data, k_ptr->mv_size, tmp_val.mv_data, tmp_val.mv_size);
+
     /* use op->val.present which is layout-compatible with MDB_val.
     If the user gave an input value then use another to get the result and copy it */
     if(op->val.kind == OP_KEY_KIND_PRESENT)
@@ -184,7 +492,7 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
         {
             EML_ERROR(LOG_TAG, "_op_get: user buffer too small (buf_size=%zu needed=%zu)",
                       op->val.present.size, tmp_val.mv_size);
-            return DB_SAFETY_FAIL;
+            return security_abort_txn(txn, -ENOBUFS, out_err);
         }
 
         /* copy to user buffer */
@@ -205,7 +513,397 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
     return DB_SAFETY_SUCCESS;
 
 fail:
-    return security_check(mdb_res, txn, out_err);
+    if(mdb_res == MDB_NOTFOUND) ops_bloom_false_positive(op->dbi);
+    return security_fail_txn(mdb_res, txn, out_err);
+}
+
+db_security_ret_code_t act_del(MDB_txn* txn, op_t* op, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_del: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    dbi_t* dbi = &DataBase->dbis[op->dbi];
+
+    if(op->flags & OP_FLAG_RANGE) return _del_range(txn, op, dbi, out_err);
+
+    /* Get key pointer */
+    MDB_val* k_ptr = _get_key(op);
+    if(!k_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_del: failed to retrieve key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    /* Optional dup value: LMDB would silently ignore it on plain DBIs */
+    MDB_val* v_ptr = NULL;
+    if(op->val.kind != OP_KEY_KIND_NONE)
+    {
+        v_ptr = _get_val(op);
+        if(!v_ptr || !dbi->is_dupsort)
+        {
+            EML_ERROR(LOG_TAG, "act_del: bad dup value (val=%p dupsort=%u)", (void*)v_ptr,
+                      dbi->is_dupsort);
+            return security_abort_txn(txn, -EINVAL, out_err);
+        }
+    }
+
+    int mdb_res = mdb_del(txn, dbi->dbi, k_ptr, v_ptr);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_lst(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !op->scan || !cur || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_lst: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    db_scan_t* scan = op->scan;
+    dbi_t*     dbi  = &DataBase->dbis[op->dbi];
+
+    /* A retried attempt starts over */
+    scan->n_seen = 0;
+    scan->more   = 0;
+    if(scan->page)
+    {
+        scan->page->used    = 0;
+        scan->page->n_items = 0;
+    }
+
+    /* Resolve bounds: start is mandatory except for open ranges */
+    MDB_val* start = NULL;
+    MDB_val* bound = NULL;
+    if(op->key.kind != OP_KEY_KIND_NONE && !(start = _get_key(op)))
+    {
+        EML_ERROR(LOG_TAG, "act_lst: failed to retrieve start key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(!start && scan->mode != DB_SCAN_RANGE)
+    {
+        EML_ERROR(LOG_TAG, "act_lst: mode %d needs a key", (int)scan->mode);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(scan->mode == DB_SCAN_RANGE && op->val.kind != OP_KEY_KIND_NONE && !(bound = _get_val(op)))
+    {
+        EML_ERROR(LOG_TAG, "act_lst: failed to retrieve end key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(scan->mode == DB_SCAN_PREFIX) bound = start;
+
+    int mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* Position: exact key for DUPS, first key >= start otherwise */
+    MDB_val         k    = { 0 };
+    MDB_val         v    = { 0 };
+    MDB_cursor_op   step = (scan->mode == DB_SCAN_DUPS) ? MDB_NEXT_DUP : MDB_NEXT;
+    if(start) k = *start;
+    if(scan->mode == DB_SCAN_DUPS) mdb_res = mdb_cursor_get(*cur, &k, &v, MDB_SET_KEY);
+    else mdb_res = mdb_cursor_get(*cur, &k, &v, start ? MDB_SET_RANGE : MDB_FIRST);
+
+    while(mdb_res == MDB_SUCCESS && _scan_in_bounds(txn, op, &k, bound))
+    {
+        /* Limit reached with a record left: there is more */
+        if(scan->limit && scan->n_seen == scan->limit)
+        {
+            scan->more = 1;
+            break;
+        }
+
+        MDB_val plain = v;
+        int     rc    = ops_zip_on(op->dbi) ? ops_zip_view(op->dbi, &v, &plain) : 0;
+        if(rc == 0) rc = _scan_emit(scan, &k, &plain);
+        if(rc < 0)
+        {
+            EML_ERROR(LOG_TAG, "act_lst: record %zu rejected, err=%d", scan->n_seen, rc);
+            return security_abort_txn(txn, rc, out_err);
+        }
+        if(rc > 0)
+        {
+            scan->more = 1;
+            break;
+        }
+
+        mdb_res = mdb_cursor_get(*cur, &k, &v, step);
+    }
+
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        EML_ERROR(LOG_TAG, "act_lst: cursor walk failed after %zu records", scan->n_seen);
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    DB_HOT_DBG(LOG_TAG, "act_lst: %zu records (more=%d)", scan->n_seen, scan->more);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_get_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !op->multi || !cur || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_get_multiple: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    db_multi_t* multi = op->multi;
+    dbi_t*      dbi   = &DataBase->dbis[op->dbi];
+
+    /* A retried attempt starts over */
+    multi->elem_size = 0;
+    multi->n_items   = 0;
+    multi->more      = 0;
+
+    if(!dbi->is_dupfixed || !multi->buf)
+    {
+        EML_ERROR(LOG_TAG, "act_get_multiple: dbi %u is not DUPFIXED or no buffer", op->dbi);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    MDB_val* k_ptr = _get_key(op);
+    if(!k_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_get_multiple: failed to retrieve key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    int mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* Position on the key: its first dup gives the fixed size */
+    MDB_val k = *k_ptr;
+    MDB_val v = { 0 };
+    mdb_res   = mdb_cursor_get(*cur, &k, &v, MDB_SET_KEY);
+    if(mdb_res == MDB_SUCCESS)
+    {
+        multi->elem_size = v.mv_size;
+        mdb_res          = mdb_cursor_get(*cur, &k, &v, MDB_GET_MULTIPLE);
+    }
+
+    size_t used = 0;
+    while(mdb_res == MDB_SUCCESS)
+    {
+        /* Whole dups only: a chunk larger than the room left is cut */
+        size_t room = (multi->cap - used) / multi->elem_size * multi->elem_size;
+        size_t n    = (v.mv_size < room) ? v.mv_size : room;
+        memcpy((unsigned char*)multi->buf + used, v.mv_data, n);
+        used += n;
+        if(n < v.mv_size)
+        {
+            multi->more = 1;
+            break;
+        }
+
+        mdb_res = mdb_cursor_get(*cur, &k, &v, MDB_NEXT_MULTIPLE);
+    }
+
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        EML_ERROR(LOG_TAG, "act_get_multiple: cursor walk failed after %zu bytes", used);
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* Not even one dup fits: the caller must grow the buffer */
+    if(multi->more && used == 0) return security_abort_txn(txn, -ENOBUFS, out_err);
+
+    multi->n_items = multi->elem_size ? used / multi->elem_size : 0;
+
+    /* Leased views and later lookups see the packed array */
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = multi->buf;
+    op->val.present.size = used;
+
+    DB_HOT_DBG(LOG_TAG, "act_get_multiple: %zu dups of %zu bytes (more=%d)", multi->n_items,
+               multi->elem_size, multi->more);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_put_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !op->multi || !cur || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_put_multiple: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    const db_multi_t* multi = op->multi;
+    dbi_t*            dbi   = &DataBase->dbis[op->dbi];
+
+    if(!dbi->is_dupfixed || !multi->buf || multi->elem_size == 0 || multi->n_items == 0)
+    {
+        EML_ERROR(LOG_TAG, "act_put_multiple: dbi %u is not DUPFIXED or empty array", op->dbi);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    MDB_val* k_ptr = _get_key(op);
+    if(!k_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_put_multiple: failed to retrieve key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    ops_bloom_add(op->dbi, k_ptr->mv_data, k_ptr->mv_size);
+
+    int mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* LMDB takes the dup size from data[0] and the count from data[1] */
+    MDB_val data[2] = {
+        { multi->elem_size, multi->buf },
+        { multi->n_items, NULL },
+    };
+    mdb_res = mdb_cursor_put(*cur, k_ptr, data, dbi->put_flags | MDB_MULTIPLE);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    DB_HOT_DBG(LOG_TAG, "act_put_multiple: %zu dups of %zu bytes", data[1].mv_size,
+               multi->elem_size);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_put_reserve(MDB_txn* txn, op_t* op, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !op->reserve || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_put_reserve: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    const db_reserve_t* reserve = op->reserve;
+    dbi_t*              dbi     = &DataBase->dbis[op->dbi];
+
+    if(dbi->is_dupsort || !reserve->write || reserve->size == 0)
+    {
+        EML_ERROR(LOG_TAG, "act_put_reserve: dbi %u is DUPSORT or no writer", op->dbi);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(ops_zip_on(op->dbi))
+    {
+        EML_ERROR(LOG_TAG, "act_put_reserve: dbi %u holds frames, no in-place write", op->dbi);
+        return security_abort_txn(txn, -EOPNOTSUPP, out_err);
+    }
+
+    MDB_val* k_ptr = _get_key(op);
+    if(!k_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_put_reserve: failed to retrieve key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    ops_bloom_add(op->dbi, k_ptr->mv_data, k_ptr->mv_size);
+
+    /* LMDB returns the reserved bytes in v.mv_data */
+    MDB_val v       = { reserve->size, NULL };
+    int     mdb_res = mdb_put(txn, dbi->dbi, k_ptr, &v, dbi->put_flags | MDB_RESERVE);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Fill them now: the next write may move the page */
+    int rc = reserve->write(v.mv_data, v.mv_size, reserve->ctx);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "act_put_reserve: writer failed (%d)", rc);
+        return security_abort_txn(txn, rc < 0 ? rc : -ECANCELED, out_err);
+    }
+
+    DB_HOT_DBG(LOG_TAG, "act_put_reserve: %zu bytes written in place", v.mv_size);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_rep(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !op || !op->patch || !cur || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "act_rep: invalid input");
+        return DB_SAFETY_FAIL;
+    }
+
+    const db_patch_t* patch = op->patch;
+    dbi_t*            dbi   = &DataBase->dbis[op->dbi];
+
+    if(dbi->is_dupsort || (!patch->mutate && !patch->bytes))
+    {
+        EML_ERROR(LOG_TAG, "act_rep: dbi %u is DUPSORT or empty patch", op->dbi);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(ops_zip_on(op->dbi))
+    {
+        EML_ERROR(LOG_TAG, "act_rep: dbi %u holds frames, no in-place patch", op->dbi);
+        return security_abort_txn(txn, -EOPNOTSUPP, out_err);
+    }
+
+    MDB_val* k_ptr = _get_key(op);
+    if(!k_ptr)
+    {
+        EML_ERROR(LOG_TAG, "act_rep: failed to retrieve key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    int mdb_res = MDB_SUCCESS;
+    if(!*cur)
+    {
+        mdb_res = mdb_cursor_open(txn, dbi->dbi, cur);
+        if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* MDB_SET_KEY points the key into the page: the op keeps its own */
+    MDB_val k = *k_ptr;
+    MDB_val old;
+    mdb_res = mdb_cursor_get(*cur, &k, &old, MDB_SET_KEY);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    if(!patch->mutate && (patch->offset > old.mv_size || patch->size > old.mv_size - patch->offset))
+    {
+        EML_ERROR(LOG_TAG, "act_rep: patch [%zu, +%zu) past value of %zu bytes", patch->offset,
+                  patch->size, old.mv_size);
+        return security_abort_txn(txn, -ERANGE, out_err);
+    }
+
+    /* Same size: LMDB hands back the node in the now dirty page */
+    MDB_val cur_val = { old.mv_size, NULL };
+    mdb_res         = mdb_cursor_put(*cur, &k, &cur_val, MDB_CURRENT | MDB_RESERVE);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* An overflow value that was not dirty yet gets fresh pages: bring the
+    old bytes over from the clean pages, untouched until commit */
+    if(cur_val.mv_data != old.mv_data) memcpy(cur_val.mv_data, old.mv_data, old.mv_size);
+
+    if(patch->mutate)
+    {
+        int rc = patch->mutate(cur_val.mv_data, cur_val.mv_size, patch->ctx);
+        if(rc != 0)
+        {
+            EML_ERROR(LOG_TAG, "act_rep: mutate failed (%d)", rc);
+            return security_abort_txn(txn, rc < 0 ? rc : -ECANCELED, out_err);
+        }
+    }
+    else
+    {
+        memcpy((unsigned char*)cur_val.mv_data + patch->offset, patch->bytes, patch->size);
+    }
+
+    DB_HOT_DBG(LOG_TAG, "act_rep: patched value of %zu bytes", cur_val.mv_size);
+    return DB_SAFETY_SUCCESS;
 }
 
 /****************************************************************************
@@ -213,6 +911,220 @@ fail:
  ****************************************************************************
  */
 
+static int _scan_in_bounds(MDB_txn* txn, const op_t* op, const MDB_val* k, const MDB_val* bound)
+{
+    if(!bound) return 1;
+
+    switch(op->scan->mode)
+    {
+        case DB_SCAN_RANGE:
+            return mdb_cmp(txn, DataBase->dbis[op->dbi].dbi, k, bound) < 0;
+        case DB_SCAN_PREFIX:
+            return k->mv_size >= bound->mv_size &&
+                   memcmp(k->mv_data, bound->mv_data, bound->mv_size) == 0;
+        default:
+            /* DUPS: MDB_NEXT_DUP never leaves the key */
+            return 1;
+    }
+}
+
+static int _scan_emit(db_scan_t* scan, const MDB_val* k, const MDB_val* v)
+{
+    if(scan->cb)
+    {
+        const db_view_t kv = { k->mv_size, k->mv_data };
+        const db_view_t vv = { v->mv_size, v->mv_data };
+
+        int rc = scan->cb(&kv, &vv, scan->ctx);
+        if(rc < 0) return rc;
+        scan->n_seen++;
+        return rc > 0;
+    }
+
+    db_scan_page_t* page = scan->page;
+    if(!page || !page->buf)
+    {
+        EML_ERROR(LOG_TAG, "_scan_emit: scan has neither callback nor page");
+        return -EINVAL;
+    }
+
+    /* Header + key + val, rounded up to keep headers aligned */
+    size_t rec = sizeof(db_scan_rec_t) + k->mv_size + v->mv_size;
+    rec        = (rec + 7u) & ~(size_t)7u;
+    if(k->mv_size > UINT_MAX || v->mv_size > UINT_MAX || rec > page->cap - page->used)
+    {
+        /* Not even one record fits: the caller must grow the page */
+        if(page->n_items == 0) return -ENOBUFS;
+        return 1;
+    }
+
+    unsigned char* dst = (unsigned char*)page->buf + page->used;
+    db_scan_rec_t  hdr = { (unsigned int)k->mv_size, (unsigned int)v->mv_size };
+    memcpy(dst, &hdr, sizeof(hdr));
+    memcpy(dst + sizeof(hdr), k->mv_data, k->mv_size);
+    memcpy(dst + sizeof(hdr) + k->mv_size, v->mv_data, v->mv_size);
+
+    page->used += rec;
+    page->n_items++;
+    scan->n_seen++;
+    return 0;
+}
+
+static int _unpack(op_t* op, const MDB_val* frame, ops_arena_t* arena)
+{
+    size_t size = 0;
+    int    rc   = ops_zip_size(frame, &size);
+    if(rc != 0) return rc;
+
+    if(op->val.kind == OP_KEY_KIND_PRESENT)
+    {
+        if(size > op->val.present.size)
+        {
+            EML_ERROR(LOG_TAG, "_unpack: user buffer too small (buf_size=%zu needed=%zu)",
+                      op->val.present.size, size);
+            return -ENOBUFS;
+        }
+        rc = ops_zip_unpack(op->dbi, frame, op->val.present.ptr, size);
+        if(rc == 0) op->val.present.size = size;
+        return rc;
+    }
+
+    /* No user buffer: raw frames are viewed in the map like plain values,
+    compressed ones need memory that lives as long as the batch */
+    MDB_val view;
+    if(!arena)
+    {
+        rc = ops_zip_view(op->dbi, frame, &view);
+        if(rc != 0) return rc;
+        if(view.mv_data != (unsigned char*)frame->mv_data + 1)
+        {
+            EML_ERROR(LOG_TAG, "_unpack: compressed value in dbi %u needs a buffer", op->dbi);
+            return -ENOBUFS;
+        }
+    }
+    else
+    {
+        view.mv_size = size;
+        view.mv_data = ops_arena_alloc(arena, size ? size : 1u);
+        if(!view.mv_data) return -ENOMEM;
+        rc = ops_zip_unpack(op->dbi, frame, view.mv_data, size);
+        if(rc != 0) return rc;
+    }
+
+    op->val.kind    = OP_KEY_KIND_PRESENT;
+    op->val.present = *((op_val_t*)&view);
+    return 0;
+}
+
+static db_security_ret_code_t _del_range(MDB_txn* txn, op_t* op, const dbi_t* dbi,
+                                         int* const out_err)
+{
+    /* NONE bounds are open ends, anything else has to resolve */
+    MDB_val* start = NULL;
+    MDB_val* end   = NULL;
+    if(op->key.kind != OP_KEY_KIND_NONE && !(start = _get_key(op)))
+    {
+        EML_ERROR(LOG_TAG, "_del_range: failed to retrieve start key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+    if(op->val.kind != OP_KEY_KIND_NONE && !(end = _get_val(op)))
+    {
+        EML_ERROR(LOG_TAG, "_del_range: failed to retrieve end key");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    MDB_cursor* cur     = NULL;
+    int         mdb_res = mdb_cursor_open(txn, dbi->dbi, &cur);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Position on the first key >= start */
+    MDB_val k = { 0 };
+    MDB_val v = { 0 };
+    if(start) k = *start;
+    mdb_res = mdb_cursor_get(cur, &k, &v, start ? MDB_SET_RANGE : MDB_FIRST);
+
+    /* After mdb_cursor_del the cursor already sits on the next item,
+    MDB_NEXT then returns that item */
+    size_t n_del = 0;
+    while(mdb_res == MDB_SUCCESS)
+    {
+        if(end && mdb_cmp(txn, dbi->dbi, &k, end) >= 0) break;
+
+        mdb_res = mdb_cursor_del(cur, dbi->is_dupsort ? MDB_NODUPDATA : 0);
+        if(mdb_res != MDB_SUCCESS) break;
+        n_del++;
+
+        mdb_res = mdb_cursor_get(cur, &k, &v, MDB_NEXT);
+    }
+    mdb_cursor_close(cur);
+
+    /* Running off the end of the DBI is the normal way out */
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        EML_ERROR(LOG_TAG, "_del_range: cursor walk failed after %zu deletes", n_del);
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    DB_HOT_DBG(LOG_TAG, "_del_range: deleted %zu keys", n_del);
+    return DB_SAFETY_SUCCESS;
+}
+
+static void _ro_key_create(void)
+{
+    ro_txn_key_ok = (pthread_key_create(&ro_txn_key, _ro_slot_free) == 0);
+    if(!ro_txn_key_ok) EML_ERROR(LOG_TAG, "_ro_key_create: pthread_key_create failed");
+}
+
+static ro_txn_slot_t* _ro_slot_get(void)
+{
+    pthread_once(&ro_txn_key_once, _ro_key_create);
+    if(!ro_txn_key_ok) return NULL;
+
+    ro_txn_slot_t* slot = pthread_getspecific(ro_txn_key);
+    if(slot) return slot;
+
+    slot = calloc(1, sizeof(ro_txn_slot_t));
+    if(!slot)
+    {
+        EML_ERROR(LOG_TAG, "_ro_slot_get: calloc(slot) failed");
+        return NULL;
+    }
+
+    if(pthread_setspecific(ro_txn_key, slot) != 0)
+    {
+        EML_ERROR(LOG_TAG, "_ro_slot_get: pthread_setspecific failed");
+        free(slot);
+        return NULL;
+    }
+
+    /* Register for shutdown */
+    pthread_mutex_lock(&ro_txn_lock);
+    slot->next = ro_txn_slots;
+    if(ro_txn_slots) ro_txn_slots->prev = slot;
+    ro_txn_slots = slot;
+    pthread_mutex_unlock(&ro_txn_lock);
+
+    return slot;
+}
+
+static void _ro_slot_free(void* arg)
+{
+    ro_txn_slot_t* slot = arg;
+    if(!slot) return;
+
+    pthread_mutex_lock(&ro_txn_lock);
+    if(slot->prev) slot->prev->next = slot->next;
+    else ro_txn_slots = slot->next;
+    if(slot->next) slot->next->prev = slot->prev;
+    pthread_mutex_unlock(&ro_txn_lock);
+
+    /* MDB_NOTLS: a txn may be aborted from any thread */
+    MDB_txn* parked = atomic_exchange(&slot->txn, NULL);
+    if(parked) mdb_txn_abort(parked);
+
+    free(slot);
+}
+
 static MDB_val* _resolve_desc(op_t* base, op_key_t* desc)
 {
     if(!base || !desc)
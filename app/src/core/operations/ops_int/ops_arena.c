@@ -0,0 +1,194 @@
+/**
+ * @file ops_arena.c
+ *
+ */
+
+#include <stdalign.h> /* alignof */
+#include <stddef.h>   /* max_align_t */
+#include <stdlib.h>   /* malloc, free */
+#include <string.h>   /* memset */
+
+#include "common.h" /* EML_* macros, DB_LMDB_RW_OPS_CACHE_SIZE */
+#include "ops_arena.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG         "ops_arena"
+
+/* Alignment of every allocation */
+#define OPS_ARENA_ALIGN alignof(max_align_t)
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+struct ops_arena_slab
+{
+    ops_arena_slab_t* next; /**< Next slab in the chain. */
+    size_t            cap;  /**< Usable bytes in data. */
+    size_t            off;  /**< Bytes already handed out from data. */
+    alignas(OPS_ARENA_ALIGN) unsigned char data[]; /**< Slab payload. */
+};
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static ops_arena_slab_t* _slab_new(size_t cap);
+
+static inline size_t _align_up(size_t size)
+{
+    return (size + (OPS_ARENA_ALIGN - 1)) & ~(size_t)(OPS_ARENA_ALIGN - 1);
+}
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+void* ops_arena_alloc(ops_arena_t* arena, size_t size)
+{
+    if(!arena || size == 0) return NULL;
+
+    size_t need = _align_up(size);
+    if(need < size)
+    {
+        EML_ERROR(LOG_TAG, "ops_arena_alloc: size overflow (size=%zu)", size);
+        return NULL;
+    }
+
+    /* Fast path: fits in the current slab */
+    ops_arena_slab_t* slab = arena->cur;
+    if(slab && need <= slab->cap - slab->off) goto carve;
+
+    /* Reuse the next slab of the chain if it is large enough */
+    if(slab && slab->next && need <= slab->next->cap)
+    {
+        slab      = slab->next;
+        slab->off = 0;
+        goto carve;
+    }
+
+    /* Link a new slab after the current one: at least the configured size,
+    and at least double the current one so long batches converge quickly */
+    size_t cap = arena->slab_size ? arena->slab_size : DB_LMDB_RW_OPS_CACHE_SIZE;
+    if(slab && cap < slab->cap * 2) cap = slab->cap * 2;
+    if(cap < need) cap = need;
+
+    ops_arena_slab_t* fresh = _slab_new(cap);
+    if(!fresh) return NULL;
+
+    if(slab)
+    {
+        fresh->next = slab->next;
+        slab->next  = fresh;
+    }
+    else
+    {
+        fresh->next = arena->head;
+        arena->head = fresh;
+    }
+    slab = fresh;
+
+carve:
+{
+    void* dst = slab->data + slab->off;
+    slab->off += need;
+    arena->cur = slab;
+    arena->used += need;
+    return dst;
+}
+}
+
+void ops_arena_reset(ops_arena_t* arena)
+{
+    if(!arena) return;
+
+    /* Only the head offset is rewound here, later slabs are rewound
+    lazily when ops_arena_alloc moves onto them */
+    if(arena->head) arena->head->off = 0;
+    arena->cur  = arena->head;
+    arena->used = 0;
+}
+
+ops_arena_mark_t ops_arena_mark(const ops_arena_t* arena)
+{
+    ops_arena_mark_t mark = { 0 };
+    if(!arena) return mark;
+
+    mark.cur  = arena->cur;
+    mark.off  = arena->cur ? arena->cur->off : 0;
+    mark.used = arena->used;
+    return mark;
+}
+
+void ops_arena_rewind(ops_arena_t* arena, const ops_arena_mark_t* mark)
+{
+    if(!arena || !mark) return;
+
+    /* Nothing was allocated at the mark: same as a reset */
+    if(!mark->cur)
+    {
+        ops_arena_reset(arena);
+        return;
+    }
+
+    /* Slabs after the mark's are rewound lazily, as after a reset */
+    mark->cur->off = mark->off;
+    arena->cur     = mark->cur;
+    arena->used    = mark->used;
+}
+
+void ops_arena_release(ops_arena_t* arena)
+{
+    if(!arena) return;
+
+    ops_arena_slab_t* slab = arena->head;
+    while(slab)
+    {
+        ops_arena_slab_t* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    memset(arena, 0, sizeof(ops_arena_t));
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static ops_arena_slab_t* _slab_new(size_t cap)
+{
+    if(cap > (size_t)-1 - sizeof(ops_arena_slab_t))
+    {
+        EML_ERROR(LOG_TAG, "_slab_new: slab size overflow (cap=%zu)", cap);
+        return NULL;
+    }
+
+    ops_arena_slab_t* slab = malloc(sizeof(ops_arena_slab_t) + cap);
+    if(!slab)
+    {
+        EML_ERROR(LOG_TAG, "_slab_new: malloc(%zu) failed", cap);
+        return NULL;
+    }
+
+    slab->next = NULL;
+    slab->cap  = cap;
+    slab->off  = 0;
+
+    EML_DBG(LOG_TAG, "_slab_new: new slab of %zu bytes", cap);
+    return slab;
+}
@@ -0,0 +1,436 @@
+/**
+ * @file ops_async.c
+ *
+ */
+
+#include <errno.h>       /* EAGAIN, EALREADY, EINTR, EINVAL, EIO, ENOMEM, ENOTCONN */
+#include <pthread.h>     /* pthread_* */
+#include <stdint.h>      /* uint64_t */
+#include <stdlib.h>      /* calloc, free */
+#include <sys/eventfd.h> /* eventfd */
+#include <unistd.h>      /* read, write, close */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_ASYNC_* */
+#include "db.h"     /* DataBase */
+#include "ops_async.h"
+#include "ops_group.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_async"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief One job slot: free, queued for a worker, executing or completed.
+ */
+typedef struct async_job
+{
+    struct async_job* next;  /**< Free list, run queue or completion queue link. */
+    batch_t*          batch; /**< Submitted batch. */
+    db_async_cb_t     cb;    /**< Completion callback, NULL for the completion queue. */
+    void*             ctx;   /**< Context of cb, or returned by poll. */
+    int               res;   /**< Result, once completed. */
+} async_job_t;
+
+typedef struct
+{
+    pthread_mutex_t  lock;
+    pthread_cond_t   work;      /**< Signaled on a queued job, broadcast on quit. */
+    pthread_cond_t   idle;      /**< Signaled when executing drops to 0. */
+    async_job_t*     jobs;      /**< Slot pool, depth entries. */
+    async_job_t*     free_list; /**< Unused slots. */
+    async_job_t*     run_head;  /**< FIFO of jobs waiting for a worker. */
+    async_job_t*     run_tail;
+    async_job_t*     cq_head;   /**< FIFO of completions waiting for poll. */
+    async_job_t*     cq_tail;
+    pthread_t*       threads;   /**< Workers. */
+    size_t           n_threads; /**< Workers started. */
+    size_t           depth;     /**< Slots in the pool. */
+    size_t           used;      /**< Slots out of the free list. */
+    size_t           executing; /**< Jobs submitted and not completed yet. */
+    int              running;   /**< Submits accepted. */
+    int              quit;      /**< Workers exit once the run queue is empty. */
+    int              efd;       /**< Completion eventfd, -1 when not asked for. */
+    db_async_stats_t stats;
+} async_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+static async_t async = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work = PTHREAD_COND_INITIALIZER,
+    .idle = PTHREAD_COND_INITIALIZER,
+    .efd  = -1,
+};
+
+/* Serializes start and stop */
+static pthread_mutex_t async_ctl = PTHREAD_MUTEX_INITIALIZER;
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static void* _worker_main(void* arg);
+
+/**
+ * @brief Completion of a write batch run by the group writer.
+ */
+static void _group_done(batch_t* batch, int res, void* ctx);
+
+/**
+ * @brief Hand the result of @p job to its callback or to the completion queue.
+ */
+static void _complete(async_job_t* job, const int res);
+
+/**
+ * @brief Give @p job back to the pool. Lock held.
+ */
+static void _release(async_job_t* job);
+
+/**
+ * @brief Quit and join the workers, free the pool and the eventfd. Control lock held.
+ */
+static void _teardown(void);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_async_start(const db_async_cfg_t* cfg)
+{
+    if(!DataBase || !DataBase->env)
+    {
+        EML_ERROR(LOG_TAG, "ops_async_start: database not initialized");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&async_ctl);
+
+    pthread_mutex_lock(&async.lock);
+    int running = async.running;
+    pthread_mutex_unlock(&async.lock);
+    if(running)
+    {
+        pthread_mutex_unlock(&async_ctl);
+        EML_ERROR(LOG_TAG, "ops_async_start: already running");
+        return -EALREADY;
+    }
+
+    size_t readers = (cfg && cfg->readers) ? cfg->readers : DB_LMDB_ASYNC_READERS;
+    size_t depth   = (cfg && cfg->depth) ? cfg->depth : DB_LMDB_ASYNC_DEPTH;
+
+    async.jobs    = calloc(depth, sizeof(async_job_t));
+    async.threads = calloc(readers, sizeof(pthread_t));
+    if(!async.jobs || !async.threads)
+    {
+        _teardown();
+        pthread_mutex_unlock(&async_ctl);
+        EML_ERROR(LOG_TAG, "ops_async_start: calloc(%zu slots, %zu workers) failed", depth,
+                  readers);
+        return -ENOMEM;
+    }
+
+    async.free_list = NULL;
+    for(size_t i = depth; i > 0; i--)
+    {
+        async.jobs[i - 1].next = async.free_list;
+        async.free_list        = &async.jobs[i - 1];
+    }
+    async.run_head  = async.run_tail = NULL;
+    async.cq_head   = async.cq_tail  = NULL;
+    async.depth     = depth;
+    async.used      = 0;
+    async.executing = 0;
+    async.quit      = 0;
+    async.stats     = (db_async_stats_t){0};
+
+    if(cfg && cfg->eventfd)
+    {
+        async.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if(async.efd < 0)
+        {
+            int err = errno;
+            _teardown();
+            pthread_mutex_unlock(&async_ctl);
+            EML_ERROR(LOG_TAG, "ops_async_start: eventfd failed (%d)", err);
+            return -err;
+        }
+    }
+
+    for(size_t i = 0; i < readers; i++)
+    {
+        int rc = pthread_create(&async.threads[i], NULL, _worker_main, NULL);
+        if(rc != 0)
+        {
+            _teardown();
+            pthread_mutex_unlock(&async_ctl);
+            EML_ERROR(LOG_TAG, "ops_async_start: pthread_create failed (%d)", rc);
+            return -rc;
+        }
+        async.n_threads++;
+    }
+
+    pthread_mutex_lock(&async.lock);
+    async.running = 1;
+    pthread_mutex_unlock(&async.lock);
+
+    pthread_mutex_unlock(&async_ctl);
+    EML_INFO(LOG_TAG, "ops_async_start: %zu workers, %zu slots%s", readers, depth,
+             async.efd >= 0 ? ", eventfd" : "");
+    return 0;
+}
+
+int ops_async_submit(batch_t* batch, db_async_cb_t cb, void* ctx)
+{
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_async_submit: invalid input");
+        return -EINVAL;
+    }
+
+    int writes = ops_batch_has_writes(batch);
+
+    pthread_mutex_lock(&async.lock);
+    if(!async.running)
+    {
+        pthread_mutex_unlock(&async.lock);
+        return -ENOTCONN;
+    }
+
+    async_job_t* job = async.free_list;
+    if(!job)
+    {
+        async.stats.rejected++;
+        pthread_mutex_unlock(&async.lock);
+        return -EAGAIN;
+    }
+    async.free_list = job->next;
+    job->next       = NULL;
+    job->batch      = batch;
+    job->cb         = cb;
+    job->ctx        = ctx;
+    job->res        = -EIO;
+
+    async.used++;
+    async.executing++;
+    async.stats.submitted++;
+    if(async.used > async.stats.peak_inflight) async.stats.peak_inflight = async.used;
+    if(writes) async.stats.writes++;
+    else async.stats.reads++;
+
+    if(writes)
+    {
+        /* Merged into the writer's next txn; without it, a worker runs it alone */
+        pthread_mutex_unlock(&async.lock);
+        if(ops_group_submit_async(batch, _group_done, job) == 0) return 0;
+        pthread_mutex_lock(&async.lock);
+    }
+
+    if(async.run_tail) async.run_tail->next = job;
+    else async.run_head = job;
+    async.run_tail = job;
+    pthread_cond_signal(&async.work);
+
+    pthread_mutex_unlock(&async.lock);
+    return 0;
+}
+
+int ops_async_poll(db_async_done_t* out, const size_t max)
+{
+    if(!out && max)
+    {
+        EML_ERROR(LOG_TAG, "ops_async_poll: invalid input");
+        return -EINVAL;
+    }
+
+    int n = 0;
+
+    pthread_mutex_lock(&async.lock);
+    while(async.cq_head && (size_t)n < max)
+    {
+        async_job_t* job = async.cq_head;
+        async.cq_head    = job->next;
+        if(!async.cq_head) async.cq_tail = NULL;
+
+        out[n].batch = job->batch;
+        out[n].res   = job->res;
+        out[n].ctx   = job->ctx;
+        n++;
+        _release(job);
+    }
+
+    /* Writes happen under the lock too: an empty queue means a zero counter */
+    if(!async.cq_head && async.efd >= 0)
+    {
+        uint64_t v;
+        while(read(async.efd, &v, sizeof(v)) < 0 && errno == EINTR)
+        {
+        }
+    }
+    pthread_mutex_unlock(&async.lock);
+
+    return n;
+}
+
+int ops_async_fd(void)
+{
+    pthread_mutex_lock(&async.lock);
+    int fd = async.efd;
+    pthread_mutex_unlock(&async.lock);
+    return fd;
+}
+
+void ops_async_stop(void)
+{
+    pthread_mutex_lock(&async_ctl);
+
+    pthread_mutex_lock(&async.lock);
+    if(!async.running)
+    {
+        pthread_mutex_unlock(&async.lock);
+        pthread_mutex_unlock(&async_ctl);
+        return;
+    }
+
+    /* No new jobs; those queued or at the group writer still complete */
+    async.running = 0;
+    while(async.executing > 0) pthread_cond_wait(&async.idle, &async.lock);
+    size_t dropped   = async.used;
+    size_t completed = async.stats.completed;
+    pthread_mutex_unlock(&async.lock);
+
+    _teardown();
+
+    pthread_mutex_unlock(&async_ctl);
+    if(dropped)
+    {
+        EML_WARN(LOG_TAG, "ops_async_stop: %zu completions never polled", dropped);
+    }
+    EML_INFO(LOG_TAG, "ops_async_stop: workers down after %zu batches", completed);
+}
+
+void ops_async_stats(db_async_stats_t* out)
+{
+    if(!out) return;
+
+    pthread_mutex_lock(&async.lock);
+    *out = async.stats;
+    pthread_mutex_unlock(&async.lock);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void* _worker_main(void* arg)
+{
+    (void)arg;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&async.lock);
+        while(!async.run_head && !async.quit) pthread_cond_wait(&async.work, &async.lock);
+
+        async_job_t* job = async.run_head;
+        if(!job)
+        {
+            pthread_mutex_unlock(&async.lock);
+            break;
+        }
+        async.run_head = job->next;
+        if(!async.run_head) async.run_tail = NULL;
+        job->next = NULL;
+        pthread_mutex_unlock(&async.lock);
+
+        /* Reads renew this thread's parked txn, see act_txn_ro_begin */
+        _complete(job, ops_execute_operations(job->batch));
+    }
+
+    return NULL;
+}
+
+static void _group_done(batch_t* batch, int res, void* ctx)
+{
+    (void)batch;
+    _complete(ctx, res);
+}
+
+static void _complete(async_job_t* job, const int res)
+{
+    job->res = res;
+
+    /* Outside the lock: the callback may submit again */
+    if(job->cb) job->cb(job->batch, res, job->ctx);
+
+    pthread_mutex_lock(&async.lock);
+    async.stats.completed++;
+    if(res != 0) async.stats.failed++;
+
+    if(job->cb)
+    {
+        _release(job);
+    }
+    else
+    {
+        if(async.cq_tail) async.cq_tail->next = job;
+        else async.cq_head = job;
+        async.cq_tail = job;
+
+        if(async.efd >= 0)
+        {
+            uint64_t one = 1;
+            if(write(async.efd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+            {
+                EML_WARN(LOG_TAG, "_complete: eventfd write failed (%d)", errno);
+            }
+        }
+    }
+
+    if(--async.executing == 0) pthread_cond_broadcast(&async.idle);
+    pthread_mutex_unlock(&async.lock);
+}
+
+static void _release(async_job_t* job)
+{
+    job->next       = async.free_list;
+    job->batch      = NULL;
+    async.free_list = job;
+    async.used--;
+}
+
+static void _teardown(void)
+{
+    pthread_mutex_lock(&async.lock);
+    async.quit = 1;
+    pthread_cond_broadcast(&async.work);
+    pthread_mutex_unlock(&async.lock);
+
+    for(size_t i = 0; i < async.n_threads; i++) pthread_join(async.threads[i], NULL);
+
+    pthread_mutex_lock(&async.lock);
+    free(async.threads);
+    free(async.jobs);
+    async.threads   = NULL;
+    async.jobs      = NULL;
+    async.n_threads = 0;
+    async.free_list = NULL;
+    async.run_head  = async.run_tail = NULL;
+    async.cq_head   = async.cq_tail  = NULL;
+    async.used      = 0;
+    if(async.efd >= 0) close(async.efd);
+    async.efd = -1;
+    pthread_mutex_unlock(&async.lock);
+}
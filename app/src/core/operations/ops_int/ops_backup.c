@@ -0,0 +1,548 @@
+/**
+ * @file ops_backup.c
+ *
+ */
+
+#include <errno.h>     /* EALREADY, ECANCELED, EINTR, EINVAL, EIO, ENOENT, ENOMEM */
+#include <fcntl.h>     /* fcntl, FD_CLOEXEC, F_SETPIPE_SZ */
+#include <pthread.h>   /* pthread_* */
+#include <signal.h>    /* sigset_t, SIGPIPE */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint64_t, SIZE_MAX */
+#include <stdlib.h>    /* malloc, free */
+#include <string.h>    /* memset */
+#include <time.h>      /* clock_gettime, nanosleep */
+#include <unistd.h>    /* pipe, read, write, close */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_BACKUP_* */
+#include "db.h"     /* DataBase */
+#include "ops_backup.h"
+#include "ops_internals.h"
+#include "ops_map.h"
+#include "ops_util.h" /* ops_errno */
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG               "ops_backup"
+
+/* LMDB keeps the freelist in DBI 0 */
+#define BACKUP_FREE_DBI       0u
+
+/* Meta pages at the head of every copy */
+#define BACKUP_META_PAGES     2u
+
+/* Longest sleep of the throttle, so that a stop is seen quickly */
+#define BACKUP_SLEEP_SLICE_MS 100u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+typedef struct
+{
+    pthread_mutex_t         lock;      /**< Serializes start, wait and stop. */
+    pthread_t               pump;      /**< Reads the pipe, writes the fd. */
+    pthread_t               copier;    /**< Runs mdb_env_copyfd2 into the pipe. */
+    int                     started;   /**< pump not joined yet. */
+    int                     ever;      /**< A backup was started since init. */
+    int                     fd;        /**< Destination, the caller's. */
+    int                     pipe_rd;   /**< Pump side of the pipe. */
+    int                     pipe_wr;   /**< Copier side of the pipe. */
+    unsigned                flags;     /**< db_backup_flag_t bits. */
+    unsigned                rate_mb_s; /**< Throttle, 0 for none. */
+    db_backup_progress_cb_t progress;  /**< Progress callback. */
+    void*                   ctx;       /**< Context of progress. */
+    int                     copy_rc;   /**< mdb_env_copyfd2 result, read after the join. */
+    atomic_int              cancel;    /**< Stop asked. */
+    atomic_int              running;   /**< Copy in progress. */
+    atomic_int              res;       /**< Result of the last finished backup. */
+    atomic_size_t           written;   /**< Bytes written to fd. */
+    atomic_size_t           total;     /**< Size estimated at start. */
+    atomic_size_t           backups;   /**< Backups finished. */
+    atomic_size_t           reserved;  /**< Map bytes grown before the copy. */
+    atomic_size_t           headroom;  /**< Map bytes free when the copy began. */
+    atomic_size_t           deferred;  /**< Map growths put off during the copy. */
+    atomic_size_t           defer0;    /**< Map deferred counter when the copy began. */
+    atomic_size_t           refused;   /**< MAP_FULL growths refused during the copy. */
+    atomic_size_t           refuse0;   /**< Map full_refused counter when the copy began. */
+    atomic_int              copying;   /**< Copy holds the map gate. */
+    atomic_uint_fast64_t    t_start;   /**< Start, monotonic ms. */
+    atomic_uint_fast64_t    t_end;     /**< End, monotonic ms. */
+} backup_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+static backup_t backup = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static void* _pump_main(void* arg);
+
+static void* _copy_main(void* arg);
+
+/**
+ * @brief Write all of @p buf to the destination, retrying short writes.
+ */
+static int _write_all(const void* buf, size_t size);
+
+/**
+ * @brief Sleep until @p written bytes are due at the configured rate.
+ *
+ * @return 0, -ECANCELED when stopped meanwhile.
+ */
+static int _throttle(const size_t written);
+
+/**
+ * @brief Default headroom: one DB_LMDB_BACKUP_HEADROOM per
+ *        DB_LMDB_BACKUP_HEADROOM_S seconds the copy of @p total bytes
+ *        takes at @p rate_mb_s, at least one.
+ */
+static size_t _headroom(const size_t total, const unsigned rate_mb_s);
+
+/**
+ * @brief Grow the map to @p headroom bytes past the data of @p sp, capped.
+ *
+ * @return Bytes the map grew by, 0 when it was large enough or could not grow.
+ */
+static size_t _reserve(const db_space_stats_t* sp, const size_t headroom);
+
+/**
+ * @brief Map growths put off, and MAP_FULL growths refused, since the copy began.
+ */
+static void _map_since(size_t* out_deferred, size_t* out_refused);
+
+static uint64_t _now_ms(void);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_backup_start(const int fd, const db_backup_cfg_t* cfg)
+{
+    const db_backup_cfg_t none = { 0 };
+    if(!cfg) cfg = &none;
+
+    if(fd < 0 || (cfg->flags & ~(unsigned)DB_BACKUP_COMPACT) || !(DataBase && DataBase->env))
+    {
+        EML_ERROR(LOG_TAG, "ops_backup_start: invalid input");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&backup.lock);
+    if(atomic_load(&backup.running))
+    {
+        pthread_mutex_unlock(&backup.lock);
+        EML_ERROR(LOG_TAG, "ops_backup_start: a backup is running");
+        return -EALREADY;
+    }
+
+    /* Finished but never waited for */
+    if(backup.started)
+    {
+        pthread_join(backup.pump, NULL);
+        backup.started = 0;
+    }
+
+    /* Progress is measured against the expected size */
+    db_space_stats_t sp;
+    size_t           total    = 0;
+    size_t           reserved = 0;
+    size_t           headroom = 0;
+    if(ops_backup_space(&sp) == 0)
+    {
+        total = (cfg->flags & DB_BACKUP_COMPACT) ? sp.compact_bytes : sp.pages_last * sp.page_size;
+
+        /* The copy holds the map: writes meanwhile live on this headroom,
+        the longer a throttled copy the more of it */
+        reserved = _reserve(&sp, cfg->headroom ? cfg->headroom : _headroom(total, cfg->rate_mb_s));
+        headroom = sp.map_size + reserved - sp.pages_last * sp.page_size;
+    }
+
+    int p[2];
+    if(pipe(p) != 0)
+    {
+        int err = errno;
+        pthread_mutex_unlock(&backup.lock);
+        EML_ERROR(LOG_TAG, "ops_backup_start: pipe failed, errno=%d", err);
+        return -err;
+    }
+    (void)fcntl(p[0], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(p[1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+    /* Best effort: fewer wake-ups between copier and pump */
+    (void)fcntl(p[1], F_SETPIPE_SZ, (int)DB_LMDB_BACKUP_PIPE);
+#endif
+
+    backup.fd        = fd;
+    backup.pipe_rd   = p[0];
+    backup.pipe_wr   = p[1];
+    backup.flags     = cfg->flags;
+    backup.rate_mb_s = cfg->rate_mb_s;
+    backup.progress  = cfg->progress;
+    backup.ctx       = cfg->ctx;
+    backup.copy_rc   = MDB_SUCCESS;
+    atomic_store(&backup.cancel, 0);
+    atomic_store(&backup.written, 0);
+    atomic_store(&backup.total, total);
+    atomic_store(&backup.reserved, reserved);
+    atomic_store(&backup.headroom, headroom);
+    atomic_store(&backup.deferred, 0);
+    atomic_store(&backup.refused, 0);
+    atomic_store(&backup.res, 0);
+    atomic_store(&backup.t_start, _now_ms());
+    atomic_store(&backup.running, 1);
+
+    int rc = pthread_create(&backup.pump, NULL, _pump_main, NULL);
+    if(rc != 0)
+    {
+        atomic_store(&backup.running, 0);
+        close(p[0]);
+        close(p[1]);
+        pthread_mutex_unlock(&backup.lock);
+        EML_ERROR(LOG_TAG, "ops_backup_start: pthread_create failed, rc=%d", rc);
+        return -rc;
+    }
+    backup.started = 1;
+    backup.ever    = 1;
+    pthread_mutex_unlock(&backup.lock);
+
+    EML_INFO(LOG_TAG, "ops_backup_start: %s copy of ~%zu bytes, rate=%u MB/s",
+             (cfg->flags & DB_BACKUP_COMPACT) ? "compacting" : "plain", total, cfg->rate_mb_s);
+    return 0;
+}
+
+int ops_backup_wait(void)
+{
+    pthread_mutex_lock(&backup.lock);
+    if(!backup.ever)
+    {
+        pthread_mutex_unlock(&backup.lock);
+        return -ENOENT;
+    }
+    if(backup.started)
+    {
+        pthread_join(backup.pump, NULL);
+        backup.started = 0;
+    }
+    int res = atomic_load(&backup.res);
+    pthread_mutex_unlock(&backup.lock);
+
+    return res;
+}
+
+void ops_backup_stop(void)
+{
+    pthread_mutex_lock(&backup.lock);
+    if(backup.started)
+    {
+        atomic_store(&backup.cancel, 1);
+        pthread_join(backup.pump, NULL);
+        backup.started = 0;
+    }
+    pthread_mutex_unlock(&backup.lock);
+}
+
+void ops_backup_status(db_backup_status_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(*out));
+    out->running  = atomic_load(&backup.running);
+    out->res      = out->running ? 0 : atomic_load(&backup.res);
+    out->written  = atomic_load(&backup.written);
+    out->total    = atomic_load(&backup.total);
+    out->backups  = atomic_load(&backup.backups);
+    out->reserved = atomic_load(&backup.reserved);
+    out->headroom = atomic_load(&backup.headroom);
+    if(atomic_load(&backup.copying))
+    {
+        _map_since(&out->deferred, &out->refused);
+    }
+    else
+    {
+        out->deferred = atomic_load(&backup.deferred);
+        out->refused  = atomic_load(&backup.refused);
+    }
+
+    uint64_t t0 = atomic_load(&backup.t_start);
+    uint64_t t1 = out->running ? _now_ms() : atomic_load(&backup.t_end);
+    if(t0 && t1 >= t0) out->elapsed_ms = t1 - t0;
+}
+
+int ops_backup_space(db_space_stats_t* out)
+{
+    if(!out || !(DataBase && DataBase->env))
+    {
+        EML_ERROR(LOG_TAG, "ops_backup_space: invalid input");
+        return -EINVAL;
+    }
+    memset(out, 0, sizeof(*out));
+
+    MDB_txn*    txn = NULL;
+    MDB_cursor* cur = NULL;
+    MDB_envinfo info;
+    MDB_stat    st;
+
+    ops_map_enter();
+    int rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc == MDB_SUCCESS) rc = mdb_env_info(DataBase->env, &info);
+    if(rc == MDB_SUCCESS) rc = mdb_env_stat(DataBase->env, &st);
+    if(rc == MDB_SUCCESS)
+    {
+        out->page_size  = (size_t)st.ms_psize;
+        out->map_size   = (size_t)info.me_mapsize;
+        out->pages_last = (size_t)info.me_last_pgno + 1u;
+        out->depth      = st.ms_depth;
+        out->pages_tree = st.ms_branch_pages + st.ms_leaf_pages + st.ms_overflow_pages;
+    }
+    for(size_t i = 0; rc == MDB_SUCCESS && i < DataBase->n_dbis; i++)
+    {
+        rc = mdb_stat(txn, DataBase->dbis[i].dbi, &st);
+        if(rc != MDB_SUCCESS) break;
+        out->pages_tree += st.ms_branch_pages + st.ms_leaf_pages + st.ms_overflow_pages;
+        out->entries += st.ms_entries;
+    }
+
+    /* Each freelist record holds a page count, then the page numbers */
+    if(rc == MDB_SUCCESS) rc = mdb_cursor_open(txn, BACKUP_FREE_DBI, &cur);
+    if(rc == MDB_SUCCESS)
+    {
+        MDB_val k;
+        MDB_val v;
+        for(rc = mdb_cursor_get(cur, &k, &v, MDB_FIRST); rc == MDB_SUCCESS;
+            rc = mdb_cursor_get(cur, &k, &v, MDB_NEXT))
+        {
+            if(v.mv_size >= sizeof(size_t)) out->pages_free += *(const size_t*)v.mv_data;
+        }
+        mdb_cursor_close(cur);
+        if(rc == MDB_NOTFOUND) rc = MDB_SUCCESS;
+    }
+    if(txn) mdb_txn_abort(txn);
+    ops_map_leave();
+
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_backup_space: page walk failed", rc);
+        return ops_errno(rc);
+    }
+
+    /* The compacting copy keeps the trees and drops the freelist */
+    out->compact_bytes = (out->pages_tree + BACKUP_META_PAGES) * out->page_size;
+    return 0;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void* _pump_main(void* arg)
+{
+    (void)arg;
+
+    int   res = 0;
+    char* buf = malloc(DB_LMDB_BACKUP_CHUNK);
+    int   rc  = buf ? pthread_create(&backup.copier, NULL, _copy_main, NULL) : ENOMEM;
+    if(rc != 0)
+    {
+        close(backup.pipe_wr);
+        res = -rc;
+    }
+
+    while(rc == 0)
+    {
+        if(atomic_load(&backup.cancel))
+        {
+            res = -ECANCELED;
+            break;
+        }
+
+        ssize_t n = read(backup.pipe_rd, buf, DB_LMDB_BACKUP_CHUNK);
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0)
+        {
+            res = -errno;
+            break;
+        }
+        if(n == 0) break;
+
+        res = _write_all(buf, (size_t)n);
+        if(res != 0) break;
+
+        size_t written = atomic_fetch_add(&backup.written, (size_t)n) + (size_t)n;
+        if(backup.progress) backup.progress(written, atomic_load(&backup.total), backup.ctx);
+
+        res = _throttle(written);
+        if(res != 0) break;
+    }
+
+    /* A copier still writing gets EPIPE and gives up */
+    close(backup.pipe_rd);
+    if(rc == 0) pthread_join(backup.copier, NULL);
+    free(buf);
+
+    if(res == 0 && backup.copy_rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_pump_main: mdb_env_copyfd2 failed", backup.copy_rc);
+        res = ops_errno(backup.copy_rc);
+    }
+
+    atomic_store(&backup.t_end, _now_ms());
+    atomic_store(&backup.res, res);
+    atomic_fetch_add(&backup.backups, 1);
+    atomic_store(&backup.running, 0);
+
+    if(res == 0)
+    {
+        EML_INFO(LOG_TAG, "_pump_main: backup done, %zu bytes", atomic_load(&backup.written));
+    }
+    else
+    {
+        EML_ERROR(LOG_TAG, "_pump_main: backup failed after %zu bytes, res=%d",
+                  atomic_load(&backup.written), res);
+    }
+    return NULL;
+}
+
+static void* _copy_main(void* arg)
+{
+    (void)arg;
+
+    /* A closed pipe must fail the write, not kill the process */
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+    /* The copy reads the map through its own txn: no resize meanwhile.
+    mdb_env_copyfd2 is one call, so the gate is held for the whole copy */
+    const unsigned flags = (backup.flags & DB_BACKUP_COMPACT) ? MDB_CP_COMPACT : 0u;
+    db_map_stats_t ms;
+    ops_map_stats(&ms);
+    atomic_store(&backup.defer0, ms.deferred);
+    atomic_store(&backup.refuse0, ms.full_refused);
+    atomic_store(&backup.copying, 1);
+    ops_map_enter_long();
+    backup.copy_rc = mdb_env_copyfd2(DataBase->env, backup.pipe_wr, flags);
+    ops_map_leave_long();
+    size_t deferred = 0;
+    size_t refused  = 0;
+    _map_since(&deferred, &refused);
+    atomic_store(&backup.deferred, deferred);
+    atomic_store(&backup.refused, refused);
+    atomic_store(&backup.copying, 0);
+
+    if(deferred) EML_WARN(LOG_TAG, "_copy_main: %zu map growths put off by the copy", deferred);
+    if(refused)
+    {
+        EML_WARN(LOG_TAG, "_copy_main: %zu writes past the headroom of %zu bytes failed", refused,
+                 atomic_load(&backup.headroom));
+    }
+
+    close(backup.pipe_wr);
+    return NULL;
+}
+
+static int _write_all(const void* buf, size_t size)
+{
+    const char* p = buf;
+    while(size > 0)
+    {
+        ssize_t n = write(backup.fd, p, size);
+        if(n < 0 && errno == EINTR) continue;
+        if(n < 0)
+        {
+            int err = errno;
+            EML_ERROR(LOG_TAG, "_write_all: write failed, errno=%d", err);
+            return -err;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int _throttle(const size_t written)
+{
+    if(backup.rate_mb_s == 0) return 0;
+
+    const uint64_t rate = (uint64_t)backup.rate_mb_s * 1024u * 1024u;
+    const uint64_t due  = atomic_load(&backup.t_start) + (uint64_t)written * 1000u / rate;
+
+    for(uint64_t now = _now_ms(); now < due; now = _now_ms())
+    {
+        if(atomic_load(&backup.cancel)) return -ECANCELED;
+
+        uint64_t        ms = due - now;
+        struct timespec ts;
+        if(ms > BACKUP_SLEEP_SLICE_MS) ms = BACKUP_SLEEP_SLICE_MS;
+        ts.tv_sec  = (time_t)(ms / 1000u);
+        ts.tv_nsec = (long)(ms % 1000u) * 1000000L;
+        nanosleep(&ts, NULL);
+    }
+    return 0;
+}
+
+static size_t _headroom(const size_t total, const unsigned rate_mb_s)
+{
+    if(rate_mb_s == 0) return DB_LMDB_BACKUP_HEADROOM;
+
+    const uint64_t rate = (uint64_t)rate_mb_s * 1024u * 1024u;
+    const uint64_t secs = (uint64_t)total / rate;
+    const uint64_t n    = secs / DB_LMDB_BACKUP_HEADROOM_S + 1u;
+
+    /* Past SIZE_MAX _reserve caps at the ceiling anyway */
+    if(n > SIZE_MAX / DB_LMDB_BACKUP_HEADROOM) return SIZE_MAX;
+    return (size_t)n * DB_LMDB_BACKUP_HEADROOM;
+}
+
+static size_t _reserve(const db_space_stats_t* sp, const size_t headroom)
+{
+    const size_t used   = sp->pages_last * sp->page_size;
+    size_t       target = used + headroom;
+    if(target < used || target > DataBase->map_size_bytes_max)
+    {
+        target = DataBase->map_size_bytes_max;
+    }
+    if(target <= sp->map_size) return 0;
+
+    int rc = ops_map_reserve(target);
+    if(rc != 0)
+    {
+        /* Not fatal: writes during the copy may stall on a full map */
+        EML_WARN(LOG_TAG, "_reserve: map not grown to %zu before the copy (%d)", target, rc);
+        return 0;
+    }
+    EML_INFO(LOG_TAG, "_reserve: map %zu -> %zu bytes before the copy", sp->map_size, target);
+    return target - sp->map_size;
+}
+
+static void _map_since(size_t* out_deferred, size_t* out_refused)
+{
+    db_map_stats_t ms;
+    ops_map_stats(&ms);
+    const size_t d0 = atomic_load(&backup.defer0);
+    const size_t r0 = atomic_load(&backup.refuse0);
+    *out_deferred   = ms.deferred >= d0 ? ms.deferred - d0 : 0;
+    *out_refused    = ms.full_refused >= r0 ? ms.full_refused - r0 : 0;
+}
+
+static uint64_t _now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
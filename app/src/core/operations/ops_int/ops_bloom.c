@@ -0,0 +1,503 @@
+/**
+ * @file ops_bloom.c
+ *
+ */
+
+#include <errno.h>     /* EINVAL, EIO, ENOENT, ENOMEM */
+#include <fcntl.h>     /* open */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint32_t, uint64_t */
+#include <stdio.h>     /* snprintf, rename */
+#include <stdlib.h>    /* aligned_alloc, calloc, free */
+#include <string.h>    /* memset, strchr, strlen */
+#include <sys/stat.h>  /* fstat */
+#include <unistd.h>    /* read, write, fsync, close, unlink */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_BLOOM_* */
+#include "db.h"     /* DataBase */
+#include "ops_bloom.h"
+#include "ops_util.h" /* ops_errno, ops_hash */
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG       "ops_bloom"
+
+/* Sidecar file header tag ("BLMF") and layout version */
+#define BLOOM_MAGIC   0x464d4c42u
+#define BLOOM_VERSION 1u
+
+/* 64-bit words per block: one cache line, one bit set in each word */
+#define BLOOM_WORDS   8u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief One cache line of filter bits, all the bits of a key live in one block.
+ */
+typedef struct
+{
+    _Atomic uint64_t w[BLOOM_WORDS];
+} bloom_block_t;
+
+/**
+ * @brief Filter of one DBI.
+ */
+typedef struct
+{
+    bloom_block_t* blocks;    /**< Power-of-2 count, 64-byte aligned. */
+    size_t         n_blocks;  /**< Blocks allocated. */
+    size_t         capacity;  /**< Keys it was sized for. */
+    atomic_size_t  keys;      /**< Adds that set at least one new bit. */
+    atomic_int     saturated; /**< Non-zero once keys passed capacity. */
+    int            loaded;    /**< Non-zero when read from the sidecar. */
+    char*          file;      /**< Sidecar path, NULL when the DBI name is no file name. */
+#if DB_LMDB_METRICS
+    atomic_size_t negatives;
+    atomic_size_t false_positives;
+#endif
+} bloom_t;
+
+/**
+ * @brief Sidecar file header, followed by the blocks.
+ *
+ * The filter is only trusted while the env is where it was saved: same
+ * last txn id and key count.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t txnid;    /**< me_last_txnid when saved. */
+    uint64_t entries;  /**< ms_entries of the DBI when saved. */
+    uint64_t n_blocks; /**< Blocks following the header. */
+    uint64_t capacity; /**< Keys the filter was sized for. */
+    uint64_t keys;     /**< Keys added. */
+    uint64_t sum;      /**< FNV-1a of the blocks. */
+} bloom_file_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+/* Filters by DBI index, NULL for DBIs without one */
+static bloom_t** blooms   = NULL;
+static size_t    n_blooms = 0;
+
+/* Odd multipliers picking one bit per word (split block Bloom filter) */
+static const uint32_t bloom_salt[BLOOM_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static bloom_t* _bloom_new(const char* dir, const char* name);
+static void     _bloom_free(bloom_t* f);
+static int      _bloom_alloc(bloom_t* f, const size_t capacity);
+static int      _bloom_scan(bloom_t* f, MDB_txn* txn, const MDB_dbi dbi);
+static int      _bloom_load(bloom_t* f, const uint64_t txnid, const uint64_t entries);
+static void     _bloom_save(bloom_t* f, const uint64_t txnid, const uint64_t entries);
+static uint64_t _sum(const bloom_t* f);
+
+static inline bloom_t* _bloom(const unsigned dbi)
+{
+    return dbi < n_blooms ? blooms[dbi] : NULL;
+}
+
+static inline uint64_t _bit(const uint64_t h, const unsigned i)
+{
+    return 1ull << ((uint32_t)((uint32_t)h * bloom_salt[i]) >> 26);
+}
+
+static inline bloom_block_t* _block(const bloom_t* f, const uint64_t h)
+{
+    return &f->blocks[(size_t)(h >> 32) & (f->n_blocks - 1)];
+}
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_bloom_open(const char* dir, const char* const* names, const dbi_type_t* types,
+                   const unsigned n_dbis)
+{
+    if(!DataBase || !DataBase->env || !DataBase->dbis || !dir || !names || !types ||
+       n_dbis > DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_bloom_open: invalid input");
+        return -EINVAL;
+    }
+
+    unsigned wanted = 0;
+    for(unsigned i = 0; i < n_dbis; i++) wanted += (types[i] & DBI_TYPE_BLOOM) != 0;
+    if(wanted == 0) return 0;
+
+    blooms = calloc(n_dbis, sizeof(*blooms));
+    if(!blooms)
+    {
+        EML_ERROR(LOG_TAG, "ops_bloom_open: calloc(%u filters) failed", n_dbis);
+        return -ENOMEM;
+    }
+    n_blooms = n_dbis;
+
+    MDB_envinfo info;
+    MDB_txn*    txn = NULL;
+    int         rc  = mdb_env_info(DataBase->env, &info);
+    if(rc == MDB_SUCCESS) rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_bloom_open: read txn failed", rc);
+        return ops_errno(rc);
+    }
+
+    int res = 0;
+    for(unsigned i = 0; i < n_dbis && res == 0; i++)
+    {
+        if(!(types[i] & DBI_TYPE_BLOOM)) continue;
+
+        MDB_stat st;
+        rc = mdb_stat(txn, DataBase->dbis[i].dbi, &st);
+        if(rc != MDB_SUCCESS)
+        {
+            LMDB_EML_ERR(LOG_TAG, "ops_bloom_open: mdb_stat failed", rc);
+            res = ops_errno(rc);
+            break;
+        }
+
+        bloom_t* f = _bloom_new(dir, names[i]);
+        if(!f)
+        {
+            res = -ENOMEM;
+            break;
+        }
+        blooms[i] = f;
+
+        /* Saved at this very txn: no scan */
+        if(_bloom_load(f, info.me_last_txnid, st.ms_entries) == 0) continue;
+
+        const size_t keys = (size_t)st.ms_entries * DB_LMDB_BLOOM_HEADROOM;
+        res = _bloom_alloc(f, keys > DB_LMDB_BLOOM_MIN_KEYS ? keys : DB_LMDB_BLOOM_MIN_KEYS);
+        if(res == 0) res = _bloom_scan(f, txn, DataBase->dbis[i].dbi);
+    }
+    mdb_txn_abort(txn);
+
+    if(res != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_bloom_open: build failed, err=%d", res);
+        for(size_t i = 0; i < n_blooms; i++) _bloom_free(blooms[i]);
+        free(blooms);
+        blooms   = NULL;
+        n_blooms = 0;
+    }
+    return res;
+}
+
+void ops_bloom_close(void)
+{
+    if(!blooms) return;
+
+    /* Stamp the files with the env as it is now */
+    MDB_envinfo info;
+    MDB_txn*    txn = NULL;
+    int         rc  = DataBase && DataBase->env ? mdb_env_info(DataBase->env, &info) : -1;
+    if(rc == MDB_SUCCESS) rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc != MDB_SUCCESS) EML_WARN(LOG_TAG, "ops_bloom_close: env unavailable, nothing saved");
+
+    for(size_t i = 0; i < n_blooms; i++)
+    {
+        bloom_t* f  = blooms[i];
+        MDB_stat st = { 0 };
+        if(f && txn && mdb_stat(txn, DataBase->dbis[i].dbi, &st) == MDB_SUCCESS)
+        {
+            _bloom_save(f, info.me_last_txnid, st.ms_entries);
+        }
+        _bloom_free(f);
+    }
+    if(txn) mdb_txn_abort(txn);
+
+    free(blooms);
+    blooms   = NULL;
+    n_blooms = 0;
+}
+
+void ops_bloom_add(const unsigned dbi, const void* key, const size_t key_size)
+{
+    bloom_t* f = _bloom(dbi);
+    if(!f) return;
+
+    const uint64_t h     = ops_hash(key, key_size);
+    bloom_block_t* b     = _block(f, h);
+    int            fresh = 0;
+    for(unsigned i = 0; i < BLOOM_WORDS; i++)
+    {
+        const uint64_t bit = _bit(h, i);
+        if(!(atomic_load_explicit(&b->w[i], memory_order_relaxed) & bit))
+        {
+            atomic_fetch_or(&b->w[i], bit);
+            fresh = 1;
+        }
+    }
+
+    /* Past capacity the false positive rate climbs: stop trusting it */
+    if(fresh && atomic_fetch_add(&f->keys, 1) + 1 > f->capacity &&
+       !atomic_exchange(&f->saturated, 1))
+    {
+        EML_WARN(LOG_TAG, "ops_bloom_add: dbi %u filter full (%zu keys), bypassed until rebuilt",
+                 dbi, f->capacity);
+    }
+}
+
+int ops_bloom_maybe(const unsigned dbi, const void* key, const size_t key_size)
+{
+    bloom_t* f = _bloom(dbi);
+    if(!f || atomic_load_explicit(&f->saturated, memory_order_relaxed)) return 1;
+
+    const uint64_t h = ops_hash(key, key_size);
+    bloom_block_t* b = _block(f, h);
+    for(unsigned i = 0; i < BLOOM_WORDS; i++)
+    {
+        if(!(atomic_load(&b->w[i]) & _bit(h, i)))
+        {
+#if DB_LMDB_METRICS
+            atomic_fetch_add_explicit(&f->negatives, 1, memory_order_relaxed);
+#endif
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void ops_bloom_false_positive(const unsigned dbi)
+{
+#if DB_LMDB_METRICS
+    bloom_t* f = _bloom(dbi);
+    if(f) atomic_fetch_add_explicit(&f->false_positives, 1, memory_order_relaxed);
+#else
+    (void)dbi;
+#endif
+}
+
+int ops_bloom_stats(const unsigned dbi, db_bloom_stats_t* out)
+{
+    bloom_t* f = _bloom(dbi);
+    if(!f || !out) return -ENOENT;
+
+    memset(out, 0, sizeof(*out));
+    out->bits      = f->n_blocks * BLOOM_WORDS * 64u;
+    out->keys      = atomic_load(&f->keys);
+    out->capacity  = f->capacity;
+    out->loaded    = f->loaded;
+    out->saturated = atomic_load(&f->saturated);
+#if DB_LMDB_METRICS
+    out->negatives       = atomic_load(&f->negatives);
+    out->false_positives = atomic_load(&f->false_positives);
+#endif
+    return 0;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static bloom_t* _bloom_new(const char* dir, const char* name)
+{
+    bloom_t* f = calloc(1, sizeof(*f));
+    if(!f)
+    {
+        EML_ERROR(LOG_TAG, "_bloom_new: calloc failed");
+        return NULL;
+    }
+
+    /* The name becomes part of a path: plain names only */
+    if(name && *name && !strchr(name, '/'))
+    {
+        const size_t len = strlen(dir) + strlen(name) + sizeof("/.bloom");
+        f->file          = malloc(len);
+        if(!f->file)
+        {
+            free(f);
+            return NULL;
+        }
+        snprintf(f->file, len, "%s/%s.bloom", dir, name);
+    }
+    return f;
+}
+
+static void _bloom_free(bloom_t* f)
+{
+    if(!f) return;
+
+    free(f->blocks);
+    free(f->file);
+    free(f);
+}
+
+static int _bloom_alloc(bloom_t* f, const size_t capacity)
+{
+    const size_t bits     = capacity * DB_LMDB_BLOOM_BITS_PER_KEY;
+    size_t       n_blocks = 1;
+    while(n_blocks * BLOOM_WORDS * 64u < bits) n_blocks <<= 1;
+
+    f->blocks = aligned_alloc(sizeof(bloom_block_t), n_blocks * sizeof(bloom_block_t));
+    if(!f->blocks)
+    {
+        EML_ERROR(LOG_TAG, "_bloom_alloc: %zu blocks failed", n_blocks);
+        return -ENOMEM;
+    }
+    memset(f->blocks, 0, n_blocks * sizeof(bloom_block_t));
+    f->n_blocks = n_blocks;
+    f->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Add every key of @p dbi, once per key on DUPSORT DBIs.
+ */
+static int _bloom_scan(bloom_t* f, MDB_txn* txn, const MDB_dbi dbi)
+{
+    MDB_cursor* cur = NULL;
+    int         rc  = mdb_cursor_open(txn, dbi, &cur);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_bloom_scan: mdb_cursor_open failed", rc);
+        return ops_errno(rc);
+    }
+
+    MDB_val k, v;
+    size_t  n = 0;
+    for(rc = mdb_cursor_get(cur, &k, &v, MDB_FIRST); rc == MDB_SUCCESS;
+        rc = mdb_cursor_get(cur, &k, &v, MDB_NEXT_NODUP))
+    {
+        const uint64_t h = ops_hash(k.mv_data, k.mv_size);
+        bloom_block_t* b = _block(f, h);
+        for(unsigned i = 0; i < BLOOM_WORDS; i++) atomic_fetch_or(&b->w[i], _bit(h, i));
+        n++;
+    }
+    mdb_cursor_close(cur);
+    if(rc != MDB_NOTFOUND)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_bloom_scan: mdb_cursor_get failed", rc);
+        return ops_errno(rc);
+    }
+
+    atomic_store(&f->keys, n);
+    EML_INFO(LOG_TAG, "_bloom_scan: %zu keys in %zu blocks", n, f->n_blocks);
+    return 0;
+}
+
+/**
+ * @brief Read the sidecar, if it was saved at @p txnid with @p entries keys.
+ *
+ * @return 0 when loaded, -1 when the filter has to be scanned.
+ */
+static int _bloom_load(bloom_t* f, const uint64_t txnid, const uint64_t entries)
+{
+    if(!f->file) return -1;
+
+    int fd = open(f->file, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return -1;
+
+    bloom_file_t hdr;
+    struct stat  st;
+    int          res = -1;
+    if(read(fd, &hdr, sizeof(hdr)) != (ssize_t)sizeof(hdr) || fstat(fd, &st) != 0) goto out;
+
+    /* Stale, foreign or torn: rebuild */
+    if(hdr.magic != BLOOM_MAGIC || hdr.version != BLOOM_VERSION || hdr.txnid != txnid ||
+       hdr.entries != entries || hdr.n_blocks == 0 || (hdr.n_blocks & (hdr.n_blocks - 1)) ||
+       (uint64_t)st.st_size != sizeof(hdr) + hdr.n_blocks * sizeof(bloom_block_t))
+    {
+        EML_INFO(LOG_TAG, "_bloom_load: %s does not match the env, rescanning", f->file);
+        goto out;
+    }
+
+    const size_t bytes = (size_t)hdr.n_blocks * sizeof(bloom_block_t);
+    f->blocks          = aligned_alloc(sizeof(bloom_block_t), bytes);
+    if(!f->blocks) goto out;
+    f->n_blocks = (size_t)hdr.n_blocks;
+    if(read(fd, f->blocks, bytes) != (ssize_t)bytes || _sum(f) != hdr.sum)
+    {
+        EML_WARN(LOG_TAG, "_bloom_load: %s is corrupt, rescanning", f->file);
+        free(f->blocks);
+        f->blocks   = NULL;
+        f->n_blocks = 0;
+        goto out;
+    }
+
+    f->capacity = (size_t)hdr.capacity;
+    atomic_store(&f->keys, (size_t)hdr.keys);
+    f->loaded = 1;
+    res       = 0;
+    EML_INFO(LOG_TAG, "_bloom_load: %s, %zu keys", f->file, (size_t)hdr.keys);
+
+out:
+    close(fd);
+    return res;
+}
+
+/**
+ * @brief Write the filter next to the env: temp file, fsync, rename.
+ */
+static void _bloom_save(bloom_t* f, const uint64_t txnid, const uint64_t entries)
+{
+    if(!f->file || !f->blocks) return;
+
+    /* Rebuilt bigger at the next open */
+    if(atomic_load(&f->saturated))
+    {
+        unlink(f->file);
+        return;
+    }
+
+    char         tmp[4096];
+    const size_t bytes = f->n_blocks * sizeof(bloom_block_t);
+    bloom_file_t hdr   = {
+          .magic    = BLOOM_MAGIC,
+          .version  = BLOOM_VERSION,
+          .txnid    = txnid,
+          .entries  = entries,
+          .n_blocks = f->n_blocks,
+          .capacity = f->capacity,
+          .keys     = atomic_load(&f->keys),
+          .sum      = _sum(f),
+    };
+    if(snprintf(tmp, sizeof(tmp), "%s.tmp", f->file) >= (int)sizeof(tmp)) return;
+
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, DB_LMDB_ENV_MODE);
+    if(fd < 0)
+    {
+        EML_WARN(LOG_TAG, "_bloom_save: cannot create %s (errno=%d)", tmp, errno);
+        return;
+    }
+
+    const int ok = write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr) &&
+                   write(fd, f->blocks, bytes) == (ssize_t)bytes && fsync(fd) == 0;
+    close(fd);
+    if(!ok || rename(tmp, f->file) != 0)
+    {
+        EML_WARN(LOG_TAG, "_bloom_save: writing %s failed (errno=%d)", f->file, errno);
+        unlink(tmp);
+        return;
+    }
+    EML_INFO(LOG_TAG, "_bloom_save: %s, %zu keys", f->file, (size_t)hdr.keys);
+}
+
+/**
+ * @brief Checksum of the blocks, stored in the file header.
+ */
+static uint64_t _sum(const bloom_t* f)
+{
+    return ops_hash(f->blocks, f->n_blocks * sizeof(bloom_block_t));
+}
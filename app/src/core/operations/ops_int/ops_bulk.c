@@ -0,0 +1,275 @@
+/**
+ * @file ops_bulk.c
+ *
+ */
+
+#include <errno.h>  /* EINVAL, ENOMEM */
+#include <stdint.h> /* SIZE_MAX */
+#include <stdlib.h> /* calloc, free */
+#include <string.h> /* memcpy, memset */
+#include <time.h>   /* clock_gettime */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_BULK_* */
+#include "ops_arena.h"
+#include "ops_bulk.h"
+#include "ops_exec.h"
+#include "ops_map.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG               "ops_bulk"
+
+/* Per-record page overhead assumed when sizing the map: leaf node header
+plus its slot in the page index, rounded up */
+#define OPS_BULK_NODE_OVERHEAD 16u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+struct ops_bulk
+{
+    batch_t*        batch;          /**< Sorted batch holding the pending chunk. */
+    ops_arena_t     data;           /**< Copies of the pending keys and values. */
+    size_t          commit_records; /**< Flush threshold in records. */
+    size_t          commit_bytes;   /**< Flush threshold in key + value bytes. */
+    size_t          pending;        /**< Records in the pending chunk. */
+    size_t          pending_bytes;  /**< Key + value bytes in the pending chunk. */
+    db_bulk_stats_t stats;          /**< Committed counters (rates left at 0). */
+    double          t_start;        /**< Creation time, monotonic seconds. */
+};
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Grow the map ahead of a flush so the chunk does not hit MAP_FULL.
+ */
+static void _bulk_pregrow(bulk_t* bulk);
+
+static double _now_s(void);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+bulk_t* ops_bulk_create(const db_bulk_cfg_t* cfg)
+{
+    bulk_t* bulk = calloc(1, sizeof(bulk_t));
+    if(!bulk)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_create: calloc failed");
+        return NULL;
+    }
+
+    bulk->commit_records = (cfg && cfg->commit_records) ? cfg->commit_records
+                                                        : DB_LMDB_BULK_COMMIT_RECORDS;
+    bulk->commit_bytes   = (cfg && cfg->commit_bytes) ? cfg->commit_bytes
+                                                      : DB_LMDB_BULK_COMMIT_BYTES;
+
+    bulk->batch = ops_batch_create();
+    if(!bulk->batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_create: ops_batch_create failed");
+        free(bulk);
+        return NULL;
+    }
+
+    /* A chunk never holds more than commit_records ops, whatever the global
+    batch limit is */
+    if(ops_batch_set_sorted(bulk->batch, 1) != 0 ||
+       ops_batch_set_max_ops(bulk->batch, bulk->commit_records) != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_create: cannot configure batch");
+        ops_batch_destroy(bulk->batch);
+        free(bulk);
+        return NULL;
+    }
+
+    bulk->t_start = _now_s();
+
+    EML_DBG(LOG_TAG, "ops_bulk_create: commit every %zu records or %zu bytes",
+            bulk->commit_records, bulk->commit_bytes);
+    return bulk;
+}
+
+int ops_bulk_put(bulk_t* bulk, const unsigned dbi, const void* key, const size_t key_size,
+                 const void* val, const size_t val_size)
+{
+    if(!bulk || !key || key_size == 0 || !val || val_size == 0 ||
+       key_size > SIZE_MAX - val_size)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_put: invalid input");
+        return -EINVAL;
+    }
+
+    /* One allocation per record: key bytes then value bytes */
+    unsigned char* copy = ops_arena_alloc(&bulk->data, key_size + val_size);
+    if(!copy)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_put: cannot copy %zu bytes", key_size + val_size);
+        return -ENOMEM;
+    }
+    memcpy(copy, key, key_size);
+    memcpy(copy + key_size, val, val_size);
+
+    op_t* op = ops_get_next_op(bulk->batch);
+    if(!op) return -ENOMEM;
+
+    memset(op, 0, sizeof(op_t));
+    op->dbi              = dbi;
+    op->type             = DB_OPERATION_PUT;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = copy;
+    op->key.present.size = key_size;
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = copy + key_size;
+    op->val.present.size = val_size;
+
+    int rc = ops_add_operation(bulk->batch, op);
+    if(rc != 0) return rc;
+
+    bulk->pending++;
+    bulk->pending_bytes += key_size + val_size;
+
+    if(bulk->pending >= bulk->commit_records || bulk->pending_bytes >= bulk->commit_bytes)
+    {
+        return ops_bulk_flush(bulk);
+    }
+    return 0;
+}
+
+int ops_bulk_flush(bulk_t* bulk)
+{
+    if(!bulk)
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_flush: invalid input");
+        return -EINVAL;
+    }
+
+    if(bulk->pending == 0) return 0;
+
+    _bulk_pregrow(bulk);
+
+    /* The batch is reset by the exec whatever the outcome */
+    int rc = ops_execute_operations(bulk->batch);
+    if(rc == 0)
+    {
+        bulk->stats.records += bulk->pending;
+        bulk->stats.bytes += bulk->pending_bytes;
+        bulk->stats.commits++;
+    }
+    else
+    {
+        EML_ERROR(LOG_TAG, "ops_bulk_flush: chunk of %zu records dropped (%d)", bulk->pending,
+                  rc);
+    }
+
+    bulk->pending       = 0;
+    bulk->pending_bytes = 0;
+    ops_arena_reset(&bulk->data);
+
+    return rc;
+}
+
+void ops_bulk_stats(const bulk_t* bulk, db_bulk_stats_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(db_bulk_stats_t));
+    if(!bulk) return;
+
+    *out         = bulk->stats;
+    out->seconds = _now_s() - bulk->t_start;
+    if(out->seconds > 0.0)
+    {
+        out->records_per_s = (double)out->records / out->seconds;
+        out->mib_per_s     = (double)out->bytes / (1024.0 * 1024.0) / out->seconds;
+    }
+}
+
+void ops_bulk_destroy(bulk_t* bulk)
+{
+    if(!bulk) return;
+
+    if(bulk->pending)
+    {
+        EML_WARN(LOG_TAG, "ops_bulk_destroy: dropping %zu unflushed records", bulk->pending);
+    }
+
+    ops_batch_destroy(bulk->batch);
+    ops_arena_release(&bulk->data);
+    free(bulk);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void _bulk_pregrow(bulk_t* bulk)
+{
+    if(!(DataBase && DataBase->env)) return;
+
+    MDB_envinfo info;
+    MDB_stat    st;
+    int         mdb_res = mdb_env_info(DataBase->env, &info);
+    if(mdb_res == MDB_SUCCESS) mdb_res = mdb_env_stat(DataBase->env, &st);
+    if(mdb_res != MDB_SUCCESS)
+    {
+        LMDB_EML_WARN(LOG_TAG, "_bulk_pregrow: env info", mdb_res);
+        return;
+    }
+
+    /* Pages in use plus twice the chunk: unsorted input leaves pages about
+    half full after splits, and copy-on-write needs room for the old ones */
+    size_t used  = (info.me_last_pgno + 1) * (size_t)st.ms_psize;
+    size_t chunk = bulk->pending_bytes + bulk->pending * OPS_BULK_NODE_OVERHEAD;
+    size_t need  = used + 2 * chunk;
+    if(need <= info.me_mapsize) return;
+
+    size_t desired = info.me_mapsize ? info.me_mapsize : need;
+    while(desired < need && desired < DataBase->map_size_bytes_max)
+    {
+        desired *= 2;
+    }
+    if(desired > DataBase->map_size_bytes_max) desired = DataBase->map_size_bytes_max;
+
+    if(desired <= info.me_mapsize)
+    {
+        /* Already at the cap: let the exec retry path report MAP_FULL */
+        EML_WARN(LOG_TAG, "_bulk_pregrow: map at max %zu, chunk may not fit", info.me_mapsize);
+        return;
+    }
+
+    /* The loader holds no txn here, the gate only waits for other threads */
+    int res = ops_map_reserve(desired);
+    if(res != 0)
+    {
+        EML_WARN(LOG_TAG, "_bulk_pregrow: map growth to %zu failed (%d)", desired, res);
+        return;
+    }
+
+    bulk->stats.map_grows++;
+    EML_INFO(LOG_TAG, "_bulk_pregrow: map %zu -> %zu bytes", info.me_mapsize, desired);
+}
+
+static double _now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
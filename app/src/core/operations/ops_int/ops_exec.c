@@ -3,19 +3,27 @@
  * 
  */
 
+#include <stdlib.h> /* calloc, realloc, free */
 #include <string.h> /* memset, memcpy */
 
 #include "common.h" /* EML_* macros, LMDB_EML_* */
 #include "ops_actions.h"
+#include "ops_arena.h"
+#include "ops_bloom.h"
 #include "ops_exec.h"
+#include "ops_index.h"
+#include "ops_map.h"
+#include "ops_stats.h"
+#include "ops_trace.h"
+#include "ops_ttl.h"
+#include "ops_vcache.h"
 
 /****************************************************************************
  * PRIVATE DEFINES
  ****************************************************************************
  */
 
-#define LOG_TAG        "ops_exec"
-#define OPS_CACHE_SIZE 8
+#define LOG_TAG "ops_exec"
 
 /****************************************************************************
  * PRIVATE STUCTURED VARIABLES
@@ -27,49 +35,182 @@ typedef enum
     OPS_BATCH_KIND_RW = 1  /**< Write operation (PUT/DEL). */
 } batch_kind_t;
 
+/**
+ * @brief Cursor cached by a batch for one DBI.
+ *
+ * Read cursors outlive their txn and are renewed into the next read txn;
+ * write cursors are freed by LMDB when their txn ends and only forgotten.
+ */
 typedef struct
 {
-    batch_kind_t kind;                /**< Operations batch kind. */
-    op_t         ops[OPS_CACHE_SIZE]; /**< Cached operations. */
-    size_t       n_ops;               /**< Number of cached operations. */
+    MDB_cursor* cur;   /**< Cached cursor, NULL if none. */
+    int         ro;    /**< Non-zero when opened in a read-only txn. */
+    int         bound; /**< Non-zero when cur belongs to the running txn. */
+} batch_cursor_t;
+
+struct ops_batch
+{
+    batch_kind_t kind;    /**< Operations batch kind. */
+    op_t*        ops;     /**< Cached operations (pool, kept across batches). */
+    size_t       ops_cap; /**< Number of op slots allocated in ops. */
+    size_t       n_ops;   /**< Number of cached operations. */
     /* Cache needed for RW get operations:
     when get, obtain a ptr which after a read is not valid anymore.
-    Thus a necessity to store the get results in a cache arises. */
-    char rw_cache[DB_LMDB_RW_OPS_CACHE_SIZE];
-    /* Number of bytes currently used in rw_cache. */
-    size_t rw_cache_used;
-} batch_t;
+    Thus a necessity to store the get results in a cache arises.
+    The arena grows by chaining slabs and is reused across batches. */
+    ops_arena_t rw_cache;
+    MDB_txn*    lease; /**< RO txn kept open for leased views, NULL if none. */
+    /* One cursor per DBI, shared by all the scans of the batch */
+    batch_cursor_t* cursors;   /**< Indexed by DBI index, grown on demand. */
+    size_t          n_cursors; /**< Entries in cursors. */
+    /* Key-sorted writes, see ops_batch_set_sorted */
+    int     sorted;    /**< Non-zero when PUT runs execute in key order. */
+    int     planned;   /**< Non-zero when order is valid for the queued ops. */
+    size_t* order;     /**< Execution order, followed by merge sort scratch. */
+    size_t  order_cap; /**< Ops covered by order (the buffer holds twice that). */
+    size_t  max_ops;   /**< Own op limit, 0 = ops_batch_max_ops. */
+    /* Replays: a GET overwrites its val, a retry must start from the queued one */
+    op_key_t* vals_in;    /**< Val of each plain GET as queued, by op index. */
+    size_t    vals_cap;   /**< Ops covered by vals_in. */
+    size_t    n_gets;     /**< Plain GETs queued. */
+    int       vals_saved; /**< Non-zero when vals_in holds the queued vals. */
+    /* Savepoints of long write batches */
+    size_t          segment_ops; /**< Ops per child txn, 0 = DB_LMDB_EXEC_SEGMENT_OPS. */
+    size_t          run_pos;     /**< Execution position reached by the last _exec_ops. */
+    db_exec_stats_t stats;       /**< Counters of the last execution. */
+    /* Prepared plan, see ops_batch_prepare */
+    op_t*        plan;      /**< Flattened ops re-armed after every execution. */
+    size_t       plan_cap;  /**< Ops allocated in plan. */
+    size_t       n_plan;    /**< Ops in plan, 0 when the batch is not prepared. */
+    batch_kind_t plan_kind; /**< Kind of the prepared batch. */
+    size_t       plan_gets; /**< Plain GETs of the prepared batch. */
+};
 
 /****************************************************************************
  * PRIVATE VARIABLES
  ****************************************************************************
  */
 
+/* Default batch behind db_core_add_op / db_core_exec_ops (single-threaded). */
 batch_t ops_cache;
 
+/* Runtime limit on the number of ops in one batch (shared by all batches). */
+static size_t ops_batch_max_ops = DB_LMDB_BATCH_OPS_MAX;
+
 /****************************************************************************
  * PRIVATE FUNCTIONS PROTOTYPES
  ****************************************************************************
  */
 
-static db_security_ret_code_t _exec_op(MDB_txn* txn, op_t* op, int* const out_err);
-static void*                  _rw_cache_alloc(size_t size);
+static db_security_ret_code_t _exec_ops(batch_t* batch, MDB_txn* txn, const size_t from,
+                                        const size_t to, int* const out_err);
+static db_security_ret_code_t _exec_savepoints(batch_t* batch, MDB_txn* txn, int* const out_err);
+static int                    _vals_save(batch_t* batch);
+static void                   _vals_restore(batch_t* batch, const size_t from, const size_t to);
+static db_security_ret_code_t _exec_op(batch_t* batch, MDB_txn* txn, op_t* op,
+                                       int* const out_err);
+static db_security_ret_code_t _exec_one(batch_t* batch, MDB_txn* txn, op_t* op,
+                                        int* const out_err);
+static db_security_ret_code_t _exec_indexed(batch_t* batch, MDB_txn* txn, op_t* op,
+                                            int* const out_err);
+static db_security_ret_code_t _ttl_disarm(MDB_txn* txn, op_t* op, int* const out_err);
+static void*                  _rw_cache_alloc(batch_t* batch, size_t size);
+static int                    _ops_reserve(batch_t* batch, size_t n_ops);
+static void                   _batch_reset(batch_t* batch);
+static int                    _plan_flatten(const op_t* ops, const size_t i, op_key_t* desc);
+static MDB_cursor**           _batch_cursor(batch_t* batch, MDB_txn* txn, const unsigned dbi);
+static void                   _cursors_unbind(batch_t* batch);
+static db_security_ret_code_t _plan_sorted(batch_t* batch, MDB_txn* txn, int* const out_err);
+static void _sort_run(MDB_txn* txn, const op_t* ops, size_t* idx, size_t* tmp, const size_t n);
+static size_t _trace_last_pgno(void);
+static void   _trace_end(db_trace_t* trace, const int on, const int result, const int attempts);
+static int    _exec_cached(batch_t* batch);
+static int    _exec_absent(const batch_t* batch);
+
+/* Single PUT whose key and value are known up front: safe to reorder */
+static inline int _op_sortable(const op_t* op)
+{
+    return op->type == DB_OPERATION_PUT &&
+           !(op->flags & (OP_FLAG_MULTIPLE | OP_FLAG_RESERVE)) &&
+           op->key.kind == OP_KEY_KIND_PRESENT && op->val.kind == OP_KEY_KIND_PRESENT;
+}
+
+/* GET whose val (buffer or NONE) is rewritten with the result */
+static inline int _op_get_plain(const op_t* op)
+{
+    return op->type == DB_OPERATION_GET && !(op->flags & OP_FLAG_MULTIPLE);
+}
+
+/* Known keys (and dups) of an integer DBI have an integer size */
+static inline int _op_int_sizes_ok(const op_t* op)
+{
+    if(!DataBase || !DataBase->dbis || op->dbi >= DataBase->n_dbis) return 1;
+    const dbi_t* dbi = &DataBase->dbis[op->dbi];
+    if(!(dbi->is_intkey || dbi->is_intdup) || op->type == DB_OPERATION_LST) return 1;
+
+    /* A range DEL ends on a key, a plain PUT or DEL val is a dup */
+    const int key_val = (op->flags & OP_FLAG_RANGE) != 0;
+    const int dup_val = !key_val && !(op->flags & (OP_FLAG_MULTIPLE | OP_FLAG_RESERVE)) &&
+                        (op->type == DB_OPERATION_PUT || op->type == DB_OPERATION_DEL);
+
+    if(dbi->is_intkey && op->key.kind == OP_KEY_KIND_PRESENT &&
+       !dbi_int_size_ok(op->key.present.size))
+    {
+        return 0;
+    }
+    return op->val.kind != OP_KEY_KIND_PRESENT ||
+           !((key_val && dbi->is_intkey) || (dup_val && dbi->is_intdup)) ||
+           dbi_int_size_ok(op->val.present.size);
+}
+
+/* Op that changes what a GET of its DBI returns */
+static inline int _op_writes(const op_t* op)
+{
+    return op->type == DB_OPERATION_PUT || op->type == DB_OPERATION_DEL ||
+           op->type == DB_OPERATION_REP;
+}
+
+/* Expiry queue written by a write op: its deadline is set or dropped, -1 for none */
+static inline int _op_ttl_queue(const op_t* op)
+{
+    const int queue = ops_ttl_queue();
+    if(queue < 0 || op->dbi == (unsigned)queue) return -1;
+    if(op->flags & OP_FLAG_TTL) return queue;
+    return (op->type == DB_OPERATION_PUT || op->type == DB_OPERATION_DEL) ? queue : -1;
+}
+
+/* Latency histogram of an op, DB_STATS_LAT_MAX (not recorded) for scans */
+static inline db_stats_lat_t _op_lat(const op_t* op)
+{
+    switch(op->type)
+    {
+        case DB_OPERATION_GET:
+            return DB_STATS_LAT_GET;
+        case DB_OPERATION_PUT:
+        case DB_OPERATION_REP:
+            return DB_STATS_LAT_PUT;
+        case DB_OPERATION_DEL:
+            return DB_STATS_LAT_DEL;
+        default:
+            return DB_STATS_LAT_MAX;
+    }
+}
 
 static inline batch_kind_t _batch_type_from_op_type(const op_type_t* const type)
 {
     switch(*type)
     {
         case DB_OPERATION_GET:
-            // case DB_OPERATION_LST:
+        case DB_OPERATION_LST:
             return OPS_BATCH_KIND_RO;
         default:
             return OPS_BATCH_KIND_RW; /* safe default */
     }
 }
 
-static inline unsigned int _txn_type_from_batch_type(void)
+static inline unsigned int _txn_type_from_batch_type(const batch_t* const batch)
 {
-    switch(ops_cache.kind)
+    switch(batch->kind)
     {
         case OPS_BATCH_KIND_RO:
             return MDB_RDONLY;
@@ -83,33 +224,160 @@ static inline unsigned int _txn_type_from_batch_type(void)
  ****************************************************************************
  */
 
-op_t* ops_get_next_op(void)
+batch_t* ops_batch_create(void)
+{
+    batch_t* batch = calloc(1, sizeof(batch_t));
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_create: calloc(batch) failed");
+        return NULL;
+    }
+
+    return batch;
+}
+
+void ops_batch_destroy(batch_t* batch)
+{
+    if(!batch) return;
+
+    ops_release_leased(batch);
+
+    /* Only read cursors are still alive once no txn runs */
+    _cursors_unbind(batch);
+    for(size_t i = 0; i < batch->n_cursors; i++)
+    {
+        if(batch->cursors[i].cur) mdb_cursor_close(batch->cursors[i].cur);
+    }
+    free(batch->cursors);
+    free(batch->order);
+    free(batch->vals_in);
+    free(batch->plan);
+
+    free(batch->ops);
+    ops_arena_release(&batch->rw_cache);
+
+    /* The default batch is statically allocated, only drop its pool */
+    if(batch == &ops_cache)
+    {
+        memset(batch, 0, sizeof(batch_t));
+        return;
+    }
+
+    free(batch);
+}
+
+batch_t* ops_batch_default(void)
+{
+    return &ops_cache;
+}
+
+int ops_set_batch_max_ops(const size_t max_ops)
+{
+    if(max_ops == 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_set_batch_max_ops: invalid limit 0");
+        return -EINVAL;
+    }
+
+    ops_batch_max_ops = max_ops;
+    EML_DBG(LOG_TAG, "ops_set_batch_max_ops: limit set to %zu ops", max_ops);
+    return 0;
+}
+
+size_t ops_get_batch_max_ops(void)
+{
+    return ops_batch_max_ops;
+}
+
+int ops_batch_set_max_ops(batch_t* batch, const size_t max_ops)
+{
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_set_max_ops: invalid input");
+        return -EINVAL;
+    }
+
+    batch->max_ops = max_ops;
+    return 0;
+}
+
+int ops_batch_set_sorted(batch_t* batch, const int enable)
+{
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_set_sorted: invalid input");
+        return -EINVAL;
+    }
+
+    batch->sorted = enable ? 1 : 0;
+    EML_DBG(LOG_TAG, "ops_batch_set_sorted: key-sorted writes %s", enable ? "on" : "off");
+    return 0;
+}
+
+int ops_batch_set_segment_ops(batch_t* batch, const size_t segment_ops)
+{
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_set_segment_ops: invalid input");
+        return -EINVAL;
+    }
+
+    batch->segment_ops = segment_ops;
+    return 0;
+}
+
+void ops_batch_exec_stats(const batch_t* batch, db_exec_stats_t* out_stats)
+{
+    if(!out_stats) return;
+
+    if(!batch)
+    {
+        memset(out_stats, 0, sizeof(*out_stats));
+        return;
+    }
+    *out_stats = batch->stats;
+}
+
+op_t* ops_get_next_op(batch_t* batch)
 {
-    if(ops_cache.n_ops >= OPS_CACHE_SIZE)
+    if(!batch)
     {
-        EML_ERROR(LOG_TAG, "ops_get_next_op: ops cache full, exceeded %d ops", OPS_CACHE_SIZE);
+        EML_ERROR(LOG_TAG, "ops_get_next_op: invalid input");
+        return NULL;
+    }
+
+    if(_ops_reserve(batch, batch->n_ops + 1) != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_get_next_op: cannot grow ops cache past %zu ops", batch->n_ops);
         return NULL;
     }
 
     /* Return pointer to next op */
-    return &ops_cache.ops[ops_cache.n_ops];
+    return &batch->ops[batch->n_ops];
 }
 
-int ops_add_operation(const op_t* operation)
+int ops_add_operation(batch_t* batch, const op_t* operation)
 {
     /* Input check */
-    if(!operation)
+    if(!batch || !operation)
     {
         EML_ERROR(LOG_TAG, "_add_op: invalid input");
         return -EINVAL;
     }
 
+    /* A prepared batch only takes new bindings */
+    if(batch->n_plan)
+    {
+        EML_ERROR(LOG_TAG, "_add_op: batch is prepared");
+        return -EBUSY;
+    }
+
     /* Check if write op */
-    if(ops_cache.kind == OPS_BATCH_KIND_RO &&
+    if(batch->kind == OPS_BATCH_KIND_RO &&
        _batch_type_from_op_type(&operation->type) == OPS_BATCH_KIND_RW)
     {
         /* Set whole ops batch to write */
-        ops_cache.kind = OPS_BATCH_KIND_RW;
+        batch->kind = OPS_BATCH_KIND_RW;
     }
 
     /**
@@ -120,38 +388,74 @@ int ops_add_operation(const op_t* operation)
      * With this check later can safely access the prev op during exec.
      */
     if(operation->key.kind == OP_KEY_KIND_LOOKUP &&
-       operation->key.lookup.op_index > ops_cache.n_ops)
+       operation->key.lookup.op_index > batch->n_ops)
     {
         EML_ERROR(LOG_TAG, "_add_op: invalid key lookup index %u (n_ops=%zu)",
-                  operation->key.lookup.op_index, ops_cache.n_ops);
+                  operation->key.lookup.op_index, batch->n_ops);
         return -EINVAL;
     }
     /* Same for val */
     if(operation->val.kind == OP_KEY_KIND_LOOKUP &&
-       operation->val.lookup.op_index > ops_cache.n_ops)
+       operation->val.lookup.op_index > batch->n_ops)
     {
         EML_ERROR(LOG_TAG, "_add_op: invalid val lookup index %u (n_ops=%zu)",
-                  operation->val.lookup.op_index, ops_cache.n_ops);
+                  operation->val.lookup.op_index, batch->n_ops);
+        return -EINVAL;
+    }
+    /* LMDB reads integer keys as ints whatever their size */
+    if(!_op_int_sizes_ok(operation))
+    {
+        EML_ERROR(LOG_TAG, "_add_op: key or dup size is not an integer one (dbi=%u)",
+                  operation->dbi);
         return -EINVAL;
     }
 
+    /* Callers normally fill the slot returned by ops_get_next_op in place;
+    anything else is copied into the next free slot. The op may live in
+    the pool itself, so copy it out before the pool can move. */
+    if(operation != &batch->ops[batch->n_ops])
+    {
+        const op_t copy = *operation;
+        if(_ops_reserve(batch, batch->n_ops + 1) != 0)
+        {
+            EML_ERROR(LOG_TAG, "_add_op: cannot grow ops cache past %zu ops", batch->n_ops);
+            return -ENOMEM;
+        }
+        batch->ops[batch->n_ops] = copy;
+    }
+
     /* Add operation to cache, the struct is already setted up */
-    ops_cache.n_ops++;
+    const op_t* op = &batch->ops[batch->n_ops];
+    if(_op_get_plain(op)) batch->n_gets++;
+    batch->n_ops++;
 
-    EML_DBG(LOG_TAG, "_add_op: queued op #%zu (dbi=%u type=%d key_kind=%d val_kind=%d)",
-            ops_cache.n_ops - 1, operation->dbi, (int)operation->type, operation->key.kind,
-            operation->val.kind);
+    DB_HOT_DBG(LOG_TAG, "_add_op: queued op #%zu (dbi=%u type=%d key_kind=%d val_kind=%d)",
+               batch->n_ops - 1, op->dbi, (int)op->type, op->key.kind, op->val.kind);
 
     return 0;
 }
 
-int _exec_rw_ops(void)
+static int _exec_rw_ops(batch_t* batch)
 {
     /* Init retry count and result variable */
-    int retry_count = 0;
-    int res         = -1;
+    int      retry_count = 0;
+    unsigned full_count  = 0;
+    int      res         = -1;
     /* Init transaction */
-    MDB_txn* txn    = NULL;
+    MDB_txn* txn         = NULL;
+    /* Phase timings, only taken when someone listens */
+    const int  tracing = ops_trace_on();
+    db_trace_t trace   = { .batch = batch, .rw = 1, .n_ops = batch->n_ops };
+    size_t     pgno0   = 0;
+    ops_trace_mark(tracing, &trace.t_start);
+    OPS_TRACE_PROBE(batch_start, batch, 1, batch->n_ops);
+
+    /* Cached values of the written keys are off limits until the end */
+    ops_batch_cache_begin(batch);
+
+    /* GETs are replayed from their queued val */
+    res = _vals_save(batch);
+    if(res != 0) goto fail;
 
 retry:
 {
@@ -163,34 +467,62 @@ retry:
         goto fail;
     }
 
+    /* GET results and cursors of an aborted attempt are stale, drop them */
+    ops_arena_reset(&batch->rw_cache);
+    _cursors_unbind(batch);
+    _vals_restore(batch, 0, batch->n_ops);
+    batch->stats.attempts++;
+    batch->stats.segments = 0;
+
+    /* No resize while the txn lives */
+    ops_map_enter();
+
     /* Begin transaction with no flags */
-    switch(act_txn_begin(&txn, _txn_type_from_batch_type(), &res))
+    switch(act_txn_begin(&txn, _txn_type_from_batch_type(batch), &res))
     {
         case DB_SAFETY_SUCCESS:
             break;
         case DB_SAFETY_RETRY:
-            goto retry;
+            goto retry_leave;
         default:
             EML_ERROR(LOG_TAG, "_exec_ops: _txn_begin failed, err=%d", res);
-            goto fail;
+            goto fail_leave;
     }
+    ops_trace_mark(tracing, &trace.t_begun);
+    OPS_TRACE_PROBE(txn_begun, batch, retry_count);
+    /* Writer lock held: the map end only moves with this txn */
+    if(tracing) pgno0 = _trace_last_pgno();
 
-    /* Execute all cached operations */
-    switch(_exec_ops(txn, &res))
+    /* Execution order and append hints depend on what the txn sees */
+    if(batch->sorted)
+    {
+        switch(_plan_sorted(batch, txn, &res))
+        {
+            case DB_SAFETY_SUCCESS:
+                break;
+            case DB_SAFETY_RETRY:
+                goto retry_leave;
+            default:
+                EML_ERROR(LOG_TAG, "_exec_ops: sorted plan failed, err=%d", res);
+                goto fail_leave;
+        }
+    }
+
+    /* Execute all cached operations, long batches in savepoint segments */
+    batch->run_pos = 0;
+    switch(_exec_savepoints(batch, txn, &res))
     {
         case DB_SAFETY_SUCCESS:
-            /* TODO:
-            If get op, and in rw, need to save the result!!! */
-            /* A few cases here:
-            1) get operation, ptr and buf given by the user,
-            write immediately to user's */
             break;
         case DB_SAFETY_RETRY:
-            goto retry;
+            batch->stats.replayed_ops += batch->run_pos;
+            goto retry_leave;
         default:
             EML_ERROR(LOG_TAG, "_exec_ops failed, err=%d", res);
-            goto fail;
+            goto fail_leave;
     }
+    ops_trace_mark(tracing, &trace.t_executed);
+    OPS_TRACE_PROBE(ops_done, batch, retry_count);
 
     /* Commit transaction */
     switch(act_txn_commit(txn, &res))
@@ -198,30 +530,82 @@ retry:
         case DB_SAFETY_SUCCESS:
             break;
         case DB_SAFETY_RETRY:
-            goto retry;
+            goto retry_leave;
         default:
             EML_ERROR(LOG_TAG, "_exec_op: _txn_commit failed, err=%d", res);
-            goto fail;
+            goto fail_leave;
     }
 
-    /* proceed */
-    res = 0;
-    EML_DBG(LOG_TAG, "_exec_ro_ops: RO txn completed, aborted");
+    /* proceed, growing the map before the next txn needs it */
+    if(tracing)
+    {
+        const size_t pgno1 = _trace_last_pgno();
+        trace.dirty_pages  = pgno1 > pgno0 ? pgno1 - pgno0 : 0;
+    }
+    ops_map_leave();
+    ops_batch_cache_end(batch);
+    ops_map_after_commit();
+    _trace_end(&trace, tracing, 0, retry_count);
+    DB_HOT_DBG(LOG_TAG, "_exec_rw_ops: RW txn committed");
+    return 0;
 
 }  // retry
+retry_leave:
+    ops_map_leave();
+    /* MAP_FULL: grow now that this thread is out of the gate */
+    if(res == -ENOSPC && ops_map_on_full(full_count++) != 0)
+    {
+        EML_ERROR(LOG_TAG, "_exec_rw_ops: map cannot grow, err=%d", res);
+        goto fail;
+    }
+    goto retry;
+fail_leave:
+    ops_map_leave();
 fail:
-    /* wipe the cache */
-    memset(&ops_cache, 0, sizeof(batch_t));
+    ops_batch_cache_end(batch);
+    _trace_end(&trace, tracing, res, retry_count);
     return res;
 }
 
-int _exec_ro_ops(void)
+static int _exec_ro_ops(batch_t* batch, MDB_txn** out_lease)
 {
     /* Init retry count and result variable */
     int retry_count = 0;
     int res         = -1;
     /* Init transaction */
     MDB_txn* txn    = NULL;
+    /* Phase timings, only taken when someone listens */
+    const int  tracing = ops_trace_on();
+    db_trace_t trace   = { .batch = batch, .rw = 0, .n_ops = batch->n_ops };
+    ops_trace_mark(tracing, &trace.t_start);
+    OPS_TRACE_PROBE(batch_start, batch, 0, batch->n_ops);
+
+    /* GETs are replayed from their queued val */
+    res = _vals_save(batch);
+    if(res != 0)
+    {
+        _trace_end(&trace, tracing, res, 0);
+        return res;
+    }
+
+    /* A GET the Bloom filter rules out fails the batch: no txn either */
+    if(_exec_absent(batch))
+    {
+        _trace_end(&trace, tracing, -ENOENT, 0);
+        DB_HOT_DBG(LOG_TAG, "_exec_ro_ops: key ruled out by the Bloom filter");
+        return -ENOENT;
+    }
+
+    /* All hot: no txn at all. Leased views keep the txn path */
+    if(!out_lease && _exec_cached(batch))
+    {
+        _trace_end(&trace, tracing, 0, 0);
+        DB_HOT_DBG(LOG_TAG, "_exec_ro_ops: served from the value cache");
+        return 0;
+    }
+
+    /* No resize while the snapshot lives, leases keep the gate */
+    ops_map_enter();
 retry:
 {
     /* Check retry and increase */
@@ -232,8 +616,15 @@ retry:
         goto fail;
     }
 
-    /* Begin transaction with RO flags */
-    switch(act_txn_begin(&txn, _txn_type_from_batch_type(), &res))
+    /* Cursors of an aborted attempt need a renew */
+    _cursors_unbind(batch);
+    _vals_restore(batch, 0, batch->n_ops);
+    batch->stats.attempts++;
+
+    /* Begin transaction with RO flags, renewing the parked one if any.
+    The cache window opens first, see ops_vcache_read_begin */
+    ops_vcache_read_begin();
+    switch(act_txn_ro_begin(&txn, &res))
     {
         case DB_SAFETY_SUCCESS:
             break;
@@ -243,165 +634,1094 @@ retry:
             EML_ERROR(LOG_TAG, "_exec_ro_ops: _txn_begin failed, err=%d", res);
             goto fail;
     }
+    ops_trace_mark(tracing, &trace.t_begun);
+    OPS_TRACE_PROBE(txn_begun, batch, retry_count);
 
     /* Execute all cached operations */
-    switch(_exec_ops(txn, &res))
+    batch->run_pos = 0;
+    switch(_exec_ops(batch, txn, 0, batch->n_ops, &res))
     {
         case DB_SAFETY_SUCCESS:
             break;
         case DB_SAFETY_RETRY:
+            batch->stats.replayed_ops += batch->run_pos;
             goto retry;
         default:
             EML_ERROR(LOG_TAG, "_exec_ro_ops failed, err=%d", res);
             goto fail;
     }
+    ops_trace_mark(tracing, &trace.t_executed);
+    OPS_TRACE_PROBE(ops_done, batch, retry_count);
 
-    /*  Abort txn and proceed */
-    mdb_txn_abort(txn);
+    /* Leased: the caller keeps the snapshot alive, views stay valid.
+    Otherwise park txn for the next read and proceed */
+    ops_vcache_read_end();
     res = 0;
-    EML_DBG(LOG_TAG, "_exec_ro_ops: RO txn completed, aborted");
+    if(out_lease)
+    {
+        *out_lease = txn;
+        DB_HOT_DBG(LOG_TAG, "_exec_ro_ops: RO txn completed, leased");
+    }
+    else
+    {
+        act_txn_ro_end(txn);
+        ops_map_leave();
+        DB_HOT_DBG(LOG_TAG, "_exec_ro_ops: RO txn completed, released");
+    }
+    _trace_end(&trace, tracing, res, retry_count);
+    return res;
 
 }  // retry
 fail:
-    /* wipe the cache */
-    memset(&ops_cache, 0, sizeof(batch_t));
+    ops_vcache_read_end();
+    ops_map_leave();
+    _trace_end(&trace, tracing, res, retry_count);
     return res;
 }
 
-int ops_execute_operations(void)
+int ops_execute_operations(batch_t* batch)
 {
-    if(ops_cache.n_ops == 0)
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_execute_operations: invalid input");
+        return -EINVAL;
+    }
+
+    if(batch->n_ops == 0)
     {
         EML_ERROR(LOG_TAG, "ops_execute_operations: no ops in cache to execute");
         return -EINVAL;
     }
 
+    if(batch->lease)
+    {
+        EML_ERROR(LOG_TAG, "ops_execute_operations: batch holds a read lease");
+        return -EBUSY;
+    }
+
+    /* A lease of this thread keeps the map from growing under the write */
+    if(batch->kind != OPS_BATCH_KIND_RO && ops_map_held())
+    {
+        EML_ERROR(LOG_TAG, "ops_execute_operations: write under a read lease of this thread");
+        return -EBUSY;
+    }
+
     /* Init result variable */
     int res = -1;
-    switch(ops_cache.kind)
+    memset(&batch->stats, 0, sizeof(batch->stats));
+    ops_stats_batch(batch->n_ops);
+    switch(batch->kind)
     {
         /* RO ops */
         case OPS_BATCH_KIND_RO:
-            res = _exec_ro_ops();
+            res = _exec_ro_ops(batch, NULL);
             break;
         /* RW ops */
         default:
-            res = _exec_rw_ops();
+            res = _exec_rw_ops(batch);
             break;
     }
 
-    /* wipe the cache */
-    memset(&ops_cache, 0, sizeof(batch_t));
+    /* wipe the cache, keep the ops pool */
+    _cursors_unbind(batch);
+    _batch_reset(batch);
     return res;
 }
 
-/****************************************************************************
- * PRIVATE FUNCTIONS DEFINITIONS
- ****************************************************************************
- */
-static db_security_ret_code_t _exec_ops(MDB_txn* txn, int* const out_err)
+int ops_execute_leased(batch_t* batch, db_view_t* out_views, const size_t n_views)
 {
-    /* Execute all cached operations */
-    for(unsigned int i = 0; i < ops_cache.n_ops; i++)
+    if(!batch || !out_views)
     {
-        switch(_exec_op(txn, &ops_cache.ops[i], out_err))
-        {
-            case DB_SAFETY_SUCCESS:
-                /* Here, in this case, if the op_batch is RW, I should
-                take the "get" result and copy it inside the buff */
-                break;
-            case DB_SAFETY_RETRY:
-                EML_WARN(LOG_TAG, "_exec_op: retry at %u", i);
-                return DB_SAFETY_RETRY;
-            default:
-                EML_ERROR(LOG_TAG, "_exec_op: op %u failed", i);
-                return DB_SAFETY_FAIL;
-        }
-        EML_DBG(LOG_TAG, "_exec_ops: op %u executed successfully", i);
+        EML_ERROR(LOG_TAG, "ops_execute_leased: invalid input");
+        return -EINVAL;
     }
 
-    return DB_SAFETY_SUCCESS;
-}
+    if(batch->n_ops == 0 || n_views < batch->n_ops)
+    {
+        EML_ERROR(LOG_TAG, "ops_execute_leased: bad op count (n_ops=%zu n_views=%zu)",
+                  batch->n_ops, n_views);
+        return -EINVAL;
+    }
 
-/**
- * @brief Allocate a slice from the RW cache.
- *
- * The function advances the internal offset and returns a pointer into
- * ops_cache.rw_cache, or NULL when there is not enough remaining space.
- */
-static void* _rw_cache_alloc(size_t size)
-{
-    /* Zero-sized allocations are treated as no-op. */
-    if(size == 0)
+    if(batch->lease)
     {
-        return NULL;
+        EML_ERROR(LOG_TAG, "ops_execute_leased: batch already holds a read lease");
+        return -EBUSY;
     }
 
-    /* Ensure we do not overflow the fixed cache buffer. */
-    if(size > (DB_LMDB_RW_OPS_CACHE_SIZE - ops_cache.rw_cache_used))
+    /* Only read batches keep a snapshot, writes have to commit */
+    if(batch->kind != OPS_BATCH_KIND_RO)
     {
-        EML_ERROR(LOG_TAG,
-                  "_rw_cache_alloc: insufficient space (requested=%zu used=%zu capacity=%zu)", size,
-                  ops_cache.rw_cache_used, (size_t)DB_LMDB_RW_OPS_CACHE_SIZE);
-        return NULL;
+        EML_ERROR(LOG_TAG, "ops_execute_leased: batch contains write operations");
+        _batch_reset(batch);
+        return -EINVAL;
     }
 
-    char* dst                = ops_cache.rw_cache + ops_cache.rw_cache_used;
-    ops_cache.rw_cache_used += size;
-    return dst;
+    /* One view per op: scans and multi-dup reads fill their own buffers */
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        if(_op_get_plain(&batch->ops[i])) continue;
+
+        EML_ERROR(LOG_TAG, "ops_execute_leased: op %zu is not a plain GET", i);
+        _batch_reset(batch);
+        return -EINVAL;
+    }
+
+    memset(&batch->stats, 0, sizeof(batch->stats));
+    ops_stats_batch(batch->n_ops);
+    int res = _exec_ro_ops(batch, &batch->lease);
+    if(res == 0)
+    {
+        /* act_get left every val PRESENT: in the user buffer, in the map, or
+        decoded in rw_cache. The reset below only rewinds rw_cache and nothing
+        allocates from it again before the lease ends */
+        for(size_t i = 0; i < batch->n_ops; i++)
+        {
+            out_views[i].size = batch->ops[i].val.present.size;
+            out_views[i].data = batch->ops[i].val.present.ptr;
+        }
+    }
+
+    _cursors_unbind(batch);
+    _batch_reset(batch);
+    return res;
 }
 
-static db_security_ret_code_t _exec_op(MDB_txn* txn, op_t* op, int* const out_err)
+void ops_release_leased(batch_t* batch)
 {
-    db_security_ret_code_t ret = DB_SAFETY_FAIL;
+    if(!batch || !batch->lease) return;
 
-    switch((unsigned int)op->type)
-    {
-        case DB_OPERATION_PUT:
-            return act_put(txn, op, out_err);
+    act_txn_ro_end(batch->lease);
+    batch->lease = NULL;
+    ops_map_leave();
+    DB_HOT_DBG(LOG_TAG, "ops_release_leased: read lease released");
+}
 
-        case DB_OPERATION_GET:
-            ret = act_get(txn, op, out_err);
-            /* If GET failed, propagate the safety decision. */
-            if(ret != DB_SAFETY_SUCCESS) return ret;
+int ops_batch_has_writes(const batch_t* batch)
+{
+    return batch && batch->kind == OPS_BATCH_KIND_RW;
+}
 
-            /* In case of RW operation, after a GET, save the result into the cache buffer. */
-            if(ops_cache.kind == OPS_BATCH_KIND_RW)
-            {
-                /* At this point act_get() guarantees PRESENT with a valid pointer/size. */
-                if(!op->val.present.ptr || op->val.present.size == 0)
-                {
-                    EML_ERROR(LOG_TAG,
-                              "_exec_op: GET returned invalid value descriptor (ptr=%p size=%zu)",
-                              op->val.present.ptr, op->val.present.size);
-                    if(out_err) *out_err = -EIO;
-                    return DB_SAFETY_FAIL;
-                }
+void ops_batch_cache_begin(const batch_t* batch)
+{
+    if(!batch) return;
 
-                void* dst = _rw_cache_alloc(op->val.present.size);
-                if(!dst)
-                {
-                    /* Cache is too small for this value. */
-                    if(out_err) *out_err = -ENOMEM;
-                    return DB_SAFETY_FAIL;
-                }
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        const op_t* op = &batch->ops[i];
+        if(!_op_writes(op)) continue;
 
-                /* Copy the obtained value into the RW cache and repoint op->val to it. */
-                memcpy(dst, op->val.present.ptr, op->val.present.size);
-                op->val.present.ptr = dst;
-            }
+        ops_vcache_write_begin(op->dbi);
+        for(unsigned t = ops_index_targets(op->dbi), d = 0; t; t >>= 1, d++)
+        {
+            if(t & 1u) ops_vcache_write_begin(d);
+        }
+        const int queue = _op_ttl_queue(op);
+        if(queue >= 0) ops_vcache_write_begin((unsigned)queue);
+    }
+}
 
-            /* Value is now stable (either in user buffer or internal cache). */
-            return DB_SAFETY_SUCCESS;
+void ops_batch_cache_end(const batch_t* batch)
+{
+    if(!batch) return;
 
-            // case DB_OPERATION_REP:
-            //     return _op_rep(txn, op);
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        const op_t* op = &batch->ops[i];
+        if(!_op_writes(op)) continue;
 
-            // case DB_OPERATION_DEL:
-            //     return _op_del(txn, op);
+        /* Looked up keys and ranges drop the whole DBI */
+        if(op->key.kind == OP_KEY_KIND_PRESENT && !(op->flags & OP_FLAG_RANGE))
+        {
+            ops_vcache_write_end(op->dbi, op->key.present.ptr, op->key.present.size);
+        }
+        else
+        {
+            ops_vcache_write_end(op->dbi, NULL, 0);
+        }
 
-        default:
-            EML_ERROR(LOG_TAG, "_exec_op: invalid op type=%d", op->type);
-            return DB_SAFETY_FAIL;
+        /* Index keys are only known to the txn */
+        for(unsigned t = ops_index_targets(op->dbi), d = 0; t; t >>= 1, d++)
+        {
+            if(t & 1u) ops_vcache_write_end(d, NULL, 0);
+        }
+        const int queue = _op_ttl_queue(op);
+        if(queue >= 0) ops_vcache_write_end((unsigned)queue, NULL, 0);
+    }
+}
+
+db_security_ret_code_t ops_execute_nested(batch_t* batch, MDB_txn* parent, int* const out_err)
+{
+    if(!batch || !parent || batch->n_ops == 0 || batch->lease)
+    {
+        EML_ERROR(LOG_TAG, "ops_execute_nested: invalid input");
+        if(out_err) *out_err = (batch && batch->lease) ? -EBUSY : -EINVAL;
+        return DB_SAFETY_FAIL;
+    }
+
+    /* Same clean slate as a retry of _exec_rw_ops, the parent may replay it */
+    if(_vals_save(batch) != 0)
+    {
+        if(out_err) *out_err = -ENOMEM;
+        return DB_SAFETY_FAIL;
+    }
+    ops_arena_reset(&batch->rw_cache);
+    _cursors_unbind(batch);
+    _vals_restore(batch, 0, batch->n_ops);
+    memset(&batch->stats, 0, sizeof(batch->stats));
+    batch->stats.attempts = 1;
+    ops_stats_batch(batch->n_ops);
+
+    MDB_txn*               txn = NULL;
+    db_security_ret_code_t ret = act_txn_nested_begin(parent, &txn, out_err);
+    if(ret != DB_SAFETY_SUCCESS) return ret;
+
+    /* Cursors are opened in the child; LMDB frees them with it */
+    if(batch->sorted) ret = _plan_sorted(batch, txn, out_err);
+    if(ret == DB_SAFETY_SUCCESS) ret = _exec_ops(batch, txn, 0, batch->n_ops, out_err);
+    if(ret == DB_SAFETY_SUCCESS) ret = act_txn_commit(txn, out_err);
+
+    _cursors_unbind(batch);
+    return ret;
+}
+
+void ops_batch_clear(batch_t* batch)
+{
+    if(!batch) return;
+
+    _cursors_unbind(batch);
+    _batch_reset(batch);
+}
+
+int ops_batch_prepare(batch_t* batch)
+{
+    if(!batch || batch->n_ops == 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_prepare: invalid input");
+        return -EINVAL;
+    }
+
+    if(batch->lease || batch->n_plan)
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_prepare: batch leased or already prepared");
+        return -EBUSY;
+    }
+
+    /* Check everything exec would trip on, once */
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        op_t* op = &batch->ops[i];
+        if(DataBase && DataBase->dbis && op->dbi >= DataBase->n_dbis)
+        {
+            EML_ERROR(LOG_TAG, "ops_batch_prepare: op %zu has invalid dbi %u", i, op->dbi);
+            return -EINVAL;
+        }
+        if(_plan_flatten(batch->ops, i, &op->key) != 0 ||
+           _plan_flatten(batch->ops, i, &op->val) != 0)
+        {
+            EML_ERROR(LOG_TAG, "ops_batch_prepare: op %zu has a broken lookup", i);
+            return -EINVAL;
+        }
+    }
+
+    if(batch->plan_cap < batch->n_ops)
+    {
+        op_t* grown = realloc(batch->plan, batch->n_ops * sizeof(op_t));
+        if(!grown)
+        {
+            EML_ERROR(LOG_TAG, "ops_batch_prepare: realloc(%zu ops) failed", batch->n_ops);
+            return -ENOMEM;
+        }
+        batch->plan     = grown;
+        batch->plan_cap = batch->n_ops;
+    }
+
+    memcpy(batch->plan, batch->ops, batch->n_ops * sizeof(op_t));
+    batch->n_plan    = batch->n_ops;
+    batch->plan_kind = batch->kind;
+    batch->plan_gets = batch->n_gets;
+    EML_DBG(LOG_TAG, "ops_batch_prepare: %zu ops prepared", batch->n_plan);
+    return 0;
+}
+
+int ops_batch_bind(batch_t* batch, const size_t op_idx, const void* key, const size_t key_size,
+                   const void* val, const size_t val_size)
+{
+    if(!batch || op_idx >= batch->n_plan || (key && key_size == 0) || (val && val_size == 0))
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_bind: invalid input");
+        return -EINVAL;
+    }
+
+    if(batch->lease) return -EBUSY;
+
+    op_t* op = &batch->plan[op_idx];
+
+    /* Lookups stay wired to their source, special ops own their val */
+    if(key && op->key.kind != OP_KEY_KIND_PRESENT) return -EINVAL;
+    if(val && (op->val.kind == OP_KEY_KIND_LOOKUP || op->type == DB_OPERATION_LST ||
+               (op->flags & (OP_FLAG_MULTIPLE | OP_FLAG_RESERVE)) || op->patch))
+    {
+        return -EINVAL;
+    }
+
+    const op_key_t prev_key = op->key;
+    const op_key_t prev_val = op->val;
+    if(key)
+    {
+        op->key.present.ptr  = (void*)key;
+        op->key.present.size = key_size;
+    }
+    if(val)
+    {
+        op->val.kind         = OP_KEY_KIND_PRESENT;
+        op->val.present.ptr  = (void*)val;
+        op->val.present.size = val_size;
+    }
+
+    /* Same rule as _add_op: the old binding stays on a refused size */
+    if(!_op_int_sizes_ok(op))
+    {
+        EML_ERROR(LOG_TAG, "ops_batch_bind: key or dup size is not an integer one (dbi=%u)",
+                  op->dbi);
+        op->key = prev_key;
+        op->val = prev_val;
+        return -EINVAL;
+    }
+
+    /* The armed copy runs next */
+    batch->ops[op_idx].key = op->key;
+    batch->ops[op_idx].val = op->val;
+    batch->vals_saved      = 0;
+    return 0;
+}
+
+void ops_batch_unprepare(batch_t* batch)
+{
+    if(!batch) return;
+
+    batch->n_plan = 0;
+    _cursors_unbind(batch);
+    _batch_reset(batch);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+static db_security_ret_code_t _exec_ops(batch_t* batch, MDB_txn* txn, const size_t from,
+                                        const size_t to, int* const out_err)
+{
+    /* Sorted batches run through their plan, others in insertion order */
+    const size_t* order = batch->planned ? batch->order : NULL;
+
+    /* Execute cached operations [from, to) of the execution order */
+    for(size_t i = from; i < to; i++)
+    {
+        op_t*          op = &batch->ops[order ? order[i] : i];
+        const uint64_t t0 = ops_stats_now();
+        batch->run_pos    = i;
+        switch(_exec_op(batch, txn, op, out_err))
+        {
+            case DB_SAFETY_SUCCESS:
+                ops_stats_lat(_op_lat(op), t0);
+                break;
+            case DB_SAFETY_RETRY:
+                EML_WARN(LOG_TAG, "_exec_op: retry at %zu", i);
+                return DB_SAFETY_RETRY;
+            default:
+                EML_ERROR(LOG_TAG, "_exec_op: op %zu failed", i);
+                return DB_SAFETY_FAIL;
+        }
+        DB_HOT_DBG(LOG_TAG, "_exec_ops: op %zu executed successfully", i);
+    }
+
+    batch->run_pos = to;
+    return DB_SAFETY_SUCCESS;
+}
+
+/**
+ * @brief Run the ops of a write batch in @p txn, one child txn per segment.
+ *
+ * A segment that hits a retryable error is aborted alone and replayed from
+ * its first op; the work of the committed segments stays in @p txn. MAP_FULL
+ * and hard failures abort @p txn and go back to the caller, which owns the
+ * map growth and the whole-txn retry. Short batches and WRITEMAP envs (no
+ * nested txns there) run flat.
+ */
+static db_security_ret_code_t _exec_savepoints(batch_t* batch, MDB_txn* txn, int* const out_err)
+{
+    const size_t seg = batch->segment_ops ? batch->segment_ops : DB_LMDB_EXEC_SEGMENT_OPS;
+    if(batch->n_ops <= seg || (DataBase->env_flags & MDB_WRITEMAP))
+    {
+        return _exec_ops(batch, txn, 0, batch->n_ops, out_err);
+    }
+
+    size_t from  = 0;
+    int    tries = 0;
+    while(from < batch->n_ops)
+    {
+        const size_t to = (batch->n_ops - from > seg) ? from + seg : batch->n_ops;
+
+        /* Replay point: GET results of the segment live past this mark */
+        const ops_arena_mark_t mark  = ops_arena_mark(&batch->rw_cache);
+        MDB_txn*               child = NULL;
+
+        /* The parent is unusable while the child lives, so are its cursors */
+        _cursors_unbind(batch);
+        db_security_ret_code_t ret = act_txn_nested_begin(txn, &child, out_err);
+        if(ret == DB_SAFETY_SUCCESS) ret = _exec_ops(batch, child, from, to, out_err);
+        if(ret == DB_SAFETY_SUCCESS) ret = act_txn_commit(child, out_err);
+        _cursors_unbind(batch);
+
+        if(ret == DB_SAFETY_SUCCESS)
+        {
+            batch->stats.segments++;
+            from  = to;
+            tries = 0;
+            continue;
+        }
+
+        /* The child is gone, the parent still holds the previous segments */
+        if(ret == DB_SAFETY_RETRY && *out_err != -ENOSPC && ++tries < DB_LMDB_RETRY_OPS_EXEC)
+        {
+            EML_WARN(LOG_TAG, "_exec_savepoints: replaying ops [%zu, %zu)", from, to);
+            batch->stats.seg_retries++;
+            batch->stats.replayed_ops += batch->run_pos - from;
+            _vals_restore(batch, from, to);
+            ops_arena_rewind(&batch->rw_cache, &mark);
+            continue;
+        }
+
+        mdb_txn_abort(txn);
+        return ret;
+    }
+
+    return DB_SAFETY_SUCCESS;
+}
+
+/**
+ * @brief Snapshot the vals of the plain GETs before their first execution.
+ *
+ * A GET replaces its val with the result, so without the snapshot a replay
+ * would read through a pointer of the aborted txn and lose the user buffer.
+ *
+ * @return 0 on success, -ENOMEM when the snapshot cannot be allocated.
+ */
+static int _vals_save(batch_t* batch)
+{
+    if(batch->n_gets == 0 || batch->vals_saved) return 0;
+
+    if(batch->vals_cap < batch->ops_cap)
+    {
+        op_key_t* grown = realloc(batch->vals_in, batch->ops_cap * sizeof(op_key_t));
+        if(!grown)
+        {
+            EML_ERROR(LOG_TAG, "_vals_save: realloc(%zu vals) failed", batch->ops_cap);
+            return -ENOMEM;
+        }
+        batch->vals_in  = grown;
+        batch->vals_cap = batch->ops_cap;
+    }
+
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        if(_op_get_plain(&batch->ops[i])) batch->vals_in[i] = batch->ops[i].val;
+    }
+    batch->vals_saved = 1;
+    return 0;
+}
+
+/**
+ * @brief Put back the queued vals of the GETs at positions [from, to).
+ */
+static void _vals_restore(batch_t* batch, const size_t from, const size_t to)
+{
+    if(!batch->vals_saved) return;
+
+    const size_t* order = batch->planned ? batch->order : NULL;
+    for(size_t k = from; k < to; k++)
+    {
+        const size_t i = order ? order[k] : k;
+        if(_op_get_plain(&batch->ops[i])) batch->ops[i].val = batch->vals_in[i];
+    }
+}
+
+/**
+ * @brief Allocate a slice from the RW cache.
+ *
+ * The slice comes from the batch arena, which links a new slab when the
+ * current ones are exhausted. Returns NULL for zero-sized requests or when
+ * memory cannot be obtained.
+ */
+static void* _rw_cache_alloc(batch_t* batch, size_t size)
+{
+    /* Zero-sized allocations are treated as no-op. */
+    if(size == 0)
+    {
+        return NULL;
+    }
+
+    void* dst = ops_arena_alloc(&batch->rw_cache, size);
+    if(!dst)
+    {
+        EML_ERROR(LOG_TAG, "_rw_cache_alloc: allocation failed (requested=%zu used=%zu)", size,
+                  batch->rw_cache.used);
+    }
+    return dst;
+}
+
+/**
+ * @brief Make sure the batch has room for at least @p n_ops operations.
+ *
+ * The pool grows geometrically from DB_LMDB_BATCH_OPS_INIT and is capped
+ * by the runtime limit. It is never shrunk, so once a batch has seen its
+ * steady-state size no further allocation happens.
+ */
+static int _ops_reserve(batch_t* batch, size_t n_ops)
+{
+    /* First: a lowered limit also holds for a pool grown before it */
+    const size_t max_ops = batch->max_ops ? batch->max_ops : ops_batch_max_ops;
+    if(n_ops > max_ops)
+    {
+        EML_ERROR(LOG_TAG, "_ops_reserve: batch limit reached (requested=%zu max=%zu)", n_ops,
+                  max_ops);
+        return -ENOMEM;
+    }
+    if(n_ops <= batch->ops_cap) return 0;
+
+    size_t new_cap = batch->ops_cap ? batch->ops_cap : DB_LMDB_BATCH_OPS_INIT;
+    while(new_cap < n_ops)
+    {
+        new_cap *= 2;
+    }
+    if(new_cap > max_ops) new_cap = max_ops;
+
+    /* Lookups are resolved by relative index, moving the array is safe */
+    op_t* new_ops = realloc(batch->ops, new_cap * sizeof(op_t));
+    if(!new_ops)
+    {
+        EML_ERROR(LOG_TAG, "_ops_reserve: realloc(%zu ops) failed", new_cap);
+        return -ENOMEM;
+    }
+
+    EML_DBG(LOG_TAG, "_ops_reserve: ops pool grown %zu -> %zu", batch->ops_cap, new_cap);
+    batch->ops     = new_ops;
+    batch->ops_cap = new_cap;
+    return 0;
+}
+
+/**
+ * @brief Empty the batch while keeping its ops pool and RW cache slabs.
+ *
+ * Only counters are rewound; the payload memory is not touched.
+ */
+static void _batch_reset(batch_t* batch)
+{
+    batch->kind       = OPS_BATCH_KIND_RO;
+    batch->n_ops      = 0;
+    batch->planned    = 0;
+    batch->n_gets     = 0;
+    batch->vals_saved = 0;
+    ops_arena_reset(&batch->rw_cache);
+
+    /* Prepared batches re-arm instead: one copy, no per-op checks */
+    if(batch->n_plan)
+    {
+        memcpy(batch->ops, batch->plan, batch->n_plan * sizeof(op_t));
+        batch->kind   = batch->plan_kind;
+        batch->n_ops  = batch->n_plan;
+        batch->n_gets = batch->plan_gets;
+    }
+}
+
+/**
+ * @brief Point the LOOKUP descriptor @p desc of op @p i straight at its source.
+ *
+ * Ops before @p i are already flattened, so the source of a lookup is at
+ * most one hop away from the PRESENT (or GET result) descriptor that ends
+ * the chain. The lookup is rewritten to that descriptor, which leaves
+ * _resolve_desc a single step at execution time.
+ *
+ * @return 0 on success, -EINVAL on a self or out of range reference, an
+ *         unknown source, or a chain ending in a val no op produces.
+ */
+static int _plan_flatten(const op_t* ops, const size_t i, op_key_t* desc)
+{
+    if(desc->kind != OP_KEY_KIND_LOOKUP) return 0;
+
+    size_t          at  = i;
+    const op_key_t* src = desc;
+    while(src->kind == OP_KEY_KIND_LOOKUP)
+    {
+        /* Strictly backwards: no cycles */
+        if(src->lookup.op_index == 0 || src->lookup.op_index > at) return -EINVAL;
+        at -= src->lookup.op_index;
+
+        switch(src->lookup.src_type)
+        {
+            case OP_KEY_SRC_KEY:
+                src = &ops[at].key;
+                break;
+            case OP_KEY_SRC_VAL:
+                src = &ops[at].val;
+                break;
+            default:
+                return -EINVAL;
+        }
+    }
+
+    /* Only a plain GET fills an empty val */
+    if(src->kind != OP_KEY_KIND_PRESENT &&
+       !(src == &ops[at].val && src->kind == OP_KEY_KIND_NONE && _op_get_plain(&ops[at])))
+    {
+        return -EINVAL;
+    }
+
+    desc->lookup.op_index = (unsigned int)(i - at);
+    desc->lookup.src_type = (src == &ops[at].key) ? OP_KEY_SRC_KEY : OP_KEY_SRC_VAL;
+    return 0;
+}
+
+/**
+ * @brief Return the cursor slot of @p batch for DBI @p dbi, ready for @p txn.
+ *
+ * A read cursor left by a previous txn is renewed into a read @p txn and
+ * closed otherwise; the slot is then NULL and the caller opens a cursor.
+ *
+ * @return Pointer to the slot, NULL when the table cannot grow.
+ */
+static MDB_cursor** _batch_cursor(batch_t* batch, MDB_txn* txn, const unsigned dbi)
+{
+    if(dbi >= batch->n_cursors)
+    {
+        batch_cursor_t* grown = realloc(batch->cursors, (dbi + 1) * sizeof(batch_cursor_t));
+        if(!grown)
+        {
+            EML_ERROR(LOG_TAG, "_batch_cursor: realloc(%u cursors) failed", dbi + 1);
+            return NULL;
+        }
+        memset(grown + batch->n_cursors, 0,
+               (dbi + 1 - batch->n_cursors) * sizeof(batch_cursor_t));
+        batch->cursors   = grown;
+        batch->n_cursors = dbi + 1;
     }
+
+    batch_cursor_t* c  = &batch->cursors[dbi];
+    const int       ro = (batch->kind == OPS_BATCH_KIND_RO);
+
+    /* Unbound cursors are always read cursors (see _cursors_unbind) */
+    if(c->cur && !c->bound && !(ro && mdb_cursor_renew(txn, c->cur) == MDB_SUCCESS))
+    {
+        mdb_cursor_close(c->cur);
+        c->cur = NULL;
+    }
+
+    c->ro    = ro;
+    c->bound = 1;
+    return &c->cur;
+}
+
+/**
+ * @brief Detach the cached cursors from the txn that just ended.
+ */
+static void _cursors_unbind(batch_t* batch)
+{
+    for(size_t i = 0; i < batch->n_cursors; i++)
+    {
+        /* Write cursors were freed by LMDB with their txn */
+        if(!batch->cursors[i].ro) batch->cursors[i].cur = NULL;
+        batch->cursors[i].bound = 0;
+    }
+}
+
+/**
+ * @brief Build the execution order of a sorted batch for @p txn.
+ *
+ * Runs of sortable PUTs are merge sorted in place in the order array, then
+ * each DBI group of a run gets append flags when its first key sorts past
+ * the DBI's last key. Without memory for the plan the batch simply runs in
+ * insertion order.
+ */
+static db_security_ret_code_t _plan_sorted(batch_t* batch, MDB_txn* txn, int* const out_err)
+{
+    batch->planned = 0;
+
+    if(batch->n_ops > batch->order_cap)
+    {
+        size_t* grown = realloc(batch->order, 2 * batch->ops_cap * sizeof(size_t));
+        if(!grown)
+        {
+            EML_WARN(LOG_TAG, "_plan_sorted: no memory for %zu ops, insertion order",
+                     batch->n_ops);
+            return DB_SAFETY_SUCCESS;
+        }
+        batch->order     = grown;
+        batch->order_cap = batch->ops_cap;
+    }
+
+    /* Identity order, hints of a previous attempt cleared */
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        batch->order[i] = i;
+        batch->ops[i].flags &= ~(unsigned)(OP_FLAG_APPEND | OP_FLAG_APPENDDUP);
+    }
+
+    size_t i = 0;
+    while(i < batch->n_ops)
+    {
+        if(!_op_sortable(&batch->ops[i]))
+        {
+            i++;
+            continue;
+        }
+
+        /* [i, j) is a run of independent PUTs */
+        size_t j = i + 1;
+        while(j < batch->n_ops && _op_sortable(&batch->ops[j]))
+        {
+            j++;
+        }
+        if(j - i < 2)
+        {
+            i = j;
+            continue;
+        }
+
+        _sort_run(txn, batch->ops, batch->order + i, batch->order + batch->order_cap, j - i);
+
+        /* Append hints, one DBI group at a time */
+        int append = 0;
+        for(size_t k = i; k < j; k++)
+        {
+            op_t* op   = &batch->ops[batch->order[k]];
+            op_t* prev = (k > i) ? &batch->ops[batch->order[k - 1]] : NULL;
+
+            if(!prev || prev->dbi != op->dbi)
+            {
+                MDB_cursor** cur = _batch_cursor(batch, txn, op->dbi);
+                if(!cur)
+                {
+                    mdb_txn_abort(txn);
+                    if(out_err) *out_err = -ENOMEM;
+                    return DB_SAFETY_FAIL;
+                }
+
+                db_security_ret_code_t ret = act_put_after_last(txn, op, cur, &append, out_err);
+                if(ret != DB_SAFETY_SUCCESS) return ret;
+                if(append) op->flags |= OP_FLAG_APPEND;
+                continue;
+            }
+            if(!append) continue;
+
+            /* -2: new key, -1: next dup of the same key, 0: same record */
+            const int c = act_put_cmp(txn, prev, op);
+            if(c == -2) op->flags |= OP_FLAG_APPEND;
+            else if(c == -1) op->flags |= OP_FLAG_APPENDDUP;
+        }
+
+        i = j;
+    }
+
+    batch->planned = 1;
+    return DB_SAFETY_SUCCESS;
+}
+
+/**
+ * @brief Stable bottom-up merge sort of @p n op indices by act_put_cmp.
+ */
+static void _sort_run(MDB_txn* txn, const op_t* ops, size_t* idx, size_t* tmp, const size_t n)
+{
+    /* Presorted input (time-ordered IDs, bulk loads) costs one pass */
+    size_t k = 1;
+    while(k < n && act_put_cmp(txn, &ops[idx[k - 1]], &ops[idx[k]]) <= 0)
+    {
+        k++;
+    }
+    if(k == n) return;
+
+    size_t* src = idx;
+    size_t* dst = tmp;
+
+    for(size_t width = 1; width < n; width *= 2)
+    {
+        for(size_t lo = 0; lo < n; lo += 2 * width)
+        {
+            size_t mid = (lo + width < n) ? lo + width : n;
+            size_t hi  = (lo + 2 * width < n) ? lo + 2 * width : n;
+            size_t a   = lo;
+            size_t b   = mid;
+            size_t out = lo;
+
+            /* Ties take the left side: equal keys keep insertion order */
+            while(a < mid && b < hi)
+            {
+                if(act_put_cmp(txn, &ops[src[b]], &ops[src[a]]) < 0) dst[out++] = src[b++];
+                else dst[out++] = src[a++];
+            }
+            while(a < mid)
+            {
+                dst[out++] = src[a++];
+            }
+            while(b < hi)
+            {
+                dst[out++] = src[b++];
+            }
+        }
+
+        size_t* swap = src;
+        src          = dst;
+        dst          = swap;
+    }
+
+    if(src != idx) memcpy(idx, src, n * sizeof(size_t));
+}
+
+static db_security_ret_code_t _exec_op(batch_t* batch, MDB_txn* txn, op_t* op,
+                                       int* const out_err)
+{
+    /* Index entries follow the record in the same txn */
+    db_security_ret_code_t ret = (_op_writes(op) && ops_index_targets(op->dbi))
+                                     ? _exec_indexed(batch, txn, op, out_err)
+                                     : _exec_one(batch, txn, op, out_err);
+
+    /* So does the deadline of a TTL put, any other PUT or DEL drops it */
+    if(ret == DB_SAFETY_SUCCESS && (op->flags & OP_FLAG_TTL))
+    {
+        const uint64_t expires = ops_ttl_now_ms() + op->ttl_ms;
+        ret = ops_ttl_arm(txn, op->dbi, act_op_key(op), expires, out_err);
+    }
+    else if(ret == DB_SAFETY_SUCCESS && _op_ttl_queue(op) >= 0 && ops_ttl_armed(op->dbi))
+    {
+        ret = _ttl_disarm(txn, op, out_err);
+    }
+    return ret;
+}
+
+/**
+ * @brief Drop the deadlines of the keys @p op wrote, see @ref ops_ttl_disarm.
+ */
+static db_security_ret_code_t _ttl_disarm(MDB_txn* txn, op_t* op, int* const out_err)
+{
+    if(op->type == DB_OPERATION_DEL && !(op->flags & OP_FLAG_RANGE))
+    {
+        return ops_ttl_disarm_del(txn, op->dbi, act_op_key(op), out_err);
+    }
+    if(!(op->flags & OP_FLAG_RANGE)) return ops_ttl_disarm(txn, op->dbi, act_op_key(op), out_err);
+
+    /* The bounds resolved for the range DEL itself */
+    const MDB_val* start = op->key.kind != OP_KEY_KIND_NONE ? act_op_key(op) : NULL;
+    const MDB_val* end   = op->val.kind != OP_KEY_KIND_NONE ? act_op_val(op) : NULL;
+    return ops_ttl_disarm_range(txn, op->dbi, start, end, out_err);
+}
+
+/**
+ * @brief Write @p op and move the index entries of its record.
+ */
+static db_security_ret_code_t _exec_indexed(batch_t* batch, MDB_txn* txn, op_t* op,
+                                            int* const out_err)
+{
+    /* Would need the index keys of every record in the range */
+    if(op->flags & OP_FLAG_RANGE)
+    {
+        EML_ERROR(LOG_TAG, "_exec_indexed: range DEL on indexed dbi %u", op->dbi);
+        mdb_txn_abort(txn);
+        if(out_err) *out_err = -EOPNOTSUPP;
+        return DB_SAFETY_FAIL;
+    }
+
+    /* A bad key descriptor is reported by the op itself */
+    MDB_val* key = act_op_key(op);
+    if(!key) return _exec_one(batch, txn, op, out_err);
+
+    ops_index_keys_t       old;
+    db_security_ret_code_t ret = ops_index_before(txn, op->dbi, key, &old, out_err);
+    if(ret == DB_SAFETY_SUCCESS) ret = _exec_one(batch, txn, op, out_err);
+    if(ret != DB_SAFETY_SUCCESS) return ret;
+
+    /* A plain PUT wrote the resolved val, the rest is read back */
+    const MDB_val* val =
+        (op->type == DB_OPERATION_PUT && !(op->flags & OP_FLAG_RESERVE)) ? act_op_val(op) : NULL;
+    return ops_index_after(txn, op->dbi, key, val, &old, out_err);
+}
+
+static db_security_ret_code_t _exec_one(batch_t* batch, MDB_txn* txn, op_t* op,
+                                        int* const out_err)
+{
+    db_security_ret_code_t ret = DB_SAFETY_FAIL;
+
+    switch((unsigned int)op->type)
+    {
+        case DB_OPERATION_PUT:
+        {
+            /* The writer fills the page before the next op runs */
+            if(op->flags & OP_FLAG_RESERVE) return act_put_reserve(txn, op, out_err);
+
+            if(!(op->flags & (OP_FLAG_APPEND | OP_FLAG_APPENDDUP | OP_FLAG_MULTIPLE)))
+            {
+                return act_put(txn, op, out_err);
+            }
+
+            /* Appends of a sorted run and multi-dup puts share the DBI cursor */
+            MDB_cursor** cur = _batch_cursor(batch, txn, op->dbi);
+            if(!cur)
+            {
+                mdb_txn_abort(txn);
+                if(out_err) *out_err = -ENOMEM;
+                return DB_SAFETY_FAIL;
+            }
+            if(op->flags & OP_FLAG_MULTIPLE) return act_put_multiple(txn, op, cur, out_err);
+            return act_put_append(txn, op, cur, out_err);
+        }
+
+        case DB_OPERATION_GET:
+            /* Multi-dup reads land straight in the caller's array */
+            if(op->flags & OP_FLAG_MULTIPLE)
+            {
+                MDB_cursor** cur = _batch_cursor(batch, txn, op->dbi);
+                if(!cur)
+                {
+                    mdb_txn_abort(txn);
+                    if(out_err) *out_err = -ENOMEM;
+                    return DB_SAFETY_FAIL;
+                }
+                return act_get_multiple(txn, op, cur, out_err);
+            }
+
+            ret = act_get(txn, op, &batch->rw_cache, out_err);
+            /* If GET failed, propagate the safety decision. */
+            if(ret != DB_SAFETY_SUCCESS) return ret;
+
+            /* In case of RW operation, after a GET, save the result into the cache buffer. */
+            if(batch->kind == OPS_BATCH_KIND_RW)
+            {
+                /* At this point act_get() guarantees PRESENT with a valid pointer/size. */
+                if(!op->val.present.ptr || op->val.present.size == 0)
+                {
+                    EML_ERROR(LOG_TAG,
+                              "_exec_op: GET returned invalid value descriptor (ptr=%p size=%zu)",
+                              op->val.present.ptr, op->val.present.size);
+                    mdb_txn_abort(txn);
+                    if(out_err) *out_err = -EIO;
+                    return DB_SAFETY_FAIL;
+                }
+
+                void* dst = _rw_cache_alloc(batch, op->val.present.size);
+                if(!dst)
+                {
+                    /* Cache is too small for this value. */
+                    mdb_txn_abort(txn);
+                    if(out_err) *out_err = -ENOMEM;
+                    return DB_SAFETY_FAIL;
+                }
+
+                /* Copy the obtained value into the RW cache and repoint op->val to it. */
+                memcpy(dst, op->val.present.ptr, op->val.present.size);
+                ops_stats_rw_cache(op->val.present.size);
+                op->val.present.ptr = dst;
+            }
+
+            /* Value is now stable (either in user buffer or internal cache). */
+            return DB_SAFETY_SUCCESS;
+
+        case DB_OPERATION_REP:
+        {
+            MDB_cursor** cur = _batch_cursor(batch, txn, op->dbi);
+            if(!cur)
+            {
+                mdb_txn_abort(txn);
+                if(out_err) *out_err = -ENOMEM;
+                return DB_SAFETY_FAIL;
+            }
+            return act_rep(txn, op, cur, out_err);
+        }
+
+        case DB_OPERATION_DEL:
+            return act_del(txn, op, out_err);
+
+        case DB_OPERATION_LST:
+        {
+            MDB_cursor** cur = _batch_cursor(batch, txn, op->dbi);
+            if(!cur)
+            {
+                mdb_txn_abort(txn);
+                if(out_err) *out_err = -ENOMEM;
+                return DB_SAFETY_FAIL;
+            }
+            return act_lst(txn, op, cur, out_err);
+        }
+
+        default:
+            EML_ERROR(LOG_TAG, "_exec_op: invalid op type=%d", op->type);
+            mdb_txn_abort(txn);
+            if(out_err) *out_err = -EINVAL;
+            return DB_SAFETY_FAIL;
+    }
+}
+
+/**
+ * @brief Serve a batch of plain GETs into user buffers from the value cache.
+ *
+ * Stops at the first miss, leaving the vals to _vals_restore.
+ *
+ * @return Non-zero when every GET hit.
+ */
+static int _exec_cached(batch_t* batch)
+{
+    if(batch->n_gets != batch->n_ops) return 0;
+
+    size_t i = 0;
+    ops_vcache_read_begin();
+    for(; i < batch->n_ops; i++)
+    {
+        op_t* op = &batch->ops[i];
+        if(op->key.kind != OP_KEY_KIND_PRESENT || op->val.kind != OP_KEY_KIND_PRESENT) break;
+        if(ops_vcache_get(op->dbi, op->key.present.ptr, op->key.present.size,
+                          op->val.present.ptr, &op->val.present.size, 0) != 0)
+        {
+            break;
+        }
+    }
+    ops_vcache_read_end();
+
+    return i == batch->n_ops;
+}
+
+/**
+ * @brief Non-zero when a plain GET of the batch is definitely absent.
+ */
+static int _exec_absent(const batch_t* batch)
+{
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        const op_t* op = &batch->ops[i];
+        if(_op_get_plain(op) && op->key.kind == OP_KEY_KIND_PRESENT &&
+           !ops_bloom_maybe(op->dbi, op->key.present.ptr, op->key.present.size))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static size_t _trace_last_pgno(void)
+{
+    MDB_envinfo info;
+    if(!(DataBase && DataBase->env) || mdb_env_info(DataBase->env, &info) != MDB_SUCCESS)
+    {
+        return 0;
+    }
+    return (size_t)info.me_last_pgno;
+}
+
+static void _trace_end(db_trace_t* trace, const int on, const int result, const int attempts)
+{
+    trace->result  = result;
+    trace->retries = attempts > 0 ? (unsigned)(attempts - 1) : 0u;
+    OPS_TRACE_PROBE(batch_end, trace->batch, trace->rw, result, trace->retries,
+                    trace->dirty_pages);
+    if(!on) return;
+
+    trace->t_end = ops_trace_now();
+    ops_trace_emit(trace);
 }
@@ -0,0 +1,418 @@
+/**
+ * @file ops_group.c
+ *
+ */
+
+#include <errno.h>     /* EINVAL, EALREADY, EINTR, ENOMEM, ENOSPC, ENOTCONN, ENOTSUP */
+#include <pthread.h>   /* pthread_create, pthread_join, pthread_mutex_t */
+#include <sched.h>     /* sched_yield */
+#include <semaphore.h> /* sem_t, sem_init, sem_wait, sem_post */
+#include <stdatomic.h> /* atomic_* */
+#include <stdlib.h>    /* calloc, free */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_GROUP_* */
+#include "ops_actions.h"
+#include "ops_group.h"
+#include "ops_map.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_group"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief One submitted batch, on the producer's stack until completed, or
+ *        on the heap for an async one.
+ */
+typedef struct group_req
+{
+    struct group_req* next;    /**< Next request in the pending list. */
+    batch_t*          batch;   /**< Producer's batch. */
+    int               res;     /**< Result of this batch, set by the writer. */
+    sem_t             done;    /**< Posted by the writer once res is final (sync only). */
+    ops_group_done_fn on_done; /**< Async completion, NULL for a sync request. */
+    void*             ctx;     /**< Context of on_done. */
+} group_req_t;
+
+typedef struct
+{
+    _Atomic(group_req_t*) head;        /**< Lock-free LIFO of submitted requests. */
+    atomic_int            running;     /**< Non-zero while submits go to the writer. */
+    atomic_int            inflight;    /**< Sync producers waiting, async requests pending. */
+    sem_t                 work;        /**< Posted when head turns non-empty, and on stop. */
+    pthread_t             thread;      /**< Writer thread. */
+    group_req_t**         slots;       /**< Requests of the group being run. */
+    size_t                max_batches; /**< Capacity of slots. */
+    /* Counters, written by the writer only */
+    atomic_size_t batches;
+    atomic_size_t failed;
+    atomic_size_t commits;
+    atomic_size_t fallbacks;
+} group_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+static group_t group;
+
+/* Serializes start and stop */
+static pthread_mutex_t group_ctl = PTHREAD_MUTEX_INITIALIZER;
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static void* _writer_main(void* arg);
+
+/**
+ * @brief Run @p n requests in one write txn and complete each of them.
+ */
+static void _run_group(group_req_t** reqs, const size_t n);
+
+static void _push(group_req_t* req);
+
+static void _sem_wait(sem_t* sem);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_group_start(const db_group_cfg_t* cfg)
+{
+    if(!DataBase || !DataBase->env)
+    {
+        EML_ERROR(LOG_TAG, "ops_group_start: database not initialized");
+        return -EINVAL;
+    }
+
+    /* Every batch runs in a child txn, which MDB_WRITEMAP does not allow */
+    if(DataBase->env_flags & MDB_WRITEMAP)
+    {
+        EML_ERROR(LOG_TAG, "ops_group_start: not available with MDB_WRITEMAP");
+        return -ENOTSUP;
+    }
+
+    pthread_mutex_lock(&group_ctl);
+
+    if(atomic_load(&group.running))
+    {
+        pthread_mutex_unlock(&group_ctl);
+        EML_ERROR(LOG_TAG, "ops_group_start: writer already running");
+        return -EALREADY;
+    }
+
+    group.max_batches =
+        (cfg && cfg->max_batches) ? cfg->max_batches : DB_LMDB_GROUP_MAX_BATCHES;
+    group.slots = calloc(group.max_batches, sizeof(group_req_t*));
+    if(!group.slots)
+    {
+        pthread_mutex_unlock(&group_ctl);
+        EML_ERROR(LOG_TAG, "ops_group_start: calloc(%zu slots) failed", group.max_batches);
+        return -ENOMEM;
+    }
+
+    atomic_store(&group.head, NULL);
+    atomic_store(&group.batches, 0);
+    atomic_store(&group.failed, 0);
+    atomic_store(&group.commits, 0);
+    atomic_store(&group.fallbacks, 0);
+    sem_init(&group.work, 0, 0);
+    atomic_store(&group.running, 1);
+
+    int rc = pthread_create(&group.thread, NULL, _writer_main, NULL);
+    if(rc != 0)
+    {
+        atomic_store(&group.running, 0);
+        sem_destroy(&group.work);
+        free(group.slots);
+        group.slots = NULL;
+        pthread_mutex_unlock(&group_ctl);
+        EML_ERROR(LOG_TAG, "ops_group_start: pthread_create failed (%d)", rc);
+        return -rc;
+    }
+
+    pthread_mutex_unlock(&group_ctl);
+    EML_INFO(LOG_TAG, "ops_group_start: writer up, up to %zu batches per txn",
+             group.max_batches);
+    return 0;
+}
+
+int ops_group_submit(batch_t* batch)
+{
+    if(!batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_group_submit: invalid input");
+        return -EINVAL;
+    }
+
+    /* Reads never wait for the writer */
+    if(!ops_batch_has_writes(batch)) return ops_execute_operations(batch);
+
+    /* The writer could not grow the map past a lease of this thread */
+    if(ops_map_held())
+    {
+        EML_ERROR(LOG_TAG, "ops_group_submit: write under a read lease of this thread");
+        return -EBUSY;
+    }
+
+    atomic_fetch_add(&group.inflight, 1);
+    if(!atomic_load(&group.running))
+    {
+        atomic_fetch_sub(&group.inflight, 1);
+        return ops_execute_operations(batch);
+    }
+
+    group_req_t req;
+    req.next    = NULL;
+    req.batch   = batch;
+    req.res     = -EIO;
+    req.on_done = NULL;
+    req.ctx     = NULL;
+    sem_init(&req.done, 0, 0);
+
+    _push(&req);
+    _sem_wait(&req.done);
+
+    sem_destroy(&req.done);
+    atomic_fetch_sub(&group.inflight, 1);
+    return req.res;
+}
+
+int ops_group_submit_async(batch_t* batch, ops_group_done_fn on_done, void* ctx)
+{
+    if(!batch || !on_done)
+    {
+        EML_ERROR(LOG_TAG, "ops_group_submit_async: invalid input");
+        return -EINVAL;
+    }
+
+    /* Counted before the check so that stop waits for this request */
+    atomic_fetch_add(&group.inflight, 1);
+    if(!atomic_load(&group.running))
+    {
+        atomic_fetch_sub(&group.inflight, 1);
+        return -ENOTCONN;
+    }
+
+    group_req_t* req = calloc(1, sizeof(*req));
+    if(!req)
+    {
+        atomic_fetch_sub(&group.inflight, 1);
+        EML_ERROR(LOG_TAG, "ops_group_submit_async: calloc failed");
+        return -ENOMEM;
+    }
+    req->batch   = batch;
+    req->res     = -EIO;
+    req->on_done = on_done;
+    req->ctx     = ctx;
+
+    _push(req);
+    return 0;
+}
+
+void ops_group_stop(void)
+{
+    pthread_mutex_lock(&group_ctl);
+
+    if(!atomic_load(&group.running))
+    {
+        pthread_mutex_unlock(&group_ctl);
+        return;
+    }
+
+    /* New submits run in their own thread; the writer drains the rest */
+    atomic_store(&group.running, 0);
+    sem_post(&group.work);
+    pthread_join(group.thread, NULL);
+
+    sem_destroy(&group.work);
+    free(group.slots);
+    group.slots = NULL;
+
+    pthread_mutex_unlock(&group_ctl);
+    EML_INFO(LOG_TAG, "ops_group_stop: writer down after %zu batches in %zu commits",
+             atomic_load(&group.batches), atomic_load(&group.commits));
+}
+
+void ops_group_stats(db_group_stats_t* out)
+{
+    if(!out) return;
+
+    out->batches   = atomic_load(&group.batches);
+    out->failed    = atomic_load(&group.failed);
+    out->commits   = atomic_load(&group.commits);
+    out->fallbacks = atomic_load(&group.fallbacks);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void* _writer_main(void* arg)
+{
+    (void)arg;
+
+    for(;;)
+    {
+        /* Once stopping, poll instead: the last producers may not post */
+        if(atomic_load(&group.running)) _sem_wait(&group.work);
+
+        /* Take everything pending, then restore submit order */
+        group_req_t* lifo = atomic_exchange(&group.head, NULL);
+        group_req_t* fifo = NULL;
+        while(lifo)
+        {
+            group_req_t* next = lifo->next;
+            lifo->next        = fifo;
+            fifo              = lifo;
+            lifo              = next;
+        }
+
+        while(fifo)
+        {
+            size_t n = 0;
+            while(fifo && n < group.max_batches)
+            {
+                group.slots[n++] = fifo;
+                fifo             = fifo->next;
+            }
+            _run_group(group.slots, n);
+        }
+
+        if(!atomic_load(&group.running))
+        {
+            /* Nobody left inside submit and nothing queued */
+            if(atomic_load(&group.inflight) == 0 && !atomic_load(&group.head)) break;
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void _run_group(group_req_t** reqs, const size_t n)
+{
+    MDB_txn* txn       = NULL;
+    int      err       = 0;
+    int      fallback  = 0;
+    int      committed = 0;
+
+    /* The parent commits for every batch: announce them all up front */
+    for(size_t i = 0; i < n; i++) ops_batch_cache_begin(reqs[i]->batch);
+
+    /* Parent and children live inside the resize gate */
+    ops_map_enter();
+    if(act_txn_begin(&txn, 0, &err) != DB_SAFETY_SUCCESS)
+    {
+        fallback = 1;
+    }
+    else
+    {
+        for(size_t i = 0; i < n && !fallback; i++)
+        {
+            /* A failed child is aborted alone, its neighbours keep going */
+            int                    berr = 0;
+            db_security_ret_code_t ret  = ops_execute_nested(reqs[i]->batch, txn, &berr);
+            reqs[i]->res                = 0;
+            if(ret == DB_SAFETY_SUCCESS) continue;
+
+            /* The map cannot grow under an open txn: redo one by one */
+            if(ret == DB_SAFETY_RETRY || berr == -ENOSPC)
+            {
+                mdb_txn_abort(txn);
+                fallback = 1;
+                break;
+            }
+            reqs[i]->res = berr ? berr : -EIO;
+        }
+
+        if(!fallback)
+        {
+            db_security_ret_code_t ret = act_txn_commit(txn, &err);
+            if(ret == DB_SAFETY_SUCCESS)
+            {
+                atomic_fetch_add(&group.commits, 1);
+                committed = 1;
+            }
+            else if(ret == DB_SAFETY_RETRY || err == -ENOSPC)
+            {
+                fallback = 1;
+            }
+            else
+            {
+                EML_ERROR(LOG_TAG, "_run_group: commit of %zu batches failed (%d)", n, err);
+                for(size_t i = 0; i < n; i++)
+                {
+                    if(reqs[i]->res == 0) reqs[i]->res = err ? err : -EIO;
+                }
+            }
+        }
+    }
+    ops_map_leave();
+
+    /* Committed or not, before a fallback redoes its own */
+    for(size_t i = 0; i < n; i++) ops_batch_cache_end(reqs[i]->batch);
+
+    /* Out of the gate: grow the map ahead of the next group */
+    if(committed) ops_map_after_commit();
+
+    if(fallback)
+    {
+        EML_WARN(LOG_TAG, "_run_group: group of %zu batches redone one by one", n);
+        atomic_fetch_add(&group.fallbacks, 1);
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        /* Own txn, own retries and map growth; the batch is reset either way */
+        if(fallback) reqs[i]->res = ops_execute_operations(reqs[i]->batch);
+        else ops_batch_clear(reqs[i]->batch);
+
+        atomic_fetch_add(&group.batches, 1);
+        if(reqs[i]->res != 0) atomic_fetch_add(&group.failed, 1);
+
+        /* Async requests are ours to free; sync ones live on the producer's stack */
+        if(reqs[i]->on_done)
+        {
+            group_req_t* req = reqs[i];
+            req->on_done(req->batch, req->res, req->ctx);
+            free(req);
+            atomic_fetch_sub(&group.inflight, 1);
+            continue;
+        }
+        sem_post(&reqs[i]->done);
+    }
+
+    EML_DBG(LOG_TAG, "_run_group: %zu batches done (fallback=%d)", n, fallback);
+}
+
+static void _push(group_req_t* req)
+{
+    group_req_t* old = atomic_load(&group.head);
+    do
+    {
+        req->next = old;
+    } while(!atomic_compare_exchange_weak(&group.head, &old, req));
+
+    /* Only the first request of an empty list wakes the writer */
+    if(!old) sem_post(&group.work);
+}
+
+static void _sem_wait(sem_t* sem)
+{
+    while(sem_wait(sem) != 0 && errno == EINTR)
+    {
+    }
+}
@@ -0,0 +1,295 @@
+/**
+ * @file ops_index.c
+ *
+ */
+
+#include <errno.h>  /* EEXIST, EINVAL, ENOSPC */
+#include <string.h> /* memcmp, memset */
+
+#include "common.h" /* EML_* macros, LMDB_EML_* */
+#include "db.h"     /* DataBase */
+#include "ops_bloom.h"
+#include "ops_index.h"
+#include "ops_zip.h" /* ops_zip_on, ops_zip_view */
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_index"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+/* Registered indexes, in registration order */
+static db_index_t indexes[DB_LMDB_INDEX_MAX];
+static size_t     n_indexes = 0;
+
+/* Index DBIs fed by each DBI, one bit per DBI index */
+static unsigned targets[DB_MAX_DBIS];
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static int _index_key(const db_index_t* index, const MDB_val* key, const MDB_val* val,
+                      unsigned char* out, size_t* out_size);
+static int _keys_of(const unsigned dbi, const MDB_val* key, const MDB_val* val,
+                    ops_index_keys_t* out);
+static int _unlink(MDB_txn* txn, const db_index_t* index, const void* ik, const size_t ik_size,
+                   const MDB_val* key);
+static int _link(MDB_txn* txn, const db_index_t* index, const void* ik, const size_t ik_size,
+                 const MDB_val* key);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_index_add(const db_index_t* index)
+{
+    if(!DataBase || !DataBase->dbis || !index || !index->index_key ||
+       index->src_dbi >= DataBase->n_dbis || index->idx_dbi >= DataBase->n_dbis ||
+       index->src_dbi == index->idx_dbi || DataBase->dbis[index->src_dbi].is_dupsort ||
+       ops_zip_on(index->idx_dbi))
+    {
+        EML_ERROR(LOG_TAG, "ops_index_add: invalid index");
+        return -EINVAL;
+    }
+
+    /* No chains: index writes are not indexed again */
+    const unsigned src     = index->src_dbi;
+    const unsigned idx     = index->idx_dbi;
+    unsigned       chained = targets[idx];
+    for(unsigned i = 0; i < DB_MAX_DBIS; i++) chained |= targets[i] & (1u << src);
+    if(chained)
+    {
+        EML_ERROR(LOG_TAG, "ops_index_add: dbi %u and %u would chain indexes", src, idx);
+        return -EINVAL;
+    }
+    if(targets[src] & (1u << idx))
+    {
+        EML_ERROR(LOG_TAG, "ops_index_add: dbi %u already indexed into %u", src, idx);
+        return -EEXIST;
+    }
+
+    size_t per_dbi = 0;
+    for(size_t i = 0; i < n_indexes; i++) per_dbi += indexes[i].src_dbi == src;
+    if(n_indexes == DB_LMDB_INDEX_MAX || per_dbi == DB_LMDB_INDEX_PER_DBI)
+    {
+        EML_ERROR(LOG_TAG, "ops_index_add: too many indexes (%zu, %zu on dbi %u)", n_indexes,
+                  per_dbi, src);
+        return -ENOSPC;
+    }
+
+    indexes[n_indexes++] = *index;
+    targets[src] |= 1u << idx;
+    EML_INFO(LOG_TAG, "ops_index_add: dbi %u indexed into dbi %u", src, idx);
+    return 0;
+}
+
+void ops_index_reset(void)
+{
+    memset(indexes, 0, sizeof(indexes));
+    memset(targets, 0, sizeof(targets));
+    n_indexes = 0;
+}
+
+unsigned ops_index_targets(const unsigned dbi)
+{
+    return dbi < DB_MAX_DBIS ? targets[dbi] : 0u;
+}
+
+db_security_ret_code_t ops_index_before(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                        ops_index_keys_t* old, int* const out_err)
+{
+    /* Check input */
+    if(!txn || !key || !old || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_index_before: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    MDB_val val;
+    int     mdb_res = mdb_get(txn, DataBase->dbis[dbi].dbi, (MDB_val*)key, &val);
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    /* Callbacks see the value, not its frame */
+    int rc = 0;
+    if(mdb_res == MDB_SUCCESS && ops_zip_on(dbi)) rc = ops_zip_view(dbi, &val, &val);
+    if(rc == 0) rc = _keys_of(dbi, key, mdb_res == MDB_SUCCESS ? &val : NULL, old);
+    if(rc < 0) return security_abort_txn(txn, rc, out_err);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_index_after(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                       const MDB_val* val, const ops_index_keys_t* old,
+                                       int* const out_err)
+{
+    /* Check input */
+    if(!txn || !key || !old || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_index_after: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    MDB_val cur;
+    if(!val)
+    {
+        int mdb_res = mdb_get(txn, DataBase->dbis[dbi].dbi, (MDB_val*)key, &cur);
+        if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+        {
+            return security_fail_txn(mdb_res, txn, out_err);
+        }
+        if(mdb_res == MDB_SUCCESS) val = &cur;
+    }
+
+    /* All keys first: the index writes may spill the page val points into */
+    ops_index_keys_t now;
+    int              rc = 0;
+    if(val == &cur && ops_zip_on(dbi)) rc = ops_zip_view(dbi, &cur, &cur);
+    if(rc == 0) rc = _keys_of(dbi, key, val, &now);
+    if(rc < 0) return security_abort_txn(txn, rc, out_err);
+
+    size_t j = 0;
+    for(size_t i = 0; i < n_indexes && rc == 0; i++)
+    {
+        const db_index_t* index = &indexes[i];
+        if(index->src_dbi != dbi) continue;
+
+        const int same = old->has[j] && now.has[j] && old->size[j] == now.size[j] &&
+                         memcmp(old->key[j], now.key[j], now.size[j]) == 0;
+        if(!same && old->has[j]) rc = _unlink(txn, index, old->key[j], old->size[j], key);
+        if(!same && now.has[j] && rc == 0) rc = _link(txn, index, now.key[j], now.size[j], key);
+        j++;
+    }
+    if(rc != 0) return security_fail_txn(rc, txn, out_err);
+    return DB_SAFETY_SUCCESS;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+/**
+ * @brief Run the callback of @p index and check what it wrote.
+ *
+ * @return 0 with a key, 1 when not indexed, a negative errno.
+ */
+static int _index_key(const db_index_t* index, const MDB_val* key, const MDB_val* val,
+                      unsigned char* out, size_t* out_size)
+{
+    const db_view_t k = { key->mv_size, key->mv_data };
+    const db_view_t v = { val->mv_size, val->mv_data };
+
+    *out_size = DB_LMDB_INDEX_KEY_MAX;
+    int rc    = index->index_key(&k, &v, out, out_size, index->ctx);
+    if(rc < 0)
+    {
+        EML_ERROR(LOG_TAG, "_index_key: callback of dbi %u failed (%d)", index->idx_dbi, rc);
+        return rc;
+    }
+    if(rc > 0) return 1;
+
+    if(*out_size == 0 || *out_size > DB_LMDB_INDEX_KEY_MAX)
+    {
+        EML_ERROR(LOG_TAG, "_index_key: key of %zu bytes for dbi %u", *out_size, index->idx_dbi);
+        return -EINVAL;
+    }
+    return 0;
+}
+
+/**
+ * @brief Index keys of record @p key -> @p val of DBI @p dbi, none when @p val is NULL.
+ */
+static int _keys_of(const unsigned dbi, const MDB_val* key, const MDB_val* val,
+                    ops_index_keys_t* out)
+{
+    out->n = 0;
+    for(size_t i = 0; i < n_indexes; i++)
+    {
+        if(indexes[i].src_dbi != dbi) continue;
+
+        const size_t j = out->n++;
+        out->has[j]    = 0;
+        out->size[j]   = 0;
+        if(!val) continue;
+
+        const int rc = _index_key(&indexes[i], key, val, out->key[j], &out->size[j]);
+        if(rc < 0) return rc;
+        out->has[j] = rc == 0;
+    }
+    return 0;
+}
+
+/**
+ * @brief Drop `ik -> key` from the index DBI, if it still points at @p key.
+ *
+ * @return MDB_SUCCESS or an LMDB error; a missing entry is not one.
+ */
+static int _unlink(MDB_txn* txn, const db_index_t* index, const void* ik, const size_t ik_size,
+                   const MDB_val* key)
+{
+    const dbi_t* dbi = &DataBase->dbis[index->idx_dbi];
+    MDB_val      k   = { ik_size, (void*)ik };
+    int          mdb_res;
+
+    if(dbi->is_dupsort)
+    {
+        mdb_res = mdb_del(txn, dbi->dbi, &k, (MDB_val*)key);
+    }
+    else
+    {
+        /* Unique index: another record may own the key by now */
+        MDB_val owner;
+        mdb_res = mdb_get(txn, dbi->dbi, &k, &owner);
+        if(mdb_res == MDB_SUCCESS &&
+           (owner.mv_size != key->mv_size || memcmp(owner.mv_data, key->mv_data, key->mv_size)))
+        {
+            return MDB_SUCCESS;
+        }
+        if(mdb_res == MDB_SUCCESS) mdb_res = mdb_del(txn, dbi->dbi, &k, NULL);
+    }
+    return mdb_res == MDB_NOTFOUND ? MDB_SUCCESS : mdb_res;
+}
+
+/**
+ * @brief Write `ik -> key` to the index DBI with its put flags.
+ *
+ * @return MDB_SUCCESS, MDB_KEYEXIST when a unique index maps @p ik to
+ *         another record, or an LMDB error.
+ */
+static int _link(MDB_txn* txn, const db_index_t* index, const void* ik, const size_t ik_size,
+                 const MDB_val* key)
+{
+    const dbi_t* dbi = &DataBase->dbis[index->idx_dbi];
+    MDB_val      k   = { ik_size, (void*)ik };
+    MDB_val      v   = *key; /* NOOVERWRITE hands the existing value back in it */
+
+    ops_bloom_add(index->idx_dbi, ik, ik_size);
+    int mdb_res = mdb_put(txn, dbi->dbi, &k, &v, dbi->put_flags);
+    if(mdb_res == MDB_KEYEXIST && v.mv_size == key->mv_size &&
+       memcmp(v.mv_data, key->mv_data, key->mv_size) == 0)
+    {
+        return MDB_SUCCESS;
+    }
+    if(mdb_res == MDB_KEYEXIST)
+    {
+        EML_WARN(LOG_TAG, "_link: index key already taken in dbi %u", index->idx_dbi);
+    }
+    return mdb_res;
+}
@@ -1,8 +1,11 @@
 
 #include "ops_init.h" /* env/DBI init helpers */
 #include <errno.h>    /* EINVAL etc */
+#include <pthread.h>  /* pthread_create, pthread_cond_timedwait */
+#include <string.h>   /* memset */
 #include <sys/stat.h> /* mkdir, stat */
 #include <sys/types.h>
+#include <time.h>     /* clock_gettime */
 #include <unistd.h>
 #include "common.h"   /* EML_* macros, LMDB_EML_* */
 
@@ -13,17 +16,53 @@
 
 #define LOG_TAG "db_ops_init"
 
+/* One comparator trampoline per DBI slot: LMDB passes them no context */
+#define CMP_SLOTS(X)                                                                            \
+    X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7) X(8) X(9) X(10) X(11) X(12) X(13) X(14) X(15)
+#define CMP_SLOT_PROTO(i)                                                                       \
+    static int _key_cmp_##i(const MDB_val* a, const MDB_val* b);                               \
+    static int _dup_cmp_##i(const MDB_val* a, const MDB_val* b);
+#define CMP_SLOT_DEF(i)                                                                         \
+    static int _key_cmp_##i(const MDB_val* a, const MDB_val* b)                                \
+    {                                                                                           \
+        return _cmp(key_cmps[i], a, b);                                                         \
+    }                                                                                           \
+    static int _dup_cmp_##i(const MDB_val* a, const MDB_val* b)                                \
+    {                                                                                           \
+        return _cmp(dup_cmps[i], a, b);                                                         \
+    }
+#define CMP_SLOT_KEY(i) _key_cmp_##i,
+#define CMP_SLOT_DUP(i) _dup_cmp_##i,
+
+_Static_assert(DB_MAX_DBIS == 16, "CMP_SLOTS needs one entry per DBI");
+
 /****************************************************************************
  * PRIVATE STUCTURED VARIABLES
  ****************************************************************************
  */
-/* None */
+
+/**
+ * @brief Background syncer of a NOSYNC / NOMETASYNC environment.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;      /**< Protects running, paired with wake. */
+    pthread_cond_t  wake;      /**< Signalled on stop. */
+    pthread_t       thread;    /**< Syncer thread. */
+    int             running;   /**< Non-zero while the thread runs. */
+    unsigned        period_ms; /**< Sync period. */
+} env_syncer_t;
 
 /****************************************************************************
  * PRIVATE VARIABLES
  ****************************************************************************
  */
-/* None */
+
+static env_syncer_t syncer = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0 };
+
+/* Orders installed by ops_init_dbi_order, read by the trampolines */
+static db_cmp_fn_t key_cmps[DB_MAX_DBIS];
+static db_cmp_fn_t dup_cmps[DB_MAX_DBIS];
 
 /****************************************************************************
  * PRIVATE FUNCTIONS PROTOTYPES
@@ -118,7 +157,19 @@ db_security_ret_code_t _db_set_max_dbis(const unsigned int max_dbis, int* const
  * initialized state; callers should treat failure as non-recoverable unless
  * specific recovery steps are documented elsewhere.
  */
-db_security_ret_code_t _db_set_map_size(int* const out_err);
+db_security_ret_code_t _db_set_map_size(const size_t db_map_size, int* const out_err);
+
+/**
+ * @brief Set the number of reader slots of the environment.
+ *
+ * Must be applied before opening the environment. Zero keeps the LMDB
+ * default (126).
+ *
+ * @param max_readers Reader slots, 0 to keep the default.
+ * @param[out] out_err Optional errno-style error on failure.
+ * @return DB_SAFETY_SUCCESS on success, or the security_check decision.
+ */
+db_security_ret_code_t _db_set_max_readers(const unsigned int max_readers, int* const out_err);
 
 /**
  * @brief Open the database environment at the specified path.
@@ -129,6 +180,7 @@ db_security_ret_code_t _db_set_map_size(int* const out_err);
  *
  * @param path Filesystem path to the database environment directory.
  * @param mode The UNIX permissions to set on created files and semaphores.
+ * @param env_flags MDB_* open flags on top of MDB_NOTLS, which is always set.
  * @param[out] out_err Optional pointer to an integer to receive a platform-
  * specific or implementation-specific error code when the operation fails.
  * If @p out_err is non-NULL *out_err will be set to an errno-style value on
@@ -150,7 +202,7 @@ db_security_ret_code_t _db_set_map_size(int* const out_err);
  * specific recovery steps are documented elsewhere.
  */
 db_security_ret_code_t _db_open_env(const char* const path, const unsigned int mode,
-                                    int* const out_err);
+                                    const unsigned int env_flags, int* const out_err);
 
 /**
  * @brief Open a sub-database (DBI) within the environment.
@@ -217,25 +269,32 @@ db_security_ret_code_t _dbi_open(MDB_txn* const txn, const unsigned int dbi_idx,
 db_security_ret_code_t _dbi_get_flags(MDB_txn* const txn, const unsigned int dbi_idx,
                                       int* const out_err);
 
+static void* _syncer_main(void* arg);
+
 /**
- * @brief Ensure that the LMDB directory exists with restrictive permissions.
- *
- * The directory is created when missing with owner-only permissions
- * (0700). When it already exists, the function verifies that it is a
- * directory and that no group/other bits are set; it does not relax
- * permissions if they are tighter.
- *
- * @return 0 on success, negative errno-style value on failure.
+ * @brief Call @p fn on the views of two LMDB values.
  */
-static int _ensure_env_dir(const char* path);
+static int _cmp(const db_cmp_fn_t fn, const MDB_val* a, const MDB_val* b);
+
+CMP_SLOTS(CMP_SLOT_PROTO)
+
+static MDB_cmp_func* const key_slots[DB_MAX_DBIS] = { CMP_SLOTS(CMP_SLOT_KEY) };
+static MDB_cmp_func* const dup_slots[DB_MAX_DBIS] = { CMP_SLOTS(CMP_SLOT_DUP) };
 
 /****************************************************************************
  * PUBLIC FUNCTIONS DEFINITIONS
  ****************************************************************************
  */
-db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* const path,
+db_security_ret_code_t ops_init_env(const db_env_cfg_t* const cfg, const char* const path,
                                     const unsigned int mode, int* const out_err)
 {
+    if(!cfg)
+    {
+        if(out_err) *out_err = -EINVAL;
+        EML_ERROR(LOG_TAG, "_init_env: invalid input (cfg=NULL)");
+        return DB_SAFETY_FAIL;
+    }
+
     /* Do NOT allow retry at initialization */
 
     /* Create environment */
@@ -249,7 +308,7 @@ db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* con
     }
 
     /* Set max DBIs */
-    switch(_db_set_max_dbis(max_dbis, out_err))
+    switch(_db_set_max_dbis(cfg->max_dbis, out_err))
     {
         case DB_SAFETY_SUCCESS:
             break;
@@ -259,7 +318,7 @@ db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* con
     }
 
     /* Set map size */
-    switch(_db_set_map_size(out_err))
+    switch(_db_set_map_size(cfg->map_size_init, out_err))
     {
         case DB_SAFETY_SUCCESS:
             break;
@@ -268,8 +327,18 @@ db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* con
             return DB_SAFETY_FAIL;
     }
 
+    /* Set reader slots */
+    switch(_db_set_max_readers(cfg->max_readers, out_err))
+    {
+        case DB_SAFETY_SUCCESS:
+            break;
+        default:
+            EML_ERROR(LOG_TAG, "_init_env: _set_max_readers failed");
+            return DB_SAFETY_FAIL;
+    }
+
     /* Open environment */
-    switch(_db_open_env(path, mode, out_err))
+    switch(_db_open_env(path, mode, ops_env_flags(cfg->opts), out_err))
     {
         case DB_SAFETY_SUCCESS:
             break;
@@ -278,7 +347,8 @@ db_security_ret_code_t ops_init_env(const unsigned int max_dbis, const char* con
             return DB_SAFETY_FAIL;
     }
 
-    EML_INFO(LOG_TAG, "_init_env: DataBase environment opened");
+    EML_INFO(LOG_TAG, "_init_env: DataBase environment opened (profile=%d opts=0x%x)",
+             (int)cfg->profile, cfg->opts);
     return DB_SAFETY_SUCCESS;
 }
 
@@ -325,19 +395,247 @@ db_security_ret_code_t ops_init_dbi(MDB_txn* const txn, const char* const name,
     // /* derive open flags */
     // dbi->open_flags = open_flags;
 
+    ops_init_dbi_derive(dbi_idx, dbi_type);
+
+    EML_INFO(LOG_TAG, "ops_init_dbi: DBI[%u] \"%s\" ready (db_flags=0x%x dupsort=%u dupfixed=%u)",
+             dbi_idx, name, dbi->db_flags, dbi->is_dupsort, dbi->is_dupfixed);
+
+    return DB_SAFETY_SUCCESS;
+}
+
+void ops_init_dbi_derive(const unsigned int dbi_idx, const dbi_type_t dbi_type)
+{
+    dbi_t* dbi = &DataBase->dbis[dbi_idx];
+
     /* derive put flags from logical type (e.g., NOOVERWRITE) */
     dbi->put_flags = dbi_put_flags_from_type(dbi_type);
 
     /* derive dupfix and dupsort flags */
     dbi->is_dupsort  = (dbi->db_flags & MDB_DUPSORT) != 0;
     dbi->is_dupfixed = (dbi->db_flags & MDB_DUPFIXED) != 0;
+    dbi->is_intkey   = (dbi->db_flags & MDB_INTEGERKEY) != 0;
+    dbi->is_intdup   = (dbi->db_flags & MDB_INTEGERDUP) != 0;
+}
 
-    EML_INFO(LOG_TAG, "ops_init_dbi: DBI[%u] \"%s\" ready (db_flags=0x%x dupsort=%u dupfixed=%u)",
-             dbi_idx, name, dbi->db_flags, dbi->is_dupsort, dbi->is_dupfixed);
+db_security_ret_code_t ops_init_dbi_order(MDB_txn* const txn, const unsigned int dbi_idx,
+                                          const db_cmp_fn_t key_cmp, const db_cmp_fn_t dup_cmp,
+                                          int* const out_err)
+{
+    if(!txn || dbi_idx >= DataBase->n_dbis || dbi_idx >= DB_MAX_DBIS)
+    {
+        EML_ERROR(LOG_TAG, "ops_init_dbi_order: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    /* Integer DBIs already have their numeric order */
+    const dbi_t* dbi = &DataBase->dbis[dbi_idx];
+    if((key_cmp && dbi->is_intkey) || (dup_cmp && (!dbi->is_dupsort || dbi->is_intdup)))
+    {
+        EML_ERROR(LOG_TAG, "ops_init_dbi_order: DBI[%u] cannot take this order", dbi_idx);
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    key_cmps[dbi_idx] = key_cmp;
+    dup_cmps[dbi_idx] = dup_cmp;
+
+    int mdb_res = MDB_SUCCESS;
+    if(key_cmp) mdb_res = mdb_set_compare(txn, dbi->dbi, key_slots[dbi_idx]);
+    if(dup_cmp && mdb_res == MDB_SUCCESS)
+    {
+        mdb_res = mdb_set_dupsort(txn, dbi->dbi, dup_slots[dbi_idx]);
+    }
+    if(mdb_res != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_init_dbi_order failed", mdb_res);
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
 
+    EML_INFO(LOG_TAG, "ops_init_dbi_order: DBI[%u] custom order (keys=%d dups=%d)", dbi_idx,
+             key_cmp != NULL, dup_cmp != NULL);
     return DB_SAFETY_SUCCESS;
 }
 
+int ops_env_profile(const db_env_profile_t profile, db_env_cfg_t* const out)
+{
+    if(!out)
+    {
+        EML_ERROR(LOG_TAG, "ops_env_profile: invalid input");
+        return -EINVAL;
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->profile       = profile;
+    out->opts          = DB_ENV_OPT_NONE;
+    out->map_size_init = (size_t)DB_MAP_SIZE_INIT;
+    out->map_size_max  = (size_t)DB_MAP_SIZE_MAX;
+    out->map_grow_step = (size_t)DB_MAP_GROW_STEP;
+    out->max_readers   = 0u; /* LMDB default */
+    out->max_dbis      = DB_MAX_DBIS;
+    out->sync_ms       = 0u;
+
+    switch(profile)
+    {
+        case DB_ENV_PROFILE_DURABLE:
+            break;
+        case DB_ENV_PROFILE_FAST_ASYNC:
+            /* A crash loses at most the last sync_ms of commits, never consistency */
+            out->opts    = DB_ENV_OPT_NOSYNC;
+            out->sync_ms = DB_LMDB_ENV_SYNC_MS;
+            break;
+        case DB_ENV_PROFILE_READ_MOSTLY:
+            /* Random point reads on a map larger than RAM: readahead only evicts */
+            out->opts        = DB_ENV_OPT_NORDAHEAD;
+            out->max_readers = DB_LMDB_ENV_READERS_RO;
+            break;
+        default:
+            EML_ERROR(LOG_TAG, "ops_env_profile: unknown profile %d", (int)profile);
+            return -EINVAL;
+    }
+
+    return 0;
+}
+
+int ops_env_cfg_resolve(const db_env_cfg_t* const cfg, db_env_cfg_t* const out)
+{
+    int rc = ops_env_profile(cfg ? cfg->profile : DB_ENV_PROFILE_DURABLE, out);
+    if(rc != 0 || !cfg) return rc;
+
+    out->opts |= cfg->opts;
+    if(cfg->map_size_init) out->map_size_init = cfg->map_size_init;
+    if(cfg->map_size_max) out->map_size_max = cfg->map_size_max;
+    if(cfg->map_grow_step) out->map_grow_step = cfg->map_grow_step;
+    if(cfg->max_readers) out->max_readers = cfg->max_readers;
+    if(cfg->max_dbis) out->max_dbis = cfg->max_dbis;
+    if(cfg->sync_ms) out->sync_ms = cfg->sync_ms;
+    out->key_cmps      = cfg->key_cmps;
+    out->dup_cmps      = cfg->dup_cmps;
+    out->warm          = cfg->warm;
+    out->prefetch_dbis = cfg->prefetch_dbis;
+
+    /* NOSYNC asked on top of a durable profile: still sync in the background */
+    if(!out->sync_ms && (out->opts & (DB_ENV_OPT_NOSYNC | DB_ENV_OPT_NOMETASYNC)))
+    {
+        out->sync_ms = DB_LMDB_ENV_SYNC_MS;
+    }
+
+    if(out->map_size_init > out->map_size_max)
+    {
+        EML_ERROR(LOG_TAG, "ops_env_cfg_resolve: map_size_init %zu > map_size_max %zu",
+                  out->map_size_init, out->map_size_max);
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int ops_env_sync_start(const unsigned period_ms)
+{
+    if(period_ms == 0 || !DataBase || !DataBase->env)
+    {
+        EML_ERROR(LOG_TAG, "ops_env_sync_start: invalid input");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&syncer.lock);
+    if(syncer.running)
+    {
+        pthread_mutex_unlock(&syncer.lock);
+        EML_ERROR(LOG_TAG, "ops_env_sync_start: syncer already running");
+        return -EALREADY;
+    }
+
+    syncer.period_ms = period_ms;
+    syncer.running   = 1;
+    int rc           = pthread_create(&syncer.thread, NULL, _syncer_main, NULL);
+    if(rc != 0) syncer.running = 0;
+    pthread_mutex_unlock(&syncer.lock);
+
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_env_sync_start: pthread_create failed (%d)", rc);
+        return -rc;
+    }
+
+    EML_INFO(LOG_TAG, "ops_env_sync_start: syncing every %u ms", period_ms);
+    return 0;
+}
+
+void ops_env_sync_stop(void)
+{
+    pthread_mutex_lock(&syncer.lock);
+    if(!syncer.running)
+    {
+        pthread_mutex_unlock(&syncer.lock);
+        return;
+    }
+    syncer.running = 0;
+    pthread_cond_signal(&syncer.wake);
+    pthread_mutex_unlock(&syncer.lock);
+
+    pthread_join(syncer.thread, NULL);
+
+    /* Commits since the last tick: a clean shutdown loses nothing */
+    int mdb_res = mdb_env_sync(DataBase->env, 1);
+    if(mdb_res != 0) LMDB_EML_WARN(LOG_TAG, "ops_env_sync_stop: mdb_env_sync", mdb_res);
+}
+
+int ops_init_env_dir(const char* const path)
+{
+    struct stat st;
+    mode_t      dir_mode = (mode_t)0700; /* owner rwx, no group/other */
+
+    if(stat(path, &st) == 0)
+    {
+        /* Path exists: ensure it is a directory and not world-accessible. */
+        if(!S_ISDIR(st.st_mode))
+        {
+            EML_ERROR(LOG_TAG, "ops_init_env_dir: %s exists and is not a directory", path);
+            return -ENOTDIR;
+        }
+
+        if((st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        {
+            EML_ERROR(
+                LOG_TAG,
+                "ops_init_env_dir: %s has too-permissive mode (%o); group/other bits must be 0",
+                path, st.st_mode);
+            return -EACCES;
+        }
+
+        return 0;
+    }
+
+    if(errno != ENOENT)
+    {
+        int saved = errno;
+        EML_ERROR(LOG_TAG, "ops_init_env_dir: stat(%s) failed, errno=%d", path, saved);
+        return -saved;
+    }
+
+    /* Directory does not exist: create it with strict permissions. */
+    if(mkdir(path, dir_mode) != 0)
+    {
+        int saved = errno;
+        EML_ERROR(LOG_TAG, "ops_init_env_dir: mkdir(%s, %o) failed, errno=%d", path, dir_mode,
+                  saved);
+        return -saved;
+    }
+
+    return 0;
+}
+
+unsigned int ops_env_flags(const unsigned opts)
+{
+    unsigned int flags = 0;
+
+    if(opts & DB_ENV_OPT_NOSYNC) flags |= MDB_NOSYNC;
+    if(opts & DB_ENV_OPT_NOMETASYNC) flags |= MDB_NOMETASYNC;
+    if(opts & DB_ENV_OPT_WRITEMAP) flags |= MDB_WRITEMAP;
+    if(opts & DB_ENV_OPT_NORDAHEAD) flags |= MDB_NORDAHEAD;
+
+    return flags;
+}
+
 /****************************************************************************
  * PRIVATE FUNCTIONS DEFINITIONS
  ****************************************************************************
@@ -387,10 +685,18 @@ fail:
     return security_check(mdb_res, NULL, out_err);
 }
 
-db_security_ret_code_t _db_set_map_size(int* const out_err)
+db_security_ret_code_t _db_set_map_size(const size_t db_map_size, int* const out_err)
 {
+    /* Check input */
+    if(db_map_size == 0)
+    {
+        if(out_err) *out_err = -EINVAL;
+        EML_ERROR(LOG_TAG, "_set_map_size: map size cannot be zero");
+        return DB_SAFETY_FAIL;
+    }
+
     /* Set initial map size */
-    int mdb_res = mdb_env_set_mapsize(DataBase->env, DB_MAP_SIZE_INIT);
+    int mdb_res = mdb_env_set_mapsize(DataBase->env, db_map_size);
     if(mdb_res != 0) goto fail;
     return 0;
 
@@ -399,8 +705,22 @@ fail:
     return security_check(mdb_res, NULL, out_err);
 }
 
+db_security_ret_code_t _db_set_max_readers(const unsigned int max_readers, int* const out_err)
+{
+    /* Keep the LMDB default */
+    if(max_readers == 0) return 0;
+
+    int mdb_res = mdb_env_set_maxreaders(DataBase->env, max_readers);
+    if(mdb_res != 0) goto fail;
+    return 0;
+
+fail:
+    LMDB_EML_ERR(LOG_TAG, "_set_max_readers failed", mdb_res);
+    return security_check(mdb_res, NULL, out_err);
+}
+
 db_security_ret_code_t _db_open_env(const char* const path, const unsigned int mode,
-                                    int* const out_err)
+                                    const unsigned int env_flags, int* const out_err)
 {
     if(!path)
     {
@@ -410,7 +730,7 @@ db_security_ret_code_t _db_open_env(const char* const path, const unsigned int m
     }
 
     /* Ensure the environment directory exists with strict permissions. */
-    int dir_rc = _ensure_env_dir(path);
+    int dir_rc = ops_init_env_dir(path);
     if(dir_rc != 0)
     {
         if(out_err) *out_err = dir_rc;
@@ -418,9 +738,14 @@ db_security_ret_code_t _db_open_env(const char* const path, const unsigned int m
         return DB_SAFETY_FAIL;
     }
 
-    /* Open environment */
-    int mdb_res = mdb_env_open(DataBase->env, path, 0, mode);
+    /* Open environment.
+    MDB_NOTLS: reader slots are tied to txn handles, not threads, so parked
+    read txns can be renewed later and batches may move between threads. */
+    int mdb_res = mdb_env_open(DataBase->env, path, MDB_NOTLS | env_flags, mode);
     if(mdb_res != 0) goto fail;
+
+    /* Child txns are not available under MDB_WRITEMAP, callers check */
+    DataBase->env_flags = MDB_NOTLS | env_flags;
     return 0;
 
 fail:
@@ -471,47 +796,46 @@ fail:
     return security_check(mdb_res, txn, out_err);
 }
 
-static int _ensure_env_dir(const char* path)
+static void* _syncer_main(void* arg)
 {
-    struct stat st;
-    mode_t      dir_mode = (mode_t)0700; /* owner rwx, no group/other */
+    (void)arg;
 
-    if(stat(path, &st) == 0)
+    pthread_mutex_lock(&syncer.lock);
+    while(syncer.running)
     {
-        /* Path exists: ensure it is a directory and not world-accessible. */
-        if(!S_ISDIR(st.st_mode))
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += syncer.period_ms / 1000u;
+        deadline.tv_nsec += (long)(syncer.period_ms % 1000u) * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L)
         {
-            EML_ERROR(LOG_TAG, "_ensure_env_dir: %s exists and is not a directory", path);
-            return -ENOTDIR;
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
         }
 
-        if((st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        int rc = 0;
+        while(syncer.running && rc != ETIMEDOUT)
         {
-            EML_ERROR(
-                LOG_TAG,
-                "_ensure_env_dir: %s has too-permissive mode (%o); group/other bits must be 0",
-                path, st.st_mode);
-            return -EACCES;
+            rc = pthread_cond_timedwait(&syncer.wake, &syncer.lock, &deadline);
         }
+        if(!syncer.running) break;
 
-        return 0;
-    }
-
-    if(errno != ENOENT)
-    {
-        int saved = errno;
-        EML_ERROR(LOG_TAG, "_ensure_env_dir: stat(%s) failed, errno=%d", path, saved);
-        return -saved;
+        /* Sync outside the lock, stop must not wait on the disk */
+        pthread_mutex_unlock(&syncer.lock);
+        int mdb_res = mdb_env_sync(DataBase->env, 1);
+        if(mdb_res != 0) LMDB_EML_WARN(LOG_TAG, "_syncer_main: mdb_env_sync", mdb_res);
+        pthread_mutex_lock(&syncer.lock);
     }
+    pthread_mutex_unlock(&syncer.lock);
 
-    /* Directory does not exist: create it with strict permissions. */
-    if(mkdir(path, dir_mode) != 0)
-    {
-        int saved = errno;
-        EML_ERROR(LOG_TAG, "_ensure_env_dir: mkdir(%s, %o) failed, errno=%d", path, dir_mode,
-                  saved);
-        return -saved;
-    }
+    return NULL;
+}
 
-    return 0;
+static int _cmp(const db_cmp_fn_t fn, const MDB_val* a, const MDB_val* b)
+{
+    const db_view_t va = { a->mv_size, a->mv_data };
+    const db_view_t vb = { b->mv_size, b->mv_data };
+    return fn(&va, &vb);
 }
+
+CMP_SLOTS(CMP_SLOT_DEF)
@@ -0,0 +1,298 @@
+/**
+ * @file ops_map.c
+ *
+ */
+
+#define _GNU_SOURCE /* PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP */
+
+#include <errno.h>     /* EINVAL, EBUSY, EIO, ENOSPC */
+#include <pthread.h>   /* pthread_rwlock_t */
+#include <stdatomic.h> /* atomic_* */
+#include <string.h>    /* memset */
+#include <time.h>      /* clock_gettime */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_MAP_GROW_STEP */
+#include "db.h"     /* DataBase */
+#include "ops_map.h"
+#include "security.h" /* security_check */
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_map"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+/* Shared by every txn, exclusive for mdb_env_set_mapsize. A waiting resize
+holds off new entrants, or a steady flow of readers would starve it */
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+static pthread_rwlock_t map_gate = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+#else
+static pthread_rwlock_t map_gate = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+
+/* Gate entries of this thread: only the outer one takes the lock, a nested
+rdlock would queue behind a waiting resize that waits for this thread */
+static _Thread_local unsigned gate_depth = 0;
+
+static size_t        map_step     = DB_MAP_GROW_STEP;
+static atomic_size_t map_psize    = 0; /* page size, read once per env */
+static atomic_size_t grows        = 0;
+static atomic_size_t full_grows   = 0;
+static atomic_size_t deferred     = 0;
+static atomic_size_t full_refused = 0;
+
+/* Threads in the gate for a long time (a backup copy): growths do not wait */
+static atomic_int long_holds = 0;
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Current map size and bytes in use.
+ *
+ * @return 0 on success, negative errno otherwise.
+ */
+static int _map_usage(size_t* out_size, size_t* out_used);
+
+/**
+ * @brief Take the gate exclusively, then set the map to @p size when larger.
+ *
+ * @param size Target size, already capped by the caller.
+ * @param wait Non-zero to wait up to DB_LMDB_MAP_GROW_WAIT_MS, zero to try
+ *             once; a long hold of the gate turns the wait into one try.
+ * @return 0 when the map is at least @p size, -EBUSY when the gate stayed
+ *         busy or the calling thread is inside it, or a negative errno
+ *         from LMDB.
+ */
+static int _map_resize(const size_t size, const int wait);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+void ops_map_configure(const size_t step)
+{
+    map_step = step ? step : DB_MAP_GROW_STEP;
+    atomic_store(&map_psize, 0);
+    atomic_store(&grows, 0);
+    atomic_store(&full_grows, 0);
+    atomic_store(&deferred, 0);
+    atomic_store(&full_refused, 0);
+}
+
+void ops_map_enter(void)
+{
+    if(gate_depth++ == 0) pthread_rwlock_rdlock(&map_gate);
+}
+
+void ops_map_leave(void)
+{
+    if(gate_depth == 0) return;
+    if(--gate_depth == 0) pthread_rwlock_unlock(&map_gate);
+}
+
+int ops_map_held(void)
+{
+    return gate_depth != 0;
+}
+
+void ops_map_enter_long(void)
+{
+    atomic_fetch_add(&long_holds, 1);
+    ops_map_enter();
+}
+
+void ops_map_leave_long(void)
+{
+    ops_map_leave();
+    atomic_fetch_sub(&long_holds, 1);
+}
+
+void ops_map_after_commit(void)
+{
+    size_t size = 0;
+    size_t used = 0;
+    if(_map_usage(&size, &used) != 0) return;
+
+    /* Hot path: at least one step left */
+    if(used + map_step <= size) return;
+
+    size_t target = size + map_step;
+    if(target > DataBase->map_size_bytes_max) target = DataBase->map_size_bytes_max;
+    if(target <= size) return; /* at the ceiling, MAP_FULL will tell */
+
+    /* Under half a step left: wait for the readers rather than hit MAP_FULL */
+    int rc = _map_resize(target, used + map_step / 2u > size);
+    if(rc == 0)
+    {
+        atomic_fetch_add(&grows, 1);
+        EML_INFO(LOG_TAG, "ops_map_after_commit: map %zu -> %zu bytes (used %zu)", size, target,
+                 used);
+    }
+    else if(rc == -EBUSY)
+    {
+        /* Txns open, or this thread holds a lease: the next commit tries again */
+        atomic_fetch_add(&deferred, 1);
+    }
+}
+
+int ops_map_on_full(const unsigned attempt)
+{
+    size_t size = 0;
+    size_t used = 0;
+    int    rc   = _map_usage(&size, &used);
+    if(rc != 0) return rc;
+
+    /* Bigger steps for txns that did not fit after one */
+    size_t add    = map_step << (attempt < 8u ? attempt : 8u);
+    size_t target = size + add;
+    if(target < size || target > DataBase->map_size_bytes_max)
+    {
+        target = DataBase->map_size_bytes_max;
+    }
+    if(target <= size)
+    {
+        EML_ERROR(LOG_TAG, "ops_map_on_full: map at max %zu", size);
+        return -ENOSPC;
+    }
+
+    rc = _map_resize(target, 1);
+    if(rc != 0)
+    {
+        if(rc == -EBUSY) atomic_fetch_add(&full_refused, 1);
+        EML_ERROR(LOG_TAG, "ops_map_on_full: growth to %zu failed (%d)", target, rc);
+        return rc;
+    }
+
+    atomic_fetch_add(&full_grows, 1);
+    EML_WARN(LOG_TAG, "ops_map_on_full: map %zu -> %zu bytes after MDB_MAP_FULL", size, target);
+    return 0;
+}
+
+int ops_map_reserve(const size_t size)
+{
+    if(!(DataBase && DataBase->env)) return -EINVAL;
+
+    if(size > DataBase->map_size_bytes_max)
+    {
+        EML_WARN(LOG_TAG, "ops_map_reserve: %zu exceeds max %zu", size,
+                 DataBase->map_size_bytes_max);
+        return -ENOSPC;
+    }
+
+    return _map_resize(size, 1);
+}
+
+void ops_map_stats(db_map_stats_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(*out));
+    if(DataBase) out->map_max = DataBase->map_size_bytes_max;
+    (void)_map_usage(&out->map_size, &out->used);
+    out->grows        = atomic_load(&grows);
+    out->full_grows   = atomic_load(&full_grows);
+    out->deferred     = atomic_load(&deferred);
+    out->full_refused = atomic_load(&full_refused);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static int _map_usage(size_t* out_size, size_t* out_used)
+{
+    if(!(DataBase && DataBase->env)) return -EINVAL;
+
+    MDB_envinfo info;
+    int         mdb_res = mdb_env_info(DataBase->env, &info);
+    if(mdb_res != MDB_SUCCESS) goto fail;
+
+    size_t psize = atomic_load(&map_psize);
+    if(psize == 0)
+    {
+        MDB_stat st;
+        mdb_res = mdb_env_stat(DataBase->env, &st);
+        if(mdb_res != MDB_SUCCESS) goto fail;
+        psize = (size_t)st.ms_psize;
+        atomic_store(&map_psize, psize);
+    }
+
+    *out_size = (size_t)info.me_mapsize;
+    *out_used = ((size_t)info.me_last_pgno + 1) * psize;
+    return 0;
+
+fail:
+    LMDB_EML_WARN(LOG_TAG, "_map_usage: env info", mdb_res);
+    return -EIO;
+}
+
+static int _map_resize(const size_t size, const int wait)
+{
+    /* Our own txn or lease would keep the gate busy until the timeout */
+    if(gate_depth != 0)
+    {
+        EML_DBG(LOG_TAG, "_map_resize: this thread is inside the gate");
+        return -EBUSY;
+    }
+
+    /* A long hold would only keep every new txn waiting for the timeout */
+    int rc = 0;
+    if(wait && atomic_load(&long_holds) == 0)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += DB_LMDB_MAP_GROW_WAIT_MS / 1000u;
+        deadline.tv_nsec += (long)(DB_LMDB_MAP_GROW_WAIT_MS % 1000u) * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        rc = pthread_rwlock_timedwrlock(&map_gate, &deadline);
+    }
+    else
+    {
+        rc = pthread_rwlock_trywrlock(&map_gate);
+    }
+    if(rc != 0)
+    {
+        EML_DBG(LOG_TAG, "_map_resize: gate busy (%d)", rc);
+        return -EBUSY;
+    }
+
+    /* Another thread may have grown it while we waited */
+    MDB_envinfo info;
+    int         mdb_res = mdb_env_info(DataBase->env, &info);
+    if(mdb_res == MDB_SUCCESS && (size_t)info.me_mapsize < size)
+    {
+        mdb_res = mdb_env_set_mapsize(DataBase->env, size);
+    }
+    pthread_rwlock_unlock(&map_gate);
+
+    if(mdb_res != MDB_SUCCESS)
+    {
+        int err = -EIO;
+        LMDB_EML_ERR(LOG_TAG, "_map_resize: mdb_env_set_mapsize", mdb_res);
+        (void)security_check(mdb_res, NULL, &err);
+        return err;
+    }
+
+    return 0;
+}
@@ -0,0 +1,852 @@
+/**
+ * @file ops_shard.c
+ *
+ */
+
+#include <errno.h>     /* EINVAL, EIO, ENOBUFS, ENOMEM, ENOSPC, ENOTSUP, EXDEV, EINTR */
+#include <pthread.h>   /* pthread_* */
+#include <semaphore.h> /* sem_t, sem_init, sem_wait, sem_post */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint64_t */
+#include <stdlib.h>    /* calloc, realloc, free */
+#include <string.h>    /* memcpy */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_SHARDS_MAX */
+#include "dbi_int.h"
+#include "ops_arena.h"
+#include "ops_init.h"
+#include "ops_internals.h"
+#include "ops_shard.h"
+#include "ops_util.h" /* ops_hash */
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_shard"
+
+/* Features that live in process-wide state of the global database */
+#define SHARD_TYPES_UNSUPPORTED (DBI_TYPE_BLOOM | DBI_TYPE_ZIP)
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief One queued op, key and PUT value copied into the batch arena.
+ */
+typedef struct
+{
+    unsigned  dbi;      /**< DBI index, the same in every shard. */
+    op_type_t type;     /**< PUT, GET or DEL. */
+    unsigned  shard;    /**< Shard of the key, set at exec. */
+    void*     key;      /**< Key copy. */
+    size_t    key_size; /**< Key size. */
+    void*     val;      /**< PUT / DEL value copy, or GET user buffer (NULL if none). */
+    size_t    val_size; /**< Its size, the buffer capacity for GET. */
+} shard_op_t;
+
+struct ops_shard_batch
+{
+    shard_op_t* ops;   /**< Queued ops. */
+    size_t      n_ops; /**< Ops queued. */
+    size_t      cap;   /**< Capacity of ops and order. */
+    unsigned*   order; /**< Op indices grouped by shard, built at exec. */
+    ops_arena_t arena; /**< Key and value copies. */
+};
+
+/**
+ * @brief The ops of one batch on one shard, on the caller's stack until done.
+ */
+typedef struct shard_job
+{
+    struct shard_job* next; /**< Next job in the shard queue. */
+    const shard_op_t* ops;  /**< Ops of the batch. */
+    const unsigned*   idx;  /**< Indices of the ops of this shard. */
+    size_t            n;    /**< Number of indices. */
+    int               res;  /**< Result of this part. */
+    sem_t*            done; /**< Posted once res is final, shared by the parts of a batch. */
+} shard_job_t;
+
+typedef struct
+{
+    struct ops_shards* owner;             /**< Handle holding this shard. */
+    MDB_env*           env;               /**< Env of the shard, NULL until created. */
+    MDB_dbi            dbis[DB_MAX_DBIS]; /**< DBI handles in this env. */
+    size_t             map_size;          /**< Current map size. */
+    pthread_rwlock_t   gate;              /**< Txns shared, map resizes exclusive. */
+    pthread_mutex_t    lock;              /**< Protects the queue and quit. */
+    pthread_cond_t     work;              /**< Signaled on a queued job and on quit. */
+    shard_job_t*       head;              /**< FIFO of jobs for the writer. */
+    shard_job_t*       tail;
+    shard_job_t**      slots;             /**< Jobs of the group being run. */
+    int                quit;              /**< Writer exits once the queue is empty. */
+    int                inited;            /**< Locks initialized. */
+    int                started;           /**< Writer thread running. */
+    pthread_t          thread;            /**< Writer. */
+} shard_t;
+
+struct ops_shards
+{
+    shard_t*   shards;                 /**< n_shards shards. */
+    unsigned   n_shards;               /**< Number of shards. */
+    unsigned   n_dbis;                 /**< DBIs of every shard. */
+    unsigned   put_flags[DB_MAX_DBIS]; /**< mdb_put flags per DBI. */
+    dbi_type_t types[DB_MAX_DBIS];     /**< Type per DBI. */
+    size_t     map_max;                /**< Map growth limit per shard. */
+    size_t     grow_step;              /**< Bytes added per growth. */
+    size_t     max_batches;            /**< Capacity of the slots of each shard. */
+    /* Counters */
+    atomic_size_t batches;
+    atomic_size_t single;
+    atomic_size_t split;
+    atomic_size_t refused;
+    atomic_size_t failed;
+    atomic_size_t commits;
+    atomic_size_t grows;
+};
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Create, open and fill one shard env, then start its writer.
+ */
+static int _shard_open(shards_t* sh, shard_t* s, const char* path, const db_env_cfg_t* env,
+                       const db_shards_cfg_t* cfg);
+
+static void* _writer_main(void* arg);
+
+/**
+ * @brief Run @p n jobs in child txns of one write txn, then complete each of them.
+ */
+static void _run_group(shard_t* s, shard_job_t** jobs, const size_t n);
+
+/**
+ * @brief Run @p job in a write txn of its own, growing the map when full.
+ */
+static int _run_alone(shard_t* s, shard_job_t* job);
+
+/**
+ * @brief Run the GETs of @p job in a read txn of the calling thread.
+ */
+static int _run_reads(shard_t* s, shard_job_t* job);
+
+/**
+ * @brief Apply the ops of @p job in @p txn.
+ *
+ * @return 0, or the negative errno of the first failing op; @p retry is
+ *         set when the txn is worth redoing.
+ */
+static int _apply(const shard_t* s, MDB_txn* txn, const shard_job_t* job, int* retry);
+
+/**
+ * @brief Grow the map by one step when @p full, adopt the size on disk otherwise.
+ */
+static int _grow(shard_t* s, const int full);
+
+/**
+ * @brief Negative errno of LMDB code @p rc, @p retry set when retryable.
+ */
+static int _errno(const int rc, int* retry);
+
+static void _push(shard_t* s, shard_job_t* job);
+
+static void _batch_clear(shard_batch_t* batch);
+
+static void _sem_wait(sem_t* sem);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_shards_open(shards_t** out, const db_shards_cfg_t* cfg)
+{
+    if(!out || !cfg || !cfg->paths || !cfg->dbi_names || !cfg->dbi_types ||
+       cfg->n_shards == 0 || cfg->n_shards > DB_LMDB_SHARDS_MAX || cfg->n_dbis == 0 ||
+       cfg->n_dbis > DB_MAX_DBIS)
+    {
+        EML_ERROR(LOG_TAG, "ops_shards_open: invalid input");
+        return -EINVAL;
+    }
+    *out = NULL;
+
+    for(unsigned i = 0; i < cfg->n_shards; i++)
+    {
+        if(!cfg->paths[i] || !*cfg->paths[i])
+        {
+            EML_ERROR(LOG_TAG, "ops_shards_open: invalid path of shard %u", i);
+            return -EINVAL;
+        }
+    }
+    for(unsigned i = 0; i < cfg->n_dbis; i++)
+    {
+        if(!cfg->dbi_names[i] || !*cfg->dbi_names[i])
+        {
+            EML_ERROR(LOG_TAG, "ops_shards_open: invalid dbi name at index %u", i);
+            return -EINVAL;
+        }
+        if(cfg->dbi_types[i] & SHARD_TYPES_UNSUPPORTED)
+        {
+            EML_ERROR(LOG_TAG, "ops_shards_open: dbi %s: BLOOM / ZIP not available on shards",
+                      cfg->dbi_names[i]);
+            return -ENOTSUP;
+        }
+    }
+
+    db_env_cfg_t env;
+    int          rc = ops_env_cfg_resolve(cfg->env, &env);
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_shards_open: invalid env config");
+        return rc;
+    }
+
+    /* Writers merge batches in child txns; orders are installed by the global init only */
+    if((env.opts & DB_ENV_OPT_WRITEMAP) || env.key_cmps || env.dup_cmps)
+    {
+        EML_ERROR(LOG_TAG, "ops_shards_open: WRITEMAP and custom orders not available");
+        return -ENOTSUP;
+    }
+
+    shards_t* sh = calloc(1, sizeof(*sh));
+    if(!sh || !(sh->shards = calloc(cfg->n_shards, sizeof(shard_t))))
+    {
+        free(sh);
+        EML_ERROR(LOG_TAG, "ops_shards_open: calloc(%u shards) failed", cfg->n_shards);
+        return -ENOMEM;
+    }
+
+    sh->n_shards    = cfg->n_shards;
+    sh->n_dbis      = cfg->n_dbis;
+    sh->map_max     = env.map_size_max;
+    sh->grow_step   = env.map_grow_step;
+    sh->max_batches = cfg->max_batches ? cfg->max_batches : DB_LMDB_GROUP_MAX_BATCHES;
+    for(unsigned i = 0; i < cfg->n_dbis; i++)
+    {
+        sh->types[i]     = cfg->dbi_types[i];
+        sh->put_flags[i] = dbi_put_flags_from_type(cfg->dbi_types[i]);
+    }
+
+    for(unsigned i = 0; i < cfg->n_shards; i++)
+    {
+        rc = _shard_open(sh, &sh->shards[i], cfg->paths[i], &env, cfg);
+        if(rc != 0)
+        {
+            EML_ERROR(LOG_TAG, "ops_shards_open: shard %u (%s) failed, rc=%d", i, cfg->paths[i],
+                      rc);
+            ops_shards_close(sh);
+            return rc;
+        }
+    }
+
+    *out = sh;
+    EML_INFO(LOG_TAG, "ops_shards_open: %u shards of %u DBIs", sh->n_shards, sh->n_dbis);
+    return 0;
+}
+
+void ops_shards_close(shards_t* sh)
+{
+    if(!sh) return;
+
+    /* Writers drain their queue first */
+    for(unsigned i = 0; i < sh->n_shards; i++)
+    {
+        shard_t* s = &sh->shards[i];
+        if(!s->started) continue;
+
+        pthread_mutex_lock(&s->lock);
+        s->quit = 1;
+        pthread_cond_signal(&s->work);
+        pthread_mutex_unlock(&s->lock);
+        pthread_join(s->thread, NULL);
+    }
+
+    for(unsigned i = 0; i < sh->n_shards; i++)
+    {
+        shard_t* s = &sh->shards[i];
+        if(s->env)
+        {
+            /* NOSYNC shards have no background syncer: last chance */
+            int mdb_res = mdb_env_sync(s->env, 1);
+            if(mdb_res != 0) LMDB_EML_WARN(LOG_TAG, "ops_shards_close: mdb_env_sync", mdb_res);
+            mdb_env_close(s->env);
+        }
+        if(s->inited)
+        {
+            pthread_rwlock_destroy(&s->gate);
+            pthread_mutex_destroy(&s->lock);
+            pthread_cond_destroy(&s->work);
+        }
+        free(s->slots);
+    }
+
+    EML_INFO(LOG_TAG, "ops_shards_close: %u shards closed after %zu batches", sh->n_shards,
+             atomic_load(&sh->batches));
+    free(sh->shards);
+    free(sh);
+}
+
+int ops_shards_of(const shards_t* sh, const void* key, const size_t key_size)
+{
+    if(!sh || !key || key_size == 0) return -EINVAL;
+    return (int)(ops_hash(key, key_size) % sh->n_shards);
+}
+
+shard_batch_t* ops_shard_batch_create(void)
+{
+    shard_batch_t* batch = calloc(1, sizeof(*batch));
+    if(!batch) EML_ERROR(LOG_TAG, "ops_shard_batch_create: calloc failed");
+    return batch;
+}
+
+void ops_shard_batch_destroy(shard_batch_t* batch)
+{
+    if(!batch) return;
+
+    ops_arena_release(&batch->arena);
+    free(batch->ops);
+    free(batch->order);
+    free(batch);
+}
+
+int ops_shard_batch_add(shard_batch_t* batch, const unsigned dbi, const op_type_t type,
+                        const void* key, const size_t key_size, const void* val,
+                        const size_t val_size)
+{
+    if(!batch || !key || key_size == 0 || dbi >= DB_MAX_DBIS ||
+       (type != DB_OPERATION_PUT && type != DB_OPERATION_GET && type != DB_OPERATION_DEL) ||
+       (type != DB_OPERATION_DEL && !val) || (val && val_size == 0))
+    {
+        EML_ERROR(LOG_TAG, "ops_shard_batch_add: invalid input");
+        return -EINVAL;
+    }
+
+    if(batch->n_ops == batch->cap)
+    {
+        if(batch->n_ops >= DB_LMDB_BATCH_OPS_MAX)
+        {
+            EML_ERROR(LOG_TAG, "ops_shard_batch_add: batch limit reached (max=%d)",
+                      DB_LMDB_BATCH_OPS_MAX);
+            return -ENOMEM;
+        }
+        size_t      cap   = batch->cap ? batch->cap * 2u : DB_LMDB_BATCH_OPS_INIT;
+        shard_op_t* ops   = realloc(batch->ops, cap * sizeof(*ops));
+        if(ops) batch->ops = ops;
+        unsigned*   order = ops ? realloc(batch->order, cap * sizeof(*order)) : NULL;
+        if(!order)
+        {
+            EML_ERROR(LOG_TAG, "ops_shard_batch_add: realloc(%zu ops) failed", cap);
+            return -ENOMEM;
+        }
+        batch->order = order;
+        batch->cap   = cap;
+    }
+
+    shard_op_t* op = &batch->ops[batch->n_ops];
+    op->dbi        = dbi;
+    op->type       = type;
+    op->shard      = 0u;
+    op->key        = ops_arena_alloc(&batch->arena, key_size);
+    op->key_size   = key_size;
+    op->val        = NULL;
+    op->val_size   = val_size;
+    if(!op->key)
+    {
+        EML_ERROR(LOG_TAG, "ops_shard_batch_add: arena alloc failed");
+        return -ENOMEM;
+    }
+    memcpy(op->key, key, key_size);
+
+    /* GET fills the caller's buffer, the others own a copy */
+    if(type == DB_OPERATION_GET)
+    {
+        op->val = (void*)val;
+    }
+    else if(val)
+    {
+        op->val = ops_arena_alloc(&batch->arena, val_size);
+        if(!op->val)
+        {
+            EML_ERROR(LOG_TAG, "ops_shard_batch_add: arena alloc failed");
+            return -ENOMEM;
+        }
+        memcpy(op->val, val, val_size);
+    }
+
+    batch->n_ops++;
+    return 0;
+}
+
+int ops_shards_exec(shards_t* sh, shard_batch_t* batch, const int atomic)
+{
+    if(!sh || !batch)
+    {
+        EML_ERROR(LOG_TAG, "ops_shards_exec: invalid input");
+        return -EINVAL;
+    }
+    if(batch->n_ops == 0) return 0;
+
+    size_t count[DB_LMDB_SHARDS_MAX]  = { 0 };
+    size_t writes[DB_LMDB_SHARDS_MAX] = { 0 };
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        shard_op_t* op = &batch->ops[i];
+        if(op->dbi >= sh->n_dbis ||
+           ((sh->types[op->dbi] & DBI_TYPE_INTEGERKEY) && !dbi_int_size_ok(op->key_size)))
+        {
+            EML_ERROR(LOG_TAG, "ops_shards_exec: bad op %zu (dbi %u)", i, op->dbi);
+            _batch_clear(batch);
+            return -EINVAL;
+        }
+        op->shard = (unsigned)(ops_hash(op->key, op->key_size) % sh->n_shards);
+        count[op->shard]++;
+        if(op->type != DB_OPERATION_GET) writes[op->shard]++;
+    }
+
+    unsigned touched = 0;
+    size_t   start[DB_LMDB_SHARDS_MAX];
+    size_t   pos = 0;
+    for(unsigned s = 0; s < sh->n_shards; s++)
+    {
+        start[s] = pos;
+        pos += count[s];
+        if(count[s]) touched++;
+    }
+
+    /* One txn per shard: no atomicity across them */
+    if(touched > 1 && atomic)
+    {
+        atomic_fetch_add(&sh->refused, 1);
+        _batch_clear(batch);
+        return -EXDEV;
+    }
+
+    /* Group the ops by shard, keeping their order within a shard */
+    size_t fill[DB_LMDB_SHARDS_MAX];
+    memcpy(fill, start, sizeof(fill));
+    for(size_t i = 0; i < batch->n_ops; i++)
+    {
+        batch->order[fill[batch->ops[i].shard]++] = (unsigned)i;
+    }
+
+    sem_t       done;
+    shard_job_t jobs[DB_LMDB_SHARDS_MAX];
+    size_t      queued = 0;
+    sem_init(&done, 0, 0);
+
+    /* Writers first, so that they run while this thread reads */
+    for(unsigned s = 0; s < sh->n_shards; s++)
+    {
+        if(!count[s]) continue;
+        jobs[s].next = NULL;
+        jobs[s].ops  = batch->ops;
+        jobs[s].idx  = &batch->order[start[s]];
+        jobs[s].n    = count[s];
+        jobs[s].res  = -EIO;
+        jobs[s].done = &done;
+        if(writes[s])
+        {
+            _push(&sh->shards[s], &jobs[s]);
+            queued++;
+        }
+    }
+    for(unsigned s = 0; s < sh->n_shards; s++)
+    {
+        if(count[s] && !writes[s]) jobs[s].res = _run_reads(&sh->shards[s], &jobs[s]);
+    }
+    for(size_t i = 0; i < queued; i++) _sem_wait(&done);
+    sem_destroy(&done);
+
+    int res = 0;
+    for(unsigned s = 0; s < sh->n_shards && res == 0; s++)
+    {
+        if(count[s]) res = jobs[s].res;
+    }
+
+    atomic_fetch_add(&sh->batches, 1);
+    atomic_fetch_add(touched > 1 ? &sh->split : &sh->single, 1);
+    if(res != 0) atomic_fetch_add(&sh->failed, 1);
+
+    _batch_clear(batch);
+    return res;
+}
+
+void ops_shards_stats(const shards_t* sh, db_shards_stats_t* out)
+{
+    if(!sh || !out) return;
+
+    out->batches = atomic_load(&sh->batches);
+    out->single  = atomic_load(&sh->single);
+    out->split   = atomic_load(&sh->split);
+    out->refused = atomic_load(&sh->refused);
+    out->failed  = atomic_load(&sh->failed);
+    out->commits = atomic_load(&sh->commits);
+    out->grows   = atomic_load(&sh->grows);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static int _shard_open(shards_t* sh, shard_t* s, const char* path, const db_env_cfg_t* env,
+                       const db_shards_cfg_t* cfg)
+{
+    s->owner = sh;
+    s->slots = calloc(sh->max_batches, sizeof(shard_job_t*));
+    if(!s->slots) return -ENOMEM;
+
+    pthread_rwlock_init(&s->gate, NULL);
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->work, NULL);
+    s->inited = 1;
+
+    int rc = ops_init_env_dir(path);
+    if(rc != 0) return rc;
+
+    int mdb_res = mdb_env_create(&s->env);
+    if(mdb_res != MDB_SUCCESS)
+    {
+        s->env = NULL;
+        goto fail;
+    }
+    mdb_res = mdb_env_set_maxdbs(s->env, (MDB_dbi)env->max_dbis);
+    if(mdb_res == MDB_SUCCESS) mdb_res = mdb_env_set_mapsize(s->env, env->map_size_init);
+    if(mdb_res == MDB_SUCCESS && env->max_readers)
+    {
+        mdb_res = mdb_env_set_maxreaders(s->env, env->max_readers);
+    }
+    if(mdb_res != MDB_SUCCESS) goto fail;
+
+    /* MDB_NOTLS: read txns of a shard are begun on any caller thread */
+    const unsigned mode = cfg->mode ? cfg->mode : DB_LMDB_ENV_MODE;
+    mdb_res = mdb_env_open(s->env, path, MDB_NOTLS | ops_env_flags(env->opts), (mdb_mode_t)mode);
+    if(mdb_res != MDB_SUCCESS) goto fail;
+
+    MDB_txn* txn = NULL;
+    mdb_res      = mdb_txn_begin(s->env, NULL, 0, &txn);
+    if(mdb_res != MDB_SUCCESS) goto fail;
+    for(unsigned i = 0; i < cfg->n_dbis; i++)
+    {
+        mdb_res = mdb_dbi_open(txn, cfg->dbi_names[i], dbi_open_flags_from_type(cfg->dbi_types[i]),
+                               &s->dbis[i]);
+        if(mdb_res != MDB_SUCCESS)
+        {
+            mdb_txn_abort(txn);
+            goto fail;
+        }
+    }
+    mdb_res = mdb_txn_commit(txn);
+    if(mdb_res != MDB_SUCCESS) goto fail;
+
+    /* An existing env keeps its larger map */
+    MDB_envinfo info;
+    s->map_size = env->map_size_init;
+    if(mdb_env_info(s->env, &info) == MDB_SUCCESS && info.me_mapsize > s->map_size)
+    {
+        s->map_size = info.me_mapsize;
+    }
+
+    rc = pthread_create(&s->thread, NULL, _writer_main, s);
+    if(rc != 0) return -rc;
+    s->started = 1;
+    return 0;
+
+fail:
+    LMDB_EML_ERR(LOG_TAG, "_shard_open failed", mdb_res);
+    int retry = 0;
+    return _errno(mdb_res, &retry);
+}
+
+static void* _writer_main(void* arg)
+{
+    shard_t* s = arg;
+
+    for(;;)
+    {
+        pthread_mutex_lock(&s->lock);
+        while(!s->head && !s->quit) pthread_cond_wait(&s->work, &s->lock);
+        if(!s->head)
+        {
+            pthread_mutex_unlock(&s->lock);
+            break;
+        }
+
+        /* Everything pending, up to one group */
+        size_t n = 0;
+        while(s->head && n < s->owner->max_batches)
+        {
+            s->slots[n++] = s->head;
+            s->head       = s->head->next;
+        }
+        if(!s->head) s->tail = NULL;
+        pthread_mutex_unlock(&s->lock);
+
+        _run_group(s, s->slots, n);
+    }
+
+    return NULL;
+}
+
+static void _run_group(shard_t* s, shard_job_t** jobs, const size_t n)
+{
+    MDB_txn* txn      = NULL;
+    int      fallback = 0;
+    int      retry    = 0;
+    int      full     = 0;
+
+    pthread_rwlock_rdlock(&s->gate);
+    int mdb_res = mdb_txn_begin(s->env, NULL, 0, &txn);
+    if(mdb_res != MDB_SUCCESS)
+    {
+        fallback = 1;
+    }
+    else
+    {
+        for(size_t i = 0; i < n && !fallback; i++)
+        {
+            /* A failed part is aborted alone, its neighbours keep going */
+            MDB_txn* child = NULL;
+            mdb_res        = mdb_txn_begin(s->env, txn, 0, &child);
+            if(mdb_res != MDB_SUCCESS)
+            {
+                fallback = 1;
+                break;
+            }
+
+            int err = _apply(s, child, jobs[i], &retry);
+            if(err == 0 && (mdb_res = mdb_txn_commit(child)) != MDB_SUCCESS)
+            {
+                err = _errno(mdb_res, &retry);
+            }
+            else if(err != 0)
+            {
+                mdb_txn_abort(child);
+            }
+
+            /* The map cannot grow under an open txn: redo one by one */
+            if(retry) fallback = 1;
+            if(retry && err == -ENOSPC) full = 1;
+            jobs[i]->res = err;
+        }
+
+        if(fallback)
+        {
+            mdb_txn_abort(txn);
+        }
+        else if((mdb_res = mdb_txn_commit(txn)) == MDB_SUCCESS)
+        {
+            atomic_fetch_add(&s->owner->commits, 1);
+        }
+        else
+        {
+            int err = _errno(mdb_res, &retry);
+            if(retry) fallback = 1;
+            if(retry && err == -ENOSPC) full = 1;
+            for(size_t i = 0; i < n && !fallback; i++)
+            {
+                if(jobs[i]->res == 0) jobs[i]->res = err;
+            }
+        }
+    }
+    pthread_rwlock_unlock(&s->gate);
+
+    if(fallback) EML_WARN(LOG_TAG, "_run_group: group of %zu parts redone one by one", n);
+
+    /* Room first, or every part hits the same wall */
+    int grow_rc = full ? _grow(s, 1) : 0;
+
+    for(size_t i = 0; i < n; i++)
+    {
+        if(fallback) jobs[i]->res = grow_rc ? grow_rc : _run_alone(s, jobs[i]);
+
+        /* The job lives on the caller's stack: last touch */
+        sem_post(jobs[i]->done);
+    }
+}
+
+static int _run_alone(shard_t* s, shard_job_t* job)
+{
+    int err = -EIO;
+
+    for(int attempt = 0; attempt < DB_LMDB_RETRY_OPS_EXEC; attempt++)
+    {
+        MDB_txn* txn   = NULL;
+        int      retry = 0;
+
+        pthread_rwlock_rdlock(&s->gate);
+        int mdb_res = mdb_txn_begin(s->env, NULL, 0, &txn);
+        if(mdb_res != MDB_SUCCESS)
+        {
+            err = _errno(mdb_res, &retry);
+        }
+        else if((err = _apply(s, txn, job, &retry)) != 0)
+        {
+            mdb_txn_abort(txn);
+        }
+        else if((mdb_res = mdb_txn_commit(txn)) != MDB_SUCCESS)
+        {
+            err = _errno(mdb_res, &retry);
+        }
+        else
+        {
+            atomic_fetch_add(&s->owner->commits, 1);
+        }
+        pthread_rwlock_unlock(&s->gate);
+
+        if(!retry) return err;
+
+        /* Out of the gate: grow when full, else pick up a resize by another process */
+        int rc = _grow(s, err == -ENOSPC);
+        if(rc != 0) return rc;
+    }
+
+    return err;
+}
+
+static int _run_reads(shard_t* s, shard_job_t* job)
+{
+    int err = -EIO;
+
+    for(int attempt = 0; attempt < DB_LMDB_RETRY_OPS_EXEC; attempt++)
+    {
+        MDB_txn* txn   = NULL;
+        int      retry = 0;
+
+        pthread_rwlock_rdlock(&s->gate);
+        int mdb_res = mdb_txn_begin(s->env, NULL, MDB_RDONLY, &txn);
+        if(mdb_res != MDB_SUCCESS)
+        {
+            err = _errno(mdb_res, &retry);
+        }
+        else
+        {
+            err = _apply(s, txn, job, &retry);
+            mdb_txn_abort(txn);
+        }
+        pthread_rwlock_unlock(&s->gate);
+
+        if(!retry) return err;
+        if(_grow(s, 0) != 0) return err;
+    }
+
+    return err;
+}
+
+static int _apply(const shard_t* s, MDB_txn* txn, const shard_job_t* job, int* retry)
+{
+    const shards_t* sh = s->owner;
+
+    for(size_t k = 0; k < job->n; k++)
+    {
+        const shard_op_t* op      = &job->ops[job->idx[k]];
+        MDB_val           key     = { op->key_size, op->key };
+        MDB_val           val     = { op->val_size, op->val };
+        int               mdb_res = MDB_SUCCESS;
+
+        switch(op->type)
+        {
+            case DB_OPERATION_PUT:
+                mdb_res = mdb_put(txn, s->dbis[op->dbi], &key, &val, sh->put_flags[op->dbi]);
+                break;
+            case DB_OPERATION_DEL:
+                mdb_res = mdb_del(txn, s->dbis[op->dbi], &key, op->val ? &val : NULL);
+                break;
+            case DB_OPERATION_GET:
+                mdb_res = mdb_get(txn, s->dbis[op->dbi], &key, &val);
+                if(mdb_res != MDB_SUCCESS) break;
+                if(val.mv_size > op->val_size)
+                {
+                    EML_ERROR(LOG_TAG, "_apply: user buffer too small (buf_size=%zu needed=%zu)",
+                              op->val_size, val.mv_size);
+                    return -ENOBUFS;
+                }
+                memcpy(op->val, val.mv_data, val.mv_size);
+                break;
+            default:
+                return -EINVAL;
+        }
+
+        if(mdb_res != MDB_SUCCESS) return _errno(mdb_res, retry);
+    }
+
+    return 0;
+}
+
+static int _grow(shard_t* s, const int full)
+{
+    const shards_t* sh   = s->owner;
+    size_t          size = 0;
+
+    /* No txn of this env may be open while the map is resized */
+    pthread_rwlock_wrlock(&s->gate);
+    if(full)
+    {
+        if(s->map_size >= sh->map_max)
+        {
+            pthread_rwlock_unlock(&s->gate);
+            EML_ERROR(LOG_TAG, "_grow: map of %zu bytes at its limit", s->map_size);
+            return -ENOSPC;
+        }
+        size = s->map_size + sh->grow_step;
+        if(size > sh->map_max) size = sh->map_max;
+    }
+
+    int mdb_res = mdb_env_set_mapsize(s->env, size);
+    if(mdb_res == MDB_SUCCESS && full)
+    {
+        s->map_size = size;
+        atomic_fetch_add(&s->owner->grows, 1);
+    }
+    else if(mdb_res == MDB_SUCCESS)
+    {
+        MDB_envinfo info;
+        if(mdb_env_info(s->env, &info) == MDB_SUCCESS) s->map_size = info.me_mapsize;
+    }
+    pthread_rwlock_unlock(&s->gate);
+
+    if(mdb_res != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_grow: mdb_env_set_mapsize", mdb_res);
+        int retry = 0;
+        return _errno(mdb_res, &retry);
+    }
+    if(full) EML_INFO(LOG_TAG, "_grow: map grown to %zu bytes", size);
+    return 0;
+}
+
+static int _errno(const int rc, int* retry)
+{
+    int err = 0;
+    *retry  = security_check(rc, NULL, &err) == DB_SAFETY_RETRY;
+    return err ? err : -EIO;
+}
+
+static void _push(shard_t* s, shard_job_t* job)
+{
+    pthread_mutex_lock(&s->lock);
+    if(s->tail) s->tail->next = job;
+    else s->head = job;
+    s->tail = job;
+    pthread_cond_signal(&s->work);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void _batch_clear(shard_batch_t* batch)
+{
+    batch->n_ops = 0;
+    ops_arena_reset(&batch->arena);
+}
+
+static void _sem_wait(sem_t* sem)
+{
+    while(sem_wait(sem) != 0 && errno == EINTR)
+    {
+    }
+}
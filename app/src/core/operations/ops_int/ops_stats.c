@@ -0,0 +1,305 @@
+/**
+ * @file ops_stats.c
+ *
+ */
+
+#include <pthread.h>   /* pthread_key_t, pthread_once_t */
+#include <stdatomic.h> /* atomic_* */
+#include <stdlib.h>    /* calloc */
+#include <string.h>    /* memset */
+#include <time.h>      /* clock_gettime */
+
+#include "common.h" /* EML_* macros, DB_LMDB_METRICS */
+#include "lmdb.h"   /* MDB_* codes */
+#include "ops_stats.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_stats"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+typedef struct
+{
+    atomic_size_t count;
+    atomic_size_t sum;
+    atomic_size_t buckets[DB_STATS_BUCKETS];
+} stats_hist_t;
+
+/**
+ * @brief Counters of one thread.
+ *
+ * Only the owning thread writes a slot (plain load + store, no locked
+ * RMW); readers sum all slots. Slots are never freed: a thread that exits
+ * hands its slot, counts included, to the next new thread.
+ */
+typedef struct stats_slot
+{
+    stats_hist_t       lat[DB_STATS_LAT_MAX];
+    stats_hist_t       batch_ops;
+    atomic_size_t      txn_rw;
+    atomic_size_t      txn_ro;
+    atomic_size_t      retries[DB_STATS_RETRY_MAX];
+    atomic_size_t      rw_cache_bytes;
+    atomic_int         in_use; /**< Non-zero while a thread owns the slot. */
+    struct stats_slot* next;   /**< Registry link, set once. */
+} stats_slot_t;
+
+#endif /* DB_LMDB_METRICS */
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+/* Push-only registry of every slot */
+static _Atomic(stats_slot_t*) slots = NULL;
+
+static _Thread_local stats_slot_t* my_slot = NULL;
+
+static pthread_key_t  slot_key;
+static pthread_once_t slot_key_once = PTHREAD_ONCE_INIT;
+
+#endif /* DB_LMDB_METRICS */
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+/**
+ * @brief Return the calling thread's slot, claiming or creating it on demand.
+ *
+ * @return The slot, NULL when none could be allocated (samples are dropped).
+ */
+static stats_slot_t* _slot(void);
+
+/**
+ * @brief pthread key destructor: release the slot for the next thread.
+ */
+static void _slot_release(void* arg);
+
+static void _slot_key_create(void);
+
+/**
+ * @brief Single-writer increment: lock-free and no bus lock.
+ */
+static inline void _add(atomic_size_t* c, const size_t v)
+{
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v,
+                          memory_order_relaxed);
+}
+
+/**
+ * @brief Add @p v to histogram @p h.
+ */
+static void _hist_add(stats_hist_t* h, const size_t v);
+
+/**
+ * @brief Accumulate histogram @p h into @p out.
+ */
+static void _hist_sum(const stats_hist_t* h, db_hist_t* out);
+
+#endif /* DB_LMDB_METRICS */
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+uint64_t ops_stats_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+void ops_stats_lat(const db_stats_lat_t which, const uint64_t t0)
+{
+    stats_slot_t* s = _slot();
+    if(!s || (unsigned)which >= DB_STATS_LAT_MAX) return;
+
+    const uint64_t now = ops_stats_now();
+    _hist_add(&s->lat[which], (size_t)(now > t0 ? now - t0 : 0));
+}
+
+void ops_stats_batch(const size_t n_ops)
+{
+    stats_slot_t* s = _slot();
+    if(s) _hist_add(&s->batch_ops, n_ops);
+}
+
+void ops_stats_txn(const int ro)
+{
+    stats_slot_t* s = _slot();
+    if(s) _add(ro ? &s->txn_ro : &s->txn_rw, 1);
+}
+
+void ops_stats_retry(const int mdb_rc)
+{
+    stats_slot_t* s = _slot();
+    if(!s) return;
+
+    db_stats_retry_t which;
+    switch(mdb_rc)
+    {
+        case MDB_MAP_FULL:
+            which = DB_STATS_RETRY_MAP_FULL;
+            break;
+        case MDB_MAP_RESIZED:
+            which = DB_STATS_RETRY_MAP_RESIZED;
+            break;
+        case MDB_TXN_FULL:
+            which = DB_STATS_RETRY_TXN_FULL;
+            break;
+        case MDB_PAGE_FULL:
+            which = DB_STATS_RETRY_PAGE_FULL;
+            break;
+        case MDB_CURSOR_FULL:
+            which = DB_STATS_RETRY_CURSOR_FULL;
+            break;
+        case MDB_READERS_FULL:
+        case MDB_BAD_RSLOT:
+            which = DB_STATS_RETRY_READERS;
+            break;
+        default:
+            return;
+    }
+    _add(&s->retries[which], 1);
+}
+
+void ops_stats_rw_cache(const size_t bytes)
+{
+    stats_slot_t* s = _slot();
+    if(s) _add(&s->rw_cache_bytes, bytes);
+}
+
+void ops_stats_snapshot(db_stats_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(*out));
+
+    for(stats_slot_t* s = atomic_load(&slots); s; s = s->next)
+    {
+        for(unsigned i = 0; i < DB_STATS_LAT_MAX; i++)
+        {
+            _hist_sum(&s->lat[i], &out->lat_ns[i]);
+        }
+        _hist_sum(&s->batch_ops, &out->batch_ops);
+        out->txn_rw += atomic_load_explicit(&s->txn_rw, memory_order_relaxed);
+        out->txn_ro += atomic_load_explicit(&s->txn_ro, memory_order_relaxed);
+        for(unsigned i = 0; i < DB_STATS_RETRY_MAX; i++)
+        {
+            out->retries[i] += atomic_load_explicit(&s->retries[i], memory_order_relaxed);
+        }
+        out->rw_cache_bytes += atomic_load_explicit(&s->rw_cache_bytes, memory_order_relaxed);
+    }
+}
+
+#else /* !DB_LMDB_METRICS */
+
+void ops_stats_snapshot(db_stats_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(*out));
+}
+
+#endif /* DB_LMDB_METRICS */
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+#if DB_LMDB_METRICS
+
+static stats_slot_t* _slot(void)
+{
+    if(my_slot) return my_slot;
+
+    pthread_once(&slot_key_once, _slot_key_create);
+
+    /* Take over the slot of an exited thread first */
+    stats_slot_t* s = NULL;
+    for(stats_slot_t* it = atomic_load(&slots); it; it = it->next)
+    {
+        int free_slot = 0;
+        if(atomic_compare_exchange_strong(&it->in_use, &free_slot, 1))
+        {
+            s = it;
+            break;
+        }
+    }
+
+    if(!s)
+    {
+        s = calloc(1, sizeof(*s));
+        if(!s)
+        {
+            EML_ERROR(LOG_TAG, "_slot: calloc(slot) failed, samples dropped");
+            return NULL;
+        }
+        atomic_store(&s->in_use, 1);
+
+        stats_slot_t* head = atomic_load(&slots);
+        do
+        {
+            s->next = head;
+        } while(!atomic_compare_exchange_weak(&slots, &head, s));
+    }
+
+    my_slot = s;
+    pthread_setspecific(slot_key, s);
+    return s;
+}
+
+static void _slot_release(void* arg)
+{
+    stats_slot_t* s = arg;
+    if(s) atomic_store(&s->in_use, 0);
+}
+
+static void _slot_key_create(void)
+{
+    (void)pthread_key_create(&slot_key, _slot_release);
+}
+
+static void _hist_add(stats_hist_t* h, const size_t v)
+{
+    /* Bucket of the highest set bit, the last one takes the tail */
+    unsigned b = v ? (unsigned)(sizeof(unsigned long long) * 8u) - (unsigned)__builtin_clzll(v)
+                   : 0u;
+    if(b >= DB_STATS_BUCKETS) b = DB_STATS_BUCKETS - 1u;
+
+    _add(&h->count, 1);
+    _add(&h->sum, v);
+    _add(&h->buckets[b], 1);
+}
+
+static void _hist_sum(const stats_hist_t* h, db_hist_t* out)
+{
+    out->count += atomic_load_explicit(&h->count, memory_order_relaxed);
+    out->sum += atomic_load_explicit(&h->sum, memory_order_relaxed);
+    for(unsigned i = 0; i < DB_STATS_BUCKETS; i++)
+    {
+        out->buckets[i] += atomic_load_explicit(&h->buckets[i], memory_order_relaxed);
+    }
+}
+
+#endif /* DB_LMDB_METRICS */
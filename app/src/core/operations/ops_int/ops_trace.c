@@ -0,0 +1,70 @@
+/**
+ * @file ops_trace.c
+ *
+ */
+
+#include "common.h" /* EML_* macros */
+#include "ops_trace.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_trace"
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+_Atomic(db_trace_cb_t) ops_trace_cb = NULL;
+
+static void* _Atomic trace_ctx = NULL;
+
+#if DB_LMDB_USDT
+/* Raised by the tracer on attach, see _SDT_HAS_SEMAPHORES in sys/sdt.h */
+__attribute__((section(".probes"))) volatile unsigned short db_lmdb_batch_start_semaphore = 0;
+__attribute__((section(".probes"))) volatile unsigned short db_lmdb_txn_begun_semaphore   = 0;
+__attribute__((section(".probes"))) volatile unsigned short db_lmdb_ops_done_semaphore    = 0;
+__attribute__((section(".probes"))) volatile unsigned short db_lmdb_batch_end_semaphore   = 0;
+#endif
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+/* None */
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+void ops_trace_set(db_trace_cb_t cb, void* ctx)
+{
+    /* ctx first: a batch that sees the new cb sees its ctx */
+    atomic_store(&ops_trace_cb, NULL);
+    atomic_store(&trace_ctx, ctx);
+    atomic_store(&ops_trace_cb, cb);
+
+    EML_INFO(LOG_TAG, "ops_trace_set: tracing %s", cb ? "on" : "off");
+}
+
+void ops_trace_emit(const db_trace_t* trace)
+{
+    db_trace_cb_t cb = atomic_load(&ops_trace_cb);
+    if(cb) cb(trace, atomic_load(&trace_ctx));
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+/* None */
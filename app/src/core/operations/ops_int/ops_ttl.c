@@ -0,0 +1,754 @@
+/**
+ * @file ops_ttl.c
+ *
+ */
+
+#include <errno.h>     /* EALREADY, EINVAL, ENOMEM, ENOTCONN, ETIMEDOUT */
+#include <limits.h>    /* UINT_MAX */
+#include <pthread.h>   /* pthread_* */
+#include <stdatomic.h> /* atomic_* */
+#include <stdlib.h>    /* calloc, free */
+#include <string.h>    /* memcmp, memcpy */
+#include <time.h>      /* clock_gettime */
+#include <unistd.h>    /* usleep */
+
+#include "common.h" /* EML_* macros, LMDB_EML_* */
+#include "db.h"     /* DataBase */
+#include "ops_actions.h"
+#include "ops_bloom.h"
+#include "ops_index.h"
+#include "ops_map.h"
+#include "ops_ttl.h"
+#include "ops_vcache.h"
+#include "ops_zip.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_ttl"
+
+/* Queue keys: 'E' expires_be dbi key -> mark, oldest deadline first, and
+   'K' dbi key -> expires_be, the deadline that counts for the key */
+#define TTL_TAG_DUE    'E'
+#define TTL_TAG_KEY    'K'
+#define TTL_DUE_PREFIX 10u
+#define TTL_KEY_PREFIX 2u
+#define TTL_QUEUE_KEY  (TTL_DUE_PREFIX + DB_LMDB_TTL_KEY_MAX)
+
+/* DBIs with a bit in armed_dbis, the others always count as armed */
+#define TTL_MASK_DBIS  32u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Expired key found by the read half of a sweep.
+ */
+typedef struct
+{
+    uint64_t      expires;                  /**< Deadline of the queue entry. */
+    unsigned      dbi;                      /**< DBI of the record. */
+    size_t        size;                     /**< Key size. */
+    unsigned char key[DB_LMDB_TTL_KEY_MAX]; /**< Key bytes. */
+} ttl_entry_t;
+
+/**
+ * @brief Expiry queue and its sweeper thread.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;         /**< Protects running, paired with wake. */
+    pthread_cond_t  wake;         /**< Signalled on stop. */
+    pthread_mutex_t sweep_lock;   /**< One sweep at a time, owns entries. */
+    pthread_t       thread;       /**< Sweeper thread. */
+    int             running;      /**< Non-zero while the thread runs. */
+    atomic_int      queue;        /**< Queue DBI index, -1 when off. */
+    unsigned        period_ms;    /**< Time between two sweeps. */
+    size_t          batch;        /**< Entries per write txn. */
+    size_t          max_per_tick; /**< Entries per sweep of the thread. */
+    ttl_entry_t*    entries;      /**< batch slots. */
+    atomic_uint     armed_dbis;   /**< Bit i: DBI i may have deadlines. */
+    atomic_size_t   armed;
+    atomic_size_t   disarmed;
+    atomic_size_t   expired;
+    atomic_size_t   stale;
+    atomic_size_t   txns;
+    atomic_size_t   sweeps;
+} ttl_sweeper_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+static ttl_sweeper_t ttl = { .lock       = PTHREAD_MUTEX_INITIALIZER,
+                             .wake       = PTHREAD_COND_INITIALIZER,
+                             .sweep_lock = PTHREAD_MUTEX_INITIALIZER,
+                             .queue      = -1 };
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static void*    _sweeper_main(void* arg);
+static size_t   _due_key(unsigned char* out, const uint64_t expires, const unsigned dbi,
+                         const void* key, const size_t size);
+static size_t   _key_key(unsigned char* out, const unsigned dbi, const void* key,
+                         const size_t size);
+static void     _be64_put(unsigned char* p, const uint64_t v);
+static uint64_t _be64_get(const unsigned char* p);
+static int      _collect(const uint64_t now, const size_t want, size_t* out_n);
+static unsigned _armed_scan(const unsigned queue);
+static int      _unqueue(MDB_txn* txn, const MDB_dbi q, MDB_val* k);
+static long     _expire(const size_t n);
+static db_security_ret_code_t _expire_txn(const size_t n, size_t* expired, size_t* stale,
+                                          int* const out_err);
+static db_security_ret_code_t _expire_one(MDB_txn* txn, const ttl_entry_t* e, size_t* expired,
+                                          size_t* stale, int* const out_err);
+static void _cache_begin(const unsigned dbi);
+static void _cache_end(const unsigned dbi, const void* key, const size_t size);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_ttl_start(const db_ttl_cfg_t* cfg)
+{
+    if(!cfg || !DataBase || !DataBase->dbis || cfg->queue_dbi >= DataBase->n_dbis ||
+       DataBase->dbis[cfg->queue_dbi].is_dupsort || ops_zip_on(cfg->queue_dbi))
+    {
+        EML_ERROR(LOG_TAG, "ops_ttl_start: invalid input");
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&ttl.lock);
+    if(ttl.running)
+    {
+        pthread_mutex_unlock(&ttl.lock);
+        EML_ERROR(LOG_TAG, "ops_ttl_start: sweeper already running");
+        return -EALREADY;
+    }
+
+    ttl.period_ms    = cfg->period_ms ? cfg->period_ms : DB_LMDB_TTL_PERIOD_MS;
+    ttl.batch        = cfg->batch ? cfg->batch : DB_LMDB_TTL_BATCH;
+    ttl.max_per_tick = cfg->max_per_tick ? cfg->max_per_tick : DB_LMDB_TTL_MAX_PER_TICK;
+    ttl.entries      = calloc(ttl.batch, sizeof(ttl_entry_t));
+    if(!ttl.entries)
+    {
+        pthread_mutex_unlock(&ttl.lock);
+        EML_ERROR(LOG_TAG, "ops_ttl_start: no memory for %zu entries", ttl.batch);
+        return -ENOMEM;
+    }
+
+    atomic_store(&ttl.armed, 0);
+    atomic_store(&ttl.disarmed, 0);
+    atomic_store(&ttl.expired, 0);
+    atomic_store(&ttl.stale, 0);
+    atomic_store(&ttl.txns, 0);
+    atomic_store(&ttl.sweeps, 0);
+    atomic_store(&ttl.armed_dbis, _armed_scan(cfg->queue_dbi));
+    atomic_store(&ttl.queue, (int)cfg->queue_dbi);
+
+    ttl.running = 1;
+    int rc      = pthread_create(&ttl.thread, NULL, _sweeper_main, NULL);
+    if(rc != 0)
+    {
+        ttl.running = 0;
+        atomic_store(&ttl.queue, -1);
+        free(ttl.entries);
+        ttl.entries = NULL;
+    }
+    pthread_mutex_unlock(&ttl.lock);
+
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_ttl_start: pthread_create failed (%d)", rc);
+        return -rc;
+    }
+
+    EML_INFO(LOG_TAG, "ops_ttl_start: queue dbi %u, sweep every %u ms", cfg->queue_dbi,
+             ttl.period_ms);
+    return 0;
+}
+
+void ops_ttl_stop(void)
+{
+    pthread_mutex_lock(&ttl.lock);
+    if(!ttl.running)
+    {
+        pthread_mutex_unlock(&ttl.lock);
+        return;
+    }
+    ttl.running = 0;
+    pthread_cond_signal(&ttl.wake);
+    pthread_mutex_unlock(&ttl.lock);
+
+    pthread_join(ttl.thread, NULL);
+
+    /* A manual sweep may still hold the entries */
+    pthread_mutex_lock(&ttl.sweep_lock);
+    atomic_store(&ttl.queue, -1);
+    free(ttl.entries);
+    ttl.entries = NULL;
+    pthread_mutex_unlock(&ttl.sweep_lock);
+}
+
+int ops_ttl_queue(void)
+{
+    return atomic_load_explicit(&ttl.queue, memory_order_acquire);
+}
+
+uint64_t ops_ttl_now_ms(void)
+{
+    /* Wall clock: deadlines outlive the process */
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+db_security_ret_code_t ops_ttl_arm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                   const uint64_t expires, int* const out_err)
+{
+    /* Check input */
+    const int queue = ops_ttl_queue();
+    if(!txn || !key || queue < 0 || key->mv_size == 0 || key->mv_size > DB_LMDB_TTL_KEY_MAX ||
+       !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_ttl_arm: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    /* Copy first: the queue writes may spill the page key points into */
+    const MDB_dbi q = DataBase->dbis[queue].dbi;
+    unsigned char kbuf[TTL_KEY_PREFIX + DB_LMDB_TTL_KEY_MAX];
+    unsigned char ebuf[TTL_QUEUE_KEY];
+    MDB_val       k = { _key_key(kbuf, dbi, key->mv_data, key->mv_size), kbuf };
+    MDB_val       cur;
+
+    /* Only the last deadline of a key stays queued */
+    int mdb_res = mdb_get(txn, q, &k, &cur);
+    if(mdb_res == MDB_SUCCESS && cur.mv_size == sizeof(uint64_t))
+    {
+        const uint64_t old = _be64_get(cur.mv_data);
+        if(old == expires) return DB_SAFETY_SUCCESS;
+
+        MDB_val due = { _due_key(ebuf, old, dbi, kbuf + TTL_KEY_PREFIX, key->mv_size), ebuf };
+        mdb_res     = mdb_del(txn, q, &due, NULL);
+    }
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    unsigned char be[sizeof(uint64_t)];
+    _be64_put(be, expires);
+    MDB_val v = { sizeof(be), be };
+    ops_bloom_add((unsigned)queue, k.mv_data, k.mv_size);
+    mdb_res = mdb_put(txn, q, &k, &v, 0);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* The value is unused, the key says it all */
+    static unsigned char mark = 0;
+    MDB_val due = { _due_key(ebuf, expires, dbi, kbuf + TTL_KEY_PREFIX, key->mv_size), ebuf };
+    MDB_val m   = { sizeof(mark), &mark };
+    ops_bloom_add((unsigned)queue, due.mv_data, due.mv_size);
+    mdb_res = mdb_put(txn, q, &due, &m, 0);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Later writes of the DBI now check for a deadline to drop */
+    if(dbi < TTL_MASK_DBIS) atomic_fetch_or(&ttl.armed_dbis, 1u << dbi);
+    atomic_fetch_add_explicit(&ttl.armed, 1, memory_order_relaxed);
+    return DB_SAFETY_SUCCESS;
+}
+
+int ops_ttl_armed(const unsigned dbi)
+{
+    const int queue = ops_ttl_queue();
+    if(queue < 0 || dbi == (unsigned)queue) return 0;
+    if(dbi >= TTL_MASK_DBIS) return 1;
+    return (atomic_load(&ttl.armed_dbis) >> dbi) & 1u;
+}
+
+db_security_ret_code_t ops_ttl_disarm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                      int* const out_err)
+{
+    /* Check input */
+    const int queue = ops_ttl_queue();
+    if(!txn || !key || queue < 0 || !DataBase || !DataBase->dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_ttl_disarm: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    /* Too long to have been armed */
+    if(key->mv_size == 0 || key->mv_size > DB_LMDB_TTL_KEY_MAX) return DB_SAFETY_SUCCESS;
+
+    /* Copy first, as in ops_ttl_arm */
+    unsigned char kbuf[TTL_KEY_PREFIX + DB_LMDB_TTL_KEY_MAX];
+    MDB_val       k = { _key_key(kbuf, dbi, key->mv_data, key->mv_size), kbuf };
+    if(!ops_bloom_maybe((unsigned)queue, k.mv_data, k.mv_size)) return DB_SAFETY_SUCCESS;
+
+    int mdb_res = _unqueue(txn, DataBase->dbis[queue].dbi, &k);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_ttl_disarm_del(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                          int* const out_err)
+{
+    /* Dups left: the key and its deadline live on */
+    if(txn && key && DataBase && DataBase->dbis && dbi < DataBase->n_dbis &&
+       DataBase->dbis[dbi].is_dupsort)
+    {
+        MDB_val k       = *key;
+        MDB_val v;
+        int     mdb_res = mdb_get(txn, DataBase->dbis[dbi].dbi, &k, &v);
+        if(mdb_res == MDB_SUCCESS) return DB_SAFETY_SUCCESS;
+        if(mdb_res != MDB_NOTFOUND) return security_fail_txn(mdb_res, txn, out_err);
+    }
+
+    return ops_ttl_disarm(txn, dbi, key, out_err);
+}
+
+db_security_ret_code_t ops_ttl_disarm_range(MDB_txn* txn, const unsigned dbi,
+                                            const MDB_val* start, const MDB_val* end,
+                                            int* const out_err)
+{
+    /* Check input */
+    const int queue = ops_ttl_queue();
+    if(!txn || queue < 0 || !DataBase || !DataBase->dbis || dbi >= DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_ttl_disarm_range: invalid input");
+        return security_abort_txn(txn, -EINVAL, out_err);
+    }
+
+    const MDB_dbi q   = DataBase->dbis[queue].dbi;
+    const MDB_dbi d   = DataBase->dbis[dbi].dbi;
+    MDB_cursor*   cur = NULL;
+    int           mdb_res = mdb_cursor_open(txn, q, &cur);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Queue keys sort by bytes, not in the order of the DBI: every
+    deadline of the DBI is checked against the bounds */
+    unsigned char kbuf[TTL_KEY_PREFIX + DB_LMDB_TTL_KEY_MAX] = { TTL_TAG_KEY, (unsigned char)dbi };
+    MDB_val       k = { TTL_KEY_PREFIX, kbuf };
+    MDB_val       v;
+    size_t        n = 0;
+    for(mdb_res = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE); mdb_res == MDB_SUCCESS;)
+    {
+        const unsigned char* p = k.mv_data;
+        if(k.mv_size <= TTL_KEY_PREFIX || k.mv_size > sizeof(kbuf) || p[0] != TTL_TAG_KEY ||
+           p[1] != (unsigned char)dbi)
+        {
+            break;
+        }
+
+        MDB_val rk = { k.mv_size - TTL_KEY_PREFIX, (void*)(p + TTL_KEY_PREFIX) };
+        if((start && mdb_cmp(txn, d, &rk, start) < 0) || (end && mdb_cmp(txn, d, &rk, end) >= 0))
+        {
+            mdb_res = mdb_cursor_get(cur, &k, &v, MDB_NEXT);
+            continue;
+        }
+
+        /* Out of the page before the deletes reshape it, then on past it */
+        memcpy(kbuf, k.mv_data, k.mv_size);
+        k.mv_data = kbuf;
+        mdb_res   = _unqueue(txn, q, &k);
+        if(mdb_res != MDB_SUCCESS) break;
+        n++;
+        mdb_res = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE);
+    }
+    mdb_cursor_close(cur);
+
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+    if(n) DB_HOT_DBG(LOG_TAG, "ops_ttl_disarm_range: %zu deadlines dropped", n);
+    return DB_SAFETY_SUCCESS;
+}
+
+long ops_ttl_sweep(const uint64_t now, const size_t max)
+{
+    pthread_mutex_lock(&ttl.sweep_lock);
+    if(ops_ttl_queue() < 0)
+    {
+        pthread_mutex_unlock(&ttl.sweep_lock);
+        return -ENOTCONN;
+    }
+
+    long   done = 0;
+    size_t seen = 0;
+    while(seen < max)
+    {
+        const size_t want = max - seen < ttl.batch ? max - seen : ttl.batch;
+        size_t       n    = 0;
+        long         rc   = _collect(now, want, &n);
+        if(rc == 0 && n) rc = _expire(n);
+        if(rc < 0)
+        {
+            EML_WARN(LOG_TAG, "ops_ttl_sweep: stopped after %ld keys (%ld)", done, rc);
+            done = rc;
+            break;
+        }
+
+        done += rc;
+        seen += n;
+        if(n < want) break;
+
+        /* Foreground batches queue on the writer lock meanwhile, let them in */
+        usleep(DB_LMDB_TTL_PAUSE_US);
+    }
+    atomic_fetch_add_explicit(&ttl.sweeps, 1, memory_order_relaxed);
+    pthread_mutex_unlock(&ttl.sweep_lock);
+
+    if(done > 0) DB_HOT_DBG(LOG_TAG, "ops_ttl_sweep: %ld keys expired", done);
+    return done;
+}
+
+void ops_ttl_stats(db_ttl_stats_t* out)
+{
+    if(!out) return;
+
+    out->armed    = atomic_load_explicit(&ttl.armed, memory_order_relaxed);
+    out->disarmed = atomic_load_explicit(&ttl.disarmed, memory_order_relaxed);
+    out->expired  = atomic_load_explicit(&ttl.expired, memory_order_relaxed);
+    out->stale    = atomic_load_explicit(&ttl.stale, memory_order_relaxed);
+    out->txns     = atomic_load_explicit(&ttl.txns, memory_order_relaxed);
+    out->sweeps   = atomic_load_explicit(&ttl.sweeps, memory_order_relaxed);
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void* _sweeper_main(void* arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&ttl.lock);
+    while(ttl.running)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += ttl.period_ms / 1000u;
+        deadline.tv_nsec += (long)(ttl.period_ms % 1000u) * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L)
+        {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int rc = 0;
+        while(ttl.running && rc != ETIMEDOUT)
+        {
+            rc = pthread_cond_timedwait(&ttl.wake, &ttl.lock, &deadline);
+        }
+        if(!ttl.running) break;
+
+        /* Sweep outside the lock, stop must not wait on the txns */
+        pthread_mutex_unlock(&ttl.lock);
+        ops_ttl_sweep(ops_ttl_now_ms(), ttl.max_per_tick);
+        pthread_mutex_lock(&ttl.lock);
+    }
+    pthread_mutex_unlock(&ttl.lock);
+
+    return NULL;
+}
+
+static size_t _due_key(unsigned char* out, const uint64_t expires, const unsigned dbi,
+                       const void* key, const size_t size)
+{
+    out[0] = TTL_TAG_DUE;
+    _be64_put(out + 1, expires);
+    out[9] = (unsigned char)dbi;
+    memcpy(out + TTL_DUE_PREFIX, key, size);
+    return TTL_DUE_PREFIX + size;
+}
+
+static size_t _key_key(unsigned char* out, const unsigned dbi, const void* key,
+                       const size_t size)
+{
+    out[0] = TTL_TAG_KEY;
+    out[1] = (unsigned char)dbi;
+    memcpy(out + TTL_KEY_PREFIX, key, size);
+    return TTL_KEY_PREFIX + size;
+}
+
+static void _be64_put(unsigned char* p, const uint64_t v)
+{
+    for(int i = 7; i >= 0; i--) p[7 - i] = (unsigned char)(v >> (i * 8));
+}
+
+static uint64_t _be64_get(const unsigned char* p)
+{
+    uint64_t v = 0;
+    for(int i = 0; i < 8; i++) v = (v << 8) | p[i];
+    return v;
+}
+
+/**
+ * @brief Read up to @p want queue entries due at @p now into the entries, oldest first.
+ */
+static int _collect(const uint64_t now, const size_t want, size_t* out_n)
+{
+    const MDB_dbi q   = DataBase->dbis[ops_ttl_queue()].dbi;
+    MDB_txn*      txn = NULL;
+    MDB_cursor*   cur = NULL;
+    int           err = -EIO;
+
+    ops_map_enter();
+    if(act_txn_begin(&txn, MDB_RDONLY, &err) != DB_SAFETY_SUCCESS)
+    {
+        ops_map_leave();
+        return err;
+    }
+
+    int mdb_res = mdb_cursor_open(txn, q, &cur);
+    if(mdb_res == MDB_SUCCESS)
+    {
+        unsigned char tag = TTL_TAG_DUE;
+        MDB_val       k   = { 1, &tag };
+        MDB_val       v;
+        for(mdb_res = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE);
+            mdb_res == MDB_SUCCESS && *out_n < want;
+            mdb_res = mdb_cursor_get(cur, &k, &v, MDB_NEXT))
+        {
+            const unsigned char* p = k.mv_data;
+            if(k.mv_size <= TTL_DUE_PREFIX || k.mv_size > TTL_QUEUE_KEY || p[0] != TTL_TAG_DUE)
+            {
+                break;
+            }
+            const uint64_t expires = _be64_get(p + 1);
+            if(expires > now) break;
+
+            ttl_entry_t* e = &ttl.entries[(*out_n)++];
+            e->expires     = expires;
+            e->dbi         = p[9];
+            e->size        = k.mv_size - TTL_DUE_PREFIX;
+            memcpy(e->key, p + TTL_DUE_PREFIX, e->size);
+        }
+        mdb_cursor_close(cur);
+    }
+    mdb_txn_abort(txn);
+    ops_map_leave();
+
+    if(mdb_res == MDB_SUCCESS || mdb_res == MDB_NOTFOUND) return 0;
+    LMDB_EML_WARN(LOG_TAG, "_collect: queue scan", mdb_res);
+    security_check(mdb_res, NULL, &err);
+    return err;
+}
+
+/**
+ * @brief DBIs with deadlines in the queue, from one seek per DBI.
+ *
+ * @return The armed_dbis mask, every bit set when the queue cannot be read.
+ */
+static unsigned _armed_scan(const unsigned queue)
+{
+    const MDB_dbi  q    = DataBase->dbis[queue].dbi;
+    const unsigned n    = DataBase->n_dbis < TTL_MASK_DBIS ? DataBase->n_dbis : TTL_MASK_DBIS;
+    MDB_txn*       txn  = NULL;
+    MDB_cursor*    cur  = NULL;
+    unsigned       mask = 0;
+    int            err  = -EIO;
+
+    ops_map_enter();
+    if(act_txn_begin(&txn, MDB_RDONLY, &err) != DB_SAFETY_SUCCESS)
+    {
+        ops_map_leave();
+        EML_WARN(LOG_TAG, "_armed_scan: no read txn (%d), every dbi checked", err);
+        return UINT_MAX;
+    }
+
+    int mdb_res = mdb_cursor_open(txn, q, &cur);
+    for(unsigned d = 0; d < n && mdb_res == MDB_SUCCESS; d++)
+    {
+        const unsigned char prefix[TTL_KEY_PREFIX] = { TTL_TAG_KEY, (unsigned char)d };
+        MDB_val             k                      = { sizeof(prefix), (void*)prefix };
+        MDB_val             v;
+        mdb_res = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE);
+        if(mdb_res == MDB_SUCCESS && k.mv_size > sizeof(prefix) &&
+           memcmp(k.mv_data, prefix, sizeof(prefix)) == 0)
+        {
+            mask |= 1u << d;
+        }
+    }
+    if(cur) mdb_cursor_close(cur);
+    mdb_txn_abort(txn);
+    ops_map_leave();
+
+    /* Past the last deadline: no later DBI has one either */
+    if(mdb_res == MDB_SUCCESS || mdb_res == MDB_NOTFOUND) return mask;
+    LMDB_EML_WARN(LOG_TAG, "_armed_scan: queue scan, every dbi checked", mdb_res);
+    return UINT_MAX;
+}
+
+/**
+ * @brief Delete key record @p k (in a caller buffer) and its queue entry.
+ *
+ * @return MDB_SUCCESS, also when the key has no deadline, or the LMDB error.
+ */
+static int _unqueue(MDB_txn* txn, const MDB_dbi q, MDB_val* k)
+{
+    MDB_val cur;
+    int     mdb_res = mdb_get(txn, q, k, &cur);
+    if(mdb_res == MDB_NOTFOUND) return MDB_SUCCESS;
+    if(mdb_res != MDB_SUCCESS) return mdb_res;
+
+    if(cur.mv_size == sizeof(uint64_t))
+    {
+        const unsigned char* p = k->mv_data;
+        unsigned char        ebuf[TTL_QUEUE_KEY];
+        MDB_val due = { _due_key(ebuf, _be64_get(cur.mv_data), p[1], p + TTL_KEY_PREFIX,
+                                 k->mv_size - TTL_KEY_PREFIX),
+                        ebuf };
+        mdb_res     = mdb_del(txn, q, &due, NULL);
+        if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND) return mdb_res;
+    }
+
+    mdb_res = mdb_del(txn, q, k, NULL);
+    if(mdb_res == MDB_SUCCESS) atomic_fetch_add_explicit(&ttl.disarmed, 1, memory_order_relaxed);
+    return mdb_res;
+}
+
+/**
+ * @brief Delete the @p n collected entries in one write txn.
+ *
+ * @return Records deleted, or a negative errno.
+ */
+static long _expire(const size_t n)
+{
+    const unsigned queue = (unsigned)ops_ttl_queue();
+
+    /* Same rule as a batch: cached values are off limits until the end */
+    ops_vcache_write_begin(queue);
+    for(size_t i = 0; i < n; i++) _cache_begin(ttl.entries[i].dbi);
+
+    long     res  = -EIO;
+    unsigned full = 0;
+    for(unsigned attempt = 0; attempt < DB_LMDB_RETRY_OPS_EXEC; attempt++)
+    {
+        size_t expired = 0;
+        size_t stale   = 0;
+        int    err     = -EIO;
+
+        ops_map_enter();
+        db_security_ret_code_t ret = _expire_txn(n, &expired, &stale, &err);
+        ops_map_leave();
+
+        if(ret == DB_SAFETY_SUCCESS)
+        {
+            ops_map_after_commit();
+            atomic_fetch_add_explicit(&ttl.expired, expired, memory_order_relaxed);
+            atomic_fetch_add_explicit(&ttl.stale, stale, memory_order_relaxed);
+            atomic_fetch_add_explicit(&ttl.txns, 1, memory_order_relaxed);
+            res = (long)expired;
+            break;
+        }
+
+        /* MAP_FULL: grow now that this thread is out of the gate */
+        res = err;
+        if(ret != DB_SAFETY_RETRY || (err == -ENOSPC && ops_map_on_full(full++) != 0)) break;
+    }
+
+    for(size_t i = 0; i < n; i++)
+    {
+        _cache_end(ttl.entries[i].dbi, ttl.entries[i].key, ttl.entries[i].size);
+    }
+    ops_vcache_write_end(queue, NULL, 0);
+    return res;
+}
+
+static db_security_ret_code_t _expire_txn(const size_t n, size_t* expired, size_t* stale,
+                                          int* const out_err)
+{
+    MDB_txn*               txn = NULL;
+    db_security_ret_code_t ret = act_txn_begin(&txn, 0, out_err);
+    if(ret != DB_SAFETY_SUCCESS) return ret;
+
+    for(size_t i = 0; i < n; i++)
+    {
+        ret = _expire_one(txn, &ttl.entries[i], expired, stale, out_err);
+        if(ret != DB_SAFETY_SUCCESS) return ret;
+    }
+    return act_txn_commit(txn, out_err);
+}
+
+/**
+ * @brief Drop the queue entry @p e and, if it is still the deadline of its key, the record.
+ */
+static db_security_ret_code_t _expire_one(MDB_txn* txn, const ttl_entry_t* e, size_t* expired,
+                                          size_t* stale, int* const out_err)
+{
+    const MDB_dbi q = DataBase->dbis[ops_ttl_queue()].dbi;
+    unsigned char buf[TTL_QUEUE_KEY];
+
+    /* Gone since the scan: another sweep took it */
+    MDB_val due     = { _due_key(buf, e->expires, e->dbi, e->key, e->size), buf };
+    int     mdb_res = mdb_del(txn, q, &due, NULL);
+    if(mdb_res == MDB_NOTFOUND) return DB_SAFETY_SUCCESS;
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Re-armed to a later deadline, or the DBI is gone from the env */
+    MDB_val k = { _key_key(buf, e->dbi, e->key, e->size), buf };
+    MDB_val v;
+    mdb_res = mdb_get(txn, q, &k, &v);
+    if(mdb_res != MDB_SUCCESS && mdb_res != MDB_NOTFOUND)
+    {
+        return security_fail_txn(mdb_res, txn, out_err);
+    }
+    if(mdb_res == MDB_NOTFOUND || v.mv_size != sizeof(uint64_t) ||
+       _be64_get(v.mv_data) != e->expires || e->dbi >= DataBase->n_dbis)
+    {
+        (*stale)++;
+        return DB_SAFETY_SUCCESS;
+    }
+    mdb_res = mdb_del(txn, q, &k, NULL);
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+
+    /* Index entries go with the record, as for a DEL */
+    MDB_val                key = { e->size, (void*)e->key };
+    ops_index_keys_t       old;
+    const int              indexed = ops_index_targets(e->dbi) != 0;
+    db_security_ret_code_t ret     = DB_SAFETY_SUCCESS;
+    if(indexed) ret = ops_index_before(txn, e->dbi, &key, &old, out_err);
+    if(ret != DB_SAFETY_SUCCESS) return ret;
+
+    /* Already deleted by the application */
+    mdb_res = mdb_del(txn, DataBase->dbis[e->dbi].dbi, &key, NULL);
+    if(mdb_res == MDB_NOTFOUND)
+    {
+        (*stale)++;
+        return DB_SAFETY_SUCCESS;
+    }
+    if(mdb_res != MDB_SUCCESS) return security_fail_txn(mdb_res, txn, out_err);
+    if(indexed) ret = ops_index_after(txn, e->dbi, &key, NULL, &old, out_err);
+    if(ret == DB_SAFETY_SUCCESS) (*expired)++;
+    return ret;
+}
+
+static void _cache_begin(const unsigned dbi)
+{
+    ops_vcache_write_begin(dbi);
+    for(unsigned t = ops_index_targets(dbi), d = 0; t; t >>= 1, d++)
+    {
+        if(t & 1u) ops_vcache_write_begin(d);
+    }
+}
+
+static void _cache_end(const unsigned dbi, const void* key, const size_t size)
+{
+    ops_vcache_write_end(dbi, key, size);
+    for(unsigned t = ops_index_targets(dbi), d = 0; t; t >>= 1, d++)
+    {
+        if(t & 1u) ops_vcache_write_end(d, NULL, 0);
+    }
+}
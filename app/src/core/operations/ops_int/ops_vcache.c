@@ -0,0 +1,459 @@
+/**
+ * @file ops_vcache.c
+ *
+ */
+
+#include <errno.h>     /* EINVAL, ENOENT, ENOMEM */
+#include <pthread.h>   /* pthread_mutex_t */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint64_t */
+#include <stdlib.h>    /* calloc, malloc, realloc, free */
+#include <string.h>    /* memcmp, memcpy, memset */
+
+#include "common.h" /* EML_* macros, DB_LMDB_VCACHE_* */
+#include "db.h"     /* DataBase */
+#include "ops_util.h" /* ops_fnv1a */
+#include "ops_vcache.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_vcache"
+
+/* Fewest hash buckets of a shard */
+#define VC_MIN_BUCKETS 16u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Cached key / value pair, key bytes then value bytes.
+ */
+typedef struct vc_entry
+{
+    struct vc_entry* next;     /**< Hash chain. */
+    uint64_t         hash;     /**< Hash of the key. */
+    size_t           ring;     /**< Position in the shard's CLOCK ring. */
+    size_t           key_size; /**< Key bytes. */
+    size_t           val_size; /**< Value bytes. */
+    int              ref;      /**< CLOCK bit, set by hits. */
+    unsigned char    data[];   /**< Key then value. */
+} vc_entry_t;
+
+/**
+ * @brief One lock's worth of entries.
+ *
+ * Entries sit in a hash table for lookups and in a ring for CLOCK: the
+ * hand clears the bit of referenced entries and evicts the first entry
+ * found without one. Removal moves the last ring entry into the hole.
+ */
+typedef struct
+{
+    pthread_mutex_t lock;
+    vc_entry_t**    buckets;   /**< Hash chains. */
+    size_t          mask;      /**< Buckets - 1. */
+    vc_entry_t**    ring;      /**< CLOCK ring, n_entries used. */
+    size_t          ring_cap;  /**< Slots allocated in ring. */
+    size_t          n_entries; /**< Entries cached. */
+    size_t          hand;      /**< CLOCK hand. */
+    size_t          bytes;     /**< Bytes charged. */
+    size_t          cap;       /**< Budget of the shard. */
+    /* Counters, under the lock */
+    size_t hits;
+    size_t misses;
+    size_t fills;
+    size_t evictions;
+    size_t invalidations;
+} vc_shard_t;
+
+/**
+ * @brief Cache of one DBI.
+ */
+typedef struct
+{
+    vc_shard_t*   shards;
+    size_t        shard_mask;   /**< Shards - 1. */
+    size_t        max_val_size; /**< Larger values are not cached. */
+    atomic_size_t pending;      /**< Writes begun and not ended. */
+} vc_dbi_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+/* Caches by DBI index, NULL when off; changed between batches only */
+static vc_dbi_t** caches   = NULL;
+static size_t     n_caches = 0;
+
+/* Writes ended so far, all DBIs */
+static atomic_size_t epoch = 0;
+
+/* Read window of this thread: epoch when it opened */
+static _Thread_local size_t rd_ticket = 0;
+static _Thread_local int    rd_open   = 0;
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static vc_dbi_t*   _cache(const unsigned dbi);
+static void        _cache_free(vc_dbi_t* c);
+static vc_shard_t* _shard(vc_dbi_t* c, const uint64_t h);
+static vc_entry_t* _find(vc_shard_t* s, const uint64_t h, const void* key, const size_t key_size);
+static void        _remove(vc_shard_t* s, vc_entry_t* e);
+static void        _clear(vc_shard_t* s);
+static size_t      _pow2(size_t v);
+
+/* Cache content matches the reader's snapshot: nothing written since */
+static inline int _readable(vc_dbi_t* c)
+{
+    return rd_open && atomic_load(&c->pending) == 0 && atomic_load(&epoch) == rd_ticket;
+}
+
+static inline size_t _charge(const size_t key_size, const size_t val_size)
+{
+    return sizeof(vc_entry_t) + key_size + val_size;
+}
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_vcache_enable(const unsigned dbi, const db_cache_cfg_t* cfg)
+{
+    if(!DataBase || !DataBase->dbis || dbi >= DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_vcache_enable: invalid dbi %u", dbi);
+        return -EINVAL;
+    }
+
+    /* Several values per key: a GET returns the first, cache nothing */
+    if(DataBase->dbis[dbi].is_dupsort)
+    {
+        EML_ERROR(LOG_TAG, "ops_vcache_enable: dbi %u is DUPSORT", dbi);
+        return -EINVAL;
+    }
+
+    if(!caches)
+    {
+        caches = calloc(DataBase->n_dbis, sizeof(*caches));
+        if(!caches)
+        {
+            EML_ERROR(LOG_TAG, "ops_vcache_enable: calloc(%zu caches) failed", DataBase->n_dbis);
+            return -ENOMEM;
+        }
+        n_caches = DataBase->n_dbis;
+    }
+
+    const size_t bytes    = (cfg && cfg->bytes) ? cfg->bytes : DB_LMDB_VCACHE_BYTES;
+    const size_t n_shards = _pow2((cfg && cfg->shards) ? cfg->shards : DB_LMDB_VCACHE_SHARDS);
+    const size_t max_val  = (cfg && cfg->max_val_size) ? cfg->max_val_size : DB_LMDB_VCACHE_MAX_VAL;
+    const size_t cap      = bytes / n_shards;
+    const size_t n_bucket = _pow2(cap / DB_LMDB_VCACHE_AVG_ENTRY > VC_MIN_BUCKETS
+                                      ? cap / DB_LMDB_VCACHE_AVG_ENTRY
+                                      : VC_MIN_BUCKETS);
+
+    vc_dbi_t* c = calloc(1, sizeof(*c));
+    if(!c) goto nomem;
+    c->shards = calloc(n_shards, sizeof(*c->shards));
+    if(!c->shards) goto nomem;
+    c->shard_mask   = n_shards - 1;
+    c->max_val_size = max_val;
+    atomic_init(&c->pending, 0);
+
+    for(size_t i = 0; i < n_shards; i++)
+    {
+        vc_shard_t* s = &c->shards[i];
+        s->buckets    = calloc(n_bucket, sizeof(*s->buckets));
+        if(!s->buckets) goto nomem;
+        s->mask = n_bucket - 1;
+        s->cap  = cap;
+        pthread_mutex_init(&s->lock, NULL);
+    }
+
+    _cache_free(caches[dbi]);
+    caches[dbi] = c;
+    EML_INFO(LOG_TAG, "ops_vcache_enable: dbi %u, %zu bytes in %zu shards (max val %zu)", dbi,
+             bytes, n_shards, max_val);
+    return 0;
+
+nomem:
+    EML_ERROR(LOG_TAG, "ops_vcache_enable: out of memory for dbi %u", dbi);
+    _cache_free(c);
+    return -ENOMEM;
+}
+
+void ops_vcache_disable(const unsigned dbi)
+{
+    if(dbi >= n_caches || !caches[dbi]) return;
+
+    _cache_free(caches[dbi]);
+    caches[dbi] = NULL;
+}
+
+void ops_vcache_reset(void)
+{
+    for(size_t i = 0; i < n_caches; i++) _cache_free(caches[i]);
+    free(caches);
+    caches   = NULL;
+    n_caches = 0;
+}
+
+void ops_vcache_read_begin(void)
+{
+    rd_ticket = atomic_load(&epoch);
+    rd_open   = 1;
+}
+
+void ops_vcache_read_end(void)
+{
+    rd_open = 0;
+}
+
+int ops_vcache_get(const unsigned dbi, const void* key, const size_t key_size, void* dst,
+                   size_t* inout_size, const int count_miss)
+{
+    vc_dbi_t* c = _cache(dbi);
+    if(!c || !rd_open || !dst || !inout_size) return -ENOENT;
+
+    const uint64_t h   = ops_fnv1a(key, key_size);
+    vc_shard_t*    s   = _shard(c, h);
+    int            res = -ENOENT;
+
+    pthread_mutex_lock(&s->lock);
+    vc_entry_t* e = _readable(c) ? _find(s, h, key, key_size) : NULL;
+    if(e && e->val_size <= *inout_size)
+    {
+        memcpy(dst, e->data + e->key_size, e->val_size);
+        *inout_size = e->val_size;
+        e->ref      = 1;
+        s->hits++;
+        res = 0;
+    }
+    else if(count_miss)
+    {
+        s->misses++;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    return res;
+}
+
+void ops_vcache_fill(const unsigned dbi, const void* key, const size_t key_size,
+                     const void* val, const size_t val_size)
+{
+    vc_dbi_t* c = _cache(dbi);
+    if(!c || !rd_open || val_size > c->max_val_size) return;
+
+    const uint64_t h      = ops_fnv1a(key, key_size);
+    vc_shard_t*    s      = _shard(c, h);
+    const size_t   charge = _charge(key_size, val_size);
+    if(charge > s->cap) return;
+
+    /* Copy outside the lock, most fills are kept */
+    vc_entry_t* e = malloc(charge);
+    if(!e) return;
+    e->hash     = h;
+    e->key_size = key_size;
+    e->val_size = val_size;
+    e->ref      = 0;
+    memcpy(e->data, key, key_size);
+    memcpy(e->data + key_size, val, val_size);
+
+    pthread_mutex_lock(&s->lock);
+    if(!_readable(c)) goto drop;
+
+    vc_entry_t* old = _find(s, h, key, key_size);
+    if(old) _remove(s, old);
+
+    if(s->n_entries == s->ring_cap)
+    {
+        const size_t cap  = s->ring_cap ? s->ring_cap * 2 : VC_MIN_BUCKETS;
+        vc_entry_t** ring = realloc(s->ring, cap * sizeof(*ring));
+        if(!ring) goto drop;
+        s->ring     = ring;
+        s->ring_cap = cap;
+    }
+
+    /* CLOCK: a referenced entry gets one more turn of the hand */
+    while(s->bytes + charge > s->cap && s->n_entries)
+    {
+        if(s->hand >= s->n_entries) s->hand = 0;
+        vc_entry_t* victim = s->ring[s->hand];
+        if(victim->ref)
+        {
+            victim->ref = 0;
+            s->hand++;
+            continue;
+        }
+        _remove(s, victim);
+        s->evictions++;
+    }
+
+    const size_t b = (size_t)h & s->mask;
+    e->next        = s->buckets[b];
+    s->buckets[b]  = e;
+    e->ring        = s->n_entries;
+    s->ring[s->n_entries++] = e;
+    s->bytes += charge;
+    s->fills++;
+    pthread_mutex_unlock(&s->lock);
+    return;
+
+drop:
+    pthread_mutex_unlock(&s->lock);
+    free(e);
+}
+
+void ops_vcache_write_begin(const unsigned dbi)
+{
+    vc_dbi_t* c = _cache(dbi);
+    if(c) atomic_fetch_add(&c->pending, 1);
+}
+
+void ops_vcache_write_end(const unsigned dbi, const void* key, const size_t key_size)
+{
+    vc_dbi_t* c = _cache(dbi);
+    if(!c) return;
+
+    /* Drop only: two writers ending out of commit order could not both
+    update, the next read refills from LMDB */
+    if(key)
+    {
+        const uint64_t h = ops_fnv1a(key, key_size);
+        vc_shard_t*    s = _shard(c, h);
+        pthread_mutex_lock(&s->lock);
+        vc_entry_t* e = _find(s, h, key, key_size);
+        if(e)
+        {
+            _remove(s, e);
+            s->invalidations++;
+        }
+        pthread_mutex_unlock(&s->lock);
+    }
+    else
+    {
+        for(size_t i = 0; i <= c->shard_mask; i++)
+        {
+            vc_shard_t* s = &c->shards[i];
+            pthread_mutex_lock(&s->lock);
+            s->invalidations += s->n_entries;
+            _clear(s);
+            pthread_mutex_unlock(&s->lock);
+        }
+    }
+
+    /* Readers whose snapshot may predate the commit stop using the cache */
+    atomic_fetch_add(&epoch, 1);
+    atomic_fetch_sub(&c->pending, 1);
+}
+
+int ops_vcache_stats(const unsigned dbi, db_cache_stats_t* out)
+{
+    vc_dbi_t* c = _cache(dbi);
+    if(!c || !out) return -ENOENT;
+
+    memset(out, 0, sizeof(*out));
+    for(size_t i = 0; i <= c->shard_mask; i++)
+    {
+        vc_shard_t* s = &c->shards[i];
+        pthread_mutex_lock(&s->lock);
+        out->hits += s->hits;
+        out->misses += s->misses;
+        out->fills += s->fills;
+        out->evictions += s->evictions;
+        out->invalidations += s->invalidations;
+        out->entries += s->n_entries;
+        out->bytes += s->bytes;
+        pthread_mutex_unlock(&s->lock);
+    }
+    return 0;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static vc_dbi_t* _cache(const unsigned dbi)
+{
+    return dbi < n_caches ? caches[dbi] : NULL;
+}
+
+static void _cache_free(vc_dbi_t* c)
+{
+    if(!c) return;
+
+    if(c->shards)
+    {
+        for(size_t i = 0; i <= c->shard_mask; i++)
+        {
+            vc_shard_t* s = &c->shards[i];
+            if(!s->buckets) continue;
+            _clear(s);
+            free(s->buckets);
+            free(s->ring);
+            pthread_mutex_destroy(&s->lock);
+        }
+        free(c->shards);
+    }
+    free(c);
+}
+
+/* High bits pick the shard, low bits the bucket */
+static vc_shard_t* _shard(vc_dbi_t* c, const uint64_t h)
+{
+    return &c->shards[(size_t)(h >> 32) & c->shard_mask];
+}
+
+static vc_entry_t* _find(vc_shard_t* s, const uint64_t h, const void* key, const size_t key_size)
+{
+    for(vc_entry_t* e = s->buckets[(size_t)h & s->mask]; e; e = e->next)
+    {
+        if(e->hash == h && e->key_size == key_size && memcmp(e->data, key, key_size) == 0)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Unlink @p e from its chain and the ring, then free it.
+ */
+static void _remove(vc_shard_t* s, vc_entry_t* e)
+{
+    vc_entry_t** link = &s->buckets[(size_t)e->hash & s->mask];
+    while(*link != e) link = &(*link)->next;
+    *link = e->next;
+
+    vc_entry_t* last = s->ring[--s->n_entries];
+    s->ring[e->ring] = last;
+    last->ring       = e->ring;
+
+    s->bytes -= _charge(e->key_size, e->val_size);
+    free(e);
+}
+
+static void _clear(vc_shard_t* s)
+{
+    for(size_t i = 0; i < s->n_entries; i++) free(s->ring[i]);
+    memset(s->buckets, 0, (s->mask + 1) * sizeof(*s->buckets));
+    s->n_entries = 0;
+    s->hand      = 0;
+    s->bytes     = 0;
+}
+
+static size_t _pow2(size_t v)
+{
+    size_t p = 1;
+    while(p < v) p <<= 1;
+    return p;
+}
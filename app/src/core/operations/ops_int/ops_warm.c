@@ -0,0 +1,524 @@
+/**
+ * @file ops_warm.c
+ *
+ */
+
+#include <errno.h>     /* EALREADY, EINVAL, EIO, ENOMEM */
+#include <pthread.h>   /* pthread_* */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint16_t, uint32_t, uint64_t */
+#include <stdlib.h>    /* malloc, free */
+#include <string.h>    /* memcmp, memcpy, memset, strlen */
+#include <sys/mman.h>  /* madvise, MADV_WILLNEED */
+#include <time.h>      /* clock_gettime */
+
+#include "common.h" /* EML_* macros, LMDB_EML_*, DB_LMDB_WARM_STEP */
+#include "db.h"     /* DataBase */
+#include "dbi_int.h"
+#include "ops_init.h" /* ops_init_dbi_derive, ops_init_dbi_order */
+#include "ops_map.h"
+#include "ops_util.h" /* ops_errno */
+#include "ops_warm.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG             "ops_warm"
+
+/* Schema record header tag ("SCHM") and layout version */
+#define WARM_SCHEMA_TAG     0x5343484Du
+#define WARM_SCHEMA_VERSION 1u
+
+/* Longest key LMDB stores with the default build (mdb_env_get_maxkeysize) */
+#define WARM_KEY_MAX        511u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Schema record header, followed by one warm_schema_ent_t and its
+ *        name bytes per DBI. Copied in and out with memcpy: LMDB values
+ *        carry no alignment.
+ */
+typedef struct
+{
+    uint32_t tag;     /**< WARM_SCHEMA_TAG. */
+    uint16_t version; /**< WARM_SCHEMA_VERSION. */
+    uint16_t n_dbis;  /**< Entries that follow. */
+} warm_schema_hdr_t;
+
+typedef struct
+{
+    uint32_t type;     /**< dbi_type_t asked at the open. */
+    uint32_t db_flags; /**< mdb_dbi_flags once opened. */
+    uint32_t name_len; /**< Name bytes that follow, no NUL. */
+} warm_schema_ent_t;
+
+typedef struct
+{
+    pthread_mutex_t      lock;                 /**< Serializes start, wait and stop. */
+    pthread_t            threads[DB_MAX_DBIS]; /**< Walkers not joined yet. */
+    unsigned             n_threads;            /**< Entries of threads. */
+    atomic_int           stop;                 /**< Stop asked. */
+    atomic_uint          walkers;              /**< Walks running. */
+    atomic_size_t        walked;               /**< Entries visited. */
+    atomic_size_t        walked_bytes;         /**< Key and value bytes touched. */
+    atomic_int           walk_res;             /**< First walk error. */
+    atomic_uint_fast64_t t_open;               /**< ops_warm_reset, monotonic ms. */
+    atomic_uint_fast64_t t_done;               /**< End of the last walk. */
+    atomic_uint          readers_cleared;      /**< From mdb_reader_check. */
+    atomic_int           schema_hit;           /**< DBIs opened from the record. */
+    atomic_size_t        advised_bytes;        /**< Passed to madvise. */
+} warm_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+static warm_t warm = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* Key of the schema record in the main DBI: no DBI name starts with NUL */
+static const char warm_schema_key[] = "\0db_core.schema";
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static void* _walk_main(void* arg);
+
+/**
+ * @brief Walk DBI @p idx, one read txn per DB_LMDB_WARM_STEP entries.
+ *
+ * @return 0 once the last entry was read or on stop, or a negative errno.
+ */
+static int _walk(const unsigned idx);
+
+/**
+ * @brief Whether @p rec is the record of @p names and @p types; fills
+ *        the db_flags of the DBIs when it is.
+ */
+static int _schema_match(const MDB_val* rec, const char* const* names, const dbi_type_t* types,
+                         const unsigned n);
+
+static uint64_t _now_ms(void);
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+void ops_warm_reset(void)
+{
+    atomic_store(&warm.stop, 0);
+    atomic_store(&warm.walked, 0);
+    atomic_store(&warm.walked_bytes, 0);
+    atomic_store(&warm.walk_res, 0);
+    atomic_store(&warm.t_done, 0);
+    atomic_store(&warm.readers_cleared, 0);
+    atomic_store(&warm.schema_hit, 0);
+    atomic_store(&warm.advised_bytes, 0);
+    atomic_store(&warm.t_open, _now_ms());
+}
+
+int ops_warm_readers(void)
+{
+    if(!(DataBase && DataBase->env))
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_readers: invalid input");
+        return -EINVAL;
+    }
+
+    int dead = 0;
+    int rc   = mdb_reader_check(DataBase->env, &dead);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_warm_readers: mdb_reader_check failed", rc);
+        return ops_errno(rc);
+    }
+
+    atomic_store(&warm.readers_cleared, (unsigned)dead);
+    if(dead > 0) EML_WARN(LOG_TAG, "ops_warm_readers: %d stale reader slots cleared", dead);
+    return dead;
+}
+
+int ops_warm_prefetch_map(void)
+{
+    if(!(DataBase && DataBase->env))
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_prefetch_map: invalid input");
+        return -EINVAL;
+    }
+
+    MDB_envinfo info;
+    MDB_stat    st;
+    int         rc = mdb_env_info(DataBase->env, &info);
+    if(rc == MDB_SUCCESS) rc = mdb_env_stat(DataBase->env, &st);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_warm_prefetch_map: env info failed", rc);
+        return ops_errno(rc);
+    }
+
+    /* Pages past the high-water mark hold nothing yet */
+    size_t len = ((size_t)info.me_last_pgno + 1u) * (size_t)st.ms_psize;
+    if(len > info.me_mapsize) len = info.me_mapsize;
+
+    if(madvise(info.me_mapaddr, len, MADV_WILLNEED) != 0)
+    {
+        int err = errno;
+        EML_WARN(LOG_TAG, "ops_warm_prefetch_map: madvise failed, errno=%d", err);
+        return -err;
+    }
+
+    atomic_store(&warm.advised_bytes, len);
+    EML_INFO(LOG_TAG, "ops_warm_prefetch_map: %zu bytes of the map advised", len);
+    return 0;
+}
+
+int ops_warm_schema_open(const char* const* names, const dbi_type_t* types, const unsigned n,
+                         const db_env_cfg_t* cfg)
+{
+    if(!names || !types || n == 0 || !cfg || !(DataBase && DataBase->env) || n > DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_schema_open: invalid input");
+        return -EINVAL;
+    }
+
+    MDB_txn* txn      = NULL;
+    MDB_dbi  main_dbi = 0;
+    MDB_val  key      = { sizeof(warm_schema_key) - 1u, (void*)warm_schema_key };
+    MDB_val  rec;
+
+    int rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_warm_schema_open: read txn failed", rc);
+        return ops_errno(rc);
+    }
+
+    rc = mdb_dbi_open(txn, NULL, 0, &main_dbi);
+    if(rc == MDB_SUCCESS) rc = mdb_get(txn, main_dbi, &key, &rec);
+    if(rc != MDB_SUCCESS || !_schema_match(&rec, names, types, n))
+    {
+        mdb_txn_abort(txn);
+        EML_INFO(LOG_TAG, "ops_warm_schema_open: no matching schema record, cold open");
+        return 0;
+    }
+
+    /* Existing DBIs only: one dropped since the record was saved misses */
+    for(unsigned i = 0; i < n; i++)
+    {
+        const unsigned flags = dbi_open_flags_from_type(types[i]) & ~(unsigned)MDB_CREATE;
+        rc = mdb_dbi_open(txn, names[i], flags, (MDB_dbi*)&DataBase->dbis[i].dbi);
+        if(rc != MDB_SUCCESS)
+        {
+            LMDB_EML_WARN(LOG_TAG, "ops_warm_schema_open: DBI not reopened, cold open", rc);
+            mdb_txn_abort(txn);
+            return 0;
+        }
+        ops_init_dbi_derive(i, types[i]);
+
+        /* Custom orders go in before any access to the DBI */
+        const db_cmp_fn_t key_cmp = cfg->key_cmps ? cfg->key_cmps[i] : NULL;
+        const db_cmp_fn_t dup_cmp = cfg->dup_cmps ? cfg->dup_cmps[i] : NULL;
+        int               err     = -EINVAL;
+        if((key_cmp || dup_cmp) &&
+           ops_init_dbi_order(txn, i, key_cmp, dup_cmp, &err) != DB_SAFETY_SUCCESS)
+        {
+            /* ops_init_dbi_order aborted the txn, whatever the cause; the
+               env is closed right after */
+            EML_ERROR(LOG_TAG, "ops_warm_schema_open: order of dbi %s refused, err=%d",
+                      names[i], err);
+            return err;
+        }
+    }
+
+    /* A read txn that commits hands its new DBI handles to the env */
+    rc = mdb_txn_commit(txn);
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_warm_schema_open: commit failed", rc);
+        return ops_errno(rc);
+    }
+
+    atomic_store(&warm.schema_hit, 1);
+    EML_INFO(LOG_TAG, "ops_warm_schema_open: %u DBIs opened from the schema record", n);
+    return 1;
+}
+
+int ops_warm_schema_save(MDB_txn* txn, const char* const* names, const dbi_type_t* types,
+                         const unsigned n)
+{
+    if(!txn || !names || !types || n == 0 || n > UINT16_MAX || !DataBase ||
+       n > DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_schema_save: invalid input");
+        return -EINVAL;
+    }
+
+    size_t size = sizeof(warm_schema_hdr_t) + n * sizeof(warm_schema_ent_t);
+    for(unsigned i = 0; i < n; i++) size += strlen(names[i]);
+
+    unsigned char* buf = malloc(size);
+    if(!buf)
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_schema_save: malloc(%zu) failed", size);
+        return -ENOMEM;
+    }
+
+    const warm_schema_hdr_t hdr = { WARM_SCHEMA_TAG, WARM_SCHEMA_VERSION, (uint16_t)n };
+    unsigned char*          p   = buf;
+    memcpy(p, &hdr, sizeof(hdr));
+    p += sizeof(hdr);
+    for(unsigned i = 0; i < n; i++)
+    {
+        const warm_schema_ent_t ent = { (uint32_t)types[i], DataBase->dbis[i].db_flags,
+                                        (uint32_t)strlen(names[i]) };
+        memcpy(p, &ent, sizeof(ent));
+        p += sizeof(ent);
+        memcpy(p, names[i], ent.name_len);
+        p += ent.name_len;
+    }
+
+    MDB_dbi main_dbi = 0;
+    MDB_val key      = { sizeof(warm_schema_key) - 1u, (void*)warm_schema_key };
+    MDB_val val      = { size, buf };
+    int     rc       = mdb_dbi_open(txn, NULL, 0, &main_dbi);
+    if(rc == MDB_SUCCESS) rc = mdb_put(txn, main_dbi, &key, &val, 0);
+    free(buf);
+
+    if(rc != MDB_SUCCESS)
+    {
+        LMDB_EML_ERR(LOG_TAG, "ops_warm_schema_save: mdb_put failed", rc);
+        return ops_errno(rc);
+    }
+    return 0;
+}
+
+int ops_warm_walk_start(const unsigned mask)
+{
+    /* One thread slot per DBI */
+    const unsigned lim =
+        DataBase && DataBase->n_dbis < DB_MAX_DBIS ? DataBase->n_dbis : DB_MAX_DBIS;
+    if(!(DataBase && DataBase->env) || (mask >> lim) != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_walk_start: invalid input (mask=0x%x)", mask);
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&warm.lock);
+    if(warm.n_threads)
+    {
+        pthread_mutex_unlock(&warm.lock);
+        EML_ERROR(LOG_TAG, "ops_warm_walk_start: walks already started");
+        return -EALREADY;
+    }
+
+    atomic_store(&warm.stop, 0);
+    int rc = 0;
+    for(unsigned i = 0; i < lim && rc == 0; i++)
+    {
+        if(!(mask & (1u << i))) continue;
+
+        atomic_fetch_add(&warm.walkers, 1u);
+        rc = pthread_create(&warm.threads[warm.n_threads], NULL, _walk_main,
+                            (void*)(uintptr_t)i);
+        if(rc != 0)
+        {
+            atomic_fetch_sub(&warm.walkers, 1u);
+            break;
+        }
+        warm.n_threads++;
+    }
+    pthread_mutex_unlock(&warm.lock);
+
+    if(rc != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_warm_walk_start: pthread_create failed, rc=%d", rc);
+        ops_warm_stop();
+        return -rc;
+    }
+
+    EML_INFO(LOG_TAG, "ops_warm_walk_start: walking %u DBIs (mask=0x%x)", warm.n_threads, mask);
+    return 0;
+}
+
+int ops_warm_wait(void)
+{
+    pthread_mutex_lock(&warm.lock);
+    for(unsigned i = 0; i < warm.n_threads; i++) pthread_join(warm.threads[i], NULL);
+    warm.n_threads = 0;
+    pthread_mutex_unlock(&warm.lock);
+
+    return atomic_load(&warm.walk_res);
+}
+
+void ops_warm_stop(void)
+{
+    atomic_store(&warm.stop, 1);
+    (void)ops_warm_wait();
+}
+
+void ops_warm_stats(db_warm_stats_t* out)
+{
+    if(!out) return;
+
+    memset(out, 0, sizeof(*out));
+    out->readers_cleared = atomic_load(&warm.readers_cleared);
+    out->schema_hit      = atomic_load(&warm.schema_hit);
+    out->advised_bytes   = atomic_load(&warm.advised_bytes);
+    out->walkers         = atomic_load(&warm.walkers);
+    out->walked          = atomic_load(&warm.walked);
+    out->walked_bytes    = atomic_load(&warm.walked_bytes);
+    out->walk_res        = atomic_load(&warm.walk_res);
+
+    uint64_t t0 = atomic_load(&warm.t_open);
+    uint64_t t1 = atomic_load(&warm.t_done);
+    if(t0 && t1 >= t0) out->walk_ms = t1 - t0;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static void* _walk_main(void* arg)
+{
+    const unsigned idx = (unsigned)(uintptr_t)arg;
+
+    int res = _walk(idx);
+    if(res != 0)
+    {
+        int none = 0;
+        (void)atomic_compare_exchange_strong(&warm.walk_res, &none, res);
+        EML_ERROR(LOG_TAG, "_walk_main: walk of DBI[%u] failed, res=%d", idx, res);
+    }
+
+    /* The last walker out stamps the end */
+    if(atomic_fetch_sub(&warm.walkers, 1u) == 1u) atomic_store(&warm.t_done, _now_ms());
+    return NULL;
+}
+
+static int _walk(const unsigned idx)
+{
+    const MDB_dbi      dbi  = DataBase->dbis[idx].dbi;
+    const MDB_cursor_op next = DataBase->dbis[idx].is_dupsort ? MDB_NEXT_NODUP : MDB_NEXT;
+
+    MDB_stat st;
+    int      rc = mdb_env_stat(DataBase->env, &st);
+    if(rc != MDB_SUCCESS) return ops_errno(rc);
+    const size_t psize = st.ms_psize ? (size_t)st.ms_psize : 4096u;
+
+    unsigned char          last[WARM_KEY_MAX];
+    size_t                 last_len = 0;
+    int                    first    = 1;
+    volatile unsigned char sink     = 0;
+
+    while(!atomic_load(&warm.stop))
+    {
+        MDB_txn*    txn = NULL;
+        MDB_cursor* cur = NULL;
+        size_t      n   = 0;
+        size_t      b   = 0;
+
+        ops_map_enter();
+        rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+        if(rc == MDB_SUCCESS) rc = mdb_cursor_open(txn, dbi, &cur);
+        if(rc == MDB_SUCCESS)
+        {
+            MDB_val k = { last_len, last };
+            MDB_val v;
+            rc = mdb_cursor_get(cur, &k, &v, first ? MDB_FIRST : MDB_SET_RANGE);
+
+            /* Resumed on the last key of the previous step: already read */
+            if(!first && rc == MDB_SUCCESS && k.mv_size == last_len &&
+               memcmp(k.mv_data, last, last_len) == 0)
+            {
+                rc = mdb_cursor_get(cur, &k, &v, next);
+            }
+
+            MDB_val seen = { 0, NULL };
+            for(; rc == MDB_SUCCESS && n < DB_LMDB_WARM_STEP; n++)
+            {
+                /* One byte per page faults in overflow values too */
+                const unsigned char* p = v.mv_data;
+                for(size_t off = 0; off < v.mv_size; off += psize) sink ^= p[off];
+
+                b += k.mv_size + v.mv_size;
+                seen = k;
+                rc   = mdb_cursor_get(cur, &k, &v, next);
+            }
+
+            if(seen.mv_size > 0 && seen.mv_size <= sizeof(last))
+            {
+                memcpy(last, seen.mv_data, seen.mv_size);
+                last_len = seen.mv_size;
+                first    = 0;
+            }
+            mdb_cursor_close(cur);
+        }
+        if(txn) mdb_txn_abort(txn);
+        ops_map_leave();
+
+        atomic_fetch_add(&warm.walked, n);
+        atomic_fetch_add(&warm.walked_bytes, b);
+
+        if(rc == MDB_NOTFOUND) break;
+        if(rc != MDB_SUCCESS) return ops_errno(rc);
+    }
+
+    EML_INFO(LOG_TAG, "_walk: DBI[%u] walked", idx);
+    return 0;
+}
+
+static int _schema_match(const MDB_val* rec, const char* const* names, const dbi_type_t* types,
+                         const unsigned n)
+{
+    const unsigned char* p   = rec->mv_data;
+    size_t               len = rec->mv_size;
+
+    warm_schema_hdr_t hdr;
+    if(len < sizeof(hdr)) return 0;
+    memcpy(&hdr, p, sizeof(hdr));
+    if(hdr.tag != WARM_SCHEMA_TAG || hdr.version != WARM_SCHEMA_VERSION || hdr.n_dbis != n)
+    {
+        return 0;
+    }
+    p += sizeof(hdr);
+    len -= sizeof(hdr);
+
+    /* db_flags of a miss are overwritten by the cold open */
+    for(unsigned i = 0; i < n; i++)
+    {
+        warm_schema_ent_t ent;
+        if(len < sizeof(ent)) return 0;
+        memcpy(&ent, p, sizeof(ent));
+        p += sizeof(ent);
+        len -= sizeof(ent);
+
+        if(ent.type != (uint32_t)types[i] || ent.name_len != strlen(names[i]) ||
+           len < ent.name_len || memcmp(p, names[i], ent.name_len) != 0)
+        {
+            return 0;
+        }
+        p += ent.name_len;
+        len -= ent.name_len;
+        DataBase->dbis[i].db_flags = ent.db_flags;
+    }
+    return len == 0;
+}
+
+static uint64_t _now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
@@ -0,0 +1,782 @@
+/**
+ * @file ops_zip.c
+ *
+ */
+
+#include <errno.h>     /* EINVAL, EIO, ENOKEY, ENOMEM, ENOSPC, ENOTSUP */
+#include <limits.h>    /* INT_MAX */
+#include <pthread.h>   /* pthread_key_t, pthread_mutex_t, pthread_once_t */
+#include <stdatomic.h> /* atomic_* */
+#include <stdint.h>    /* uint32_t */
+#include <stdlib.h>    /* calloc, free, realloc */
+#include <string.h>    /* memcpy, memset */
+
+#if DB_LMDB_LZ4
+#include <lz4.h>
+#endif
+#if DB_LMDB_ZSTD
+#include <zdict.h>
+#include <zstd.h>
+#endif
+
+#include "common.h" /* EML_* macros, LMDB_EML_* */
+#include "db.h"     /* DataBase */
+#include "ops_map.h"
+#include "ops_util.h" /* ops_errno */
+#include "ops_zip.h"
+
+/****************************************************************************
+ * PRIVATE DEFINES
+ ****************************************************************************
+ */
+
+#define LOG_TAG "ops_zip"
+
+/* Frame tags. Compressed frames carry the raw size (u32 LE) after the tag,
+   zstd ones then the dictionary id (u32 LE, 0 = none) */
+#define ZIP_TAG_RAW   0u
+#define ZIP_TAG_LZ4   1u
+#define ZIP_TAG_ZSTD  2u
+#define ZIP_HDR_LZ4   5u
+#define ZIP_HDR_ZSTD  9u
+
+/* Largest value compressed: sizes are u32 in frames, int for LZ4 */
+#define ZIP_RAW_MAX   ((size_t)INT_MAX)
+
+/* Dictionary keys in the meta DBI: 'Z' dbi id_be */
+#define ZIP_DICT_TAG  'Z'
+#define ZIP_DICT_KEY  6u
+
+/****************************************************************************
+ * PRIVATE STUCTURED VARIABLES
+ ****************************************************************************
+ */
+
+/**
+ * @brief Trained zstd dictionary, loaded once and kept until shutdown.
+ */
+typedef struct
+{
+    unsigned id; /**< Key of the dictionary in the meta DBI. */
+#if DB_LMDB_ZSTD
+    ZSTD_CDict* cdict;
+    ZSTD_DDict* ddict;
+#endif
+} zip_dict_t;
+
+/**
+ * @brief Codec state of one DBI.
+ */
+typedef struct
+{
+    int            on;       /**< DBI_TYPE_ZIP: values are frames. */
+    db_zip_codec_t codec;    /**< Codec of new values, never AUTO. */
+    int            level;    /**< zstd level. */
+    size_t         min_size; /**< Smaller values are stored raw. */
+    int            dict;     /**< Non-zero when meta_dbi holds dictionaries. */
+    unsigned       meta_dbi; /**< DBI of the dictionaries. */
+    zip_dict_t     dicts[DB_LMDB_ZIP_DICTS];
+    atomic_uint    n_dicts;  /**< Entries of dicts published, the last one packs. */
+    atomic_size_t  packed;
+    atomic_size_t  raw;
+    atomic_size_t  bytes_in;
+    atomic_size_t  bytes_out;
+} zip_t;
+
+/**
+ * @brief Buffers and codec contexts of one thread.
+ */
+typedef struct
+{
+    unsigned char* enc;     /**< Frames built by ops_zip_pack. */
+    size_t         enc_cap;
+    unsigned char* dec;     /**< Values decoded by ops_zip_view. */
+    size_t         dec_cap;
+#if DB_LMDB_ZSTD
+    ZSTD_CCtx* cctx;
+    ZSTD_DCtx* dctx;
+#endif
+} zip_tls_t;
+
+/****************************************************************************
+ * PRIVATE VARIABLES
+ ****************************************************************************
+ */
+
+/* Codec state by DBI index */
+static zip_t zips[DB_MAX_DBIS];
+
+/* Serializes enable and training: one dictionary writer */
+static pthread_mutex_t zip_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Per-thread buffers, freed by the key destructor at thread exit */
+static pthread_once_t            tls_once   = PTHREAD_ONCE_INIT;
+static pthread_key_t             tls_key;
+static int                       tls_key_ok = 0;
+static _Thread_local zip_tls_t* my_tls     = NULL;
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS PROTOTYPES
+ ****************************************************************************
+ */
+
+static zip_tls_t* _tls(void);
+static void       _tls_free(void* arg);
+static void       _tls_key_create(void);
+static int        _grow(unsigned char** buf, size_t* cap, const size_t size);
+static size_t     _compress(zip_t* z, zip_tls_t* t, const MDB_val* in, unsigned char* out,
+                            const size_t cap, unsigned* dict_id);
+static db_zip_codec_t _codec_default(void);
+static int            _dict_add(zip_t* z, const unsigned id, const void* data, const size_t size);
+static int            _dict_load(zip_t* z, const unsigned dbi);
+#if DB_LMDB_ZSTD
+static int _dict_store(const zip_t* z, const unsigned dbi, const unsigned id, const void* data,
+                       const size_t size);
+static int _samples_scan(const unsigned dbi, unsigned char** buf, size_t** sizes, size_t* n);
+#endif
+static void _dicts_free(zip_t* z);
+
+static inline void _u32_put(unsigned char* p, const uint32_t v)
+{
+    for(int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static inline uint32_t _u32_get(const unsigned char* p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/****************************************************************************
+ * PUBLIC FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+int ops_zip_open(const dbi_type_t* types, const unsigned n_dbis)
+{
+    if(!types || n_dbis > DB_MAX_DBIS)
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_open: invalid input");
+        return -EINVAL;
+    }
+
+    for(unsigned i = 0; i < n_dbis; i++)
+    {
+        if(!(types[i] & DBI_TYPE_ZIP)) continue;
+
+        if(types[i] & (DBI_TYPE_DUPSORT | DBI_TYPE_DUPFIXED | DBI_TYPE_INTEGERDUP))
+        {
+            EML_ERROR(LOG_TAG, "ops_zip_open: dbi %u has dups, cannot compress them", i);
+            ops_zip_close();
+            return -EINVAL;
+        }
+
+        zip_t* z    = &zips[i];
+        z->on       = 1;
+        z->codec    = _codec_default();
+        z->level    = DB_LMDB_ZIP_ZSTD_LEVEL;
+        z->min_size = DB_LMDB_ZIP_MIN_SIZE;
+    }
+    return 0;
+}
+
+void ops_zip_close(void)
+{
+    for(unsigned i = 0; i < DB_MAX_DBIS; i++) _dicts_free(&zips[i]);
+    memset(zips, 0, sizeof(zips));
+}
+
+int ops_zip_on(const unsigned dbi)
+{
+    return dbi < DB_MAX_DBIS && zips[dbi].on;
+}
+
+int ops_zip_enable(const unsigned dbi, const db_zip_cfg_t* cfg)
+{
+    if(!cfg || !DataBase || !DataBase->dbis || !ops_zip_on(dbi) || dbi >= DataBase->n_dbis)
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_enable: invalid input (dbi=%u)", dbi);
+        return -EINVAL;
+    }
+
+    const db_zip_codec_t codec = cfg->codec == DB_ZIP_AUTO ? _codec_default() : cfg->codec;
+    if((codec == DB_ZIP_LZ4 && !DB_LMDB_LZ4) || (codec == DB_ZIP_ZSTD && !DB_LMDB_ZSTD) ||
+       codec > DB_ZIP_ZSTD)
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_enable: codec %d not built in", (int)codec);
+        return -ENOTSUP;
+    }
+
+    /* Dictionaries live in a plain DBI of their own */
+    if(cfg->dict && (codec != DB_ZIP_ZSTD || cfg->meta_dbi >= DataBase->n_dbis ||
+                     cfg->meta_dbi == dbi || ops_zip_on(cfg->meta_dbi) ||
+                     DataBase->dbis[cfg->meta_dbi].is_dupsort))
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_enable: bad dictionary DBI %u for dbi %u", cfg->meta_dbi,
+                  dbi);
+        return -EINVAL;
+    }
+
+    pthread_mutex_lock(&zip_lock);
+    zip_t* z    = &zips[dbi];
+    z->codec    = codec;
+    z->level    = cfg->level ? cfg->level : DB_LMDB_ZIP_ZSTD_LEVEL;
+    z->min_size = cfg->min_size ? cfg->min_size : DB_LMDB_ZIP_MIN_SIZE;
+
+    int res = 0;
+    if(cfg->dict && (!z->dict || z->meta_dbi != cfg->meta_dbi))
+    {
+        _dicts_free(z);
+        z->meta_dbi = cfg->meta_dbi;
+        res         = _dict_load(z, dbi);
+    }
+    z->dict = cfg->dict && res == 0;
+    pthread_mutex_unlock(&zip_lock);
+
+    if(res != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_enable: dictionaries of dbi %u not loaded, err=%d", dbi, res);
+        return res;
+    }
+    EML_INFO(LOG_TAG, "ops_zip_enable: dbi %u codec=%d min=%zu dicts=%u", dbi, (int)z->codec,
+             z->min_size, atomic_load(&z->n_dicts));
+    return 0;
+}
+
+int ops_zip_train(const unsigned dbi, const db_view_t* samples, const size_t n_samples)
+{
+    if(!ops_zip_on(dbi) || !zips[dbi].dict || (samples && n_samples == 0))
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_train: dbi %u has no dictionary setup", dbi);
+        return -EINVAL;
+    }
+#if !DB_LMDB_ZSTD
+    (void)samples;
+    (void)n_samples;
+    return -ENOTSUP;
+#else
+    zip_t* z = &zips[dbi];
+    pthread_mutex_lock(&zip_lock);
+
+    const unsigned id  = atomic_load(&z->n_dicts) + 1u;
+    unsigned char* buf = NULL;
+    size_t*        sz  = NULL;
+    size_t         n   = 0;
+    void*          out = NULL;
+    int            res = 0;
+
+    if(id > DB_LMDB_ZIP_DICTS)
+    {
+        res = -ENOSPC;
+        goto out;
+    }
+
+    /* One contiguous buffer of samples for ZDICT */
+    if(samples)
+    {
+        size_t total = 0;
+        for(size_t i = 0; i < n_samples; i++) total += samples[i].size;
+        buf = malloc(total ? total : 1u);
+        sz  = malloc(n_samples * sizeof(*sz));
+        if(!buf || !sz)
+        {
+            res = -ENOMEM;
+            goto out;
+        }
+        for(size_t i = 0, off = 0; i < n_samples; off += samples[i].size, i++)
+        {
+            memcpy(buf + off, samples[i].data, samples[i].size);
+            sz[i] = samples[i].size;
+        }
+        n = n_samples;
+    }
+    else
+    {
+        res = _samples_scan(dbi, &buf, &sz, &n);
+        if(res != 0) goto out;
+    }
+
+    out = malloc(DB_LMDB_ZIP_DICT_SIZE);
+    if(!out)
+    {
+        res = -ENOMEM;
+        goto out;
+    }
+    const size_t size = ZDICT_trainFromBuffer(out, DB_LMDB_ZIP_DICT_SIZE, buf, sz, (unsigned)n);
+    if(ZDICT_isError(size))
+    {
+        EML_WARN(LOG_TAG, "ops_zip_train: %zu samples of dbi %u not enough to train", n, dbi);
+        res = -EINVAL;
+        goto out;
+    }
+
+    /* Stored before any value refers to it */
+    res = _dict_store(z, dbi, id, out, size);
+    if(res == 0) res = _dict_add(z, id, out, size);
+
+out:
+    pthread_mutex_unlock(&zip_lock);
+    free(out);
+    free(sz);
+    free(buf);
+    if(res != 0)
+    {
+        EML_ERROR(LOG_TAG, "ops_zip_train: dbi %u failed, err=%d", dbi, res);
+        return res;
+    }
+    EML_INFO(LOG_TAG, "ops_zip_train: dbi %u dictionary %u from %zu samples", dbi, id, n);
+    return (int)id;
+#endif
+}
+
+int ops_zip_pack(const unsigned dbi, const MDB_val* in, MDB_val* out)
+{
+    zip_t*     z = &zips[dbi];
+    zip_tls_t* t = _tls();
+    if(!t) return -ENOMEM;
+
+    const size_t n = in->mv_size;
+    atomic_fetch_add_explicit(&z->bytes_in, n, memory_order_relaxed);
+
+    const size_t hdr = z->codec == DB_ZIP_ZSTD ? ZIP_HDR_ZSTD : ZIP_HDR_LZ4;
+    if(z->codec != DB_ZIP_NONE && n >= z->min_size && n > hdr && n <= ZIP_RAW_MAX)
+    {
+        if(_grow(&t->enc, &t->enc_cap, n + 1u) != 0) return -ENOMEM;
+
+        /* Only worth it when the frame ends up no larger than the raw one */
+        unsigned     dict_id = 0;
+        const size_t packed  = _compress(z, t, in, t->enc + hdr, n - hdr, &dict_id);
+        if(packed)
+        {
+            t->enc[0] = z->codec == DB_ZIP_ZSTD ? ZIP_TAG_ZSTD : ZIP_TAG_LZ4;
+            _u32_put(t->enc + 1, (uint32_t)n);
+            if(z->codec == DB_ZIP_ZSTD) _u32_put(t->enc + ZIP_HDR_LZ4, dict_id);
+
+            out->mv_data = t->enc;
+            out->mv_size = hdr + packed;
+            atomic_fetch_add_explicit(&z->packed, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&z->bytes_out, out->mv_size, memory_order_relaxed);
+            return 0;
+        }
+    }
+
+    if(_grow(&t->enc, &t->enc_cap, n + 1u) != 0) return -ENOMEM;
+    t->enc[0] = ZIP_TAG_RAW;
+    if(n) memcpy(t->enc + 1, in->mv_data, n);
+
+    out->mv_data = t->enc;
+    out->mv_size = n + 1u;
+    atomic_fetch_add_explicit(&z->raw, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&z->bytes_out, out->mv_size, memory_order_relaxed);
+    return 0;
+}
+
+int ops_zip_size(const MDB_val* frame, size_t* out)
+{
+    const unsigned char* p = frame->mv_data;
+    if(frame->mv_size >= 1u && p[0] == ZIP_TAG_RAW)
+    {
+        *out = frame->mv_size - 1u;
+        return 0;
+    }
+    if((frame->mv_size > ZIP_HDR_LZ4 && p[0] == ZIP_TAG_LZ4) ||
+       (frame->mv_size > ZIP_HDR_ZSTD && p[0] == ZIP_TAG_ZSTD))
+    {
+        *out = _u32_get(p + 1);
+        return 0;
+    }
+
+    EML_ERROR(LOG_TAG, "ops_zip_size: malformed frame of %zu bytes", frame->mv_size);
+    return -EIO;
+}
+
+int ops_zip_unpack(const unsigned dbi, const MDB_val* frame, void* dst, const size_t size)
+{
+    const unsigned char* p = frame->mv_data;
+    switch(p[0])
+    {
+        case ZIP_TAG_RAW:
+            if(size) memcpy(dst, p + 1, size);
+            return 0;
+
+        case ZIP_TAG_LZ4:
+        {
+#if DB_LMDB_LZ4
+            const int got = LZ4_decompress_safe((const char*)p + ZIP_HDR_LZ4, dst,
+                                                (int)(frame->mv_size - ZIP_HDR_LZ4), (int)size);
+            if(got >= 0 && (size_t)got == size) return 0;
+            EML_ERROR(LOG_TAG, "ops_zip_unpack: corrupt LZ4 frame in dbi %u", dbi);
+            return -EIO;
+#else
+            EML_ERROR(LOG_TAG, "ops_zip_unpack: LZ4 frame in dbi %u, LZ4 not built in", dbi);
+            return -ENOTSUP;
+#endif
+        }
+
+        case ZIP_TAG_ZSTD:
+        {
+#if DB_LMDB_ZSTD
+            zip_tls_t* t = _tls();
+            if(!t || (!t->dctx && !(t->dctx = ZSTD_createDCtx()))) return -ENOMEM;
+
+            const unsigned id  = _u32_get(p + ZIP_HDR_LZ4);
+            const void*    src = p + ZIP_HDR_ZSTD;
+            const size_t   len = frame->mv_size - ZIP_HDR_ZSTD;
+            size_t         got = 0;
+            if(id == 0)
+            {
+                got = ZSTD_decompressDCtx(t->dctx, dst, size, src, len);
+            }
+            else
+            {
+                /* Published dictionaries never change, no lock */
+                const zip_t*      z  = &zips[dbi];
+                const unsigned    nd = atomic_load_explicit(&z->n_dicts, memory_order_acquire);
+                const ZSTD_DDict* dd = NULL;
+                for(unsigned i = 0; i < nd && !dd; i++)
+                {
+                    if(z->dicts[i].id == id) dd = z->dicts[i].ddict;
+                }
+                if(!dd)
+                {
+                    EML_ERROR(LOG_TAG, "ops_zip_unpack: dictionary %u of dbi %u not loaded", id,
+                              dbi);
+                    return -ENOKEY;
+                }
+                got = ZSTD_decompress_usingDDict(t->dctx, dst, size, src, len, dd);
+            }
+            if(!ZSTD_isError(got) && got == size) return 0;
+            EML_ERROR(LOG_TAG, "ops_zip_unpack: corrupt zstd frame in dbi %u", dbi);
+            return -EIO;
+#else
+            EML_ERROR(LOG_TAG, "ops_zip_unpack: zstd frame in dbi %u, zstd not built in", dbi);
+            return -ENOTSUP;
+#endif
+        }
+
+        default:
+            EML_ERROR(LOG_TAG, "ops_zip_unpack: unknown frame tag %u in dbi %u", p[0], dbi);
+            return -EIO;
+    }
+}
+
+int ops_zip_view(const unsigned dbi, const MDB_val* frame, MDB_val* out)
+{
+    size_t size = 0;
+    int    rc   = ops_zip_size(frame, &size);
+    if(rc != 0) return rc;
+
+    /* Raw: no copy */
+    if(((const unsigned char*)frame->mv_data)[0] == ZIP_TAG_RAW)
+    {
+        out->mv_data = (unsigned char*)frame->mv_data + 1;
+        out->mv_size = size;
+        return 0;
+    }
+
+    zip_tls_t* t = _tls();
+    if(!t || _grow(&t->dec, &t->dec_cap, size) != 0) return -ENOMEM;
+    rc = ops_zip_unpack(dbi, frame, t->dec, size);
+    if(rc != 0) return rc;
+
+    out->mv_data = t->dec;
+    out->mv_size = size;
+    return 0;
+}
+
+int ops_zip_stats(const unsigned dbi, db_zip_stats_t* out)
+{
+    if(!out || !ops_zip_on(dbi)) return -ENOENT;
+
+    const zip_t*   z  = &zips[dbi];
+    const unsigned nd = atomic_load_explicit(&z->n_dicts, memory_order_acquire);
+    out->packed       = atomic_load_explicit(&z->packed, memory_order_relaxed);
+    out->raw          = atomic_load_explicit(&z->raw, memory_order_relaxed);
+    out->bytes_in     = atomic_load_explicit(&z->bytes_in, memory_order_relaxed);
+    out->bytes_out    = atomic_load_explicit(&z->bytes_out, memory_order_relaxed);
+    out->dict_id      = (z->dict && nd) ? z->dicts[nd - 1u].id : 0u;
+    return 0;
+}
+
+/****************************************************************************
+ * PRIVATE FUNCTIONS DEFINITIONS
+ ****************************************************************************
+ */
+
+static zip_tls_t* _tls(void)
+{
+    if(my_tls) return my_tls;
+
+    (void)pthread_once(&tls_once, _tls_key_create);
+    zip_tls_t* t = calloc(1, sizeof(*t));
+    if(!t)
+    {
+        EML_ERROR(LOG_TAG, "_tls: calloc failed");
+        return NULL;
+    }
+    if(tls_key_ok) (void)pthread_setspecific(tls_key, t);
+    my_tls = t;
+    return t;
+}
+
+static void _tls_free(void* arg)
+{
+    zip_tls_t* t = arg;
+    if(!t) return;
+#if DB_LMDB_ZSTD
+    ZSTD_freeCCtx(t->cctx);
+    ZSTD_freeDCtx(t->dctx);
+#endif
+    free(t->enc);
+    free(t->dec);
+    free(t);
+}
+
+static void _tls_key_create(void)
+{
+    tls_key_ok = (pthread_key_create(&tls_key, _tls_free) == 0);
+    if(!tls_key_ok) EML_ERROR(LOG_TAG, "_tls_key_create: pthread_key_create failed");
+}
+
+/**
+ * @brief Make @p buf hold at least @p size bytes, growing geometrically.
+ */
+static int _grow(unsigned char** buf, size_t* cap, const size_t size)
+{
+    if(size <= *cap) return 0;
+
+    size_t new_cap = *cap ? *cap : 1024u;
+    while(new_cap < size) new_cap *= 2;
+    unsigned char* grown = realloc(*buf, new_cap);
+    if(!grown)
+    {
+        EML_ERROR(LOG_TAG, "_grow: realloc(%zu) failed", new_cap);
+        return -ENOMEM;
+    }
+    *buf = grown;
+    *cap = new_cap;
+    return 0;
+}
+
+/**
+ * @brief Compress @p in into at most @p cap bytes at @p out.
+ *
+ * @return The compressed size, 0 when it does not fit (incompressible).
+ */
+static size_t _compress(zip_t* z, zip_tls_t* t, const MDB_val* in, unsigned char* out,
+                        const size_t cap, unsigned* dict_id)
+{
+    (void)t;
+    (void)out;
+    (void)cap;
+    (void)dict_id;
+
+#if DB_LMDB_LZ4
+    if(z->codec == DB_ZIP_LZ4)
+    {
+        const int got = LZ4_compress_default(in->mv_data, (char*)out, (int)in->mv_size,
+                                             cap > INT_MAX ? INT_MAX : (int)cap);
+        return got > 0 ? (size_t)got : 0u;
+    }
+#endif
+#if DB_LMDB_ZSTD
+    if(z->codec == DB_ZIP_ZSTD)
+    {
+        if(!t->cctx && !(t->cctx = ZSTD_createCCtx())) return 0u;
+
+        /* The last published dictionary packs */
+        const unsigned nd  = z->dict ? atomic_load_explicit(&z->n_dicts, memory_order_acquire) : 0u;
+        size_t         got = 0;
+        if(nd)
+        {
+            *dict_id = z->dicts[nd - 1u].id;
+            got = ZSTD_compress_usingCDict(t->cctx, out, cap, in->mv_data, in->mv_size,
+                                           z->dicts[nd - 1u].cdict);
+        }
+        else
+        {
+            got = ZSTD_compressCCtx(t->cctx, out, cap, in->mv_data, in->mv_size, z->level);
+        }
+        return ZSTD_isError(got) ? 0u : got;
+    }
+#endif
+    (void)z;
+    (void)in;
+    return 0u;
+}
+
+static db_zip_codec_t _codec_default(void)
+{
+    if(DB_LMDB_LZ4) return DB_ZIP_LZ4;
+    if(DB_LMDB_ZSTD) return DB_ZIP_ZSTD;
+    return DB_ZIP_NONE;
+}
+
+/**
+ * @brief Build the zstd contexts of dictionary @p id and publish it.
+ */
+static int _dict_add(zip_t* z, const unsigned id, const void* data, const size_t size)
+{
+    const unsigned n = atomic_load(&z->n_dicts);
+    if(n >= DB_LMDB_ZIP_DICTS) return -ENOSPC;
+#if DB_LMDB_ZSTD
+    zip_dict_t* d = &z->dicts[n];
+    d->id         = id;
+    d->cdict      = ZSTD_createCDict(data, size, z->level);
+    d->ddict      = ZSTD_createDDict(data, size);
+    if(!d->cdict || !d->ddict)
+    {
+        ZSTD_freeCDict(d->cdict);
+        ZSTD_freeDDict(d->ddict);
+        memset(d, 0, sizeof(*d));
+        return -ENOMEM;
+    }
+    atomic_store_explicit(&z->n_dicts, n + 1u, memory_order_release);
+    return 0;
+#else
+    (void)id;
+    (void)data;
+    (void)size;
+    return -ENOTSUP;
+#endif
+}
+
+/**
+ * @brief Load the dictionaries of DBI @p dbi from its meta DBI, oldest first.
+ */
+static int _dict_load(zip_t* z, const unsigned dbi)
+{
+    MDB_txn*    txn = NULL;
+    MDB_cursor* cur = NULL;
+
+    ops_map_enter();
+    int rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc == MDB_SUCCESS) rc = mdb_cursor_open(txn, DataBase->dbis[z->meta_dbi].dbi, &cur);
+
+    int res = 0;
+    if(rc == MDB_SUCCESS)
+    {
+        unsigned char prefix[2] = { ZIP_DICT_TAG, (unsigned char)dbi };
+        MDB_val       k         = { sizeof(prefix), prefix };
+        MDB_val       v;
+        for(rc = mdb_cursor_get(cur, &k, &v, MDB_SET_RANGE); rc == MDB_SUCCESS && res == 0;
+            rc = mdb_cursor_get(cur, &k, &v, MDB_NEXT))
+        {
+            const unsigned char* p = k.mv_data;
+            if(k.mv_size != ZIP_DICT_KEY || memcmp(p, prefix, sizeof(prefix)) != 0) break;
+            const unsigned id = (unsigned)p[2] << 24 | (unsigned)p[3] << 16 |
+                                (unsigned)p[4] << 8 | p[5];
+            res = _dict_add(z, id, v.mv_data, v.mv_size);
+        }
+        mdb_cursor_close(cur);
+    }
+    if(txn) mdb_txn_abort(txn);
+    ops_map_leave();
+
+    if(res != 0) return res;
+    if(rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_dict_load: meta scan failed", rc);
+        return ops_errno(rc);
+    }
+    return 0;
+}
+
+#if DB_LMDB_ZSTD
+/**
+ * @brief Write dictionary @p id of DBI @p dbi to its meta DBI in a txn of its own.
+ */
+static int _dict_store(const zip_t* z, const unsigned dbi, const unsigned id, const void* data,
+                       const size_t size)
+{
+    unsigned char key[ZIP_DICT_KEY] = { ZIP_DICT_TAG, (unsigned char)dbi, (unsigned char)(id >> 24),
+                                        (unsigned char)(id >> 16), (unsigned char)(id >> 8),
+                                        (unsigned char)id };
+    MDB_val k = { sizeof(key), key };
+    MDB_val v = { size, (void*)data };
+
+    for(unsigned attempt = 0; attempt < DB_LMDB_RETRY_OPS_EXEC; attempt++)
+    {
+        MDB_txn* txn = NULL;
+        ops_map_enter();
+        int rc = mdb_txn_begin(DataBase->env, NULL, 0, &txn);
+        if(rc == MDB_SUCCESS) rc = mdb_put(txn, DataBase->dbis[z->meta_dbi].dbi, &k, &v, 0);
+        if(rc == MDB_SUCCESS)
+        {
+            rc  = mdb_txn_commit(txn);
+            txn = NULL;
+        }
+        if(txn) mdb_txn_abort(txn);
+        ops_map_leave();
+
+        if(rc == MDB_SUCCESS)
+        {
+            ops_map_after_commit();
+            return 0;
+        }
+        LMDB_EML_WARN(LOG_TAG, "_dict_store: write failed", rc);
+        if(rc != MDB_MAP_FULL || ops_map_on_full(attempt) != 0) return ops_errno(rc);
+    }
+    return -ENOSPC;
+}
+
+/**
+ * @brief Copy up to DB_LMDB_ZIP_TRAIN_SAMPLES values of DBI @p dbi, decoded.
+ */
+static int _samples_scan(const unsigned dbi, unsigned char** buf, size_t** sizes, size_t* n)
+{
+    size_t used = 0;
+    size_t cap  = 0;
+    *sizes      = malloc(DB_LMDB_ZIP_TRAIN_SAMPLES * sizeof(**sizes));
+    if(!*sizes) return -ENOMEM;
+
+    MDB_txn*    txn = NULL;
+    MDB_cursor* cur = NULL;
+    ops_map_enter();
+    int rc = mdb_txn_begin(DataBase->env, NULL, MDB_RDONLY, &txn);
+    if(rc == MDB_SUCCESS) rc = mdb_cursor_open(txn, DataBase->dbis[dbi].dbi, &cur);
+
+    int res = 0;
+    if(rc == MDB_SUCCESS)
+    {
+        MDB_val k;
+        MDB_val v;
+        for(rc = mdb_cursor_get(cur, &k, &v, MDB_FIRST);
+            rc == MDB_SUCCESS && res == 0 && *n < DB_LMDB_ZIP_TRAIN_SAMPLES;
+            rc = mdb_cursor_get(cur, &k, &v, MDB_NEXT))
+        {
+            MDB_val plain;
+            res = ops_zip_view(dbi, &v, &plain);
+            if(res == 0) res = _grow(buf, &cap, used + plain.mv_size);
+            if(res != 0) break;
+            memcpy(*buf + used, plain.mv_data, plain.mv_size);
+            used += plain.mv_size;
+            (*sizes)[(*n)++] = plain.mv_size;
+        }
+        mdb_cursor_close(cur);
+    }
+    if(txn) mdb_txn_abort(txn);
+    ops_map_leave();
+
+    if(res != 0) return res;
+    if(rc != MDB_SUCCESS && rc != MDB_NOTFOUND)
+    {
+        LMDB_EML_ERR(LOG_TAG, "_samples_scan: value scan failed", rc);
+        return ops_errno(rc);
+    }
+    return *n ? 0 : -EINVAL;
+}
+#endif
+
+static void _dicts_free(zip_t* z)
+{
+#if DB_LMDB_ZSTD
+    const unsigned n = atomic_load(&z->n_dicts);
+    for(unsigned i = 0; i < n; i++)
+    {
+        ZSTD_freeCDict(z->dicts[i].cdict);
+        ZSTD_freeDDict(z->dicts[i].ddict);
+    }
+#endif
+    memset(z->dicts, 0, sizeof(z->dicts));
+    atomic_store(&z->n_dicts, 0u);
+}
@@ -10,27 +10,22 @@
  * Responsibilities:
  * - Map LMDB errors to POSIX `errno` (see `_map_mdb_err_to_errno`).
  * - Decide whether an LMDB error should cause the caller to retry the
- *   operation, expand the environment map size (when appropriate), or fail
- *   the operation permanently (`security_check`).
- * - Attempt a mapsize expansion in a safe manner when `MDB_MAP_FULL`
- *   is encountered (`_expand_env_mapsize`).
+ *   operation or fail it permanently (`security_check`).
+ * - Drop the txn of a write path on any failure (`security_fail_txn`,
+ *   `security_abort_txn`).
  *
  * Notes & guarantees:
  * - `security_check` will abort the supplied `MDB_txn *txn` when the
  *   LMDB error requires transaction invalidation (for example: map full,
  *   corruption, or other fatal conditions). Callers should not attempt to
  *   reuse a transaction after it has been aborted here.
- * - `_expand_env_mapsize` must be called with no open transactions that
- *   use the environment (this function itself checks `DataBase`/`env`).
- * - The code attempts to double the current map size up to the configured
- *   maximum and returns LMDB style result codes on failure so callers may
- *   inspect LMDB's detailed cause when present.
+ * - `MDB_MAP_FULL` is a retry with `-ENOSPC`: the map is grown by the
+ *   caller once it has left the resize gate (see ops_map.c), never here
+ *   where other transactions may still be open.
  *
  * Thread-safety:
- * - The underlying LMDB environment functions are responsible for
- *   concurrency; this module does not enforce additional locking. If the
- *   embedding application requires serialized mapsize changes, it must
- *   provide that coordination.
+ * - Stateless; the underlying LMDB environment functions are responsible
+ *   for concurrency.
  *
  * Usage example:
  * @code
@@ -50,6 +45,7 @@
 
 #include "common.h" /* EML_* macros, LMDB_EML_* */
 #include "db.h"     /* DB, DataBase, lmdb  */
+#include "ops_stats.h" /* ops_stats_retry */
 
 /****************************************************************************
  * PRIVATE DEFINES
@@ -97,25 +93,6 @@
  */
 static int _map_mdb_err_to_errno(int rc);
 
-/**
- * @brief Attempt to expand the LMDB environment's map size.
- *
- * @details
- * This helper doubles the current `DataBase->map_size_bytes` up to the
- * configured maximum `DataBase->map_size_bytes_max`. It uses
- * `mdb_env_set_mapsize()` to request the new mapsize and updates the in-
- * process `DataBase` bookkeeping on success.
- *
- * @pre There must be no active LMDB transactions that might be using the
- *      environment while this function is called. The caller is responsible
- *      for ensuring that precondition.
- *
- * @return MDB_SUCCESS (0) on success. On failure, returns the LMDB error
- *         code returned by `mdb_env_set_mapsize()` (positive LMDB rc), or a
- *         negative POSIX-style code when `DataBase`/`env` is invalid.
- */
-static int _expand_env_mapsize(void);
-
 /****************************************************************************
  * PUBLIC FUNCTIONS DEFINITIONS
  ****************************************************************************
@@ -140,23 +117,10 @@ db_security_ret_code_t security_check(const int mdb_rc, MDB_txn* const txn, int*
         case MDB_BAD_RSLOT:
         case MDB_READERS_FULL:
         case MDB_MAP_FULL:
+            ops_stats_retry(mdb_rc);
             /* Here the transaction has to be aborted */
             if(txn) mdb_txn_abort(txn);
-            /* Check if need to resize */
-            if(mdb_rc == MDB_MAP_FULL)
-            {
-                /* resize */
-                int expand = _expand_env_mapsize();
-                if(expand == 0)
-                {
-                    EML_INFO(LOG_TAG, "_check: mapsize expanded on MDB_MAP_FULL");
-                    return DB_SAFETY_RETRY;
-                }
-
-                EML_ERROR(LOG_TAG, "_check: mapsize expand failed, lmdb_ret=%d", expand);
-                return DB_SAFETY_FAIL;
-            }
-
+            /* MAP_FULL (-ENOSPC): the caller grows the map outside the gate */
             return DB_SAFETY_RETRY;
 
         /* Logic failures which do not invalidate the transaction */
@@ -172,6 +136,22 @@ db_security_ret_code_t security_check(const int mdb_rc, MDB_txn* const txn, int*
     }
 }
 
+db_security_ret_code_t security_fail_txn(const int mdb_rc, MDB_txn* txn, int* const out_errno)
+{
+    db_security_ret_code_t ret = security_check(mdb_rc, txn, out_errno);
+
+    /* Logic failures leave the txn alive in security_check */
+    if(txn && (mdb_rc == MDB_NOTFOUND || mdb_rc == MDB_KEYEXIST)) mdb_txn_abort(txn);
+    return ret;
+}
+
+db_security_ret_code_t security_abort_txn(MDB_txn* txn, const int err, int* const out_errno)
+{
+    if(txn) mdb_txn_abort(txn);
+    if(out_errno) *out_errno = err;
+    return DB_SAFETY_FAIL;
+}
+
 /****************************************************************************
  * PRIVATE FUNCTIONS DEFINITIONS
  ****************************************************************************
@@ -225,42 +205,3 @@ static int _map_mdb_err_to_errno(int rc)
             return -rc;        /* unknown error, let pass the code */
     }
 }
-
-static int _expand_env_mapsize(void)
-{
-    /* Check database min health */
-    if(!(DataBase && DataBase->env)) return -EIO;
-
-    /* Get straigth environment info */
-    unsigned int retries = 3;
-    MDB_envinfo  info;
-    while((mdb_env_info(DataBase->env, &info) != MDB_SUCCESS) && retries > 0)
-    {
-        retries--;
-    }
-    if(retries == 0)
-    {
-        EML_ERROR(LOG_TAG, "_expand_env_mapsize: mdb_env_info failed after retries");
-        return -EIO;
-    }
-
-    /* Double current map size */
-    size_t desired = info.me_mapsize * 2;
-
-    /* Check against max, allow equal */
-    if(desired > DataBase->map_size_bytes_max)
-    {
-        EML_ERROR(LOG_TAG, "_expand_env_mapsize: desired size %zu exceeds max %zu", desired,
-                  DataBase->map_size_bytes_max);
-        return MDB_MAP_FULL;
-    }
-
-    int set = mdb_env_set_mapsize(DataBase->env, desired);
-    if(set != MDB_SUCCESS)
-    {
-        EML_ERROR(LOG_TAG, "_expand_env_mapsize: mdb_env_set_mapsize failed %d", set);
-        return set;
-    }
-
-    return set;
-}
@@ -0,0 +1,123 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_async_db";
+
+static atomic_int it_async_hits = 0;
+
+static void it_async_cb(db_batch_t* batch, int res, void* ctx)
+{
+    /* Worker thread: only count the reads that found their value */
+    (void)batch;
+    const char* buf = ctx;
+    if(res == 0 && buf[0] == 'v') atomic_fetch_add(&it_async_hits, 1);
+}
+
+static void test_db_core_async_keeps_many_batches_in_flight(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    db_batch_t* b = NULL;
+    assert_int_equal(db_core_batch_create(&b), 0);
+    assert_int_equal(db_core_async_submit(b, NULL, NULL), -ENOTCONN);
+    assert_int_equal(db_core_async_fd(), -1);
+
+    assert_int_equal(db_core_group_start(NULL), 0);
+    assert_int_equal(db_core_async_start(&(db_async_cfg_t){ .readers = 2u, .eventfd = 1 }), 0);
+    assert_int_equal(db_core_async_start(NULL), -EALREADY);
+    assert_int_equal(db_core_async_submit(NULL, NULL, NULL), -EINVAL);
+    db_core_batch_destroy(b);
+
+    /* One thread queues every write, then waits on the eventfd */
+    enum { N = 64 };
+    static db_batch_t* batches[N];
+    static char        keys[N][8];
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(db_core_batch_create(&batches[i]), 0);
+        (void)snprintf(keys[i], sizeof(keys[i]), "a%02d", i);
+        assert_int_equal(
+            db_core_batch_add_op(batches[i], 0u, DB_OPERATION_PUT, keys[i], 3u, "v", 1u), 0);
+    }
+    assert_int_equal(db_core_batch_add_op(batches[0], 0u, DB_OPERATION_PUT, "a01", 3u, "w", 1u),
+                     0);
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(db_core_async_submit(batches[i], NULL, (void*)(intptr_t)i), 0);
+    }
+
+    int             failed = 0;
+    int             got    = 0;
+    db_async_done_t done[16];
+    struct pollfd   pfd = { .fd = db_core_async_fd(), .events = POLLIN };
+    while(got < N)
+    {
+        assert_int_equal(poll(&pfd, 1, 5000), 1);
+        int n = db_core_async_poll(done, 16u);
+        assert_true(n >= 0);
+        for(int j = 0; j < n; j++)
+        {
+            assert_ptr_equal(done[j].batch, batches[(intptr_t)done[j].ctx]);
+            if(done[j].res != 0) failed++;
+        }
+        got += n;
+    }
+    /* Batch 0 or batch 1 lost the race for the NOOVERWRITE key a01 */
+    assert_int_equal(failed, 1);
+
+    /* Reads on the workers, completed through callbacks */
+    static char bufs[N][4];
+    atomic_store(&it_async_hits, 0);
+    for(int i = 0; i < N; i++)
+    {
+        memset(bufs[i], 0, sizeof(bufs[i]));
+        assert_int_equal(
+            db_core_batch_add_op(batches[i], 0u, DB_OPERATION_GET, keys[i], 3u, bufs[i], 4u), 0);
+        assert_int_equal(db_core_async_submit(batches[i], it_async_cb, bufs[i]), 0);
+    }
+    db_core_async_stop();
+    assert_int_equal(atomic_load(&it_async_hits), N - 1);
+
+    db_async_stats_t st;
+    db_core_async_stats(&st);
+    assert_int_equal(st.submitted, 2u * N);
+    assert_int_equal(st.completed, 2u * N);
+    assert_int_equal(st.writes, (size_t)N);
+    assert_int_equal(st.reads, (size_t)N);
+
+    db_group_stats_t gst;
+    db_core_group_stats(&gst);
+    assert_int_equal(gst.batches, (size_t)N);
+
+    for(int i = 0; i < N; i++)
+    {
+        db_core_batch_destroy(batches[i]);
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_async_keeps_many_batches_in_flight,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
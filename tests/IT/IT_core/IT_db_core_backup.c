@@ -0,0 +1,125 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_backup_src_db";
+
+static const char* k_it_backup_path = "./it_db_core_backup_db";
+
+static void it_backup_cleanup(void)
+{
+    char path[256];
+    (void)snprintf(path, sizeof(path), "%s/data.mdb", k_it_backup_path);
+    unlink(path);
+    (void)snprintf(path, sizeof(path), "%s/lock.mdb", k_it_backup_path);
+    unlink(path);
+    rmdir(k_it_backup_path);
+}
+
+static size_t it_backup_progress_last = 0;
+
+static void it_backup_progress(size_t written, size_t total, void* ctx)
+{
+    (void)total;
+    (void)ctx;
+    it_backup_progress_last = written;
+}
+
+static void test_db_core_backup_copies_live_database(void** state)
+{
+    (void)state;
+
+    it_backup_cleanup();
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    /* 256 keys of 1 KiB, then three quarters deleted: free pages to skip */
+    static char keys[256][8];
+    static char val[1024];
+    memset(val, 'v', sizeof(val));
+    for(int i = 0; i < 256; i++)
+    {
+        (void)snprintf(keys[i], sizeof(keys[i]), "k%03d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, keys[i], 4u, val, sizeof(val)), 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, keys[64], 4u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "last", 4u, "x", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    db_space_stats_t sp;
+    assert_int_equal(db_core_space_stats(&sp), 0);
+    assert_true(sp.page_size > 0u);
+    assert_int_equal(sp.entries, 65u);
+    assert_true(sp.pages_tree > 0u);
+    assert_true(sp.compact_bytes <= sp.pages_last * sp.page_size);
+
+    /* Compacting copy, written as the data file of another env */
+    assert_int_equal(mkdir(k_it_backup_path, 0700), 0);
+    char path[256];
+    (void)snprintf(path, sizeof(path), "%s/data.mdb", k_it_backup_path);
+    int fd = open(path, O_CREAT | O_WRONLY | O_TRUNC, 0600);
+    assert_true(fd >= 0);
+
+    db_backup_cfg_t cfg = { .flags = DB_BACKUP_COMPACT, .progress = it_backup_progress };
+    assert_int_equal(db_core_backup(-1, &cfg), -EINVAL);
+    assert_int_equal(db_core_backup(fd, &cfg), 0);
+    assert_int_equal(db_core_backup_wait(), 0);
+
+    struct stat st;
+    assert_int_equal(fstat(fd, &st), 0);
+    assert_int_equal(fsync(fd), 0);
+    close(fd);
+
+    db_backup_status_t bs;
+    db_core_backup_status(&bs);
+    assert_int_equal(bs.running, 0);
+    assert_int_equal(bs.res, 0);
+    assert_int_equal(bs.backups, 1u);
+    assert_int_equal(bs.written, (size_t)st.st_size);
+    assert_int_equal(it_backup_progress_last, (size_t)st.st_size);
+    assert_true((size_t)st.st_size <= sp.pages_last * sp.page_size);
+
+    /* The copy opens as a database of its own */
+    (void)db_core_shutdown();
+    assert_int_equal(db_core_init(k_it_backup_path, 0600u, dbi_names, dbi_types, 1u), 0);
+    char buf[sizeof(val)];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[3], 4u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, val, sizeof(val));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "last", 4u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[64], 4u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    (void)db_core_shutdown();
+
+    it_backup_cleanup();
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_backup_copies_live_database,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
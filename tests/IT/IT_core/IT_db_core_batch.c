@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_batch_db";
+
+static void test_db_core_batches_are_independent(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    db_batch_t* writer = NULL;
+    db_batch_t* reader = NULL;
+    assert_int_equal(db_core_batch_create(&writer), 0);
+    assert_int_equal(db_core_batch_create(&reader), 0);
+    assert_non_null(writer);
+    assert_non_null(reader);
+
+    const char* key = "key";
+    const char* val = "value";
+
+    /* Queue a PUT in the writer; reader and default batch stay empty. */
+    rc = db_core_batch_add_op(writer, 0u, DB_OPERATION_PUT, key, 3u, val, 5u);
+    assert_int_equal(rc, 0);
+    assert_int_equal(db_core_batch_exec(reader), -EINVAL);
+    assert_int_equal(db_core_exec_ops(), -EINVAL);
+
+    assert_int_equal(db_core_batch_exec(writer), 0);
+
+    /* Read the value back through the other handle. */
+    char buf[16] = { 0 };
+    rc = db_core_batch_add_op(reader, 0u, DB_OPERATION_GET, key, 3u, buf, sizeof(buf));
+    assert_int_equal(rc, 0);
+    assert_int_equal(db_core_batch_exec(reader), 0);
+    assert_memory_equal(buf, val, 5u);
+
+    db_core_batch_destroy(writer);
+    db_core_batch_destroy(reader);
+    db_core_batch_destroy(NULL);
+
+    /* NULL output pointer is rejected. */
+    assert_int_equal(db_core_batch_create(NULL), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_batches_are_independent,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,65 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_batch_grow_db";
+
+static void test_db_core_exec_ops_large_batch_single_txn(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    /* Well past the initial pool size, the batch must grow on demand. */
+    enum
+    {
+        N_KEYS = 200
+    };
+    static char keys[N_KEYS][16];
+    const char* val = "value";
+
+    for(int i = 0; i < N_KEYS; ++i)
+    {
+        (void)snprintf(keys[i], sizeof(keys[i]), "key_%04d", i);
+        rc = db_core_add_op(0u, DB_OPERATION_PUT, keys[i], 8u, val, 5u);
+        assert_int_equal(rc, 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Read back a few and check the pool is reused for the next batch. */
+    char buf[3][8] = { { 0 } };
+    for(int i = 0; i < 3; ++i)
+    {
+        rc = db_core_add_op(0u, DB_OPERATION_GET, keys[i * 99], 8u, buf[i], sizeof(buf[i]));
+        assert_int_equal(rc, 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    for(int i = 0; i < 3; ++i)
+    {
+        assert_memory_equal(buf[i], val, 5u);
+    }
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_exec_ops_large_batch_single_txn,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,70 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <unistd.h>
+
+#include "config.h" /* DB_LMDB_METRICS */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_bloom_db";
+
+static void test_db_core_bloom_rules_out_missing_keys_across_restart(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "bloom_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_BLOOM };
+    char             sidecar[256];
+    (void)snprintf(sidecar, sizeof(sidecar), "%s/bloom_dbi.bloom", k_test_db_path);
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "dev", 3u, "n1", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    for(int round = 0; round < 2; round++)
+    {
+        char buf[8] = { 0 };
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "dev", 3u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), 0);
+        assert_string_equal(buf, "n1");
+
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "nope", 4u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+        db_bloom_stats_t st;
+        assert_int_equal(db_core_bloom_stats(0u, &st), 0);
+        assert_int_equal(st.loaded, round);
+        assert_int_equal(st.keys, 1u);
+#if DB_LMDB_METRICS
+        assert_true(st.negatives >= 1u);
+#endif
+
+        /* Shutdown saves the filter, the next init loads it */
+        (void)db_core_shutdown();
+        assert_int_equal(access(sidecar, F_OK), 0);
+        if(round == 0)
+        {
+            assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+        }
+    }
+    unlink(sidecar);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_bloom_rules_out_missing_keys_across_restart,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
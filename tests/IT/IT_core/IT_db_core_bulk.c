@@ -0,0 +1,89 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_bulk_db";
+
+static void test_db_core_bulk_load_commits_in_chunks(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "bulk_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    /* b00..b11 shuffled, one reused key buffer: 5 + 5 + 2 records */
+    db_bulk_t*    bulk = NULL;
+    db_bulk_cfg_t cfg  = { .commit_records = 5u, .commit_bytes = 0u };
+    assert_int_equal(db_core_bulk_begin(&bulk, &cfg), 0);
+    assert_int_equal(db_core_bulk_put(bulk, 1u, "k", 1u, "v", 1u), -EINVAL);
+
+    char key[4];
+    for(int i = 0; i < 12; ++i)
+    {
+        (void)snprintf(key, sizeof(key), "b%02d", (i * 5) % 12);
+        assert_int_equal(db_core_bulk_put(bulk, 0u, key, 3u, key, 3u), 0);
+    }
+
+    db_bulk_stats_t st = { 0 };
+    db_core_bulk_stats(bulk, &st);
+    assert_int_equal(st.records, 10u);
+    assert_int_equal(st.commits, 2u);
+
+    assert_int_equal(db_core_bulk_end(bulk, &st), 0);
+    assert_int_equal(st.records, 12u);
+    assert_int_equal(st.bytes, 12u * 6u);
+    assert_int_equal(st.commits, 3u);
+    assert_true(st.records_per_s > 0.0);
+
+    /* Sorted input past the tail, chunked by bytes (6 bytes per record) */
+    cfg = (db_bulk_cfg_t){ .commit_records = 0u, .commit_bytes = 12u };
+    assert_int_equal(db_core_bulk_begin(&bulk, &cfg), 0);
+    for(int i = 0; i < 4; ++i)
+    {
+        (void)snprintf(key, sizeof(key), "c%02d", i);
+        assert_int_equal(db_core_bulk_put(bulk, 0u, key, 3u, key, 3u), 0);
+    }
+    assert_int_equal(db_core_bulk_end(bulk, &st), 0);
+    assert_int_equal(st.commits, 2u);
+
+    /* Everything landed, in key order */
+    it_scan_sink_t sink = { 0 };
+    db_scan_t      all  = { 0 };
+    all.mode            = DB_SCAN_RANGE;
+    all.cb              = it_scan_collect;
+    all.ctx             = &sink;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &all), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(sink.n, 16u);
+    assert_string_equal(sink.keys[0], "b00");
+    assert_string_equal(sink.keys[11], "b11");
+    assert_string_equal(sink.keys[15], "c03");
+
+    char buf[4] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "b07", 3u, buf, 3u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "b07", 3u);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_bulk_load_commits_in_chunks,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,71 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_cache_db";
+
+static void test_db_core_cache_serves_hot_reads_and_sees_commits(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    assert_int_equal(db_core_cache_enable(1u, NULL), -EINVAL);
+    assert_int_equal(db_core_cache_enable(0u, NULL), 0);
+
+    char buf[8] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "dev", 3u, "n1", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* First read fills, second is served without LMDB */
+    for(int i = 0; i < 2; i++)
+    {
+        memset(buf, 0, sizeof(buf));
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "dev", 3u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), 0);
+        assert_string_equal(buf, "n1");
+    }
+
+    db_cache_stats_t st;
+    assert_int_equal(db_core_cache_stats(0u, &st), 0);
+    assert_int_equal(st.misses, 1u);
+    assert_int_equal(st.hits, 1u);
+    assert_int_equal(st.fills, 1u);
+
+    /* A commit drops the key, the next read sees the new value */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "dev", 3u, "n2", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    memset(buf, 0, sizeof(buf));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "dev", 3u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_string_equal(buf, "n2");
+
+    assert_int_equal(db_core_cache_stats(0u, &st), 0);
+    assert_int_equal(st.invalidations, 1u);
+    assert_int_equal(st.misses, 2u);
+
+    db_core_cache_disable(0u);
+    assert_int_equal(db_core_cache_stats(0u, &st), -ENOENT);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_cache_serves_hot_reads_and_sees_commits,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,98 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_del_db";
+
+static void test_db_core_del_by_key_dup_and_range(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "plain_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    /* k0..k9 in the plain DBI, "d" with three dups in the other */
+    static char keys[10][4];
+    for(int i = 0; i < 10; ++i)
+    {
+        (void)snprintf(keys[i], sizeof(keys[i]), "k%d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, keys[i], 2u, "v", 1u), 0);
+    }
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "x", 1u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "y", 1u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "z", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    char buf[4];
+
+    /* By key, then the key is gone */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, keys[0], 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[0], 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, keys[0], 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    /* GET -> DEL chain in one RW txn: the DEL reuses the GET's key */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[1], 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, NULL, 1u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[1], 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    /* Range [k3, k7): k2 and k7 survive */
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, keys[3], 2u, keys[7], 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    for(int i = 2; i < 10; ++i)
+    {
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[i], 2u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), (i >= 3 && i < 7) ? -ENOENT : 0);
+    }
+
+    /* Open range empties the DBI, an empty range is fine */
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, NULL, 0u, NULL, 0u), 0);
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, keys[8], 2u, keys[2], 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[9], 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, keys[8], 0u, NULL, 0u), -EINVAL);
+
+    /* One duplicate, then the remaining ones with the key */
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_DEL, "d", 1u, "y", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_DEL, "d", 1u, "y", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_DEL, "d", 1u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_GET, "d", 1u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    /* A dup value on a plain DBI is refused */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, keys[0], 2u, "v", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, keys[0], 2u, "v", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_del_by_key_dup_and_range,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,104 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_group_db";
+
+typedef struct
+{
+    db_batch_t* batch;
+    char        key[8];
+    int         res;
+} it_group_prod_t;
+
+static void* it_group_prod_main(void* arg)
+{
+    it_group_prod_t* p = arg;
+    p->res             = db_core_batch_add_op(p->batch, 0u, DB_OPERATION_PUT, p->key, 2u, "v", 1u);
+    if(p->res == 0) p->res = db_core_group_exec(p->batch);
+    return NULL;
+}
+
+static void test_db_core_group_commit_merges_threads(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "k2", 2u, "old", 3u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    assert_int_equal(db_core_group_start(NULL), 0);
+    assert_int_equal(db_core_group_start(NULL), -EALREADY);
+
+    /* Producers 0..3 write k0..k3, k2 already exists */
+    enum { N = 4 };
+    it_group_prod_t prod[N];
+    pthread_t       threads[N];
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(db_core_batch_create(&prod[i].batch), 0);
+        (void)snprintf(prod[i].key, sizeof(prod[i].key), "k%d", i);
+        prod[i].res = 1;
+        assert_int_equal(pthread_create(&threads[i], NULL, it_group_prod_main, &prod[i]), 0);
+    }
+    for(int i = 0; i < N; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    /* Each producer gets its own result */
+    assert_int_equal(prod[0].res, 0);
+    assert_int_equal(prod[1].res, 0);
+    assert_int_equal(prod[2].res, -EEXIST);
+    assert_int_equal(prod[3].res, 0);
+
+    db_group_stats_t st;
+    db_core_group_stats(&st);
+    assert_int_equal(st.batches, (size_t)N);
+    assert_int_equal(st.failed, 1u);
+    assert_true(st.commits >= 1u && st.commits <= (size_t)N);
+    assert_int_equal(st.fallbacks, 0u);
+
+    /* Reads run directly, the writer keeps the others' keys and the old k2 */
+    for(int i = 0; i < N; i++)
+    {
+        char buf[8] = { 0 };
+        assert_int_equal(
+            db_core_batch_add_op(prod[i].batch, 0u, DB_OPERATION_GET, prod[i].key, 2u, buf, 8u),
+            0);
+        assert_int_equal(db_core_group_exec(prod[i].batch), 0);
+        assert_string_equal(buf, i == 2 ? "old" : "v");
+        db_core_batch_destroy(prod[i].batch);
+    }
+
+    /* Stopped: the caller executes */
+    db_core_group_stop();
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "k9", 2u, "v", 1u), 0);
+    assert_int_equal(db_core_group_exec(NULL), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_group_commit_merges_threads,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,79 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_index_db";
+
+/* Value "mail|meta": the mail is the index key */
+static int it_mail_of(const db_view_t* key, const db_view_t* val, void* out, size_t* out_size,
+                      void* ctx)
+{
+    (void)key;
+    (void)ctx;
+    const char* bar = memchr(val->data, '|', val->size);
+    if(!bar) return -EINVAL;
+
+    const size_t n = (size_t)(bar - (const char*)val->data);
+    if(n > *out_size) return -ENOBUFS;
+    memcpy(out, val->data, n);
+    *out_size = n;
+    return 0;
+}
+
+static void test_db_core_index_follows_record_writes(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "user_id2meta", "user_mail2id" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_NOOVERWRITE };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    const db_index_t mail2id = { 0u, 1u, it_mail_of, NULL };
+    assert_int_equal(db_core_index_add(&mail2id), 0);
+    assert_int_equal(db_core_index_add(&mail2id), -EEXIST);
+
+    /* One op per record, the index entry comes with it */
+    char id[8] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "u1", 2u, "a@x|m1", 6u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_GET, "a@x", 3u, id, sizeof(id)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_string_equal(id, "u1");
+
+    /* New mail: the old entry goes in the same txn */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "u1", 2u, "b@x|m1", 6u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_GET, "a@x", 3u, id, sizeof(id)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    /* Unique index: a second user cannot take the mail, nothing is written */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "u2", 2u, "b@x|m2", 6u), 0);
+    assert_int_equal(db_core_exec_ops(), -EEXIST);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "u2", 2u, id, sizeof(id)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, "u1", 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_GET, "b@x", 3u, id, sizeof(id)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_index_follows_record_writes,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -1,65 +1,21 @@
 #include <errno.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <setjmp.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <cmocka.h>
 
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <unistd.h>
 
+#include "config.h" /* DB_LMDB_BATCH_OPS_MAX */
 #include "core.h"
+#include "it_env.h"
 
-static const char* k_test_db_path = "./it_db_core_init_db";
-
-static int setup_clean_env(void** state)
-{
-    (void)state;
-
-    /* Best-effort cleanup of any previous env directory. */
-    struct stat st;
-    if(stat(k_test_db_path, &st) == 0 && S_ISDIR(st.st_mode))
-    {
-        /* Remove LMDB files if they exist, then rmdir. */
-        char path_data[256];
-        char path_lock[256];
-
-        (void)snprintf(path_data, sizeof(path_data), "%s/data.mdb", k_test_db_path);
-        (void)snprintf(path_lock, sizeof(path_lock), "%s/lock.mdb", k_test_db_path);
-
-        unlink(path_data);
-        unlink(path_lock);
-        rmdir(k_test_db_path);
-    }
-
-    return 0;
-}
-
-static int teardown_env(void** state)
-{
-    (void)state;
-
-    /* Ensure core shutdown so tests remain isolated. */
-    (void)db_core_shutdown();
-
-    struct stat st;
-    if(stat(k_test_db_path, &st) == 0 && S_ISDIR(st.st_mode))
-    {
-        char path_data[256];
-        char path_lock[256];
-
-        (void)snprintf(path_data, sizeof(path_data), "%s/data.mdb", k_test_db_path);
-        (void)snprintf(path_lock, sizeof(path_lock), "%s/lock.mdb", k_test_db_path);
-
-        unlink(path_data);
-        unlink(path_lock);
-        rmdir(k_test_db_path);
-    }
-
-    return 0;
-}
+const char* k_test_db_path = "./it_db_core_init_db";
 
 static void test_db_core_init_creates_env_with_strict_mode(void** state)
 {
@@ -157,8 +113,12 @@ static void test_db_core_add_op_invalid_type_and_key(void** state)
     rc = db_core_add_op(0u, DB_OPERATION_NONE, key, 3u, val, 3u);
     assert_int_equal(rc, -EINVAL);
 
-    /* Type higher than GET (e.g. DEL). */
-    rc = db_core_add_op(0u, DB_OPERATION_DEL, key, 3u, val, 3u);
+    /* Past the last supported type. */
+    rc = db_core_add_op(0u, DB_OPERATION_MAX, key, 3u, val, 3u);
+    assert_int_equal(rc, -EINVAL);
+
+    /* DEL with a dup value needs a size. */
+    rc = db_core_add_op(0u, DB_OPERATION_DEL, key, 3u, val, 0u);
     assert_int_equal(rc, -EINVAL);
 
     /* Null key with non-zero size should fail. */
@@ -180,18 +140,27 @@ static void test_db_core_add_op_overflow_cache_returns_enomem(void** state)
     int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
     assert_int_equal(rc, 0);
 
+    /* Lower the runtime limit so the overflow is reached quickly. */
+    assert_int_equal(db_core_set_batch_max_ops(0u), -EINVAL);
+    assert_int_equal(db_core_set_batch_max_ops(64u), 0);
+
     const char* key = "key";
     const char* val = "value";
 
     /* Push enough operations to overflow the internal ops cache. */
     int last_rc = 0;
-    for(int i = 0; i < 64; ++i)
+    int n_added = 0;
+    for(int i = 0; i < 65; ++i)
     {
         last_rc = db_core_add_op(0u, DB_OPERATION_PUT, key, 3u, val, 5u);
         if(last_rc != 0) break;
+        n_added++;
     }
 
+    assert_int_equal(n_added, 64);
     assert_int_equal(last_rc, -ENOMEM);
+
+    assert_int_equal(db_core_set_batch_max_ops(DB_LMDB_BATCH_OPS_MAX), 0);
 }
 
 int main(void)
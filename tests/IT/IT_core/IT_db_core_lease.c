@@ -0,0 +1,83 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_lease_db";
+
+static void test_db_core_leased_get_returns_map_views(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    static char blob[2048];
+    memset(blob, 'b', sizeof(blob));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "k1", 2u, blob, sizeof(blob)), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "k2", 2u, "small", 5u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* One zero-copy GET and one into a user buffer */
+    char      buf[8] = { 0 };
+    db_view_t views[2];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "k1", 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "k2", 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_batch_exec_leased(NULL, views, 2u), 0);
+
+    assert_int_equal(views[0].size, sizeof(blob));
+    assert_memory_equal(views[0].data, blob, sizeof(blob));
+    assert_true(views[0].data != (const void*)blob);
+    assert_int_equal(views[1].size, 5u);
+    assert_ptr_equal(views[1].data, buf);
+
+    /* The batch is busy until the lease ends */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "k2", 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -EBUSY);
+
+    /* So is this thread for writes: the map could not grow past the lease */
+    db_batch_t* writer = NULL;
+    assert_int_equal(db_core_batch_create(&writer), 0);
+    assert_int_equal(db_core_batch_add_op(writer, 0u, DB_OPERATION_PUT, "k4", 2u, "v", 1u), 0);
+    assert_int_equal(db_core_batch_exec(writer), -EBUSY);
+
+    db_core_release_read(NULL);
+    db_core_release_read(NULL);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_batch_exec(writer), 0);
+    db_core_batch_destroy(writer);
+
+    /* Write batches cannot be leased */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "k3", 2u, "v", 1u), 0);
+    assert_int_equal(db_core_batch_exec_leased(NULL, views, 2u), -EINVAL);
+
+    /* A lease of a caller-owned batch ends with the batch */
+    db_batch_t* reader = NULL;
+    assert_int_equal(db_core_batch_create(&reader), 0);
+    assert_int_equal(db_core_batch_add_op(reader, 0u, DB_OPERATION_GET, "k1", 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_batch_exec_leased(reader, views, 1u), 0);
+    assert_int_equal(views[0].size, sizeof(blob));
+    db_core_batch_destroy(reader);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_leased_get_returns_map_views,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,73 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "config.h" /* KiB, MiB */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_map_db";
+
+static void test_db_core_map_grows_ahead_of_commits(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    /* Tiny map, small steps: ~2 MiB of values must fit without MAP_FULL */
+    db_env_cfg_t cfg;
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_FAST_ASYNC, &cfg), 0);
+    cfg.map_size_init = KiB(256);
+    cfg.map_grow_step = KiB(128);
+    cfg.map_size_max  = MiB(64);
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 1u, &cfg), 0);
+
+    char val[1024];
+    memset(val, 'm', sizeof(val));
+    for(int i = 0; i < 2048; i++)
+    {
+        char key[8];
+        (void)snprintf(key, sizeof(key), "m%05d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 6u, val, sizeof(val)), 0);
+        assert_int_equal(db_core_exec_ops(), 0);
+    }
+
+    db_map_stats_t st;
+    db_core_map_stats(&st);
+    assert_true(st.grows >= 1u);
+    assert_int_equal(st.full_grows, 0u);
+    assert_true(st.map_size > KiB(256));
+    assert_true(st.map_size >= st.used + KiB(128) || st.map_size == st.map_max);
+    assert_int_equal(st.map_max, MiB(64));
+
+    /* One txn larger than a step still lands through the MAP_FULL path */
+    for(int i = 0; i < 256; i++)
+    {
+        char key[8];
+        (void)snprintf(key, sizeof(key), "n%05d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 6u, val, sizeof(val)), 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    char buf[sizeof(val)];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "n00255", 6u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(buf[0], 'm');
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_map_grows_ahead_of_commits,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,92 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_multi_db";
+
+static void test_db_core_multi_get_put_on_dupfixed(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "hash_dbi", "plain_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DUPSORT | DBI_TYPE_DUPFIXED, DBI_TYPE_DEFAULT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    /* 300 32-byte hashes under one key, descending, in one put */
+    enum { N_HASH = 300, HASH_SIZE = 32 };
+    static unsigned char hashes[N_HASH][HASH_SIZE];
+    for(int i = 0; i < N_HASH; ++i)
+    {
+        memset(hashes[i], 0, HASH_SIZE);
+        hashes[i][0] = (unsigned char)((N_HASH - 1 - i) >> 8);
+        hashes[i][1] = (unsigned char)(N_HASH - 1 - i);
+    }
+    db_multi_t put = { 0 };
+    put.buf        = hashes;
+    put.elem_size  = HASH_SIZE;
+    put.n_items    = N_HASH;
+    assert_int_equal(db_core_batch_add_put_multiple(NULL, 0u, "h", 1u, &put), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Read back across several pages, in dup order */
+    static unsigned char out[N_HASH * HASH_SIZE];
+    db_multi_t           get = { 0 };
+    get.buf                  = out;
+    get.cap                  = sizeof(out);
+    assert_int_equal(db_core_batch_add_get_multiple(NULL, 0u, "h", 1u, &get), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(get.elem_size, HASH_SIZE);
+    assert_int_equal(get.n_items, N_HASH);
+    assert_int_equal(get.more, 0);
+    for(int i = 0; i < N_HASH; ++i)
+    {
+        assert_int_equal(out[i * HASH_SIZE] << 8 | out[i * HASH_SIZE + 1], i);
+    }
+
+    /* A short buffer keeps whole dups only */
+    get.cap = 10u * HASH_SIZE + 5u;
+    assert_int_equal(db_core_batch_add_get_multiple(NULL, 0u, "h", 1u, &get), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(get.n_items, 10u);
+    assert_int_equal(get.more, 1);
+
+    /* Missing key: nothing, and not an error */
+    get.cap = sizeof(out);
+    assert_int_equal(db_core_batch_add_get_multiple(NULL, 0u, "x", 1u, &get), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(get.n_items, 0u);
+
+    /* Too small for one dup */
+    get.cap = HASH_SIZE - 1u;
+    assert_int_equal(db_core_batch_add_get_multiple(NULL, 0u, "h", 1u, &get), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOBUFS);
+
+    /* Only DUPFIXED DBIs take multi ops */
+    get.cap = sizeof(out);
+    assert_int_equal(db_core_batch_add_get_multiple(NULL, 1u, "h", 1u, &get), -EINVAL);
+    assert_int_equal(db_core_batch_add_put_multiple(NULL, 1u, "h", 1u, &put), -EINVAL);
+    put.n_items = 0u;
+    assert_int_equal(db_core_batch_add_put_multiple(NULL, 0u, "h", 1u, &put), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_multi_get_put_on_dupfixed,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_order_db";
+
+/* Keys newest first: reverse byte order */
+static int it_reverse_cmp(const db_view_t* a, const db_view_t* b)
+{
+    const size_t n = a->size < b->size ? a->size : b->size;
+    const int    c = memcmp(a->data, b->data, n);
+    return c ? -c : (b->size > a->size) - (b->size < a->size);
+}
+
+static void test_db_core_integer_keys_and_custom_order(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "by_id", "by_day" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_INTEGERKEY, DBI_TYPE_DUPSORT };
+    const db_cmp_fn_t key_cmps[] = { NULL, it_reverse_cmp };
+    const db_cmp_fn_t dup_cmps[] = { NULL, db_core_cmp_be64 };
+
+    db_env_cfg_t cfg;
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+    cfg.key_cmps = key_cmps;
+    cfg.dup_cmps = dup_cmps;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg), 0);
+
+    /* Native integers: numeric order, not byte order */
+    const size_t ids[] = { 65536u, 1u, 256u };
+    for(size_t i = 0; i < 3u; ++i)
+    {
+        assert_int_equal(
+            db_core_add_op(0u, DB_OPERATION_PUT, &ids[i], sizeof(ids[i]), "v", 1u), 0);
+    }
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "abc", 3u, "v", 1u), -EINVAL);
+
+    const char* days[] = { "2024-01-01", "2024-03-01", "2024-02-01" };
+    unsigned char stamps[3][8] = { { 0, 0, 0, 0, 0, 0, 0, 3 },
+                                   { 0, 0, 0, 0, 0, 0, 0, 2 },
+                                   { 0, 0, 0, 0, 0, 0, 0, 1 } };
+    for(size_t i = 0; i < 3u; ++i)
+    {
+        assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, days[i], 10u, stamps[i], 8u), 0);
+    }
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, days[0], 10u, stamps[1], 8u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, days[0], 10u, stamps[2], 8u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    unsigned char  buf[512];
+    db_scan_page_t page = { buf, sizeof(buf), 0u, 0u };
+    db_scan_t      scan = { 0 };
+    scan.mode           = DB_SCAN_RANGE;
+    scan.page           = &page;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &scan), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(page.n_items, 3u);
+
+    size_t    pos = 0u;
+    db_view_t k;
+    db_view_t v;
+    size_t    id  = 0u;
+    const size_t sorted[] = { 1u, 256u, 65536u };
+    for(size_t i = 0; i < 3u; ++i)
+    {
+        assert_int_equal(db_core_page_next(&page, &pos, &k, &v), 1);
+        assert_int_equal(k.size, sizeof(id));
+        memcpy(&id, k.data, sizeof(id));
+        assert_int_equal(id, sorted[i]);
+    }
+
+    /* Custom orders hold across a restart: newest day first, dups ascending */
+    (void)db_core_shutdown();
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg), 0);
+
+    page.used    = 0u;
+    page.n_items = 0u;
+    assert_int_equal(db_core_batch_add_scan(NULL, 1u, &scan), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(page.n_items, 5u);
+
+    const char*         expect_day[] = { "2024-03-01", "2024-02-01", "2024-01-01", "2024-01-01",
+                                         "2024-01-01" };
+    const unsigned char expect_dup[] = { 2u, 1u, 1u, 2u, 3u };
+    pos = 0u;
+    for(size_t i = 0; i < 5u; ++i)
+    {
+        assert_int_equal(db_core_page_next(&page, &pos, &k, &v), 1);
+        assert_memory_equal(k.data, expect_day[i], 10u);
+        assert_int_equal(((const unsigned char*)v.data)[7], expect_dup[i]);
+    }
+}
+
+static void test_db_core_refused_order_releases_the_writer(void** state)
+{
+    (void)state;
+
+    const char*       dbi_names[] = { "by_id", "plain" };
+    const dbi_type_t  dbi_types[] = { DBI_TYPE_INTEGERKEY, DBI_TYPE_DEFAULT };
+    const db_cmp_fn_t bad_keys[]  = { it_reverse_cmp, NULL };
+    const db_cmp_fn_t bad_dups[]  = { NULL, it_reverse_cmp };
+
+    db_env_cfg_t cfg;
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+
+    /* A key order on an integer DBI, then a dup order on a plain one */
+    cfg.key_cmps = bad_keys;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg),
+                     -EINVAL);
+    cfg.key_cmps = NULL;
+    cfg.dup_cmps = bad_dups;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg),
+                     -EINVAL);
+
+    /* The refused opens left no write txn behind: init and write go through */
+    cfg.dup_cmps = NULL;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg), 0);
+
+    const size_t id = 7u;
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, &id, sizeof(id), "v", 1u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "k", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_integer_keys_and_custom_order,
+                                        setup_clean_env,
+                                        teardown_env),
+        cmocka_unit_test_setup_teardown(test_db_core_refused_order_releases_the_writer,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,102 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_patch_db";
+
+/* Bumps a little-endian u32 counter at the start of the record */
+static int it_patch_bump(void* val, size_t size, void* ctx)
+{
+    (void)ctx;
+    if(size < 4u) return -EINVAL;
+    unsigned char* p = val;
+    unsigned       n = (unsigned)p[0] | (unsigned)p[1] << 8 | (unsigned)p[2] << 16 |
+                 (unsigned)p[3] << 24;
+    n++;
+    p[0] = (unsigned char)n;
+    p[1] = (unsigned char)(n >> 8);
+    p[2] = (unsigned char)(n >> 16);
+    p[3] = (unsigned char)(n >> 24);
+    return 0;
+}
+
+static void test_db_core_patch_updates_value_in_place(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "rec_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    /* A 1 KiB record (in page) and a 16 KiB one (overflow pages) */
+    static unsigned char small[1024];
+    static unsigned char big[16384];
+    memset(small, 's', sizeof(small));
+    memset(big, 'b', sizeof(big));
+    memset(small, 0, 4u);
+    memset(big, 0, 4u);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "s", 1u, small, sizeof(small)), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "b", 1u, big, sizeof(big)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Counter bumped twice in one txn, timestamp bytes patched in a new one */
+    db_patch_t bump   = { 0u, NULL, 0u, it_patch_bump, NULL };
+    db_patch_t ts     = { sizeof(small) - 8u, "20261014", 8u, NULL, NULL };
+    db_patch_t ts_big = { sizeof(big) - 8u, "20261014", 8u, NULL, NULL };
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, &bump), 0);
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, &bump), 0);
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "b", 1u, &bump), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, &ts), 0);
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "b", 1u, &ts_big), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    static unsigned char out[16384];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s", 1u, out, sizeof(small)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(out[0], 2);
+    assert_int_equal(out[4], 's');
+    assert_memory_equal(out + 1016, "20261014", 8u);
+
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "b", 1u, out, sizeof(out)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(out[0], 1);
+    assert_int_equal(out[8000], 'b');
+    assert_memory_equal(out + sizeof(big) - 8u, "20261014", 8u);
+
+    /* Missing key, patch past the end */
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "x", 1u, &bump), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    db_patch_t past = { 1020u, "12345678", 8u, NULL, NULL };
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, &past), 0);
+    assert_int_equal(db_core_exec_ops(), -ERANGE);
+
+    /* Bad requests */
+    db_patch_t both = { 0u, "a", 1u, it_patch_bump, NULL };
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, &both), -EINVAL);
+    assert_int_equal(db_core_batch_add_patch(NULL, 1u, "s", 1u, &bump), -EINVAL);
+    assert_int_equal(db_core_batch_add_patch(NULL, 0u, "s", 1u, NULL), -EINVAL);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_REP, "s", 1u, "a", 1u), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_patch_updates_value_in_place,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
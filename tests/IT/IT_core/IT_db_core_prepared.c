@@ -0,0 +1,66 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_prepared_db";
+
+static void test_db_core_prepared_batch_runs_many_times(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    /* Shape: PUT key/val, then GET of the same key through a lookup */
+    db_batch_t* plan = NULL;
+    char        out[8];
+    assert_int_equal(db_core_batch_create(&plan), 0);
+    assert_int_equal(db_core_batch_add_op(plan, 0u, DB_OPERATION_PUT, "p0000", 5u, "v0", 2u), 0);
+    assert_int_equal(db_core_batch_add_op(plan, 0u, DB_OPERATION_GET, NULL, 1u, out, sizeof(out)),
+                     0);
+    assert_int_equal(db_core_batch_prepare(plan), 0);
+
+    for(int i = 0; i < 100; i++)
+    {
+        char key[8];
+        char val[4];
+        (void)snprintf(key, sizeof(key), "p%04d", i);
+        (void)snprintf(val, sizeof(val), "%03d", i);
+        memset(out, 0, sizeof(out));
+        assert_int_equal(db_core_batch_bind(plan, 0u, key, 5u, val, 3u), 0);
+        assert_int_equal(db_core_batch_exec(plan), 0);
+        assert_memory_equal(out, val, 3u);
+    }
+
+    /* Frozen shape until unprepared */
+    assert_int_equal(db_core_batch_add_op(plan, 0u, DB_OPERATION_GET, "p0007", 5u, out, 8u),
+                     -EBUSY);
+    db_core_batch_unprepare(plan);
+    memset(out, 0, sizeof(out));
+    assert_int_equal(db_core_batch_add_op(plan, 0u, DB_OPERATION_GET, "p0007", 5u, out, 8u), 0);
+    assert_int_equal(db_core_batch_exec(plan), 0);
+    assert_memory_equal(out, "007", 3u);
+    db_core_batch_destroy(plan);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_prepared_batch_runs_many_times,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,68 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <unistd.h>
+
+#include "config.h" /* GiB */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_profiles_db";
+
+static void test_db_core_init_ex_profiles_and_async_sync(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    /* Bad setups never touch the disk */
+    db_env_cfg_t cfg;
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_MAX, &cfg), -EINVAL);
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+    cfg.map_size_init = GiB(2);
+    cfg.map_size_max  = GiB(1);
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 1u, &cfg),
+                     -EINVAL);
+
+    /* Fast-async: short syncer period, commits survive a clean shutdown */
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_FAST_ASYNC, &cfg), 0);
+    cfg.sync_ms      = 10u;
+    cfg.map_size_max = GiB(2);
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 1u, &cfg), 0);
+    for(int i = 0; i < 16; i++)
+    {
+        char key[8];
+        (void)snprintf(key, sizeof(key), "k%02d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 3u, "v", 1u), 0);
+        assert_int_equal(db_core_exec_ops(), 0);
+    }
+    usleep(30000);
+    (void)db_core_shutdown();
+
+    /* Reopen read-mostly, the data is there */
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_READ_MOSTLY, &cfg), 0);
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 1u, &cfg), 0);
+    char buf[4] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "k15", 3u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(buf[0], 'v');
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_init_ex_profiles_and_async_sync,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,88 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_reserve_db";
+
+/* Serializes a counter record: "rec:" then the index repeated */
+typedef struct
+{
+    int calls;
+    int fail;
+} it_rsv_ctx_t;
+
+static int it_rsv_write(void* dst, size_t size, void* ctx)
+{
+    it_rsv_ctx_t* c = ctx;
+    c->calls++;
+    if(c->fail) return -EPROTO;
+    memcpy(dst, "rec:", 4u);
+    memset((char*)dst + 4, '0' + c->calls, size - 4u);
+    return 0;
+}
+
+static void test_db_core_reserved_put_serializes_in_place(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "meta_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    /* Two reserved puts around a plain one, in one txn */
+    it_rsv_ctx_t ctx  = { 0 };
+    db_reserve_t big  = { 4096u, it_rsv_write, &ctx };
+    db_reserve_t tiny = { 6u, it_rsv_write, &ctx };
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "m1", 2u, &big), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "p", 1u, "plain", 5u), 0);
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "m2", 2u, &tiny), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(ctx.calls, 2);
+
+    static char buf[4096];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "m1", 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "rec:1111", 8u);
+    assert_int_equal(buf[4095], '1');
+
+    memset(buf, 0, 8u);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "m2", 2u, buf, 6u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "rec:22", 6u);
+
+    /* A failing writer rolls back the whole batch */
+    ctx.fail = 1;
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "q", 1u, "lost", 4u), 0);
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "m3", 2u, &tiny), 0);
+    assert_int_equal(db_core_exec_ops(), -EPROTO);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "q", 1u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    /* Bad requests */
+    db_reserve_t none = { 8u, NULL, NULL };
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "m", 1u, &none), -EINVAL);
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "m", 1u, NULL), -EINVAL);
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 1u, "m", 1u, &tiny), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_reserved_put_serializes_in_place,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,76 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "config.h" /* DB_LMDB_RO_TXN_REUSE */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_ro_reuse_db";
+
+static void test_db_core_reads_reuse_txn_across_misses_and_restart(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_NOOVERWRITE };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    const char* key = "key";
+    const char* val = "value";
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 3u, val, 5u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Many RO batches in a row, with a miss in between: the parked txn
+    is renewed each time and a failed read must not leak it. */
+    char buf[16];
+    for(int i = 0; i < 32; ++i)
+    {
+        memset(buf, 0, sizeof(buf));
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, key, 3u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), 0);
+        assert_memory_equal(buf, val, 5u);
+
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "nope", 4u, buf, sizeof(buf)), 0);
+        assert_int_equal(db_core_exec_ops(), -ENOENT);
+    }
+
+    /* The renewed snapshot sees later writes. */
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "key2", 4u, val, 5u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    memset(buf, 0, sizeof(buf));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "key2", 4u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, val, 5u);
+
+    /* Shutdown drops the parked txn; a new env starts clean. */
+    (void)db_core_shutdown();
+    rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u);
+    assert_int_equal(rc, 0);
+
+    db_core_set_ro_txn_reuse(0);
+    memset(buf, 0, sizeof(buf));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, key, 3u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, val, 5u);
+    db_core_set_ro_txn_reuse(DB_LMDB_RO_TXN_REUSE);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_reads_reuse_txn_across_misses_and_restart,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,61 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_savepoint_db";
+
+static void test_db_core_batch_runs_in_savepoint_segments(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    /* 250 PUTs and a GET in segments of 100: three child txns, one commit */
+    char buf[8] = { 0 };
+    assert_int_equal(db_core_batch_set_segment_ops(NULL, 100u), 0);
+    for(int i = 0; i < 250; i++)
+    {
+        char key[8];
+        (void)snprintf(key, sizeof(key), "s%05d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 6u, "seg", 3u), 0);
+    }
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s00007", 6u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "seg", 3u);
+
+    db_exec_stats_t st;
+    db_core_batch_stats(NULL, &st);
+    assert_int_equal(st.attempts, 1u);
+    assert_int_equal(st.segments, 3u);
+    assert_int_equal(st.seg_retries, 0u);
+    assert_int_equal(st.replayed_ops, 0u);
+
+    /* Committed with the parent */
+    memset(buf, 0, sizeof(buf));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s00249", 6u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "seg", 3u);
+    assert_int_equal(db_core_batch_set_segment_ops(NULL, 0u), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_batch_runs_in_savepoint_segments,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,129 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_scan_db";
+
+static void test_db_core_scan_range_prefix_dups_and_page(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "plain_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    /* a0..a4 and b0..b4 in the plain DBI, "d" with three dups */
+    static char keys[10][4];
+    for(int i = 0; i < 10; ++i)
+    {
+        (void)snprintf(keys[i], sizeof(keys[i]), "%c%d", i < 5 ? 'a' : 'b', i % 5);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, keys[i], 2u, "v", 1u), 0);
+    }
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "x", 1u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "y", 1u), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "z", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Range [a3, b2) and prefix "b" share one read txn and one cursor */
+    it_scan_sink_t range_sink  = { 0 };
+    it_scan_sink_t prefix_sink = { 0 };
+    db_scan_t      range       = { 0 };
+    db_scan_t      prefix      = { 0 };
+    range.mode       = DB_SCAN_RANGE;
+    range.start      = (db_view_t){ 2u, keys[3] };
+    range.end        = (db_view_t){ 2u, keys[7] };
+    range.cb         = it_scan_collect;
+    range.ctx        = &range_sink;
+    prefix.mode      = DB_SCAN_PREFIX;
+    prefix.start     = (db_view_t){ 1u, "b" };
+    prefix.cb        = it_scan_collect;
+    prefix.ctx       = &prefix_sink;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &range), 0);
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &prefix), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(range_sink.n, 4u);
+    assert_string_equal(range_sink.keys[0], "a3");
+    assert_string_equal(range_sink.keys[3], "b1");
+    assert_int_equal(range.more, 0);
+    assert_int_equal(prefix_sink.n, 5u);
+    assert_string_equal(prefix_sink.keys[4], "b4");
+
+    /* Limit, then a callback stop */
+    memset(&range_sink, 0, sizeof(range_sink));
+    range.limit = 2u;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &range), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(range.n_seen, 2u);
+    assert_int_equal(range.more, 1);
+
+    memset(&range_sink, 0, sizeof(range_sink));
+    range.limit           = 0u;
+    range.start.size      = 0u;
+    range.end.size        = 0u;
+    range_sink.stop_after = 3u;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &range), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(range_sink.n, 3u);
+    assert_int_equal(range.more, 1);
+
+    /* All dups of "d" into a page */
+    unsigned char  buf[256];
+    db_scan_page_t page = { buf, sizeof(buf), 0u, 0u };
+    db_scan_t      dups = { 0 };
+    dups.mode           = DB_SCAN_DUPS;
+    dups.start          = (db_view_t){ 1u, "d" };
+    dups.page           = &page;
+    assert_int_equal(db_core_batch_add_scan(NULL, 1u, &dups), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(page.n_items, 3u);
+
+    size_t    pos = 0u;
+    db_view_t k;
+    db_view_t v;
+    const char* expect = "xyz";
+    for(size_t i = 0; i < 3u; ++i)
+    {
+        assert_int_equal(db_core_page_next(&page, &pos, &k, &v), 1);
+        assert_int_equal(k.size, 1u);
+        assert_int_equal(v.size, 1u);
+        assert_int_equal(*(const char*)v.data, expect[i]);
+    }
+    assert_int_equal(db_core_page_next(&page, &pos, &k, &v), 0);
+
+    /* A page too small for one record fails the batch */
+    page.cap = 4u;
+    assert_int_equal(db_core_batch_add_scan(NULL, 1u, &dups), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOBUFS);
+
+    /* Malformed requests */
+    db_scan_t bad = { 0 };
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, NULL), -EINVAL);
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &bad), -EINVAL); /* no sink */
+    bad.cb   = it_scan_collect;
+    bad.mode = DB_SCAN_PREFIX;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &bad), -EINVAL); /* no prefix */
+    assert_int_equal(db_core_batch_add_scan(NULL, 5u, &range), -EINVAL);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_LST, "a", 1u, NULL, 0u), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_scan_range_prefix_dups_and_page,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,187 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <unistd.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_shard_db";
+
+enum { IT_SHARDS = 4, IT_SHARD_THREADS = 4, IT_SHARD_KEYS = 64 };
+
+static const char* const it_shard_paths[IT_SHARDS] = {
+    "./it_db_core_shard_0", "./it_db_core_shard_1", "./it_db_core_shard_2",
+    "./it_db_core_shard_3" };
+
+static void it_shards_cleanup(void)
+{
+    for(int i = 0; i < IT_SHARDS; i++)
+    {
+        char path[256];
+        (void)snprintf(path, sizeof(path), "%s/data.mdb", it_shard_paths[i]);
+        unlink(path);
+        (void)snprintf(path, sizeof(path), "%s/lock.mdb", it_shard_paths[i]);
+        unlink(path);
+        rmdir(it_shard_paths[i]);
+    }
+}
+
+typedef struct
+{
+    db_shards_t* shards;
+    int          id;
+    int          rc;
+} it_shard_writer_t;
+
+static void* it_shard_writer(void* arg)
+{
+    it_shard_writer_t* w     = arg;
+    db_shard_batch_t*  batch = NULL;
+
+    w->rc = db_core_shard_batch_create(&batch);
+    for(int i = 0; i < IT_SHARD_KEYS && w->rc == 0; i++)
+    {
+        char key[16];
+        (void)snprintf(key, sizeof(key), "t%d-%03d", w->id, i);
+        w->rc = db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_PUT, key, strlen(key), key,
+                                           strlen(key));
+        /* Small batches, so that the writers merge those of the threads */
+        if(w->rc == 0 && i % 8 == 7) w->rc = db_core_shards_exec(w->shards, batch, 0);
+    }
+    db_core_shard_batch_destroy(batch);
+    return NULL;
+}
+
+static void test_db_core_shards_write_in_parallel_and_read_back(void** state)
+{
+    (void)state;
+
+    it_shards_cleanup();
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+    db_shards_cfg_t  cfg         = { .paths     = it_shard_paths,
+                                     .n_shards  = IT_SHARDS,
+                                     .dbi_names = dbi_names,
+                                     .dbi_types = dbi_types,
+                                     .n_dbis    = 1u };
+
+    db_shards_t* sh = NULL;
+    cfg.n_shards    = 0u;
+    assert_int_equal(db_core_shards_open(&sh, &cfg), -EINVAL);
+    cfg.n_shards = IT_SHARDS;
+    assert_int_equal(db_core_shards_open(&sh, &cfg), 0);
+
+    /* Independent of the global database */
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    pthread_t         th[IT_SHARD_THREADS];
+    it_shard_writer_t w[IT_SHARD_THREADS];
+    for(int t = 0; t < IT_SHARD_THREADS; t++)
+    {
+        w[t] = (it_shard_writer_t){ .shards = sh, .id = t, .rc = -1 };
+        assert_int_equal(pthread_create(&th[t], NULL, it_shard_writer, &w[t]), 0);
+    }
+    for(int t = 0; t < IT_SHARD_THREADS; t++)
+    {
+        pthread_join(th[t], NULL);
+        assert_int_equal(w[t].rc, 0);
+    }
+
+    /* Atomic only within one shard */
+    const char* a  = "t0-000";
+    const char* b  = NULL;
+    const char* c  = NULL;
+    int         sa = db_core_shards_of(sh, a, strlen(a));
+    static char other[IT_SHARD_KEYS][16];
+    for(int i = 1; i < IT_SHARD_KEYS && (!b || !c); i++)
+    {
+        (void)snprintf(other[i], sizeof(other[i]), "t1-%03d", i);
+        int s = db_core_shards_of(sh, other[i], strlen(other[i]));
+        if(s == sa && !b) b = other[i];
+        if(s != sa && !c) c = other[i];
+    }
+    assert_non_null(b);
+    assert_non_null(c);
+
+    db_shard_batch_t* batch = NULL;
+    assert_int_equal(db_core_shard_batch_create(&batch), 0);
+    assert_int_equal(db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_PUT, a, strlen(a), "x", 1u),
+                     0);
+    assert_int_equal(db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_PUT, c, strlen(c), "x", 1u),
+                     0);
+    assert_int_equal(db_core_shards_exec(sh, batch, 1), -EXDEV);
+    assert_int_equal(db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_PUT, a, strlen(a), "x", 1u),
+                     0);
+    assert_int_equal(db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_PUT, b, strlen(b), "x", 1u),
+                     0);
+    assert_int_equal(db_core_shards_exec(sh, batch, 1), 0);
+
+    /* Read everything back in one split batch */
+    static char bufs[IT_SHARD_THREADS][IT_SHARD_KEYS][16];
+    static char keys[IT_SHARD_THREADS][IT_SHARD_KEYS][16];
+    memset(bufs, 0, sizeof(bufs));
+    for(int t = 0; t < IT_SHARD_THREADS; t++)
+    {
+        for(int i = 0; i < IT_SHARD_KEYS; i++)
+        {
+            (void)snprintf(keys[t][i], sizeof(keys[t][i]), "t%d-%03d", t, i);
+            assert_int_equal(db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_GET, keys[t][i],
+                                                        strlen(keys[t][i]), bufs[t][i], 15u),
+                             0);
+        }
+    }
+    assert_int_equal(db_core_shards_exec(sh, batch, 0), 0);
+    for(int t = 0; t < IT_SHARD_THREADS; t++)
+    {
+        for(int i = 0; i < IT_SHARD_KEYS; i++)
+        {
+            int         hit = !strcmp(keys[t][i], a) || !strcmp(keys[t][i], b);
+            const char* exp = hit ? "x" : keys[t][i];
+            assert_string_equal(bufs[t][i], exp);
+        }
+    }
+    db_core_shard_batch_destroy(batch);
+
+    db_shards_stats_t st;
+    db_core_shards_stats(sh, &st);
+    assert_int_equal(st.refused, 1u);
+    assert_int_equal(st.batches, (size_t)(IT_SHARD_THREADS * IT_SHARD_KEYS / 8 + 2));
+    assert_int_equal(st.failed, 0u);
+    assert_true(st.commits >= IT_SHARDS);
+
+    db_core_shards_close(sh);
+
+    /* Reopened: the data is on disk */
+    assert_int_equal(db_core_shards_open(&sh, &cfg), 0);
+    assert_int_equal(db_core_shard_batch_create(&batch), 0);
+    char buf[16] = { 0 };
+    assert_int_equal(
+        db_core_shard_batch_add_op(batch, 0u, DB_OPERATION_GET, c, strlen(c), buf, 15u), 0);
+    assert_int_equal(db_core_shards_exec(sh, batch, 1), 0);
+    assert_string_equal(buf, c);
+    db_core_shard_batch_destroy(batch);
+    db_core_shards_close(sh);
+
+    it_shards_cleanup();
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_shards_write_in_parallel_and_read_back,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,110 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_sorted_db";
+
+static void test_db_core_sorted_batch_matches_insertion_order(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "plain_dbi", "dup_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    int rc = db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u);
+    assert_int_equal(rc, 0);
+
+    db_batch_t* batch = NULL;
+    assert_int_equal(db_core_batch_create(&batch), 0);
+    assert_int_equal(db_core_batch_set_sorted(batch, 1), 0);
+
+    /* t00..t15 shuffled into an empty DBI (append path), t05 written twice */
+    static char keys[16][4];
+    for(int i = 0; i < 16; ++i)
+    {
+        const int k = (i * 7) % 16;
+        (void)snprintf(keys[k], sizeof(keys[k]), "t%02d", k);
+        assert_int_equal(db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, keys[k], 3u, "old", 3u),
+                         0);
+    }
+    assert_int_equal(db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, keys[5], 3u, "new", 3u), 0);
+
+    /* Dups in reverse order, then keys below the tail (plain put path) */
+    assert_int_equal(db_core_batch_add_op(batch, 1u, DB_OPERATION_PUT, "d", 1u, "3", 1u), 0);
+    assert_int_equal(db_core_batch_add_op(batch, 1u, DB_OPERATION_PUT, "d", 1u, "1", 1u), 0);
+    assert_int_equal(db_core_batch_add_op(batch, 1u, DB_OPERATION_PUT, "d", 1u, "2", 1u), 0);
+    assert_int_equal(db_core_batch_exec(batch), 0);
+
+    assert_int_equal(db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, "b", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, "a", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, "u", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_batch_exec(batch), 0);
+
+    /* Last write wins, as in insertion order */
+    char buf[8] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, keys[5], 3u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, "new", 3u);
+
+    /* Everything landed, in key order: a b t00..t15 u */
+    it_scan_sink_t sink = { 0 };
+    db_scan_t      all  = { 0 };
+    all.mode            = DB_SCAN_RANGE;
+    all.limit           = 16u;
+    all.cb              = it_scan_collect;
+    all.ctx             = &sink;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &all), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(sink.n, 16u);
+    assert_int_equal(all.more, 1);
+    assert_string_equal(sink.keys[0], "a");
+    assert_string_equal(sink.keys[1], "b");
+    assert_string_equal(sink.keys[2], "t00");
+    assert_string_equal(sink.keys[15], "t13");
+
+    memset(&sink, 0, sizeof(sink));
+    all.limit = 0u;
+    all.start = (db_view_t){ 3u, keys[14] };
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &all), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(sink.n, 3u);
+    assert_string_equal(sink.keys[2], "u");
+
+    unsigned char  page_buf[128];
+    db_scan_page_t page = { page_buf, sizeof(page_buf), 0u, 0u };
+    db_scan_t      dups = { 0 };
+    dups.mode           = DB_SCAN_DUPS;
+    dups.start          = (db_view_t){ 1u, "d" };
+    dups.page           = &page;
+    assert_int_equal(db_core_batch_add_scan(NULL, 1u, &dups), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(page.n_items, 3u);
+
+    db_core_batch_destroy(batch);
+
+    /* The default batch accepts the mode too */
+    assert_int_equal(db_core_batch_set_sorted(NULL, 1), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "z", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "y", 1u, "v", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_batch_set_sorted(NULL, 0), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_sorted_batch_matches_insertion_order,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
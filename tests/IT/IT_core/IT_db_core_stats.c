@@ -0,0 +1,63 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "config.h" /* DB_LMDB_METRICS */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_stats_db";
+
+static void test_db_core_stats_count_ops_and_txns(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    /* Counters are process-wide: compare against a first snapshot */
+    db_stats_t before;
+    db_core_stats(&before);
+
+    char buf[4] = { 0 };
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "t1", 2u, "v1", 2u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "t2", 2u, "v2", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "t2", 2u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    db_stats_t st;
+    db_core_stats(&st);
+#if DB_LMDB_METRICS
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_PUT].count - before.lat_ns[DB_STATS_LAT_PUT].count,
+                     2u);
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_GET].count - before.lat_ns[DB_STATS_LAT_GET].count,
+                     1u);
+    assert_int_equal(st.batch_ops.count - before.batch_ops.count, 2u);
+    assert_int_equal(st.batch_ops.sum - before.batch_ops.sum, 3u);
+    assert_true(st.txn_rw - before.txn_rw >= 1u);
+    assert_true(st.lat_ns[DB_STATS_LAT_TXN_COMMIT].count >
+                before.lat_ns[DB_STATS_LAT_TXN_COMMIT].count);
+#else
+    assert_int_equal(st.batch_ops.count, 0u);
+#endif
+    assert_true(st.map.map_size > 0u);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_stats_count_ops_and_txns,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
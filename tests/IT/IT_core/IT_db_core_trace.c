@@ -0,0 +1,73 @@
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_trace_db";
+
+static void it_trace_cb(const db_trace_t* trace, void* ctx)
+{
+    *(db_trace_t*)ctx = *trace;
+}
+
+static void test_db_core_trace_reports_batch_phases(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "demo_dbi" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 1u), 0);
+
+    /* Enough values to append pages at the end of the map */
+    db_trace_t last;
+    memset(&last, 0, sizeof(last));
+    db_core_set_trace(it_trace_cb, &last);
+
+    char val[512];
+    memset(val, 't', sizeof(val));
+    for(int i = 0; i < 64; i++)
+    {
+        char key[8];
+        (void)snprintf(key, sizeof(key), "t%05d", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 6u, val, sizeof(val)), 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    assert_int_equal(last.rw, 1);
+    assert_int_equal(last.result, 0);
+    assert_int_equal(last.n_ops, 64u);
+    assert_int_equal(last.retries, 0u);
+    assert_true(last.dirty_pages > 0u);
+    assert_true(last.t_start <= last.t_begun);
+    assert_true(last.t_begun <= last.t_executed);
+    assert_true(last.t_executed <= last.t_end);
+
+    /* Reads: no commit, nothing appended */
+    char buf[8];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "t00003", 6u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(last.rw, 0);
+    assert_int_equal(last.n_ops, 1u);
+    assert_int_equal(last.dirty_pages, 0u);
+
+    db_core_set_trace(NULL, NULL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_trace_reports_batch_phases,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
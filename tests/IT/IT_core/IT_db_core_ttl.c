@@ -0,0 +1,142 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <unistd.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_ttl_db";
+
+static void test_db_core_ttl_expires_keys_across_restart(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "sessions", "expiry" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+    char             val[8]      = { 0 };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s1", 2u, "v1", 2u, 1u), -EINVAL);
+
+    /* Sweeps on demand first: the thread waits an hour */
+    db_ttl_cfg_t cfg = { .queue_dbi = 1u, .period_ms = 3600000u };
+    assert_int_equal(db_core_ttl_start(&cfg), 0);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 1u, "s1", 2u, "v1", 2u, 1u), -EINVAL);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s1", 2u, "v1", 2u, 1u), 0);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s2", 2u, "v2", 2u, 3600000u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "s3", 2u, "v3", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    usleep(5000);
+    assert_int_equal(db_core_ttl_sweep(), 1);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s1", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s2", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s3", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* A new TTL moves the deadline, a plain PUT drops it */
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s2", 2u, "v2", 2u, 1u), 0);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s3", 2u, "v3", 2u, 1u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "s3", 2u, "w3", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    db_ttl_stats_t st;
+    assert_int_equal(db_core_ttl_stats(&st), 0);
+    assert_int_equal(st.armed, 4u);
+    assert_int_equal(st.disarmed, 1u);
+    assert_int_equal(st.expired, 1u);
+
+    /* The deadline is on disk: the thread of the next run deletes it */
+    (void)db_core_shutdown();
+    assert_int_equal(db_core_ttl_stats(&st), -ENOTCONN);
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    cfg.period_ms = 10u;
+    assert_int_equal(db_core_ttl_start(&cfg), 0);
+
+    int rc = 0;
+    for(int i = 0; i < 200 && rc != -ENOENT; i++)
+    {
+        usleep(10000);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s2", 2u, val, sizeof(val)), 0);
+        rc = db_core_exec_ops();
+    }
+    assert_int_equal(rc, -ENOENT);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s3", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(val, "w3", 2u);
+    assert_int_equal(db_core_ttl_stats(&st), 0);
+    assert_int_equal(st.expired, 1u);
+    assert_true(st.sweeps > 0u);
+}
+
+static void test_db_core_ttl_del_then_put_keeps_new_record(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "sessions", "expiry" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+    char             val[8]      = { 0 };
+
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    db_ttl_cfg_t cfg = { .queue_dbi = 1u, .period_ms = 3600000u };
+    assert_int_equal(db_core_ttl_start(&cfg), 0);
+
+    /* The DEL takes the deadline with the record */
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s1", 2u, "v1", 2u, 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_DEL, "s1", 2u, NULL, 0u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "s1", 2u, "w1", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* So does a range DEL */
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s2", 2u, "v2", 2u, 1u), 0);
+    assert_int_equal(db_core_batch_add_put_ttl(NULL, 0u, "s3", 2u, "v3", 2u, 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_batch_add_del_range(NULL, 0u, "s2", 2u, "s3", 2u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "s2", 2u, "w2", 2u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Only s3 kept its deadline */
+    usleep(5000);
+    assert_int_equal(db_core_ttl_sweep(), 1);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s1", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(val, "w1", 2u);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s2", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(val, "w2", 2u);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "s3", 2u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), -ENOENT);
+
+    db_ttl_stats_t st;
+    assert_int_equal(db_core_ttl_stats(&st), 0);
+    assert_int_equal(st.armed, 3u);
+    assert_int_equal(st.disarmed, 2u);
+    assert_int_equal(st.expired, 1u);
+    assert_int_equal(st.stale, 0u);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_ttl_expires_keys_across_restart,
+                                        setup_clean_env,
+                                        teardown_env),
+        cmocka_unit_test_setup_teardown(test_db_core_ttl_del_then_put_keeps_new_record,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
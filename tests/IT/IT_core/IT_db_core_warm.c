@@ -0,0 +1,106 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "config.h" /* DB_LMDB_BATCH_OPS_MAX, DB_LMDB_WARM_STEP */
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_warm_db";
+
+static void test_db_core_warm_reopen_uses_schema_and_prefetch(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "hot", "cold" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+    db_env_cfg_t cfg;
+    assert_int_equal(db_core_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+    cfg.warm          = DB_WARM_READER_CHECK | DB_WARM_PREFETCH_MAP | DB_WARM_SCHEMA;
+    cfg.prefetch_dbis = 1u << 2;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg),
+                     -EINVAL);
+
+    /* First open: no record yet, DBIs created and the record saved */
+    cfg.prefetch_dbis = 0u;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg), 0);
+
+    db_warm_stats_t ws;
+    db_core_warm_stats(&ws);
+    assert_int_equal(ws.schema_hit, 0);
+    assert_int_equal(ws.readers_cleared, 0u);
+
+    /* More entries than one walk step */
+    const unsigned n = 2u * DB_LMDB_WARM_STEP + 100u;
+    char           key[16];
+    for(unsigned i = 0; i < n; i++)
+    {
+        (void)snprintf(key, sizeof(key), "k%07u", i);
+        assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, key, 8u, "v", 1u), 0);
+        if((i + 1u) % DB_LMDB_BATCH_OPS_MAX == 0) assert_int_equal(db_core_exec_ops(), 0);
+    }
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "1", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Reopen: DBIs from the record, the hot one walked in the background */
+    (void)db_core_shutdown();
+    cfg.prefetch_dbis = 1u << 0;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, dbi_names, dbi_types, 2u, &cfg), 0);
+
+    char val[8];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "k0000007", 8u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_warm_wait(), 0);
+
+    db_core_warm_stats(&ws);
+    assert_int_equal(ws.schema_hit, 1);
+    assert_true(ws.advised_bytes > 0u);
+    assert_int_equal(ws.walkers, 0u);
+    assert_int_equal(ws.walk_res, 0);
+    assert_int_equal(ws.walked, n);
+    assert_int_equal(ws.walked_bytes, n * 9u);
+
+    /* Writes and dups work on DBIs opened from the record */
+    assert_int_equal(db_core_add_op(1u, DB_OPERATION_PUT, "d", 1u, "2", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "new", 3u, "x", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "new", 3u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    /* Another schema: cold open, which saves the new record */
+    (void)db_core_shutdown();
+    const char*      names2[] = { "hot", "cold", "extra" };
+    const dbi_type_t types2[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT, DBI_TYPE_DEFAULT };
+    cfg.prefetch_dbis         = 0u;
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, names2, types2, 3u, &cfg), 0);
+    db_core_warm_stats(&ws);
+    assert_int_equal(ws.schema_hit, 0);
+    assert_int_equal(ws.walked, 0u);
+
+    (void)db_core_shutdown();
+    assert_int_equal(db_core_init_ex(k_test_db_path, 0600u, names2, types2, 3u, &cfg), 0);
+    db_core_warm_stats(&ws);
+    assert_int_equal(ws.schema_hit, 1);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "new", 3u, val, sizeof(val)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_warm_reopen_uses_schema_and_prefetch,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,138 @@
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "core.h"
+#include "it_env.h"
+
+const char* k_test_db_path = "./it_db_core_zip_db";
+
+static size_t it_doc(char* buf, const size_t cap, const unsigned i)
+{
+    return (size_t)snprintf(buf, cap,
+                            "{\"id\":%u,\"name\":\"user-%u\",\"email\":\"user-%u@example.org\","
+                            "\"plan\":\"%s\",\"tags\":[\"alpha\",\"beta\"]}",
+                            i, i * 7u, i, (i % 3u) ? "basic" : "premium");
+}
+
+static int it_fill(void* dst, size_t size, void* ctx)
+{
+    (void)ctx;
+    memset(dst, 'r', size);
+    return 0;
+}
+
+static void test_db_core_zip_values_read_back_transparently(void** state)
+{
+    (void)state;
+
+    const char*      dbi_names[] = { "docs", "zip_meta" };
+    const dbi_type_t dbi_types[] = { DBI_TYPE_ZIP, DBI_TYPE_DEFAULT };
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+
+    /* Pages of alike records: compressed when a codec is built in */
+    static char page_doc[4096];
+    size_t      used = 0u;
+    for(unsigned i = 0; used < sizeof(page_doc) - 128u; ++i)
+    {
+        used += it_doc(page_doc + used, sizeof(page_doc) - used, i);
+    }
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "big", 3u, page_doc, used), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "tiny", 4u, "t", 1u), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+
+    db_zip_stats_t st;
+    assert_int_equal(db_core_zip_stats(0u, &st), 0);
+    assert_int_equal(st.packed + st.raw, 2u);
+    if(st.packed) assert_true(st.bytes_out < st.bytes_in);
+    assert_int_equal(db_core_zip_stats(1u, &st), -ENOENT);
+
+    /* Into a buffer, leased without one, and through a scan */
+    static char buf[4096];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "big", 3u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, page_doc, used);
+
+    db_view_t views[2];
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "big", 3u, NULL, 0u), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "tiny", 4u, NULL, 0u), 0);
+    assert_int_equal(db_core_batch_exec_leased(NULL, views, 2u), 0);
+    assert_int_equal(views[0].size, used);
+    assert_memory_equal(views[0].data, page_doc, used);
+    assert_int_equal(views[1].size, 1u);
+    assert_memory_equal(views[1].data, "t", 1u);
+    db_core_release_read(NULL);
+
+    static unsigned char scan_buf[8192];
+    db_scan_page_t       page = { scan_buf, sizeof(scan_buf), 0u, 0u };
+    db_scan_t            scan = { 0 };
+    scan.mode                 = DB_SCAN_RANGE;
+    scan.page                 = &page;
+    assert_int_equal(db_core_batch_add_scan(NULL, 0u, &scan), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(page.n_items, 2u);
+
+    size_t    pos = 0u;
+    db_view_t k;
+    db_view_t v;
+    assert_int_equal(db_core_page_next(&page, &pos, &k, &v), 1);
+    assert_int_equal(v.size, used);
+    assert_memory_equal(v.data, page_doc, used);
+
+    /* Frames cannot be written in place */
+    db_reserve_t rsv = { 8u, it_fill, NULL };
+    assert_int_equal(db_core_batch_add_put_reserve(NULL, 0u, "r", 1u, &rsv), 0);
+    assert_int_equal(db_core_exec_ops(), -EOPNOTSUPP);
+
+    /* zstd dictionaries: small records shrink too, and survive a restart */
+    const db_zip_cfg_t cfg = { .codec = DB_ZIP_ZSTD, .min_size = 32u, .dict = 1, .meta_dbi = 1u };
+    const int          rc  = db_core_zip_enable(0u, &cfg);
+    if(rc == -ENOTSUP) return;
+    assert_int_equal(rc, 0);
+
+    static char      pool[1000][128];
+    static db_view_t samples[1000];
+    for(unsigned i = 0; i < 1000u; ++i)
+    {
+        samples[i].data = pool[i];
+        samples[i].size = it_doc(pool[i], sizeof(pool[i]), i);
+    }
+    assert_int_equal(db_core_zip_train(0u, samples, 1000u), 1);
+
+    char           doc[128];
+    const size_t   n = it_doc(doc, sizeof(doc), 4242u);
+    db_zip_stats_t before;
+    assert_int_equal(db_core_zip_stats(0u, &before), 0);
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_PUT, "small", 5u, doc, n), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_int_equal(db_core_zip_stats(0u, &st), 0);
+    assert_int_equal(st.dict_id, 1u);
+    assert_int_equal(st.packed, before.packed + 1u);
+    assert_true(st.bytes_out - before.bytes_out < n);
+
+    (void)db_core_shutdown();
+    assert_int_equal(db_core_init(k_test_db_path, 0600u, dbi_names, dbi_types, 2u), 0);
+    assert_int_equal(db_core_zip_enable(0u, &cfg), 0);
+
+    memset(buf, 0, sizeof(buf));
+    assert_int_equal(db_core_add_op(0u, DB_OPERATION_GET, "small", 5u, buf, sizeof(buf)), 0);
+    assert_int_equal(db_core_exec_ops(), 0);
+    assert_memory_equal(buf, doc, n);
+}
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_db_core_zip_values_read_back_transparently,
+                                        setup_clean_env,
+                                        teardown_env),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
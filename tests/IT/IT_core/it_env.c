@@ -0,0 +1,72 @@
+#include "it_env.h"
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <setjmp.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+int setup_clean_env(void** state)
+{
+    (void)state;
+
+    /* Best-effort cleanup of any previous env directory. */
+    struct stat st;
+    if(stat(k_test_db_path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        /* Remove LMDB files if they exist, then rmdir. */
+        char path_data[256];
+        char path_lock[256];
+
+        (void)snprintf(path_data, sizeof(path_data), "%s/data.mdb", k_test_db_path);
+        (void)snprintf(path_lock, sizeof(path_lock), "%s/lock.mdb", k_test_db_path);
+
+        unlink(path_data);
+        unlink(path_lock);
+        rmdir(k_test_db_path);
+    }
+
+    return 0;
+}
+
+int teardown_env(void** state)
+{
+    (void)state;
+
+    /* Ensure core shutdown so tests remain isolated. */
+    (void)db_core_shutdown();
+
+    struct stat st;
+    if(stat(k_test_db_path, &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        char path_data[256];
+        char path_lock[256];
+
+        (void)snprintf(path_data, sizeof(path_data), "%s/data.mdb", k_test_db_path);
+        (void)snprintf(path_lock, sizeof(path_lock), "%s/lock.mdb", k_test_db_path);
+
+        unlink(path_data);
+        unlink(path_lock);
+        rmdir(k_test_db_path);
+    }
+
+    return 0;
+}
+
+int it_scan_collect(const db_view_t* key, const db_view_t* val, void* ctx)
+{
+    it_scan_sink_t* sink = ctx;
+    assert_true(key->size < sizeof(sink->keys[0]));
+    assert_true(val->size > 0u);
+    memcpy(sink->keys[sink->n], key->data, key->size);
+    sink->keys[sink->n][key->size] = '\0';
+    sink->n++;
+    return sink->stop_after && sink->n == sink->stop_after;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file it_env.h
+ * @brief Shared integration-test environment: env directory fixtures and scan helpers.
+ */
+
+#ifndef DB_LMDB_IT_ENV_H
+#define DB_LMDB_IT_ENV_H
+
+#include <stddef.h>
+
+#include "core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Env directory of the suite, defined by each IT file so suites never share one. */
+extern const char* k_test_db_path;
+
+/* Removes the env directory left by a previous run. */
+int setup_clean_env(void** state);
+
+/* Shuts the core down and removes the env directory. */
+int teardown_env(void** state);
+
+/* Keys seen by it_scan_collect(), which stops the scan after stop_after keys when set. */
+typedef struct
+{
+    char   keys[16][4];
+    size_t n;
+    size_t stop_after;
+} it_scan_sink_t;
+
+int it_scan_collect(const db_view_t* key, const db_view_t* val, void* ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DB_LMDB_IT_ENV_H */
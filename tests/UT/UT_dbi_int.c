@@ -53,6 +53,33 @@ static void test_dbi_open_flags_ignores_nooverwrite_flag(void** state)
     assert_int_equal(flags, MDB_CREATE);
 }
 
+static void test_dbi_open_flags_integer_types(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+
+    unsigned int flags_key = dbi_open_flags_from_type(DBI_TYPE_INTEGERKEY);
+    assert_int_equal(flags_key, MDB_CREATE | MDB_INTEGERKEY);
+
+    /* Integer dups are sorted fixed-size dups */
+    unsigned int flags_dup = dbi_open_flags_from_type(DBI_TYPE_INTEGERDUP);
+    assert_true((flags_dup & MDB_INTEGERDUP) != 0u);
+    assert_true((flags_dup & MDB_DUPSORT) != 0u);
+    assert_true((flags_dup & MDB_DUPFIXED) != 0u);
+    assert_true((flags_dup & MDB_INTEGERKEY) == 0u);
+}
+
+static void test_dbi_int_size_ok_accepts_only_integer_sizes(void** state)
+{
+    (void)state;
+
+    assert_true(dbi_int_size_ok(sizeof(unsigned int)));
+    assert_true(dbi_int_size_ok(sizeof(size_t)));
+    assert_false(dbi_int_size_ok(0u));
+    assert_false(dbi_int_size_ok(1u));
+    assert_false(dbi_int_size_ok(sizeof(size_t) + 1u));
+}
+
 /* ------------------------------------------------------------------------- */
 /* dbi_put_flags_from_type() tests                                           */
 /* ------------------------------------------------------------------------- */
@@ -95,6 +122,8 @@ int main(void)
         cmocka_unit_test(test_dbi_open_flags_default_type_uses_create_only),
         cmocka_unit_test(test_dbi_open_flags_dupsort_and_dupfixed_bits),
         cmocka_unit_test(test_dbi_open_flags_ignores_nooverwrite_flag),
+        cmocka_unit_test(test_dbi_open_flags_integer_types),
+        cmocka_unit_test(test_dbi_int_size_ok_accepts_only_integer_sizes),
         cmocka_unit_test(test_dbi_put_flags_default_type_returns_zero),
         cmocka_unit_test(test_dbi_put_flags_nooverwrite_sets_mdb_nooverwrite),
         cmocka_unit_test(test_dbi_put_flags_nooverwrite_combined_with_other_bits),
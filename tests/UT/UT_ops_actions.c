@@ -9,6 +9,8 @@
 
 #include "tests/UT/ut_env.h"
 #include "core/operations/ops_int/ops_actions.h"
+#include "core/operations/ops_int/ops_map.h"
+#include "core/operations/ops_int/ops_zip.h"
 
 /* ------------------------------------------------------------------------- */
 /* Helpers                                                                   */
@@ -20,8 +22,42 @@ static void ut_reset_all(void)
     DataBase = NULL;
 }
 
+/* Reset, with a database of one plain DBI for the ops that look it up */
+static void ut_reset_with_db(void)
+{
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+
+    ut_reset_all();
+    memset(dbis, 0, sizeof(dbis));
+    memset(&db, 0, sizeof(db));
+    db.env    = (MDB_env*)0x60;
+    db.dbis   = dbis;
+    db.n_dbis = 1u;
+    DataBase  = &db;
+}
+
 /* _resolve_desc() is exercised indirectly via act_put/act_get tests. */
 
+/* Map gate of the dictionary txns of ops_zip: unused here */
+void ops_map_enter(void)
+{
+}
+
+void ops_map_leave(void)
+{
+}
+
+void ops_map_after_commit(void)
+{
+}
+
+int ops_map_on_full(const unsigned attempt)
+{
+    (void)attempt;
+    return -ENOSPC;
+}
+
 /* ------------------------------------------------------------------------- */
 /* act_txn_begin / act_txn_commit tests                                      */
 /* ------------------------------------------------------------------------- */
@@ -114,6 +150,45 @@ static void test_act_txn_begin_lmdb_error_maps_via_security_check(void** state)
     assert_null(out_txn);
 }
 
+static MDB_txn* ut_txn_parent = NULL;
+
+static int ut_txn_begin_nested_capture(MDB_env* env, MDB_txn* parent, unsigned int flags,
+                                       MDB_txn** out)
+{
+    (void)env;
+    assert_int_equal(flags, 0u);
+    ut_txn_parent = parent;
+    *out          = (MDB_txn*)0x210;
+    return MDB_SUCCESS;
+}
+
+static void test_act_txn_nested_begin_passes_parent(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    static DataBase_t db;
+    memset(&db, 0, sizeof(db));
+    db.env   = (MDB_env*)0x12;
+    DataBase = &db;
+
+    MDB_txn* out_txn = NULL;
+    int      err     = 0;
+
+    g_ut_mdb_txn_begin = ut_txn_begin_nested_capture;
+    assert_int_equal(act_txn_nested_begin((MDB_txn*)0x20F, &out_txn, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(ut_txn_parent, (MDB_txn*)0x20F);
+    assert_ptr_equal(out_txn, (MDB_txn*)0x210);
+
+    /* No parent: not a nested txn */
+    assert_int_equal(act_txn_nested_begin(NULL, &out_txn, &err), DB_SAFETY_FAIL);
+
+    g_ut_mdb_txn_begin = ut_txn_begin_fail_readers_full;
+    assert_int_equal(act_txn_nested_begin((MDB_txn*)0x20F, &out_txn, &err), DB_SAFETY_RETRY);
+    assert_int_equal(err, -EAGAIN);
+}
+
 static int ut_txn_commit_fail_corrupted(MDB_txn* txn)
 {
     (void)txn;
@@ -305,8 +380,8 @@ static void test_act_get_rejects_invalid_input(void** state)
     memset(&op, 0, sizeof(op));
 
     int err = 0;
-    assert_int_equal(act_get(NULL, &op, &err), DB_SAFETY_FAIL);
-    assert_int_equal(act_get((MDB_txn*)0x60, NULL, &err), DB_SAFETY_FAIL);
+    assert_int_equal(act_get(NULL, &op, NULL, &err), DB_SAFETY_FAIL);
+    assert_int_equal(act_get((MDB_txn*)0x60, NULL, NULL, &err), DB_SAFETY_FAIL);
 }
 
 static int ut_get_success_in_place_buffer(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* val)
@@ -325,7 +400,7 @@ static void test_act_get_copies_into_user_buffer_when_present(void** state)
 {
     (void)state;
 
-    ut_reset_all();
+    ut_reset_with_db();
 
     op_t op;
     memset(&op, 0, sizeof(op));
@@ -343,7 +418,7 @@ static void test_act_get_copies_into_user_buffer_when_present(void** state)
     g_ut_mdb_get = ut_get_success_in_place_buffer;
 
     int err = 0;
-    db_security_ret_code_t rc = act_get((MDB_txn*)0x61, &op, &err);
+    db_security_ret_code_t rc = act_get((MDB_txn*)0x61, &op, NULL, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
@@ -366,7 +441,7 @@ static void test_act_get_populates_present_when_no_buffer(void** state)
 {
     (void)state;
 
-    ut_reset_all();
+    ut_reset_with_db();
 
     op_t op;
     memset(&op, 0, sizeof(op));
@@ -381,7 +456,7 @@ static void test_act_get_populates_present_when_no_buffer(void** state)
     g_ut_mdb_get = ut_get_success_no_user_buffer;
 
     int err = 0;
-    db_security_ret_code_t rc = act_get((MDB_txn*)0x62, &op, &err);
+    db_security_ret_code_t rc = act_get((MDB_txn*)0x62, &op, NULL, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
@@ -406,7 +481,7 @@ static void test_act_get_user_buffer_too_small_fails(void** state)
 {
     (void)state;
 
-    ut_reset_all();
+    ut_reset_with_db();
 
     op_t op;
     memset(&op, 0, sizeof(op));
@@ -424,7 +499,7 @@ static void test_act_get_user_buffer_too_small_fails(void** state)
     g_ut_mdb_get = ut_get_sets_large_value;
 
     int err = 0;
-    db_security_ret_code_t rc = act_get((MDB_txn*)0x63, &op, &err);
+    db_security_ret_code_t rc = act_get((MDB_txn*)0x63, &op, NULL, &err);
 
     assert_int_equal(rc, DB_SAFETY_FAIL);
 }
@@ -442,7 +517,7 @@ static void test_act_get_lmdb_error_maps_via_security_check(void** state)
 {
     (void)state;
 
-    ut_reset_all();
+    ut_reset_with_db();
 
     op_t op;
     memset(&op, 0, sizeof(op));
@@ -455,10 +530,1309 @@ static void test_act_get_lmdb_error_maps_via_security_check(void** state)
     g_ut_mdb_get = ut_get_fail_notfound;
 
     int err = 0;
-    db_security_ret_code_t rc = act_get((MDB_txn*)0x64, &op, &err);
+    db_security_ret_code_t rc = act_get((MDB_txn*)0x64, &op, NULL, &err);
+
+    assert_int_equal(rc, DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOENT);
+}
+
+static MDB_txn* ut_last_aborted_txn;
+static int      ut_abort_calls;
+
+static void ut_abort_record(MDB_txn* txn)
+{
+    ut_last_aborted_txn = txn;
+    ut_abort_calls++;
+}
+
+static void test_act_get_notfound_aborts_txn(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    ut_last_aborted_txn = NULL;
+    ut_abort_calls      = 0;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    db.env    = (MDB_env*)0x66;
+    db.dbis   = dbis;
+    db.n_dbis = 1u;
+    DataBase  = &db;
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+
+    char key_buf[1] = { 'k' };
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = key_buf;
+    op.key.present.size = sizeof(key_buf);
+
+    g_ut_mdb_get       = ut_get_fail_notfound;
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    int err = 0;
+    db_security_ret_code_t rc = act_get((MDB_txn*)0x65, &op, NULL, &err);
 
+    /* Logic failures must not leak the txn to the caller */
     assert_int_equal(rc, DB_SAFETY_FAIL);
     assert_int_equal(err, -ENOENT);
+    assert_int_equal(ut_abort_calls, 1);
+    assert_ptr_equal(ut_last_aborted_txn, (MDB_txn*)0x65);
+}
+
+static void test_act_txn_commit_failure_does_not_abort(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    ut_abort_calls = 0;
+
+    g_ut_mdb_txn_commit = ut_txn_commit_fail_corrupted;
+    g_ut_mdb_txn_abort  = ut_abort_record;
+
+    int err = 0;
+    db_security_ret_code_t rc = act_txn_commit((MDB_txn*)0x32, &err);
+
+    /* mdb_txn_commit already freed the txn */
+    assert_int_equal(rc, DB_SAFETY_FAIL);
+    assert_int_equal(ut_abort_calls, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* act_txn_ro_begin() / act_txn_ro_end() tests                               */
+/* ------------------------------------------------------------------------- */
+
+static int ut_begin_calls;
+static int ut_reset_calls;
+static int ut_renew_calls;
+
+static int ut_txn_begin_count(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** out)
+{
+    (void)env;
+    (void)parent;
+    assert_int_equal(flags, MDB_RDONLY);
+    ut_begin_calls++;
+    if(out)
+    {
+        *out = (MDB_txn*)0x300;
+    }
+    return MDB_SUCCESS;
+}
+
+static void ut_txn_reset_count(MDB_txn* txn)
+{
+    assert_ptr_equal(txn, (MDB_txn*)0x300);
+    ut_reset_calls++;
+}
+
+static int ut_txn_renew_count(MDB_txn* txn)
+{
+    assert_ptr_equal(txn, (MDB_txn*)0x300);
+    ut_renew_calls++;
+    return MDB_SUCCESS;
+}
+
+static void ut_ro_setup(DataBase_t* db)
+{
+    ut_reset_all();
+    memset(db, 0, sizeof(*db));
+    db->env  = (MDB_env*)0x70;
+    DataBase = db;
+
+    /* Drop whatever a previous test left parked on this thread */
+    act_txn_ro_flush();
+
+    ut_begin_calls = 0;
+    ut_reset_calls = 0;
+    ut_renew_calls = 0;
+    ut_abort_calls = 0;
+
+    g_ut_mdb_txn_begin = ut_txn_begin_count;
+    g_ut_mdb_txn_reset = ut_txn_reset_count;
+    g_ut_mdb_txn_renew = ut_txn_renew_count;
+    g_ut_mdb_txn_abort = ut_abort_record;
+}
+
+static void test_act_txn_ro_renews_parked_txn(void** state)
+{
+    (void)state;
+
+    static DataBase_t db;
+    ut_ro_setup(&db);
+
+    MDB_txn* txn = NULL;
+    int      err = 0;
+
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(txn, (MDB_txn*)0x300);
+    act_txn_ro_end(txn);
+
+    txn = NULL;
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(txn, (MDB_txn*)0x300);
+    act_txn_ro_end(txn);
+
+    /* One real begin, then reset/renew cycles; nothing aborted */
+    assert_int_equal(ut_begin_calls, 1);
+    assert_int_equal(ut_renew_calls, 1);
+    assert_int_equal(ut_reset_calls, 2);
+    assert_int_equal(ut_abort_calls, 0);
+
+    /* Flush aborts the parked txn exactly once */
+    act_txn_ro_flush();
+    act_txn_ro_flush();
+    assert_int_equal(ut_abort_calls, 1);
+}
+
+static int ut_txn_renew_fail(MDB_txn* txn)
+{
+    (void)txn;
+    ut_renew_calls++;
+    return EINVAL;
+}
+
+static void test_act_txn_ro_renew_failure_falls_back_to_begin(void** state)
+{
+    (void)state;
+
+    static DataBase_t db;
+    ut_ro_setup(&db);
+    g_ut_mdb_txn_renew = ut_txn_renew_fail;
+
+    MDB_txn* txn = NULL;
+    int      err = 0;
+
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    act_txn_ro_end(txn);
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(txn, (MDB_txn*)0x300);
+
+    /* The unrenewable handle was dropped and a fresh txn begun */
+    assert_int_equal(ut_renew_calls, 1);
+    assert_int_equal(ut_abort_calls, 1);
+    assert_int_equal(ut_begin_calls, 2);
+
+    act_txn_ro_end(txn);
+    act_txn_ro_flush();
+}
+
+static void test_act_txn_ro_reuse_disabled_aborts(void** state)
+{
+    (void)state;
+
+    static DataBase_t db;
+    ut_ro_setup(&db);
+    act_txn_ro_set_reuse(0);
+
+    MDB_txn* txn = NULL;
+    int      err = 0;
+
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    act_txn_ro_end(txn);
+    assert_int_equal(act_txn_ro_begin(&txn, &err), DB_SAFETY_SUCCESS);
+    act_txn_ro_end(txn);
+
+    assert_int_equal(ut_begin_calls, 2);
+    assert_int_equal(ut_reset_calls, 0);
+    assert_int_equal(ut_renew_calls, 0);
+    assert_int_equal(ut_abort_calls, 2);
+
+    act_txn_ro_set_reuse(DB_LMDB_RO_TXN_REUSE);
+}
+
+/* ------------------------------------------------------------------------- */
+/* act_del() tests                                                           */
+/* ------------------------------------------------------------------------- */
+
+static MDB_val* ut_del_key;
+static MDB_val* ut_del_data;
+
+static int ut_del_capture(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    (void)txn;
+    assert_int_equal(dbi, 3u);
+    ut_del_key  = key;
+    ut_del_data = data;
+    return MDB_SUCCESS;
+}
+
+static void ut_del_setup(dbi_t* dbis, DataBase_t* db, const unsigned is_dupsort)
+{
+    ut_reset_all();
+    memset(dbis, 0, sizeof(dbi_t));
+    memset(db, 0, sizeof(DataBase_t));
+    dbis[0].dbi        = 3u;
+    dbis[0].is_dupsort = is_dupsort;
+    db->env            = (MDB_env*)0x90;
+    db->dbis           = dbis;
+    db->n_dbis         = 1u;
+    DataBase           = db;
+
+    ut_del_key     = NULL;
+    ut_del_data    = NULL;
+    ut_abort_calls = 0;
+}
+
+static void test_act_del_by_key_and_dup_value(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    g_ut_mdb_del = ut_del_capture;
+
+    op_t ops[2];
+    memset(ops, 0, sizeof(ops));
+    ops[0].type             = DB_OPERATION_GET;
+    ops[0].key.kind         = OP_KEY_KIND_PRESENT;
+    ops[0].key.present.ptr  = (void*)"k";
+    ops[0].key.present.size = 1u;
+
+    /* Key looked up from the previous op, whole key deleted */
+    ops[1].type                = DB_OPERATION_DEL;
+    ops[1].key.kind            = OP_KEY_KIND_LOOKUP;
+    ops[1].key.lookup.src_type = OP_KEY_SRC_KEY;
+    ops[1].key.lookup.op_index = 1u;
+
+    int err = 0;
+    assert_int_equal(act_del((MDB_txn*)0x91, &ops[1], &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(ut_del_key, (MDB_val*)&ops[0].key.present);
+    assert_null(ut_del_data);
+
+    /* Only one duplicate */
+    ops[1].val.kind         = OP_KEY_KIND_PRESENT;
+    ops[1].val.present.ptr  = (void*)"d";
+    ops[1].val.present.size = 1u;
+    assert_int_equal(act_del((MDB_txn*)0x91, &ops[1], &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(ut_del_data, (MDB_val*)&ops[1].val.present);
+    assert_int_equal(ut_abort_calls, 0);
+}
+
+static void test_act_del_rejects_dup_value_on_plain_dbi(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_del       = ut_del_capture;
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_DEL;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+    op.val.kind         = OP_KEY_KIND_PRESENT;
+    op.val.present.ptr  = (void*)"d";
+    op.val.present.size = 1u;
+
+    int err = 0;
+    assert_int_equal(act_del((MDB_txn*)0x92, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_null(ut_del_key);
+    assert_int_equal(ut_abort_calls, 1);
+
+    assert_int_equal(act_del(NULL, &op, &err), DB_SAFETY_FAIL);
+}
+
+static int ut_del_notfound(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)data;
+    return MDB_NOTFOUND;
+}
+
+static void test_act_del_missing_key_fails_and_aborts(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_del       = ut_del_notfound;
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_DEL;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+
+    int err = 0;
+    assert_int_equal(act_del((MDB_txn*)0x93, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOENT);
+    assert_int_equal(ut_abort_calls, 1);
+}
+
+/* Fake cursor over a sorted key set: "a" "b" "c" "d" "e" */
+static const char* ut_keys[]     = { "a", "b", "c", "d", "e" };
+static int         ut_deleted[5] = { 0 };
+static int         ut_cur_pos    = -1;
+static unsigned    ut_cur_del_flags;
+
+static int ut_cur_seek(int from, MDB_val* key)
+{
+    ut_cur_pos = from;
+    while(ut_cur_pos < 5 && ut_deleted[ut_cur_pos])
+    {
+        ut_cur_pos++;
+    }
+    if(ut_cur_pos >= 5) return MDB_NOTFOUND;
+    key->mv_data = (void*)ut_keys[ut_cur_pos];
+    key->mv_size = 1u;
+    return MDB_SUCCESS;
+}
+
+/* Values of the fake cursor: upper case of the key */
+static const char* ut_vals[] = { "A", "B", "C", "D", "E" };
+
+static int ut_cursor_get_fake(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    (void)cursor;
+    int rc = EINVAL;
+    switch(op)
+    {
+        case MDB_FIRST:
+            rc = ut_cur_seek(0, key);
+            break;
+        case MDB_SET_RANGE:
+            rc = MDB_NOTFOUND;
+            for(int i = 0; i < 5; i++)
+            {
+                if(memcmp(ut_keys[i], key->mv_data, 1u) >= 0)
+                {
+                    rc = ut_cur_seek(i, key);
+                    break;
+                }
+            }
+            break;
+        case MDB_SET_KEY:
+            rc = MDB_NOTFOUND;
+            for(int i = 0; i < 5; i++)
+            {
+                if(memcmp(ut_keys[i], key->mv_data, 1u) == 0)
+                {
+                    rc = ut_cur_seek(i, key);
+                    break;
+                }
+            }
+            break;
+        case MDB_NEXT:
+            /* After a delete the cursor already points to the next item */
+            rc = ut_cur_seek(ut_deleted[ut_cur_pos] ? ut_cur_pos : ut_cur_pos + 1, key);
+            break;
+        case MDB_NEXT_DUP:
+            /* One value per key */
+            return MDB_NOTFOUND;
+        default:
+            return EINVAL;
+    }
+
+    if(rc == MDB_SUCCESS && data)
+    {
+        data->mv_data = (void*)ut_vals[ut_cur_pos];
+        data->mv_size = 1u;
+    }
+    return rc;
+}
+
+static int ut_cursor_del_fake(MDB_cursor* cursor, unsigned int flags)
+{
+    (void)cursor;
+    ut_cur_del_flags        = flags;
+    ut_deleted[ut_cur_pos] = 1;
+    return MDB_SUCCESS;
+}
+
+static void ut_range_setup(dbi_t* dbis, DataBase_t* db, const unsigned is_dupsort)
+{
+    ut_del_setup(dbis, db, is_dupsort);
+    memset(ut_deleted, 0, sizeof(ut_deleted));
+    ut_cur_pos       = -1;
+    ut_cur_del_flags = 0xFFu;
+    g_ut_mdb_cursor_get = ut_cursor_get_fake;
+    g_ut_mdb_cursor_del = ut_cursor_del_fake;
+}
+
+static void test_act_del_range_deletes_half_open_interval(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 1u);
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_DEL;
+    op.flags            = OP_FLAG_RANGE;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"b";
+    op.key.present.size = 1u;
+    op.val.kind         = OP_KEY_KIND_PRESENT;
+    op.val.present.ptr  = (void*)"d";
+    op.val.present.size = 1u;
+
+    int err = 0;
+    assert_int_equal(act_del((MDB_txn*)0x94, &op, &err), DB_SAFETY_SUCCESS);
+
+    /* [b, d) gone, duplicates removed with their key */
+    assert_int_equal(ut_deleted[0], 0);
+    assert_int_equal(ut_deleted[1], 1);
+    assert_int_equal(ut_deleted[2], 1);
+    assert_int_equal(ut_deleted[3], 0);
+    assert_int_equal(ut_deleted[4], 0);
+    assert_int_equal(ut_cur_del_flags, MDB_NODUPDATA);
+}
+
+static void test_act_del_range_open_bounds_and_empty_range(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 0u);
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_DEL;
+    op.flags            = OP_FLAG_RANGE;
+    op.val.kind         = OP_KEY_KIND_PRESENT;
+    op.val.present.ptr  = (void*)"c";
+    op.val.present.size = 1u;
+
+    /* (-inf, c) */
+    int err = 0;
+    assert_int_equal(act_del((MDB_txn*)0x95, &op, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_deleted[0] + ut_deleted[1], 2);
+    assert_int_equal(ut_deleted[2] + ut_deleted[3] + ut_deleted[4], 0);
+    assert_int_equal(ut_cur_del_flags, 0u);
+
+    /* Same range again: nothing left to delete, still a success */
+    assert_int_equal(act_del((MDB_txn*)0x95, &op, &err), DB_SAFETY_SUCCESS);
+
+    /* [d, +inf) */
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_DEL;
+    op.flags            = OP_FLAG_RANGE;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"d";
+    op.key.present.size = 1u;
+    assert_int_equal(act_del((MDB_txn*)0x95, &op, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_deleted[2], 0);
+    assert_int_equal(ut_deleted[3] + ut_deleted[4], 2);
+}
+
+/* Collects the keys a scan delivers; stops or fails at ut_scan_stop_at */
+static char ut_scan_seen[8];
+static int  ut_scan_n;
+static int  ut_scan_stop_at;
+static int  ut_scan_stop_rc;
+
+static int ut_scan_collect(const db_view_t* key, const db_view_t* val, void* ctx)
+{
+    (void)ctx;
+    assert_int_equal(val->size, 1u);
+    assert_int_equal(*(const char*)val->data, *(const char*)key->data - 'a' + 'A');
+    ut_scan_seen[ut_scan_n++] = *(const char*)key->data;
+    return (ut_scan_n == ut_scan_stop_at) ? ut_scan_stop_rc : 0;
+}
+
+static void ut_scan_setup(op_t* op, db_scan_t* scan, const db_scan_mode_t mode,
+                          const char* start, const char* end)
+{
+    memset(op, 0, sizeof(op_t));
+    memset(scan, 0, sizeof(db_scan_t));
+    memset(ut_scan_seen, 0, sizeof(ut_scan_seen));
+    ut_scan_n       = 0;
+    ut_scan_stop_at = 0;
+    ut_scan_stop_rc = 0;
+
+    scan->mode = mode;
+    scan->cb   = ut_scan_collect;
+    op->type   = DB_OPERATION_LST;
+    op->scan   = scan;
+    if(start)
+    {
+        op->key.kind         = OP_KEY_KIND_PRESENT;
+        op->key.present.ptr  = (void*)start;
+        op->key.present.size = 1u;
+    }
+    if(end)
+    {
+        op->val.kind         = OP_KEY_KIND_PRESENT;
+        op->val.present.ptr  = (void*)end;
+        op->val.present.size = 1u;
+    }
+}
+
+static void test_act_lst_range_honours_bounds_and_limit(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 0u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t        op;
+    db_scan_t   scan;
+    MDB_cursor* cur = NULL;
+    ut_scan_setup(&op, &scan, DB_SCAN_RANGE, "b", "e");
+    scan.limit = 2u;
+
+    /* Limit cuts [b, e) after two records */
+    int err = 0;
+    assert_int_equal(act_lst((MDB_txn*)0x96, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_string_equal(ut_scan_seen, "bc");
+    assert_int_equal(scan.n_seen, 2u);
+    assert_int_equal(scan.more, 1);
+    assert_ptr_equal(cur, (MDB_cursor*)0x800);
+
+    /* No limit: the whole range, out fields reset */
+    ut_scan_n = 0;
+    scan.limit = 0u;
+    assert_int_equal(act_lst((MDB_txn*)0x96, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_scan_n, 3);
+    assert_int_equal(scan.n_seen, 3u);
+    assert_int_equal(scan.more, 0);
+
+    /* Open range */
+    ut_scan_setup(&op, &scan, DB_SCAN_RANGE, NULL, NULL);
+    assert_int_equal(act_lst((MDB_txn*)0x96, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_string_equal(ut_scan_seen, "abcde");
+    assert_int_equal(ut_abort_calls, 0);
+}
+
+static void test_act_lst_prefix_and_dups(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 1u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t        op;
+    db_scan_t   scan;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+
+    ut_scan_setup(&op, &scan, DB_SCAN_PREFIX, "c", NULL);
+    assert_int_equal(act_lst((MDB_txn*)0x97, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_string_equal(ut_scan_seen, "c");
+
+    ut_scan_setup(&op, &scan, DB_SCAN_DUPS, "d", NULL);
+    assert_int_equal(act_lst((MDB_txn*)0x97, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_string_equal(ut_scan_seen, "d");
+    assert_int_equal(scan.more, 0);
+
+    /* Missing key: empty result, not an error */
+    ut_scan_setup(&op, &scan, DB_SCAN_DUPS, "x", NULL);
+    assert_int_equal(act_lst((MDB_txn*)0x97, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(scan.n_seen, 0u);
+
+    /* Keyed modes need a key */
+    ut_scan_setup(&op, &scan, DB_SCAN_PREFIX, NULL, NULL);
+    assert_int_equal(act_lst((MDB_txn*)0x97, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ut_abort_calls, 1);
+}
+
+static void test_act_lst_packs_page_until_full(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 0u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    /* Each record is 8 + 1 + 1 bytes, padded to 16: room for two */
+    unsigned char  buf[40];
+    db_scan_page_t page = { buf, sizeof(buf), 0u, 0u };
+
+    op_t        op;
+    db_scan_t   scan;
+    MDB_cursor* cur = NULL;
+    ut_scan_setup(&op, &scan, DB_SCAN_RANGE, "b", NULL);
+    scan.cb   = NULL;
+    scan.page = &page;
+
+    int err = 0;
+    assert_int_equal(act_lst((MDB_txn*)0x98, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(page.n_items, 2u);
+    assert_int_equal(page.used, 32u);
+    assert_int_equal(scan.more, 1);
+
+    db_scan_rec_t hdr;
+    memcpy(&hdr, buf + 16, sizeof(hdr));
+    assert_int_equal(hdr.key_size, 1u);
+    assert_int_equal(hdr.val_size, 1u);
+    assert_memory_equal(buf + 16 + sizeof(hdr), "cC", 2u);
+
+    /* Not even one record fits */
+    page.cap = 8u;
+    assert_int_equal(act_lst((MDB_txn*)0x98, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOBUFS);
+    assert_int_equal(page.n_items, 0u);
+    assert_int_equal(ut_abort_calls, 1);
+}
+
+static void test_act_lst_callback_stop_and_error(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_range_setup(dbis, &db, 0u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t        op;
+    db_scan_t   scan;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+
+    /* Positive result: the record counts and the scan stops */
+    ut_scan_setup(&op, &scan, DB_SCAN_RANGE, NULL, NULL);
+    ut_scan_stop_at = 2;
+    ut_scan_stop_rc = 1;
+    assert_int_equal(act_lst((MDB_txn*)0x99, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(scan.n_seen, 2u);
+    assert_int_equal(scan.more, 1);
+
+    /* Negative result fails the op and releases the txn */
+    ut_scan_setup(&op, &scan, DB_SCAN_RANGE, NULL, NULL);
+    ut_scan_stop_at = 3;
+    ut_scan_stop_rc = -EIO;
+    assert_int_equal(act_lst((MDB_txn*)0x99, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EIO);
+    assert_int_equal(ut_abort_calls, 1);
+    assert_ptr_equal(ut_last_aborted_txn, (MDB_txn*)0x99);
+
+    assert_int_equal(act_lst((MDB_txn*)0x99, NULL, &cur, &err), DB_SAFETY_FAIL);
+}
+
+/* Cursor put recorder: ut_cput_refuse_append 1 refuses appends, 2 everything */
+static unsigned ut_cput_flags[4];
+static int      ut_cput_calls;
+static int      ut_cput_refuse_append;
+
+static int ut_cursor_put_record(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    (void)cursor;
+    (void)key;
+    (void)data;
+    ut_cput_flags[ut_cput_calls++ & 3] = flags;
+    if(ut_cput_refuse_append > 1) return MDB_KEYEXIST;
+    if(ut_cput_refuse_append && (flags & (MDB_APPEND | MDB_APPENDDUP))) return MDB_KEYEXIST;
+    return MDB_SUCCESS;
+}
+
+static void ut_append_setup(op_t* op, const char* key, const char* val, const unsigned flags)
+{
+    memset(op, 0, sizeof(op_t));
+    op->type             = DB_OPERATION_PUT;
+    op->flags            = flags;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = 1u;
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = (void*)val;
+    op->val.present.size = 1u;
+
+    ut_cput_calls         = 0;
+    ut_cput_refuse_append = 0;
+    g_ut_mdb_cursor_put   = ut_cursor_put_record;
+}
+
+static void test_act_put_append_uses_cursor_and_append_flags(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    dbis[0].put_flags = MDB_NODUPDATA;
+
+    op_t        op;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+
+    ut_append_setup(&op, "k", "v", OP_FLAG_APPEND);
+    assert_int_equal(act_put_append((MDB_txn*)0xA0, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(cur, (MDB_cursor*)0x800);
+    assert_int_equal(ut_cput_calls, 1);
+    assert_int_equal(ut_cput_flags[0], MDB_NODUPDATA | MDB_APPEND);
+
+    ut_append_setup(&op, "k", "w", OP_FLAG_APPENDDUP);
+    assert_int_equal(act_put_append((MDB_txn*)0xA0, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_cput_flags[0], MDB_NODUPDATA | MDB_APPENDDUP);
+    assert_int_equal(op.flags, OP_FLAG_APPENDDUP);
+}
+
+static void test_act_put_append_refused_falls_back_to_plain_put(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t        op;
+    MDB_cursor* cur = (MDB_cursor*)0x801;
+    int         err = 0;
+
+    ut_append_setup(&op, "k", "v", OP_FLAG_APPEND);
+    ut_cput_refuse_append = 1;
+    assert_int_equal(act_put_append((MDB_txn*)0xA1, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_cput_calls, 2);
+    assert_int_equal(ut_cput_flags[1], 0u);
+    assert_int_equal(op.flags, OP_FLAG_NONE);
+    assert_ptr_equal(cur, (MDB_cursor*)0x801);
+    assert_int_equal(ut_abort_calls, 0);
+
+    /* A real conflict (NOOVERWRITE) still fails and releases the txn */
+    ut_append_setup(&op, "k", "v", OP_FLAG_APPEND);
+    ut_cput_refuse_append = 2;
+    assert_int_equal(act_put_append((MDB_txn*)0xA1, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EEXIST);
+    assert_int_equal(ut_abort_calls, 1);
+
+    assert_int_equal(act_put_append((MDB_txn*)0xA1, NULL, &cur, &err), DB_SAFETY_FAIL);
+}
+
+static void test_act_put_cmp_orders_by_dbi_key_then_dup(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[2];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    memset(&dbis[1], 0, sizeof(dbi_t));
+    db.n_dbis = 2u;
+
+    op_t a;
+    op_t b;
+    ut_append_setup(&a, "a", "2", OP_FLAG_NONE);
+    ut_append_setup(&b, "b", "1", OP_FLAG_NONE);
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &a, &b), -2);
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &b, &a), 2);
+
+    /* Same key: the dup value decides on DUPSORT DBIs only */
+    b.key.present.ptr = (void*)"a";
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &a, &b), 1);
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &b, &a), -1);
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &a, &a), 0);
+    a.dbi = 1u;
+    b.dbi = 1u;
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &a, &b), 0);
+
+    /* DBI first */
+    b.dbi = 0u;
+    assert_int_equal(act_put_cmp((MDB_txn*)0xA2, &b, &a), -2);
+}
+
+static int ut_cursor_last_is_c(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    (void)cursor;
+    (void)data;
+    assert_int_equal(op, MDB_LAST);
+    key->mv_data = (void*)"c";
+    key->mv_size = 1u;
+    return MDB_SUCCESS;
+}
+
+static void test_act_put_after_last_compares_with_last_key(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    op_t        op;
+    MDB_cursor* cur   = NULL;
+    int         after = -1;
+    int         err   = 0;
+    ut_append_setup(&op, "a", "v", OP_FLAG_NONE);
+
+    /* Empty DBI (default cursor stub) */
+    assert_int_equal(act_put_after_last((MDB_txn*)0xA3, &op, &cur, &after, &err),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(after, 1);
+    assert_non_null(cur);
+
+    g_ut_mdb_cursor_get = ut_cursor_last_is_c;
+    assert_int_equal(act_put_after_last((MDB_txn*)0xA3, &op, &cur, &after, &err),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(after, 0);
+    op.key.present.ptr = (void*)"c";
+    assert_int_equal(act_put_after_last((MDB_txn*)0xA3, &op, &cur, &after, &err),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(after, 0);
+    op.key.present.ptr = (void*)"d";
+    assert_int_equal(act_put_after_last((MDB_txn*)0xA3, &op, &cur, &after, &err),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(after, 1);
+    assert_int_equal(ut_abort_calls, 0);
+
+    assert_int_equal(act_put_after_last((MDB_txn*)0xA3, &op, &cur, NULL, &err), DB_SAFETY_FAIL);
+}
+
+/* Fake DUPFIXED key "u": 4 byte dups aaaa..eeee in two pages of 3 + 2 */
+static const char ut_multi_page0[] = "aaaabbbbcccc";
+static const char ut_multi_page1[] = "ddddeeee";
+static int        ut_multi_page;
+
+static int ut_cursor_get_multi(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    (void)cursor;
+    switch(op)
+    {
+        case MDB_SET_KEY:
+            if(memcmp(key->mv_data, "u", 1u) != 0) return MDB_NOTFOUND;
+            ut_multi_page = 0;
+            data->mv_data = (void*)ut_multi_page0;
+            data->mv_size = 4u;
+            return MDB_SUCCESS;
+        case MDB_GET_MULTIPLE:
+            data->mv_data = (void*)ut_multi_page0;
+            data->mv_size = 12u;
+            return MDB_SUCCESS;
+        case MDB_NEXT_MULTIPLE:
+            if(ut_multi_page++ > 0) return MDB_NOTFOUND;
+            data->mv_data = (void*)ut_multi_page1;
+            data->mv_size = 8u;
+            return MDB_SUCCESS;
+        default:
+            return EINVAL;
+    }
+}
+
+static void ut_multi_setup(op_t* op, db_multi_t* multi, const op_type_t type, const char* key)
+{
+    memset(op, 0, sizeof(op_t));
+    memset(multi, 0, sizeof(db_multi_t));
+    op->type             = type;
+    op->flags            = OP_FLAG_MULTIPLE;
+    op->multi            = multi;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = 1u;
+}
+
+static void test_act_get_multiple_packs_pages_until_full(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    dbis[0].is_dupfixed = 1u;
+    g_ut_mdb_cursor_get = ut_cursor_get_multi;
+    g_ut_mdb_txn_abort  = ut_abort_record;
+
+    op_t        op;
+    db_multi_t  multi;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+    char        buf[32];
+
+    /* Both pages fit */
+    ut_multi_setup(&op, &multi, DB_OPERATION_GET, "u");
+    multi.buf = buf;
+    multi.cap = sizeof(buf);
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA4, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_non_null(cur);
+    assert_int_equal(multi.elem_size, 4u);
+    assert_int_equal(multi.n_items, 5u);
+    assert_int_equal(multi.more, 0);
+    assert_memory_equal(buf, "aaaabbbbccccddddeeee", 20u);
+    assert_int_equal(op.val.kind, OP_KEY_KIND_PRESENT);
+    assert_ptr_equal(op.val.present.ptr, buf);
+    assert_int_equal(op.val.present.size, 20u);
+
+    /* 18 bytes: the second page is cut to the one whole dup that fits */
+    memset(buf, 0, sizeof(buf));
+    multi.cap = 18u;
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA4, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(multi.n_items, 4u);
+    assert_int_equal(multi.more, 1);
+    assert_memory_equal(buf, "aaaabbbbccccdddd", 16u);
+    assert_int_equal(buf[16], 0);
+
+    /* Missing key: no dups, still a success */
+    ut_multi_setup(&op, &multi, DB_OPERATION_GET, "x");
+    multi.buf = buf;
+    multi.cap = sizeof(buf);
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA4, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(multi.n_items, 0u);
+    assert_int_equal(multi.more, 0);
+    assert_int_equal(ut_abort_calls, 0);
+}
+
+static void test_act_get_multiple_rejects_small_buffer_and_plain_dbi(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    dbis[0].is_dupfixed = 1u;
+    g_ut_mdb_cursor_get = ut_cursor_get_multi;
+    g_ut_mdb_txn_abort  = ut_abort_record;
+
+    op_t        op;
+    db_multi_t  multi;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+    char        buf[4];
+
+    /* Smaller than one dup */
+    ut_multi_setup(&op, &multi, DB_OPERATION_GET, "u");
+    multi.buf = buf;
+    multi.cap = 3u;
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA5, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOBUFS);
+    assert_int_equal(ut_abort_calls, 1);
+
+    /* DUPSORT without DUPFIXED */
+    dbis[0].is_dupfixed = 0u;
+    multi.cap           = sizeof(buf);
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA5, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ut_abort_calls, 2);
+
+    op.multi = NULL;
+    assert_int_equal(act_get_multiple((MDB_txn*)0xA5, &op, &cur, &err), DB_SAFETY_FAIL);
+}
+
+/* Cursor put recorder for MDB_MULTIPLE: data is an array of two MDB_val */
+static size_t   ut_mput_elem;
+static size_t   ut_mput_count;
+static unsigned ut_mput_flags;
+
+static int ut_cursor_put_multi(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    (void)cursor;
+    assert_memory_equal(key->mv_data, "u", 1u);
+    ut_mput_flags = flags;
+    ut_mput_elem  = data[0].mv_size;
+    ut_mput_count = data[1].mv_size;
+    assert_memory_equal(data[0].mv_data, "aaaabbbb", 8u);
+    return MDB_SUCCESS;
+}
+
+static void test_act_put_multiple_stores_array_in_one_put(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 1u);
+    dbis[0].is_dupfixed = 1u;
+    dbis[0].put_flags   = MDB_NOOVERWRITE;
+    g_ut_mdb_cursor_put = ut_cursor_put_multi;
+    g_ut_mdb_txn_abort  = ut_abort_record;
+
+    op_t        op;
+    db_multi_t  multi;
+    MDB_cursor* cur = NULL;
+    int         err = 0;
+
+    ut_multi_setup(&op, &multi, DB_OPERATION_PUT, "u");
+    multi.buf       = (void*)"aaaabbbb";
+    multi.elem_size = 4u;
+    multi.n_items   = 2u;
+    assert_int_equal(act_put_multiple((MDB_txn*)0xA6, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_non_null(cur);
+    assert_int_equal(ut_mput_flags, MDB_NOOVERWRITE | MDB_MULTIPLE);
+    assert_int_equal(ut_mput_elem, 4u);
+    assert_int_equal(ut_mput_count, 2u);
+    assert_int_equal(ut_abort_calls, 0);
+
+    /* Empty array or plain DBI: rejected, txn released */
+    multi.n_items = 0u;
+    assert_int_equal(act_put_multiple((MDB_txn*)0xA6, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    multi.n_items       = 2u;
+    dbis[0].is_dupfixed = 0u;
+    assert_int_equal(act_put_multiple((MDB_txn*)0xA6, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ut_abort_calls, 2);
+}
+
+/* Fake page for MDB_RESERVE: mdb_put hands out ut_rsv_page */
+static char     ut_rsv_page[16];
+static unsigned ut_rsv_flags;
+
+static int ut_mdb_put_reserve(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data,
+                              unsigned int flags)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    ut_rsv_flags = flags;
+    if(data->mv_size > sizeof(ut_rsv_page)) return MDB_KEYEXIST;
+    data->mv_data = ut_rsv_page;
+    return MDB_SUCCESS;
+}
+
+static int ut_rsv_write(void* dst, size_t size, void* ctx)
+{
+    memset(dst, *(const char*)ctx, size);
+    return 0;
+}
+
+static int ut_rsv_write_fail(void* dst, size_t size, void* ctx)
+{
+    (void)dst;
+    (void)size;
+    (void)ctx;
+    return -EPROTO;
+}
+
+static void test_act_put_reserve_writes_into_reserved_bytes(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    dbis[0].put_flags  = MDB_NOOVERWRITE;
+    g_ut_mdb_put       = ut_mdb_put_reserve;
+    g_ut_mdb_txn_abort = ut_abort_record;
+    memset(ut_rsv_page, 0, sizeof(ut_rsv_page));
+
+    db_reserve_t rsv = { 8u, ut_rsv_write, (void*)"r" };
+    op_t         op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_PUT;
+    op.flags            = OP_FLAG_RESERVE;
+    op.reserve          = &rsv;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+
+    int err = 0;
+    assert_int_equal(act_put_reserve((MDB_txn*)0xB1, &op, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_rsv_flags, MDB_NOOVERWRITE | MDB_RESERVE);
+    assert_memory_equal(ut_rsv_page, "rrrrrrrr", 8u);
+    assert_int_equal(ut_rsv_page[8], 0);
+    assert_int_equal(ut_abort_calls, 0);
+
+    /* LMDB failure: the writer never runs */
+    memset(ut_rsv_page, 0, sizeof(ut_rsv_page));
+    rsv.size = 64u;
+    assert_int_equal(act_put_reserve((MDB_txn*)0xB1, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EEXIST);
+    assert_int_equal(ut_rsv_page[0], 0);
+    assert_int_equal(ut_abort_calls, 1);
+
+    /* Writer failure aborts with its code */
+    rsv.size  = 4u;
+    rsv.write = ut_rsv_write_fail;
+    assert_int_equal(act_put_reserve((MDB_txn*)0xB1, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EPROTO);
+    assert_int_equal(ut_abort_calls, 2);
+
+    /* DUPSORT DBIs cannot reserve */
+    rsv.write          = ut_rsv_write;
+    dbis[0].is_dupsort = 1u;
+    assert_int_equal(act_put_reserve((MDB_txn*)0xB1, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ut_abort_calls, 3);
+}
+
+/* Fake key "k": value in a clean page, rewritten into a fresh "dirty" copy.
+ * As LMDB, MDB_SET_KEY points the key at its copy in the page. */
+static char     ut_rep_clean[11];
+static char     ut_rep_dirty[11];
+static char     ut_rep_page_key[1] = { 'k' };
+static unsigned ut_rep_flags;
+
+static int ut_cursor_get_rep(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    (void)cursor;
+    if(op != MDB_SET_KEY || memcmp(key->mv_data, "k", 1u) != 0) return MDB_NOTFOUND;
+    key->mv_data  = ut_rep_page_key;
+    data->mv_data = ut_rep_clean;
+    data->mv_size = 10u;
+    return MDB_SUCCESS;
+}
+
+static int ut_cursor_put_rep(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    (void)cursor;
+    assert_int_equal(key->mv_size, 1u);
+    ut_rep_flags = flags;
+    assert_int_equal(data->mv_size, 10u);
+    memset(ut_rep_dirty, '?', 10u);
+    data->mv_data = ut_rep_dirty;
+    return MDB_SUCCESS;
+}
+
+static int ut_rep_mutate(void* val, size_t size, void* ctx)
+{
+    (void)ctx;
+    ((char*)val)[size - 1u] = 'Z';
+    return 0;
+}
+
+static void test_act_rep_patches_bytes_or_calls_mutate(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_cursor_get = ut_cursor_get_rep;
+    g_ut_mdb_cursor_put = ut_cursor_put_rep;
+    g_ut_mdb_txn_abort  = ut_abort_record;
+    memcpy(ut_rep_clean, "0123456789", 11u);
+
+    db_patch_t  patch = { 2u, "AB", 2u, NULL, NULL };
+    op_t        op;
+    MDB_cursor* cur    = NULL;
+    int         err    = 0;
+    char        key[1] = { 'k' };
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_REP;
+    op.patch            = &patch;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = key;
+    op.key.present.size = 1u;
+
+    /* Old bytes carried into the new copy, then patched */
+    assert_int_equal(act_rep((MDB_txn*)0xC1, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_non_null(cur);
+    /* The op still owns its key, not the page of this txn */
+    assert_ptr_equal(op.key.present.ptr, key);
+    assert_int_equal(op.key.present.size, 1u);
+    assert_int_equal(ut_rep_flags, MDB_CURRENT | MDB_RESERVE);
+    assert_memory_equal(ut_rep_dirty, "01AB456789", 10u);
+
+    patch = (db_patch_t){ 0u, NULL, 0u, ut_rep_mutate, NULL };
+    assert_int_equal(act_rep((MDB_txn*)0xC1, &op, &cur, &err), DB_SAFETY_SUCCESS);
+    assert_memory_equal(ut_rep_dirty, "012345678Z", 10u);
+    assert_int_equal(ut_abort_calls, 0);
+
+    /* Past the end of the value */
+    patch = (db_patch_t){ 9u, "AB", 2u, NULL, NULL };
+    assert_int_equal(act_rep((MDB_txn*)0xC1, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ERANGE);
+    assert_int_equal(ut_abort_calls, 1);
+
+    /* Missing key */
+    patch              = (db_patch_t){ 0u, "A", 1u, NULL, NULL };
+    op.key.present.ptr = (void*)"x";
+    assert_int_equal(act_rep((MDB_txn*)0xC1, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOENT);
+    assert_int_equal(ut_abort_calls, 2);
+
+    /* DUPSORT DBIs cannot be patched */
+    op.key.present.ptr = key;
+    dbis[0].is_dupsort = 1u;
+    assert_int_equal(act_rep((MDB_txn*)0xC1, &op, &cur, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ut_abort_calls, 3);
+}
+
+/* One stored value for the DBI_TYPE_ZIP tests */
+static unsigned char ut_zip_stored[64];
+static size_t        ut_zip_stored_size;
+
+static int ut_mdb_put_zip(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data,
+                          unsigned int flags)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)flags;
+    assert_true(data->mv_size <= sizeof(ut_zip_stored));
+    memcpy(ut_zip_stored, data->mv_data, data->mv_size);
+    ut_zip_stored_size = data->mv_size;
+    return MDB_SUCCESS;
+}
+
+static int ut_mdb_get_zip(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    data->mv_data = ut_zip_stored;
+    data->mv_size = ut_zip_stored_size;
+    return MDB_SUCCESS;
+}
+
+static void test_act_zip_dbi_stores_frames_and_reads_values(void** state)
+{
+    (void)state;
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+    ut_del_setup(dbis, &db, 0u);
+    g_ut_mdb_put       = ut_mdb_put_zip;
+    g_ut_mdb_get       = ut_mdb_get_zip;
+    g_ut_mdb_txn_abort = ut_abort_record;
+
+    const dbi_type_t types[1] = { DBI_TYPE_ZIP };
+    assert_int_equal(ops_zip_open(types, 1u), 0);
+
+    /* Small values are framed raw: a tag byte in front */
+    op_t op;
+    int  err = 0;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_PUT;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+    op.val.kind         = OP_KEY_KIND_PRESENT;
+    op.val.present.ptr  = (void*)"hello";
+    op.val.present.size = 5u;
+    assert_int_equal(act_put((MDB_txn*)0xD1, &op, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_zip_stored_size, 6u);
+    assert_int_equal(ut_zip_stored[0], 0);
+    assert_memory_equal(ut_zip_stored + 1, "hello", 5u);
+
+    /* GETs see the value, in the user buffer or in place */
+    char buf[8] = { 0 };
+    op.type             = DB_OPERATION_GET;
+    op.val.present.ptr  = buf;
+    op.val.present.size = sizeof(buf);
+    assert_int_equal(act_get((MDB_txn*)0xD1, &op, NULL, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(op.val.present.size, 5u);
+    assert_memory_equal(buf, "hello", 5u);
+
+    op.val.present.size = 2u;
+    assert_int_equal(act_get((MDB_txn*)0xD1, &op, NULL, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -ENOBUFS);
+
+    op.val.kind = OP_KEY_KIND_NONE;
+    assert_int_equal(act_get((MDB_txn*)0xD1, &op, NULL, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(op.val.present.ptr, ut_zip_stored + 1);
+    assert_int_equal(op.val.present.size, 5u);
+
+    /* No in-place writes into frames */
+    db_reserve_t rsv = { 4u, ut_rsv_write, (void*)"r" };
+    op.type          = DB_OPERATION_PUT;
+    op.flags         = OP_FLAG_RESERVE;
+    op.reserve       = &rsv;
+    assert_int_equal(act_put_reserve((MDB_txn*)0xD1, &op, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EOPNOTSUPP);
+    assert_int_equal(ut_abort_calls, 2);
+
+    ops_zip_close();
 }
 
 /* ------------------------------------------------------------------------- */
@@ -471,6 +1845,7 @@ int main(void)
         cmocka_unit_test(test_act_txn_begin_success),
         cmocka_unit_test(test_act_txn_begin_invalid_input_fails),
         cmocka_unit_test(test_act_txn_begin_lmdb_error_maps_via_security_check),
+        cmocka_unit_test(test_act_txn_nested_begin_passes_parent),
         cmocka_unit_test(test_act_txn_commit_success),
         cmocka_unit_test(test_act_txn_commit_invalid_input_fails),
         cmocka_unit_test(test_act_txn_commit_lmdb_error_maps_via_security_check),
@@ -483,6 +1858,30 @@ int main(void)
         cmocka_unit_test(test_act_get_populates_present_when_no_buffer),
         cmocka_unit_test(test_act_get_user_buffer_too_small_fails),
         cmocka_unit_test(test_act_get_lmdb_error_maps_via_security_check),
+        cmocka_unit_test(test_act_get_notfound_aborts_txn),
+        cmocka_unit_test(test_act_txn_commit_failure_does_not_abort),
+        cmocka_unit_test(test_act_txn_ro_renews_parked_txn),
+        cmocka_unit_test(test_act_txn_ro_renew_failure_falls_back_to_begin),
+        cmocka_unit_test(test_act_txn_ro_reuse_disabled_aborts),
+        cmocka_unit_test(test_act_del_by_key_and_dup_value),
+        cmocka_unit_test(test_act_del_rejects_dup_value_on_plain_dbi),
+        cmocka_unit_test(test_act_del_missing_key_fails_and_aborts),
+        cmocka_unit_test(test_act_del_range_deletes_half_open_interval),
+        cmocka_unit_test(test_act_del_range_open_bounds_and_empty_range),
+        cmocka_unit_test(test_act_lst_range_honours_bounds_and_limit),
+        cmocka_unit_test(test_act_lst_prefix_and_dups),
+        cmocka_unit_test(test_act_lst_packs_page_until_full),
+        cmocka_unit_test(test_act_lst_callback_stop_and_error),
+        cmocka_unit_test(test_act_put_append_uses_cursor_and_append_flags),
+        cmocka_unit_test(test_act_put_append_refused_falls_back_to_plain_put),
+        cmocka_unit_test(test_act_put_cmp_orders_by_dbi_key_then_dup),
+        cmocka_unit_test(test_act_put_after_last_compares_with_last_key),
+        cmocka_unit_test(test_act_get_multiple_packs_pages_until_full),
+        cmocka_unit_test(test_act_get_multiple_rejects_small_buffer_and_plain_dbi),
+        cmocka_unit_test(test_act_put_multiple_stores_array_in_one_put),
+        cmocka_unit_test(test_act_put_reserve_writes_into_reserved_bytes),
+        cmocka_unit_test(test_act_zip_dbi_stores_frames_and_reads_values),
+        cmocka_unit_test(test_act_rep_patches_bytes_or_calls_mutate),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
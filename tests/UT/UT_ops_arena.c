@@ -0,0 +1,176 @@
+#include <setjmp.h>
+#include <stdalign.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/config.h"
+#include "core/operations/ops_int/ops_arena.h"
+
+/* ------------------------------------------------------------------------- */
+/* ops_arena_alloc() tests                                                   */
+/* ------------------------------------------------------------------------- */
+
+static void test_arena_alloc_rejects_null_and_zero_size(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+
+    assert_null(ops_arena_alloc(NULL, 8u));
+    assert_null(ops_arena_alloc(&arena, 0u));
+    assert_null(arena.head);
+    assert_int_equal(arena.used, 0u);
+}
+
+static void test_arena_alloc_is_aligned_and_advances(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+
+    char* p1 = ops_arena_alloc(&arena, 1u);
+    char* p2 = ops_arena_alloc(&arena, 3u);
+    assert_non_null(p1);
+    assert_non_null(p2);
+    assert_true(p2 > p1);
+    assert_int_equal((uintptr_t)p1 % alignof(max_align_t), 0u);
+    assert_int_equal((uintptr_t)p2 % alignof(max_align_t), 0u);
+
+    /* Both allocations come from the first slab */
+    assert_ptr_equal(arena.head, arena.cur);
+
+    ops_arena_release(&arena);
+}
+
+static void test_arena_alloc_chains_slabs_when_full(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+    arena.slab_size   = 64u;
+
+    void* p1 = ops_arena_alloc(&arena, 48u);
+    assert_non_null(p1);
+    ops_arena_slab_t* first = arena.cur;
+
+    /* Does not fit in the 64 byte slab: a second slab is linked */
+    void* p2 = ops_arena_alloc(&arena, 48u);
+    assert_non_null(p2);
+    assert_true(arena.cur != first);
+    assert_ptr_equal(arena.head, first);
+
+    /* Bigger than any slab size: still served */
+    char* big = ops_arena_alloc(&arena, 1000u);
+    assert_non_null(big);
+    memset(big, 0xA5, 1000u);
+
+    ops_arena_release(&arena);
+    assert_null(arena.head);
+    assert_null(arena.cur);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_arena_reset() / ops_arena_release() tests                             */
+/* ------------------------------------------------------------------------- */
+
+static void test_arena_reset_reuses_slabs(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+    arena.slab_size   = 64u;
+
+    void* a1 = ops_arena_alloc(&arena, 48u);
+    void* a2 = ops_arena_alloc(&arena, 48u);
+    assert_non_null(a1);
+    assert_non_null(a2);
+
+    ops_arena_reset(&arena);
+    assert_int_equal(arena.used, 0u);
+    assert_ptr_equal(arena.cur, arena.head);
+
+    /* Same sequence after reset hands out the same memory */
+    assert_ptr_equal(ops_arena_alloc(&arena, 48u), a1);
+    assert_ptr_equal(ops_arena_alloc(&arena, 48u), a2);
+
+    ops_arena_release(&arena);
+}
+
+static void test_arena_rewind_keeps_allocations_before_mark(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+    arena.slab_size   = 64u;
+
+    /* Mark of an empty arena rewinds like a reset */
+    ops_arena_mark_t empty = ops_arena_mark(&arena);
+    void*            a1    = ops_arena_alloc(&arena, 16u);
+    ops_arena_rewind(&arena, &empty);
+    assert_int_equal(arena.used, 0u);
+    assert_ptr_equal(ops_arena_alloc(&arena, 16u), a1);
+
+    /* Mark, spill into a second slab, rewind into the first one */
+    ops_arena_mark_t mark = ops_arena_mark(&arena);
+    void*            a2   = ops_arena_alloc(&arena, 32u);
+    assert_non_null(ops_arena_alloc(&arena, 48u));
+    assert_ptr_not_equal(arena.cur, arena.head);
+
+    ops_arena_rewind(&arena, &mark);
+    assert_ptr_equal(arena.cur, arena.head);
+    assert_int_equal(arena.used, mark.used);
+    assert_ptr_equal(ops_arena_alloc(&arena, 32u), a2);
+
+    ops_arena_rewind(NULL, &mark);
+    ops_arena_rewind(&arena, NULL);
+    mark = ops_arena_mark(NULL);
+    assert_null(mark.cur);
+
+    ops_arena_release(&arena);
+}
+
+static void test_arena_reset_and_release_on_empty_arena(void** state)
+{
+    (void)state;
+
+    ops_arena_t arena = { 0 };
+
+    ops_arena_reset(&arena);
+    ops_arena_reset(NULL);
+    ops_arena_release(&arena);
+    ops_arena_release(NULL);
+
+    assert_null(arena.head);
+    assert_int_equal(arena.used, 0u);
+
+    /* Default slab size applies when none is configured */
+    assert_non_null(ops_arena_alloc(&arena, DB_LMDB_RW_OPS_CACHE_SIZE / 2u));
+    assert_non_null(ops_arena_alloc(&arena, DB_LMDB_RW_OPS_CACHE_SIZE / 4u));
+    assert_ptr_equal(arena.cur, arena.head);
+
+    ops_arena_release(&arena);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_arena_alloc_rejects_null_and_zero_size),
+        cmocka_unit_test(test_arena_alloc_is_aligned_and_advances),
+        cmocka_unit_test(test_arena_alloc_chains_slabs_when_full),
+        cmocka_unit_test(test_arena_reset_reuses_slabs),
+        cmocka_unit_test(test_arena_rewind_keeps_allocations_before_mark),
+        cmocka_unit_test(test_arena_reset_and_release_on_empty_arena),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
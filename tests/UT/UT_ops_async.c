@@ -0,0 +1,352 @@
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_async.h"
+#include "core/operations/ops_int/ops_exec.h"
+#include "core/operations/ops_int/ops_group.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for ops_exec / ops_group layers                         */
+/* ------------------------------------------------------------------------- */
+
+/* ops_exec and ops_group are tested in their own UT suites; here a fake
+ * batch only says whether it writes and how its execution ends. cmocka is
+ * not thread-safe, so the fakes only record and the checks run on the main
+ * thread. */
+
+struct ops_batch
+{
+    int        writes;  /* ops_batch_has_writes */
+    int        exec_rc; /* ops_execute_operations return */
+    atomic_int exec_calls;
+};
+
+/* Workers wait here while the test keeps the gate closed */
+static atomic_int g_gate_closed = 0;
+
+/* ops_group_submit_async: return code, and the last request taken */
+static int               g_group_rc    = -ENOTCONN;
+static ops_group_done_fn g_group_fn    = NULL;
+static void*             g_group_ctx   = NULL;
+static batch_t*          g_group_batch = NULL;
+
+int ops_batch_has_writes(const batch_t* batch)
+{
+    return batch->writes;
+}
+
+int ops_execute_operations(batch_t* batch)
+{
+    while(atomic_load(&g_gate_closed))
+    {
+        usleep(100);
+    }
+    atomic_fetch_add(&batch->exec_calls, 1);
+    return batch->exec_rc;
+}
+
+int ops_group_submit_async(batch_t* batch, ops_group_done_fn on_done, void* ctx)
+{
+    if(g_group_rc != 0) return g_group_rc;
+    g_group_batch = batch;
+    g_group_fn    = on_done;
+    g_group_ctx   = ctx;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+
+static atomic_int g_cb_calls = 0;
+static atomic_int g_cb_fails = 0; /* callbacks with res != 0 */
+static atomic_int g_cb_ctx   = 0; /* sum of the ctx values */
+
+static void ut_cb(db_batch_t* batch, int res, void* ctx)
+{
+    (void)batch;
+    if(res != 0) atomic_fetch_add(&g_cb_fails, 1);
+    atomic_fetch_add(&g_cb_ctx, (int)(intptr_t)ctx);
+    atomic_fetch_add(&g_cb_calls, 1);
+}
+
+static void ut_batch_init(batch_t* batch, const int writes)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->writes = writes;
+}
+
+static void ut_wait_cb(const int n)
+{
+    while(atomic_load(&g_cb_calls) < n)
+    {
+        usleep(100);
+    }
+}
+
+/* Poll until @p n completions are taken */
+static int ut_drain(db_async_done_t* out, const int n)
+{
+    int got = 0;
+    while(got < n)
+    {
+        int rc = ops_async_poll(out + got, (size_t)(n - got));
+        if(rc < 0) return rc;
+        got += rc;
+        if(got < n) usleep(100);
+    }
+    return got;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    g_db.env = (MDB_env*)0x90;
+    DataBase = &g_db;
+    atomic_store(&g_gate_closed, 0);
+    atomic_store(&g_cb_calls, 0);
+    atomic_store(&g_cb_fails, 0);
+    atomic_store(&g_cb_ctx, 0);
+    g_group_rc    = -ENOTCONN;
+    g_group_fn    = NULL;
+    g_group_ctx   = NULL;
+    g_group_batch = NULL;
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    atomic_store(&g_gate_closed, 0);
+    ops_async_stop();
+    DataBase = NULL;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_async_start() / ops_async_submit() tests                              */
+/* ------------------------------------------------------------------------- */
+
+static void test_async_start_stop_and_invalid_input(void** state)
+{
+    (void)state;
+
+    batch_t b;
+    ut_batch_init(&b, 0);
+
+    /* Not started */
+    assert_int_equal(ops_async_submit(&b, ut_cb, NULL), -ENOTCONN);
+    assert_int_equal(ops_async_poll(NULL, 0), 0);
+    assert_int_equal(ops_async_fd(), -1);
+
+    DataBase = NULL;
+    assert_int_equal(ops_async_start(NULL), -EINVAL);
+    DataBase = &g_db;
+    assert_int_equal(ops_async_start(NULL), 0);
+    assert_int_equal(ops_async_start(NULL), -EALREADY);
+
+    assert_int_equal(ops_async_submit(NULL, ut_cb, NULL), -EINVAL);
+    assert_int_equal(ops_async_poll(NULL, 1), -EINVAL);
+    assert_int_equal(ops_async_fd(), -1);
+
+    /* Stop is idempotent, then submits are refused again */
+    ops_async_stop();
+    ops_async_stop();
+    assert_int_equal(ops_async_submit(&b, ut_cb, NULL), -ENOTCONN);
+    assert_int_equal(b.exec_calls, 0);
+}
+
+static void test_async_reads_run_on_workers_with_callbacks(void** state)
+{
+    (void)state;
+
+    enum { N = 32 };
+    batch_t batches[N];
+    assert_int_equal(ops_async_start(&(db_async_cfg_t){ .readers = 3u }), 0);
+
+    int ctx_sum = 0;
+    for(int i = 0; i < N; i++)
+    {
+        ut_batch_init(&batches[i], 0);
+        batches[i].exec_rc = (i % 8 == 0) ? -ENOENT : 0;
+        assert_int_equal(ops_async_submit(&batches[i], ut_cb, (void*)(intptr_t)(i + 1)), 0);
+        ctx_sum += i + 1;
+    }
+    ut_wait_cb(N);
+
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(batches[i].exec_calls, 1);
+    }
+    assert_int_equal(g_cb_fails, 4);
+    assert_int_equal(g_cb_ctx, ctx_sum);
+
+    /* Callback batches never reach the completion queue */
+    db_async_done_t done[1];
+    assert_int_equal(ops_async_poll(done, 1), 0);
+
+    ops_async_stop();
+    db_async_stats_t st;
+    ops_async_stats(&st);
+    assert_int_equal(st.submitted, (size_t)N);
+    assert_int_equal(st.completed, (size_t)N);
+    assert_int_equal(st.failed, 4u);
+    assert_int_equal(st.reads, (size_t)N);
+    assert_int_equal(st.writes, 0u);
+    assert_int_equal(st.rejected, 0u);
+    assert_true(st.peak_inflight >= 1u);
+}
+
+static void test_async_completion_queue_signals_eventfd(void** state)
+{
+    (void)state;
+
+    enum { N = 3 };
+    batch_t batches[N];
+    assert_int_equal(ops_async_start(&(db_async_cfg_t){ .eventfd = 1 }), 0);
+
+    int fd = ops_async_fd();
+    assert_true(fd >= 0);
+
+    for(int i = 0; i < N; i++)
+    {
+        ut_batch_init(&batches[i], 0);
+        batches[i].exec_rc = -i;
+        assert_int_equal(ops_async_submit(&batches[i], NULL, &batches[i]), 0);
+    }
+
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    assert_int_equal(poll(&pfd, 1, 5000), 1);
+
+    db_async_done_t done[N];
+    assert_int_equal(ut_drain(done, N), N);
+    for(int i = 0; i < N; i++)
+    {
+        batch_t* b = done[i].batch;
+        assert_ptr_equal(done[i].ctx, b);
+        assert_int_equal(done[i].res, b->exec_rc);
+    }
+
+    /* Queue empty: the counter is reset */
+    assert_int_equal(poll(&pfd, 1, 0), 0);
+    assert_int_equal(ops_async_poll(done, N), 0);
+}
+
+static void test_async_depth_limits_inflight_and_unpolled(void** state)
+{
+    (void)state;
+
+    batch_t a;
+    batch_t b;
+    batch_t c;
+    ut_batch_init(&a, 0);
+    ut_batch_init(&b, 0);
+    ut_batch_init(&c, 0);
+    assert_int_equal(ops_async_start(&(db_async_cfg_t){ .readers = 1u, .depth = 2u }), 0);
+
+    /* Executing or queued: both slots taken */
+    atomic_store(&g_gate_closed, 1);
+    assert_int_equal(ops_async_submit(&a, NULL, NULL), 0);
+    assert_int_equal(ops_async_submit(&b, NULL, NULL), 0);
+    assert_int_equal(ops_async_submit(&c, NULL, NULL), -EAGAIN);
+    atomic_store(&g_gate_closed, 0);
+
+    /* Completed but not polled: still taken */
+    db_async_done_t done[2];
+    while(a.exec_calls + b.exec_calls < 2)
+    {
+        usleep(100);
+    }
+    usleep(20000);
+    assert_int_equal(ops_async_submit(&c, NULL, NULL), -EAGAIN);
+
+    assert_int_equal(ut_drain(done, 2), 2);
+    assert_int_equal(ops_async_submit(&c, NULL, NULL), 0);
+
+    /* Stop waits for it, then drops the completion */
+    ops_async_stop();
+    assert_int_equal(c.exec_calls, 1);
+
+    db_async_stats_t st;
+    ops_async_stats(&st);
+    assert_int_equal(st.submitted, 3u);
+    assert_int_equal(st.completed, 3u);
+    assert_int_equal(st.rejected, 2u);
+    assert_int_equal(st.peak_inflight, 2u);
+}
+
+static void test_async_writes_go_to_group_writer_when_running(void** state)
+{
+    (void)state;
+
+    batch_t w;
+    ut_batch_init(&w, 1);
+    assert_int_equal(ops_async_start(NULL), 0);
+
+    /* Writer running: it completes the batch, no worker runs it */
+    g_group_rc = 0;
+    assert_int_equal(ops_async_submit(&w, NULL, (void*)0x7), 0);
+    assert_ptr_equal(g_group_batch, &w);
+    assert_non_null(g_group_fn);
+
+    db_async_done_t done[1];
+    assert_int_equal(ops_async_poll(done, 1), 0);
+    g_group_fn(&w, -EEXIST, g_group_ctx);
+    assert_int_equal(ops_async_poll(done, 1), 1);
+    assert_ptr_equal(done[0].batch, &w);
+    assert_ptr_equal(done[0].ctx, (void*)0x7);
+    assert_int_equal(done[0].res, -EEXIST);
+    assert_int_equal(w.exec_calls, 0);
+
+    /* Writer stopped: a worker executes it */
+    g_group_rc = -ENOTCONN;
+    w.exec_rc  = 0;
+    assert_int_equal(ops_async_submit(&w, ut_cb, NULL), 0);
+    ut_wait_cb(1);
+    assert_int_equal(w.exec_calls, 1);
+    assert_int_equal(g_cb_fails, 0);
+
+    db_async_stats_t st;
+    ops_async_stats(&st);
+    assert_int_equal(st.writes, 2u);
+    assert_int_equal(st.reads, 0u);
+    assert_int_equal(st.failed, 1u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_async_start_stop_and_invalid_input, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_async_reads_run_on_workers_with_callbacks, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_async_completion_queue_signals_eventfd, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_async_depth_limits_inflight_and_unpolled, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_async_writes_go_to_group_writer_when_running,
+                                        ut_setup, ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,477 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_backup.h"
+#include "core/operations/ops_int/ops_map.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for the ops_map gate                                    */
+/* ------------------------------------------------------------------------- */
+
+/* ops_map is tested in its own UT suite; here only the gate is counted.
+ * The copy runs on a thread of the module: the hooks only record, the
+ * checks run on the main thread. */
+
+static atomic_int    g_enters     = 0;
+static atomic_int    g_leaves     = 0;
+static size_t        g_reserve    = 0; /* last size asked for */
+static int           g_reserve_rc = 0;
+static atomic_size_t g_deferred   = 0; /* growths the map put off */
+static atomic_size_t g_refused    = 0; /* MAP_FULL growths it refused */
+static atomic_int    g_long       = 0; /* long holds open */
+
+void ops_map_enter(void)
+{
+    atomic_fetch_add(&g_enters, 1);
+}
+
+void ops_map_leave(void)
+{
+    atomic_fetch_add(&g_leaves, 1);
+}
+
+void ops_map_enter_long(void)
+{
+    atomic_fetch_add(&g_long, 1);
+    ops_map_enter();
+}
+
+void ops_map_leave_long(void)
+{
+    ops_map_leave();
+    atomic_fetch_sub(&g_long, 1);
+}
+
+int ops_map_reserve(const size_t size)
+{
+    g_reserve = size;
+    return g_reserve_rc;
+}
+
+void ops_map_stats(db_map_stats_t* out)
+{
+    memset(out, 0, sizeof(*out));
+    out->deferred     = atomic_load(&g_deferred);
+    out->full_refused = atomic_load(&g_refused);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake copy                                                                 */
+/* ------------------------------------------------------------------------- */
+
+#define UT_PAGE 4096u
+
+static size_t     g_copy_size   = 0; /* bytes the fake copy writes, SIZE_MAX for endless */
+static int        g_copy_rc     = 0; /* returned once written */
+static unsigned   g_copy_flags  = 0; /* flags seen */
+static atomic_int g_copy_errno  = 0; /* errno of the write that failed */
+static size_t     g_copy_defers = 0; /* map growths put off while it runs */
+static size_t     g_copy_refuse = 0; /* MAP_FULL growths refused while it runs */
+
+static unsigned char ut_pattern(const size_t i)
+{
+    return (unsigned char)(i * 31u + 7u);
+}
+
+static int ut_copyfd2(MDB_env* env, mdb_filehandle_t fd, unsigned int flags)
+{
+    (void)env;
+    g_copy_flags = flags;
+    assert_int_equal(atomic_load(&g_long), 1);
+    atomic_fetch_add(&g_deferred, g_copy_defers);
+    atomic_fetch_add(&g_refused, g_copy_refuse);
+
+    unsigned char page[UT_PAGE];
+    for(size_t done = 0; done < g_copy_size; done += sizeof(page))
+    {
+        for(size_t i = 0; i < sizeof(page); i++) page[i] = ut_pattern(done + i);
+        if(write(fd, page, sizeof(page)) != (ssize_t)sizeof(page))
+        {
+            atomic_store(&g_copy_errno, errno);
+            return errno;
+        }
+    }
+    return g_copy_rc;
+}
+
+static atomic_int g_progress_calls = 0;
+static size_t     g_progress_last  = 0;
+
+static void ut_progress(size_t written, size_t total, void* ctx)
+{
+    (void)total;
+    (void)ctx;
+    g_progress_last = written;
+    atomic_fetch_add(&g_progress_calls, 1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake env for the page walk                                                */
+/* ------------------------------------------------------------------------- */
+
+static size_t g_last_pgno = 99u; /* 400 KiB of data */
+
+static int ut_env_info(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_mapsize   = 1u << 20;
+    info->me_last_pgno = g_last_pgno;
+    return MDB_SUCCESS;
+}
+
+static int ut_env_stat(MDB_env* env, MDB_stat* st)
+{
+    (void)env;
+    memset(st, 0, sizeof(*st));
+    st->ms_psize        = UT_PAGE;
+    st->ms_depth        = 2u;
+    st->ms_branch_pages = 1u;
+    st->ms_leaf_pages   = 3u;
+    return MDB_SUCCESS;
+}
+
+static int ut_stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* st)
+{
+    (void)txn;
+    (void)dbi;
+    memset(st, 0, sizeof(*st));
+    st->ms_leaf_pages     = 8u;
+    st->ms_overflow_pages = 2u;
+    st->ms_entries        = 50u;
+    return MDB_SUCCESS;
+}
+
+/* Two freelist records of 3 and 5 pages */
+static int ut_free_get(MDB_cursor* cur, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    (void)cur;
+    static size_t ids[2][6] = { { 3u, 10u, 11u, 12u }, { 5u, 20u, 21u, 22u, 23u, 24u } };
+    static int    pos       = 0;
+
+    pos = (op == MDB_FIRST) ? 0 : pos + 1;
+    if(pos > 1) return MDB_NOTFOUND;
+    key->mv_size  = sizeof(size_t);
+    key->mv_data  = &ids[pos][1];
+    data->mv_size = (ids[pos][0] + 1u) * sizeof(size_t);
+    data->mv_data = ids[pos];
+    return MDB_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[2];
+static FILE*      g_out = NULL;
+
+/* Bytes of the destination file, checked against the pattern */
+static size_t ut_out_check(void)
+{
+    unsigned char buf[UT_PAGE];
+    size_t        off = 0;
+    size_t        n;
+
+    rewind(g_out);
+    while((n = fread(buf, 1, sizeof(buf), g_out)) > 0)
+    {
+        for(size_t i = 0; i < n; i++)
+        {
+            if(buf[i] != ut_pattern(off + i)) return SIZE_MAX;
+        }
+        off += n;
+    }
+    return off;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    g_db.env             = (MDB_env*)0x90;
+    g_db.dbis            = g_dbis;
+    g_db.n_dbis          = 2u;
+    DataBase             = &g_db;
+    g_ut_mdb_env_copyfd2 = ut_copyfd2;
+    g_copy_size          = 0;
+    g_copy_rc            = 0;
+    g_copy_flags         = 0;
+    g_copy_defers        = 0;
+    g_copy_refuse        = 0;
+    g_last_pgno          = 99u;
+    g_reserve            = 0;
+    g_reserve_rc         = 0;
+    g_progress_last      = 0;
+    atomic_store(&g_copy_errno, 0);
+    atomic_store(&g_progress_calls, 0);
+    atomic_store(&g_enters, 0);
+    atomic_store(&g_leaves, 0);
+    atomic_store(&g_deferred, 0);
+    atomic_store(&g_refused, 0);
+    atomic_store(&g_long, 0);
+    g_out = tmpfile();
+    return g_out ? 0 : -1;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_backup_stop();
+    fclose(g_out);
+    DataBase = NULL;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_backup_start() / ops_backup_wait() tests                              */
+/* ------------------------------------------------------------------------- */
+
+static void test_backup_invalid_input_and_wait_without_start(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_backup_wait(), -ENOENT);
+    assert_int_equal(ops_backup_start(-1, NULL), -EINVAL);
+    assert_int_equal(ops_backup_start(fileno(g_out), &(db_backup_cfg_t){ .flags = 1u << 5 }),
+                     -EINVAL);
+
+    DataBase = NULL;
+    assert_int_equal(ops_backup_start(fileno(g_out), NULL), -EINVAL);
+    assert_int_equal(ops_backup_space(&(db_space_stats_t){ 0 }), -EINVAL);
+    assert_int_equal(ops_backup_wait(), -ENOENT);
+
+    db_backup_status_t st;
+    ops_backup_status(&st);
+    assert_int_equal(st.running, 0);
+    assert_int_equal(st.backups, 0u);
+}
+
+static void test_backup_space_walks_trees_and_freelist(void** state)
+{
+    (void)state;
+
+    g_ut_mdb_env_info   = ut_env_info;
+    g_ut_mdb_env_stat   = ut_env_stat;
+    g_ut_mdb_stat       = ut_stat;
+    g_ut_mdb_cursor_get = ut_free_get;
+
+    db_space_stats_t sp;
+    assert_int_equal(ops_backup_space(&sp), 0);
+    assert_int_equal(sp.page_size, UT_PAGE);
+    assert_int_equal(sp.map_size, 1u << 20);
+    assert_int_equal(sp.pages_last, 100u);
+    assert_int_equal(sp.pages_free, 8u);
+    assert_int_equal(sp.depth, 2u);
+    /* Main tree 4 pages, 10 per DBI */
+    assert_int_equal(sp.pages_tree, 24u);
+    assert_int_equal(sp.entries, 100u);
+    assert_int_equal(sp.compact_bytes, 26u * UT_PAGE);
+    assert_int_equal(atomic_load(&g_enters), atomic_load(&g_leaves));
+}
+
+static void test_backup_streams_copy_to_fd_with_progress(void** state)
+{
+    (void)state;
+
+    g_copy_size         = 64u * UT_PAGE;
+    db_backup_cfg_t cfg = { .flags = DB_BACKUP_COMPACT, .progress = ut_progress };
+    assert_int_equal(ops_backup_start(fileno(g_out), &cfg), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+
+    assert_int_equal(g_copy_flags, MDB_CP_COMPACT);
+    assert_int_equal(ut_out_check(), g_copy_size);
+    assert_true(atomic_load(&g_progress_calls) > 0);
+    assert_int_equal(g_progress_last, g_copy_size);
+
+    /* The copy holds off map resizes */
+    assert_true(atomic_load(&g_enters) >= 1);
+    assert_int_equal(atomic_load(&g_enters), atomic_load(&g_leaves));
+
+    db_backup_status_t st;
+    ops_backup_status(&st);
+    assert_int_equal(st.running, 0);
+    assert_int_equal(st.res, 0);
+    assert_int_equal(st.written, g_copy_size);
+    assert_true(st.backups >= 1u);
+
+    /* Waiting again gives the same result */
+    assert_int_equal(ops_backup_wait(), 0);
+}
+
+static void test_backup_grows_map_before_copy(void** state)
+{
+    (void)state;
+
+    /* 1 MiB map, 400 KiB of data, room to grow to 8 MiB */
+    g_ut_mdb_env_info       = ut_env_info;
+    g_ut_mdb_env_stat       = ut_env_stat;
+    g_ut_mdb_stat           = ut_stat;
+    g_ut_mdb_cursor_get     = ut_free_get;
+    g_db.map_size_bytes_max = 8u << 20;
+    g_copy_size             = 4u * UT_PAGE;
+    g_copy_defers           = 2u;
+    g_copy_refuse           = 1u;
+
+    assert_int_equal(ops_backup_start(fileno(g_out), &(db_backup_cfg_t){ .headroom = 1u << 20 }),
+                     0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, 100u * UT_PAGE + (1u << 20));
+
+    db_backup_status_t st;
+    ops_backup_status(&st);
+    assert_int_equal(st.reserved, 100u * UT_PAGE);
+    assert_int_equal(st.headroom, 1u << 20);
+    assert_int_equal(st.deferred, 2u);
+    assert_int_equal(st.refused, 1u);
+
+    /* The default headroom stops at the ceiling */
+    g_copy_defers = 0;
+    g_copy_refuse = 0;
+    assert_int_equal(ops_backup_start(fileno(g_out), NULL), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, 8u << 20);
+    ops_backup_status(&st);
+    assert_int_equal(st.reserved, (8u << 20) - (1u << 20));
+    assert_int_equal(st.headroom, (8u << 20) - 100u * UT_PAGE);
+    assert_int_equal(st.deferred, 0u);
+    assert_int_equal(st.refused, 0u);
+
+    /* A map that cannot grow does not stop the backup */
+    g_reserve_rc = -EBUSY;
+    assert_int_equal(ops_backup_start(fileno(g_out), NULL), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    ops_backup_status(&st);
+    assert_int_equal(st.reserved, 0u);
+    assert_int_equal(st.headroom, (1u << 20) - 100u * UT_PAGE);
+}
+
+static void test_backup_headroom_follows_the_throttle(void** state)
+{
+    (void)state;
+
+    /* 400 KiB of data, a ceiling far off */
+    g_ut_mdb_env_info       = ut_env_info;
+    g_ut_mdb_env_stat       = ut_env_stat;
+    g_ut_mdb_stat           = ut_stat;
+    g_ut_mdb_cursor_get     = ut_free_get;
+    g_db.map_size_bytes_max = SIZE_MAX;
+    g_copy_size             = UT_PAGE;
+
+    /* Unthrottled, or a copy shorter than DB_LMDB_BACKUP_HEADROOM_S: one headroom */
+    db_backup_cfg_t cfg = { 0 };
+    assert_int_equal(ops_backup_start(fileno(g_out), &cfg), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, 100u * UT_PAGE + DB_LMDB_BACKUP_HEADROOM);
+    cfg.rate_mb_s = 1u;
+    assert_int_equal(ops_backup_start(fileno(g_out), &cfg), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, 100u * UT_PAGE + DB_LMDB_BACKUP_HEADROOM);
+
+    /* 25 MiB at 1 MB/s: 25 s of copy, three headrooms */
+    const size_t used = 25u << 20;
+    g_last_pgno       = used / UT_PAGE - 1u;
+    assert_int_equal(ops_backup_start(fileno(g_out), &cfg), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, used + 3u * DB_LMDB_BACKUP_HEADROOM);
+
+    /* The same data at full speed: one */
+    cfg.rate_mb_s = 0u;
+    assert_int_equal(ops_backup_start(fileno(g_out), &cfg), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_reserve, used + DB_LMDB_BACKUP_HEADROOM);
+}
+
+static void test_backup_throttle_paces_writes(void** state)
+{
+    (void)state;
+
+    /* 256 KiB at 1 MB/s: about 250 ms */
+    g_copy_size = 64u * UT_PAGE;
+    assert_int_equal(ops_backup_start(fileno(g_out), &(db_backup_cfg_t){ .rate_mb_s = 1u }), 0);
+    assert_int_equal(ops_backup_wait(), 0);
+    assert_int_equal(g_copy_flags, 0u);
+
+    db_backup_status_t st;
+    ops_backup_status(&st);
+    assert_int_equal(st.written, g_copy_size);
+    assert_true(st.elapsed_ms >= 200u);
+}
+
+static void test_backup_stop_cancels_running_copy(void** state)
+{
+    (void)state;
+
+    g_copy_size = SIZE_MAX;
+    assert_int_equal(ops_backup_start(fileno(g_out), &(db_backup_cfg_t){ .rate_mb_s = 1u }), 0);
+    assert_int_equal(ops_backup_start(fileno(g_out), NULL), -EALREADY);
+
+    db_backup_status_t st;
+    ops_backup_status(&st);
+    assert_int_equal(st.running, 1);
+
+    ops_backup_stop();
+    assert_int_equal(ops_backup_wait(), -ECANCELED);
+    assert_int_equal(atomic_load(&g_copy_errno), EPIPE);
+    assert_int_equal(atomic_load(&g_enters), atomic_load(&g_leaves));
+
+    ops_backup_status(&st);
+    assert_int_equal(st.running, 0);
+    assert_int_equal(st.res, -ECANCELED);
+}
+
+static void test_backup_reports_write_and_copy_errors(void** state)
+{
+    (void)state;
+
+    /* Destination not writable */
+    int ro = open("/dev/null", O_RDONLY);
+    assert_true(ro >= 0);
+    g_copy_size = 4u * UT_PAGE;
+    assert_int_equal(ops_backup_start(ro, NULL), 0);
+    assert_int_equal(ops_backup_wait(), -EBADF);
+    close(ro);
+
+    /* Copy failing once written */
+    g_copy_rc = ENOSPC;
+    assert_int_equal(ops_backup_start(fileno(g_out), NULL), 0);
+    assert_int_equal(ops_backup_wait(), -ENOSPC);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_backup_invalid_input_and_wait_without_start, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_space_walks_trees_and_freelist, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_streams_copy_to_fd_with_progress, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_grows_map_before_copy, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_headroom_follows_the_throttle, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_throttle_paces_writes, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_stop_cancels_running_copy, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_backup_reports_write_and_copy_errors, ut_setup,
+                                        ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
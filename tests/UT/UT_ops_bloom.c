@@ -0,0 +1,311 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/db/dbi_int.h"
+#include "core/operations/ops_int/ops_bloom.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[2];
+static char       g_dir[64];
+
+/* Fake env: last txn id, key count and keys of DBI 0 */
+static const char* g_keys[] = { "dev1", "dev2", "dev3" };
+static size_t      g_key_at;
+static size_t      g_txnid;
+static size_t      g_scans;
+static int         g_cursor_rc;
+
+static const char* const g_names[] = { "devices", "log" };
+static const dbi_type_t  g_types[] = { DBI_TYPE_BLOOM, DBI_TYPE_DEFAULT };
+
+static int ut_env_info(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_last_txnid = g_txnid;
+    return MDB_SUCCESS;
+}
+
+static int ut_stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* st)
+{
+    (void)txn;
+    memset(st, 0, sizeof(*st));
+    st->ms_entries = dbi == 1 ? sizeof(g_keys) / sizeof(g_keys[0]) : 0;
+    return MDB_SUCCESS;
+}
+
+static int ut_cursor_get(MDB_cursor* cur, MDB_val* k, MDB_val* v, MDB_cursor_op op)
+{
+    (void)cur;
+    (void)v;
+    if(g_cursor_rc != MDB_SUCCESS) return g_cursor_rc;
+    if(op == MDB_FIRST)
+    {
+        g_key_at = 0;
+        g_scans++;
+    }
+    else
+    {
+        assert_int_equal(op, MDB_NEXT_NODUP);
+    }
+    if(g_key_at == sizeof(g_keys) / sizeof(g_keys[0])) return MDB_NOTFOUND;
+
+    k->mv_data = (void*)g_keys[g_key_at];
+    k->mv_size = strlen(g_keys[g_key_at++]);
+    return MDB_SUCCESS;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    g_ut_mdb_env_info   = ut_env_info;
+    g_ut_mdb_stat       = ut_stat;
+    g_ut_mdb_cursor_get = ut_cursor_get;
+    g_txnid             = 7;
+    g_scans             = 0;
+    g_cursor_rc         = MDB_SUCCESS;
+
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    g_dbis[0].dbi = 1;
+    g_dbis[1].dbi = 2;
+    g_db.env      = (MDB_env*)0x1;
+    g_db.dbis     = g_dbis;
+    g_db.n_dbis   = 2;
+    DataBase      = &g_db;
+
+    snprintf(g_dir, sizeof(g_dir), "/tmp/ut_bloom_XXXXXX");
+    assert_non_null(mkdtemp(g_dir));
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_bloom_close();
+
+    char file[128];
+    snprintf(file, sizeof(file), "%s/devices.bloom", g_dir);
+    unlink(file);
+    rmdir(g_dir);
+
+    DataBase = NULL;
+    ut_reset_lmdb_stubs();
+    return 0;
+}
+
+static int ut_maybe(const unsigned dbi, const char* key)
+{
+    return ops_bloom_maybe(dbi, key, strlen(key));
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_bloom_open() tests                                                    */
+/* ------------------------------------------------------------------------- */
+
+static void test_bloom_open_without_bloom_dbis_is_noop(void** state)
+{
+    (void)state;
+
+    const dbi_type_t plain[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+    assert_int_equal(ops_bloom_open(g_dir, g_names, plain, 2), 0);
+    assert_int_equal(g_scans, 0u);
+
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), -ENOENT);
+    assert_true(ut_maybe(0, "absent"));
+}
+
+static void test_bloom_scan_keeps_keys_and_rules_out_others(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    assert_int_equal(g_scans, 1u);
+
+    assert_true(ut_maybe(0, "dev1"));
+    assert_true(ut_maybe(0, "dev2"));
+    assert_true(ut_maybe(0, "dev3"));
+
+    /* Three keys in a filter sized for thousands: no false positive expected */
+    unsigned passed = 0;
+    char     key[16];
+    for(unsigned i = 0; i < 1000; i++)
+    {
+        snprintf(key, sizeof(key), "other%u", i);
+        passed += ut_maybe(0, key) != 0;
+    }
+    assert_true(passed <= 2);
+
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.keys, 3u);
+    assert_int_equal(st.capacity, DB_LMDB_BLOOM_MIN_KEYS);
+    assert_true(st.bits >= st.capacity * DB_LMDB_BLOOM_BITS_PER_KEY);
+    assert_int_equal(st.loaded, 0);
+    assert_int_equal(st.saturated, 0);
+#if DB_LMDB_METRICS
+    assert_int_equal(st.negatives, 1000u - passed);
+#endif
+
+    /* DBI 1 has no filter */
+    assert_true(ut_maybe(1, "anything"));
+    assert_int_equal(ops_bloom_stats(1, &st), -ENOENT);
+}
+
+static void test_bloom_scan_error_fails_open(void** state)
+{
+    (void)state;
+
+    g_cursor_rc = MDB_PANIC;
+    assert_true(ops_bloom_open(g_dir, g_names, g_types, 2) < 0);
+
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), -ENOENT);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_bloom_add() tests                                                     */
+/* ------------------------------------------------------------------------- */
+
+static void test_bloom_add_then_maybe(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    ops_bloom_add(0, "dev4", 4);
+    ops_bloom_add(0, "dev4", 4);
+    assert_true(ut_maybe(0, "dev4"));
+
+    /* No filter, nothing to do */
+    ops_bloom_add(1, "dev4", 4);
+
+    ops_bloom_false_positive(0);
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.keys, 4u);
+#if DB_LMDB_METRICS
+    assert_int_equal(st.false_positives, 1u);
+#endif
+}
+
+static void test_bloom_saturates_past_capacity(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    char key[16];
+    for(unsigned i = 0; i < 4 * DB_LMDB_BLOOM_MIN_KEYS; i++)
+    {
+        snprintf(key, sizeof(key), "k%u", i);
+        ops_bloom_add(0, key, strlen(key));
+    }
+
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.saturated, 1);
+    assert_true(ut_maybe(0, "never-added"));
+
+    /* Not worth keeping: no sidecar */
+    ops_bloom_close();
+    char file[128];
+    snprintf(file, sizeof(file), "%s/devices.bloom", g_dir);
+    assert_int_not_equal(access(file, F_OK), 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Sidecar tests                                                             */
+/* ------------------------------------------------------------------------- */
+
+static void test_bloom_sidecar_round_trip(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    ops_bloom_add(0, "dev4", 4);
+    ops_bloom_close();
+
+    /* Same txn id and key count: loaded, no scan */
+    g_scans = 0;
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    assert_int_equal(g_scans, 0u);
+    assert_true(ut_maybe(0, "dev1"));
+    assert_true(ut_maybe(0, "dev4"));
+
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.loaded, 1);
+    assert_int_equal(st.keys, 4u);
+}
+
+static void test_bloom_sidecar_stale_or_corrupt_rescans(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    ops_bloom_close();
+
+    /* A commit happened since the save */
+    g_txnid = 8;
+    g_scans = 0;
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    assert_int_equal(g_scans, 1u);
+    db_bloom_stats_t st;
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.loaded, 0);
+    ops_bloom_close();
+
+    /* Flip a filter byte */
+    char file[128];
+    snprintf(file, sizeof(file), "%s/devices.bloom", g_dir);
+    FILE* f = fopen(file, "r+b");
+    assert_non_null(f);
+    assert_int_equal(fseek(f, -1, SEEK_END), 0);
+    const int c = fgetc(f);
+    assert_int_equal(fseek(f, -1, SEEK_END), 0);
+    fputc(c ^ 0xff, f);
+    fclose(f);
+
+    g_scans = 0;
+    assert_int_equal(ops_bloom_open(g_dir, g_names, g_types, 2), 0);
+    assert_int_equal(g_scans, 1u);
+    assert_int_equal(ops_bloom_stats(0, &st), 0);
+    assert_int_equal(st.loaded, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_bloom_open_without_bloom_dbis_is_noop, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_scan_keeps_keys_and_rules_out_others,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_scan_error_fails_open, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_add_then_maybe, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_saturates_past_capacity, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_sidecar_round_trip, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_bloom_sidecar_stale_or_corrupt_rescans, ut_setup,
+                                        ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
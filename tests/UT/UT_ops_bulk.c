@@ -0,0 +1,338 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_bulk.h"
+#include "core/operations/ops_int/ops_exec.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for ops_exec layer                                      */
+/* ------------------------------------------------------------------------- */
+
+/* ops_exec is tested in its own UT suite; here a fixed-size fake batch
+ * records what the loader queues and what each exec would commit. */
+
+#define UT_BULK_MAX_OPS 16u
+
+struct ops_batch
+{
+    op_t   ops[UT_BULK_MAX_OPS];
+    size_t n_ops;
+    size_t max_ops;
+    int    sorted;
+};
+
+static struct ops_batch g_batch;
+static int              g_exec_rc    = 0;
+static size_t           g_exec_calls = 0;
+static size_t           g_exec_sizes[8];
+static char             g_exec_first_key[8][8]; /* First key bytes of each chunk */
+
+batch_t* ops_batch_create(void)
+{
+    memset(&g_batch, 0, sizeof(g_batch));
+    return &g_batch;
+}
+
+void ops_batch_destroy(batch_t* batch)
+{
+    (void)batch;
+}
+
+int ops_batch_set_sorted(batch_t* batch, const int enable)
+{
+    batch->sorted = enable;
+    return 0;
+}
+
+int ops_batch_set_max_ops(batch_t* batch, const size_t max_ops)
+{
+    batch->max_ops = max_ops;
+    return 0;
+}
+
+op_t* ops_get_next_op(batch_t* batch)
+{
+    if(batch->n_ops >= UT_BULK_MAX_OPS || batch->n_ops >= batch->max_ops) return NULL;
+    return &batch->ops[batch->n_ops];
+}
+
+int ops_add_operation(batch_t* batch, const op_t* operation)
+{
+    assert_ptr_equal(operation, &batch->ops[batch->n_ops]);
+    batch->n_ops++;
+    return 0;
+}
+
+int ops_execute_operations(batch_t* batch)
+{
+    if(g_exec_calls < 8)
+    {
+        const op_t* op = &batch->ops[0];
+        size_t      n  = op->key.present.size < 7 ? op->key.present.size : 7;
+        memcpy(g_exec_first_key[g_exec_calls], op->key.present.ptr, n);
+        g_exec_first_key[g_exec_calls][n] = '\0';
+        g_exec_sizes[g_exec_calls]        = batch->n_ops;
+    }
+    g_exec_calls++;
+    batch->n_ops = 0;
+    return g_exec_rc;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+
+static size_t g_set_mapsize_calls = 0;
+static size_t g_set_mapsize_last  = 0;
+
+static int ut_env_info_small(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_mapsize   = 4u * 4096u;
+    info->me_last_pgno = 2u; /* 3 pages in use */
+    return MDB_SUCCESS;
+}
+
+static int ut_set_mapsize_record(MDB_env* env, size_t size)
+{
+    (void)env;
+    g_set_mapsize_calls++;
+    g_set_mapsize_last = size;
+    return MDB_SUCCESS;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_exec_sizes, 0, sizeof(g_exec_sizes));
+    memset(g_exec_first_key, 0, sizeof(g_exec_first_key));
+    g_exec_rc           = 0;
+    g_exec_calls        = 0;
+    g_set_mapsize_calls = 0;
+    g_set_mapsize_last  = 0;
+    DataBase            = NULL;
+    return 0;
+}
+
+static void ut_put_str(bulk_t* bulk, const char* key, const char* val, int expected)
+{
+    assert_int_equal(ops_bulk_put(bulk, 0u, key, strlen(key), val, strlen(val)), expected);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_bulk_put() / ops_bulk_flush() tests                                   */
+/* ------------------------------------------------------------------------- */
+
+static void test_bulk_commits_every_n_records(void** state)
+{
+    (void)state;
+
+    db_bulk_cfg_t cfg  = { .commit_records = 3u, .commit_bytes = 1u << 20 };
+    bulk_t*       bulk = ops_bulk_create(&cfg);
+    assert_non_null(bulk);
+    assert_true(g_batch.sorted);
+    assert_int_equal(g_batch.max_ops, 3u);
+
+    const char* keys[] = { "k0", "k1", "k2", "k3", "k4", "k5", "k6" };
+    for(size_t i = 0; i < 7u; i++)
+    {
+        ut_put_str(bulk, keys[i], "value", 0);
+    }
+    assert_int_equal(g_exec_calls, 2u);
+    assert_int_equal(g_batch.n_ops, 1u);
+
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0); /* Nothing pending: no exec */
+    assert_int_equal(g_exec_calls, 3u);
+    assert_int_equal(g_exec_sizes[0], 3u);
+    assert_int_equal(g_exec_sizes[1], 3u);
+    assert_int_equal(g_exec_sizes[2], 1u);
+
+    db_bulk_stats_t st;
+    ops_bulk_stats(bulk, &st);
+    assert_int_equal(st.records, 7u);
+    assert_int_equal(st.bytes, 7u * 7u);
+    assert_int_equal(st.commits, 3u);
+    assert_true(st.seconds >= 0.0);
+
+    ops_bulk_destroy(bulk);
+}
+
+static void test_bulk_commits_on_byte_threshold(void** state)
+{
+    (void)state;
+
+    db_bulk_cfg_t cfg  = { .commit_records = 16u, .commit_bytes = 20u };
+    bulk_t*       bulk = ops_bulk_create(&cfg);
+    assert_non_null(bulk);
+
+    /* 10 bytes per record: the second one reaches the threshold */
+    ut_put_str(bulk, "key0", "val000", 0);
+    assert_int_equal(g_exec_calls, 0u);
+    ut_put_str(bulk, "key1", "val001", 0);
+    assert_int_equal(g_exec_calls, 1u);
+    assert_int_equal(g_exec_sizes[0], 2u);
+
+    ops_bulk_destroy(bulk);
+}
+
+static void test_bulk_copies_caller_buffers(void** state)
+{
+    (void)state;
+
+    db_bulk_cfg_t cfg  = { .commit_records = 2u, .commit_bytes = 0u };
+    bulk_t*       bulk = ops_bulk_create(&cfg);
+    assert_non_null(bulk);
+
+    char key[8];
+    strcpy(key, "first");
+    ut_put_str(bulk, key, "v", 0);
+    strcpy(key, "other"); /* Caller reuses its buffer before the flush */
+    ut_put_str(bulk, key, "v", 0);
+
+    assert_int_equal(g_exec_calls, 1u);
+    assert_string_equal(g_exec_first_key[0], "first");
+
+    /* After the flush the arena is rewound and reused for the next chunk */
+    strcpy(key, "third");
+    ut_put_str(bulk, key, "v", 0);
+    strcpy(key, "xxxxx");
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_string_equal(g_exec_first_key[1], "third");
+
+    ops_bulk_destroy(bulk);
+}
+
+static void test_bulk_rejects_invalid_input(void** state)
+{
+    (void)state;
+
+    bulk_t* bulk = ops_bulk_create(NULL);
+    assert_non_null(bulk);
+
+    assert_int_equal(ops_bulk_put(NULL, 0u, "k", 1u, "v", 1u), -EINVAL);
+    assert_int_equal(ops_bulk_put(bulk, 0u, NULL, 1u, "v", 1u), -EINVAL);
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k", 0u, "v", 1u), -EINVAL);
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k", 1u, "v", 0u), -EINVAL);
+    assert_int_equal(ops_bulk_flush(NULL), -EINVAL);
+    assert_int_equal(g_batch.n_ops, 0u);
+
+    /* Defaults from config.h */
+    assert_int_equal(g_batch.max_ops, DB_LMDB_BULK_COMMIT_RECORDS);
+
+    ops_bulk_destroy(bulk);
+    ops_bulk_destroy(NULL);
+}
+
+static void test_bulk_failed_chunk_is_dropped(void** state)
+{
+    (void)state;
+
+    db_bulk_cfg_t cfg  = { .commit_records = 2u, .commit_bytes = 0u };
+    bulk_t*       bulk = ops_bulk_create(&cfg);
+    assert_non_null(bulk);
+
+    ut_put_str(bulk, "a", "1", 0);
+    ut_put_str(bulk, "b", "2", 0);
+
+    g_exec_rc = -EIO;
+    ut_put_str(bulk, "c", "3", 0);
+    ut_put_str(bulk, "d", "4", -EIO);
+
+    /* The loader keeps working after a failed chunk */
+    g_exec_rc = 0;
+    ut_put_str(bulk, "e", "5", 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+
+    db_bulk_stats_t st;
+    ops_bulk_stats(bulk, &st);
+    assert_int_equal(st.records, 3u);
+    assert_int_equal(st.commits, 2u);
+    assert_int_equal(g_exec_calls, 3u);
+
+    ops_bulk_destroy(bulk);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Map pre-growth tests                                                      */
+/* ------------------------------------------------------------------------- */
+
+static void test_bulk_pregrow_doubles_map_up_to_max(void** state)
+{
+    (void)state;
+
+    g_db.env                = (MDB_env*)0x1;
+    g_db.map_size_bytes_max = 1u << 20;
+    DataBase                = &g_db;
+    g_ut_mdb_env_info       = ut_env_info_small;
+    g_ut_mdb_env_set_mapsize = ut_set_mapsize_record;
+
+    db_bulk_cfg_t cfg  = { .commit_records = 16u, .commit_bytes = 0u };
+    bulk_t*       bulk = ops_bulk_create(&cfg);
+    assert_non_null(bulk);
+
+    /* Small chunk: 3 pages used + 2 * (2 + 16) bytes fits in 16 KiB */
+    ut_put_str(bulk, "k", "v", 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_int_equal(g_set_mapsize_calls, 0u);
+
+    /* 3 pages + 2 * (2 * 5000 + 2 * 16) needs 32 KiB */
+    char big[5000];
+    memset(big, 'x', sizeof(big));
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k1", 2u, big, sizeof(big) - 2u), 0);
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k2", 2u, big, sizeof(big) - 2u), 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_int_equal(g_set_mapsize_calls, 1u);
+    assert_int_equal(g_set_mapsize_last, 8u * 4096u);
+
+    /* The max caps the growth */
+    g_db.map_size_bytes_max = 6u * 4096u;
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k3", 2u, big, sizeof(big) - 2u), 0);
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k4", 2u, big, sizeof(big) - 2u), 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_int_equal(g_set_mapsize_calls, 2u);
+    assert_int_equal(g_set_mapsize_last, 6u * 4096u);
+
+    /* Already at the max: no resize, the chunk is still executed */
+    g_db.map_size_bytes_max = 4u * 4096u;
+    assert_int_equal(ops_bulk_put(bulk, 0u, "k5", 2u, big, sizeof(big) - 2u), 0);
+    assert_int_equal(ops_bulk_flush(bulk), 0);
+    assert_int_equal(g_set_mapsize_calls, 2u);
+
+    db_bulk_stats_t st;
+    ops_bulk_stats(bulk, &st);
+    assert_int_equal(st.map_grows, 2u);
+    assert_int_equal(st.commits, 4u);
+
+    ops_bulk_destroy(bulk);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(test_bulk_commits_every_n_records, ut_setup),
+        cmocka_unit_test_setup(test_bulk_commits_on_byte_threshold, ut_setup),
+        cmocka_unit_test_setup(test_bulk_copies_caller_buffers, ut_setup),
+        cmocka_unit_test_setup(test_bulk_rejects_invalid_input, ut_setup),
+        cmocka_unit_test_setup(test_bulk_failed_chunk_is_dropped, ut_setup),
+        cmocka_unit_test_setup(test_bulk_pregrow_doubles_map_up_to_max, ut_setup),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
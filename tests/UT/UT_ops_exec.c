@@ -2,6 +2,7 @@
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -14,11 +15,11 @@
 /* Under-test implementation                                                 */
 /* ------------------------------------------------------------------------- */
 
-/* Pull in the implementation with static stripped so we can call internal
- * helpers such as _exec_op and _rw_cache_alloc directly. */
-#define static
+/* Pull in the implementation so the tests can call internal helpers such
+ * as _exec_op and _rw_cache_alloc directly: they share this unit. */
+#include "app/src/core/operations/ops_int/ops_arena.c"
+#undef LOG_TAG
 #include "app/src/core/operations/ops_int/ops_exec.c"
-#undef static
 
 /* ------------------------------------------------------------------------- */
 /* Lightweight stubs for ops_actions layer                                   */
@@ -38,24 +39,128 @@ db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, in
     return DB_SAFETY_SUCCESS;
 }
 
+/* Commits left that end in MDB_MAP_FULL (security_check: RETRY, -ENOSPC) */
+static int g_commit_full = 0;
+
 db_security_ret_code_t act_txn_commit(MDB_txn* const txn, int* const out_err)
 {
     (void)txn;
+    if(g_commit_full > 0)
+    {
+        g_commit_full--;
+        if(out_err) *out_err = -ENOSPC;
+        return DB_SAFETY_RETRY;
+    }
     if(out_err) *out_err = 0;
     return DB_SAFETY_SUCCESS;
 }
 
+static MDB_txn* g_nested_parent = NULL;
+
+db_security_ret_code_t act_txn_nested_begin(MDB_txn* parent, MDB_txn** out_txn,
+                                            int* const out_err)
+{
+    g_nested_parent = parent;
+    if(out_txn) *out_txn = (MDB_txn*)0x510;
+    if(out_err) *out_err = 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_txn_ro_begin(MDB_txn** out_txn, int* const out_err)
+{
+    return act_txn_begin(out_txn, MDB_RDONLY, out_err);
+}
+
+static int g_ro_end_calls = 0;
+
+void act_txn_ro_end(MDB_txn* txn)
+{
+    (void)txn;
+    g_ro_end_calls++;
+}
+
+/* Execution log of PUTs: key, value and '+' (append) '*' (appenddup) or '.' */
+static char   g_put_log[64];
+static size_t g_put_log_len = 0;
+static int    g_after_last  = 0;
+
+static void ut_log_put(const op_t* op, const char mark)
+{
+    if(op->key.kind != OP_KEY_KIND_PRESENT || op->val.kind != OP_KEY_KIND_PRESENT) return;
+    if(g_put_log_len + 3 >= sizeof(g_put_log)) return;
+    g_put_log[g_put_log_len++] = *(const char*)op->key.present.ptr;
+    g_put_log[g_put_log_len++] = *(const char*)op->val.present.ptr;
+    g_put_log[g_put_log_len++] = mark;
+    g_put_log[g_put_log_len]   = '\0';
+}
+
+/* The g_put_retry_at-th act_put call (from 1) fails once with a retryable error */
+static int g_put_calls    = 0;
+static int g_put_retry_at = 0;
+
 db_security_ret_code_t act_put(MDB_txn* txn, op_t* op, int* const out_err)
 {
     (void)txn;
-    (void)op;
+    ut_log_put(op, '.');
+    if(++g_put_calls == g_put_retry_at)
+    {
+        if(out_err) *out_err = -EAGAIN;
+        return DB_SAFETY_RETRY;
+    }
     if(out_err) *out_err = (g_next_put_rc == DB_SAFETY_FAIL) ? -EIO : 0;
     return g_next_put_rc;
 }
 
-db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
+db_security_ret_code_t act_put_append(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                      int* const out_err)
 {
     (void)txn;
+    assert_non_null(cur);
+    ut_log_put(op, (op->flags & OP_FLAG_APPENDDUP) ? '*' : '+');
+    if(out_err) *out_err = 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+int act_put_cmp(MDB_txn* txn, const op_t* a, const op_t* b)
+{
+    /* One byte keys and values, every DBI treated as DUPSORT */
+    (void)txn;
+    if(a->dbi != b->dbi) return (a->dbi < b->dbi) ? -2 : 2;
+    int c = *(const char*)a->key.present.ptr - *(const char*)b->key.present.ptr;
+    if(c) return (c < 0) ? -2 : 2;
+    c = *(const char*)a->val.present.ptr - *(const char*)b->val.present.ptr;
+    return (c > 0) - (c < 0);
+}
+
+db_security_ret_code_t act_put_after_last(MDB_txn* txn, const op_t* op, MDB_cursor** cur,
+                                          int* const out_after, int* const out_err)
+{
+    (void)txn;
+    (void)op;
+    (void)cur;
+    *out_after = g_after_last;
+    if(out_err) *out_err = 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_del(MDB_txn* txn, op_t* op, int* const out_err)
+{
+    (void)txn;
+    (void)op;
+    if(out_err) *out_err = 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+/* Val kind each act_get call was handed */
+static op_key_kind_t g_get_in_kind[4];
+static size_t        g_get_calls = 0;
+
+db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, ops_arena_t* arena, int* const out_err)
+{
+    (void)txn;
+    (void)arena;
+    if(g_get_calls < 4u) g_get_in_kind[g_get_calls] = op->val.kind;
+    g_get_calls++;
     if(out_err) *out_err = (g_next_get_rc == DB_SAFETY_FAIL) ? -EIO : 0;
 
     if(g_next_get_rc == DB_SAFETY_SUCCESS)
@@ -74,16 +179,294 @@ db_security_ret_code_t act_get(MDB_txn* txn, op_t* op, int* const out_err)
     return g_next_get_rc;
 }
 
+static MDB_cursor** g_last_lst_cur = NULL;
+
+db_security_ret_code_t act_lst(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err)
+{
+    /* Same cursor handling as the real act_lst: open only when missing */
+    g_last_lst_cur = cur;
+    if(out_err) *out_err = 0;
+    if(!*cur && mdb_cursor_open(txn, (MDB_dbi)op->dbi, cur) != MDB_SUCCESS) return DB_SAFETY_FAIL;
+    return DB_SAFETY_SUCCESS;
+}
+
+static int g_multi_calls = 0;
+
+db_security_ret_code_t act_get_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err)
+{
+    g_multi_calls++;
+    if(out_err) *out_err = 0;
+    if(!*cur && mdb_cursor_open(txn, (MDB_dbi)op->dbi, cur) != MDB_SUCCESS) return DB_SAFETY_FAIL;
+    op->multi->n_items = 1u;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_put_multiple(MDB_txn* txn, op_t* op, MDB_cursor** cur,
+                                        int* const out_err)
+{
+    g_multi_calls++;
+    if(out_err) *out_err = 0;
+    if(!*cur && mdb_cursor_open(txn, (MDB_dbi)op->dbi, cur) != MDB_SUCCESS) return DB_SAFETY_FAIL;
+    return DB_SAFETY_SUCCESS;
+}
+
+static int g_reserve_calls = 0;
+static int g_rep_calls     = 0;
+
+db_security_ret_code_t act_put_reserve(MDB_txn* txn, op_t* op, int* const out_err)
+{
+    (void)txn;
+    (void)op;
+    g_reserve_calls++;
+    if(out_err) *out_err = 0;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_rep(MDB_txn* txn, op_t* op, MDB_cursor** cur, int* const out_err)
+{
+    g_rep_calls++;
+    if(out_err) *out_err = 0;
+    if(!*cur && mdb_cursor_open(txn, (MDB_dbi)op->dbi, cur) != MDB_SUCCESS) return DB_SAFETY_FAIL;
+    return DB_SAFETY_SUCCESS;
+}
+
+/* Key descriptors of these tests are all present ones */
+MDB_val* act_op_key(op_t* op)
+{
+    return op->key.kind == OP_KEY_KIND_PRESENT ? (MDB_val*)&op->key.present : NULL;
+}
+
+MDB_val* act_op_val(op_t* op)
+{
+    return op->val.kind == OP_KEY_KIND_PRESENT ? (MDB_val*)&op->val.present : NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for the cache, filter, index and TTL layers             */
+/* ------------------------------------------------------------------------- */
+
+/* Write windows left open, reads always miss */
+static int g_cache_writes = 0;
+
+void ops_vcache_read_begin(void)
+{
+}
+
+void ops_vcache_read_end(void)
+{
+}
+
+int ops_vcache_get(const unsigned dbi, const void* key, const size_t key_size, void* dst,
+                   size_t* inout_size, const int count_miss)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+    (void)dst;
+    (void)inout_size;
+    (void)count_miss;
+    return -ENOENT;
+}
+
+void ops_vcache_write_begin(const unsigned dbi)
+{
+    (void)dbi;
+    g_cache_writes++;
+}
+
+void ops_vcache_write_end(const unsigned dbi, const void* key, const size_t key_size)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+    g_cache_writes--;
+}
+
+int ops_bloom_maybe(const unsigned dbi, const void* key, const size_t key_size)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+    return 1;
+}
+
+unsigned ops_index_targets(const unsigned dbi)
+{
+    (void)dbi;
+    return 0u;
+}
+
+db_security_ret_code_t ops_index_before(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                        ops_index_keys_t* old, int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)old;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_index_after(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                       const MDB_val* val, const ops_index_keys_t* old,
+                                       int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)val;
+    (void)old;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+/* TTL keys stay off: no queue */
+int ops_ttl_queue(void)
+{
+    return -1;
+}
+
+uint64_t ops_ttl_now_ms(void)
+{
+    return 0u;
+}
+
+int ops_ttl_armed(const unsigned dbi)
+{
+    (void)dbi;
+    return 0;
+}
+
+db_security_ret_code_t ops_ttl_arm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                   const uint64_t expires, int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)expires;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_ttl_disarm(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                      int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_ttl_disarm_del(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                          int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_ttl_disarm_range(MDB_txn* txn, const unsigned dbi,
+                                            const MDB_val* start, const MDB_val* end,
+                                            int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)start;
+    (void)end;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for ops_map layer                                       */
+/* ------------------------------------------------------------------------- */
+
+/* Gate depth of the test thread, and where growth was asked from */
+static int g_map_depth       = 0;
+static int g_map_full_calls  = 0;
+static int g_map_full_depth  = -1;
+static int g_map_full_rc     = 0;
+static int g_map_after_calls = 0;
+
+void ops_map_enter(void)
+{
+    g_map_depth++;
+}
+
+void ops_map_leave(void)
+{
+    g_map_depth--;
+}
+
+int ops_map_held(void)
+{
+    return g_map_depth != 0;
+}
+
+void ops_map_after_commit(void)
+{
+    assert_int_equal(g_map_depth, 0);
+    g_map_after_calls++;
+}
+
+int ops_map_on_full(const unsigned attempt)
+{
+    (void)attempt;
+    g_map_full_calls++;
+    g_map_full_depth = g_map_depth;
+    return g_map_full_rc;
+}
+
 /* ------------------------------------------------------------------------- */
 /* Helpers                                                                   */
 /* ------------------------------------------------------------------------- */
 
+static void ut_add_put(batch_t* batch, const char* key, const char* val)
+{
+    op_t* op = ops_get_next_op(batch);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_PUT;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)key;
+    op->key.present.size = 1u;
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = (void*)val;
+    op->val.present.size = 1u;
+    assert_int_equal(ops_add_operation(batch, op), 0);
+}
+
 static void ut_reset_all(void)
 {
     ut_reset_lmdb_stubs();
-    memset(&ops_cache, 0, sizeof(ops_cache));
+    ops_batch_destroy(&ops_cache);
+    (void)ops_set_batch_max_ops(DB_LMDB_BATCH_OPS_MAX);
     g_next_put_rc = DB_SAFETY_SUCCESS;
     g_next_get_rc = DB_SAFETY_SUCCESS;
+    g_ro_end_calls  = 0;
+    g_last_lst_cur  = NULL;
+    g_multi_calls   = 0;
+    g_reserve_calls = 0;
+    g_rep_calls     = 0;
+    g_nested_parent = NULL;
+    g_put_log_len   = 0;
+    g_put_log[0]    = '\0';
+    g_after_last    = 0;
+    g_commit_full   = 0;
+    g_put_calls     = 0;
+    g_put_retry_at  = 0;
+    g_get_calls     = 0;
+
+    g_map_depth       = 0;
+    g_map_full_calls  = 0;
+    g_map_full_depth  = -1;
+    g_map_full_rc     = 0;
+    g_map_after_calls = 0;
+    g_cache_writes    = 0;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -96,8 +479,8 @@ static void test_rw_cache_alloc_zero_size_returns_null(void** state)
 
     ut_reset_all();
 
-    assert_null(_rw_cache_alloc(0u));
-    assert_int_equal(ops_cache.rw_cache_used, 0u);
+    assert_null(_rw_cache_alloc(&ops_cache, 0u));
+    assert_int_equal(ops_cache.rw_cache.used, 0u);
 }
 
 static void test_rw_cache_alloc_within_capacity_advances_offset(void** state)
@@ -106,26 +489,38 @@ static void test_rw_cache_alloc_within_capacity_advances_offset(void** state)
 
     ut_reset_all();
 
-    void* p1 = _rw_cache_alloc(16u);
+    void* p1 = _rw_cache_alloc(&ops_cache, 16u);
     assert_non_null(p1);
-    assert_int_equal(ops_cache.rw_cache_used, 16u);
+    assert_int_equal(ops_cache.rw_cache.used, 16u);
 
-    void* p2 = _rw_cache_alloc(32u);
+    void* p2 = _rw_cache_alloc(&ops_cache, 32u);
     assert_non_null(p2);
     assert_true((char*)p2 > (char*)p1);
-    assert_int_equal(ops_cache.rw_cache_used, 48u);
+    assert_int_equal(ops_cache.rw_cache.used, 48u);
 }
 
-static void test_rw_cache_alloc_beyond_capacity_fails(void** state)
+static void test_rw_cache_alloc_beyond_slab_size_grows(void** state)
 {
     (void)state;
 
     ut_reset_all();
 
-    ops_cache.rw_cache_used = DB_LMDB_RW_OPS_CACHE_SIZE - 4u;
-    void* p = _rw_cache_alloc(8u);
-    assert_null(p);
-    assert_int_equal(ops_cache.rw_cache_used, DB_LMDB_RW_OPS_CACHE_SIZE - 4u);
+    /* Two ~1 KiB values plus a third one no longer fit in one slab. */
+    void* p1 = _rw_cache_alloc(&ops_cache, 1000u);
+    void* p2 = _rw_cache_alloc(&ops_cache, 1000u);
+    void* p3 = _rw_cache_alloc(&ops_cache, 1000u);
+    assert_non_null(p1);
+    assert_non_null(p2);
+    assert_non_null(p3);
+    assert_true(ops_cache.rw_cache.used >= 3000u);
+
+    /* Larger than a whole slab is fine as well. */
+    assert_non_null(_rw_cache_alloc(&ops_cache, 2u * DB_LMDB_RW_OPS_CACHE_SIZE));
+
+    /* After a batch reset the first slab is handed out again. */
+    _batch_reset(&ops_cache);
+    assert_int_equal(ops_cache.rw_cache.used, 0u);
+    assert_ptr_equal(_rw_cache_alloc(&ops_cache, 1000u), p1);
 }
 
 /* ------------------------------------------------------------------------- */
@@ -143,7 +538,7 @@ static void test_exec_op_invalid_type_fails(void** state)
     op.type = DB_OPERATION_NONE;
 
     int err = 0;
-    db_security_ret_code_t rc = _exec_op((MDB_txn*)0x700, &op, &err);
+    db_security_ret_code_t rc = _exec_op(&ops_cache, (MDB_txn*)0x700, &op, &err);
 
     assert_int_equal(rc, DB_SAFETY_FAIL);
 }
@@ -161,7 +556,7 @@ static void test_exec_op_put_delegates_to_act_put(void** state)
     g_next_put_rc = DB_SAFETY_SUCCESS;
 
     int err = -1;
-    db_security_ret_code_t rc = _exec_op((MDB_txn*)0x701, &op, &err);
+    db_security_ret_code_t rc = _exec_op(&ops_cache, (MDB_txn*)0x701, &op, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
@@ -181,13 +576,13 @@ static void test_exec_op_get_rw_caches_value(void** state)
     op.val.kind   = OP_KEY_KIND_NONE;
 
     int err = 0;
-    db_security_ret_code_t rc = _exec_op((MDB_txn*)0x702, &op, &err);
+    db_security_ret_code_t rc = _exec_op(&ops_cache, (MDB_txn*)0x702, &op, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
     assert_int_equal(op.val.kind, OP_KEY_KIND_PRESENT);
     assert_non_null(op.val.present.ptr);
-    assert_true(ops_cache.rw_cache_used > 0u);
+    assert_true(ops_cache.rw_cache.used > 0u);
 }
 
 static void test_exec_op_get_retry_propagates_retry(void** state)
@@ -205,7 +600,7 @@ static void test_exec_op_get_retry_propagates_retry(void** state)
     g_next_get_rc = DB_SAFETY_RETRY;
 
     int err = 0;
-    db_security_ret_code_t rc = _exec_op((MDB_txn*)0x703, &op, &err);
+    db_security_ret_code_t rc = _exec_op(&ops_cache, (MDB_txn*)0x703, &op, &err);
 
     assert_int_equal(rc, DB_SAFETY_RETRY);
 }
@@ -220,7 +615,9 @@ static void test_exec_ops_all_success_returns_success(void** state)
 
     ut_reset_all();
 
+    assert_int_equal(_ops_reserve(&ops_cache, 2u), 0);
     ops_cache.n_ops   = 2u;
+    memset(ops_cache.ops, 0, 2u * sizeof(op_t));
     ops_cache.ops[0].type = DB_OPERATION_PUT;
     ops_cache.ops[1].type = DB_OPERATION_GET;
 
@@ -228,7 +625,8 @@ static void test_exec_ops_all_success_returns_success(void** state)
     g_next_get_rc = DB_SAFETY_SUCCESS;
 
     int err = 0;
-    db_security_ret_code_t rc = _exec_ops((MDB_txn*)0x710, &err);
+    db_security_ret_code_t rc =
+        _exec_ops(&ops_cache, (MDB_txn*)0x710, 0, ops_cache.n_ops, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
@@ -240,14 +638,17 @@ static void test_exec_ops_stops_on_retry(void** state)
 
     ut_reset_all();
 
+    assert_int_equal(_ops_reserve(&ops_cache, 2u), 0);
     ops_cache.n_ops   = 2u;
+    memset(ops_cache.ops, 0, 2u * sizeof(op_t));
     ops_cache.ops[0].type = DB_OPERATION_GET;
     ops_cache.ops[1].type = DB_OPERATION_PUT;
 
     g_next_get_rc = DB_SAFETY_RETRY;
 
     int err = 0;
-    db_security_ret_code_t rc = _exec_ops((MDB_txn*)0x711, &err);
+    db_security_ret_code_t rc =
+        _exec_ops(&ops_cache, (MDB_txn*)0x711, 0, ops_cache.n_ops, &err);
 
     assert_int_equal(rc, DB_SAFETY_RETRY);
 }
@@ -262,7 +663,7 @@ static void test_ops_add_operation_rejects_null_input(void** state)
 
     ut_reset_all();
 
-    assert_int_equal(ops_add_operation(NULL), -EINVAL);
+    assert_int_equal(ops_add_operation(&ops_cache, NULL), -EINVAL);
 }
 
 static void test_ops_add_operation_updates_batch_kind_and_validates_lookup(void** state)
@@ -280,13 +681,13 @@ static void test_ops_add_operation_updates_batch_kind_and_validates_lookup(void*
     op.key.present.ptr  = (void*)"k";
     op.key.present.size = 1u;
 
-    assert_int_equal(ops_add_operation(&op), 0);
+    assert_int_equal(ops_add_operation(&ops_cache, &op), 0);
     assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
     assert_int_equal(ops_cache.n_ops, 1u);
 
     /* Second op: PUT => batch kind becomes RW. */
     op.type = DB_OPERATION_PUT;
-    assert_int_equal(ops_add_operation(&op), 0);
+    assert_int_equal(ops_add_operation(&ops_cache, &op), 0);
     assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RW);
     assert_int_equal(ops_cache.n_ops, 2u);
 
@@ -294,7 +695,120 @@ static void test_ops_add_operation_updates_batch_kind_and_validates_lookup(void*
     op.type                  = DB_OPERATION_GET;
     op.key.kind              = OP_KEY_KIND_LOOKUP;
     op.key.lookup.op_index   = 10u;
-    assert_int_equal(ops_add_operation(&op), -EINVAL);
+    assert_int_equal(ops_add_operation(&ops_cache, &op), -EINVAL);
+}
+
+static void test_ops_get_next_op_grows_past_initial_capacity(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_PUT;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+
+    for(size_t i = 0; i < 3u * DB_LMDB_BATCH_OPS_INIT; ++i)
+    {
+        op_t* slot = ops_get_next_op(&ops_cache);
+        assert_non_null(slot);
+        *slot = op;
+        assert_int_equal(ops_add_operation(&ops_cache, slot), 0);
+    }
+
+    assert_int_equal(ops_cache.n_ops, 3u * DB_LMDB_BATCH_OPS_INIT);
+    assert_true(ops_cache.ops_cap >= ops_cache.n_ops);
+}
+
+static void test_ops_get_next_op_respects_runtime_limit(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    assert_int_equal(ops_set_batch_max_ops(0u), -EINVAL);
+    assert_int_equal(ops_set_batch_max_ops(3u), 0);
+    assert_int_equal(ops_get_batch_max_ops(), 3u);
+
+    op_t op;
+    memset(&op, 0, sizeof(op));
+    op.type             = DB_OPERATION_PUT;
+    op.key.kind         = OP_KEY_KIND_PRESENT;
+    op.key.present.ptr  = (void*)"k";
+    op.key.present.size = 1u;
+
+    for(int i = 0; i < 3; ++i)
+    {
+        assert_int_equal(ops_add_operation(&ops_cache, &op), 0);
+    }
+
+    assert_null(ops_get_next_op(&ops_cache));
+    assert_int_equal(ops_add_operation(&ops_cache, &op), -ENOMEM);
+    assert_int_equal(ops_cache.n_ops, 3u);
+    assert_int_equal(ops_cache.ops_cap, 3u);
+}
+
+static void test_ops_limit_lowered_below_grown_pool(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    /* The pool has room for more, the new limit still applies */
+    ut_add_put(&ops_cache, "a", "1");
+    ut_add_put(&ops_cache, "b", "2");
+    assert_true(ops_cache.ops_cap > 2u);
+    assert_int_equal(ops_set_batch_max_ops(2u), 0);
+
+    op_t op = ops_cache.ops[0];
+    assert_null(ops_get_next_op(&ops_cache));
+    assert_int_equal(ops_add_operation(&ops_cache, &op), -ENOMEM);
+    assert_int_equal(ops_cache.n_ops, 2u);
+}
+
+static void test_ops_add_operation_copies_pool_op_before_growing(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    for(size_t i = 0; i < DB_LMDB_BATCH_OPS_INIT; ++i) ut_add_put(&ops_cache, "k", "v");
+    assert_int_equal(ops_cache.ops_cap, DB_LMDB_BATCH_OPS_INIT);
+
+    /* Re-adding an op of the full pool moves the pool under it */
+    ops_cache.ops[0].key.present.ptr = (void*)"z";
+    assert_int_equal(ops_add_operation(&ops_cache, &ops_cache.ops[0]), 0);
+    assert_int_equal(ops_cache.n_ops, DB_LMDB_BATCH_OPS_INIT + 1u);
+
+    const op_t* last = &ops_cache.ops[DB_LMDB_BATCH_OPS_INIT];
+    assert_int_equal(last->type, DB_OPERATION_PUT);
+    assert_memory_equal(last->key.present.ptr, "z", 1u);
+}
+
+static void test_batch_reset_keeps_ops_pool(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    assert_int_equal(_ops_reserve(&ops_cache, 2u * DB_LMDB_BATCH_OPS_INIT), 0);
+    op_t*  pool = ops_cache.ops;
+    size_t cap  = ops_cache.ops_cap;
+
+    ops_cache.n_ops         = 4u;
+    ops_cache.kind          = OPS_BATCH_KIND_RW;
+    assert_non_null(_rw_cache_alloc(&ops_cache, 16u));
+
+    _batch_reset(&ops_cache);
+
+    assert_ptr_equal(ops_cache.ops, pool);
+    assert_int_equal(ops_cache.ops_cap, cap);
+    assert_int_equal(ops_cache.n_ops, 0u);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
+    assert_int_equal(ops_cache.rw_cache.used, 0u);
 }
 
 static void test_ops_execute_operations_rejects_empty_cache(void** state)
@@ -303,7 +817,7 @@ static void test_ops_execute_operations_rejects_empty_cache(void** state)
 
     ut_reset_all();
 
-    assert_int_equal(ops_execute_operations(), -EINVAL);
+    assert_int_equal(ops_execute_operations(&ops_cache), -EINVAL);
 }
 
 static void test_ops_execute_operations_ro_uses_exec_ro_ops(void** state)
@@ -319,13 +833,744 @@ static void test_ops_execute_operations_ro_uses_exec_ro_ops(void** state)
     op.key.present.ptr  = (void*)"k";
     op.key.present.size = 1u;
 
-    assert_int_equal(ops_add_operation(&op), 0);
+    assert_int_equal(ops_add_operation(&ops_cache, &op), 0);
     assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
 
-    int rc = ops_execute_operations();
+    int rc = ops_execute_operations(&ops_cache);
     assert_int_equal(rc, 0);
 }
 
+static void test_exec_rw_map_full_grows_outside_gate_then_retries(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    /* Commit hits MAP_FULL once: grown out of the gate, redone, committed */
+    ut_add_put(&ops_cache, "k", "v");
+    g_commit_full = 1;
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_map_full_calls, 1);
+    assert_int_equal(g_map_full_depth, 0);
+    assert_int_equal(g_map_after_calls, 1);
+    assert_int_equal(g_map_depth, 0);
+
+    /* At the ceiling: no more retries, the batch fails with -ENOSPC */
+    ut_add_put(&ops_cache, "k", "v");
+    g_commit_full = 1;
+    g_map_full_rc = -ENOSPC;
+    assert_int_equal(ops_execute_operations(&ops_cache), -ENOSPC);
+    assert_int_equal(g_map_full_calls, 2);
+    assert_int_equal(g_map_after_calls, 1);
+    assert_int_equal(g_map_depth, 0);
+    assert_int_equal(g_cache_writes, 0);
+}
+
+static void test_exec_rw_segment_retry_replays_only_that_segment(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    DataBase_t db;
+    memset(&db, 0, sizeof(db));
+    DataBase = &db;
+
+    /* Segments [a b] [c d] [e]: d fails once, only c and d run again */
+    assert_int_equal(ops_batch_set_segment_ops(&ops_cache, 2u), 0);
+    ut_add_put(&ops_cache, "a", "1");
+    ut_add_put(&ops_cache, "b", "2");
+    ut_add_put(&ops_cache, "c", "3");
+    ut_add_put(&ops_cache, "d", "4");
+    ut_add_put(&ops_cache, "e", "5");
+    g_put_retry_at = 4;
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1.b2.c3.d4.c3.d4.e5.");
+    assert_ptr_equal(g_nested_parent, (MDB_txn*)0x500);
+    assert_int_equal(g_map_depth, 0);
+
+    db_exec_stats_t st;
+    ops_batch_exec_stats(&ops_cache, &st);
+    assert_int_equal(st.attempts, 1u);
+    assert_int_equal(st.segments, 3u);
+    assert_int_equal(st.seg_retries, 1u);
+    assert_int_equal(st.replayed_ops, 1u);
+
+    /* No nested txns under WRITEMAP: the whole txn is redone */
+    db.env_flags    = MDB_WRITEMAP;
+    g_nested_parent = NULL;
+    g_put_log_len   = 0;
+    g_put_calls     = 0;
+    ut_add_put(&ops_cache, "a", "1");
+    ut_add_put(&ops_cache, "b", "2");
+    ut_add_put(&ops_cache, "c", "3");
+    g_put_retry_at = 3;
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1.b2.c3.a1.b2.c3.");
+    assert_null(g_nested_parent);
+
+    ops_batch_exec_stats(&ops_cache, &st);
+    assert_int_equal(st.attempts, 2u);
+    assert_int_equal(st.segments, 0u);
+    assert_int_equal(st.replayed_ops, 2u);
+
+    ops_batch_exec_stats(NULL, &st);
+    assert_int_equal(st.attempts, 0u);
+    assert_int_equal(ops_batch_set_segment_ops(NULL, 1u), -EINVAL);
+    DataBase = NULL;
+}
+
+static void test_exec_retry_restores_get_vals(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    /* The GET result of the aborted attempt must not feed the replay */
+    op_t* op = ops_get_next_op(&ops_cache);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_GET;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"k";
+    op->key.present.size = 1u;
+    op->val.kind         = OP_KEY_KIND_NONE;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    ut_add_put(&ops_cache, "k", "v");
+    assert_int_equal(ops_cache.n_gets, 1u);
+
+    g_put_retry_at = 1;
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_get_calls, 2u);
+    assert_int_equal(g_get_in_kind[0], OP_KEY_KIND_NONE);
+    assert_int_equal(g_get_in_kind[1], OP_KEY_KIND_NONE);
+    assert_int_equal(ops_cache.n_gets, 0u);
+    assert_int_equal(ops_cache.vals_saved, 0);
+}
+
+/* Last trace handed to the callback */
+static db_trace_t g_trace;
+static int        g_trace_calls = 0;
+
+static void ut_trace_cb(const db_trace_t* trace, void* ctx)
+{
+    assert_ptr_equal(ctx, &g_trace_calls);
+    g_trace = *trace;
+    g_trace_calls++;
+}
+
+static void test_exec_trace_reports_phases_and_retries(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    g_trace_calls = 0;
+
+    /* Off: nothing collected */
+    ut_add_put(&ops_cache, "k", "v");
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_trace_calls, 0);
+
+    /* RW, commit hits MAP_FULL once */
+    ops_trace_set(ut_trace_cb, &g_trace_calls);
+    ut_add_put(&ops_cache, "k", "v");
+    ut_add_put(&ops_cache, "l", "w");
+    g_commit_full = 1;
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_trace_calls, 1);
+    assert_ptr_equal(g_trace.batch, &ops_cache);
+    assert_int_equal(g_trace.rw, 1);
+    assert_int_equal(g_trace.result, 0);
+    assert_int_equal(g_trace.n_ops, 2u);
+    assert_int_equal(g_trace.retries, 1u);
+    assert_true(g_trace.t_start > 0u);
+    assert_true(g_trace.t_begun >= g_trace.t_start);
+    assert_true(g_trace.t_executed >= g_trace.t_begun);
+    assert_true(g_trace.t_end >= g_trace.t_executed);
+
+    /* Failures are traced with their errno */
+    ut_add_put(&ops_cache, "k", "v");
+    g_next_put_rc = DB_SAFETY_FAIL;
+    assert_int_equal(ops_execute_operations(&ops_cache), -EIO);
+    assert_int_equal(g_trace_calls, 2);
+    assert_int_equal(g_trace.result, -EIO);
+    assert_int_equal(g_trace.retries, 0u);
+    g_next_put_rc = DB_SAFETY_SUCCESS;
+
+    /* RO */
+    op_t* op = ops_get_next_op(&ops_cache);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_GET;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"k";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_trace_calls, 3);
+    assert_int_equal(g_trace.rw, 0);
+    assert_int_equal(g_trace.n_ops, 1u);
+    assert_int_equal(g_trace.dirty_pages, 0u);
+    assert_true(g_trace.t_end >= g_trace.t_begun);
+
+    ops_trace_set(NULL, NULL);
+    ut_add_put(&ops_cache, "k", "v");
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_trace_calls, 3);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_batch_prepare() / ops_batch_bind() tests                              */
+/* ------------------------------------------------------------------------- */
+
+static op_t* ut_add_lookup(batch_t* batch, const op_type_t type, const unsigned key_back,
+                           const op_key_source_t key_src)
+{
+    op_t* op = ops_get_next_op(batch);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->type                = type;
+    op->key.kind            = OP_KEY_KIND_LOOKUP;
+    op->key.lookup.op_index = key_back;
+    op->key.lookup.src_type = key_src;
+    return op;
+}
+
+static void test_prepare_flattens_lookups_and_rearms_after_exec(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    /* PUT a=1, GET by op 0's key, PUT key of op 1 (-> op 0) with op 1's result */
+    ut_add_put(&ops_cache, "a", "1");
+    op_t* get = ut_add_lookup(&ops_cache, DB_OPERATION_GET, 1u, OP_KEY_SRC_KEY);
+    assert_int_equal(ops_add_operation(&ops_cache, get), 0);
+    op_t* put = ut_add_lookup(&ops_cache, DB_OPERATION_PUT, 1u, OP_KEY_SRC_KEY);
+    put->val.kind            = OP_KEY_KIND_LOOKUP;
+    put->val.lookup.op_index = 1u;
+    put->val.lookup.src_type = OP_KEY_SRC_VAL;
+    assert_int_equal(ops_add_operation(&ops_cache, put), 0);
+
+    assert_int_equal(ops_batch_prepare(&ops_cache), 0);
+    assert_int_equal(ops_cache.ops[2].key.lookup.op_index, 2u);
+    assert_int_equal(ops_cache.ops[2].key.lookup.src_type, OP_KEY_SRC_KEY);
+    assert_int_equal(ops_cache.ops[2].val.lookup.op_index, 1u);
+    assert_int_equal(ops_batch_prepare(&ops_cache), -EBUSY);
+
+    /* Runs, then comes back armed; new bindings show up in the next run */
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(ops_cache.n_ops, 3u);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RW);
+    assert_int_equal(ops_cache.ops[1].val.kind, OP_KEY_KIND_NONE);
+    assert_int_equal(ops_batch_bind(&ops_cache, 0u, "b", 1u, NULL, 0u), 0);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1.b1.");
+    assert_int_equal(g_get_calls, 2u);
+    assert_int_equal(g_get_in_kind[1], OP_KEY_KIND_NONE);
+
+    /* Lookups and missing ops cannot be bound, the shape is frozen */
+    assert_int_equal(ops_batch_bind(&ops_cache, 1u, "c", 1u, NULL, 0u), -EINVAL);
+    assert_int_equal(ops_batch_bind(&ops_cache, 2u, NULL, 0u, "2", 1u), -EINVAL);
+    assert_int_equal(ops_batch_bind(&ops_cache, 3u, "c", 1u, NULL, 0u), -EINVAL);
+    assert_int_equal(ops_batch_bind(&ops_cache, 0u, "c", 0u, NULL, 0u), -EINVAL);
+    assert_int_equal(ops_add_operation(&ops_cache, &ops_cache.ops[0]), -EBUSY);
+
+    ops_batch_unprepare(&ops_cache);
+    assert_int_equal(ops_cache.n_ops, 0u);
+    assert_int_equal(ops_batch_bind(&ops_cache, 0u, "c", 1u, NULL, 0u), -EINVAL);
+    ut_add_put(&ops_cache, "k", "v");
+}
+
+static void test_prepare_rejects_broken_lookups(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    /* Self reference: a cycle _resolve_desc would never leave */
+    ut_add_put(&ops_cache, "a", "1");
+    op_t* op = ut_add_lookup(&ops_cache, DB_OPERATION_GET, 0u, OP_KEY_SRC_KEY);
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_batch_prepare(&ops_cache), -EINVAL);
+    ops_batch_clear(&ops_cache);
+
+    /* Val of a DEL: nothing ever fills it */
+    op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_DEL;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"k";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    op = ut_add_lookup(&ops_cache, DB_OPERATION_GET, 1u, OP_KEY_SRC_VAL);
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_batch_prepare(&ops_cache), -EINVAL);
+    ops_batch_clear(&ops_cache);
+
+    /* Nothing queued */
+    assert_int_equal(ops_batch_prepare(&ops_cache), -EINVAL);
+    assert_int_equal(ops_batch_prepare(NULL), -EINVAL);
+}
+
+static void test_bind_keeps_integer_sizes_of_integer_dbis(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    DataBase_t db;
+    dbi_t      dbis[2];
+    memset(&db, 0, sizeof(db));
+    memset(dbis, 0, sizeof(dbis));
+    dbis[0].is_intkey = 1u;
+    dbis[1].is_intdup = 1u;
+    db.dbis           = dbis;
+    db.n_dbis         = 2u;
+    DataBase          = &db;
+
+    /* PUT 4-byte key on the INTEGERKEY DBI, PUT 4-byte dup on the INTEGERDUP one */
+    static const unsigned k4 = 7u, d4 = 9u;
+    static const size_t   k8 = 8u;
+    op_t* op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_PUT;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)&k4;
+    op->key.present.size = sizeof(k4);
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = (void*)"v";
+    op->val.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->dbi              = 1u;
+    op->type             = DB_OPERATION_PUT;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"k";
+    op->key.present.size = 1u;
+    op->val.kind         = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr  = (void*)&d4;
+    op->val.present.size = sizeof(d4);
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_batch_prepare(&ops_cache), 0);
+
+    /* LMDB would read a 3-byte integer past its end: refused, old bytes kept */
+    assert_int_equal(ops_batch_bind(&ops_cache, 0u, "abc", 3u, "w", 1u), -EINVAL);
+    assert_int_equal(ops_batch_bind(&ops_cache, 1u, NULL, 0u, "abc", 3u), -EINVAL);
+    for(size_t i = 0; i < 2u; i++)
+    {
+        const op_t* armed = &ops_cache.ops[i];
+        const op_t* plan  = &ops_cache.plan[i];
+        assert_memory_equal(&armed->key, &plan->key, sizeof(op_key_t));
+        assert_memory_equal(&armed->val, &plan->val, sizeof(op_key_t));
+    }
+    assert_ptr_equal(ops_cache.ops[0].key.present.ptr, &k4);
+    assert_string_equal(ops_cache.ops[0].val.present.ptr, "v");
+    assert_ptr_equal(ops_cache.ops[1].val.present.ptr, &d4);
+
+    /* Either integer size binds; other bytes on a plain side stay free */
+    assert_int_equal(ops_batch_bind(&ops_cache, 0u, &k8, sizeof(k8), "w", 1u), 0);
+    assert_int_equal(ops_batch_bind(&ops_cache, 1u, "ab", 2u, &k8, sizeof(k8)), 0);
+    assert_ptr_equal(ops_cache.ops[0].key.present.ptr, &k8);
+    assert_int_equal(ops_cache.ops[1].val.present.size, sizeof(k8));
+
+    ops_batch_unprepare(&ops_cache);
+    DataBase = NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_execute_leased() / ops_release_leased() tests                         */
+/* ------------------------------------------------------------------------- */
+
+static void ut_add_get(batch_t* batch)
+{
+    op_t* op = ops_get_next_op(batch);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_GET;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"k";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(batch, op), 0);
+}
+
+static void test_ops_execute_leased_keeps_txn_until_release(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    ut_add_get(&ops_cache);
+    ut_add_get(&ops_cache);
+
+    db_view_t views[2] = { { 0 } };
+    assert_int_equal(ops_execute_leased(&ops_cache, views, 2u), 0);
+
+    /* Views point at what act_get produced, txn is still open */
+    assert_int_equal(views[0].size, 2u);
+    assert_memory_equal(views[0].data, "X", 2u);
+    assert_ptr_equal(views[0].data, views[1].data);
+    assert_ptr_equal(ops_cache.lease, (MDB_txn*)0x500);
+    assert_int_equal(ops_cache.n_ops, 0u);
+    assert_int_equal(g_ro_end_calls, 0);
+    assert_int_equal(g_map_depth, 1); /* no resize under the views */
+
+    /* A leased batch refuses to run again */
+    ut_add_get(&ops_cache);
+    assert_int_equal(ops_execute_operations(&ops_cache), -EBUSY);
+    assert_int_equal(ops_execute_leased(&ops_cache, views, 2u), -EBUSY);
+
+    /* Nor can this thread write through another batch: the map could not grow */
+    batch_t* other = ops_batch_create();
+    assert_non_null(other);
+    op_t put;
+    memset(&put, 0, sizeof(put));
+    put.type             = DB_OPERATION_PUT;
+    put.key.kind         = OP_KEY_KIND_PRESENT;
+    put.key.present.ptr  = (void*)"k";
+    put.key.present.size = 1u;
+    assert_int_equal(ops_add_operation(other, &put), 0);
+    assert_int_equal(ops_execute_operations(other), -EBUSY);
+    assert_int_equal(other->n_ops, 1u);
+    ops_batch_destroy(other);
+
+    ops_release_leased(&ops_cache);
+    ops_release_leased(&ops_cache);
+    assert_null(ops_cache.lease);
+    assert_int_equal(g_ro_end_calls, 1);
+    assert_int_equal(g_map_depth, 0);
+
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_ro_end_calls, 2);
+}
+
+static void test_ops_execute_leased_rejects_bad_input(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    db_view_t views[1];
+    assert_int_equal(ops_execute_leased(NULL, views, 1u), -EINVAL);
+    assert_int_equal(ops_execute_leased(&ops_cache, NULL, 1u), -EINVAL);
+    assert_int_equal(ops_execute_leased(&ops_cache, views, 1u), -EINVAL); /* empty */
+
+    /* Fewer views than ops */
+    ut_add_get(&ops_cache);
+    ut_add_get(&ops_cache);
+    assert_int_equal(ops_execute_leased(&ops_cache, views, 1u), -EINVAL);
+    ops_cache.n_ops = 0;
+
+    /* Write batches cannot be leased and are dropped */
+    op_t put;
+    memset(&put, 0, sizeof(put));
+    put.type             = DB_OPERATION_PUT;
+    put.key.kind         = OP_KEY_KIND_PRESENT;
+    put.key.present.ptr  = (void*)"k";
+    put.key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, &put), 0);
+    assert_int_equal(ops_execute_leased(&ops_cache, views, 1u), -EINVAL);
+    assert_int_equal(ops_cache.n_ops, 0u);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
+    assert_null(ops_cache.lease);
+
+    /* Read-only but not a single GET: refused before any txn, and dropped */
+    const op_type_t    types[] = { DB_OPERATION_LST, DB_OPERATION_GET };
+    const unsigned int flags[] = { 0u, OP_FLAG_MULTIPLE };
+    for(size_t i = 0; i < 2u; i++)
+    {
+        ut_add_get(&ops_cache);
+        op_t rd;
+        memset(&rd, 0, sizeof(rd));
+        rd.type             = types[i];
+        rd.flags            = flags[i];
+        rd.key.kind         = OP_KEY_KIND_PRESENT;
+        rd.key.present.ptr  = (void*)"k";
+        rd.key.present.size = 1u;
+        assert_int_equal(ops_add_operation(&ops_cache, &rd), 0);
+        assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
+
+        db_view_t two[2];
+        assert_int_equal(ops_execute_leased(&ops_cache, two, 2u), -EINVAL);
+        assert_int_equal(ops_cache.n_ops, 0u);
+        assert_null(ops_cache.lease);
+        assert_int_equal(g_map_depth, 0);
+    }
+}
+
+/* ------------------------------------------------------------------------- */
+/* DB_OPERATION_LST cursor cache tests                                       */
+/* ------------------------------------------------------------------------- */
+
+static int g_cursor_opens = 0;
+
+static int ut_cursor_open_count(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor)
+{
+    (void)txn;
+    g_cursor_opens++;
+    *cursor = (MDB_cursor*)(uintptr_t)(0x800 + dbi);
+    return MDB_SUCCESS;
+}
+
+static void ut_add_lst(batch_t* batch, const unsigned dbi)
+{
+    static db_scan_t scan;
+    op_t* op = ops_get_next_op(batch);
+    assert_non_null(op);
+    memset(op, 0, sizeof(*op));
+    op->dbi  = dbi;
+    op->type = DB_OPERATION_LST;
+    op->scan = &scan;
+    assert_int_equal(ops_add_operation(batch, op), 0);
+}
+
+static void test_lst_reuses_one_cursor_per_dbi(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    g_cursor_opens       = 0;
+    g_ut_mdb_cursor_open = ut_cursor_open_count;
+
+    /* Scans are read ops */
+    ut_add_lst(&ops_cache, 0u);
+    ut_add_lst(&ops_cache, 2u);
+    ut_add_lst(&ops_cache, 0u);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+
+    /* One cursor per DBI, kept for the next batch */
+    assert_int_equal(g_cursor_opens, 2);
+    assert_int_equal(ops_cache.n_cursors, 3u);
+    assert_ptr_equal(ops_cache.cursors[0].cur, (MDB_cursor*)0x800);
+    assert_null(ops_cache.cursors[1].cur);
+    assert_ptr_equal(ops_cache.cursors[2].cur, (MDB_cursor*)0x802);
+    assert_int_equal(ops_cache.cursors[0].bound, 0);
+
+    /* Next read batch renews instead of reopening */
+    ut_add_lst(&ops_cache, 0u);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_cursor_opens, 2);
+    assert_ptr_equal(g_last_lst_cur, &ops_cache.cursors[0].cur);
+
+    /* A write batch drops the read cursor and opens its own, which dies
+    with the write txn */
+    ut_add_lst(&ops_cache, 0u);
+    op_t put;
+    memset(&put, 0, sizeof(put));
+    put.type             = DB_OPERATION_PUT;
+    put.key.kind         = OP_KEY_KIND_PRESENT;
+    put.key.present.ptr  = (void*)"k";
+    put.key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, &put), 0);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_cursor_opens, 3);
+    assert_null(ops_cache.cursors[0].cur);
+    assert_ptr_equal(ops_cache.cursors[2].cur, (MDB_cursor*)0x802);
+
+    ops_batch_destroy(&ops_cache);
+    assert_null(ops_cache.cursors);
+    assert_int_equal(ops_cache.n_cursors, 0u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_batch_set_sorted() tests                                              */
+/* ------------------------------------------------------------------------- */
+
+/* c1 a1 b2 b1 | GET | b9 a9 */
+static void ut_add_unsorted_puts(batch_t* batch)
+{
+    ut_add_put(batch, "c", "1");
+    ut_add_put(batch, "a", "1");
+    ut_add_put(batch, "b", "2");
+    ut_add_put(batch, "b", "1");
+    ut_add_get(batch);
+    ut_add_put(batch, "b", "9");
+    ut_add_put(batch, "a", "9");
+}
+
+static void test_sorted_batch_reorders_runs_and_appends(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    g_after_last = 1;
+
+    assert_int_equal(ops_batch_set_sorted(NULL, 1), -EINVAL);
+    assert_int_equal(ops_batch_set_sorted(&ops_cache, 1), 0);
+
+    /* Each run is sorted on its own, the GET stays between them; new keys
+    append, the second dup of b appends as a dup */
+    ut_add_unsorted_puts(&ops_cache);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1+b1+b2*c1+a9+b9+");
+
+    /* Keys not past the DBI end: same order, plain puts */
+    g_after_last  = 0;
+    g_put_log_len = 0;
+    ut_add_unsorted_puts(&ops_cache);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1.b1.b2.c1.a9.b9.");
+
+    /* Off again: insertion order */
+    g_after_last  = 1;
+    g_put_log_len = 0;
+    assert_int_equal(ops_batch_set_sorted(&ops_cache, 0), 0);
+    ut_add_unsorted_puts(&ops_cache);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "c1.a1.b2.b1.b9.a9.");
+}
+
+static void test_sorted_batch_keeps_repeated_keys_in_order(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    g_after_last = 1;
+    assert_int_equal(ops_batch_set_sorted(&ops_cache, 1), 0);
+
+    /* Identical records are not appended twice; a PUT with a looked up
+    key is not reordered */
+    ut_add_put(&ops_cache, "b", "1");
+    ut_add_put(&ops_cache, "a", "1");
+    ut_add_put(&ops_cache, "b", "1");
+
+    op_t* op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type                = DB_OPERATION_PUT;
+    op->key.kind            = OP_KEY_KIND_LOOKUP;
+    op->key.lookup.src_type = OP_KEY_SRC_KEY;
+    op->key.lookup.op_index = 1u;
+    op->val.kind            = OP_KEY_KIND_PRESENT;
+    op->val.present.ptr     = (void*)"0";
+    op->val.present.size    = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_string_equal(g_put_log, "a1+b1+b1.");
+    assert_int_equal(ops_cache.planned, 0);
+
+    /* Reset keeps the mode */
+    assert_int_equal(ops_cache.sorted, 1);
+    ops_batch_destroy(&ops_cache);
+    assert_int_equal(ops_cache.sorted, 0);
+    assert_null(ops_cache.order);
+}
+
+static void test_multi_reserve_and_rep_ops_dispatch(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    g_after_last = 1;
+    assert_int_equal(ops_batch_set_sorted(&ops_cache, 1), 0);
+
+    /* b1 | PUT MULTIPLE | a1 | PUT RESERVE | 01: neither splits into a sorted run */
+    db_multi_t multi = { 0 };
+    ut_add_put(&ops_cache, "b", "1");
+    op_t* op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_PUT;
+    op->flags            = OP_FLAG_MULTIPLE;
+    op->multi            = &multi;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"m";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    ut_add_put(&ops_cache, "a", "1");
+
+    /* A reserved put is a barrier too */
+    db_reserve_t rsv = { 0 };
+    op               = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_PUT;
+    op->flags            = OP_FLAG_RESERVE;
+    op->reserve          = &rsv;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"r";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    ut_add_put(&ops_cache, "0", "1");
+
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_multi_calls, 1);
+    assert_int_equal(g_reserve_calls, 1);
+    assert_string_equal(g_put_log, "b1.a1.01.");
+
+    /* A multi GET is a read op on the batch cursor of its DBI */
+    op = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_GET;
+    op->flags            = OP_FLAG_MULTIPLE;
+    op->multi            = &multi;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"m";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RO);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_multi_calls, 2);
+    assert_int_equal(multi.n_items, 1u);
+    assert_non_null(ops_cache.cursors[0].cur);
+
+    /* A patch is a write op on the batch cursor */
+    db_patch_t patch = { 0 };
+    op               = ops_get_next_op(&ops_cache);
+    memset(op, 0, sizeof(*op));
+    op->type             = DB_OPERATION_REP;
+    op->patch            = &patch;
+    op->key.kind         = OP_KEY_KIND_PRESENT;
+    op->key.present.ptr  = (void*)"m";
+    op->key.present.size = 1u;
+    assert_int_equal(ops_add_operation(&ops_cache, op), 0);
+    assert_int_equal(ops_cache.kind, OPS_BATCH_KIND_RW);
+    assert_int_equal(ops_execute_operations(&ops_cache), 0);
+    assert_int_equal(g_rep_calls, 1);
+
+    ops_batch_destroy(&ops_cache);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_execute_nested() tests                                                */
+/* ------------------------------------------------------------------------- */
+
+static void test_execute_nested_keeps_batch_until_clear(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    int err = 0;
+
+    /* Reads alone are not writes */
+    ut_add_get(&ops_cache);
+    assert_int_equal(ops_batch_has_writes(&ops_cache), 0);
+    ut_add_put(&ops_cache, "a", "1");
+    assert_int_equal(ops_batch_has_writes(&ops_cache), 1);
+    assert_int_equal(ops_batch_has_writes(NULL), 0);
+
+    /* Child of the given parent, batch left as is for a redo */
+    assert_int_equal(ops_execute_nested(&ops_cache, (MDB_txn*)0x600, &err), DB_SAFETY_SUCCESS);
+    assert_ptr_equal(g_nested_parent, (MDB_txn*)0x600);
+    assert_int_equal(ops_cache.n_ops, 2u);
+    assert_string_equal(g_put_log, "a1.");
+
+    /* A failing op fails the child only */
+    g_next_put_rc = DB_SAFETY_FAIL;
+    assert_int_equal(ops_execute_nested(&ops_cache, (MDB_txn*)0x600, &err), DB_SAFETY_FAIL);
+    assert_int_equal(ops_cache.n_ops, 2u);
+
+    ops_batch_clear(&ops_cache);
+    assert_int_equal(ops_cache.n_ops, 0u);
+    assert_int_equal(ops_batch_has_writes(&ops_cache), 0);
+
+    /* Nothing to run */
+    assert_int_equal(ops_execute_nested(&ops_cache, (MDB_txn*)0x600, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(ops_execute_nested(NULL, (MDB_txn*)0x600, &err), DB_SAFETY_FAIL);
+    ops_batch_clear(NULL);
+}
+
 /* ------------------------------------------------------------------------- */
 /* Main                                                                      */
 /* ------------------------------------------------------------------------- */
@@ -335,7 +1580,7 @@ int main(void)
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_rw_cache_alloc_zero_size_returns_null),
         cmocka_unit_test(test_rw_cache_alloc_within_capacity_advances_offset),
-        cmocka_unit_test(test_rw_cache_alloc_beyond_capacity_fails),
+        cmocka_unit_test(test_rw_cache_alloc_beyond_slab_size_grows),
         cmocka_unit_test(test_exec_op_invalid_type_fails),
         cmocka_unit_test(test_exec_op_put_delegates_to_act_put),
         cmocka_unit_test(test_exec_op_get_rw_caches_value),
@@ -344,8 +1589,27 @@ int main(void)
         cmocka_unit_test(test_exec_ops_stops_on_retry),
         cmocka_unit_test(test_ops_add_operation_rejects_null_input),
         cmocka_unit_test(test_ops_add_operation_updates_batch_kind_and_validates_lookup),
+        cmocka_unit_test(test_ops_get_next_op_grows_past_initial_capacity),
+        cmocka_unit_test(test_ops_get_next_op_respects_runtime_limit),
+        cmocka_unit_test(test_ops_limit_lowered_below_grown_pool),
+        cmocka_unit_test(test_ops_add_operation_copies_pool_op_before_growing),
+        cmocka_unit_test(test_batch_reset_keeps_ops_pool),
         cmocka_unit_test(test_ops_execute_operations_rejects_empty_cache),
         cmocka_unit_test(test_ops_execute_operations_ro_uses_exec_ro_ops),
+        cmocka_unit_test(test_exec_rw_map_full_grows_outside_gate_then_retries),
+        cmocka_unit_test(test_exec_rw_segment_retry_replays_only_that_segment),
+        cmocka_unit_test(test_exec_retry_restores_get_vals),
+        cmocka_unit_test(test_exec_trace_reports_phases_and_retries),
+        cmocka_unit_test(test_prepare_flattens_lookups_and_rearms_after_exec),
+        cmocka_unit_test(test_prepare_rejects_broken_lookups),
+        cmocka_unit_test(test_bind_keeps_integer_sizes_of_integer_dbis),
+        cmocka_unit_test(test_ops_execute_leased_keeps_txn_until_release),
+        cmocka_unit_test(test_ops_execute_leased_rejects_bad_input),
+        cmocka_unit_test(test_lst_reuses_one_cursor_per_dbi),
+        cmocka_unit_test(test_sorted_batch_reorders_runs_and_appends),
+        cmocka_unit_test(test_sorted_batch_keeps_repeated_keys_in_order),
+        cmocka_unit_test(test_multi_reserve_and_rep_ops_dispatch),
+        cmocka_unit_test(test_execute_nested_keeps_batch_until_clear),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
@@ -0,0 +1,434 @@
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_actions.h"
+#include "core/operations/ops_int/ops_exec.h"
+#include "core/operations/ops_int/ops_group.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for ops_exec / ops_actions layers                       */
+/* ------------------------------------------------------------------------- */
+
+/* ops_exec is tested in its own UT suite; here a fake batch only says how
+ * its nested and direct executions end. cmocka is not thread-safe, so the
+ * fakes only record and the checks run on the main thread. */
+
+struct ops_batch
+{
+    int        writes;      /* ops_batch_has_writes */
+    int        nested_rc;   /* ops_execute_nested return */
+    int        nested_err;  /* ...and its error */
+    int        exec_rc;     /* ops_execute_operations return */
+    atomic_int nested_calls;
+    atomic_int exec_calls;
+    atomic_int clear_calls;
+    atomic_int cache_begins; /* ops_batch_cache_begin */
+    atomic_int cache_ends;   /* ops_batch_cache_end */
+};
+
+static atomic_int g_submitted  = 0; /* has_writes calls, made right before the push */
+static atomic_int g_txn_begins = 0;
+static int        g_commit_rc  = DB_SAFETY_SUCCESS;
+static int        g_commit_err = 0;
+
+/* First writer txn waits here until the test opens the gate */
+static atomic_int g_gate_closed = 0;
+
+db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, int* const out_err)
+{
+    (void)flags;
+    (void)out_err;
+    while(atomic_load(&g_gate_closed))
+    {
+        usleep(100);
+    }
+    atomic_fetch_add(&g_txn_begins, 1);
+    *out_txn = (MDB_txn*)0xD0;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_txn_commit(MDB_txn* const txn, int* const out_err)
+{
+    (void)txn;
+    if(g_commit_rc != DB_SAFETY_SUCCESS && out_err) *out_err = g_commit_err;
+    return (db_security_ret_code_t)g_commit_rc;
+}
+
+int ops_batch_has_writes(const batch_t* batch)
+{
+    atomic_fetch_add(&g_submitted, 1);
+    return batch->writes;
+}
+
+db_security_ret_code_t ops_execute_nested(batch_t* batch, MDB_txn* parent, int* const out_err)
+{
+    (void)parent;
+    atomic_fetch_add(&batch->nested_calls, 1);
+    if(batch->nested_rc != DB_SAFETY_SUCCESS && out_err) *out_err = batch->nested_err;
+    return (db_security_ret_code_t)batch->nested_rc;
+}
+
+int ops_execute_operations(batch_t* batch)
+{
+    atomic_fetch_add(&batch->exec_calls, 1);
+    return batch->exec_rc;
+}
+
+void ops_batch_clear(batch_t* batch)
+{
+    atomic_fetch_add(&batch->clear_calls, 1);
+}
+
+void ops_batch_cache_begin(const batch_t* batch)
+{
+    atomic_fetch_add(&((batch_t*)batch)->cache_begins, 1);
+}
+
+void ops_batch_cache_end(const batch_t* batch)
+{
+    atomic_fetch_add(&((batch_t*)batch)->cache_ends, 1);
+}
+
+/* The gate is ops_map's; here only count that the writer balances it */
+static atomic_int g_map_depth   = 0;
+static atomic_int g_map_commits = 0;
+static int        g_map_held    = 0; /* the submitter holds a lease */
+
+void ops_map_enter(void)
+{
+    atomic_fetch_add(&g_map_depth, 1);
+}
+
+void ops_map_leave(void)
+{
+    atomic_fetch_sub(&g_map_depth, 1);
+}
+
+int ops_map_held(void)
+{
+    return g_map_held;
+}
+
+void ops_map_after_commit(void)
+{
+    atomic_fetch_add(&g_map_commits, 1);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+
+typedef struct
+{
+    batch_t*  batch;
+    int       res;
+    pthread_t thread;
+} ut_producer_t;
+
+static void* ut_producer_main(void* arg)
+{
+    ut_producer_t* p = arg;
+    p->res           = ops_group_submit(p->batch);
+    return NULL;
+}
+
+static void ut_batch_init(batch_t* batch, const int writes)
+{
+    memset(batch, 0, sizeof(*batch));
+    batch->writes    = writes;
+    batch->nested_rc = DB_SAFETY_SUCCESS;
+}
+
+static void ut_wait_submitted(const int n)
+{
+    while(atomic_load(&g_submitted) < n)
+    {
+        usleep(100);
+    }
+    /* has_writes runs right before the push */
+    usleep(20000);
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    g_db.env = (MDB_env*)0x90;
+    DataBase = &g_db;
+    atomic_store(&g_submitted, 0);
+    atomic_store(&g_txn_begins, 0);
+    atomic_store(&g_gate_closed, 0);
+    atomic_store(&g_map_depth, 0);
+    atomic_store(&g_map_commits, 0);
+    g_map_held   = 0;
+    g_commit_rc  = DB_SAFETY_SUCCESS;
+    g_commit_err = 0;
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_group_stop();
+    DataBase = NULL;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_group_start() / ops_group_submit() tests                              */
+/* ------------------------------------------------------------------------- */
+
+static void test_group_runs_direct_when_stopped_or_read_only(void** state)
+{
+    (void)state;
+
+    batch_t w;
+    batch_t r;
+    ut_batch_init(&w, 1);
+    ut_batch_init(&r, 0);
+    w.exec_rc = -EEXIST;
+
+    /* Not running: the caller executes */
+    assert_int_equal(ops_group_submit(&w), -EEXIST);
+    assert_int_equal(w.exec_calls, 1);
+    assert_int_equal(w.nested_calls, 0);
+    assert_int_equal(ops_group_submit(NULL), -EINVAL);
+
+    DataBase = NULL;
+    assert_int_equal(ops_group_start(NULL), -EINVAL);
+    DataBase       = &g_db;
+    g_db.env_flags = MDB_WRITEMAP;
+    assert_int_equal(ops_group_start(NULL), -ENOTSUP);
+    g_db.env_flags = 0u;
+    assert_int_equal(ops_group_start(NULL), 0);
+    assert_int_equal(ops_group_start(NULL), -EALREADY);
+
+    /* Reads never reach the writer */
+    assert_int_equal(ops_group_submit(&r), 0);
+    assert_int_equal(r.exec_calls, 1);
+    assert_int_equal(r.nested_calls, 0);
+    assert_int_equal(g_txn_begins, 0);
+
+    /* Under a lease of the caller writes are refused, reads still run */
+    g_map_held = 1;
+    assert_int_equal(ops_group_submit(&w), -EBUSY);
+    assert_int_equal(w.exec_calls, 1);
+    assert_int_equal(ops_group_submit(&r), 0);
+    assert_int_equal(r.exec_calls, 2);
+    g_map_held = 0;
+
+    db_group_stats_t st;
+    ops_group_stats(&st);
+    assert_int_equal(st.batches, 0u);
+
+    /* Stop is idempotent, then submits are direct again */
+    ops_group_stop();
+    ops_group_stop();
+    assert_int_equal(ops_group_submit(&w), -EEXIST);
+    assert_int_equal(w.exec_calls, 2);
+}
+
+static void test_group_merges_pending_batches_and_isolates_failures(void** state)
+{
+    (void)state;
+
+    enum { N = 4 };
+    batch_t       batches[N];
+    ut_producer_t prod[N];
+    for(int i = 0; i < N; i++)
+    {
+        ut_batch_init(&batches[i], 1);
+        prod[i].batch = &batches[i];
+        prod[i].res   = 1;
+    }
+    batches[2].nested_rc  = DB_SAFETY_FAIL;
+    batches[2].nested_err = -EEXIST;
+
+    assert_int_equal(ops_group_start(NULL), 0);
+
+    /* The first batch holds the writer while the others queue up */
+    atomic_store(&g_gate_closed, 1);
+    assert_int_equal(pthread_create(&prod[0].thread, NULL, ut_producer_main, &prod[0]), 0);
+    ut_wait_submitted(1);
+    for(int i = 1; i < N; i++)
+    {
+        assert_int_equal(pthread_create(&prod[i].thread, NULL, ut_producer_main, &prod[i]), 0);
+    }
+    ut_wait_submitted(N);
+    atomic_store(&g_gate_closed, 0);
+
+    for(int i = 0; i < N; i++)
+    {
+        pthread_join(prod[i].thread, NULL);
+    }
+
+    /* Own result per batch, one txn for the three that queued together */
+    assert_int_equal(prod[0].res, 0);
+    assert_int_equal(prod[1].res, 0);
+    assert_int_equal(prod[2].res, -EEXIST);
+    assert_int_equal(prod[3].res, 0);
+    assert_int_equal(g_txn_begins, 2);
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(batches[i].nested_calls, 1);
+        assert_int_equal(batches[i].clear_calls, 1);
+        assert_int_equal(batches[i].exec_calls, 0);
+        /* Announced to the value cache before the group, released after */
+        assert_int_equal(batches[i].cache_begins, 1);
+        assert_int_equal(batches[i].cache_ends, 1);
+    }
+
+    db_group_stats_t st;
+    ops_group_stats(&st);
+    assert_int_equal(st.batches, 4u);
+    assert_int_equal(st.failed, 1u);
+    assert_int_equal(st.commits, 2u);
+    assert_int_equal(st.fallbacks, 0u);
+
+    /* Map growth checked once per group commit, outside the gate */
+    assert_int_equal(g_map_commits, 2);
+    assert_int_equal(g_map_depth, 0);
+}
+
+static void test_group_falls_back_to_one_txn_per_batch(void** state)
+{
+    (void)state;
+
+    batch_t b;
+    ut_batch_init(&b, 1);
+    assert_int_equal(ops_group_start(NULL), 0);
+
+    /* MAP_FULL in a child: the map cannot grow under the parent */
+    b.nested_rc  = DB_SAFETY_FAIL;
+    b.nested_err = -ENOSPC;
+    b.exec_rc    = 0;
+    assert_int_equal(ops_group_submit(&b), 0);
+    assert_int_equal(b.nested_calls, 1);
+    assert_int_equal(b.exec_calls, 1);
+    assert_int_equal(b.clear_calls, 0);
+
+    /* Retryable child error, the redo fails on its own */
+    b.nested_rc = DB_SAFETY_RETRY;
+    b.exec_rc   = -EIO;
+    assert_int_equal(ops_group_submit(&b), -EIO);
+    assert_int_equal(b.exec_calls, 2);
+
+    db_group_stats_t st;
+    ops_group_stats(&st);
+    assert_int_equal(st.fallbacks, 2u);
+    assert_int_equal(st.commits, 0u);
+    assert_int_equal(st.failed, 1u);
+    assert_int_equal(g_map_commits, 0);
+    assert_int_equal(g_map_depth, 0);
+}
+
+static void test_group_commit_failure_fails_every_batch(void** state)
+{
+    (void)state;
+
+    batch_t b;
+    ut_batch_init(&b, 1);
+    assert_int_equal(ops_group_start(&(db_group_cfg_t){ .max_batches = 1u }), 0);
+
+    g_commit_rc  = DB_SAFETY_FAIL;
+    g_commit_err = -EIO;
+    assert_int_equal(ops_group_submit(&b), -EIO);
+    assert_int_equal(b.clear_calls, 1);
+
+    /* Retryable commit error: redone alone */
+    g_commit_rc  = DB_SAFETY_RETRY;
+    g_commit_err = -EAGAIN;
+    assert_int_equal(ops_group_submit(&b), 0);
+    assert_int_equal(b.exec_calls, 1);
+
+    db_group_stats_t st;
+    ops_group_stats(&st);
+    assert_int_equal(st.batches, 2u);
+    assert_int_equal(st.failed, 1u);
+    assert_int_equal(st.commits, 0u);
+}
+
+static atomic_int g_async_done = 0;
+static int        g_async_res  = 1;
+static void*      g_async_ctx  = NULL;
+
+static void ut_async_done(batch_t* batch, int res, void* ctx)
+{
+    /* Writer thread: record only */
+    (void)batch;
+    g_async_res = res;
+    g_async_ctx = ctx;
+    atomic_fetch_add(&g_async_done, 1);
+}
+
+static void test_group_async_submit_completes_through_callback(void** state)
+{
+    (void)state;
+
+    batch_t b;
+    ut_batch_init(&b, 1);
+    b.nested_rc  = DB_SAFETY_FAIL;
+    b.nested_err = -EEXIST;
+    atomic_store(&g_async_done, 0);
+
+    /* Not running: the caller has to execute it */
+    assert_int_equal(ops_group_submit_async(&b, ut_async_done, (void*)0x5), -ENOTCONN);
+    assert_int_equal(ops_group_submit_async(NULL, ut_async_done, NULL), -EINVAL);
+    assert_int_equal(ops_group_submit_async(&b, NULL, NULL), -EINVAL);
+    assert_int_equal(b.exec_calls, 0);
+
+    /* Held at the writer: stop still waits for it */
+    assert_int_equal(ops_group_start(NULL), 0);
+    atomic_store(&g_gate_closed, 1);
+    assert_int_equal(ops_group_submit_async(&b, ut_async_done, (void*)0x5), 0);
+    usleep(20000);
+    assert_int_equal(g_async_done, 0);
+    atomic_store(&g_gate_closed, 0);
+    ops_group_stop();
+
+    assert_int_equal(g_async_done, 1);
+    assert_int_equal(g_async_res, -EEXIST);
+    assert_ptr_equal(g_async_ctx, (void*)0x5);
+    assert_int_equal(b.nested_calls, 1);
+    assert_int_equal(b.clear_calls, 1);
+
+    db_group_stats_t st;
+    ops_group_stats(&st);
+    assert_int_equal(st.batches, 1u);
+    assert_int_equal(st.failed, 1u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_group_runs_direct_when_stopped_or_read_only,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_group_merges_pending_batches_and_isolates_failures,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_group_falls_back_to_one_txn_per_batch, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_group_commit_failure_fails_every_batch, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_group_async_submit_completes_through_callback,
+                                        ut_setup, ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,347 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/db/dbi_int.h"
+#include "core/operations/ops_int/ops_index.h"
+#include "core/operations/ops_int/ops_zip.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* 0: users (id -> "mail|tag"), 1: mail -> id (unique), 2: tag -> id (DUPSORT), 3: spare */
+enum
+{
+    UT_USERS = 0,
+    UT_MAIL  = 1,
+    UT_TAG   = 2,
+    UT_SPARE = 3,
+    UT_DBIS  = 4
+};
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[UT_DBIS];
+static MDB_txn*   g_txn = (MDB_txn*)0x100;
+static int        g_aborts;
+
+/* Tiny in-memory store behind mdb_get / mdb_put / mdb_del */
+typedef struct
+{
+    unsigned dbi;
+    char     key[32];
+    char     val[32];
+} ut_rec_t;
+
+static ut_rec_t g_recs[32];
+static size_t   g_n_recs;
+
+/* No DBI_TYPE_ZIP DBI here, see UT_ops_zip */
+int ops_zip_on(const unsigned dbi)
+{
+    (void)dbi;
+    return 0;
+}
+
+int ops_zip_view(const unsigned dbi, const MDB_val* frame, MDB_val* out)
+{
+    (void)dbi;
+    *out = *frame;
+    return 0;
+}
+
+static int ut_eq(const char* s, const MDB_val* v)
+{
+    return strlen(s) == v->mv_size && memcmp(s, v->mv_data, v->mv_size) == 0;
+}
+
+static ut_rec_t* ut_find(const unsigned dbi, const MDB_val* k, const MDB_val* v)
+{
+    for(size_t i = 0; i < g_n_recs; i++)
+    {
+        ut_rec_t* r = &g_recs[i];
+        if(r->dbi == dbi && ut_eq(r->key, k) && (!v || ut_eq(r->val, v))) return r;
+    }
+    return NULL;
+}
+
+static void ut_store(const unsigned dbi, const char* key, const char* val)
+{
+    ut_rec_t* r = &g_recs[g_n_recs++];
+    r->dbi      = dbi;
+    snprintf(r->key, sizeof(r->key), "%s", key);
+    snprintf(r->val, sizeof(r->val), "%s", val);
+}
+
+static int ut_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v)
+{
+    (void)txn;
+    ut_rec_t* r = ut_find(dbi, k, NULL);
+    if(!r) return MDB_NOTFOUND;
+    v->mv_data = r->val;
+    v->mv_size = strlen(r->val);
+    return MDB_SUCCESS;
+}
+
+static int ut_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v, unsigned flags)
+{
+    (void)txn;
+    char key[32], val[32];
+    snprintf(key, sizeof(key), "%.*s", (int)k->mv_size, (const char*)k->mv_data);
+    snprintf(val, sizeof(val), "%.*s", (int)v->mv_size, (const char*)v->mv_data);
+
+    ut_rec_t* r = ut_find(dbi, k, NULL);
+    if(r && (flags & MDB_NOOVERWRITE))
+    {
+        v->mv_data = r->val;
+        v->mv_size = strlen(r->val);
+        return MDB_KEYEXIST;
+    }
+    if(g_dbis[dbi].is_dupsort)
+    {
+        if(!ut_find(dbi, k, v)) ut_store(dbi, key, val);
+    }
+    else if(r)
+    {
+        snprintf(r->val, sizeof(r->val), "%s", val);
+    }
+    else
+    {
+        ut_store(dbi, key, val);
+    }
+    return MDB_SUCCESS;
+}
+
+static int ut_del(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v)
+{
+    (void)txn;
+    int found = 0;
+    for(ut_rec_t* r; (r = ut_find(dbi, k, g_dbis[dbi].is_dupsort ? v : NULL)); found = 1)
+    {
+        *r = g_recs[--g_n_recs];
+    }
+    return found ? MDB_SUCCESS : MDB_NOTFOUND;
+}
+
+static void ut_abort(MDB_txn* txn)
+{
+    (void)txn;
+    g_aborts++;
+}
+
+/* "mail|tag": index 1 takes the mail, index 2 the tag; '-' is not indexed */
+static int ut_field(const db_view_t* val, const unsigned field, void* out, size_t* out_size)
+{
+    const char* s   = val->data;
+    const char* bar = memchr(s, '|', val->size);
+    if(!bar) return -EBADMSG;
+
+    const char*  p = field == 0 ? s : bar + 1;
+    const size_t n = field == 0 ? (size_t)(bar - s) : val->size - (size_t)(bar + 1 - s);
+    if(n == 1 && *p == '-') return 1;
+    if(n > *out_size) return -ENOBUFS;
+    memcpy(out, p, n);
+    *out_size = n;
+    return 0;
+}
+
+static int ut_mail(const db_view_t* key, const db_view_t* val, void* out, size_t* out_size,
+                   void* ctx)
+{
+    (void)key;
+    (void)ctx;
+    return ut_field(val, 0, out, out_size);
+}
+
+static int ut_tag(const db_view_t* key, const db_view_t* val, void* out, size_t* out_size,
+                  void* ctx)
+{
+    (void)key;
+    (void)ctx;
+    return ut_field(val, 1, out, out_size);
+}
+
+static const db_index_t k_mail = { UT_USERS, UT_MAIL, ut_mail, NULL };
+static const db_index_t k_tag  = { UT_USERS, UT_TAG, ut_tag, NULL };
+
+/* Store id -> val through the index hooks, as _exec_indexed does */
+static int ut_write(const char* id, const char* val)
+{
+    MDB_val          k   = { strlen(id), (void*)id };
+    ops_index_keys_t old;
+    int              err = 0;
+
+    if(ops_index_before(g_txn, UT_USERS, &k, &old, &err) != DB_SAFETY_SUCCESS) return err;
+    if(val)
+    {
+        MDB_val v = { strlen(val), (void*)val };
+        assert_int_equal(ut_put(g_txn, UT_USERS, &k, &v, 0), MDB_SUCCESS);
+        if(ops_index_after(g_txn, UT_USERS, &k, &v, &old, &err) != DB_SAFETY_SUCCESS)
+        {
+            return err;
+        }
+        return 0;
+    }
+    (void)ut_del(g_txn, UT_USERS, &k, NULL);
+    if(ops_index_after(g_txn, UT_USERS, &k, NULL, &old, &err) != DB_SAFETY_SUCCESS) return err;
+    return 0;
+}
+
+static int ut_has(const unsigned dbi, const char* key, const char* val)
+{
+    MDB_val k = { strlen(key), (void*)key };
+    MDB_val v = { strlen(val), (void*)val };
+    return ut_find(dbi, &k, &v) != NULL;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    g_ut_mdb_get       = ut_get;
+    g_ut_mdb_put       = ut_put;
+    g_ut_mdb_del       = ut_del;
+    g_ut_mdb_txn_abort = ut_abort;
+    g_aborts           = 0;
+    g_n_recs           = 0;
+
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    for(unsigned i = 0; i < UT_DBIS; i++) g_dbis[i].dbi = i;
+    g_dbis[UT_MAIL].put_flags = MDB_NOOVERWRITE;
+    g_dbis[UT_TAG].is_dupsort = 1;
+    g_db.dbis                 = g_dbis;
+    g_db.n_dbis               = UT_DBIS;
+    DataBase                  = &g_db;
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_index_reset();
+    DataBase = NULL;
+    ut_reset_lmdb_stubs();
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_index_add() tests                                                     */
+/* ------------------------------------------------------------------------- */
+
+static void test_index_add_validates(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_index_add(NULL), -EINVAL);
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_USERS, UT_USERS, ut_mail, NULL }), -EINVAL);
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_USERS, UT_DBIS, ut_mail, NULL }), -EINVAL);
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_USERS, UT_MAIL, NULL, NULL }), -EINVAL);
+    /* DUPSORT source: a key has no single value */
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_TAG, UT_SPARE, ut_mail, NULL }), -EINVAL);
+
+    assert_int_equal(ops_index_add(&k_mail), 0);
+    assert_int_equal(ops_index_add(&k_mail), -EEXIST);
+    assert_int_equal(ops_index_targets(UT_USERS), 1u << UT_MAIL);
+    assert_int_equal(ops_index_targets(UT_MAIL), 0u);
+
+    /* No chains either way */
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_MAIL, UT_SPARE, ut_mail, NULL }), -EINVAL);
+    assert_int_equal(ops_index_add(&(db_index_t){ UT_SPARE, UT_USERS, ut_mail, NULL }), -EINVAL);
+
+    ops_index_reset();
+    assert_int_equal(ops_index_targets(UT_USERS), 0u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_index_before() / ops_index_after() tests                              */
+/* ------------------------------------------------------------------------- */
+
+static void test_index_follows_puts_and_dels(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_index_add(&k_mail), 0);
+    assert_int_equal(ops_index_add(&k_tag), 0);
+
+    assert_int_equal(ut_write("u1", "a@x|admin"), 0);
+    assert_int_equal(ut_write("u2", "b@x|admin"), 0);
+    assert_true(ut_has(UT_MAIL, "a@x", "u1"));
+    assert_true(ut_has(UT_MAIL, "b@x", "u2"));
+    assert_true(ut_has(UT_TAG, "admin", "u1"));
+    assert_true(ut_has(UT_TAG, "admin", "u2"));
+
+    /* New mail moves its entry, the unchanged tag is left alone */
+    assert_int_equal(ut_write("u1", "c@x|admin"), 0);
+    assert_false(ut_has(UT_MAIL, "a@x", "u1"));
+    assert_true(ut_has(UT_MAIL, "c@x", "u1"));
+    assert_true(ut_has(UT_TAG, "admin", "u1"));
+
+    /* DUPSORT index: only this record's dup goes */
+    assert_int_equal(ut_write("u1", "c@x|-"), 0);
+    assert_false(ut_has(UT_TAG, "admin", "u1"));
+    assert_true(ut_has(UT_TAG, "admin", "u2"));
+
+    assert_int_equal(ut_write("u2", NULL), 0);
+    assert_false(ut_has(UT_MAIL, "b@x", "u2"));
+    assert_false(ut_has(UT_TAG, "admin", "u2"));
+    assert_int_equal(g_aborts, 0);
+
+    /* Records of u1 and its mail entry only */
+    assert_int_equal(g_n_recs, 2u);
+}
+
+static void test_index_unique_conflict_fails_batch(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_index_add(&k_mail), 0);
+    assert_int_equal(ut_write("u1", "a@x|t"), 0);
+
+    /* Rewriting the same record is no conflict */
+    assert_int_equal(ut_write("u1", "a@x|t"), 0);
+    assert_int_equal(g_aborts, 0);
+
+    assert_int_equal(ut_write("u2", "a@x|t"), -EEXIST);
+    assert_int_equal(g_aborts, 1);
+    assert_true(ut_has(UT_MAIL, "a@x", "u1"));
+}
+
+static void test_index_callback_error_fails_batch(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_index_add(&k_mail), 0);
+
+    /* No '|': the callback rejects the new value */
+    assert_int_equal(ut_write("u1", "garbage"), -EBADMSG);
+    assert_int_equal(g_aborts, 1);
+
+    /* ... and the old one, before the write */
+    assert_int_equal(ut_write("u1", "a@x|t"), -EBADMSG);
+    assert_int_equal(g_aborts, 2);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_index_add_validates, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_index_follows_puts_and_dels, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_index_unique_conflict_fails_batch, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_index_callback_error_fails_batch, ut_setup,
+                                        ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -3,6 +3,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -18,7 +19,7 @@
 /* ------------------------------------------------------------------------- */
 
 /* Include ops_init.c with static stripped so we can exercise internal
- * helpers (e.g. _ensure_env_dir) while still compiling the same code
+ * helpers (e.g. _db_open_env) while still compiling the same code
  * as production. */
 #define static
 #include "app/src/core/operations/ops_int/ops_init.c"
@@ -175,7 +176,7 @@ static void test_db_set_map_size_success(void** state)
     DataBase              = &db;
 
     int err = 0;
-    db_security_ret_code_t rc = _db_set_map_size(&err);
+    db_security_ret_code_t rc = _db_set_map_size((size_t)DB_MAP_SIZE_INIT, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, 0);
@@ -198,7 +199,7 @@ static void test_db_set_map_size_lmdb_error_uses_security_check(void** state)
     g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_fail_panic;
 
     int err = 0;
-    db_security_ret_code_t rc = _db_set_map_size(&err);
+    db_security_ret_code_t rc = _db_set_map_size((size_t)DB_MAP_SIZE_INIT, &err);
 
     assert_int_equal(rc, DB_SAFETY_FAIL);
     assert_int_equal(err, -EIO); /* MDB_PANIC -> -EIO */
@@ -299,7 +300,7 @@ static void test_db_create_env_success_sets_env_handle(void** state)
 }
 
 /* ------------------------------------------------------------------------- */
-/* _db_open_env() and _ensure_env_dir() tests                                */
+/* _db_open_env() and ops_init_env_dir() tests                              */
 /* ------------------------------------------------------------------------- */
 
 static void test_db_open_env_rejects_null_path(void** state)
@@ -309,7 +310,7 @@ static void test_db_open_env_rejects_null_path(void** state)
     ut_reset_all();
 
     int err = 0;
-    db_security_ret_code_t rc = _db_open_env(NULL, 0600u, &err);
+    db_security_ret_code_t rc = _db_open_env(NULL, 0600u, 0u, &err);
 
     assert_int_equal(rc, DB_SAFETY_FAIL);
     assert_int_equal(err, -EINVAL);
@@ -328,7 +329,7 @@ static void test_ensure_env_dir_rejects_non_directory_path(void** state)
     assert_non_null(f);
     fclose(f);
 
-    int rc = _ensure_env_dir(path);
+    int rc = ops_init_env_dir(path);
     assert_int_equal(rc, -ENOTDIR);
 
     ut_rm_path(path);
@@ -345,7 +346,7 @@ static void test_ensure_env_dir_rejects_world_readable_dir(void** state)
 
     assert_int_equal(mkdir(path, 0755), 0);
 
-    int rc = _ensure_env_dir(path);
+    int rc = ops_init_env_dir(path);
     assert_int_equal(rc, -EACCES);
 
     ut_rm_path(path);
@@ -360,7 +361,7 @@ static void test_ensure_env_dir_creates_directory_with_strict_perms(void** state
     const char* path = "tests/UT/tmp_ops_init_dir";
     ut_rm_path(path);
 
-    int rc = _ensure_env_dir(path);
+    int rc = ops_init_env_dir(path);
     assert_int_equal(rc, 0);
 
     struct stat st;
@@ -400,7 +401,7 @@ static void test_db_open_env_propagates_lmdb_error_via_security_check(void** sta
     ut_rm_path(path);
 
     int err = 0;
-    db_security_ret_code_t rc = _db_open_env(path, 0600u, &err);
+    db_security_ret_code_t rc = _db_open_env(path, 0600u, 0u, &err);
 
     assert_int_equal(rc, DB_SAFETY_FAIL);
     assert_int_equal(err, -EPROTO); /* MDB_INCOMPATIBLE -> -EPROTO */
@@ -658,8 +659,12 @@ static void test_ops_init_env_success_happy_path(void** state)
     const char* path = "tests/UT/tmp_ops_init_env_full";
     ut_rm_path(path);
 
+    db_env_cfg_t cfg;
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+    cfg.max_dbis = 4u;
+
     int err = -1;
-    db_security_ret_code_t rc = ops_init_env(4u, path, 0600u, &err);
+    db_security_ret_code_t rc = ops_init_env(&cfg, path, 0600u, &err);
 
     assert_int_equal(rc, DB_SAFETY_SUCCESS);
     assert_int_equal(err, -1);
@@ -668,6 +673,175 @@ static void test_ops_init_env_success_happy_path(void** state)
     ut_rm_path(path);
 }
 
+static unsigned int g_open_flags   = 0u;
+static unsigned int g_max_readers  = 0u;
+static int          g_sync_calls   = 0;
+static int          g_sync_forced  = 1;
+
+static int ut_env_open_capture_flags(MDB_env* env, const char* path, unsigned int flags,
+                                     mdb_mode_t mode)
+{
+    (void)env;
+    (void)path;
+    (void)mode;
+    g_open_flags = flags;
+    return MDB_SUCCESS;
+}
+
+static int ut_env_set_maxreaders_capture(MDB_env* env, unsigned int readers)
+{
+    (void)env;
+    g_max_readers = readers;
+    return MDB_SUCCESS;
+}
+
+static int ut_env_sync_count(MDB_env* env, int force)
+{
+    (void)env;
+    __atomic_fetch_add(&g_sync_calls, 1, __ATOMIC_SEQ_CST);
+    if(!force) g_sync_forced = 0;
+    return MDB_SUCCESS;
+}
+
+static void test_env_profiles_and_resolve_overrides(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    db_env_cfg_t out;
+
+    /* NULL selects the durable profile, today's db_core_init setup */
+    assert_int_equal(ops_env_cfg_resolve(NULL, &out), 0);
+    assert_int_equal(out.profile, DB_ENV_PROFILE_DURABLE);
+    assert_int_equal(out.opts, DB_ENV_OPT_NONE);
+    assert_int_equal(out.map_size_init, (size_t)DB_MAP_SIZE_INIT);
+    assert_int_equal(out.map_size_max, (size_t)DB_MAP_SIZE_MAX);
+    assert_int_equal(out.map_grow_step, (size_t)DB_MAP_GROW_STEP);
+    assert_int_equal(out.max_dbis, DB_MAX_DBIS);
+    assert_int_equal(out.sync_ms, 0u);
+
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_FAST_ASYNC, &out), 0);
+    assert_int_equal(out.opts, DB_ENV_OPT_NOSYNC);
+    assert_int_equal(out.sync_ms, DB_LMDB_ENV_SYNC_MS);
+
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_READ_MOSTLY, &out), 0);
+    assert_int_equal(out.opts, DB_ENV_OPT_NORDAHEAD);
+    assert_int_equal(out.max_readers, DB_LMDB_ENV_READERS_RO);
+
+    /* Zero fields keep the profile, options are OR'ed */
+    db_env_cfg_t cfg  = { 0 };
+    cfg.profile       = DB_ENV_PROFILE_READ_MOSTLY;
+    cfg.opts          = DB_ENV_OPT_WRITEMAP;
+    cfg.map_size_max  = GiB(4);
+    cfg.map_grow_step = MiB(512);
+    assert_int_equal(ops_env_cfg_resolve(&cfg, &out), 0);
+    assert_int_equal(out.opts, DB_ENV_OPT_NORDAHEAD | DB_ENV_OPT_WRITEMAP);
+    assert_int_equal(out.map_size_max, GiB(4));
+    assert_int_equal(out.map_grow_step, MiB(512));
+    assert_int_equal(out.map_size_init, (size_t)DB_MAP_SIZE_INIT);
+    assert_int_equal(out.max_readers, DB_LMDB_ENV_READERS_RO);
+
+    /* NOSYNC on a durable base still gets a syncer period */
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.opts = DB_ENV_OPT_NOMETASYNC;
+    assert_int_equal(ops_env_cfg_resolve(&cfg, &out), 0);
+    assert_int_equal(out.sync_ms, DB_LMDB_ENV_SYNC_MS);
+
+    /* Bad setups */
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.map_size_init = GiB(2);
+    cfg.map_size_max  = GiB(1);
+    assert_int_equal(ops_env_cfg_resolve(&cfg, &out), -EINVAL);
+    cfg.map_size_init = 0u;
+    cfg.profile       = DB_ENV_PROFILE_MAX;
+    assert_int_equal(ops_env_cfg_resolve(&cfg, &out), -EINVAL);
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_DURABLE, NULL), -EINVAL);
+}
+
+static void test_ops_init_env_applies_profile_flags_and_readers(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    static DataBase_t db;
+    memset(&db, 0, sizeof(db));
+    DataBase = &db;
+
+    g_ut_mdb_env_create         = ut_env_create_assign;
+    g_ut_mdb_env_set_maxdbs     = ut_env_set_maxdbs_ok;
+    g_ut_mdb_env_set_mapsize    = ut_env_set_mapsize_ok;
+    g_ut_mdb_env_open           = ut_env_open_capture_flags;
+    g_ut_mdb_env_set_maxreaders = ut_env_set_maxreaders_capture;
+
+    const char* path = "tests/UT/tmp_ops_init_env_profile";
+    ut_rm_path(path);
+
+    db_env_cfg_t cfg;
+    int          err = 0;
+    g_max_readers    = 0u;
+
+    /* Durable: MDB_NOTLS only, LMDB default readers */
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_DURABLE, &cfg), 0);
+    assert_int_equal(ops_init_env(&cfg, path, 0600u, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(g_open_flags, (unsigned)MDB_NOTLS);
+    assert_int_equal(g_max_readers, 0u);
+
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_READ_MOSTLY, &cfg), 0);
+    cfg.opts |= DB_ENV_OPT_WRITEMAP;
+    assert_int_equal(ops_init_env(&cfg, path, 0600u, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(g_open_flags, (unsigned)(MDB_NOTLS | MDB_NORDAHEAD | MDB_WRITEMAP));
+    assert_int_equal(g_max_readers, DB_LMDB_ENV_READERS_RO);
+
+    assert_int_equal(ops_env_profile(DB_ENV_PROFILE_FAST_ASYNC, &cfg), 0);
+    cfg.opts |= DB_ENV_OPT_NOMETASYNC;
+    assert_int_equal(ops_init_env(&cfg, path, 0600u, &err), DB_SAFETY_SUCCESS);
+    assert_int_equal(g_open_flags, (unsigned)(MDB_NOTLS | MDB_NOSYNC | MDB_NOMETASYNC));
+
+    /* No setup */
+    assert_int_equal(ops_init_env(NULL, path, 0600u, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+
+    ut_rm_path(path);
+}
+
+static void test_env_syncer_syncs_periodically_and_on_stop(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    static DataBase_t db;
+    memset(&db, 0, sizeof(db));
+    db.env   = (MDB_env*)0x50;
+    DataBase = &db;
+
+    g_ut_mdb_env_sync = ut_env_sync_count;
+    g_sync_calls      = 0;
+    g_sync_forced     = 1;
+
+    assert_int_equal(ops_env_sync_start(0u), -EINVAL);
+    assert_int_equal(ops_env_sync_start(5u), 0);
+    assert_int_equal(ops_env_sync_start(5u), -EALREADY);
+
+    /* A few periods go by */
+    while(__atomic_load_n(&g_sync_calls, __ATOMIC_SEQ_CST) < 2)
+    {
+        usleep(1000);
+    }
+
+    int before_stop = __atomic_load_n(&g_sync_calls, __ATOMIC_SEQ_CST);
+    ops_env_sync_stop();
+    assert_true(g_sync_calls >= before_stop + 1); /* final sync */
+    assert_int_equal(g_sync_forced, 1);
+
+    /* Stop again is a no-op */
+    int after_stop = g_sync_calls;
+    ops_env_sync_stop();
+    assert_int_equal(g_sync_calls, after_stop);
+}
+
 static void test_ops_init_dbi_success_configures_cached_flags(void** state)
 {
     (void)state;
@@ -735,6 +909,171 @@ static void test_ops_init_dbi_rejects_invalid_input(void** state)
     assert_int_equal(err, -EINVAL);
 }
 
+static int ut_dbi_flags_integer(MDB_txn* txn, MDB_dbi dbi, unsigned int* flags)
+{
+    (void)txn;
+    (void)dbi;
+    *flags = MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_INTEGERDUP;
+    return MDB_SUCCESS;
+}
+
+static void test_ops_init_dbi_sets_integer_type_bits(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    static dbi_t      dbis[1];
+    static DataBase_t db;
+
+    db.env                = (MDB_env*)0x50;
+    db.dbis               = dbis;
+    db.n_dbis             = 1u;
+    db.map_size_bytes_max = (size_t)DB_MAP_SIZE_MAX;
+    DataBase              = &db;
+
+    g_ut_mdb_dbi_open  = ut_dbi_open_success;
+    g_ut_mdb_dbi_flags = ut_dbi_flags_integer;
+
+    int err = 0;
+    db_security_ret_code_t rc = ops_init_dbi((MDB_txn*)0x51, "ints", 0u,
+                                             DBI_TYPE_INTEGERKEY | DBI_TYPE_INTEGERDUP, &err);
+
+    assert_int_equal(rc, DB_SAFETY_SUCCESS);
+    assert_int_equal(dbis[0].is_intkey, 1u);
+    assert_int_equal(dbis[0].is_intdup, 1u);
+    assert_int_equal(dbis[0].is_dupsort, 1u);
+}
+
+static MDB_cmp_func* g_set_key_cmp = NULL;
+static MDB_cmp_func* g_set_dup_cmp = NULL;
+static int           g_set_rc      = MDB_SUCCESS;
+
+static int ut_set_compare(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp)
+{
+    (void)txn;
+    (void)dbi;
+    g_set_key_cmp = cmp;
+    return g_set_rc;
+}
+
+static int ut_set_dupsort(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp)
+{
+    (void)txn;
+    (void)dbi;
+    g_set_dup_cmp = cmp;
+    return g_set_rc;
+}
+
+/* Reverse byte order, to tell the user order from memcmp */
+static int ut_reverse_cmp(const db_view_t* a, const db_view_t* b)
+{
+    const size_t n = a->size < b->size ? a->size : b->size;
+    const int    r = memcmp(a->data, b->data, n);
+    return r ? -r : (a->size > b->size) - (a->size < b->size);
+}
+
+static void ut_order_db(dbi_t* dbis, DataBase_t* db)
+{
+    memset(dbis, 0, 2u * sizeof(*dbis));
+    db->env    = (MDB_env*)0x60;
+    db->dbis   = dbis;
+    db->n_dbis = 2u;
+    DataBase   = db;
+
+    dbis[0].dbi        = 7u;
+    dbis[0].is_dupsort = 1u;
+    dbis[1].dbi        = 8u;
+    dbis[1].is_intkey  = 1u;
+
+    g_set_key_cmp        = NULL;
+    g_set_dup_cmp        = NULL;
+    g_set_rc             = MDB_SUCCESS;
+    g_ut_mdb_set_compare = ut_set_compare;
+    g_ut_mdb_set_dupsort = ut_set_dupsort;
+}
+
+static void test_ops_init_dbi_order_installs_trampolines(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+
+    static dbi_t      dbis[2];
+    static DataBase_t db;
+    ut_order_db(dbis, &db);
+
+    int err = 0;
+    db_security_ret_code_t rc =
+        ops_init_dbi_order((MDB_txn*)0x61, 0u, ut_reverse_cmp, ut_reverse_cmp, &err);
+
+    assert_int_equal(rc, DB_SAFETY_SUCCESS);
+    assert_non_null(g_set_key_cmp);
+    assert_non_null(g_set_dup_cmp);
+
+    /* The installed LMDB callbacks run the user order */
+    MDB_val a = { 2u, "ab" };
+    MDB_val b = { 2u, "ac" };
+    assert_true(g_set_key_cmp(&a, &b) > 0);
+    assert_true(g_set_dup_cmp(&b, &a) < 0);
+    assert_int_equal(g_set_key_cmp(&a, &a), 0);
+}
+
+static void test_ops_init_dbi_order_rejects_integer_and_plain_dbis(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    reset_abort_tracking();
+
+    static dbi_t      dbis[2];
+    static DataBase_t db;
+    ut_order_db(dbis, &db);
+
+    MDB_txn* txn = (MDB_txn*)0x62;
+    int      err = 0;
+
+    /* Integer keys keep their numeric order */
+    assert_int_equal(ops_init_dbi_order(txn, 1u, ut_reverse_cmp, NULL, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+
+    /* No dups to order without DUPSORT */
+    err = 0;
+    assert_int_equal(ops_init_dbi_order(txn, 1u, NULL, ut_reverse_cmp, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+
+    err = 0;
+    assert_int_equal(ops_init_dbi_order(txn, 2u, ut_reverse_cmp, NULL, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+
+    /* Each refusal ends the write txn, so the writer lock is released */
+    assert_int_equal(g_abort_calls, 3);
+    assert_ptr_equal(g_last_aborted_txn, txn);
+    assert_null(g_set_key_cmp);
+    assert_null(g_set_dup_cmp);
+}
+
+static void test_ops_init_dbi_order_lmdb_error_uses_security_check(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    reset_abort_tracking();
+
+    static dbi_t      dbis[2];
+    static DataBase_t db;
+    ut_order_db(dbis, &db);
+    g_set_rc = EINVAL;
+
+    MDB_txn* txn = (MDB_txn*)0x63;
+    int      err = 0;
+    db_security_ret_code_t rc = ops_init_dbi_order(txn, 0u, ut_reverse_cmp, NULL, &err);
+
+    assert_int_not_equal(rc, DB_SAFETY_SUCCESS);
+    assert_int_equal(err, -EINVAL);
+    assert_int_equal(g_abort_calls, 1);
+}
+
 /* ------------------------------------------------------------------------- */
 /* Main                                                                      */
 /* ------------------------------------------------------------------------- */
@@ -762,8 +1101,15 @@ int main(void)
         cmocka_unit_test(test_dbi_get_flags_success_populates_dbi_flags),
         cmocka_unit_test(test_dbi_get_flags_lmdb_error_uses_security_check_and_aborts_txn),
         cmocka_unit_test(test_ops_init_env_success_happy_path),
+        cmocka_unit_test(test_env_profiles_and_resolve_overrides),
+        cmocka_unit_test(test_ops_init_env_applies_profile_flags_and_readers),
+        cmocka_unit_test(test_env_syncer_syncs_periodically_and_on_stop),
         cmocka_unit_test(test_ops_init_dbi_success_configures_cached_flags),
         cmocka_unit_test(test_ops_init_dbi_rejects_invalid_input),
+        cmocka_unit_test(test_ops_init_dbi_sets_integer_type_bits),
+        cmocka_unit_test(test_ops_init_dbi_order_installs_trampolines),
+        cmocka_unit_test(test_ops_init_dbi_order_rejects_integer_and_plain_dbis),
+        cmocka_unit_test(test_ops_init_dbi_order_lmdb_error_uses_security_check),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
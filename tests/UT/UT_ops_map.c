@@ -0,0 +1,359 @@
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_map.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+#define UT_PAGE 4096u
+
+static DataBase_t g_db;
+
+/* Fake env: the map size follows mdb_env_set_mapsize */
+static size_t g_mapsize           = 0;
+static size_t g_last_pgno         = 0;
+static int    g_set_mapsize_rc    = MDB_SUCCESS;
+static size_t g_set_mapsize_calls = 0;
+
+static int ut_env_info(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_mapsize   = g_mapsize;
+    info->me_last_pgno = g_last_pgno;
+    return MDB_SUCCESS;
+}
+
+static int ut_env_set_mapsize(MDB_env* env, size_t size)
+{
+    (void)env;
+    g_set_mapsize_calls++;
+    if(g_set_mapsize_rc != MDB_SUCCESS) return g_set_mapsize_rc;
+    g_mapsize = size;
+    return MDB_SUCCESS;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    g_db.env                = (MDB_env*)0x1;
+    g_db.map_size_bytes_max = 64u * UT_PAGE;
+    DataBase                = &g_db;
+
+    g_mapsize                = 16u * UT_PAGE;
+    g_last_pgno              = 3u; /* 4 pages in use */
+    g_set_mapsize_rc         = MDB_SUCCESS;
+    g_set_mapsize_calls      = 0;
+    g_ut_mdb_env_info        = ut_env_info;
+    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize;
+
+    /* 4 pages per step, default page size from the env_stat stub */
+    ops_map_configure(4u * UT_PAGE);
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    DataBase = NULL;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_map_after_commit() tests                                              */
+/* ------------------------------------------------------------------------- */
+
+static void test_map_after_commit_grows_one_step_when_low(void** state)
+{
+    (void)state;
+
+    /* 12 pages free: nothing to do */
+    ops_map_after_commit();
+    assert_int_equal(g_set_mapsize_calls, 0u);
+
+    /* 3 pages free, less than a step */
+    g_last_pgno = 12u;
+    ops_map_after_commit();
+    assert_int_equal(g_set_mapsize_calls, 1u);
+    assert_int_equal(g_mapsize, 20u * UT_PAGE);
+
+    /* Near the ceiling the last step is partial, then it stops */
+    g_db.map_size_bytes_max = 22u * UT_PAGE;
+    g_last_pgno             = 18u;
+    ops_map_after_commit();
+    assert_int_equal(g_mapsize, 22u * UT_PAGE);
+    g_last_pgno = 20u;
+    ops_map_after_commit();
+    assert_int_equal(g_set_mapsize_calls, 2u);
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.map_size, 22u * UT_PAGE);
+    assert_int_equal(st.used, 21u * UT_PAGE);
+    assert_int_equal(st.map_max, 22u * UT_PAGE);
+    assert_int_equal(st.grows, 2u);
+    assert_int_equal(st.full_grows, 0u);
+    assert_int_equal(st.deferred, 0u);
+}
+
+static void test_map_after_commit_defers_while_gate_held(void** state)
+{
+    (void)state;
+
+    g_last_pgno = 14u;
+
+    /* An open txn (here on this very thread): never wait, try next time */
+    ops_map_enter();
+    ops_map_after_commit();
+    assert_int_equal(g_set_mapsize_calls, 0u);
+    ops_map_leave();
+
+    ops_map_after_commit();
+    assert_int_equal(g_mapsize, 20u * UT_PAGE);
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.deferred, 1u);
+    assert_int_equal(st.grows, 1u);
+
+    /* Configure starts the counters over */
+    ops_map_configure(0u);
+    ops_map_stats(&st);
+    assert_int_equal(st.deferred, 0u);
+    assert_int_equal(st.grows, 0u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_map_on_full() / ops_map_reserve() tests                               */
+/* ------------------------------------------------------------------------- */
+
+static void test_map_on_full_grows_by_increasing_steps_up_to_max(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_map_on_full(0u), 0);
+    assert_int_equal(g_mapsize, 20u * UT_PAGE);
+    assert_int_equal(ops_map_on_full(2u), 0);
+    assert_int_equal(g_mapsize, 36u * UT_PAGE);
+
+    /* Capped, then out of room */
+    assert_int_equal(ops_map_on_full(4u), 0);
+    assert_int_equal(g_mapsize, 64u * UT_PAGE);
+    assert_int_equal(ops_map_on_full(0u), -ENOSPC);
+    assert_int_equal(g_set_mapsize_calls, 3u);
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.full_grows, 3u);
+}
+
+static void test_map_on_full_reports_busy_gate_and_lmdb_errors(void** state)
+{
+    (void)state;
+
+    /* The caller still inside the gate would wait for itself: refused at once */
+    ops_map_enter();
+    assert_int_equal(ops_map_on_full(0u), -EBUSY);
+    ops_map_leave();
+    assert_int_equal(g_set_mapsize_calls, 0u);
+
+    g_set_mapsize_rc = MDB_PANIC;
+    assert_int_equal(ops_map_on_full(0u), -EIO);
+    g_set_mapsize_rc = EINVAL;
+    assert_int_equal(ops_map_on_full(0u), -EINVAL);
+    assert_int_equal(g_mapsize, 16u * UT_PAGE);
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.full_grows, 0u);
+}
+
+static void test_map_reserve_grows_to_size_within_max(void** state)
+{
+    (void)state;
+
+    /* Large enough already */
+    assert_int_equal(ops_map_reserve(8u * UT_PAGE), 0);
+    assert_int_equal(g_set_mapsize_calls, 0u);
+
+    assert_int_equal(ops_map_reserve(40u * UT_PAGE), 0);
+    assert_int_equal(g_mapsize, 40u * UT_PAGE);
+    assert_int_equal(ops_map_reserve(65u * UT_PAGE), -ENOSPC);
+    assert_int_equal(g_set_mapsize_calls, 1u);
+
+    /* No database */
+    DataBase = NULL;
+    assert_int_equal(ops_map_reserve(UT_PAGE), -EINVAL);
+    assert_int_equal(ops_map_on_full(0u), -EINVAL);
+    ops_map_after_commit();
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.map_size, 0u);
+    assert_int_equal(st.map_max, 0u);
+    ops_map_stats(NULL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Gate under reader load                                                    */
+/* ------------------------------------------------------------------------- */
+
+static atomic_int    g_readers_stop = 0;
+static atomic_size_t g_reader_laps  = 0;
+
+/* Overlapping txns, each entering twice like a read batch under a lease */
+static void* ut_reader_main(void* arg)
+{
+    (void)arg;
+    while(!atomic_load(&g_readers_stop))
+    {
+        ops_map_enter();
+        ops_map_enter();
+        usleep(2000);
+        ops_map_leave();
+        ops_map_leave();
+        atomic_fetch_add(&g_reader_laps, 1);
+    }
+    return NULL;
+}
+
+static void ut_wait_laps(const size_t n)
+{
+    const size_t from = atomic_load(&g_reader_laps);
+    while(atomic_load(&g_reader_laps) < from + n)
+    {
+        usleep(500);
+    }
+}
+
+static void test_map_grows_while_readers_hold_the_gate(void** state)
+{
+    (void)state;
+
+    enum { N = 4 };
+    pthread_t readers[N];
+    atomic_store(&g_readers_stop, 0);
+    atomic_store(&g_reader_laps, 0);
+    for(int i = 0; i < N; i++)
+    {
+        assert_int_equal(pthread_create(&readers[i], NULL, ut_reader_main, NULL), 0);
+    }
+    ut_wait_laps(2u * N);
+
+    /* The gate is never empty, yet the waiting resize gets it */
+    assert_int_equal(ops_map_on_full(0u), 0);
+    assert_int_equal(g_mapsize, 20u * UT_PAGE);
+    ut_wait_laps(2u * N);
+
+    /* Under half a step free: the commit waits for its growth */
+    g_last_pgno = 18u;
+    ops_map_after_commit();
+    assert_int_equal(g_mapsize, 24u * UT_PAGE);
+
+    /* Nested entries of the readers never blocked behind the resizes */
+    ut_wait_laps(2u * N);
+    atomic_store(&g_readers_stop, 1);
+    for(int i = 0; i < N; i++)
+    {
+        pthread_join(readers[i], NULL);
+    }
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.full_grows, 1u);
+    assert_int_equal(st.grows, 1u);
+    assert_int_equal(st.deferred, 0u);
+    assert_int_equal(g_set_mapsize_calls, 2u);
+}
+
+static atomic_int g_long_in   = 0;
+static atomic_int g_long_stop = 0;
+
+/* A backup copy: one hold for as long as the test wants */
+static void* ut_long_main(void* arg)
+{
+    (void)arg;
+    ops_map_enter_long();
+    atomic_store(&g_long_in, 1);
+    while(!atomic_load(&g_long_stop))
+    {
+        usleep(500);
+    }
+    ops_map_leave_long();
+    return NULL;
+}
+
+static void test_map_long_hold_refuses_growth_without_waiting(void** state)
+{
+    (void)state;
+
+    pthread_t holder;
+    atomic_store(&g_long_in, 0);
+    atomic_store(&g_long_stop, 0);
+    assert_int_equal(pthread_create(&holder, NULL, ut_long_main, NULL), 0);
+    while(!atomic_load(&g_long_in))
+    {
+        usleep(500);
+    }
+
+    /* Waiting would only stall every new txn behind the resize: one try */
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    assert_int_equal(ops_map_on_full(0u), -EBUSY);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    const long ms = (t1.tv_sec - t0.tv_sec) * 1000L + (t1.tv_nsec - t0.tv_nsec) / 1000000L;
+    assert_true(ms < (long)DB_LMDB_MAP_GROW_WAIT_MS / 2);
+
+    atomic_store(&g_long_stop, 1);
+    pthread_join(holder, NULL);
+
+    /* Once it ends, growths wait and succeed again */
+    assert_int_equal(ops_map_on_full(0u), 0);
+    assert_int_equal(g_mapsize, 20u * UT_PAGE);
+
+    db_map_stats_t st;
+    ops_map_stats(&st);
+    assert_int_equal(st.full_refused, 1u);
+    assert_int_equal(st.full_grows, 1u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_map_after_commit_grows_one_step_when_low, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_after_commit_defers_while_gate_held, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_on_full_grows_by_increasing_steps_up_to_max,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_on_full_reports_busy_gate_and_lmdb_errors,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_reserve_grows_to_size_within_max, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_grows_while_readers_hold_the_gate, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_map_long_hold_refuses_growth_without_waiting,
+                                        ut_setup, ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,587 @@
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_init.h"
+#include "core/operations/ops_int/ops_shard.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for the ops_init helpers                                */
+/* ------------------------------------------------------------------------- */
+
+/* ops_init is tested in its own UT suite */
+
+#define UT_MAP_INIT (1u << 20)
+#define UT_MAP_STEP (1u << 20)
+
+static size_t g_map_max = 4u << 20;
+
+int ops_init_env_dir(const char* const path)
+{
+    return path ? 0 : -EINVAL;
+}
+
+unsigned int ops_env_flags(const unsigned opts)
+{
+    (void)opts;
+    return 0u;
+}
+
+int ops_env_cfg_resolve(const db_env_cfg_t* const cfg, db_env_cfg_t* const out)
+{
+    memset(out, 0, sizeof(*out));
+    if(cfg) *out = *cfg;
+    if(!out->map_size_init) out->map_size_init = UT_MAP_INIT;
+    if(!out->map_size_max) out->map_size_max = g_map_max;
+    if(!out->map_grow_step) out->map_grow_step = UT_MAP_STEP;
+    if(!out->max_dbis) out->max_dbis = DB_MAX_DBIS;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake LMDB: one small key/value store per env, writes kept per txn         */
+/* ------------------------------------------------------------------------- */
+
+/* Writer threads call the stubs concurrently: one lock, no cmocka inside.
+ * Keys and values are short strings. */
+
+#define UT_ENVS    DB_LMDB_SHARDS_MAX
+#define UT_ENTRIES 128
+#define UT_STR     24
+
+typedef struct
+{
+    char key[UT_STR];
+    char val[UT_STR];
+} ut_kv_t;
+
+typedef struct ut_txn
+{
+    int            env;
+    struct ut_txn* parent;
+    int            n;
+    ut_kv_t        kv[UT_ENTRIES];
+} ut_txn_t;
+
+typedef struct
+{
+    int      n;
+    ut_kv_t  kv[UT_ENTRIES];
+    int      opened;
+    int      closed;
+    int      commits;  /* top-level commits */
+    int      full;     /* next puts failing with MDB_MAP_FULL */
+    size_t   map_size; /* last mdb_env_set_mapsize */
+    unsigned flags;    /* mdb_env_open flags */
+    int      dbis;     /* mdb_dbi_open calls */
+} ut_env_t;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static ut_env_t        g_envs[UT_ENVS];
+static int             g_n_envs = 0;
+
+static int ut_env_index(MDB_env* env)
+{
+    return (int)((uintptr_t)env - 0x1000u);
+}
+
+static ut_kv_t* ut_find(ut_kv_t* kv, const int n, const MDB_val* key)
+{
+    for(int i = 0; i < n; i++)
+    {
+        if(strlen(kv[i].key) == key->mv_size && !memcmp(kv[i].key, key->mv_data, key->mv_size))
+        {
+            return &kv[i];
+        }
+    }
+    return NULL;
+}
+
+static void ut_set(ut_kv_t* kv, int* n, const char* key, const char* val)
+{
+    MDB_val  k = { strlen(key), (void*)key };
+    ut_kv_t* e = ut_find(kv, *n, &k);
+    if(!e) e = &kv[(*n)++];
+    snprintf(e->key, UT_STR, "%s", key);
+    snprintf(e->val, UT_STR, "%s", val);
+}
+
+static int ut_create(MDB_env** env)
+{
+    pthread_mutex_lock(&g_lock);
+    *env = (MDB_env*)(uintptr_t)(0x1000u + (unsigned)g_n_envs++);
+    pthread_mutex_unlock(&g_lock);
+    return MDB_SUCCESS;
+}
+
+static void ut_close(MDB_env* env)
+{
+    g_envs[ut_env_index(env)].closed++;
+}
+
+static int ut_env_open(MDB_env* env, const char* path, unsigned int flags, mdb_mode_t mode)
+{
+    (void)path;
+    (void)mode;
+    g_envs[ut_env_index(env)].opened++;
+    g_envs[ut_env_index(env)].flags = flags;
+    return MDB_SUCCESS;
+}
+
+static int ut_set_mapsize(MDB_env* env, size_t size)
+{
+    pthread_mutex_lock(&g_lock);
+    if(size) g_envs[ut_env_index(env)].map_size = size;
+    pthread_mutex_unlock(&g_lock);
+    return MDB_SUCCESS;
+}
+
+static int ut_info(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_mapsize = UT_MAP_INIT;
+    return MDB_SUCCESS;
+}
+
+static int ut_dbi_open(MDB_txn* txn, const char* name, unsigned int flags, MDB_dbi* dbi)
+{
+    (void)name;
+    (void)flags;
+    ut_txn_t* t = (ut_txn_t*)txn;
+    *dbi        = (MDB_dbi)(g_envs[t->env].dbis++ + 1);
+    return MDB_SUCCESS;
+}
+
+static int ut_begin(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** out)
+{
+    (void)flags;
+    ut_txn_t* t = calloc(1, sizeof(*t));
+    t->env      = ut_env_index(env);
+    t->parent   = (ut_txn_t*)parent;
+    *out        = (MDB_txn*)t;
+    return MDB_SUCCESS;
+}
+
+static void ut_abort(MDB_txn* txn)
+{
+    free(txn);
+}
+
+static int ut_commit(MDB_txn* txn)
+{
+    ut_txn_t* t = (ut_txn_t*)txn;
+
+    pthread_mutex_lock(&g_lock);
+    if(t->parent)
+    {
+        ut_txn_t* p = t->parent;
+        for(int i = 0; i < t->n; i++) ut_set(p->kv, &p->n, t->kv[i].key, t->kv[i].val);
+    }
+    else
+    {
+        ut_env_t* e = &g_envs[t->env];
+        for(int i = 0; i < t->n; i++) ut_set(e->kv, &e->n, t->kv[i].key, t->kv[i].val);
+        e->commits++;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    free(t);
+    return MDB_SUCCESS;
+}
+
+static int ut_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    (void)dbi;
+    (void)flags;
+    ut_txn_t* t = (ut_txn_t*)txn;
+    char      k[UT_STR];
+    char      v[UT_STR];
+    snprintf(k, sizeof(k), "%.*s", (int)key->mv_size, (const char*)key->mv_data);
+    snprintf(v, sizeof(v), "%.*s", (int)data->mv_size, (const char*)data->mv_data);
+
+    /* "dup*" keys already exist */
+    if(!strncmp(k, "dup", 3)) return MDB_KEYEXIST;
+
+    pthread_mutex_lock(&g_lock);
+    int full = g_envs[t->env].full > 0;
+    if(full) g_envs[t->env].full--;
+    pthread_mutex_unlock(&g_lock);
+    if(full) return MDB_MAP_FULL;
+
+    ut_set(t->kv, &t->n, k, v);
+    return MDB_SUCCESS;
+}
+
+static int ut_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    (void)dbi;
+    int rc = MDB_NOTFOUND;
+
+    pthread_mutex_lock(&g_lock);
+    for(ut_txn_t* t = (ut_txn_t*)txn; t; t = t->parent)
+    {
+        ut_kv_t* e = ut_find(t->kv, t->n, key);
+        if(!t->parent && !e) e = ut_find(g_envs[t->env].kv, g_envs[t->env].n, key);
+        if(e)
+        {
+            data->mv_data = e->val;
+            data->mv_size = strlen(e->val);
+            rc            = MDB_SUCCESS;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+    return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static const char* const g_paths[] = { "/tmp/s0", "/tmp/s1", "/tmp/s2", "/tmp/s3" };
+static const char* const g_names[] = { "main", "meta" };
+static const dbi_type_t  g_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+
+static shards_t*      g_sh    = NULL;
+static shard_batch_t* g_batch = NULL;
+
+static db_shards_cfg_t ut_cfg(const unsigned n_shards)
+{
+    return (db_shards_cfg_t){ .paths     = g_paths,
+                              .n_shards  = n_shards,
+                              .dbi_names = g_names,
+                              .dbi_types = g_types,
+                              .n_dbis    = 2u };
+}
+
+/* Committed value of @p key on @p env, NULL when absent */
+static const char* ut_stored(const int env, const char* key)
+{
+    MDB_val  k = { strlen(key), (void*)key };
+    ut_kv_t* e = ut_find(g_envs[env].kv, g_envs[env].n, &k);
+    return e ? e->val : NULL;
+}
+
+/* First @p n keys "k<i>" routed to @p shard */
+static int ut_keys_of(const int shard, char keys[][UT_STR], const int n)
+{
+    int got = 0;
+    for(int i = 0; got < n && i < 10000; i++)
+    {
+        char k[UT_STR];
+        snprintf(k, sizeof(k), "k%d", i);
+        if(ops_shards_of(g_sh, k, strlen(k)) == shard) snprintf(keys[got++], UT_STR, "%s", k);
+    }
+    return got;
+}
+
+static int ut_add_put(const char* key, const char* val)
+{
+    return ops_shard_batch_add(g_batch, 0u, DB_OPERATION_PUT, key, strlen(key), val, strlen(val));
+}
+
+static void ut_open(const unsigned n_shards)
+{
+    db_shards_cfg_t cfg = ut_cfg(n_shards);
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), 0);
+
+    /* Count the commits of the batches only */
+    for(unsigned i = 0; i < UT_ENVS; i++) g_envs[i].commits = 0;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(g_envs, 0, sizeof(g_envs));
+    g_n_envs                 = 0;
+    g_map_max                = 4u << 20;
+    g_ut_mdb_env_create      = ut_create;
+    g_ut_mdb_env_close       = ut_close;
+    g_ut_mdb_env_open        = ut_env_open;
+    g_ut_mdb_env_set_mapsize = ut_set_mapsize;
+    g_ut_mdb_env_info        = ut_info;
+    g_ut_mdb_dbi_open        = ut_dbi_open;
+    g_ut_mdb_txn_begin       = ut_begin;
+    g_ut_mdb_txn_abort       = ut_abort;
+    g_ut_mdb_txn_commit      = ut_commit;
+    g_ut_mdb_put             = ut_put;
+    g_ut_mdb_get             = ut_get;
+    g_batch                  = ops_shard_batch_create();
+    return g_batch ? 0 : -1;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_shards_close(g_sh);
+    g_sh = NULL;
+    ops_shard_batch_destroy(g_batch);
+    g_batch = NULL;
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_shards_open() / ops_shards_of() tests                                 */
+/* ------------------------------------------------------------------------- */
+
+static void test_shards_open_validates_and_opens_every_env(void** state)
+{
+    (void)state;
+
+    db_shards_cfg_t cfg = ut_cfg(3u);
+    assert_int_equal(ops_shards_open(NULL, &cfg), -EINVAL);
+    assert_int_equal(ops_shards_open(&g_sh, NULL), -EINVAL);
+
+    cfg.n_shards = 0u;
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), -EINVAL);
+    cfg.n_shards = DB_LMDB_SHARDS_MAX + 1u;
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), -EINVAL);
+
+    const dbi_type_t bloom[] = { DBI_TYPE_DEFAULT, DBI_TYPE_BLOOM };
+    cfg                      = ut_cfg(3u);
+    cfg.dbi_types            = bloom;
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), -ENOTSUP);
+
+    db_env_cfg_t env = { .opts = DB_ENV_OPT_WRITEMAP };
+    cfg              = ut_cfg(3u);
+    cfg.env          = &env;
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), -ENOTSUP);
+    assert_null(g_sh);
+    assert_int_equal(g_n_envs, 0);
+
+    cfg = ut_cfg(3u);
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), 0);
+    assert_non_null(g_sh);
+    assert_int_equal(g_n_envs, 3);
+    for(int i = 0; i < 3; i++)
+    {
+        assert_int_equal(g_envs[i].opened, 1);
+        assert_int_equal(g_envs[i].dbis, 2);
+        assert_true(g_envs[i].flags & MDB_NOTLS);
+    }
+
+    ops_shards_close(g_sh);
+    g_sh = NULL;
+    for(int i = 0; i < 3; i++) assert_int_equal(g_envs[i].closed, 1);
+}
+
+static void test_shards_of_is_stable_and_spread(void** state)
+{
+    (void)state;
+
+    db_shards_cfg_t cfg = ut_cfg(4u);
+    assert_int_equal(ops_shards_open(&g_sh, &cfg), 0);
+
+    assert_int_equal(ops_shards_of(g_sh, NULL, 1u), -EINVAL);
+    assert_int_equal(ops_shards_of(g_sh, "k", 0u), -EINVAL);
+
+    int count[4] = { 0 };
+    for(int i = 0; i < 1000; i++)
+    {
+        char k[UT_STR];
+        snprintf(k, sizeof(k), "key-%d", i);
+        int s = ops_shards_of(g_sh, k, strlen(k));
+        assert_true(s >= 0 && s < 4);
+        assert_int_equal(ops_shards_of(g_sh, k, strlen(k)), s);
+        count[s]++;
+    }
+    for(int s = 0; s < 4; s++) assert_true(count[s] > 150);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_shards_exec() tests                                                   */
+/* ------------------------------------------------------------------------- */
+
+static void test_exec_single_shard_batch_is_one_txn(void** state)
+{
+    (void)state;
+
+    ut_open(4u);
+
+    char keys[3][UT_STR];
+    assert_int_equal(ut_keys_of(2, keys, 3), 3);
+    for(int i = 0; i < 3; i++) assert_int_equal(ut_add_put(keys[i], keys[i]), 0);
+
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 1), 0);
+    assert_int_equal(g_envs[2].commits, 1);
+    for(int i = 0; i < 3; i++) assert_string_equal(ut_stored(2, keys[i]), keys[i]);
+    assert_int_equal(g_envs[0].commits + g_envs[1].commits + g_envs[3].commits, 0);
+
+    /* Emptied: a second exec does nothing */
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 1), 0);
+
+    db_shards_stats_t st;
+    ops_shards_stats(g_sh, &st);
+    assert_int_equal(st.batches, 1u);
+    assert_int_equal(st.single, 1u);
+    assert_int_equal(st.split, 0u);
+    assert_int_equal(st.commits, 1u);
+}
+
+static void test_exec_over_shards_refused_when_atomic_split_otherwise(void** state)
+{
+    (void)state;
+
+    ut_open(4u);
+
+    char a[1][UT_STR];
+    char b[1][UT_STR];
+    assert_int_equal(ut_keys_of(0, a, 1), 1);
+    assert_int_equal(ut_keys_of(3, b, 1), 1);
+
+    assert_int_equal(ut_add_put(a[0], "va"), 0);
+    assert_int_equal(ut_add_put(b[0], "vb"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 1), -EXDEV);
+    assert_null(ut_stored(0, a[0]));
+    assert_null(ut_stored(3, b[0]));
+
+    assert_int_equal(ut_add_put(a[0], "va"), 0);
+    assert_int_equal(ut_add_put(b[0], "vb"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), 0);
+    assert_string_equal(ut_stored(0, a[0]), "va");
+    assert_string_equal(ut_stored(3, b[0]), "vb");
+
+    db_shards_stats_t st;
+    ops_shards_stats(g_sh, &st);
+    assert_int_equal(st.refused, 1u);
+    assert_int_equal(st.split, 1u);
+    assert_int_equal(st.batches, 1u);
+    assert_int_equal(st.commits, 2u);
+
+    /* Unknown DBI */
+    assert_int_equal(ops_shard_batch_add(g_batch, 5u, DB_OPERATION_PUT, "k", 1u, "v", 1u), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), -EINVAL);
+    assert_int_equal(ops_shards_exec(NULL, g_batch, 0), -EINVAL);
+}
+
+static void test_exec_reads_copy_into_user_buffers(void** state)
+{
+    (void)state;
+
+    ut_open(2u);
+
+    assert_int_equal(ut_add_put("alpha", "one"), 0);
+    assert_int_equal(ut_add_put("beta", "two"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), 0);
+
+    /* GET needs a buffer */
+    assert_int_equal(ops_shard_batch_add(g_batch, 0u, DB_OPERATION_GET, "alpha", 5u, NULL, 0u),
+                     -EINVAL);
+
+    char b1[8] = { 0 };
+    char b2[8] = { 0 };
+    assert_int_equal(
+        ops_shard_batch_add(g_batch, 0u, DB_OPERATION_GET, "alpha", 5u, b1, sizeof(b1)), 0);
+    assert_int_equal(ops_shard_batch_add(g_batch, 0u, DB_OPERATION_GET, "beta", 4u, b2, sizeof(b2)),
+                     0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), 0);
+    assert_string_equal(b1, "one");
+    assert_string_equal(b2, "two");
+
+    char small[2];
+    assert_int_equal(
+        ops_shard_batch_add(g_batch, 0u, DB_OPERATION_GET, "alpha", 5u, small, sizeof(small)), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), -ENOBUFS);
+
+    assert_int_equal(
+        ops_shard_batch_add(g_batch, 0u, DB_OPERATION_GET, "gamma", 5u, b1, sizeof(b1)), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), -ENOENT);
+
+    /* Reads alone never reach a writer */
+    db_shards_stats_t st;
+    ops_shards_stats(g_sh, &st);
+    assert_int_equal(g_envs[0].commits + g_envs[1].commits, (int)st.commits);
+    assert_int_equal(st.failed, 2u);
+}
+
+static void test_exec_grows_full_map_and_retries(void** state)
+{
+    (void)state;
+
+    ut_open(1u);
+
+    g_envs[0].full = 1;
+    assert_int_equal(ut_add_put("key", "val"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 1), 0);
+    assert_string_equal(ut_stored(0, "key"), "val");
+    assert_int_equal(g_envs[0].map_size, UT_MAP_INIT + UT_MAP_STEP);
+
+    db_shards_stats_t st;
+    ops_shards_stats(g_sh, &st);
+    assert_int_equal(st.grows, 1u);
+    assert_int_equal(st.failed, 0u);
+
+    /* At the limit */
+    ops_shards_close(g_sh);
+    g_sh      = NULL;
+    g_map_max = UT_MAP_INIT;
+    ut_open(1u);
+    g_envs[1].full = 1;
+    assert_int_equal(ut_add_put("other", "val"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 1), -ENOSPC);
+    assert_null(ut_stored(1, "other"));
+}
+
+static void test_exec_failed_part_leaves_other_shards_committed(void** state)
+{
+    (void)state;
+
+    ut_open(2u);
+
+    /* A failing key and a good key on each side */
+    const char* bad = "dup";
+    int         s   = ops_shards_of(g_sh, bad, strlen(bad));
+    char        good[2][UT_STR];
+    assert_int_equal(ut_keys_of(s, good, 1), 1);
+    assert_int_equal(ut_keys_of(1 - s, good + 1, 1), 1);
+
+    assert_int_equal(ut_add_put(good[0], "same"), 0);
+    assert_int_equal(ut_add_put(good[1], "other"), 0);
+    assert_int_equal(ut_add_put(bad, "x"), 0);
+    assert_int_equal(ops_shards_exec(g_sh, g_batch, 0), -EEXIST);
+
+    assert_null(ut_stored(s, good[0]));
+    assert_string_equal(ut_stored(1 - s, good[1]), "other");
+
+    db_shards_stats_t st;
+    ops_shards_stats(g_sh, &st);
+    assert_int_equal(st.failed, 1u);
+    assert_int_equal(st.split, 1u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_shards_open_validates_and_opens_every_env, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_shards_of_is_stable_and_spread, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_exec_single_shard_batch_is_one_txn, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_exec_over_shards_refused_when_atomic_split_otherwise,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_exec_reads_copy_into_user_buffers, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_exec_grows_full_map_and_retries, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_exec_failed_part_leaves_other_shards_committed,
+                                        ut_setup, ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,163 @@
+#include <errno.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_stats.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* Counters are process-wide and only grow: every test works on deltas */
+static db_stats_t g_before;
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ops_stats_snapshot(&g_before);
+    return 0;
+}
+
+#define UT_THREADS    4
+#define UT_PER_THREAD 1000u
+
+static void* ut_worker(void* arg)
+{
+    (void)arg;
+    for(size_t i = 0; i < UT_PER_THREAD; i++)
+    {
+        ops_stats_batch(3u);
+        ops_stats_txn(1);
+    }
+    return NULL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Histogram / counter tests                                                 */
+/* ------------------------------------------------------------------------- */
+
+static void test_stats_hist_uses_log2_buckets(void** state)
+{
+    (void)state;
+
+    ops_stats_batch(0u);       /* bucket 0 */
+    ops_stats_batch(1u);       /* [1, 2) */
+    ops_stats_batch(5u);       /* [4, 8) */
+    ops_stats_batch(7u);       /* [4, 8) */
+    ops_stats_batch(SIZE_MAX); /* past the last bucket: clamped */
+
+    db_stats_t st;
+    ops_stats_snapshot(&st);
+    const db_hist_t* h = &st.batch_ops;
+    const db_hist_t* b = &g_before.batch_ops;
+    assert_int_equal(h->count - b->count, 5u);
+    assert_int_equal(h->buckets[0] - b->buckets[0], 1u);
+    assert_int_equal(h->buckets[1] - b->buckets[1], 1u);
+    assert_int_equal(h->buckets[3] - b->buckets[3], 2u);
+    assert_int_equal(h->buckets[DB_STATS_BUCKETS - 1] - b->buckets[DB_STATS_BUCKETS - 1], 1u);
+}
+
+static void test_stats_lat_counts_by_kind(void** state)
+{
+    (void)state;
+
+    const uint64_t t0 = ops_stats_now();
+    ops_stats_lat(DB_STATS_LAT_GET, t0);
+    ops_stats_lat(DB_STATS_LAT_GET, t0);
+    ops_stats_lat(DB_STATS_LAT_TXN_COMMIT, t0);
+    ops_stats_lat(DB_STATS_LAT_MAX, t0); /* scans: not recorded */
+
+    /* A start in the future does not wrap around */
+    ops_stats_lat(DB_STATS_LAT_DEL, t0 + 1000000000ull);
+
+    db_stats_t st;
+    ops_stats_snapshot(&st);
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_GET].count - g_before.lat_ns[DB_STATS_LAT_GET].count,
+                     2u);
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_TXN_COMMIT].count -
+                         g_before.lat_ns[DB_STATS_LAT_TXN_COMMIT].count,
+                     1u);
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_PUT].count, g_before.lat_ns[DB_STATS_LAT_PUT].count);
+    assert_int_equal(st.lat_ns[DB_STATS_LAT_DEL].buckets[0] -
+                         g_before.lat_ns[DB_STATS_LAT_DEL].buckets[0],
+                     1u);
+    assert_true(ops_stats_now() >= t0);
+}
+
+static void test_stats_retry_by_lmdb_code(void** state)
+{
+    (void)state;
+
+    ops_stats_retry(MDB_MAP_FULL);
+    ops_stats_retry(MDB_MAP_FULL);
+    ops_stats_retry(MDB_READERS_FULL);
+    ops_stats_retry(MDB_BAD_RSLOT);
+    ops_stats_retry(MDB_NOTFOUND); /* not a retry code */
+    ops_stats_rw_cache(100u);
+    ops_stats_txn(0);
+
+    db_stats_t st;
+    ops_stats_snapshot(&st);
+    assert_int_equal(st.retries[DB_STATS_RETRY_MAP_FULL] -
+                         g_before.retries[DB_STATS_RETRY_MAP_FULL],
+                     2u);
+    assert_int_equal(st.retries[DB_STATS_RETRY_READERS] - g_before.retries[DB_STATS_RETRY_READERS],
+                     2u);
+    assert_int_equal(st.retries[DB_STATS_RETRY_TXN_FULL], g_before.retries[DB_STATS_RETRY_TXN_FULL]);
+    assert_int_equal(st.rw_cache_bytes - g_before.rw_cache_bytes, 100u);
+    assert_int_equal(st.txn_rw - g_before.txn_rw, 1u);
+    assert_int_equal(st.map.map_size, 0u);
+
+    ops_stats_snapshot(NULL);
+}
+
+static void test_stats_sum_of_threads_survives_their_exit(void** state)
+{
+    (void)state;
+
+    pthread_t th[UT_THREADS];
+    for(int i = 0; i < UT_THREADS; i++)
+    {
+        assert_int_equal(pthread_create(&th[i], NULL, ut_worker, NULL), 0);
+    }
+    for(int i = 0; i < UT_THREADS; i++)
+    {
+        assert_int_equal(pthread_join(th[i], NULL), 0);
+    }
+
+    /* A second wave reuses the released slots, counts keep adding up */
+    assert_int_equal(pthread_create(&th[0], NULL, ut_worker, NULL), 0);
+    assert_int_equal(pthread_join(th[0], NULL), 0);
+
+    db_stats_t st;
+    ops_stats_snapshot(&st);
+    assert_int_equal(st.txn_ro - g_before.txn_ro, (UT_THREADS + 1) * UT_PER_THREAD);
+    assert_int_equal(st.batch_ops.buckets[2] - g_before.batch_ops.buckets[2],
+                     (UT_THREADS + 1) * UT_PER_THREAD);
+    assert_int_equal(st.batch_ops.sum - g_before.batch_ops.sum,
+                     3u * (UT_THREADS + 1) * UT_PER_THREAD);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup(test_stats_hist_uses_log2_buckets, ut_setup),
+        cmocka_unit_test_setup(test_stats_lat_counts_by_kind, ut_setup),
+        cmocka_unit_test_setup(test_stats_retry_by_lmdb_code, ut_setup),
+        cmocka_unit_test_setup(test_stats_sum_of_threads_survives_their_exit, ut_setup),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,600 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/db/dbi_int.h"
+#include "core/operations/ops_int/ops_actions.h"
+#include "core/operations/ops_int/ops_bloom.h"
+#include "core/operations/ops_int/ops_index.h"
+#include "core/operations/ops_int/ops_map.h"
+#include "core/operations/ops_int/ops_ttl.h"
+#include "core/operations/ops_int/ops_vcache.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* 0: sessions, 1: expiry queue, 2: DUPSORT spare */
+enum
+{
+    UT_SESSIONS = 0,
+    UT_QUEUE    = 1,
+    UT_DUPS     = 2,
+    UT_DBIS     = 3
+};
+
+/* Far enough that the sweeper thread never runs during a test */
+#define UT_PERIOD_MS 3600000u
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[UT_DBIS];
+static MDB_txn*   g_txn = (MDB_txn*)0x100;
+
+/* Tiny in-memory store behind mdb_get / mdb_put / mdb_del and the cursor */
+typedef struct
+{
+    unsigned      dbi;
+    size_t        ksize;
+    unsigned char key[64];
+    size_t        vsize;
+    unsigned char val[32];
+} ut_rec_t;
+
+static ut_rec_t g_recs[64];
+static size_t   g_n_recs;
+static unsigned g_cursor_dbi;
+static ut_rec_t g_cursor_at;
+
+/* Lightweight stubs of the txn, map, cache, index and filter layers */
+static int g_commits;
+static int g_commit_rc;
+static int g_commit_err;
+static int g_map_depth;
+static int g_map_full;
+static int g_cache_depth;
+
+db_security_ret_code_t act_txn_begin(MDB_txn** out_txn, const unsigned flags, int* const out_err)
+{
+    (void)flags;
+    (void)out_err;
+    *out_txn = g_txn;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t act_txn_commit(MDB_txn* const txn, int* const out_err)
+{
+    (void)txn;
+    if(g_commit_rc == DB_SAFETY_SUCCESS)
+    {
+        g_commits++;
+        return DB_SAFETY_SUCCESS;
+    }
+
+    /* Fail once */
+    const int rc = g_commit_rc;
+    if(out_err) *out_err = g_commit_err;
+    g_commit_rc = DB_SAFETY_SUCCESS;
+    return (db_security_ret_code_t)rc;
+}
+
+void ops_map_enter(void)
+{
+    g_map_depth++;
+}
+
+void ops_map_leave(void)
+{
+    g_map_depth--;
+}
+
+void ops_map_after_commit(void)
+{
+    assert_int_equal(g_map_depth, 0);
+}
+
+int ops_map_on_full(const unsigned attempt)
+{
+    (void)attempt;
+    assert_int_equal(g_map_depth, 0);
+    g_map_full++;
+    return 0;
+}
+
+void ops_vcache_write_begin(const unsigned dbi)
+{
+    (void)dbi;
+    g_cache_depth++;
+}
+
+void ops_vcache_write_end(const unsigned dbi, const void* key, const size_t key_size)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+    g_cache_depth--;
+}
+
+unsigned ops_index_targets(const unsigned dbi)
+{
+    (void)dbi;
+    return 0u;
+}
+
+db_security_ret_code_t ops_index_before(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                        ops_index_keys_t* old, int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)old;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+db_security_ret_code_t ops_index_after(MDB_txn* txn, const unsigned dbi, const MDB_val* key,
+                                       const MDB_val* val, const ops_index_keys_t* old,
+                                       int* const out_err)
+{
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)val;
+    (void)old;
+    (void)out_err;
+    return DB_SAFETY_SUCCESS;
+}
+
+void ops_bloom_add(const unsigned dbi, const void* key, const size_t key_size)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+}
+
+int ops_bloom_maybe(const unsigned dbi, const void* key, const size_t key_size)
+{
+    (void)dbi;
+    (void)key;
+    (void)key_size;
+    return 1;
+}
+
+static int ut_cmp(const unsigned char* a, const size_t na, const unsigned char* b,
+                  const size_t nb)
+{
+    const int c = memcmp(a, b, na < nb ? na : nb);
+    return c ? c : (na > nb) - (na < nb);
+}
+
+static ut_rec_t* ut_find(const unsigned dbi, const MDB_val* k)
+{
+    for(size_t i = 0; i < g_n_recs; i++)
+    {
+        ut_rec_t* r = &g_recs[i];
+        if(r->dbi == dbi && ut_cmp(r->key, r->ksize, k->mv_data, k->mv_size) == 0) return r;
+    }
+    return NULL;
+}
+
+static int ut_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v)
+{
+    (void)txn;
+    ut_rec_t* r = ut_find(dbi, k);
+    if(!r) return MDB_NOTFOUND;
+    v->mv_data = r->val;
+    v->mv_size = r->vsize;
+    return MDB_SUCCESS;
+}
+
+static int ut_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v, unsigned flags)
+{
+    (void)txn;
+    (void)flags;
+    assert_true(k->mv_size <= sizeof(g_recs[0].key) && v->mv_size <= sizeof(g_recs[0].val));
+
+    ut_rec_t* r = ut_find(dbi, k);
+    if(!r)
+    {
+        r        = &g_recs[g_n_recs++];
+        r->dbi   = dbi;
+        r->ksize = k->mv_size;
+        memcpy(r->key, k->mv_data, k->mv_size);
+    }
+    r->vsize = v->mv_size;
+    memcpy(r->val, v->mv_data, v->mv_size);
+    return MDB_SUCCESS;
+}
+
+static int ut_del(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v)
+{
+    (void)txn;
+    (void)v;
+    ut_rec_t* r = ut_find(dbi, k);
+    if(!r) return MDB_NOTFOUND;
+    *r = g_recs[--g_n_recs];
+    return MDB_SUCCESS;
+}
+
+static int ut_cursor_open(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor)
+{
+    (void)txn;
+    g_cursor_dbi = dbi;
+    *cursor      = (MDB_cursor*)0x200;
+    return MDB_SUCCESS;
+}
+
+/* Smallest key of the cursor DBI above (or at, when @p eq) the given one */
+static int ut_cursor_get(MDB_cursor* cur, MDB_val* k, MDB_val* v, MDB_cursor_op op)
+{
+    (void)cur;
+    const unsigned char* from  = op == MDB_SET_RANGE ? k->mv_data : g_cursor_at.key;
+    const size_t         nfrom = op == MDB_SET_RANGE ? k->mv_size : g_cursor_at.ksize;
+    const int            eq    = op == MDB_SET_RANGE;
+    assert_true(op == MDB_SET_RANGE || op == MDB_NEXT);
+
+    ut_rec_t* best = NULL;
+    for(size_t i = 0; i < g_n_recs; i++)
+    {
+        ut_rec_t* r = &g_recs[i];
+        if(r->dbi != g_cursor_dbi) continue;
+        const int c = ut_cmp(r->key, r->ksize, from, nfrom);
+        if((c > 0 || (eq && c == 0)) &&
+           (!best || ut_cmp(r->key, r->ksize, best->key, best->ksize) < 0))
+        {
+            best = r;
+        }
+    }
+    if(!best) return MDB_NOTFOUND;
+
+    g_cursor_at = *best;
+    k->mv_data  = g_cursor_at.key;
+    k->mv_size  = g_cursor_at.ksize;
+    v->mv_data  = g_cursor_at.val;
+    v->mv_size  = g_cursor_at.vsize;
+    return MDB_SUCCESS;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    g_ut_mdb_get         = ut_get;
+    g_ut_mdb_put         = ut_put;
+    g_ut_mdb_del         = ut_del;
+    g_ut_mdb_cursor_open = ut_cursor_open;
+    g_ut_mdb_cursor_get  = ut_cursor_get;
+
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    for(unsigned i = 0; i < UT_DBIS; i++) g_dbis[i].dbi = i;
+    g_dbis[UT_DUPS].is_dupsort = 1;
+    g_db.env                   = (MDB_env*)0x1;
+    g_db.dbis                  = g_dbis;
+    g_db.n_dbis                = UT_DBIS;
+    DataBase                   = &g_db;
+
+    g_n_recs      = 0;
+    g_commits     = 0;
+    g_commit_rc   = DB_SAFETY_SUCCESS;
+    g_commit_err  = 0;
+    g_map_depth   = 0;
+    g_map_full    = 0;
+    g_cache_depth = 0;
+
+    const db_ttl_cfg_t cfg = { .queue_dbi = UT_QUEUE, .period_ms = UT_PERIOD_MS, .batch = 2 };
+    assert_int_equal(ops_ttl_start(&cfg), 0);
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_ttl_stop();
+    DataBase = NULL;
+    ut_reset_lmdb_stubs();
+    return 0;
+}
+
+static void ut_put_ttl(const char* key, const uint64_t expires)
+{
+    MDB_val k = { strlen(key), (void*)key };
+    MDB_val v = { 1, "v" };
+    assert_int_equal(ut_put(g_txn, UT_SESSIONS, &k, &v, 0), MDB_SUCCESS);
+    assert_int_equal(ops_ttl_arm(g_txn, UT_SESSIONS, &k, expires, NULL), DB_SAFETY_SUCCESS);
+}
+
+static int ut_has(const unsigned dbi, const char* key)
+{
+    MDB_val k = { strlen(key), (void*)key };
+    return ut_find(dbi, &k) != NULL;
+}
+
+static size_t ut_count(const unsigned dbi)
+{
+    size_t n = 0;
+    for(size_t i = 0; i < g_n_recs; i++) n += g_recs[i].dbi == dbi;
+    return n;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_ttl_start() / ops_ttl_stop() tests                                    */
+/* ------------------------------------------------------------------------- */
+
+static void test_ttl_start_checks_queue_and_stop_turns_off(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_ttl_queue(), UT_QUEUE);
+    const db_ttl_cfg_t again = { .queue_dbi = UT_QUEUE };
+    assert_int_equal(ops_ttl_start(&again), -EALREADY);
+
+    ops_ttl_stop();
+    assert_int_equal(ops_ttl_queue(), -1);
+    assert_int_equal(ops_ttl_sweep(UINT64_MAX, 10), -ENOTCONN);
+
+    const db_ttl_cfg_t dups    = { .queue_dbi = UT_DUPS };
+    const db_ttl_cfg_t unknown = { .queue_dbi = UT_DBIS };
+    assert_int_equal(ops_ttl_start(&dups), -EINVAL);
+    assert_int_equal(ops_ttl_start(&unknown), -EINVAL);
+    assert_int_equal(ops_ttl_start(NULL), -EINVAL);
+
+    MDB_val k = { 1, "k" };
+    assert_int_equal(ops_ttl_arm(g_txn, UT_SESSIONS, &k, 1, NULL), DB_SAFETY_FAIL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_ttl_arm() tests                                                       */
+/* ------------------------------------------------------------------------- */
+
+static void test_ttl_arm_keeps_last_deadline_only(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("s1", 100);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+
+    /* Moved: the old deadline entry goes */
+    ut_put_ttl("s1", 300);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+    ut_put_ttl("s1", 300);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+
+    assert_int_equal(ops_ttl_sweep(200, 10), 0);
+    assert_true(ut_has(UT_SESSIONS, "s1"));
+    assert_int_equal(ops_ttl_sweep(300, 10), 1);
+    assert_false(ut_has(UT_SESSIONS, "s1"));
+    assert_int_equal(ut_count(UT_QUEUE), 0u);
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.armed, 2u);
+    assert_int_equal(st.expired, 1u);
+}
+
+static void test_ttl_arm_rejects_oversized_key(void** state)
+{
+    (void)state;
+
+    static char big[DB_LMDB_TTL_KEY_MAX + 1];
+    MDB_val     k   = { sizeof(big), big };
+    int         err = 0;
+    assert_int_equal(ops_ttl_arm(g_txn, UT_SESSIONS, &k, 1, &err), DB_SAFETY_FAIL);
+    assert_int_equal(err, -EINVAL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_ttl_disarm() / ops_ttl_disarm_range() tests                           */
+/* ------------------------------------------------------------------------- */
+
+static void test_ttl_disarm_drops_key_and_due_entry(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_ttl_armed(UT_SESSIONS), 0);
+    ut_put_ttl("s1", 10);
+    ut_put_ttl("s2", 10);
+    assert_int_equal(ops_ttl_armed(UT_SESSIONS), 1);
+    assert_int_equal(ops_ttl_armed(UT_QUEUE), 0);
+
+    MDB_val k = { 2, "s1" };
+    assert_int_equal(ops_ttl_disarm(g_txn, UT_SESSIONS, &k, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+
+    /* No deadline left: nothing to drop */
+    assert_int_equal(ops_ttl_disarm(g_txn, UT_SESSIONS, &k, NULL), DB_SAFETY_SUCCESS);
+
+    assert_int_equal(ops_ttl_sweep(100, 10), 1);
+    assert_true(ut_has(UT_SESSIONS, "s1"));
+    assert_false(ut_has(UT_SESSIONS, "s2"));
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.disarmed, 1u);
+    assert_int_equal(st.expired, 1u);
+    assert_int_equal(st.stale, 0u);
+}
+
+static void test_ttl_disarm_del_keeps_deadline_while_dups_remain(void** state)
+{
+    (void)state;
+
+    /* Two dups of d1, one of them with the deadline of the key */
+    MDB_val k = { 2, "d1" };
+    MDB_val v = { 1, "a" };
+    assert_int_equal(ut_put(g_txn, UT_DUPS, &k, &v, 0), MDB_SUCCESS);
+    assert_int_equal(ops_ttl_arm(g_txn, UT_DUPS, &k, 10, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+
+    /* A DEL of one dup: the store still has the key */
+    assert_int_equal(ops_ttl_disarm_del(g_txn, UT_DUPS, &k, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+
+    /* The last dup gone: so is the deadline */
+    assert_int_equal(ut_del(g_txn, UT_DUPS, &k, NULL), MDB_SUCCESS);
+    assert_int_equal(ops_ttl_disarm_del(g_txn, UT_DUPS, &k, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 0u);
+
+    /* Not DUPSORT: the key is gone with any DEL, no lookup */
+    ut_put_ttl("s1", 10);
+    MDB_val s = { 2, "s1" };
+    assert_int_equal(ops_ttl_disarm_del(g_txn, UT_SESSIONS, &s, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 0u);
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.disarmed, 2u);
+}
+
+static void test_ttl_disarm_range_drops_keys_in_bounds(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("a", 10);
+    ut_put_ttl("b", 10);
+    ut_put_ttl("c", 10);
+    ut_put_ttl("d", 10);
+
+    MDB_val from = { 1, "b" };
+    MDB_val to   = { 1, "d" };
+    assert_int_equal(ops_ttl_disarm_range(g_txn, UT_SESSIONS, &from, &to, NULL),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 4u);
+
+    /* A restart finds the deadlines left in the queue */
+    ops_ttl_stop();
+    const db_ttl_cfg_t cfg = { .queue_dbi = UT_QUEUE, .period_ms = UT_PERIOD_MS, .batch = 2 };
+    assert_int_equal(ops_ttl_start(&cfg), 0);
+    assert_int_equal(ops_ttl_armed(UT_SESSIONS), 1);
+    assert_int_equal(g_map_depth, 0);
+
+    assert_int_equal(ops_ttl_disarm_range(g_txn, UT_SESSIONS, NULL, NULL, NULL),
+                     DB_SAFETY_SUCCESS);
+    assert_int_equal(ut_count(UT_QUEUE), 0u);
+    assert_int_equal(ops_ttl_sweep(100, 10), 0);
+    assert_int_equal(ut_count(UT_SESSIONS), 4u);
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.disarmed, 2u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_ttl_sweep() tests                                                     */
+/* ------------------------------------------------------------------------- */
+
+static void test_ttl_sweep_oldest_first_in_bounded_txns(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("c", 30);
+    ut_put_ttl("a", 10);
+    ut_put_ttl("d", 900);
+    ut_put_ttl("b", 20);
+
+    /* max stops the sweep, the oldest go first */
+    assert_int_equal(ops_ttl_sweep(100, 1), 1);
+    assert_false(ut_has(UT_SESSIONS, "a"));
+    assert_true(ut_has(UT_SESSIONS, "b"));
+
+    /* Two due keys left, batch of 2: one txn plus an empty scan */
+    g_commits = 0;
+    assert_int_equal(ops_ttl_sweep(100, 10), 2);
+    assert_int_equal(g_commits, 1);
+    assert_false(ut_has(UT_SESSIONS, "b"));
+    assert_false(ut_has(UT_SESSIONS, "c"));
+    assert_true(ut_has(UT_SESSIONS, "d"));
+    assert_int_equal(ut_count(UT_QUEUE), 2u);
+    assert_int_equal(g_map_depth, 0);
+    assert_int_equal(g_cache_depth, 0);
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.expired, 3u);
+    assert_int_equal(st.txns, 2u);
+    assert_int_equal(st.sweeps, 2u);
+}
+
+static void test_ttl_sweep_drops_entries_of_deleted_records(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("gone", 10);
+    MDB_val k = { 4, "gone" };
+    assert_int_equal(ut_del(g_txn, UT_SESSIONS, &k, NULL), MDB_SUCCESS);
+
+    assert_int_equal(ops_ttl_sweep(100, 10), 0);
+    assert_int_equal(ut_count(UT_QUEUE), 0u);
+
+    db_ttl_stats_t st;
+    ops_ttl_stats(&st);
+    assert_int_equal(st.expired, 0u);
+    assert_int_equal(st.stale, 1u);
+}
+
+static void test_ttl_sweep_grows_map_and_retries(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("s1", 10);
+    g_commit_rc  = DB_SAFETY_RETRY;
+    g_commit_err = -ENOSPC;
+
+    /* The stub store kept the deletes of the failed txn: nothing left to do */
+    assert_int_equal(ops_ttl_sweep(100, 10), 0);
+    assert_int_equal(g_map_full, 1);
+    assert_int_equal(g_commits, 1);
+    assert_int_equal(g_cache_depth, 0);
+}
+
+static void test_ttl_sweep_reports_commit_failure(void** state)
+{
+    (void)state;
+
+    ut_put_ttl("s1", 10);
+    g_commit_rc  = DB_SAFETY_FAIL;
+    g_commit_err = -EIO;
+
+    assert_int_equal(ops_ttl_sweep(100, 10), -EIO);
+    assert_int_equal(g_map_full, 0);
+    assert_int_equal(g_map_depth, 0);
+    assert_int_equal(g_cache_depth, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_ttl_start_checks_queue_and_stop_turns_off, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_arm_keeps_last_deadline_only, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_arm_rejects_oversized_key, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_disarm_drops_key_and_due_entry, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_disarm_del_keeps_deadline_while_dups_remain,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_disarm_range_drops_keys_in_bounds, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_sweep_oldest_first_in_bounded_txns, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_sweep_drops_entries_of_deleted_records,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_sweep_grows_map_and_retries, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_ttl_sweep_reports_commit_failure, ut_setup,
+                                        ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
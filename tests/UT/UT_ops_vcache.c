@@ -0,0 +1,255 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/db/dbi_int.h"
+#include "core/operations/ops_int/ops_vcache.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[2]; /* 0: plain, 1: DUPSORT */
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    g_dbis[1].is_dupsort = 1;
+    g_db.dbis            = g_dbis;
+    g_db.n_dbis          = 2;
+    DataBase             = &g_db;
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_vcache_read_end();
+    ops_vcache_reset();
+    DataBase = NULL;
+    return 0;
+}
+
+static void ut_fill(const char* key, const char* val)
+{
+    ops_vcache_fill(0, key, strlen(key), val, strlen(val));
+}
+
+/* 0 on a hit, the value NUL-terminated in buf */
+static int ut_get(const char* key, char* buf, const size_t cap)
+{
+    size_t size = cap - 1;
+    int    rc   = ops_vcache_get(0, key, strlen(key), buf, &size, 1);
+    if(rc == 0) buf[size] = '\0';
+    return rc;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_vcache_enable() tests                                                 */
+/* ------------------------------------------------------------------------- */
+
+static void test_vcache_enable_rejects_unknown_and_dupsort_dbi(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_vcache_enable(2, NULL), -EINVAL);
+    assert_int_equal(ops_vcache_enable(1, NULL), -EINVAL);
+    assert_int_equal(ops_vcache_enable(0, NULL), 0);
+
+    db_cache_stats_t st;
+    assert_int_equal(ops_vcache_stats(1, &st), -ENOENT);
+    assert_int_equal(ops_vcache_stats(0, &st), 0);
+    assert_int_equal(st.entries, 0u);
+
+    ops_vcache_disable(0);
+    assert_int_equal(ops_vcache_stats(0, &st), -ENOENT);
+    ops_vcache_disable(0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_vcache_get() / ops_vcache_fill() tests                                */
+/* ------------------------------------------------------------------------- */
+
+static void test_vcache_fill_then_hit_inside_read_window_only(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_vcache_enable(0, NULL), 0);
+    char buf[32];
+
+    /* No window: neither filled nor served */
+    ut_fill("dev1", "nonce1");
+    ops_vcache_read_begin();
+    assert_int_equal(ut_get("dev1", buf, sizeof(buf)), -ENOENT);
+
+    ut_fill("dev1", "nonce1");
+    assert_int_equal(ut_get("dev1", buf, sizeof(buf)), 0);
+    assert_string_equal(buf, "nonce1");
+
+    /* A too small buffer is a miss, LMDB reports the size */
+    size_t size = 3;
+    assert_int_equal(ops_vcache_get(0, "dev1", 4, buf, &size, 1), -ENOENT);
+    assert_int_equal(size, 3u);
+
+    /* A refill replaces the value */
+    ut_fill("dev1", "nonce2");
+    assert_int_equal(ut_get("dev1", buf, sizeof(buf)), 0);
+    assert_string_equal(buf, "nonce2");
+    ops_vcache_read_end();
+    assert_int_equal(ut_get("dev1", buf, sizeof(buf)), -ENOENT);
+
+    db_cache_stats_t st;
+    assert_int_equal(ops_vcache_stats(0, &st), 0);
+    assert_int_equal(st.hits, 2u);
+    assert_int_equal(st.misses, 2u); /* the window-less get is not counted */
+    assert_int_equal(st.fills, 2u);
+    assert_int_equal(st.entries, 1u);
+}
+
+static void test_vcache_skips_large_values(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_vcache_enable(0, &(db_cache_cfg_t){ .max_val_size = 4 }), 0);
+    char buf[32];
+
+    ops_vcache_read_begin();
+    ut_fill("a", "1234");
+    ut_fill("b", "12345");
+    assert_int_equal(ut_get("a", buf, sizeof(buf)), 0);
+    assert_int_equal(ut_get("b", buf, sizeof(buf)), -ENOENT);
+}
+
+static void test_vcache_clock_evicts_unreferenced_first(void** state)
+{
+    (void)state;
+
+    /* Measure one entry, then a single shard with room for three */
+    assert_int_equal(ops_vcache_enable(0, NULL), 0);
+    ops_vcache_read_begin();
+    ut_fill("k0", "v0");
+    db_cache_stats_t st;
+    assert_int_equal(ops_vcache_stats(0, &st), 0);
+    const size_t charge = st.bytes;
+    ops_vcache_read_end();
+
+    assert_int_equal(
+        ops_vcache_enable(0, &(db_cache_cfg_t){ .bytes = 3 * charge, .shards = 1 }), 0);
+    char buf[8];
+
+    ops_vcache_read_begin();
+    ut_fill("k1", "v1");
+    ut_fill("k2", "v2");
+    ut_fill("k3", "v3");
+    /* k1 referenced: the hand spares it once and takes k2 */
+    assert_int_equal(ut_get("k1", buf, sizeof(buf)), 0);
+    ut_fill("k4", "v4");
+
+    assert_int_equal(ut_get("k1", buf, sizeof(buf)), 0);
+    assert_int_equal(ut_get("k2", buf, sizeof(buf)), -ENOENT);
+    assert_int_equal(ut_get("k3", buf, sizeof(buf)), 0);
+    assert_int_equal(ut_get("k4", buf, sizeof(buf)), 0);
+
+    assert_int_equal(ops_vcache_stats(0, &st), 0);
+    assert_int_equal(st.evictions, 1u);
+    assert_int_equal(st.entries, 3u);
+    assert_true(st.bytes <= 3 * charge);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_vcache_write_begin() / ops_vcache_write_end() tests                   */
+/* ------------------------------------------------------------------------- */
+
+static void test_vcache_write_drops_key_and_blocks_readers_in_flight(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_vcache_enable(0, NULL), 0);
+    char buf[32];
+
+    ops_vcache_read_begin();
+    ut_fill("a", "1");
+    ut_fill("b", "2");
+    ops_vcache_read_end();
+
+    /* While the write is in flight the DBI is neither served nor filled */
+    ops_vcache_write_begin(0);
+    ops_vcache_read_begin();
+    assert_int_equal(ut_get("b", buf, sizeof(buf)), -ENOENT);
+    ut_fill("c", "3");
+    ops_vcache_read_end();
+
+    /* A window opened before the write ended may hold an old snapshot */
+    ops_vcache_read_begin();
+    ops_vcache_write_end(0, "a", 1);
+    assert_int_equal(ut_get("b", buf, sizeof(buf)), -ENOENT);
+    ops_vcache_read_end();
+
+    ops_vcache_read_begin();
+    assert_int_equal(ut_get("a", buf, sizeof(buf)), -ENOENT);
+    assert_int_equal(ut_get("b", buf, sizeof(buf)), 0);
+    assert_int_equal(ut_get("c", buf, sizeof(buf)), -ENOENT);
+    ops_vcache_read_end();
+
+    /* Unknown key: the whole DBI goes */
+    ops_vcache_write_begin(0);
+    ops_vcache_write_end(0, NULL, 0);
+    db_cache_stats_t st;
+    assert_int_equal(ops_vcache_stats(0, &st), 0);
+    assert_int_equal(st.entries, 0u);
+    assert_int_equal(st.bytes, 0u);
+    assert_int_equal(st.invalidations, 2u);
+}
+
+static void test_vcache_write_to_uncached_dbi_is_ignored(void** state)
+{
+    (void)state;
+
+    char buf[8];
+    assert_int_equal(ops_vcache_enable(0, NULL), 0);
+    ops_vcache_read_begin();
+    ut_fill("a", "1");
+    ops_vcache_read_end();
+
+    /* DUPSORT DBI 1 has no cache: readers of DBI 0 keep going */
+    ops_vcache_write_begin(1);
+    ops_vcache_read_begin();
+    assert_int_equal(ut_get("a", buf, sizeof(buf)), 0);
+    ops_vcache_read_end();
+    ops_vcache_write_end(1, "a", 1);
+
+    ops_vcache_read_begin();
+    assert_int_equal(ut_get("a", buf, sizeof(buf)), 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_vcache_enable_rejects_unknown_and_dupsort_dbi,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_vcache_fill_then_hit_inside_read_window_only,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_vcache_skips_large_values, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_vcache_clock_evicts_unreferenced_first, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_vcache_write_drops_key_and_blocks_readers_in_flight,
+                                        ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_vcache_write_to_uncached_dbi_is_ignored, ut_setup,
+                                        ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
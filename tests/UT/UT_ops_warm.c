@@ -0,0 +1,546 @@
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/ops_init.h"
+#include "core/operations/ops_int/ops_map.h"
+#include "core/operations/ops_int/ops_warm.h"
+
+/* ------------------------------------------------------------------------- */
+/* Lightweight stubs for ops_map and ops_init                                */
+/* ------------------------------------------------------------------------- */
+
+/* Both are tested in their own UT suites; here the calls are only counted.
+ * The walks run on threads of the module: the hooks only record, the
+ * checks run on the main thread. */
+
+static atomic_int g_enters = 0;
+static atomic_int g_leaves = 0;
+static int        g_derived = 0;
+static int        g_orders  = 0;
+static int        g_order_rc = 0;
+
+void ops_map_enter(void)
+{
+    atomic_fetch_add(&g_enters, 1);
+}
+
+void ops_map_leave(void)
+{
+    atomic_fetch_add(&g_leaves, 1);
+}
+
+void ops_init_dbi_derive(const unsigned int dbi_idx, const dbi_type_t dbi_type)
+{
+    (void)dbi_type;
+    DataBase->dbis[dbi_idx].is_dupsort = (DataBase->dbis[dbi_idx].db_flags & MDB_DUPSORT) != 0;
+    g_derived++;
+}
+
+/* A refusal aborts the txn, as the real one does */
+db_security_ret_code_t ops_init_dbi_order(MDB_txn* const txn, const unsigned int dbi_idx,
+                                          const db_cmp_fn_t key_cmp, const db_cmp_fn_t dup_cmp,
+                                          int* const out_err)
+{
+    (void)dbi_idx;
+    (void)key_cmp;
+    (void)dup_cmp;
+    g_orders++;
+    if(g_order_rc == 0) return DB_SAFETY_SUCCESS;
+    mdb_txn_abort(txn);
+    if(out_err) *out_err = g_order_rc;
+    return DB_SAFETY_FAIL;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake LMDB: txns, schema record, DBI handles                               */
+/* ------------------------------------------------------------------------- */
+
+#define UT_PAGE 4096u
+
+static atomic_int g_txns    = 0;
+static atomic_int g_aborts  = 0;
+static int        g_commits = 0;
+
+static int ut_txn_begin(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** out)
+{
+    (void)env;
+    (void)parent;
+    (void)flags;
+    atomic_fetch_add(&g_txns, 1);
+    *out = (MDB_txn*)0x100;
+    return MDB_SUCCESS;
+}
+
+static void ut_txn_abort(MDB_txn* txn)
+{
+    (void)txn;
+    atomic_fetch_add(&g_aborts, 1);
+}
+
+static int ut_txn_commit(MDB_txn* txn)
+{
+    (void)txn;
+    g_commits++;
+    return MDB_SUCCESS;
+}
+
+/* The main DBI keeps one record, the schema */
+static unsigned char g_rec[512];
+static size_t        g_rec_size = 0;
+
+static int ut_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    (void)txn;
+    (void)flags;
+    assert_int_equal(dbi, 1u);
+    assert_true(key->mv_size > 1u && ((const char*)key->mv_data)[0] == '\0');
+    assert_true(data->mv_size <= sizeof(g_rec));
+    memcpy(g_rec, data->mv_data, data->mv_size);
+    g_rec_size = data->mv_size;
+    return MDB_SUCCESS;
+}
+
+static int ut_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    (void)txn;
+    (void)key;
+    if(dbi != 1u || g_rec_size == 0) return MDB_NOTFOUND;
+    data->mv_data = g_rec;
+    data->mv_size = g_rec_size;
+    return MDB_SUCCESS;
+}
+
+static unsigned    g_open_flags[4];
+static int         g_opens     = 0;
+static const char* g_gone_name = NULL; /* DBI dropped since the record */
+
+static int ut_dbi_open(MDB_txn* txn, const char* name, unsigned int flags, MDB_dbi* dbi)
+{
+    (void)txn;
+    if(!name)
+    {
+        *dbi = 1u;
+        return MDB_SUCCESS;
+    }
+    if(g_gone_name && strcmp(name, g_gone_name) == 0) return MDB_NOTFOUND;
+    g_open_flags[g_opens++ & 3] = flags;
+    *dbi = (MDB_dbi)(name[strlen(name) - 1] - '0' + 2);
+    return MDB_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Fake cursors over N sorted keys, one state per open                       */
+/* ------------------------------------------------------------------------- */
+
+#define UT_KEYS    10000u
+#define UT_VAL     100u
+#define UT_CURSORS 64u
+
+typedef struct
+{
+    MDB_dbi  dbi;
+    unsigned pos;
+} ut_cursor_t;
+
+static char          g_keys[UT_KEYS][9];
+static unsigned char g_val[UT_VAL];
+static ut_cursor_t   g_cursors[UT_CURSORS];
+static atomic_uint   g_n_cursors  = 0;
+static atomic_int    g_nodup_seen = 0;  /* MDB_NEXT_NODUP used */
+static atomic_int    g_hold       = 0;  /* cursor_get spins while set */
+static atomic_int    g_held       = 0;  /* a cursor_get is spinning */
+static int           g_cursor_rc  = 0;  /* cursor_open result */
+
+static int ut_cursor_open(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor)
+{
+    (void)txn;
+    if(g_cursor_rc != 0) return g_cursor_rc;
+    unsigned i = atomic_fetch_add(&g_n_cursors, 1u) % UT_CURSORS;
+    g_cursors[i].dbi = dbi;
+    g_cursors[i].pos = 0;
+    *cursor          = (MDB_cursor*)&g_cursors[i];
+    return MDB_SUCCESS;
+}
+
+static int ut_cursor_get(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    ut_cursor_t* c = (ut_cursor_t*)cursor;
+    if(atomic_load(&g_hold)) atomic_store(&g_held, 1);
+    while(atomic_load(&g_hold)) sched_yield();
+
+    switch(op)
+    {
+        case MDB_FIRST:
+            c->pos = 0;
+            break;
+        case MDB_SET_RANGE:
+        {
+            char k[9] = { 0 };
+            memcpy(k, key->mv_data, key->mv_size < 8u ? key->mv_size : 8u);
+            c->pos = (unsigned)strtoul(k + 1, NULL, 10);
+            break;
+        }
+        case MDB_NEXT_NODUP:
+            atomic_store(&g_nodup_seen, 1);
+            c->pos++;
+            break;
+        case MDB_NEXT:
+            c->pos++;
+            break;
+        default:
+            return EINVAL;
+    }
+    if(c->pos >= UT_KEYS) return MDB_NOTFOUND;
+
+    key->mv_data  = g_keys[c->pos];
+    key->mv_size  = 8u;
+    data->mv_data = g_val;
+    data->mv_size = UT_VAL;
+    return MDB_SUCCESS;
+}
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[3];
+
+static const char*      k_names[] = { "dbi0", "dbi1" };
+static const dbi_type_t k_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT };
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    g_db.env             = (MDB_env*)0x90;
+    g_db.dbis            = g_dbis;
+    g_db.n_dbis          = 2u;
+    DataBase             = &g_db;
+    g_ut_mdb_txn_begin   = ut_txn_begin;
+    g_ut_mdb_txn_abort   = ut_txn_abort;
+    g_ut_mdb_txn_commit  = ut_txn_commit;
+    g_ut_mdb_put         = ut_put;
+    g_ut_mdb_get         = ut_get;
+    g_ut_mdb_dbi_open    = ut_dbi_open;
+    g_ut_mdb_cursor_open = ut_cursor_open;
+    g_ut_mdb_cursor_get  = ut_cursor_get;
+    g_rec_size           = 0;
+    g_opens              = 0;
+    g_gone_name          = NULL;
+    g_derived            = 0;
+    g_orders             = 0;
+    g_order_rc           = 0;
+    g_commits            = 0;
+    g_cursor_rc          = 0;
+    for(unsigned i = 0; i < UT_KEYS; i++) (void)snprintf(g_keys[i], sizeof(g_keys[i]), "k%07u", i);
+    atomic_store(&g_txns, 0);
+    atomic_store(&g_aborts, 0);
+    atomic_store(&g_enters, 0);
+    atomic_store(&g_leaves, 0);
+    atomic_store(&g_nodup_seen, 0);
+    atomic_store(&g_hold, 0);
+    atomic_store(&g_held, 0);
+    ops_warm_reset();
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    atomic_store(&g_hold, 0);
+    ops_warm_stop();
+    DataBase = NULL;
+    return 0;
+}
+
+/* Save the record of the DBIs as a cold open leaves them */
+static void ut_save_schema(void)
+{
+    g_dbis[0].db_flags = 0u;
+    g_dbis[1].db_flags = MDB_DUPSORT;
+    assert_int_equal(ops_warm_schema_save((MDB_txn*)0x100, k_names, k_types, 2u), 0);
+    assert_true(g_rec_size > 0u);
+    g_dbis[0].db_flags = 0xdeadu;
+    g_dbis[1].db_flags = 0xdeadu;
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_warm_readers() / ops_warm_prefetch_map() tests                        */
+/* ------------------------------------------------------------------------- */
+
+static int ut_reader_check(MDB_env* env, int* dead)
+{
+    (void)env;
+    *dead = 3;
+    return MDB_SUCCESS;
+}
+
+static int ut_reader_check_fail(MDB_env* env, int* dead)
+{
+    (void)env;
+    (void)dead;
+    return EINVAL;
+}
+
+static void test_warm_readers_clears_stale_slots(void** state)
+{
+    (void)state;
+
+    assert_int_equal(ops_warm_readers(), 0);
+
+    g_ut_mdb_reader_check = ut_reader_check;
+    assert_int_equal(ops_warm_readers(), 3);
+
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.readers_cleared, 3u);
+
+    g_ut_mdb_reader_check = ut_reader_check_fail;
+    assert_true(ops_warm_readers() < 0);
+
+    DataBase = NULL;
+    assert_int_equal(ops_warm_readers(), -EINVAL);
+    assert_int_equal(ops_warm_prefetch_map(), -EINVAL);
+}
+
+static void* g_map = NULL;
+
+static int ut_env_info(MDB_env* env, MDB_envinfo* info)
+{
+    (void)env;
+    memset(info, 0, sizeof(*info));
+    info->me_mapaddr   = g_map;
+    info->me_mapsize   = 64u * UT_PAGE;
+    info->me_last_pgno = 9u;
+    return MDB_SUCCESS;
+}
+
+static void test_warm_prefetch_advises_used_pages(void** state)
+{
+    (void)state;
+
+    g_map = mmap(NULL, 64u * UT_PAGE, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    assert_true(g_map != MAP_FAILED);
+    g_ut_mdb_env_info = ut_env_info;
+
+    /* Up to the high-water mark only */
+    assert_int_equal(ops_warm_prefetch_map(), 0);
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.advised_bytes, 10u * UT_PAGE);
+
+    /* madvise refuses an address off a page boundary */
+    void* map = g_map;
+    g_map     = (char*)map + 1;
+    assert_int_equal(ops_warm_prefetch_map(), -EINVAL);
+    g_map = map;
+
+    munmap(g_map, 64u * UT_PAGE);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_warm_schema_save() / ops_warm_schema_open() tests                     */
+/* ------------------------------------------------------------------------- */
+
+static int ut_cmp(const db_view_t* a, const db_view_t* b)
+{
+    (void)a;
+    (void)b;
+    return 0;
+}
+
+static void test_warm_schema_round_trip_opens_read_only(void** state)
+{
+    (void)state;
+
+    db_env_cfg_t cfg = { 0 };
+
+    /* No record yet: cold open */
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), 0);
+    assert_int_equal(atomic_load(&g_aborts), 1);
+
+    ut_save_schema();
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), 1);
+
+    /* Flags from the record, existing DBIs only, handles kept by a commit */
+    assert_int_equal(g_dbis[0].db_flags, 0u);
+    assert_int_equal(g_dbis[1].db_flags, MDB_DUPSORT);
+    assert_int_equal(g_dbis[0].dbi, 2u);
+    assert_int_equal(g_dbis[1].dbi, 3u);
+    assert_int_equal(g_opens, 2);
+    assert_int_equal(g_open_flags[0] & MDB_CREATE, 0u);
+    assert_int_equal(g_open_flags[1], MDB_DUPSORT);
+    assert_int_equal(g_derived, 2);
+    assert_int_equal(g_orders, 0);
+    assert_int_equal(g_commits, 1);
+    assert_int_equal(atomic_load(&g_aborts), 1);
+
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.schema_hit, 1);
+
+    /* Custom orders are installed in the same txn, a refusal fails the open */
+    const db_cmp_fn_t cmps[2] = { ut_cmp, NULL };
+    cfg.key_cmps              = cmps;
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), 1);
+    assert_int_equal(g_orders, 1);
+    g_order_rc = -EINVAL;
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), -EINVAL);
+
+    /* The refused open ends its read txn once, and never commits it */
+    assert_int_equal(atomic_load(&g_aborts), 2);
+    assert_int_equal(g_commits, 2);
+    assert_int_equal(atomic_load(&g_txns), atomic_load(&g_aborts) + g_commits);
+}
+
+static void test_warm_schema_mismatch_falls_back(void** state)
+{
+    (void)state;
+
+    db_env_cfg_t cfg = { 0 };
+    ut_save_schema();
+
+    /* Another type, another name, fewer DBIs */
+    const dbi_type_t types2[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+    const char*      names2[] = { "dbi0", "dbi9" };
+    assert_int_equal(ops_warm_schema_open(k_names, types2, 2u, &cfg), 0);
+    assert_int_equal(ops_warm_schema_open(names2, k_types, 2u, &cfg), 0);
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 1u, &cfg), 0);
+    assert_int_equal(g_opens, 0);
+
+    /* A DBI dropped since: the read txn and its handles go away */
+    g_gone_name = "dbi1";
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), 0);
+    assert_int_equal(g_commits, 0);
+    assert_int_equal(atomic_load(&g_aborts), 4);
+
+    /* A truncated record */
+    g_gone_name = NULL;
+    g_rec_size -= 2u;
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 2u, &cfg), 0);
+
+    assert_int_equal(ops_warm_schema_open(NULL, k_types, 2u, &cfg), -EINVAL);
+    assert_int_equal(ops_warm_schema_open(k_names, k_types, 3u, &cfg), -EINVAL);
+    assert_int_equal(ops_warm_schema_save(NULL, k_names, k_types, 2u), -EINVAL);
+
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.schema_hit, 0);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_warm_walk_start() tests                                               */
+/* ------------------------------------------------------------------------- */
+
+static void test_warm_walks_every_entry_in_steps(void** state)
+{
+    (void)state;
+
+    g_dbis[0].dbi        = 2u;
+    g_dbis[1].dbi        = 3u;
+    g_dbis[1].is_dupsort = 1u;
+
+    assert_int_equal(ops_warm_walk_start(1u << 2), -EINVAL);
+    assert_int_equal(ops_warm_walk_start(0x3u), 0);
+    assert_int_equal(ops_warm_wait(), 0);
+
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.walkers, 0u);
+    assert_int_equal(st.walk_res, 0);
+    assert_int_equal(st.walked, 2u * UT_KEYS);
+    assert_int_equal(st.walked_bytes, 2u * UT_KEYS * (8u + UT_VAL));
+
+    /* ceil(UT_KEYS / DB_LMDB_WARM_STEP) read txns per DBI, all in the gate */
+    const int steps = (int)((UT_KEYS + DB_LMDB_WARM_STEP - 1u) / DB_LMDB_WARM_STEP);
+    assert_int_equal(atomic_load(&g_txns), 2 * steps);
+    assert_int_equal(atomic_load(&g_aborts), 2 * steps);
+    assert_int_equal(atomic_load(&g_enters), 2 * steps);
+    assert_int_equal(atomic_load(&g_leaves), 2 * steps);
+
+    /* Dups are skipped on the DUPSORT DBI */
+    assert_int_equal(atomic_load(&g_nodup_seen), 1);
+}
+
+/* Lets the held walk go once ops_warm_stop() has asked it to stop */
+static void* ut_release(void* arg)
+{
+    (void)arg;
+    usleep(50000);
+    atomic_store(&g_hold, 0);
+    return NULL;
+}
+
+static void test_warm_stop_and_errors(void** state)
+{
+    (void)state;
+
+    /* A walk held on its first entry */
+    atomic_store(&g_hold, 1);
+    assert_int_equal(ops_warm_walk_start(0x1u), 0);
+    assert_int_equal(ops_warm_walk_start(0x1u), -EALREADY);
+    while(!atomic_load(&g_held)) sched_yield();
+
+    db_warm_stats_t st;
+    ops_warm_stats(&st);
+    assert_int_equal(st.walkers, 1u);
+
+    /* Stop is seen at the end of the step */
+    pthread_t rel;
+    assert_int_equal(pthread_create(&rel, NULL, ut_release, NULL), 0);
+    ops_warm_stop();
+    pthread_join(rel, NULL);
+    ops_warm_stats(&st);
+    assert_int_equal(st.walkers, 0u);
+    assert_int_equal(st.walked, DB_LMDB_WARM_STEP);
+    assert_int_equal(atomic_load(&g_enters), atomic_load(&g_leaves));
+
+    /* The first error is kept */
+    ops_warm_reset();
+    g_cursor_rc = EIO;
+    assert_int_equal(ops_warm_walk_start(0x3u), 0);
+    assert_int_equal(ops_warm_wait(), -EIO);
+    ops_warm_stats(&st);
+    assert_int_equal(st.walk_res, -EIO);
+    assert_int_equal(st.walked, 0u);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_warm_readers_clears_stale_slots, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_warm_prefetch_advises_used_pages, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_warm_schema_round_trip_opens_read_only, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_warm_schema_mismatch_falls_back, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_warm_walks_every_entry_in_steps, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_warm_stop_and_errors, ut_setup, ut_teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
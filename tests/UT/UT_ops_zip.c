@@ -0,0 +1,505 @@
+#include <errno.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "tests/UT/ut_env.h"
+#include "core/operations/ops_int/db/dbi_int.h"
+#include "core/operations/ops_int/ops_map.h"
+#include "core/operations/ops_int/ops_zip.h"
+
+/* ------------------------------------------------------------------------- */
+/* Helpers                                                                   */
+/* ------------------------------------------------------------------------- */
+
+/* 0: compressed, 1: dictionaries, 2: DUPSORT spare, 3: plain */
+enum
+{
+    UT_DOCS  = 0,
+    UT_META  = 1,
+    UT_DUPS  = 2,
+    UT_PLAIN = 3,
+    UT_DBIS  = 4
+};
+
+static const dbi_type_t g_types[UT_DBIS] = { DBI_TYPE_ZIP, DBI_TYPE_DEFAULT, DBI_TYPE_DUPSORT,
+                                             DBI_TYPE_DEFAULT };
+
+static DataBase_t g_db;
+static dbi_t      g_dbis[UT_DBIS];
+
+/* Tiny in-memory store behind mdb_get / mdb_put and the cursor */
+typedef struct
+{
+    unsigned      dbi;
+    size_t        ksize;
+    unsigned char key[16];
+    size_t         vsize;
+    unsigned char* val; /* malloc'd: records or dictionaries */
+} ut_rec_t;
+
+static ut_rec_t g_recs[1100];
+static size_t   g_n_recs;
+static unsigned g_cursor_dbi;
+static ut_rec_t g_cursor_at;
+
+/* Lightweight stubs of the map layer */
+static int g_map_depth;
+static int g_commits;
+
+void ops_map_enter(void)
+{
+    g_map_depth++;
+}
+
+void ops_map_leave(void)
+{
+    g_map_depth--;
+}
+
+void ops_map_after_commit(void)
+{
+    assert_int_equal(g_map_depth, 0);
+}
+
+int ops_map_on_full(const unsigned attempt)
+{
+    (void)attempt;
+    assert_int_equal(g_map_depth, 0);
+    return 0;
+}
+
+static int ut_cmp(const unsigned char* a, const size_t na, const unsigned char* b,
+                  const size_t nb)
+{
+    const int c = memcmp(a, b, na < nb ? na : nb);
+    return c ? c : (na > nb) - (na < nb);
+}
+
+static ut_rec_t* ut_find(const unsigned dbi, const MDB_val* k)
+{
+    for(size_t i = 0; i < g_n_recs; i++)
+    {
+        ut_rec_t* r = &g_recs[i];
+        if(r->dbi == dbi && ut_cmp(r->key, r->ksize, k->mv_data, k->mv_size) == 0) return r;
+    }
+    return NULL;
+}
+
+static int ut_put(MDB_txn* txn, MDB_dbi dbi, MDB_val* k, MDB_val* v, unsigned flags)
+{
+    (void)txn;
+    (void)flags;
+    assert_true(k->mv_size <= sizeof(g_recs[0].key));
+
+    ut_rec_t* r = ut_find(dbi, k);
+    if(!r)
+    {
+        assert_true(g_n_recs < sizeof(g_recs) / sizeof(g_recs[0]));
+        r        = &g_recs[g_n_recs++];
+        r->dbi   = dbi;
+        r->ksize = k->mv_size;
+        memcpy(r->key, k->mv_data, k->mv_size);
+    }
+    r->vsize = v->mv_size;
+    r->val   = realloc(r->val, v->mv_size ? v->mv_size : 1u);
+    assert_non_null(r->val);
+    memcpy(r->val, v->mv_data, v->mv_size);
+    return MDB_SUCCESS;
+}
+
+static int ut_commit(MDB_txn* txn)
+{
+    (void)txn;
+    g_commits++;
+    return MDB_SUCCESS;
+}
+
+static int ut_cursor_open(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor)
+{
+    (void)txn;
+    g_cursor_dbi = dbi;
+    *cursor      = (MDB_cursor*)0x200;
+    return MDB_SUCCESS;
+}
+
+/* Smallest key of the cursor DBI above (or at, for FIRST / SET_RANGE) the given one */
+static int ut_cursor_get(MDB_cursor* cur, MDB_val* k, MDB_val* v, MDB_cursor_op op)
+{
+    (void)cur;
+    assert_true(op == MDB_FIRST || op == MDB_SET_RANGE || op == MDB_NEXT);
+    const unsigned char* from  = op == MDB_SET_RANGE ? k->mv_data : g_cursor_at.key;
+    const size_t         nfrom = op == MDB_SET_RANGE ? k->mv_size : g_cursor_at.ksize;
+    const int            eq    = op != MDB_NEXT;
+
+    ut_rec_t* best = NULL;
+    for(size_t i = 0; i < g_n_recs; i++)
+    {
+        ut_rec_t* r = &g_recs[i];
+        if(r->dbi != g_cursor_dbi) continue;
+        const int c = op == MDB_FIRST ? 1 : ut_cmp(r->key, r->ksize, from, nfrom);
+        if((c > 0 || (eq && c == 0)) &&
+           (!best || ut_cmp(r->key, r->ksize, best->key, best->ksize) < 0))
+        {
+            best = r;
+        }
+    }
+    if(!best) return MDB_NOTFOUND;
+
+    g_cursor_at = *best;
+    k->mv_data  = g_cursor_at.key;
+    k->mv_size  = g_cursor_at.ksize;
+    v->mv_data  = g_cursor_at.val;
+    v->mv_size  = g_cursor_at.vsize;
+    return MDB_SUCCESS;
+}
+
+static int ut_setup(void** state)
+{
+    (void)state;
+    ut_reset_lmdb_stubs();
+    g_ut_mdb_put         = ut_put;
+    g_ut_mdb_txn_commit  = ut_commit;
+    g_ut_mdb_cursor_open = ut_cursor_open;
+    g_ut_mdb_cursor_get  = ut_cursor_get;
+
+    memset(&g_db, 0, sizeof(g_db));
+    memset(g_dbis, 0, sizeof(g_dbis));
+    for(unsigned i = 0; i < UT_DBIS; i++) g_dbis[i].dbi = i;
+    g_dbis[UT_DUPS].is_dupsort = 1;
+    g_db.env                   = (MDB_env*)0x1;
+    g_db.dbis                  = g_dbis;
+    g_db.n_dbis                = UT_DBIS;
+    DataBase                   = &g_db;
+
+    g_n_recs    = 0;
+    g_map_depth = 0;
+    g_commits   = 0;
+
+    assert_int_equal(ops_zip_open(g_types, UT_DBIS), 0);
+    return 0;
+}
+
+static int ut_teardown(void** state)
+{
+    (void)state;
+    ops_zip_close();
+    for(size_t i = 0; i < g_n_recs; i++) free(g_recs[i].val);
+    memset(g_recs, 0, sizeof(g_recs));
+    DataBase = NULL;
+    ut_reset_lmdb_stubs();
+    return 0;
+}
+
+#if DB_LMDB_LZ4 || DB_LMDB_ZSTD
+/* Record-like text: what dictionaries are for */
+static size_t ut_doc(char* buf, const size_t cap, const unsigned i)
+{
+    return (size_t)snprintf(buf, cap,
+                            "{\"id\":%u,\"name\":\"user-%u\",\"email\":\"user-%u@example.org\","
+                            "\"plan\":\"%s\",\"active\":%s,\"tags\":[\"alpha\",\"beta\"]}",
+                            i, i * 7u, i, (i % 3u) ? "basic" : "premium",
+                            (i % 2u) ? "true" : "false");
+}
+#endif
+
+static void ut_round_trip(const unsigned dbi, const void* data, const size_t size,
+                          MDB_val* out_frame)
+{
+    MDB_val in = { size, (void*)data };
+    assert_int_equal(ops_zip_pack(dbi, &in, out_frame), 0);
+
+    size_t n = 0;
+    assert_int_equal(ops_zip_size(out_frame, &n), 0);
+    assert_int_equal(n, size);
+
+    char plain[4096];
+    assert_true(size <= sizeof(plain));
+    assert_int_equal(ops_zip_unpack(dbi, out_frame, plain, n), 0);
+    assert_memory_equal(plain, data, size);
+
+    MDB_val view;
+    assert_int_equal(ops_zip_view(dbi, out_frame, &view), 0);
+    assert_int_equal(view.mv_size, size);
+    assert_memory_equal(view.mv_data, data, size);
+}
+
+/* ------------------------------------------------------------------------- */
+/* ops_zip_open() / ops_zip_enable() tests                                   */
+/* ------------------------------------------------------------------------- */
+
+static void test_zip_open_rejects_dups(void** state)
+{
+    (void)state;
+
+    assert_true(ops_zip_on(UT_DOCS));
+    assert_false(ops_zip_on(UT_PLAIN));
+    assert_false(ops_zip_on(DB_MAX_DBIS));
+
+    ops_zip_close();
+    const dbi_type_t dups[2] = { DBI_TYPE_ZIP, DBI_TYPE_ZIP | DBI_TYPE_DUPSORT };
+    assert_int_equal(ops_zip_open(dups, 2), -EINVAL);
+    assert_false(ops_zip_on(0));
+    assert_int_equal(ops_zip_open(NULL, 2), -EINVAL);
+}
+
+static void test_zip_enable_validates(void** state)
+{
+    (void)state;
+
+    const db_zip_cfg_t none = { .codec = DB_ZIP_NONE };
+    assert_int_equal(ops_zip_enable(UT_PLAIN, &none), -EINVAL);
+    assert_int_equal(ops_zip_enable(UT_DOCS, NULL), -EINVAL);
+    assert_int_equal(ops_zip_enable(UT_DOCS, &none), 0);
+
+    /* Dictionaries: zstd only, in a plain DBI of their own */
+    const db_zip_cfg_t no_zstd = { .codec = DB_ZIP_NONE, .dict = 1, .meta_dbi = UT_META };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &no_zstd), -EINVAL);
+#if DB_LMDB_ZSTD
+    const db_zip_cfg_t self = { .codec = DB_ZIP_ZSTD, .dict = 1, .meta_dbi = UT_DOCS };
+    const db_zip_cfg_t dups = { .codec = DB_ZIP_ZSTD, .dict = 1, .meta_dbi = UT_DUPS };
+    const db_zip_cfg_t far  = { .codec = DB_ZIP_ZSTD, .dict = 1, .meta_dbi = UT_DBIS };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &self), -EINVAL);
+    assert_int_equal(ops_zip_enable(UT_DOCS, &dups), -EINVAL);
+    assert_int_equal(ops_zip_enable(UT_DOCS, &far), -EINVAL);
+#else
+    const db_zip_cfg_t zstd = { .codec = DB_ZIP_ZSTD };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &zstd), -ENOTSUP);
+#endif
+#if !DB_LMDB_LZ4
+    const db_zip_cfg_t lz4 = { .codec = DB_ZIP_LZ4 };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &lz4), -ENOTSUP);
+#endif
+
+    /* No dictionary set up */
+    assert_int_equal(ops_zip_train(UT_DOCS, NULL, 0), -EINVAL);
+    assert_int_equal(ops_zip_train(UT_PLAIN, NULL, 0), -EINVAL);
+}
+
+/* ------------------------------------------------------------------------- */
+/* Frame tests                                                               */
+/* ------------------------------------------------------------------------- */
+
+static void test_zip_small_and_uncompressed_values_stay_raw(void** state)
+{
+    (void)state;
+
+    /* Below min_size, whatever the codec */
+    MDB_val frame;
+    ut_round_trip(UT_DOCS, "tiny", 4, &frame);
+    assert_int_equal(frame.mv_size, 5);
+    assert_int_equal(((unsigned char*)frame.mv_data)[0], 0);
+
+    /* Raw views point into the frame, no copy */
+    MDB_val view;
+    assert_int_equal(ops_zip_view(UT_DOCS, &frame, &view), 0);
+    assert_ptr_equal(view.mv_data, (unsigned char*)frame.mv_data + 1);
+
+    /* Codec NONE: frames only */
+    char doc[512];
+    memset(doc, 'a', sizeof(doc));
+    const db_zip_cfg_t none = { .codec = DB_ZIP_NONE, .min_size = 1 };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &none), 0);
+    ut_round_trip(UT_DOCS, doc, sizeof(doc), &frame);
+    assert_int_equal(frame.mv_size, sizeof(doc) + 1);
+    ut_round_trip(UT_DOCS, "", 0, &frame);
+
+    db_zip_stats_t st;
+    assert_int_equal(ops_zip_stats(UT_DOCS, &st), 0);
+    assert_int_equal(st.packed, 0);
+    assert_int_equal(st.raw, 3);
+    assert_int_equal(st.bytes_in, 4 + sizeof(doc));
+    assert_int_equal(st.bytes_out, 5 + sizeof(doc) + 1 + 1);
+    assert_int_equal(st.dict_id, 0);
+    assert_int_equal(ops_zip_stats(UT_PLAIN, &st), -ENOENT);
+}
+
+static void test_zip_malformed_frames_fail(void** state)
+{
+    (void)state;
+
+    size_t  n     = 0;
+    MDB_val empty = { 0, (unsigned char[]){ 0 } };
+    assert_int_equal(ops_zip_size(&empty, &n), -EIO);
+
+    /* Compressed tags need their header and a block */
+    MDB_val short_lz4  = { 5, (unsigned char[]){ 1, 4, 0, 0, 0 } };
+    MDB_val short_zstd = { 9, (unsigned char[]){ 2, 4, 0, 0, 0, 0, 0, 0, 0 } };
+    assert_int_equal(ops_zip_size(&short_lz4, &n), -EIO);
+    assert_int_equal(ops_zip_size(&short_zstd, &n), -EIO);
+
+    /* Unknown tag */
+    MDB_val view;
+    MDB_val unknown = { 8, (unsigned char[]){ 7, 1, 0, 0, 0, 9, 9, 9 } };
+    assert_int_equal(ops_zip_size(&unknown, &n), -EIO);
+    assert_int_equal(ops_zip_view(UT_DOCS, &unknown, &view), -EIO);
+
+    /* Garbage after a valid header */
+    MDB_val junk = { 10, (unsigned char[]){ 1, 4, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0xff } };
+#if DB_LMDB_LZ4
+    assert_int_equal(ops_zip_view(UT_DOCS, &junk, &view), -EIO);
+#else
+    assert_int_equal(ops_zip_view(UT_DOCS, &junk, &view), -ENOTSUP);
+#endif
+}
+
+#if DB_LMDB_LZ4
+static void test_zip_lz4_round_trip(void** state)
+{
+    (void)state;
+
+    const db_zip_cfg_t lz4 = { .codec = DB_ZIP_LZ4, .min_size = 64 };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &lz4), 0);
+
+    char   docs[4096];
+    size_t used = 0;
+    for(unsigned i = 0; used < sizeof(docs) - 256u; i++)
+    {
+        used += ut_doc(docs + used, sizeof(docs) - used, i);
+    }
+    MDB_val frame;
+    ut_round_trip(UT_DOCS, docs, used, &frame);
+    assert_int_equal(((unsigned char*)frame.mv_data)[0], 1);
+    assert_true(frame.mv_size < used / 2);
+
+    /* Noise does not shrink: stored raw */
+    unsigned char noise[1024];
+    uint32_t      x = 2463534242u;
+    for(size_t i = 0; i < sizeof(noise); i++)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        noise[i] = (unsigned char)x;
+    }
+    ut_round_trip(UT_DOCS, noise, sizeof(noise), &frame);
+    assert_int_equal(((unsigned char*)frame.mv_data)[0], 0);
+
+    db_zip_stats_t st;
+    assert_int_equal(ops_zip_stats(UT_DOCS, &st), 0);
+    assert_int_equal(st.packed, 1);
+    assert_int_equal(st.raw, 1);
+    assert_true(st.bytes_out < st.bytes_in);
+}
+#endif
+
+#if DB_LMDB_ZSTD
+static void test_zip_zstd_dict_trained_stored_and_reloaded(void** state)
+{
+    (void)state;
+
+    const db_zip_cfg_t cfg = { .codec = DB_ZIP_ZSTD, .min_size = 32, .dict = 1,
+                               .meta_dbi = UT_META };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &cfg), 0);
+
+    /* Without a dictionary a small record does not shrink */
+    char    doc[256];
+    size_t  n = ut_doc(doc, sizeof(doc), 4242);
+    MDB_val plain_frame;
+    ut_round_trip(UT_DOCS, doc, n, &plain_frame);
+    assert_int_equal(((unsigned char*)plain_frame.mv_data)[0], 0);
+
+    static char      pool[1000][160];
+    static db_view_t samples[1000];
+    for(unsigned i = 0; i < 1000u; i++)
+    {
+        samples[i].data = pool[i];
+        samples[i].size = ut_doc(pool[i], sizeof(pool[i]), i);
+    }
+    assert_int_equal(ops_zip_train(UT_DOCS, samples, 1000), 1);
+    assert_int_equal(g_commits, 1);
+    assert_int_equal(g_map_depth, 0);
+
+    /* Stored under 'Z' dbi id_be in the meta DBI */
+    MDB_val key = { 6, (unsigned char[]){ 'Z', UT_DOCS, 0, 0, 0, 1 } };
+    assert_non_null(ut_find(UT_META, &key));
+
+    MDB_val dict_frame;
+    ut_round_trip(UT_DOCS, doc, n, &dict_frame);
+    assert_int_equal(((unsigned char*)dict_frame.mv_data)[0], 2);
+    assert_int_equal(((unsigned char*)dict_frame.mv_data)[5], 1);
+    assert_true(dict_frame.mv_size < n / 2);
+
+    db_zip_stats_t st;
+    assert_int_equal(ops_zip_stats(UT_DOCS, &st), 0);
+    assert_int_equal(st.dict_id, 1);
+
+    /* After a restart the dictionary comes back from the meta DBI */
+    unsigned char stored[512];
+    memcpy(stored, dict_frame.mv_data, dict_frame.mv_size);
+    MDB_val old = { dict_frame.mv_size, stored };
+    ops_zip_close();
+    assert_int_equal(ops_zip_open(g_types, UT_DBIS), 0);
+
+    MDB_val view;
+    assert_int_equal(ops_zip_view(UT_DOCS, &old, &view), -ENOKEY);
+    assert_int_equal(ops_zip_enable(UT_DOCS, &cfg), 0);
+    assert_int_equal(ops_zip_view(UT_DOCS, &old, &view), 0);
+    assert_int_equal(view.mv_size, n);
+    assert_memory_equal(view.mv_data, doc, n);
+}
+
+static void test_zip_zstd_train_from_stored_values(void** state)
+{
+    (void)state;
+
+    const db_zip_cfg_t cfg = { .codec = DB_ZIP_ZSTD, .min_size = 32, .dict = 1,
+                               .meta_dbi = UT_META };
+    assert_int_equal(ops_zip_enable(UT_DOCS, &cfg), 0);
+
+    /* Too few values to learn from */
+    assert_int_equal(ops_zip_train(UT_DOCS, NULL, 0), -EINVAL);
+
+    /* Stored values are frames: the scan decodes them for the trainer */
+    for(unsigned i = 0; i < 1000u; i++)
+    {
+        char    doc[160];
+        char    id[16];
+        MDB_val frame;
+        MDB_val in  = { ut_doc(doc, sizeof(doc), i), doc };
+        MDB_val key = { (size_t)snprintf(id, sizeof(id), "u%04u", i), id };
+        assert_int_equal(ops_zip_pack(UT_DOCS, &in, &frame), 0);
+        assert_int_equal(ut_put(NULL, UT_DOCS, &key, &frame, 0), MDB_SUCCESS);
+    }
+
+    assert_int_equal(ops_zip_train(UT_DOCS, NULL, 0), 1);
+    assert_int_equal(ops_zip_train(UT_DOCS, NULL, 0), 2);
+
+    db_zip_stats_t st;
+    assert_int_equal(ops_zip_stats(UT_DOCS, &st), 0);
+    assert_int_equal(st.dict_id, 2);
+    assert_int_equal(g_map_depth, 0);
+}
+#endif
+
+/* ------------------------------------------------------------------------- */
+/* Main                                                                      */
+/* ------------------------------------------------------------------------- */
+
+int main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_setup_teardown(test_zip_open_rejects_dups, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_zip_enable_validates, ut_setup, ut_teardown),
+        cmocka_unit_test_setup_teardown(test_zip_small_and_uncompressed_values_stay_raw, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_zip_malformed_frames_fail, ut_setup, ut_teardown),
+#if DB_LMDB_LZ4
+        cmocka_unit_test_setup_teardown(test_zip_lz4_round_trip, ut_setup, ut_teardown),
+#endif
+#if DB_LMDB_ZSTD
+        cmocka_unit_test_setup_teardown(test_zip_zstd_dict_trained_stored_and_reloaded, ut_setup,
+                                        ut_teardown),
+        cmocka_unit_test_setup_teardown(test_zip_zstd_train_from_stored_values, ut_setup,
+                                        ut_teardown),
+#endif
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
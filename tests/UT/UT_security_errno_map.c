@@ -99,143 +99,6 @@ static void test_map_mdb_known_and_unknown_errors_to_errno(void** state)
     }
 }
 
-/* ------------------------------------------------------------------------- */
-/* _expand_env_mapsize() tests                                               */
-/* ------------------------------------------------------------------------- */
-
-static void test_expand_env_mapsize_returns_eio_when_db_invalid(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-
-    /* No DataBase and no env pointer. */
-    assert_int_equal(_expand_env_mapsize(), -EIO);
-
-    /* DataBase present but env is NULL. */
-    static DataBase_t db;
-    DataBase                  = &db;
-    db.env                    = NULL;
-    db.dbis                   = NULL;
-    db.n_dbis                 = 0u;
-    db.map_size_bytes_max     = 0u;
-
-    assert_int_equal(_expand_env_mapsize(), -EIO);
-}
-
-static int ut_env_info_always_fail(MDB_env* env, MDB_envinfo* info)
-{
-    (void)env;
-    (void)info;
-    return MDB_PANIC;
-}
-
-static void test_expand_env_mapsize_fails_after_three_env_info_retries(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-
-    MDB_env*         dummy_env = (MDB_env*)0x1;
-    static DataBase_t db;
-
-    db.env                = dummy_env;
-    db.dbis               = NULL;
-    db.n_dbis             = 0u;
-    db.map_size_bytes_max = (size_t)1u << 20;
-    DataBase              = &db;
-
-    g_ut_mdb_env_info = ut_env_info_always_fail;
-
-    assert_int_equal(_expand_env_mapsize(), -EIO);
-}
-
-static int ut_env_info_small_mapsize(MDB_env* env, MDB_envinfo* info)
-{
-    (void)env;
-    if(info)
-    {
-        info->me_mapsize = 1024u;
-    }
-    return MDB_SUCCESS;
-}
-
-static void test_expand_env_mapsize_fails_when_desired_exceeds_max(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-
-    MDB_env*         dummy_env = (MDB_env*)0x1;
-    static DataBase_t db;
-
-    db.env                = dummy_env;
-    db.dbis               = NULL;
-    db.n_dbis             = 0u;
-    db.map_size_bytes_max = 1024u; /* desired will be 2048u */
-    DataBase              = &db;
-
-    g_ut_mdb_env_info = ut_env_info_small_mapsize;
-
-    assert_int_equal(_expand_env_mapsize(), MDB_MAP_FULL);
-}
-
-static int ut_env_set_mapsize_fail(MDB_env* env, size_t size)
-{
-    (void)env;
-    (void)size;
-    return MDB_PANIC;
-}
-
-static void test_expand_env_mapsize_propagates_set_mapsize_error(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-
-    MDB_env*         dummy_env = (MDB_env*)0x1;
-    static DataBase_t db;
-
-    db.env                = dummy_env;
-    db.dbis               = NULL;
-    db.n_dbis             = 0u;
-    db.map_size_bytes_max = (size_t)1u << 20;
-    DataBase              = &db;
-
-    g_ut_mdb_env_info        = ut_env_info_small_mapsize;
-    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_fail;
-
-    assert_int_equal(_expand_env_mapsize(), MDB_PANIC);
-}
-
-static int ut_env_set_mapsize_ok(MDB_env* env, size_t size)
-{
-    (void)env;
-    (void)size;
-    return MDB_SUCCESS;
-}
-
-static void test_expand_env_mapsize_success_returns_zero(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-
-    MDB_env*         dummy_env = (MDB_env*)0x1;
-    static DataBase_t db;
-
-    db.env                = dummy_env;
-    db.dbis               = NULL;
-    db.n_dbis             = 0u;
-    db.map_size_bytes_max = (size_t)1u << 20;
-    DataBase              = &db;
-
-    g_ut_mdb_env_info        = ut_env_info_small_mapsize;
-    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_ok;
-
-    assert_int_equal(_expand_env_mapsize(), MDB_SUCCESS);
-}
-
 /* ------------------------------------------------------------------------- */
 /* security_check() tests                                                    */
 /* ------------------------------------------------------------------------- */
@@ -269,64 +132,52 @@ static void test_security_check_retry_case_aborts_txn_and_sets_errno(void** stat
     assert_ptr_equal(g_last_aborted_txn, dummy_txn);
 }
 
-static void test_security_check_map_full_expand_success_returns_retry(void** state)
+static int g_set_mapsize_calls = 0;
+
+static int ut_env_set_mapsize_count(MDB_env* env, size_t size)
+{
+    (void)env;
+    (void)size;
+    g_set_mapsize_calls++;
+    return MDB_SUCCESS;
+}
+
+static void test_security_check_map_full_returns_retry_without_resize(void** state)
 {
     (void)state;
 
     ut_reset_all();
     reset_abort_tracking();
 
-    MDB_env*         dummy_env = (MDB_env*)0x3;
     static DataBase_t db;
 
-    db.env                = dummy_env;
+    db.env                = (MDB_env*)0x3;
     db.dbis               = NULL;
     db.n_dbis             = 0u;
     db.map_size_bytes_max = (size_t)1u << 20;
     DataBase              = &db;
 
-    g_ut_mdb_env_info        = ut_env_info_small_mapsize;
-    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_ok;
+    g_set_mapsize_calls      = 0;
+    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_count;
 
     MDB_txn* dummy_txn = (MDB_txn*)0x4;
     int      errno_out = 0;
 
+    /* Other txns may be open: the caller grows the map (ops_map_on_full) */
     db_security_ret_code_t rc = security_check(MDB_MAP_FULL, dummy_txn, &errno_out);
 
     assert_int_equal(rc, DB_SAFETY_RETRY);
     assert_int_equal(errno_out, -ENOSPC);
     assert_int_equal(g_abort_calls, 1);
     assert_ptr_equal(g_last_aborted_txn, dummy_txn);
-}
-
-static void test_security_check_map_full_expand_failure_returns_fail(void** state)
-{
-    (void)state;
-
-    ut_reset_all();
-    reset_abort_tracking();
-
-    MDB_env*         dummy_env = (MDB_env*)0x5;
-    static DataBase_t db;
-
-    db.env                = dummy_env;
-    db.dbis               = NULL;
-    db.n_dbis             = 0u;
-    db.map_size_bytes_max = (size_t)1u << 20;
-    DataBase              = &db;
-
-    g_ut_mdb_env_info        = ut_env_info_small_mapsize;
-    g_ut_mdb_env_set_mapsize = ut_env_set_mapsize_fail;
+    assert_int_equal(g_set_mapsize_calls, 0);
 
-    MDB_txn* dummy_txn = (MDB_txn*)0x6;
-    int      errno_out = 0;
-
-    db_security_ret_code_t rc = security_check(MDB_MAP_FULL, dummy_txn, &errno_out);
-
-    assert_int_equal(rc, DB_SAFETY_FAIL);
-    assert_int_equal(errno_out, -ENOSPC);
+    /* Same answer without a txn or a database */
+    DataBase = NULL;
+    rc       = security_check(MDB_MAP_FULL, NULL, &errno_out);
+    assert_int_equal(rc, DB_SAFETY_RETRY);
     assert_int_equal(g_abort_calls, 1);
-    assert_ptr_equal(g_last_aborted_txn, dummy_txn);
+    assert_int_equal(g_set_mapsize_calls, 0);
 }
 
 static void test_security_check_logic_failure_returns_fail_without_abort(void** state)
@@ -365,6 +216,52 @@ static void test_security_check_unknown_error_aborts_txn_and_sets_errno(void** s
     assert_ptr_equal(g_last_aborted_txn, dummy_txn);
 }
 
+/* ------------------------------------------------------------------------- */
+/* security_fail_txn() / security_abort_txn() tests                          */
+/* ------------------------------------------------------------------------- */
+
+static void test_security_fail_txn_aborts_on_logic_failure_once(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    reset_abort_tracking();
+
+    MDB_txn* dummy_txn = (MDB_txn*)0x8;
+    int      errno_out = 0;
+
+    assert_int_equal(security_fail_txn(MDB_KEYEXIST, dummy_txn, &errno_out), DB_SAFETY_FAIL);
+    assert_int_equal(errno_out, -EEXIST);
+    assert_int_equal(g_abort_calls, 1);
+    assert_ptr_equal(g_last_aborted_txn, dummy_txn);
+
+    /* Already aborted by security_check: not a second time */
+    reset_abort_tracking();
+    assert_int_equal(security_fail_txn(MDB_TXN_FULL, dummy_txn, &errno_out), DB_SAFETY_RETRY);
+    assert_int_equal(errno_out, -EOVERFLOW);
+    assert_int_equal(g_abort_calls, 1);
+
+    reset_abort_tracking();
+    assert_int_equal(security_fail_txn(MDB_SUCCESS, dummy_txn, NULL), DB_SAFETY_SUCCESS);
+    assert_int_equal(g_abort_calls, 0);
+}
+
+static void test_security_abort_txn_reports_error(void** state)
+{
+    (void)state;
+
+    ut_reset_all();
+    reset_abort_tracking();
+
+    int errno_out = 0;
+    assert_int_equal(security_abort_txn((MDB_txn*)0x9, -EINVAL, &errno_out), DB_SAFETY_FAIL);
+    assert_int_equal(errno_out, -EINVAL);
+    assert_int_equal(g_abort_calls, 1);
+
+    assert_int_equal(security_abort_txn(NULL, -EIO, NULL), DB_SAFETY_FAIL);
+    assert_int_equal(g_abort_calls, 1);
+}
+
 /* ------------------------------------------------------------------------- */
 /* Main                                                                      */
 /* ------------------------------------------------------------------------- */
@@ -374,16 +271,12 @@ int main(void)
     const struct CMUnitTest tests[] = {
         cmocka_unit_test(test_map_mdb_success_returns_zero),
         cmocka_unit_test(test_map_mdb_known_and_unknown_errors_to_errno),
-        cmocka_unit_test(test_expand_env_mapsize_returns_eio_when_db_invalid),
-        cmocka_unit_test(test_expand_env_mapsize_fails_after_three_env_info_retries),
-        cmocka_unit_test(test_expand_env_mapsize_fails_when_desired_exceeds_max),
-        cmocka_unit_test(test_expand_env_mapsize_propagates_set_mapsize_error),
-        cmocka_unit_test(test_expand_env_mapsize_success_returns_zero),
         cmocka_unit_test(test_security_check_retry_case_aborts_txn_and_sets_errno),
-        cmocka_unit_test(test_security_check_map_full_expand_success_returns_retry),
-        cmocka_unit_test(test_security_check_map_full_expand_failure_returns_fail),
+        cmocka_unit_test(test_security_check_map_full_returns_retry_without_resize),
         cmocka_unit_test(test_security_check_logic_failure_returns_fail_without_abort),
         cmocka_unit_test(test_security_check_unknown_error_aborts_txn_and_sets_errno),
+        cmocka_unit_test(test_security_fail_txn_aborts_on_logic_failure_once),
+        cmocka_unit_test(test_security_abort_txn_reports_error),
     };
 
     int rc = cmocka_run_group_tests(tests, NULL, NULL);
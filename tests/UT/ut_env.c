@@ -1,40 +1,71 @@
 #include "tests/UT/ut_env.h"
 
 #include <stdarg.h>
+#include <string.h>
 
 /* Global DB handle expected by core code. */
 DataBase_t* DataBase = NULL;
 
 /* Hook points used by tests to customize LMDB behavior. */
 ut_mdb_env_info_fn         g_ut_mdb_env_info         = NULL;
+ut_mdb_env_stat_fn         g_ut_mdb_env_stat         = NULL;
+ut_mdb_stat_fn             g_ut_mdb_stat             = NULL;
 ut_mdb_env_set_mapsize_fn  g_ut_mdb_env_set_mapsize  = NULL;
 ut_mdb_txn_abort_fn        g_ut_mdb_txn_abort        = NULL;
+ut_mdb_txn_reset_fn        g_ut_mdb_txn_reset        = NULL;
+ut_mdb_txn_renew_fn        g_ut_mdb_txn_renew        = NULL;
 ut_mdb_env_create_fn       g_ut_mdb_env_create       = NULL;
 ut_mdb_env_close_fn        g_ut_mdb_env_close        = NULL;
 ut_mdb_env_set_maxdbs_fn   g_ut_mdb_env_set_maxdbs   = NULL;
 ut_mdb_env_open_fn         g_ut_mdb_env_open         = NULL;
+ut_mdb_env_set_maxreaders_fn g_ut_mdb_env_set_maxreaders = NULL;
+ut_mdb_env_sync_fn         g_ut_mdb_env_sync         = NULL;
 ut_mdb_dbi_open_fn         g_ut_mdb_dbi_open         = NULL;
 ut_mdb_dbi_flags_fn        g_ut_mdb_dbi_flags        = NULL;
 ut_mdb_txn_begin_fn        g_ut_mdb_txn_begin        = NULL;
 ut_mdb_txn_commit_fn       g_ut_mdb_txn_commit       = NULL;
 ut_mdb_put_fn              g_ut_mdb_put              = NULL;
 ut_mdb_get_fn              g_ut_mdb_get              = NULL;
+ut_mdb_del_fn              g_ut_mdb_del              = NULL;
+ut_mdb_cursor_open_fn      g_ut_mdb_cursor_open      = NULL;
+ut_mdb_cursor_get_fn       g_ut_mdb_cursor_get       = NULL;
+ut_mdb_cursor_del_fn       g_ut_mdb_cursor_del       = NULL;
+ut_mdb_cursor_put_fn       g_ut_mdb_cursor_put       = NULL;
+ut_mdb_set_cmp_fn          g_ut_mdb_set_compare      = NULL;
+ut_mdb_set_cmp_fn          g_ut_mdb_set_dupsort      = NULL;
+ut_mdb_env_copyfd2_fn      g_ut_mdb_env_copyfd2      = NULL;
+ut_mdb_reader_check_fn     g_ut_mdb_reader_check     = NULL;
 
 void ut_reset_lmdb_stubs(void)
 {
     g_ut_mdb_env_info         = NULL;
+    g_ut_mdb_env_stat         = NULL;
+    g_ut_mdb_stat             = NULL;
     g_ut_mdb_env_set_mapsize  = NULL;
     g_ut_mdb_txn_abort        = NULL;
+    g_ut_mdb_txn_reset        = NULL;
+    g_ut_mdb_txn_renew        = NULL;
     g_ut_mdb_env_create       = NULL;
     g_ut_mdb_env_close        = NULL;
     g_ut_mdb_env_set_maxdbs   = NULL;
     g_ut_mdb_env_open         = NULL;
+    g_ut_mdb_env_set_maxreaders = NULL;
+    g_ut_mdb_env_sync         = NULL;
     g_ut_mdb_dbi_open         = NULL;
     g_ut_mdb_dbi_flags        = NULL;
     g_ut_mdb_txn_begin        = NULL;
     g_ut_mdb_txn_commit       = NULL;
     g_ut_mdb_put              = NULL;
     g_ut_mdb_get              = NULL;
+    g_ut_mdb_del              = NULL;
+    g_ut_mdb_cursor_open      = NULL;
+    g_ut_mdb_cursor_get       = NULL;
+    g_ut_mdb_cursor_del       = NULL;
+    g_ut_mdb_cursor_put       = NULL;
+    g_ut_mdb_set_compare      = NULL;
+    g_ut_mdb_set_dupsort      = NULL;
+    g_ut_mdb_env_copyfd2      = NULL;
+    g_ut_mdb_reader_check     = NULL;
 }
 
 /* ------------------------------------------------------------------------- */
@@ -77,6 +108,28 @@ void mdb_txn_abort(MDB_txn* txn)
     (void)txn;
 }
 
+void mdb_txn_reset(MDB_txn* txn)
+{
+    if(g_ut_mdb_txn_reset)
+    {
+        g_ut_mdb_txn_reset(txn);
+        return;
+    }
+
+    (void)txn;
+}
+
+int mdb_txn_renew(MDB_txn* txn)
+{
+    if(g_ut_mdb_txn_renew)
+    {
+        return g_ut_mdb_txn_renew(txn);
+    }
+
+    (void)txn;
+    return MDB_SUCCESS;
+}
+
 int mdb_env_info(MDB_env* env, MDB_envinfo* stat)
 {
     if(g_ut_mdb_env_info)
@@ -94,6 +147,39 @@ int mdb_env_info(MDB_env* env, MDB_envinfo* stat)
     return MDB_SUCCESS;
 }
 
+int mdb_env_stat(MDB_env* env, MDB_stat* stat)
+{
+    if(g_ut_mdb_env_stat)
+    {
+        return g_ut_mdb_env_stat(env, stat);
+    }
+
+    (void)env;
+    if(stat != NULL)
+    {
+        memset(stat, 0, sizeof(*stat));
+        stat->ms_psize = 4096;
+    }
+    return MDB_SUCCESS;
+}
+
+int mdb_stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* stat)
+{
+    if(g_ut_mdb_stat)
+    {
+        return g_ut_mdb_stat(txn, dbi, stat);
+    }
+
+    (void)txn;
+    (void)dbi;
+    if(stat != NULL)
+    {
+        memset(stat, 0, sizeof(*stat));
+        stat->ms_psize = 4096;
+    }
+    return MDB_SUCCESS;
+}
+
 int mdb_env_set_mapsize(MDB_env* env, size_t size)
 {
     if(g_ut_mdb_env_set_mapsize)
@@ -144,6 +230,30 @@ int mdb_env_set_maxdbs(MDB_env* env, MDB_dbi dbs)
     return MDB_SUCCESS;
 }
 
+int mdb_env_set_maxreaders(MDB_env* env, unsigned int readers)
+{
+    if(g_ut_mdb_env_set_maxreaders)
+    {
+        return g_ut_mdb_env_set_maxreaders(env, readers);
+    }
+
+    (void)env;
+    (void)readers;
+    return MDB_SUCCESS;
+}
+
+int mdb_env_sync(MDB_env* env, int force)
+{
+    if(g_ut_mdb_env_sync)
+    {
+        return g_ut_mdb_env_sync(env, force);
+    }
+
+    (void)env;
+    (void)force;
+    return MDB_SUCCESS;
+}
+
 int mdb_env_open(MDB_env* env, const char* path, unsigned int flags, mdb_mode_t mode)
 {
     if(g_ut_mdb_env_open)
@@ -251,3 +361,157 @@ int mdb_get(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
     }
     return MDB_SUCCESS;
 }
+
+int mdb_del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data)
+{
+    if(g_ut_mdb_del)
+    {
+        return g_ut_mdb_del(txn, dbi, key, data);
+    }
+
+    (void)txn;
+    (void)dbi;
+    (void)key;
+    (void)data;
+    return MDB_SUCCESS;
+}
+
+int mdb_cursor_open(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor)
+{
+    if(g_ut_mdb_cursor_open)
+    {
+        return g_ut_mdb_cursor_open(txn, dbi, cursor);
+    }
+
+    (void)txn;
+    (void)dbi;
+    if(cursor)
+    {
+        *cursor = (MDB_cursor*)0x800;
+    }
+    return MDB_SUCCESS;
+}
+
+void mdb_cursor_close(MDB_cursor* cursor)
+{
+    (void)cursor;
+}
+
+int mdb_cursor_renew(MDB_txn* txn, MDB_cursor* cursor)
+{
+    (void)txn;
+    (void)cursor;
+    return MDB_SUCCESS;
+}
+
+int mdb_cursor_get(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op)
+{
+    if(g_ut_mdb_cursor_get)
+    {
+        return g_ut_mdb_cursor_get(cursor, key, data, op);
+    }
+
+    /* Default: an empty DBI */
+    (void)cursor;
+    (void)key;
+    (void)data;
+    (void)op;
+    return MDB_NOTFOUND;
+}
+
+int mdb_cursor_del(MDB_cursor* cursor, unsigned int flags)
+{
+    if(g_ut_mdb_cursor_del)
+    {
+        return g_ut_mdb_cursor_del(cursor, flags);
+    }
+
+    (void)cursor;
+    (void)flags;
+    return MDB_SUCCESS;
+}
+
+int mdb_cursor_put(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags)
+{
+    if(g_ut_mdb_cursor_put)
+    {
+        return g_ut_mdb_cursor_put(cursor, key, data, flags);
+    }
+
+    (void)cursor;
+    (void)key;
+    (void)data;
+    (void)flags;
+    return MDB_SUCCESS;
+}
+
+int mdb_cmp(MDB_txn* txn, MDB_dbi dbi, const MDB_val* a, const MDB_val* b)
+{
+    /* Default LMDB order: memcmp, then shorter first */
+    (void)txn;
+    (void)dbi;
+    size_t n  = a->mv_size < b->mv_size ? a->mv_size : b->mv_size;
+    int    rc = memcmp(a->mv_data, b->mv_data, n);
+    if(rc != 0) return rc;
+    return a->mv_size < b->mv_size ? -1 : (a->mv_size > b->mv_size ? 1 : 0);
+}
+
+int mdb_dcmp(MDB_txn* txn, MDB_dbi dbi, const MDB_val* a, const MDB_val* b)
+{
+    /* Default dup order is the same as the key order */
+    return mdb_cmp(txn, dbi, a, b);
+}
+
+int mdb_set_compare(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp)
+{
+    if(g_ut_mdb_set_compare)
+    {
+        return g_ut_mdb_set_compare(txn, dbi, cmp);
+    }
+
+    (void)txn;
+    (void)dbi;
+    (void)cmp;
+    return MDB_SUCCESS;
+}
+
+int mdb_set_dupsort(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp)
+{
+    if(g_ut_mdb_set_dupsort)
+    {
+        return g_ut_mdb_set_dupsort(txn, dbi, cmp);
+    }
+
+    (void)txn;
+    (void)dbi;
+    (void)cmp;
+    return MDB_SUCCESS;
+}
+
+int mdb_env_copyfd2(MDB_env* env, mdb_filehandle_t fd, unsigned int flags)
+{
+    if(g_ut_mdb_env_copyfd2)
+    {
+        return g_ut_mdb_env_copyfd2(env, fd, flags);
+    }
+
+    (void)env;
+    (void)fd;
+    (void)flags;
+    return MDB_SUCCESS;
+}
+
+int mdb_reader_check(MDB_env* env, int* dead)
+{
+    if(g_ut_mdb_reader_check)
+    {
+        return g_ut_mdb_reader_check(env, dead);
+    }
+
+    (void)env;
+    if(dead)
+    {
+        *dead = 0;
+    }
+    return MDB_SUCCESS;
+}
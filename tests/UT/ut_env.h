@@ -25,45 +25,91 @@ void emlog_log_errno(eml_level_t level, const char* comp, int err, const char* f
 /* Minimal LMDB stubs used in the core code paths exercised by UTs. */
 char* mdb_strerror(int err);
 void  mdb_txn_abort(MDB_txn* txn);
+void  mdb_txn_reset(MDB_txn* txn);
+int   mdb_txn_renew(MDB_txn* txn);
 int   mdb_env_info(MDB_env* env, MDB_envinfo* stat);
+int   mdb_env_stat(MDB_env* env, MDB_stat* stat);
+int   mdb_stat(MDB_txn* txn, MDB_dbi dbi, MDB_stat* stat);
 int   mdb_env_set_mapsize(MDB_env* env, size_t size);
 int   mdb_env_create(MDB_env** env);
 void  mdb_env_close(MDB_env* env);
 int   mdb_env_set_maxdbs(MDB_env* env, MDB_dbi dbs);
 int   mdb_env_open(MDB_env* env, const char* path, unsigned int flags, mdb_mode_t mode);
+int   mdb_env_set_maxreaders(MDB_env* env, unsigned int readers);
+int   mdb_env_sync(MDB_env* env, int force);
 int   mdb_dbi_open(MDB_txn* txn, const char* name, unsigned int flags, MDB_dbi* dbi);
 int   mdb_dbi_flags(MDB_txn* txn, MDB_dbi dbi, unsigned int* flags);
+int   mdb_del(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data);
+int   mdb_cursor_open(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor);
+void  mdb_cursor_close(MDB_cursor* cursor);
+int   mdb_cursor_renew(MDB_txn* txn, MDB_cursor* cursor);
+int   mdb_cursor_get(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op);
+int   mdb_cursor_del(MDB_cursor* cursor, unsigned int flags);
+int   mdb_cursor_put(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags);
+int   mdb_cmp(MDB_txn* txn, MDB_dbi dbi, const MDB_val* a, const MDB_val* b);
+int   mdb_dcmp(MDB_txn* txn, MDB_dbi dbi, const MDB_val* a, const MDB_val* b);
+int   mdb_set_compare(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp);
+int   mdb_set_dupsort(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp);
 
 /* Hook points so individual tests can override LMDB behavior without
  * having to redefine symbols. When these function pointers are NULL a
  * reasonable default stub behavior is used. */
 typedef int  (*ut_mdb_env_info_fn)(MDB_env* env, MDB_envinfo* stat);
+typedef int  (*ut_mdb_env_stat_fn)(MDB_env* env, MDB_stat* stat);
+typedef int  (*ut_mdb_stat_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_stat* stat);
 typedef int  (*ut_mdb_env_set_mapsize_fn)(MDB_env* env, size_t size);
 typedef void (*ut_mdb_txn_abort_fn)(MDB_txn* txn);
+typedef void (*ut_mdb_txn_reset_fn)(MDB_txn* txn);
+typedef int  (*ut_mdb_txn_renew_fn)(MDB_txn* txn);
 typedef int  (*ut_mdb_env_create_fn)(MDB_env** env);
 typedef void (*ut_mdb_env_close_fn)(MDB_env* env);
 typedef int  (*ut_mdb_env_set_maxdbs_fn)(MDB_env* env, MDB_dbi dbs);
 typedef int  (*ut_mdb_env_open_fn)(MDB_env* env, const char* path, unsigned int flags, mdb_mode_t mode);
+typedef int  (*ut_mdb_env_set_maxreaders_fn)(MDB_env* env, unsigned int readers);
+typedef int  (*ut_mdb_env_sync_fn)(MDB_env* env, int force);
 typedef int  (*ut_mdb_dbi_open_fn)(MDB_txn* txn, const char* name, unsigned int flags, MDB_dbi* dbi);
 typedef int  (*ut_mdb_dbi_flags_fn)(MDB_txn* txn, MDB_dbi dbi, unsigned int* flags);
 typedef int  (*ut_mdb_txn_begin_fn)(MDB_env* env, MDB_txn* parent, unsigned int flags, MDB_txn** out);
 typedef int  (*ut_mdb_txn_commit_fn)(MDB_txn* txn);
 typedef int  (*ut_mdb_put_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data, unsigned int flags);
 typedef int  (*ut_mdb_get_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data);
+typedef int  (*ut_mdb_del_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_val* key, MDB_val* data);
+typedef int  (*ut_mdb_cursor_open_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_cursor** cursor);
+typedef int  (*ut_mdb_cursor_get_fn)(MDB_cursor* cursor, MDB_val* key, MDB_val* data, MDB_cursor_op op);
+typedef int  (*ut_mdb_cursor_del_fn)(MDB_cursor* cursor, unsigned int flags);
+typedef int  (*ut_mdb_cursor_put_fn)(MDB_cursor* cursor, MDB_val* key, MDB_val* data, unsigned int flags);
+typedef int  (*ut_mdb_set_cmp_fn)(MDB_txn* txn, MDB_dbi dbi, MDB_cmp_func* cmp);
+typedef int  (*ut_mdb_env_copyfd2_fn)(MDB_env* env, mdb_filehandle_t fd, unsigned int flags);
+typedef int  (*ut_mdb_reader_check_fn)(MDB_env* env, int* dead);
 
 extern ut_mdb_env_info_fn         g_ut_mdb_env_info;
+extern ut_mdb_env_stat_fn         g_ut_mdb_env_stat;
+extern ut_mdb_stat_fn             g_ut_mdb_stat;
 extern ut_mdb_env_set_mapsize_fn  g_ut_mdb_env_set_mapsize;
 extern ut_mdb_txn_abort_fn        g_ut_mdb_txn_abort;
+extern ut_mdb_txn_reset_fn        g_ut_mdb_txn_reset;
+extern ut_mdb_txn_renew_fn        g_ut_mdb_txn_renew;
 extern ut_mdb_env_create_fn       g_ut_mdb_env_create;
 extern ut_mdb_env_close_fn        g_ut_mdb_env_close;
 extern ut_mdb_env_set_maxdbs_fn   g_ut_mdb_env_set_maxdbs;
 extern ut_mdb_env_open_fn         g_ut_mdb_env_open;
+extern ut_mdb_env_set_maxreaders_fn g_ut_mdb_env_set_maxreaders;
+extern ut_mdb_env_sync_fn         g_ut_mdb_env_sync;
 extern ut_mdb_dbi_open_fn         g_ut_mdb_dbi_open;
 extern ut_mdb_dbi_flags_fn        g_ut_mdb_dbi_flags;
 extern ut_mdb_txn_begin_fn        g_ut_mdb_txn_begin;
 extern ut_mdb_txn_commit_fn       g_ut_mdb_txn_commit;
 extern ut_mdb_put_fn              g_ut_mdb_put;
 extern ut_mdb_get_fn              g_ut_mdb_get;
+extern ut_mdb_del_fn              g_ut_mdb_del;
+extern ut_mdb_cursor_open_fn      g_ut_mdb_cursor_open;
+extern ut_mdb_cursor_get_fn       g_ut_mdb_cursor_get;
+extern ut_mdb_cursor_del_fn       g_ut_mdb_cursor_del;
+extern ut_mdb_cursor_put_fn       g_ut_mdb_cursor_put;
+extern ut_mdb_set_cmp_fn          g_ut_mdb_set_compare;
+extern ut_mdb_set_cmp_fn          g_ut_mdb_set_dupsort;
+extern ut_mdb_env_copyfd2_fn      g_ut_mdb_env_copyfd2;
+extern ut_mdb_reader_check_fn     g_ut_mdb_reader_check;
 
 /* Reset all LMDB stub hooks back to their defaults. */
 void ut_reset_lmdb_stubs(void);
@@ -0,0 +1,483 @@
+/**
+ * @file bench_common.c
+ * @brief Shared benchmark harness, see bench_common.h.
+ */
+
+#include "bench_common.h"
+#include <dirent.h>
+#include <errno.h>
+#include <math.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/sysinfo.h>
+#include <sys/statvfs.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Environment profiles selectable by name */
+static const struct
+{
+    const char*      name;
+    db_env_profile_t profile;
+} g_profiles[] = {
+    { "durable", DB_ENV_PROFILE_DURABLE },
+    { "fast-async", DB_ENV_PROFILE_FAST_ASYNC },
+    { "read-mostly", DB_ENV_PROFILE_READ_MOSTLY },
+};
+const char*  g_profile_name = "durable";
+db_env_cfg_t g_env_cfg;
+
+int bench_set_profile(const char* name)
+{
+    for(size_t i = 0; i < sizeof(g_profiles) / sizeof(g_profiles[0]); ++i)
+    {
+        if(strcmp(name, g_profiles[i].name) == 0)
+        {
+            g_profile_name = g_profiles[i].name;
+            return db_core_env_profile(g_profiles[i].profile, &g_env_cfg);
+        }
+    }
+    return -EINVAL;
+}
+
+const char* bench_profile_path(const char* path, char* buf, size_t size)
+{
+    if(g_env_cfg.profile == DB_ENV_PROFILE_DURABLE) return path;
+
+    const char* ext = strrchr(path, '.');
+    int         len = ext ? (int)(ext - path) : (int)strlen(path);
+    (void)snprintf(buf, size, "%.*s_%s%s", len, path, g_profile_name, ext ? ext : "");
+    return buf;
+}
+
+void get_system_info(sys_info_t* info)
+{
+    FILE* fp;
+    char  buffer[256];
+
+    /* Hostname */
+    gethostname(info->hostname, sizeof(info->hostname));
+
+    /* CPU model */
+    fp = fopen("/proc/cpuinfo", "r");
+    if(fp)
+    {
+        while(fgets(buffer, sizeof(buffer), fp))
+        {
+            if(strncmp(buffer, "model name", 10) == 0)
+            {
+                char* colon = strchr(buffer, ':');
+                if(colon)
+                {
+                    colon += 2; /* Skip ": " */
+                    strncpy(info->cpu_model, colon, sizeof(info->cpu_model) - 1);
+                    info->cpu_model[strcspn(info->cpu_model, "\n")] = 0;
+                    break;
+                }
+            }
+        }
+        fclose(fp);
+    }
+
+    /* CPU cores */
+    info->cpu_cores = sysconf(_SC_NPROCESSORS_ONLN);
+
+    /* CPU frequency (from /proc/cpuinfo) */
+    fp = fopen("/proc/cpuinfo", "r");
+    if(fp)
+    {
+        while(fgets(buffer, sizeof(buffer), fp))
+        {
+            if(strncmp(buffer, "cpu MHz", 7) == 0)
+            {
+                char* colon = strchr(buffer, ':');
+                if(colon)
+                {
+                    info->cpu_freq_mhz = (long)atof(colon + 1);
+                    break;
+                }
+            }
+        }
+        fclose(fp);
+    }
+
+    /* Total RAM */
+    struct sysinfo si;
+    if(sysinfo(&si) == 0)
+    {
+        info->total_ram_mb = si.totalram / (1024 * 1024);
+    }
+
+    /* OS information */
+    fp = fopen("/etc/os-release", "r");
+    if(fp)
+    {
+        while(fgets(buffer, sizeof(buffer), fp))
+        {
+            if(strncmp(buffer, "PRETTY_NAME=", 12) == 0)
+            {
+                char* start = strchr(buffer, '"');
+                if(start)
+                {
+                    start++;
+                    char* end = strchr(start, '"');
+                    if(end)
+                    {
+                        size_t len = (size_t)(end - start);
+                        if(len < sizeof(info->os_info))
+                        {
+                            memcpy(info->os_info, start, len);
+                            info->os_info[len] = '\0';
+                        }
+                    }
+                }
+                break;
+            }
+        }
+        fclose(fp);
+    }
+
+    /* Storage type - detect SSD vs HDD */
+    /* Check if /tmp is on SSD by looking at rotational flag */
+    strcpy(info->storage_type, "Unknown");
+    fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep '/tmp' | awk '{print $2}'", "r");
+    if(fp)
+    {
+        if(fgets(buffer, sizeof(buffer), fp))
+        {
+            int rota = atoi(buffer);
+            strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
+        }
+        pclose(fp);
+    }
+
+    /* If /tmp not in lsblk output, check root */
+    if(strcmp(info->storage_type, "Unknown") == 0)
+    {
+        fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep ' /$' | awk '{print $2}'", "r");
+        if(fp)
+        {
+            if(fgets(buffer, sizeof(buffer), fp))
+            {
+                int rota = atoi(buffer);
+                strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
+            }
+            pclose(fp);
+        }
+    }
+
+    /* Filesystem type */
+    struct statvfs vfs;
+    if(statvfs("/tmp", &vfs) == 0)
+    {
+        fp = popen("df -T /tmp 2>/dev/null | tail -1 | awk '{print $2}'", "r");
+        if(fp)
+        {
+            if(fgets(buffer, sizeof(buffer), fp))
+            {
+                buffer[strcspn(buffer, "\n")] = 0;
+                strncpy(info->filesystem, buffer, sizeof(info->filesystem) - 1);
+            }
+            pclose(fp);
+        }
+    }
+}
+
+void bench_print_system_info(FILE* fp, const sys_info_t* info)
+{
+    fprintf(fp, "SYSTEM INFORMATION:\n");
+    fprintf(fp, "-------------------\n");
+    fprintf(fp, "Hostname:       %s\n", info->hostname);
+    fprintf(fp, "OS:             %s\n", info->os_info);
+    fprintf(fp, "CPU:            %s\n", info->cpu_model);
+    fprintf(fp, "CPU Cores:      %ld\n", info->cpu_cores);
+    fprintf(fp, "CPU Frequency:  %ld MHz\n", info->cpu_freq_mhz);
+    fprintf(fp, "Total RAM:      %lu MB\n", info->total_ram_mb);
+    fprintf(fp, "Storage Type:   %s\n", info->storage_type);
+    fprintf(fp, "Filesystem:     %s\n", info->filesystem);
+    fprintf(fp, "\n");
+}
+
+int remove_directory(const char* path)
+{
+    struct stat st;
+
+    if(stat(path, &st) != 0)
+    {
+        /* Treat non-existent path as success. */
+        return (errno == ENOENT) ? 0 : -1;
+    }
+
+    if(!S_ISDIR(st.st_mode))
+    {
+        return (unlink(path) == 0) ? 0 : -1;
+    }
+
+    DIR* dir = opendir(path);
+    if(!dir)
+    {
+        return -1;
+    }
+
+    struct dirent* ent;
+    int            rc = 0;
+
+    while((ent = readdir(dir)) != NULL)
+    {
+        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+
+        char child[PATH_MAX];
+        int  n = snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
+        if(n <= 0 || (size_t)n >= sizeof(child))
+        {
+            rc = -1;
+            continue;
+        }
+
+        struct stat child_st;
+        if(lstat(child, &child_st) != 0)
+        {
+            rc = -1;
+            continue;
+        }
+
+        if(S_ISDIR(child_st.st_mode))
+        {
+            if(remove_directory(child) != 0) rc = -1;
+        }
+        else
+        {
+            if(unlink(child) != 0) rc = -1;
+        }
+    }
+
+    closedir(dir);
+
+    if(rmdir(path) != 0) rc = -1;
+    return rc;
+}
+
+int bench_ensure_results_dir(void)
+{
+    struct stat st;
+    if(stat(BENCH_RESULTS_DIR, &st) != 0)
+    {
+        if(errno != ENOENT || mkdir(BENCH_RESULTS_DIR, 0755) != 0)
+        {
+            perror("mkdir " BENCH_RESULTS_DIR);
+            return -1;
+        }
+    }
+    else if(!S_ISDIR(st.st_mode))
+    {
+        fprintf(stderr, "ERROR: " BENCH_RESULTS_DIR " exists and is not a directory\n");
+        return -1;
+    }
+    return 0;
+}
+
+double get_time_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
+}
+
+int compare_double(const void* a, const void* b)
+{
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+double percentile(const double* sorted, size_t n, double q)
+{
+    if(n == 0) return 0.0;
+
+    double pos  = q * (double)n;
+    size_t rank = (size_t)pos;
+    if((double)rank < pos) rank++;
+    if(rank < 1) rank = 1;
+    if(rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+void calculate_stats(double* samples, size_t n, stats_t* out)
+{
+    double sum    = 0.0;
+    double sum_sq = 0.0;
+
+    memset(out, 0, sizeof(*out));
+    if(n == 0) return;
+
+    /* Sort samples for median and min/max */
+    qsort(samples, n, sizeof(double), compare_double);
+
+    /* Calculate mean */
+    for(size_t i = 0; i < n; i++)
+    {
+        sum += samples[i];
+    }
+    out->mean = sum / (double)n;
+
+    /* Calculate standard deviation */
+    for(size_t i = 0; i < n; i++)
+    {
+        double diff = samples[i] - out->mean;
+        sum_sq += diff * diff;
+    }
+    out->std_dev = sqrt(sum_sq / (double)n);
+
+    /* Min, max, median, tail */
+    out->min    = samples[0];
+    out->max    = samples[n - 1];
+    out->median = (n % 2 == 0) ? (samples[n / 2 - 1] + samples[n / 2]) / 2.0 : samples[n / 2];
+    out->p99    = percentile(samples, n, 0.99);
+    out->p999   = percentile(samples, n, 0.999);
+}
+
+int bench_samples_init(bench_samples_t* s, size_t cap, unsigned int seed)
+{
+    memset(s, 0, sizeof(*s));
+    s->v = malloc((cap ? cap : 1) * sizeof(double));
+    if(!s->v) return -ENOMEM;
+    s->cap  = cap ? cap : 1;
+    s->seed = seed;
+    return 0;
+}
+
+void bench_samples_add(bench_samples_t* s, double v)
+{
+    s->seen++;
+    if(s->n < s->cap)
+    {
+        s->v[s->n++] = v;
+        return;
+    }
+
+    /* Full: replace a random slot with probability cap / seen */
+    size_t r = (((size_t)rand_r(&s->seed) << 16) ^ (size_t)rand_r(&s->seed)) % s->seen;
+    if(r < s->cap) s->v[r] = v;
+}
+
+void bench_samples_free(bench_samples_t* s)
+{
+    free(s->v);
+    memset(s, 0, sizeof(*s));
+}
+
+int bench_parse_list(const char* str, size_t* out, int max, int binary)
+{
+    const unsigned long long unit = binary ? 1024u : 1000u;
+    int                      n    = 0;
+
+    while(*str)
+    {
+        char*              end = NULL;
+        unsigned long long v   = strtoull(str, &end, 10);
+        if(end == str || n >= max) return -1;
+
+        switch(*end)
+        {
+            case 'K':
+            case 'k':
+                v *= unit;
+                end++;
+                break;
+            case 'M':
+            case 'm':
+                v *= unit * unit;
+                end++;
+                break;
+            case 'G':
+            case 'g':
+                v *= unit * unit * unit;
+                end++;
+                break;
+            default:
+                break;
+        }
+        if(*end != ',' && *end != '\0') return -1;
+
+        out[n++] = (size_t)v;
+        str      = (*end == ',') ? end + 1 : end;
+    }
+    return n;
+}
+
+/**
+ * @brief Write @p s as a JSON string (quotes and backslashes escaped,
+ *        control characters dropped).
+ */
+static void json_string(FILE* fp, const char* s)
+{
+    fputc('"', fp);
+    for(; s && *s; s++)
+    {
+        if(*s == '"' || *s == '\\') fputc('\\', fp);
+        if((unsigned char)*s >= 0x20) fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
+
+int bench_json_open(bench_json_t* j, const char* path, const char* bench,
+                    const sys_info_t* info)
+{
+    j->n_results = 0;
+    j->fp        = fopen(path, "w");
+    if(!j->fp)
+    {
+        fprintf(stderr, "ERROR: Failed to open output file %s\n", path);
+        return -errno;
+    }
+
+    fprintf(j->fp, "{\n  \"bench\": ");
+    json_string(j->fp, bench);
+    fprintf(j->fp, ",\n  \"profile\": ");
+    json_string(j->fp, g_profile_name);
+    fprintf(j->fp, ",\n  \"system\": {\"hostname\": ");
+    json_string(j->fp, info->hostname);
+    fprintf(j->fp, ", \"os\": ");
+    json_string(j->fp, info->os_info);
+    fprintf(j->fp, ", \"cpu\": ");
+    json_string(j->fp, info->cpu_model);
+    fprintf(j->fp, ", \"cores\": %ld, \"cpu_mhz\": %ld, \"ram_mb\": %lu, \"storage\": ",
+            info->cpu_cores, info->cpu_freq_mhz, info->total_ram_mb);
+    json_string(j->fp, info->storage_type);
+    fprintf(j->fp, ", \"filesystem\": ");
+    json_string(j->fp, info->filesystem);
+    fprintf(j->fp, "},\n  \"results\": [");
+    return 0;
+}
+
+void bench_json_result(bench_json_t* j, const bench_result_t* r)
+{
+    if(!j->fp) return;
+
+    fprintf(j->fp, "%s\n    {\"name\": ", j->n_results++ ? "," : "");
+    json_string(j->fp, r->name);
+    fprintf(j->fp, ", \"access\": ");
+    json_string(j->fp, r->access);
+    fprintf(j->fp,
+            ", \"keys\": %zu, \"value_size\": %zu, \"batch\": %zu, \"ops\": %zu, "
+            "\"ops_per_s\": %.1f,\n     \"lat_us\": {\"mean\": %.3f, \"std_dev\": %.3f, "
+            "\"min\": %.3f, \"p50\": %.3f, \"p99\": %.3f, \"p999\": %.3f, \"max\": %.3f}}",
+            r->keys, r->value_size, r->batch, r->ops, r->ops_per_s, r->lat_us.mean,
+            r->lat_us.std_dev, r->lat_us.min, r->lat_us.median, r->lat_us.p99, r->lat_us.p999,
+            r->lat_us.max);
+}
+
+int bench_json_close(bench_json_t* j)
+{
+    if(!j->fp) return -EINVAL;
+
+    fprintf(j->fp, "\n  ]\n}\n");
+    int rc = ferror(j->fp) ? -EIO : 0;
+    if(fclose(j->fp) != 0 && rc == 0) rc = -errno;
+    j->fp = NULL;
+    return rc;
+}
@@ -0,0 +1,177 @@
+/**
+ * @file bench_common.h
+ * @brief Shared benchmark harness: system info, timing, statistics,
+ *        environment profiles, CLI lists and JSON results.
+ */
+
+#ifndef BENCH_COMMON_H_
+#define BENCH_COMMON_H_
+
+#include <stddef.h>
+#include <stdio.h>
+
+#include "core.h"
+
+/* Directory every benchmark writes its results into (relative to the repo root) */
+#define BENCH_RESULTS_DIR "tests/benchmarks/results"
+
+/* System information structure */
+typedef struct
+{
+    char           hostname[256];
+    char           cpu_model[256];
+    char           os_info[256];
+    long           cpu_cores;
+    long           cpu_freq_mhz;
+    unsigned long  total_ram_mb;
+    char           storage_type[64]; /* SSD or HDD */
+    char           filesystem[64];
+} sys_info_t;
+
+/* Statistics structure */
+typedef struct
+{
+    double mean;
+    double std_dev;
+    double min;
+    double max;
+    double median;
+    double p99;
+    double p999;
+} stats_t;
+
+/**
+ * @brief Bounded sample set: keeps every sample up to its capacity, then a
+ *        uniform random subset of them (reservoir sampling).
+ */
+typedef struct
+{
+    double*      v;
+    size_t       n;    /* samples kept */
+    size_t       cap;  /* samples that fit */
+    size_t       seen; /* samples offered */
+    unsigned int seed;
+} bench_samples_t;
+
+/**
+ * @brief One measured case of a JSON result file.
+ */
+typedef struct
+{
+    const char* name;       /* case label, e.g. "put" or "get" */
+    const char* access;     /* "seq" or "rand" */
+    size_t      keys;       /* keys stored */
+    size_t      value_size; /* bytes per value */
+    size_t      batch;      /* ops per exec */
+    size_t      ops;        /* ops measured over all runs */
+    double      ops_per_s;  /* mean over the runs */
+    stats_t     lat_us;     /* latency of one exec (batch ops), μs */
+} bench_result_t;
+
+/**
+ * @brief JSON result file being written.
+ */
+typedef struct
+{
+    FILE* fp;
+    int   n_results;
+} bench_json_t;
+
+/* Environment profile of every run, see bench_set_profile() ("durable" by default) */
+extern const char*  g_profile_name;
+extern db_env_cfg_t g_env_cfg;
+
+/**
+ * @brief Select the environment profile by name.
+ */
+int bench_set_profile(const char* name);
+
+/**
+ * @brief Results file of the selected profile: "x.txt" -> "x_<profile>.txt"
+ *        unless durable, so earlier results stay comparable.
+ */
+const char* bench_profile_path(const char* path, char* buf, size_t size);
+
+/**
+ * @brief Get system information
+ */
+void get_system_info(sys_info_t* info);
+
+/**
+ * @brief Print the system information block of the console report.
+ */
+void bench_print_system_info(FILE* fp, const sys_info_t* info);
+
+/**
+ * @brief Recursively remove a directory tree (best-effort `rm -rf path`).
+ */
+int remove_directory(const char* path);
+
+/**
+ * @brief Create BENCH_RESULTS_DIR if missing.
+ *
+ * @return 0 on success, -1 when it cannot be created or is not a directory.
+ */
+int bench_ensure_results_dir(void);
+
+/**
+ * @brief Get current time in microseconds
+ */
+double get_time_us(void);
+
+/**
+ * @brief Compare function for qsort (doubles)
+ */
+int compare_double(const void* a, const void* b);
+
+/**
+ * @brief Sample at quantile @p q of @p n sorted samples (nearest rank).
+ */
+double percentile(const double* sorted, size_t n, double q);
+
+/**
+ * @brief Calculate statistics from an array of samples (sorted in place).
+ */
+void calculate_stats(double* samples, size_t n, stats_t* out);
+
+/**
+ * @brief Allocate room for @p cap samples.
+ */
+int bench_samples_init(bench_samples_t* s, size_t cap, unsigned int seed);
+
+/**
+ * @brief Offer one sample, kept with probability cap / seen once full.
+ */
+void bench_samples_add(bench_samples_t* s, double v);
+
+void bench_samples_free(bench_samples_t* s);
+
+/**
+ * @brief Parse a comma separated list of sizes into @p out.
+ *
+ * Each item is a number with an optional suffix: K, M, G multiply by
+ * 1000 (counts) or 1024 (@p binary, byte sizes).
+ *
+ * @return Items parsed, -1 on a malformed list or more than @p max items.
+ */
+int bench_parse_list(const char* str, size_t* out, int max, int binary);
+
+/**
+ * @brief Start a JSON result file: benchmark name, profile and system info.
+ */
+int bench_json_open(bench_json_t* j, const char* path, const char* bench,
+                    const sys_info_t* info);
+
+/**
+ * @brief Append one case to the "results" array.
+ */
+void bench_json_result(bench_json_t* j, const bench_result_t* r);
+
+/**
+ * @brief Close the array and the file.
+ *
+ * @return 0 on success, -errno when the file could not be written.
+ */
+int bench_json_close(bench_json_t* j);
+
+#endif /* BENCH_COMMON_H_ */
@@ -0,0 +1,398 @@
+/**
+ * @file bench_db_bulk_load.c
+ * @brief Benchmark for the bulk loader (db_core_bulk_*).
+ *
+ * This benchmark measures the ingest rate of the bulk loader into a single
+ * sub-DBI, for 1M and 10M records of 16 byte keys and 16 byte values:
+ *
+ *   - sorted input:   keys arrive in ascending order, so every chunk is
+ *                     written with MDB_APPEND
+ *   - shuffled input: the same keys in a random permutation, so every
+ *                     chunk is key-sorted by the loader before its commit
+ *
+ * The loader commits every DB_LMDB_BULK_COMMIT_RECORDS records (or
+ * DB_LMDB_BULK_COMMIT_BYTES bytes) and grows the map ahead of each commit.
+ * The database environment and DBI are created BEFORE timing starts; the
+ * permutation is generated before timing too, key formatting is timed.
+ * Timing covers db_core_bulk_begin .. db_core_bulk_end.
+ *
+ * Each run starts from a completely clean database directory so that the
+ * measured time reflects only the ingest workload, not prior state.
+ */
+
+#include "bench_common.h"
+#include "core.h"
+#include "config.h" /* DB_LMDB_BULK_COMMIT_RECORDS, DB_LMDB_BULK_COMMIT_BYTES */
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Benchmark configuration */
+#define BENCH_DB_PATH    "/tmp/bench_lmdb_bulk"
+#define BENCH_DB_MODE    0700
+#define BENCH_KEY_SIZE   16
+#define BENCH_VALUE_SIZE 16
+#define BENCH_RUNS       3
+
+/* Record counts swept, each with sorted then shuffled input */
+static const size_t g_record_counts[] = { 1000000u, 10000000u };
+#define BENCH_N_COUNTS (sizeof(g_record_counts) / sizeof(g_record_counts[0]))
+
+/**
+ * @brief Format the 16 byte key of record @p idx (zero padded, so that
+ * the byte order matches the numeric order).
+ */
+static void make_key(size_t idx, char* out)
+{
+    char tmp[BENCH_KEY_SIZE + 1];
+    (void)snprintf(tmp, sizeof(tmp), "k%015zu", idx);
+    memcpy(out, tmp, BENCH_KEY_SIZE);
+}
+
+/**
+ * @brief Fill @p order with a random permutation of 0 .. n-1 (xorshift64,
+ * fixed seed so that every run loads the same sequence).
+ */
+static void make_permutation(uint32_t* order, size_t n)
+{
+    uint64_t x = 0x9E3779B97F4A7C15ull;
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        order[i] = (uint32_t)i;
+    }
+
+    for(size_t i = n - 1; i > 0; --i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        size_t   j = (size_t)(x % (i + 1));
+        uint32_t t = order[i];
+        order[i]   = order[j];
+        order[j]   = t;
+    }
+}
+
+/**
+ * @brief Run one bulk load of @p n records.
+ *
+ * The run:
+ *   - starts from a clean directory
+ *   - creates the environment + single DBI
+ *   - measures ONLY db_core_bulk_begin .. db_core_bulk_end
+ *   - shuts down the database (not timed)
+ *
+ * @param order NULL for sorted input, else the permutation to load in.
+ */
+static int run_single_load(size_t n, const uint32_t* order, double* out_total_us,
+                           db_bulk_stats_t* out_stats)
+{
+    static const char*      dbi_names[] = { "bench_bulk" };
+    static const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    /* Clean up any previous database state (not timed). */
+    if(remove_directory(BENCH_DB_PATH) != 0)
+    {
+        fprintf(stderr, "WARNING: Failed to remove directory %s\n", BENCH_DB_PATH);
+    }
+
+    /* Create database environment + single DBI (not timed). */
+    int rc = db_core_init(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u);
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_init failed with rc=%d\n", rc);
+        return rc;
+    }
+
+    char key[BENCH_KEY_SIZE];
+    char value[BENCH_VALUE_SIZE];
+    memset(value, 'v', sizeof(value));
+
+    double start_us = get_time_us();
+
+    db_bulk_t* bulk = NULL;
+    rc              = db_core_bulk_begin(&bulk, NULL);
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_bulk_begin failed with rc=%d\n", rc);
+        (void)db_core_shutdown();
+        return rc;
+    }
+
+    for(size_t i = 0; i < n; ++i)
+    {
+        size_t idx = order ? (size_t)order[i] : i;
+        make_key(idx, key);
+        memcpy(value, &idx, sizeof(idx));
+
+        rc = db_core_bulk_put(bulk, 0u, key, sizeof(key), value, sizeof(value));
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: db_core_bulk_put failed (record=%zu, rc=%d)\n", i, rc);
+            (void)db_core_bulk_end(bulk, NULL);
+            (void)db_core_shutdown();
+            return rc;
+        }
+    }
+
+    rc = db_core_bulk_end(bulk, out_stats);
+
+    double end_us = get_time_us();
+
+    /* Shutdown database (not timed). */
+    (void)db_core_shutdown();
+
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_bulk_end failed with rc=%d\n", rc);
+        return rc;
+    }
+
+    *out_total_us = end_us - start_us;
+    return 0;
+}
+
+/**
+ * @brief Run the full benchmark for @p n records, sorted or shuffled.
+ *
+ * When @p out_mean_rate is not NULL it receives the mean records/s.
+ */
+static int run_load_benchmark(const char*     label,
+                              size_t          n,
+                              const uint32_t* order,
+                              const char*     output_file,
+                              double*         out_mean_rate)
+{
+    sys_info_t sys_info = {0};
+    get_system_info(&sys_info);
+
+    double*         rates = malloc(BENCH_RUNS * sizeof(double));
+    double*         times = malloc(BENCH_RUNS * sizeof(double));
+    db_bulk_stats_t last  = {0};
+    if(!rates || !times)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate memory for results\n");
+        free(rates);
+        free(times);
+        return -ENOMEM;
+    }
+
+    printf("=================================================================\n");
+    printf("Database Bulk Load Benchmark (%s)\n", label);
+    printf("=================================================================\n\n");
+
+    printf("SYSTEM INFORMATION:\n");
+    printf("-------------------\n");
+    printf("Hostname:       %s\n", sys_info.hostname);
+    printf("OS:             %s\n", sys_info.os_info);
+    printf("CPU:            %s\n", sys_info.cpu_model);
+    printf("CPU Cores:      %ld\n", sys_info.cpu_cores);
+    printf("CPU Frequency:  %ld MHz\n", sys_info.cpu_freq_mhz);
+    printf("Total RAM:      %lu MB\n", sys_info.total_ram_mb);
+    printf("Storage Type:   %s\n", sys_info.storage_type);
+    printf("Filesystem:     %s\n", sys_info.filesystem);
+    printf("\n");
+
+    printf("BENCHMARK CONFIGURATION:\n");
+    printf("------------------------\n");
+    printf("Test Type:      Bulk load into single DBI (%s input)\n", order ? "shuffled" : "sorted");
+    printf("Measured:       db_core_bulk_begin .. db_core_bulk_end\n");
+    printf("NOT Measured:   Environment/DBI init, shutdown, directory cleanup\n");
+    printf("Records:        %zu\n", n);
+    printf("Key/Value size: %d / %d bytes\n", BENCH_KEY_SIZE, BENCH_VALUE_SIZE);
+    printf("Commit every:   %u records or %llu bytes\n", (unsigned)DB_LMDB_BULK_COMMIT_RECORDS,
+           (unsigned long long)DB_LMDB_BULK_COMMIT_BYTES);
+    printf("Runs:           %d\n", BENCH_RUNS);
+    printf("DB Path:        %s\n", BENCH_DB_PATH);
+    printf("=================================================================\n\n");
+
+    printf("Running benchmark...\n");
+
+    for(int run = 0; run < BENCH_RUNS; ++run)
+    {
+        double total_us = 0.0;
+        int    rc       = run_single_load(n, order, &total_us, &last);
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: Benchmark run %d failed with rc=%d\n", run + 1, rc);
+            free(rates);
+            free(times);
+            return rc;
+        }
+        times[run] = total_us;
+        rates[run] = (double)n / (total_us / 1000000.0);
+
+        printf("  Run %2d/%d: total = %.2f ms, %.0f records/s, %zu commits, %zu map grows\n",
+               run + 1, BENCH_RUNS, total_us / 1000.0, rates[run], last.commits,
+               last.map_grows);
+    }
+
+    printf("\nBenchmark completed!\n\n");
+
+    /* Compute statistics on the per-run rates. */
+    stats_t stats;
+    double* sorted = malloc(BENCH_RUNS * sizeof(double));
+    if(!sorted)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate memory for statistics\n");
+        free(rates);
+        free(times);
+        return -ENOMEM;
+    }
+    memcpy(sorted, rates, BENCH_RUNS * sizeof(double));
+    calculate_stats(sorted, BENCH_RUNS, &stats);
+    free(sorted);
+
+    printf("=================================================================\n");
+    printf("BULK LOAD RESULTS (%s)\n", label);
+    printf("=================================================================\n");
+    printf("Total runs:     %d\n", BENCH_RUNS);
+    printf("Records:        %zu\n", n);
+    printf("\nRecords per second:\n");
+    printf("  Mean:         %.0f\n", stats.mean);
+    printf("  Std Dev:      %.0f\n", stats.std_dev);
+    printf("  Median:       %.0f\n", stats.median);
+    printf("  Min:          %.0f\n", stats.min);
+    printf("  Max:          %.0f\n", stats.max);
+    printf("\nLoader (last run): %zu commits, %zu map grows, %.2f MiB/s payload\n",
+           last.commits, last.map_grows, last.mib_per_s);
+    printf("=================================================================\n\n");
+
+    /* Write detailed results to file. */
+    FILE* fp = fopen(output_file, "w");
+    if(!fp)
+    {
+        fprintf(stderr, "ERROR: Failed to open output file %s\n", output_file);
+        free(rates);
+        free(times);
+        return -errno;
+    }
+
+    fprintf(fp, "╔════════════════════════════════════════════════════════════════╗\n");
+    fprintf(fp, "║        Database Bulk Load Benchmark (%-26s)        ║\n", label);
+    fprintf(fp, "╚════════════════════════════════════════════════════════════════╝\n\n");
+
+    fprintf(fp, "SYSTEM INFORMATION\n");
+    fprintf(fp, "-------------------\n");
+    fprintf(fp, "Hostname:          %s\n", sys_info.hostname);
+    fprintf(fp, "Operating System:  %s\n", sys_info.os_info);
+    fprintf(fp, "CPU Model:         %s\n", sys_info.cpu_model);
+    fprintf(fp, "CPU Cores:         %ld\n", sys_info.cpu_cores);
+    fprintf(fp, "CPU Frequency:     %ld MHz\n", sys_info.cpu_freq_mhz);
+    fprintf(fp, "Total RAM:         %lu MB\n", sys_info.total_ram_mb);
+    fprintf(fp, "Storage Type:      %s\n", sys_info.storage_type);
+    fprintf(fp, "Filesystem:        %s\n", sys_info.filesystem);
+
+    fprintf(fp, "\nBENCHMARK CONFIGURATION\n");
+    fprintf(fp, "------------------------\n");
+    fprintf(fp, "Test Type:         Bulk load into single DBI (%s input)\n",
+            order ? "shuffled" : "sorted");
+    fprintf(fp, "What is Measured:  db_core_bulk_begin .. db_core_bulk_end\n");
+    fprintf(fp, "NOT Measured:      Environment/DBI init, shutdown, directory cleanup\n");
+    fprintf(fp, "Records:           %zu\n", n);
+    fprintf(fp, "Key/Value size:    %d / %d bytes\n", BENCH_KEY_SIZE, BENCH_VALUE_SIZE);
+    fprintf(fp, "Commit every:      %u records or %llu bytes\n",
+            (unsigned)DB_LMDB_BULK_COMMIT_RECORDS, (unsigned long long)DB_LMDB_BULK_COMMIT_BYTES);
+    fprintf(fp, "Runs:              %d\n", BENCH_RUNS);
+    fprintf(fp, "DB Path:           %s\n", BENCH_DB_PATH);
+    fprintf(fp, "DB Mode:           0%o\n", BENCH_DB_MODE);
+
+    fprintf(fp, "\nRESULTS - Records per second\n");
+    fprintf(fp, "----------------------------\n");
+    fprintf(fp, "Mean:              %12.0f\n", stats.mean);
+    fprintf(fp, "Std Dev:           %12.0f\n", stats.std_dev);
+    fprintf(fp, "Median:            %12.0f\n", stats.median);
+    fprintf(fp, "Min:               %12.0f\n", stats.min);
+    fprintf(fp, "Max:               %12.0f\n", stats.max);
+
+    fprintf(fp, "\nLOADER COUNTERS (last run)\n");
+    fprintf(fp, "--------------------------\n");
+    fprintf(fp, "Commits:           %zu\n", last.commits);
+    fprintf(fp, "Map grows:         %zu\n", last.map_grows);
+    fprintf(fp, "Payload rate:      %.2f MiB/s\n", last.mib_per_s);
+
+    fprintf(fp, "\nDETAILED TIMING DATA (all %d runs)\n", BENCH_RUNS);
+    fprintf(fp, "----------------------------------\n");
+    for(int i = 0; i < BENCH_RUNS; ++i)
+    {
+        fprintf(fp, "Run %4d: %12.2f ms  [%.0f records/s]\n", i + 1, times[i] / 1000.0,
+                rates[i]);
+    }
+
+    fclose(fp);
+    free(rates);
+    free(times);
+
+    if(out_mean_rate) *out_mean_rate = stats.mean;
+
+    printf("Detailed results written to: %s\n\n", output_file);
+    return 0;
+}
+
+int main(void)
+{
+    /* Ensure results directory exists. */
+    if(bench_ensure_results_dir() != 0) return 1;
+
+    int    n_failed = 0;
+    double mean_rate[BENCH_N_COUNTS][2];
+
+    for(size_t i = 0; i < BENCH_N_COUNTS; ++i)
+    {
+        const size_t n     = g_record_counts[i];
+        uint32_t*    order = malloc(n * sizeof(uint32_t));
+        if(!order)
+        {
+            fprintf(stderr, "ERROR: Failed to allocate the permutation of %zu records\n", n);
+            return 1;
+        }
+        make_permutation(order, n);
+
+        for(int shuffled = 0; shuffled < 2; ++shuffled)
+        {
+            char label[64];
+            char output_file[128];
+            (void)snprintf(label, sizeof(label), "%zuM records, %s", n / 1000000u,
+                           shuffled ? "shuffled" : "sorted");
+            (void)snprintf(output_file, sizeof(output_file),
+                           "tests/benchmarks/results/bench_bulk_load_%zuM_%s.txt", n / 1000000u,
+                           shuffled ? "shuffled" : "sorted");
+
+            int rc = run_load_benchmark(label, n, shuffled ? order : NULL, output_file,
+                                        &mean_rate[i][shuffled]);
+            if(rc != 0)
+            {
+                fprintf(stderr, "Bulk load benchmark (%s) failed with rc=%d\n", label, rc);
+                mean_rate[i][shuffled] = 0.0;
+                n_failed++;
+            }
+        }
+
+        free(order);
+    }
+
+    (void)remove_directory(BENCH_DB_PATH);
+
+    /* Short summary: mean records/s for each pattern. */
+    printf("=================================================================\n");
+    printf("BULK LOAD SUMMARY (mean records/s)\n");
+    printf("=================================================================\n");
+    for(size_t i = 0; i < BENCH_N_COUNTS; ++i)
+    {
+        printf("  %3zuM records: sorted %12.0f   shuffled %12.0f\n",
+               g_record_counts[i] / 1000000u, mean_rate[i][0], mean_rate[i][1]);
+    }
+    printf("=================================================================\n\n");
+
+    if(n_failed == 0)
+    {
+        printf("All bulk load benchmarks completed successfully!\n");
+        return 0;
+    }
+
+    fprintf(stderr, "%d bulk load benchmark(s) failed\n", n_failed);
+    return 1;
+}
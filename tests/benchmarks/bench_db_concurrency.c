@@ -0,0 +1,475 @@
+/**
+ * @file bench_db_concurrency.c
+ * @brief Benchmark for concurrent readers and writers on one environment.
+ *
+ * The database is populated once with BENCH_NUM_KEYS keys (NOT TIMED), then
+ * the thread count is swept from 1 to the number of online cores. Each step
+ * starts T reader threads against M writer threads (argv[2], default 1):
+ *
+ *   - every reader runs BENCH_READS_PER_THREAD single GETs of random keys,
+ *     each one batch on its own db_batch_t, so the per-thread parked read
+ *     txn is reused between GETs
+ *   - every writer overwrites random keys, one PUT per batch (one commit
+ *     each), until the last reader is done
+ *
+ * Every op is timed on its own; the step reports the throughput of readers
+ * and writers and the p50 / p99 / p999 latency over all their ops.
+ * Environment init, population and shutdown are not timed.
+ */
+
+#include "bench_common.h"
+#include "core.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Benchmark configuration */
+#define BENCH_DB_PATH          "/tmp/bench_lmdb_concurrency"
+#define BENCH_DB_MODE          0700
+#define BENCH_NUM_KEYS         10000
+#define BENCH_VALUE_SIZE       1024
+#define BENCH_READS_PER_THREAD 20000
+#define BENCH_WRITES_MAX       100000 /* samples kept per writer */
+#define BENCH_POPULATE_BATCH   64
+#define BENCH_MAX_WRITERS      64
+#define BENCH_MAX_STEPS        16
+
+/* Latency distribution of one side (readers or writers) of a step */
+typedef struct
+{
+    size_t ops;
+    double elapsed_us; /* first start to last stop of that side */
+    double ops_per_s;
+    double p50;
+    double p99;
+    double p999;
+    double max;
+} lat_stats_t;
+
+/* Result of one thread-count step */
+typedef struct
+{
+    int         readers;
+    int         writers;
+    lat_stats_t rd;
+    lat_stats_t wr;
+} step_result_t;
+
+/* One benchmark thread: its samples in microseconds */
+typedef struct
+{
+    pthread_t    tid;
+    int          writer;
+    unsigned int seed;
+    double*      samples;
+    size_t       cap;
+    size_t       n;
+    double       start_us;
+    double       stop_us;
+    int          rc;
+} bench_thread_t;
+
+/* Pre-generated test data */
+static char g_keys[BENCH_NUM_KEYS][32];
+static char g_value[BENCH_VALUE_SIZE];
+
+/* Raised once every reader is done, writers stop on it */
+static atomic_int g_stop;
+/* All threads of a step start together */
+static pthread_barrier_t g_start;
+
+/**
+ * @brief Merge the samples of one side of a step and compute its stats.
+ */
+static int calculate_lat_stats(const bench_thread_t* th, int n_th, int writer, lat_stats_t* out)
+{
+    size_t total = 0;
+    double start = 0.0;
+    double stop  = 0.0;
+    for(int i = 0; i < n_th; ++i)
+    {
+        if(th[i].writer != writer) continue;
+        if(total == 0 || th[i].start_us < start) start = th[i].start_us;
+        if(th[i].stop_us > stop) stop = th[i].stop_us;
+        total += th[i].n;
+    }
+
+    memset(out, 0, sizeof(*out));
+    if(total == 0) return 0;
+
+    double* all = malloc(total * sizeof(double));
+    if(!all) return -ENOMEM;
+
+    size_t off = 0;
+    for(int i = 0; i < n_th; ++i)
+    {
+        if(th[i].writer != writer) continue;
+        memcpy(all + off, th[i].samples, th[i].n * sizeof(double));
+        off += th[i].n;
+    }
+    qsort(all, total, sizeof(double), compare_double);
+
+    out->ops        = total;
+    out->elapsed_us = stop - start;
+    out->ops_per_s  = out->elapsed_us > 0.0 ? (double)total * 1000000.0 / out->elapsed_us : 0.0;
+    out->p50        = percentile(all, total, 0.50);
+    out->p99        = percentile(all, total, 0.99);
+    out->p999       = percentile(all, total, 0.999);
+    out->max        = all[total - 1];
+
+    free(all);
+    return 0;
+}
+
+/**
+ * @brief Initialize synthetic keys and value buffer.
+ */
+static void init_test_data(void)
+{
+    for(int i = 0; i < BENCH_NUM_KEYS; ++i)
+    {
+        snprintf(g_keys[i], sizeof(g_keys[i]), "key_%05d", i);
+    }
+
+    /* Fill value buffer with a deterministic pattern. */
+    for(int i = 0; i < BENCH_VALUE_SIZE; ++i)
+    {
+        g_value[i] = (char)('A' + (i % 26));
+    }
+}
+
+/**
+ * @brief Populate the DB with BENCH_NUM_KEYS entries (not timed).
+ */
+static int populate_db(void)
+{
+    int rc;
+    int pending = 0;
+
+    for(int i = 0; i < BENCH_NUM_KEYS; ++i)
+    {
+        rc = db_core_add_op(0u, DB_OPERATION_PUT, (const void*)g_keys[i], strlen(g_keys[i]),
+                            (const void*)g_value, BENCH_VALUE_SIZE);
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: populate_db: db_core_add_op failed (key=%d, rc=%d)\n", i, rc);
+            return rc;
+        }
+
+        if(++pending == BENCH_POPULATE_BATCH || i == BENCH_NUM_KEYS - 1)
+        {
+            rc = db_core_exec_ops();
+            if(rc != 0)
+            {
+                fprintf(stderr, "ERROR: populate_db: db_core_exec_ops failed (rc=%d)\n", rc);
+                return rc;
+            }
+            pending = 0;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Thread body: timed single-op batches on a private batch handle.
+ */
+static void* bench_thread(void* arg)
+{
+    bench_thread_t* th    = arg;
+    db_batch_t*     batch = NULL;
+    char            val_buf[BENCH_VALUE_SIZE];
+
+    th->rc = db_core_batch_create(&batch);
+    pthread_barrier_wait(&g_start);
+    if(th->rc != 0) return NULL;
+
+    th->start_us = get_time_us();
+    while(th->n < th->cap)
+    {
+        /* Writers run until the readers are done */
+        if(th->writer && atomic_load_explicit(&g_stop, memory_order_relaxed)) break;
+
+        int    idx = rand_r(&th->seed) % BENCH_NUM_KEYS;
+        double t0  = get_time_us();
+        if(th->writer)
+        {
+            th->rc = db_core_batch_add_op(batch, 0u, DB_OPERATION_PUT, (const void*)g_keys[idx],
+                                          strlen(g_keys[idx]), (const void*)g_value,
+                                          BENCH_VALUE_SIZE);
+        }
+        else
+        {
+            th->rc = db_core_batch_add_op(batch, 0u, DB_OPERATION_GET, (const void*)g_keys[idx],
+                                          strlen(g_keys[idx]), val_buf, sizeof(val_buf));
+        }
+        if(th->rc == 0) th->rc = db_core_batch_exec(batch);
+        if(th->rc != 0)
+        {
+            fprintf(stderr, "ERROR: bench_thread: %s failed (key=%d, rc=%d)\n",
+                    th->writer ? "PUT" : "GET", idx, th->rc);
+            break;
+        }
+        th->samples[th->n++] = get_time_us() - t0;
+    }
+    th->stop_us = get_time_us();
+
+    db_core_batch_destroy(batch);
+    return NULL;
+}
+
+/**
+ * @brief Run one step: @p readers reader threads against @p writers writers.
+ */
+static int run_step(int readers, int writers, step_result_t* out)
+{
+    const int       n_th = readers + writers;
+    bench_thread_t* th   = calloc((size_t)n_th, sizeof(*th));
+    if(!th) return -ENOMEM;
+
+    int rc = 0;
+    for(int i = 0; i < n_th; ++i)
+    {
+        th[i].writer  = (i >= readers);
+        th[i].seed    = 1234u + (unsigned int)i;
+        th[i].cap     = th[i].writer ? BENCH_WRITES_MAX : BENCH_READS_PER_THREAD;
+        th[i].samples = malloc(th[i].cap * sizeof(double));
+        if(!th[i].samples) rc = -ENOMEM;
+    }
+
+    int started = 0;
+    if(rc == 0)
+    {
+        atomic_store(&g_stop, 0);
+        pthread_barrier_init(&g_start, NULL, (unsigned)n_th);
+        for(; started < n_th; ++started)
+        {
+            if(pthread_create(&th[started].tid, NULL, bench_thread, &th[started]) != 0) break;
+        }
+        if(started < n_th)
+        {
+            /* Cannot release a partial barrier: the step is lost */
+            fprintf(stderr, "ERROR: run_step: pthread_create failed after %d threads\n", started);
+            exit(1);
+        }
+
+        /* Readers first, then stop the writers */
+        for(int i = 0; i < readers; ++i) pthread_join(th[i].tid, NULL);
+        atomic_store(&g_stop, 1);
+        for(int i = readers; i < n_th; ++i) pthread_join(th[i].tid, NULL);
+        pthread_barrier_destroy(&g_start);
+
+        for(int i = 0; i < n_th; ++i)
+        {
+            if(th[i].rc != 0) rc = th[i].rc;
+        }
+    }
+
+    if(rc == 0)
+    {
+        out->readers = readers;
+        out->writers = writers;
+        rc           = calculate_lat_stats(th, n_th, 0, &out->rd);
+        if(rc == 0) rc = calculate_lat_stats(th, n_th, 1, &out->wr);
+    }
+
+    for(int i = 0; i < n_th; ++i) free(th[i].samples);
+    free(th);
+    return rc;
+}
+
+/**
+ * @brief Print or write one result row.
+ */
+static void print_step(FILE* fp, const step_result_t* r)
+{
+    fprintf(fp, "%7d %7d | %12.0f %9.2f %9.2f %9.2f | %12.0f %9.2f %9.2f %9.2f\n", r->readers,
+            r->writers, r->rd.ops_per_s, r->rd.p50, r->rd.p99, r->rd.p999, r->wr.ops_per_s,
+            r->wr.p50, r->wr.p99, r->wr.p999);
+}
+
+static void print_header(FILE* fp)
+{
+    fprintf(fp, "%7s %7s | %12s %9s %9s %9s | %12s %9s %9s %9s\n", "readers", "writers",
+            "GET ops/s", "p50 μs", "p99 μs", "p999 μs", "PUT ops/s", "p50 μs", "p99 μs",
+            "p999 μs");
+    fprintf(fp, "----------------+----------------------------------------------+"
+                "---------------------------------------------\n");
+}
+
+/**
+ * @brief Sweep the reader count from 1 to the core count.
+ */
+static int run_concurrency_benchmark(int writers, const char* output_file)
+{
+    static const char*      dbi_names[] = { "bench_keys" };
+    static const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    char profile_path[256];
+    output_file = bench_profile_path(output_file, profile_path, sizeof(profile_path));
+
+    sys_info_t sys_info = {0};
+    get_system_info(&sys_info);
+
+    /* 1, 2, 4, ... and the core count itself */
+    int steps[BENCH_MAX_STEPS];
+    int n_steps = 0;
+    int cores   = sys_info.cpu_cores > 0 ? (int)sys_info.cpu_cores : 1;
+    for(int t = 1; t < cores && n_steps < BENCH_MAX_STEPS - 1; t *= 2) steps[n_steps++] = t;
+    steps[n_steps++] = cores;
+
+    printf("=================================================================\n");
+    printf("Database Concurrency Benchmark\n");
+    printf("=================================================================\n\n");
+
+    printf("SYSTEM INFORMATION:\n");
+    printf("-------------------\n");
+    printf("Hostname:       %s\n", sys_info.hostname);
+    printf("OS:             %s\n", sys_info.os_info);
+    printf("CPU:            %s\n", sys_info.cpu_model);
+    printf("CPU Cores:      %ld\n", sys_info.cpu_cores);
+    printf("CPU Frequency:  %ld MHz\n", sys_info.cpu_freq_mhz);
+    printf("Total RAM:      %lu MB\n", sys_info.total_ram_mb);
+    printf("Storage Type:   %s\n", sys_info.storage_type);
+    printf("Filesystem:     %s\n", sys_info.filesystem);
+    printf("\n");
+
+    printf("BENCHMARK CONFIGURATION:\n");
+    printf("------------------------\n");
+    printf("Test Type:      concurrent single-op GET / PUT batches, one DBI\n");
+    printf("Measured:       db_core_batch_add_op + db_core_batch_exec, per op\n");
+    printf("NOT Measured:   Environment/DBI init, population, shutdown\n");
+    printf("Keys stored:    %d\n", BENCH_NUM_KEYS);
+    printf("Value size:     %d bytes\n", BENCH_VALUE_SIZE);
+    printf("GETs / reader:  %d\n", BENCH_READS_PER_THREAD);
+    printf("Writers:        %d (PUT until the readers are done)\n", writers);
+    printf("DB Path:        %s\n", BENCH_DB_PATH);
+    printf("Env profile:    %s\n", g_profile_name);
+    printf("=================================================================\n\n");
+
+    /* One environment for the whole sweep, populated once (not timed) */
+    if(remove_directory(BENCH_DB_PATH) != 0)
+    {
+        fprintf(stderr, "WARNING: Failed to remove directory %s\n", BENCH_DB_PATH);
+    }
+    int rc = db_core_init_ex(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u, &g_env_cfg);
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_init_ex failed with rc=%d\n", rc);
+        return rc;
+    }
+    rc = populate_db();
+    if(rc != 0)
+    {
+        (void)db_core_shutdown();
+        return rc;
+    }
+
+    step_result_t results[BENCH_MAX_STEPS];
+    print_header(stdout);
+    for(int s = 0; s < n_steps; ++s)
+    {
+        rc = run_step(steps[s], writers, &results[s]);
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: step with %d readers failed with rc=%d\n", steps[s], rc);
+            (void)db_core_shutdown();
+            return rc;
+        }
+        print_step(stdout, &results[s]);
+    }
+    printf("\nBenchmark completed!\n\n");
+
+    (void)db_core_shutdown();
+
+    /* Write detailed results to file. */
+    FILE* fp = fopen(output_file, "w");
+    if(!fp)
+    {
+        fprintf(stderr, "ERROR: Failed to open output file %s\n", output_file);
+        return -errno;
+    }
+
+    fprintf(fp, "╔════════════════════════════════════════════════════════════════╗\n");
+    fprintf(fp, "║              Database Concurrency Benchmark                    ║\n");
+    fprintf(fp, "╚════════════════════════════════════════════════════════════════╝\n\n");
+
+    fprintf(fp, "SYSTEM INFORMATION\n");
+    fprintf(fp, "-------------------\n");
+    fprintf(fp, "Hostname:          %s\n", sys_info.hostname);
+    fprintf(fp, "Operating System:  %s\n", sys_info.os_info);
+    fprintf(fp, "CPU Model:         %s\n", sys_info.cpu_model);
+    fprintf(fp, "CPU Cores:         %ld\n", sys_info.cpu_cores);
+    fprintf(fp, "CPU Frequency:     %ld MHz\n", sys_info.cpu_freq_mhz);
+    fprintf(fp, "Total RAM:         %lu MB\n", sys_info.total_ram_mb);
+    fprintf(fp, "Storage Type:      %s\n", sys_info.storage_type);
+    fprintf(fp, "Filesystem:        %s\n", sys_info.filesystem);
+
+    fprintf(fp, "\nBENCHMARK CONFIGURATION\n");
+    fprintf(fp, "------------------------\n");
+    fprintf(fp, "Test Type:         concurrent single-op GET / PUT batches, one DBI\n");
+    fprintf(fp, "What is Measured:  db_core_batch_add_op + db_core_batch_exec, per op\n");
+    fprintf(fp, "NOT Measured:      Environment/DBI init, population, shutdown\n");
+    fprintf(fp, "Keys stored:       %d\n", BENCH_NUM_KEYS);
+    fprintf(fp, "Value size:        %d bytes\n", BENCH_VALUE_SIZE);
+    fprintf(fp, "GETs per reader:   %d\n", BENCH_READS_PER_THREAD);
+    fprintf(fp, "Writers:           %d\n", writers);
+    fprintf(fp, "DB Path:           %s\n", BENCH_DB_PATH);
+    fprintf(fp, "DB Mode:           0%o\n", BENCH_DB_MODE);
+    fprintf(fp, "Env profile:       %s\n", g_profile_name);
+
+    fprintf(fp, "\nRESULTS - Throughput and latency per thread count\n");
+    fprintf(fp, "--------------------------------------------------\n");
+    print_header(fp);
+    for(int s = 0; s < n_steps; ++s) print_step(fp, &results[s]);
+
+    fprintf(fp, "\nRESULTS - Max latency (μs)\n");
+    fprintf(fp, "--------------------------\n");
+    for(int s = 0; s < n_steps; ++s)
+    {
+        fprintf(fp, "readers %3d: GET %10.2f  PUT %10.2f  (%zu GETs, %zu PUTs)\n",
+                results[s].readers, results[s].rd.max, results[s].wr.max, results[s].rd.ops,
+                results[s].wr.ops);
+    }
+
+    fclose(fp);
+
+    printf("Detailed results written to: %s\n\n", output_file);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int writers = (argc > 2) ? atoi(argv[2]) : 1;
+    if(bench_set_profile(argc > 1 ? argv[1] : "durable") != 0 || writers < 0 ||
+       writers > BENCH_MAX_WRITERS)
+    {
+        fprintf(stderr, "usage: %s [durable|fast-async|read-mostly] [writers 0..%d]\n", argv[0],
+                BENCH_MAX_WRITERS);
+        return 1;
+    }
+
+    /* Ensure results directory exists. */
+    if(bench_ensure_results_dir() != 0) return 1;
+
+    /* Prepare synthetic data once. */
+    init_test_data();
+
+    char output_file[128];
+    (void)snprintf(output_file, sizeof(output_file),
+                   "tests/benchmarks/results/bench_concurrency_w%d.txt", writers);
+
+    int rc = run_concurrency_benchmark(writers, output_file);
+    (void)remove_directory(BENCH_DB_PATH);
+    if(rc != 0)
+    {
+        fprintf(stderr, "Concurrency benchmark failed with rc=%d\n", rc);
+        return 1;
+    }
+
+    printf("Concurrency benchmark completed successfully!\n");
+    return 0;
+}
@@ -8,6 +8,10 @@
  *   - Scenario 1: non-batched GETs (one op per exec)
  *   - Scenario 2: batched GETs (8 ops per exec)
  *
+ * Each scenario runs twice: with read-only txn reuse (park with
+ * mdb_txn_reset, resume with mdb_txn_renew) and without it (a fresh
+ * mdb_txn_begin/mdb_txn_abort per exec), so the cost of txn setup shows up.
+ *
  * For each run:
  *   - The database directory is cleaned.
  *   - A new environment + single DBI is created.
@@ -16,20 +20,12 @@
  *   - Shutdown is NOT included in the timing.
  */
 
+#include "bench_common.h"
 #include "core.h"
-#include <dirent.h>
 #include <errno.h>
-#include <math.h>
-#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <sys/sysinfo.h>
-#include <sys/statvfs.h>
-#include <sys/time.h>
-#include <time.h>
-#include <unistd.h>
 
 /* Benchmark configuration */
 #define BENCH_DB_PATH        "/tmp/bench_lmdb_get"
@@ -40,286 +36,10 @@
 #define BENCH_RUNS           10
 #define BENCH_BATCH_SIZE     8
 
-/* System information structure */
-typedef struct
-{
-    char           hostname[256];
-    char           cpu_model[256];
-    char           os_info[256];
-    long           cpu_cores;
-    long           cpu_freq_mhz;
-    unsigned long  total_ram_mb;
-    char           storage_type[64]; /* SSD or HDD */
-    char           filesystem[64];
-} sys_info_t;
-
-/* Statistics structure */
-typedef struct
-{
-    double mean;
-    double std_dev;
-    double min;
-    double max;
-    double median;
-} stats_t;
-
 /* Pre-generated test data */
 static char g_keys[BENCH_NUM_USERS][32];
 static char g_value[BENCH_VALUE_SIZE];
 
-/**
- * @brief Get system information
- */
-static void get_system_info(sys_info_t* info)
-{
-    FILE* fp;
-    char  buffer[256];
-
-    /* Hostname */
-    gethostname(info->hostname, sizeof(info->hostname));
-
-    /* CPU model */
-    fp = fopen("/proc/cpuinfo", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "model name", 10) == 0)
-            {
-                char* colon = strchr(buffer, ':');
-                if(colon)
-                {
-                    colon += 2; /* Skip ": " */
-                    strncpy(info->cpu_model, colon, sizeof(info->cpu_model) - 1);
-                    info->cpu_model[strcspn(info->cpu_model, "\n")] = 0;
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-
-    /* CPU cores */
-    info->cpu_cores = sysconf(_SC_NPROCESSORS_ONLN);
-
-    /* CPU frequency (from /proc/cpuinfo) */
-    fp = fopen("/proc/cpuinfo", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "cpu MHz", 7) == 0)
-            {
-                char* colon = strchr(buffer, ':');
-                if(colon)
-                {
-                    info->cpu_freq_mhz = (long)atof(colon + 1);
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-
-    /* Total RAM */
-    struct sysinfo si;
-    if(sysinfo(&si) == 0)
-    {
-        info->total_ram_mb = si.totalram / (1024 * 1024);
-    }
-
-    /* OS information */
-    fp = fopen("/etc/os-release", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "PRETTY_NAME=", 12) == 0)
-            {
-                char* start = strchr(buffer, '"');
-                if(start)
-                {
-                    start++;
-                    char* end = strchr(start, '"');
-                    if(end)
-                    {
-                        size_t len = (size_t)(end - start);
-                        if(len < sizeof(info->os_info))
-                        {
-                            memcpy(info->os_info, start, len);
-                            info->os_info[len] = '\0';
-                        }
-                    }
-                }
-                break;
-            }
-        }
-        fclose(fp);
-    }
-
-    /* Storage type - detect SSD vs HDD */
-    /* Check if /tmp is on SSD by looking at rotational flag */
-    strcpy(info->storage_type, "Unknown");
-    fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep '/tmp' | awk '{print $2}'", "r");
-    if(fp)
-    {
-        if(fgets(buffer, sizeof(buffer), fp))
-        {
-            int rota = atoi(buffer);
-            strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
-        }
-        pclose(fp);
-    }
-
-    /* If /tmp not in lsblk output, check root */
-    if(strcmp(info->storage_type, "Unknown") == 0)
-    {
-        fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep ' /$' | awk '{print $2}'", "r");
-        if(fp)
-        {
-            if(fgets(buffer, sizeof(buffer), fp))
-            {
-                int rota = atoi(buffer);
-                strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
-            }
-            pclose(fp);
-        }
-    }
-
-    /* Filesystem type */
-    struct statvfs vfs;
-    if(statvfs("/tmp", &vfs) == 0)
-    {
-        fp = popen("df -T /tmp 2>/dev/null | tail -1 | awk '{print $2}'", "r");
-        if(fp)
-        {
-            if(fgets(buffer, sizeof(buffer), fp))
-            {
-                buffer[strcspn(buffer, "\n")] = 0;
-                strncpy(info->filesystem, buffer, sizeof(info->filesystem) - 1);
-            }
-            pclose(fp);
-        }
-    }
-}
-
-/**
- * @brief Recursively remove a directory tree.
- *
- * This is a simple, benchmark-oriented equivalent of `rm -rf path`.
- * Best-effort: on failure it returns -1 but continues as far as possible.
- */
-static int remove_directory(const char* path)
-{
-    struct stat st;
-
-    if(stat(path, &st) != 0)
-    {
-        /* Treat non-existent path as success. */
-        return (errno == ENOENT) ? 0 : -1;
-    }
-
-    if(!S_ISDIR(st.st_mode))
-    {
-        return (unlink(path) == 0) ? 0 : -1;
-    }
-
-    DIR* dir = opendir(path);
-    if(!dir)
-    {
-        return -1;
-    }
-
-    struct dirent* ent;
-    int            rc = 0;
-
-    while((ent = readdir(dir)) != NULL)
-    {
-        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
-
-        char child[PATH_MAX];
-        int  n = snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
-        if(n <= 0 || (size_t)n >= sizeof(child))
-        {
-            rc = -1;
-            continue;
-        }
-
-        struct stat child_st;
-        if(lstat(child, &child_st) != 0)
-        {
-            rc = -1;
-            continue;
-        }
-
-        if(S_ISDIR(child_st.st_mode))
-        {
-            if(remove_directory(child) != 0) rc = -1;
-        }
-        else
-        {
-            if(unlink(child) != 0) rc = -1;
-        }
-    }
-
-    closedir(dir);
-
-    if(rmdir(path) != 0) rc = -1;
-    return rc;
-}
-
-/**
- * @brief Get current time in microseconds
- */
-static double get_time_us(void)
-{
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
-}
-
-/**
- * @brief Compare function for qsort (doubles)
- */
-static int compare_double(const void* a, const void* b)
-{
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    return (da > db) - (da < db);
-}
-
-/**
- * @brief Calculate statistics from an array of samples
- */
-static void calculate_stats(double* samples, size_t n, stats_t* out)
-{
-    double sum    = 0.0;
-    double sum_sq = 0.0;
-
-    /* Sort samples for median and min/max */
-    qsort(samples, n, sizeof(double), compare_double);
-
-    /* Calculate mean */
-    for(size_t i = 0; i < n; i++)
-    {
-        sum += samples[i];
-    }
-    out->mean = sum / (double)n;
-
-    /* Calculate standard deviation */
-    for(size_t i = 0; i < n; i++)
-    {
-        double diff = samples[i] - out->mean;
-        sum_sq += diff * diff;
-    }
-    out->std_dev = sqrt(sum_sq / (double)n);
-
-    /* Min, max, median */
-    out->min    = samples[0];
-    out->max    = samples[n - 1];
-    out->median = (n % 2 == 0) ? (samples[n / 2 - 1] + samples[n / 2]) / 2.0 : samples[n / 2];
-}
-
 /**
  * @brief Initialize synthetic user keys and value buffer.
  */
@@ -408,10 +128,10 @@ static int run_single_get_run(int batch_size, int run_index, double* out_total_u
     }
 
     /* Create database environment + single DBI (not timed). */
-    int rc = db_core_init(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u);
+    int rc = db_core_init_ex(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u, &g_env_cfg);
     if(rc != 0)
     {
-        fprintf(stderr, "ERROR: db_core_init failed with rc=%d\n", rc);
+        fprintf(stderr, "ERROR: db_core_init_ex failed with rc=%d\n", rc);
         return rc;
     }
 
@@ -528,8 +248,12 @@ static int run_single_get_run(int batch_size, int run_index, double* out_total_u
  */
 static int run_get_benchmark(const char* label,
                              int         batch_size,
+                             int         ro_txn_reuse,
                              const char* output_file)
 {
+    char profile_path[256];
+    output_file = bench_profile_path(output_file, profile_path, sizeof(profile_path));
+
     sys_info_t sys_info = {0};
     get_system_info(&sys_info);
 
@@ -565,13 +289,18 @@ static int run_get_benchmark(const char* label,
     printf("Value size:     %d bytes\n", BENCH_VALUE_SIZE);
     printf("GETs per run:   %d\n", BENCH_NUM_GETS);
     printf("Batch size:     %d\n", batch_size <= 1 ? 1 : batch_size);
+    printf("RO txn reuse:   %s\n", ro_txn_reuse ? "on (reset/renew)" : "off (begin/abort)");
     printf("Runs:           %d\n", BENCH_RUNS);
     printf("DB Path:        %s\n", BENCH_DB_PATH);
     printf("DB Mode:        0%o\n", BENCH_DB_MODE);
+    printf("Env profile:    %s\n", g_profile_name);
     printf("=================================================================\n\n");
 
     printf("Running benchmark...\n");
 
+    /* Process-wide toggle, survives init/shutdown of each run. */
+    db_core_set_ro_txn_reuse(ro_txn_reuse);
+
     for(int run = 0; run < BENCH_RUNS; ++run)
     {
         double total_us = 0.0;
@@ -653,9 +382,12 @@ static int run_get_benchmark(const char* label,
     fprintf(fp, "Value size:        %d bytes\n", BENCH_VALUE_SIZE);
     fprintf(fp, "GETs per run:      %d\n", BENCH_NUM_GETS);
     fprintf(fp, "Batch size:        %d\n", batch_size <= 1 ? 1 : batch_size);
+    fprintf(fp, "RO txn reuse:      %s\n",
+            ro_txn_reuse ? "on (reset/renew)" : "off (begin/abort)");
     fprintf(fp, "Runs:              %d\n", BENCH_RUNS);
     fprintf(fp, "DB Path:           %s\n", BENCH_DB_PATH);
     fprintf(fp, "DB Mode:           0%o\n", BENCH_DB_MODE);
+    fprintf(fp, "Env profile:       %s\n", g_profile_name);
 
     fprintf(fp, "\nRESULTS - Per-run Totals\n");
     fprintf(fp, "------------------------\n");
@@ -693,55 +425,61 @@ static int run_get_benchmark(const char* label,
     return 0;
 }
 
-int main(void)
+int main(int argc, char* argv[])
 {
-    const char* output_single = "tests/benchmarks/results/bench_get_users_single.txt";
-    const char* output_batch8 = "tests/benchmarks/results/bench_get_users_batch8.txt";
-
-    /* Ensure results directory exists. */
-    struct stat st;
-    if(stat("tests/benchmarks/results", &st) != 0)
+    if(bench_set_profile(argc > 1 ? argv[1] : "durable") != 0)
     {
-        if(errno != ENOENT || mkdir("tests/benchmarks/results", 0755) != 0)
-        {
-            perror("mkdir tests/benchmarks/results");
-            return 1;
-        }
-    }
-    else if(!S_ISDIR(st.st_mode))
-    {
-        fprintf(stderr, "ERROR: tests/benchmarks/results exists and is not a directory\n");
+        fprintf(stderr, "usage: %s [durable|fast-async|read-mostly]\n", argv[0]);
         return 1;
     }
 
+    static const struct
+    {
+        const char* label;
+        int         batch_size;
+        int         ro_txn_reuse;
+        const char* output_file;
+    } patterns[] = {
+        { "Single GET, txn reuse", 1, 1, "tests/benchmarks/results/bench_get_users_single.txt" },
+        { "Single GET, no reuse", 1, 0,
+          "tests/benchmarks/results/bench_get_users_single_noreuse.txt" },
+        { "Batched GET (8), txn reuse", BENCH_BATCH_SIZE, 1,
+          "tests/benchmarks/results/bench_get_users_batch8.txt" },
+        { "Batched GET (8), no reuse", BENCH_BATCH_SIZE, 0,
+          "tests/benchmarks/results/bench_get_users_batch8_noreuse.txt" },
+    };
+    const size_t n_patterns = sizeof(patterns) / sizeof(patterns[0]);
+
+    /* Ensure results directory exists. */
+    if(bench_ensure_results_dir() != 0) return 1;
+
     /* Prepare synthetic data once. */
     init_test_data();
 
-    int rc_single =
-        run_get_benchmark("Single GET (no batching)", 1, output_single);
-    if(rc_single != 0)
+    int failed = 0;
+    for(size_t i = 0; i < n_patterns; ++i)
     {
-        fprintf(stderr, "Single GET benchmark failed with rc=%d\n", rc_single);
-    }
-
-    /* Clean up completely between patterns. */
-    (void)remove_directory(BENCH_DB_PATH);
+        int rc = run_get_benchmark(patterns[i].label, patterns[i].batch_size,
+                                   patterns[i].ro_txn_reuse, patterns[i].output_file);
+        if(rc != 0)
+        {
+            fprintf(stderr, "%s benchmark failed with rc=%d\n", patterns[i].label, rc);
+            failed++;
+        }
 
-    int rc_batch =
-        run_get_benchmark("Batched GET (8 ops)", BENCH_BATCH_SIZE, output_batch8);
-    if(rc_batch != 0)
-    {
-        fprintf(stderr, "Batched GET benchmark failed with rc=%d\n", rc_batch);
+        /* Clean up completely between patterns. */
+        (void)remove_directory(BENCH_DB_PATH);
     }
 
-    if(rc_single == 0 && rc_batch == 0)
+    /* Leave the library default in place. */
+    db_core_set_ro_txn_reuse(1);
+
+    if(failed == 0)
     {
         printf("All GET benchmarks completed successfully!\n");
         return 0;
     }
 
-    fprintf(stderr, "One or more GET benchmarks failed (single rc=%d, batch rc=%d)\n",
-            rc_single, rc_batch);
+    fprintf(stderr, "%d of %zu GET benchmarks failed\n", failed, n_patterns);
     return 1;
 }
-
@@ -10,20 +10,19 @@
  *
  * The test runs multiple iterations, cleaning the database directory between
  * each iteration to ensure every measurement is a true "from scratch" init.
+ *
+ * A second scenario reopens a populated database after evicting its file from
+ * the page cache and measures the time to the first answered query, with the
+ * default open and with the warm start options (db_env_cfg_t.warm).
  */
 
+#include "bench_common.h"
 #include "core.h"
-#include <dirent.h>
 #include <errno.h>
-#include <math.h>
-#include <limits.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <sys/sysinfo.h>
-#include <sys/statvfs.h>
-#include <sys/time.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -32,252 +31,11 @@
 #define BENCH_DB_PATH "/tmp/bench_lmdb_test"
 #define BENCH_DB_MODE 0700
 
-/* System information structure */
-typedef struct {
-    char hostname[256];
-    char cpu_model[256];
-    char os_info[256];
-    long cpu_cores;
-    long cpu_freq_mhz;
-    unsigned long total_ram_mb;
-    char storage_type[64];  /* SSD or HDD */
-    char filesystem[64];
-} sys_info_t;
-
-/* Statistics structure */
-typedef struct {
-    double mean;
-    double std_dev;
-    double min;
-    double max;
-    double median;
-} stats_t;
-
-/**
- * @brief Get system information
- */
-static void get_system_info(sys_info_t* info) {
-    FILE* fp;
-    char buffer[256];
-    
-    /* Hostname */
-    gethostname(info->hostname, sizeof(info->hostname));
-    
-    /* CPU model */
-    fp = fopen("/proc/cpuinfo", "r");
-    if (fp) {
-        while (fgets(buffer, sizeof(buffer), fp)) {
-            if (strncmp(buffer, "model name", 10) == 0) {
-                char* colon = strchr(buffer, ':');
-                if (colon) {
-                    colon += 2;  /* Skip ": " */
-                    strncpy(info->cpu_model, colon, sizeof(info->cpu_model) - 1);
-                    info->cpu_model[strcspn(info->cpu_model, "\n")] = 0;
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-    
-    /* CPU cores */
-    info->cpu_cores = sysconf(_SC_NPROCESSORS_ONLN);
-    
-    /* CPU frequency (from /proc/cpuinfo) */
-    fp = fopen("/proc/cpuinfo", "r");
-    if (fp) {
-        while (fgets(buffer, sizeof(buffer), fp)) {
-            if (strncmp(buffer, "cpu MHz", 7) == 0) {
-                char* colon = strchr(buffer, ':');
-                if (colon) {
-                    info->cpu_freq_mhz = (long)atof(colon + 1);
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-    
-    /* Total RAM */
-    struct sysinfo si;
-    if (sysinfo(&si) == 0) {
-        info->total_ram_mb = si.totalram / (1024 * 1024);
-    }
-    
-    /* OS information */
-    fp = fopen("/etc/os-release", "r");
-    if (fp) {
-        while (fgets(buffer, sizeof(buffer), fp)) {
-            if (strncmp(buffer, "PRETTY_NAME=", 12) == 0) {
-                char* start = strchr(buffer, '"');
-                if (start) {
-                    start++;
-                    char* end = strchr(start, '"');
-                    if (end) {
-                        size_t len = end - start;
-                        if (len < sizeof(info->os_info)) {
-                            memcpy(info->os_info, start, len);
-                            info->os_info[len] = '\0';
-                        }
-                    }
-                }
-                break;
-            }
-        }
-        fclose(fp);
-    }
-    
-    /* Storage type - detect SSD vs HDD */
-    /* Check if /tmp is on SSD by looking at rotational flag */
-    strcpy(info->storage_type, "Unknown");
-    fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep '/tmp' | awk '{print $2}'", "r");
-    if (fp) {
-        if (fgets(buffer, sizeof(buffer), fp)) {
-            int rota = atoi(buffer);
-            strcpy(info->storage_type, rota == 0 ? "SSD" : "HDD");
-        }
-        pclose(fp);
-    }
-    
-    /* If /tmp not in lsblk output, check root */
-    if (strcmp(info->storage_type, "Unknown") == 0) {
-        fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep ' /$' | awk '{print $2}'", "r");
-        if (fp) {
-            if (fgets(buffer, sizeof(buffer), fp)) {
-                int rota = atoi(buffer);
-                strcpy(info->storage_type, rota == 0 ? "SSD" : "HDD");
-            }
-            pclose(fp);
-        }
-    }
-    
-    /* Filesystem type */
-    struct statvfs vfs;
-    if (statvfs("/tmp", &vfs) == 0) {
-        fp = popen("df -T /tmp 2>/dev/null | tail -1 | awk '{print $2}'", "r");
-        if (fp) {
-            if (fgets(buffer, sizeof(buffer), fp)) {
-                buffer[strcspn(buffer, "\n")] = 0;
-                strncpy(info->filesystem, buffer, sizeof(info->filesystem) - 1);
-            }
-            pclose(fp);
-        }
-    }
-}
-
-/**
- * @brief Recursively remove a directory tree.
- *
- * This is a simple, benchmark-oriented equivalent of `rm -rf path`.
- * Best-effort: on failure it returns -1 but continues as far as possible.
- */
-static int remove_directory(const char* path)
-{
-    struct stat st;
-
-    if(stat(path, &st) != 0)
-    {
-        /* Treat non-existent path as success. */
-        return (errno == ENOENT) ? 0 : -1;
-    }
-
-    if(!S_ISDIR(st.st_mode))
-    {
-        return (unlink(path) == 0) ? 0 : -1;
-    }
-
-    DIR* dir = opendir(path);
-    if(!dir)
-    {
-        return -1;
-    }
-
-    struct dirent* ent;
-    int            rc = 0;
-
-    while((ent = readdir(dir)) != NULL)
-    {
-        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
-
-        char child[PATH_MAX];
-        int  n = snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
-        if(n <= 0 || (size_t)n >= sizeof(child))
-        {
-            rc = -1;
-            continue;
-        }
-
-        struct stat child_st;
-        if(lstat(child, &child_st) != 0)
-        {
-            rc = -1;
-            continue;
-        }
-
-        if(S_ISDIR(child_st.st_mode))
-        {
-            if(remove_directory(child) != 0) rc = -1;
-        }
-        else
-        {
-            if(unlink(child) != 0) rc = -1;
-        }
-    }
-
-    closedir(dir);
-
-    if(rmdir(path) != 0) rc = -1;
-    return rc;
-}
-
-/**
- * @brief Get current time in microseconds
- */
-static double get_time_us(void) {
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
-}
-
-/**
- * @brief Compare function for qsort (doubles)
- */
-static int compare_double(const void* a, const void* b) {
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    return (da > db) - (da < db);
-}
-
-/**
- * @brief Calculate statistics from an array of samples
- */
-static void calculate_stats(double* samples, size_t n, stats_t* out) {
-    double sum = 0.0;
-    double sum_sq = 0.0;
-    
-    /* Sort samples for median and min/max */
-    qsort(samples, n, sizeof(double), compare_double);
-    
-    /* Calculate mean */
-    for (size_t i = 0; i < n; i++) {
-        sum += samples[i];
-    }
-    out->mean = sum / (double)n;
-    
-    /* Calculate standard deviation */
-    for (size_t i = 0; i < n; i++) {
-        double diff = samples[i] - out->mean;
-        sum_sq += diff * diff;
-    }
-    out->std_dev = sqrt(sum_sq / (double)n);
-    
-    /* Min, max, median */
-    out->min = samples[0];
-    out->max = samples[n - 1];
-    out->median = (n % 2 == 0) 
-        ? (samples[n/2 - 1] + samples[n/2]) / 2.0
-        : samples[n/2];
-}
+/* Warm reopen scenario */
+#define BENCH_REOPEN_ITERATIONS 50     /* Reopens measured per variant */
+#define BENCH_REOPEN_KEYS       200000 /* Keys written once before the reopens */
+#define BENCH_REOPEN_VAL        100    /* Value bytes per key */
+#define BENCH_REOPEN_BATCH      4096   /* PUTs per db_core_exec_ops */
 
 /**
  * @brief Run a single benchmark iteration for a given DBI layout.
@@ -474,9 +232,164 @@ static int run_benchmark(const char* label,
     return 0;
 }
 
+/* Layout of the reopen scenario: one hot DBI queried, one cold */
+static const char*      reopen_names[] = { "hot_dbi", "cold_dbi" };
+static const dbi_type_t reopen_types[] = { DBI_TYPE_DEFAULT, DBI_TYPE_DEFAULT };
+
+/**
+ * @brief Write BENCH_REOPEN_KEYS keys to the hot DBI, then close.
+ * @return 0 on success, or the first error.
+ */
+static int bench_reopen_populate(const char* db_path, const db_env_cfg_t* cfg)
+{
+    int rc = db_core_init_ex(db_path, BENCH_DB_MODE, reopen_names, reopen_types, 2u, cfg);
+    if(rc != 0) return rc;
+
+    char key[16];
+    char val[BENCH_REOPEN_VAL];
+    memset(val, 'v', sizeof(val));
+    for(unsigned i = 0; i < BENCH_REOPEN_KEYS && rc == 0; i++)
+    {
+        (void)snprintf(key, sizeof(key), "k%09u", i);
+        rc = db_core_add_op(0u, DB_OPERATION_PUT, key, 10u, val, sizeof(val));
+        if(rc == 0 && ((i + 1u) % BENCH_REOPEN_BATCH == 0 || i + 1u == BENCH_REOPEN_KEYS))
+        {
+            rc = db_core_exec_ops();
+        }
+    }
+
+    (void)db_core_shutdown();
+    return rc;
+}
+
+/**
+ * @brief Drop the clean pages of the data file from the page cache.
+ */
+static void bench_evict_file(const char* db_path)
+{
+    char path[512];
+    (void)snprintf(path, sizeof(path), "%s/data.mdb", db_path);
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return;
+    (void)fdatasync(fd);
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/**
+ * @brief One cold-cache reopen: init, then the first GET answered.
+ * @return Time in microseconds, or -1.0 on error
+ */
+static double bench_single_reopen(const char* db_path, const db_env_cfg_t* cfg, unsigned seed)
+{
+    char key[16];
+    char val[BENCH_REOPEN_VAL];
+    (void)snprintf(key, sizeof(key), "k%09u", (seed * 7919u) % BENCH_REOPEN_KEYS);
+
+    bench_evict_file(db_path);
+
+    /* TIMING STARTS: open + first query */
+    double start = get_time_us();
+    int    rc    = db_core_init_ex(db_path, BENCH_DB_MODE, reopen_names, reopen_types, 2u, cfg);
+    if(rc == 0) rc = db_core_add_op(0u, DB_OPERATION_GET, key, 10u, val, sizeof(val));
+    if(rc == 0) rc = db_core_exec_ops();
+    double end = get_time_us();
+
+    /* Walks still running are stopped - NOT TIMED */
+    (void)db_core_shutdown();
+
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: reopen + first GET failed with rc=%d\n", rc);
+        return -1.0;
+    }
+    return end - start;
+}
+
+/**
+ * @brief Time to first query after a cold-cache reopen, default vs warm open.
+ */
+static int run_reopen_benchmark(const char* db_path, const char* output_file)
+{
+    db_env_cfg_t warm_cfg;
+    (void)db_core_env_profile(DB_ENV_PROFILE_DURABLE, &warm_cfg);
+    warm_cfg.warm          = DB_WARM_READER_CHECK | DB_WARM_PREFETCH_MAP | DB_WARM_SCHEMA;
+    warm_cfg.prefetch_dbis = 1u << 0;
+
+    const char*         labels[2] = { "default", "warm" };
+    const db_env_cfg_t* cfgs[2]   = { NULL, &warm_cfg };
+    stats_t             stats[2];
+
+    double* times = malloc(BENCH_REOPEN_ITERATIONS * sizeof(double));
+    if(!times)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate memory for results\n");
+        return -ENOMEM;
+    }
+
+    printf("=================================================================\n");
+    printf("Warm Reopen Benchmark (%d keys, page cache dropped per reopen)\n", BENCH_REOPEN_KEYS);
+    printf("=================================================================\n");
+
+    /* The warm variant saves the schema record on its first open */
+    (void)remove_directory(db_path);
+    int rc = bench_reopen_populate(db_path, &warm_cfg);
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: populate failed with rc=%d\n", rc);
+        free(times);
+        return rc;
+    }
+
+    for(int v = 0; v < 2; v++)
+    {
+        for(int iter = 0; iter < BENCH_REOPEN_ITERATIONS; iter++)
+        {
+            times[iter] = bench_single_reopen(db_path, cfgs[v], (unsigned)iter);
+            if(times[iter] < 0.0)
+            {
+                free(times);
+                return -1;
+            }
+        }
+        calculate_stats(times, BENCH_REOPEN_ITERATIONS, &stats[v]);
+        printf("  %-8s mean %10.2f μs  median %10.2f μs  p99 %10.2f μs\n", labels[v],
+               stats[v].mean, stats[v].median, stats[v].p99);
+    }
+    free(times);
+    printf("=================================================================\n\n");
+
+    FILE* fp = fopen(output_file, "w");
+    if(!fp)
+    {
+        fprintf(stderr, "ERROR: Failed to open output file %s\n", output_file);
+        return -errno;
+    }
+
+    time_t now = time(NULL);
+    fprintf(fp, "Warm Reopen Benchmark Results\n");
+    fprintf(fp, "Timestamp: %s\n", ctime(&now));
+    fprintf(fp, "Measured:          db_core_init_ex + first GET, page cache dropped before each\n");
+    fprintf(fp, "Keys:              %d x %d B values in one of 2 DBIs\n", BENCH_REOPEN_KEYS,
+            BENCH_REOPEN_VAL);
+    fprintf(fp, "Iterations:        %d per variant\n", BENCH_REOPEN_ITERATIONS);
+    fprintf(fp, "Warm options:      READER_CHECK | PREFETCH_MAP | SCHEMA, prefetch DBI 0\n\n");
+    for(int v = 0; v < 2; v++)
+    {
+        fprintf(fp, "%-8s mean %12.2f μs  median %12.2f μs  p99 %12.2f μs  max %12.2f μs\n",
+                labels[v], stats[v].mean, stats[v].median, stats[v].p99, stats[v].max);
+    }
+    fclose(fp);
+
+    printf("Detailed results written to: %s\n\n", output_file);
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     const char* output_file_1  = "tests/benchmarks/results/bench_db_init_results_1dbi.txt";
     const char* output_file_10 = "tests/benchmarks/results/bench_db_init_results_10dbis.txt";
+    const char* output_file_re = "tests/benchmarks/results/bench_db_init_results_warm_reopen.txt";
 
     /* Allow overriding the base output file from command line (1 DBI case). */
     if(argc > 1)
@@ -485,20 +398,7 @@ int main(int argc, char* argv[]) {
     }
 
     /* Ensure results directory exists */
-    struct stat st;
-    if(stat("tests/benchmarks/results", &st) != 0)
-    {
-        if(errno != ENOENT || mkdir("tests/benchmarks/results", 0755) != 0)
-        {
-            perror("mkdir tests/benchmarks/results");
-            return 1;
-        }
-    }
-    else if(!S_ISDIR(st.st_mode))
-    {
-        fprintf(stderr, "ERROR: tests/benchmarks/results exists and is not a directory\n");
-        return 1;
-    }
+    if(bench_ensure_results_dir() != 0) return 1;
     
     /* Define DBI layouts */
     static const char* dbi_names_1[]  = { "test_dbi" };
@@ -540,18 +440,26 @@ int main(int argc, char* argv[]) {
         fprintf(stderr, "Benchmark for 10 DBIs failed with error code: %d\n", rc10);
     }
 
+    /* Cold-cache reopen of a populated database, default vs warm open */
+    int rc_re = run_reopen_benchmark(BENCH_DB_PATH, output_file_re);
+    if(rc_re != 0)
+    {
+        fprintf(stderr, "Warm reopen benchmark failed with error code: %d\n", rc_re);
+    }
+
     /* Final cleanup */
     /* Final cleanup */
     remove_directory(BENCH_DB_PATH);
     
-    if(rc == 0 && rc10 == 0)
+    if(rc == 0 && rc10 == 0 && rc_re == 0)
     {
         printf("All benchmarks completed successfully!\n");
         return 0;
     }
     else
     {
-        fprintf(stderr, "One or more benchmarks failed (1 DBI rc=%d, 10 DBIs rc=%d)\n", rc, rc10);
+        fprintf(stderr, "One or more benchmarks failed (1 DBI rc=%d, 10 DBIs rc=%d, reopen rc=%d)\n",
+                rc, rc10, rc_re);
         return 1;
     }
 }
@@ -6,7 +6,8 @@
  * of key/value pairs into a single sub-DBI:
  *
  *   - Scenario 1: non-batched PUTs (one op per exec)
- *   - Scenario 2: batched PUTs (8 ops per exec)
+ *   - Scenario 2..N: batched PUTs, sweeping the batch size over
+ *     8 / 64 / 512 / 4096 ops per exec to show commit amortization
  *
  * The database environment and DBI are created BEFORE timing starts.
  * Timing starts immediately before the first db_core_add_op/db_core_exec_ops
@@ -16,309 +17,28 @@
  * measured time reflects only the insertion workload, not prior state.
  */
 
+#include "bench_common.h"
 #include "core.h"
-#include <dirent.h>
 #include <errno.h>
-#include <math.h>
-#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/stat.h>
-#include <sys/sysinfo.h>
-#include <sys/statvfs.h>
-#include <sys/time.h>
-#include <time.h>
-#include <unistd.h>
 
 /* Benchmark configuration */
 #define BENCH_DB_PATH        "/tmp/bench_lmdb_ops"
 #define BENCH_DB_MODE        0700
-#define BENCH_NUM_USERS      1000
+#define BENCH_NUM_USERS      4096
 #define BENCH_VALUE_SIZE     1024
 #define BENCH_RUNS           10
-#define BENCH_BATCH_SIZE     8
 
-/* System information structure */
-typedef struct
-{
-    char           hostname[256];
-    char           cpu_model[256];
-    char           os_info[256];
-    long           cpu_cores;
-    long           cpu_freq_mhz;
-    unsigned long  total_ram_mb;
-    char           storage_type[64]; /* SSD or HDD */
-    char           filesystem[64];
-} sys_info_t;
-
-/* Statistics structure */
-typedef struct
-{
-    double mean;
-    double std_dev;
-    double min;
-    double max;
-    double median;
-} stats_t;
+/* Batch sizes swept after the non-batched baseline */
+static const int g_batch_sizes[] = { 8, 64, 512, 4096 };
+#define BENCH_N_BATCH_SIZES  (sizeof(g_batch_sizes) / sizeof(g_batch_sizes[0]))
 
 /* Pre-generated test data */
 static char  g_keys[BENCH_NUM_USERS][32];
 static char  g_value[BENCH_VALUE_SIZE];
 
-/**
- * @brief Get system information
- */
-static void get_system_info(sys_info_t* info)
-{
-    FILE* fp;
-    char  buffer[256];
-
-    /* Hostname */
-    gethostname(info->hostname, sizeof(info->hostname));
-
-    /* CPU model */
-    fp = fopen("/proc/cpuinfo", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "model name", 10) == 0)
-            {
-                char* colon = strchr(buffer, ':');
-                if(colon)
-                {
-                    colon += 2; /* Skip ": " */
-                    strncpy(info->cpu_model, colon, sizeof(info->cpu_model) - 1);
-                    info->cpu_model[strcspn(info->cpu_model, "\n")] = 0;
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-
-    /* CPU cores */
-    info->cpu_cores = sysconf(_SC_NPROCESSORS_ONLN);
-
-    /* CPU frequency (from /proc/cpuinfo) */
-    fp = fopen("/proc/cpuinfo", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "cpu MHz", 7) == 0)
-            {
-                char* colon = strchr(buffer, ':');
-                if(colon)
-                {
-                    info->cpu_freq_mhz = (long)atof(colon + 1);
-                    break;
-                }
-            }
-        }
-        fclose(fp);
-    }
-
-    /* Total RAM */
-    struct sysinfo si;
-    if(sysinfo(&si) == 0)
-    {
-        info->total_ram_mb = si.totalram / (1024 * 1024);
-    }
-
-    /* OS information */
-    fp = fopen("/etc/os-release", "r");
-    if(fp)
-    {
-        while(fgets(buffer, sizeof(buffer), fp))
-        {
-            if(strncmp(buffer, "PRETTY_NAME=", 12) == 0)
-            {
-                char* start = strchr(buffer, '"');
-                if(start)
-                {
-                    start++;
-                    char* end = strchr(start, '"');
-                    if(end)
-                    {
-                        size_t len = (size_t)(end - start);
-                        if(len < sizeof(info->os_info))
-                        {
-                            memcpy(info->os_info, start, len);
-                            info->os_info[len] = '\0';
-                        }
-                    }
-                }
-                break;
-            }
-        }
-        fclose(fp);
-    }
-
-    /* Storage type - detect SSD vs HDD */
-    /* Check if /tmp is on SSD by looking at rotational flag */
-    strcpy(info->storage_type, "Unknown");
-    fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep '/tmp' | awk '{print $2}'", "r");
-    if(fp)
-    {
-        if(fgets(buffer, sizeof(buffer), fp))
-        {
-            int rota = atoi(buffer);
-            strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
-        }
-        pclose(fp);
-    }
-
-    /* If /tmp not in lsblk output, check root */
-    if(strcmp(info->storage_type, "Unknown") == 0)
-    {
-        fp = popen("lsblk -o NAME,ROTA,MOUNTPOINT 2>/dev/null | grep ' /$' | awk '{print $2}'", "r");
-        if(fp)
-        {
-            if(fgets(buffer, sizeof(buffer), fp))
-            {
-                int rota = atoi(buffer);
-                strcpy(info->storage_type, (rota == 0) ? "SSD" : "HDD");
-            }
-            pclose(fp);
-        }
-    }
-
-    /* Filesystem type */
-    struct statvfs vfs;
-    if(statvfs("/tmp", &vfs) == 0)
-    {
-        fp = popen("df -T /tmp 2>/dev/null | tail -1 | awk '{print $2}'", "r");
-        if(fp)
-        {
-            if(fgets(buffer, sizeof(buffer), fp))
-            {
-                buffer[strcspn(buffer, "\n")] = 0;
-                strncpy(info->filesystem, buffer, sizeof(info->filesystem) - 1);
-            }
-            pclose(fp);
-        }
-    }
-}
-
-/**
- * @brief Recursively remove a directory tree.
- *
- * This is a simple, benchmark-oriented equivalent of `rm -rf path`.
- * Best-effort: on failure it returns -1 but continues as far as possible.
- */
-static int remove_directory(const char* path)
-{
-    struct stat st;
-
-    if(stat(path, &st) != 0)
-    {
-        /* Treat non-existent path as success. */
-        return (errno == ENOENT) ? 0 : -1;
-    }
-
-    if(!S_ISDIR(st.st_mode))
-    {
-        return (unlink(path) == 0) ? 0 : -1;
-    }
-
-    DIR* dir = opendir(path);
-    if(!dir)
-    {
-        return -1;
-    }
-
-    struct dirent* ent;
-    int            rc = 0;
-
-    while((ent = readdir(dir)) != NULL)
-    {
-        if(strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
-
-        char child[PATH_MAX];
-        int  n = snprintf(child, sizeof(child), "%s/%s", path, ent->d_name);
-        if(n <= 0 || (size_t)n >= sizeof(child))
-        {
-            rc = -1;
-            continue;
-        }
-
-        struct stat child_st;
-        if(lstat(child, &child_st) != 0)
-        {
-            rc = -1;
-            continue;
-        }
-
-        if(S_ISDIR(child_st.st_mode))
-        {
-            if(remove_directory(child) != 0) rc = -1;
-        }
-        else
-        {
-            if(unlink(child) != 0) rc = -1;
-        }
-    }
-
-    closedir(dir);
-
-    if(rmdir(path) != 0) rc = -1;
-    return rc;
-}
-
-/**
- * @brief Get current time in microseconds
- */
-static double get_time_us(void)
-{
-    struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
-    return (double)ts.tv_sec * 1000000.0 + (double)ts.tv_nsec / 1000.0;
-}
-
-/**
- * @brief Compare function for qsort (doubles)
- */
-static int compare_double(const void* a, const void* b)
-{
-    double da = *(const double*)a;
-    double db = *(const double*)b;
-    return (da > db) - (da < db);
-}
-
-/**
- * @brief Calculate statistics from an array of samples
- */
-static void calculate_stats(double* samples, size_t n, stats_t* out)
-{
-    double sum    = 0.0;
-    double sum_sq = 0.0;
-
-    /* Sort samples for median and min/max */
-    qsort(samples, n, sizeof(double), compare_double);
-
-    /* Calculate mean */
-    for(size_t i = 0; i < n; i++)
-    {
-        sum += samples[i];
-    }
-    out->mean = sum / (double)n;
-
-    /* Calculate standard deviation */
-    for(size_t i = 0; i < n; i++)
-    {
-        double diff = samples[i] - out->mean;
-        sum_sq += diff * diff;
-    }
-    out->std_dev = sqrt(sum_sq / (double)n);
-
-    /* Min, max, median */
-    out->min    = samples[0];
-    out->max    = samples[n - 1];
-    out->median = (n % 2 == 0) ? (samples[n / 2 - 1] + samples[n / 2]) / 2.0 : samples[n / 2];
-}
-
 /**
  * @brief Initialize synthetic user keys and value buffer.
  */
@@ -357,10 +77,10 @@ static int run_single_put_run(int batch_size, double* out_total_us)
     }
 
     /* Create database environment + single DBI (not timed). */
-    int rc = db_core_init(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u);
+    int rc = db_core_init_ex(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u, &g_env_cfg);
     if(rc != 0)
     {
-        fprintf(stderr, "ERROR: db_core_init failed with rc=%d\n", rc);
+        fprintf(stderr, "ERROR: db_core_init_ex failed with rc=%d\n", rc);
         return rc;
     }
 
@@ -448,11 +168,17 @@ static int run_single_put_run(int batch_size, double* out_total_us)
 
 /**
  * @brief Run the full benchmark for a given pattern (batch_size).
+ *
+ * When @p out_mean_per_op is not NULL it receives the mean per-op time (μs).
  */
 static int run_put_benchmark(const char* label,
                              int         batch_size,
-                             const char* output_file)
+                             const char* output_file,
+                             double*     out_mean_per_op)
 {
+    char profile_path[256];
+    output_file = bench_profile_path(output_file, profile_path, sizeof(profile_path));
+
     sys_info_t sys_info = {0};
     get_system_info(&sys_info);
 
@@ -490,6 +216,7 @@ static int run_put_benchmark(const char* label,
     printf("Runs:           %d\n", BENCH_RUNS);
     printf("DB Path:        %s\n", BENCH_DB_PATH);
     printf("DB Mode:        0%o\n", BENCH_DB_MODE);
+    printf("Env profile:    %s\n", g_profile_name);
     printf("=================================================================\n\n");
 
     printf("Running benchmark...\n");
@@ -577,6 +304,7 @@ static int run_put_benchmark(const char* label,
     fprintf(fp, "Runs:              %d\n", BENCH_RUNS);
     fprintf(fp, "DB Path:           %s\n", BENCH_DB_PATH);
     fprintf(fp, "DB Mode:           0%o\n", BENCH_DB_MODE);
+    fprintf(fp, "Env profile:       %s\n", g_profile_name);
 
     fprintf(fp, "\nRESULTS - Per-run Totals\n");
     fprintf(fp, "------------------------\n");
@@ -610,59 +338,87 @@ static int run_put_benchmark(const char* label,
     fclose(fp);
     free(all_times);
 
+    if(out_mean_per_op) *out_mean_per_op = mean_per_op;
+
     printf("Detailed results written to: %s\n\n", output_file);
     return 0;
 }
 
-int main(void)
+int main(int argc, char* argv[])
 {
+    if(bench_set_profile(argc > 1 ? argv[1] : "durable") != 0)
+    {
+        fprintf(stderr, "usage: %s [durable|fast-async|read-mostly]\n", argv[0]);
+        return 1;
+    }
+
     const char* output_single = "tests/benchmarks/results/bench_put_users_single.txt";
-    const char* output_batch8 = "tests/benchmarks/results/bench_put_users_batch8.txt";
 
     /* Ensure results directory exists. */
-    struct stat st;
-    if(stat("tests/benchmarks/results", &st) != 0)
-    {
-        if(errno != ENOENT || mkdir("tests/benchmarks/results", 0755) != 0)
-        {
-            perror("mkdir tests/benchmarks/results");
-            return 1;
-        }
-    }
-    else if(!S_ISDIR(st.st_mode))
+    if(bench_ensure_results_dir() != 0) return 1;
+
+    /* Prepare synthetic data once. */
+    init_test_data();
+
+    /* Let the largest swept batch fit in a single exec. */
+    if(db_core_set_batch_max_ops((size_t)g_batch_sizes[BENCH_N_BATCH_SIZES - 1]) != 0)
     {
-        fprintf(stderr, "ERROR: tests/benchmarks/results exists and is not a directory\n");
+        fprintf(stderr, "ERROR: db_core_set_batch_max_ops failed\n");
         return 1;
     }
 
-    /* Prepare synthetic data once. */
-    init_test_data();
+    int n_failed = 0;
 
     int rc_single =
-        run_put_benchmark("Single PUT (no batching)", 1, output_single);
+        run_put_benchmark("Single PUT (no batching)", 1, output_single, NULL);
     if(rc_single != 0)
     {
         fprintf(stderr, "Single PUT benchmark failed with rc=%d\n", rc_single);
+        n_failed++;
     }
 
-    /* Clean up completely between patterns. */
-    (void)remove_directory(BENCH_DB_PATH);
+    double mean_per_batch[BENCH_N_BATCH_SIZES];
 
-    int rc_batch =
-        run_put_benchmark("Batched PUT (8 ops)", BENCH_BATCH_SIZE, output_batch8);
-    if(rc_batch != 0)
+    for(size_t i = 0; i < BENCH_N_BATCH_SIZES; ++i)
     {
-        fprintf(stderr, "Batched PUT benchmark failed with rc=%d\n", rc_batch);
+        /* Clean up completely between patterns. */
+        (void)remove_directory(BENCH_DB_PATH);
+
+        char label[64];
+        char output_batch[128];
+        (void)snprintf(label, sizeof(label), "Batched PUT (%d ops)", g_batch_sizes[i]);
+        (void)snprintf(output_batch, sizeof(output_batch),
+                       "tests/benchmarks/results/bench_put_users_batch%d.txt", g_batch_sizes[i]);
+
+        int rc_batch = run_put_benchmark(label, g_batch_sizes[i], output_batch,
+                                         &mean_per_batch[i]);
+        if(rc_batch != 0)
+        {
+            fprintf(stderr, "Batched PUT benchmark (%d ops) failed with rc=%d\n",
+                    g_batch_sizes[i], rc_batch);
+            mean_per_batch[i] = 0.0;
+            n_failed++;
+        }
+    }
+
+    /* Short sweep summary: mean time per PUT for each batch size. */
+    printf("=================================================================\n");
+    printf("BATCH SIZE SWEEP (mean per-op)\n");
+    printf("=================================================================\n");
+    for(size_t i = 0; i < BENCH_N_BATCH_SIZES; ++i)
+    {
+        printf("  batch %5d: %10.2f μs/op  (%d commits per run)\n", g_batch_sizes[i],
+               mean_per_batch[i],
+               (BENCH_NUM_USERS + g_batch_sizes[i] - 1) / g_batch_sizes[i]);
     }
+    printf("=================================================================\n\n");
 
-    if(rc_single == 0 && rc_batch == 0)
+    if(n_failed == 0)
     {
         printf("All PUT benchmarks completed successfully!\n");
         return 0;
     }
 
-    fprintf(stderr, "One or more PUT benchmarks failed (single rc=%d, batch rc=%d)\n",
-            rc_single, rc_batch);
+    fprintf(stderr, "%d PUT benchmark(s) failed\n", n_failed);
     return 1;
 }
-
@@ -0,0 +1,482 @@
+/**
+ * @file bench_db_sweep.c
+ * @brief Parametric PUT / GET benchmark with JSON results.
+ *
+ * Every combination of key count, value size, batch size and access
+ * pattern given on the command line is run --runs times, each run from a
+ * clean database directory with a single sub-DBI:
+ *
+ *   - put: the keys are inserted, --batch PUTs per exec, in ascending key
+ *          order (seq) or in a fixed pseudo-random permutation (rand)
+ *   - get: --gets GETs, --batch per exec, walking the keys in order (seq)
+ *          or picking them uniformly at random (rand)
+ *
+ * Every exec is timed on its own (up to BENCH_MAX_SAMPLES kept per case,
+ * sampled uniformly past that); a case reports ops/s and the mean, p50,
+ * p99, p999 and max latency of one exec. Environment init, shutdown and
+ * directory cleanup are not timed.
+ *
+ * Results go to the console and to a JSON file (--json), the input of
+ * utils/bench/compare.py.
+ */
+
+#include "bench_common.h"
+#include "core.h"
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Benchmark configuration */
+#define BENCH_DB_PATH      "/tmp/bench_lmdb_sweep"
+#define BENCH_DB_MODE      0700
+#define BENCH_KEY_SIZE     16
+#define BENCH_MAX_LIST     16
+#define BENCH_MAX_SAMPLES  1000000u
+#define BENCH_MAX_GETS     100000u /* default --gets cap */
+#define BENCH_PAGE_SLACK   64u     /* estimated per-record overhead in the map */
+
+enum
+{
+    ACCESS_SEQ  = 0,
+    ACCESS_RAND = 1
+};
+
+static const char* const g_access_names[] = { "seq", "rand" };
+
+/* Command line parameters */
+typedef struct
+{
+    size_t      keys[BENCH_MAX_LIST];
+    int         n_keys;
+    size_t      value_sizes[BENCH_MAX_LIST];
+    int         n_value_sizes;
+    size_t      batches[BENCH_MAX_LIST];
+    int         n_batches;
+    int         access[2];
+    int         n_access;
+    size_t      gets; /* 0 = min(keys, BENCH_MAX_GETS) */
+    int         runs;
+    const char* json_path;
+} sweep_args_t;
+
+/* One combination of the sweep */
+typedef struct
+{
+    size_t keys;
+    size_t value_size;
+    size_t batch;
+    int    access;
+} sweep_case_t;
+
+static char* g_value = NULL; /* BENCH max value size, deterministic pattern */
+
+/**
+ * @brief Print the usage line.
+ */
+static void usage(const char* prog)
+{
+    fprintf(stderr,
+            "usage: %s [--profile durable|fast-async|read-mostly] [--keys LIST]\n"
+            "          [--value-size LIST] [--batch LIST] [--access seq,rand] [--gets N]\n"
+            "          [--runs N] [--json PATH]\n"
+            "  LIST: comma separated, K/M/G suffixes (x1000 for keys, x1024 for sizes)\n"
+            "  e.g.  %s --keys 1K,1M --value-size 16,1K,64K --batch 1,64 --access rand\n",
+            prog, prog);
+}
+
+/**
+ * @brief Parse argv into @p a, defaults for what is not given.
+ */
+static int parse_args(int argc, char* argv[], sweep_args_t* a)
+{
+    memset(a, 0, sizeof(*a));
+    a->keys[a->n_keys++]               = 1000u;
+    a->keys[a->n_keys++]               = 100000u;
+    a->value_sizes[a->n_value_sizes++] = 16u;
+    a->value_sizes[a->n_value_sizes++] = 1024u;
+    a->batches[a->n_batches++]         = 1u;
+    a->batches[a->n_batches++]         = 64u;
+    a->access[a->n_access++]           = ACCESS_SEQ;
+    a->access[a->n_access++]           = ACCESS_RAND;
+    a->runs                            = 3;
+    a->json_path                       = BENCH_RESULTS_DIR "/bench_sweep.json";
+
+    if(bench_set_profile("durable") != 0) return -1;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        const char* opt = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if(!val) return -1;
+        i++;
+
+        if(strcmp(opt, "--profile") == 0)
+        {
+            if(bench_set_profile(val) != 0) return -1;
+        }
+        else if(strcmp(opt, "--keys") == 0)
+        {
+            a->n_keys = bench_parse_list(val, a->keys, BENCH_MAX_LIST, 0);
+            if(a->n_keys <= 0) return -1;
+        }
+        else if(strcmp(opt, "--value-size") == 0)
+        {
+            a->n_value_sizes = bench_parse_list(val, a->value_sizes, BENCH_MAX_LIST, 1);
+            if(a->n_value_sizes <= 0) return -1;
+        }
+        else if(strcmp(opt, "--batch") == 0)
+        {
+            a->n_batches = bench_parse_list(val, a->batches, BENCH_MAX_LIST, 0);
+            if(a->n_batches <= 0) return -1;
+        }
+        else if(strcmp(opt, "--access") == 0)
+        {
+            a->n_access = 0;
+            if(strcmp(val, "seq") == 0 || strcmp(val, "seq,rand") == 0)
+            {
+                a->access[a->n_access++] = ACCESS_SEQ;
+            }
+            if(strcmp(val, "rand") == 0 || strcmp(val, "seq,rand") == 0)
+            {
+                a->access[a->n_access++] = ACCESS_RAND;
+            }
+            if(a->n_access == 0) return -1;
+        }
+        else if(strcmp(opt, "--gets") == 0)
+        {
+            size_t n = 0;
+            if(bench_parse_list(val, &n, 1, 0) != 1) return -1;
+            a->gets = n;
+        }
+        else if(strcmp(opt, "--runs") == 0)
+        {
+            a->runs = atoi(val);
+            if(a->runs <= 0) return -1;
+        }
+        else if(strcmp(opt, "--json") == 0)
+        {
+            a->json_path = val;
+        }
+        else
+        {
+            return -1;
+        }
+    }
+
+    /* Zero sizes would make empty cases */
+    for(int i = 0; i < a->n_keys; ++i)
+    {
+        if(a->keys[i] == 0) return -1;
+    }
+    for(int i = 0; i < a->n_value_sizes; ++i)
+    {
+        if(a->value_sizes[i] == 0) return -1;
+    }
+    for(int i = 0; i < a->n_batches; ++i)
+    {
+        if(a->batches[i] == 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Fixed-width key of record @p idx: ascending idx, ascending key.
+ */
+static void make_key(size_t idx, char* out)
+{
+    char buf[BENCH_KEY_SIZE + 1];
+    (void)snprintf(buf, sizeof(buf), "%016zu", idx);
+    memcpy(out, buf, BENCH_KEY_SIZE);
+}
+
+static size_t gcd(size_t a, size_t b)
+{
+    while(b)
+    {
+        size_t t = a % b;
+        a        = b;
+        b        = t;
+    }
+    return a;
+}
+
+/**
+ * @brief Stride of the "rand" insert order: i -> (i * stride) % n visits
+ *        every record once without a permutation table (100M keys).
+ */
+static size_t rand_stride(size_t n)
+{
+    size_t stride = (size_t)(n * 0.6180339887) | 1u;
+    while(stride > 1 && gcd(stride, n) != 1) stride++;
+    return (stride % n) ? stride : 1u;
+}
+
+/**
+ * @brief Exec the queued ops, a failure reported with @p what.
+ */
+static int exec_timed(const char* what, bench_samples_t* samples, double t0)
+{
+    int rc = db_core_exec_ops();
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: %s: db_core_exec_ops failed (rc=%d)\n", what, rc);
+        return rc;
+    }
+    bench_samples_add(samples, get_time_us() - t0);
+    return 0;
+}
+
+/**
+ * @brief One run of @p c: PUT phase then GET phase, one sample per exec.
+ */
+static int run_case_once(const sweep_case_t* c, size_t gets, unsigned int seed,
+                         bench_samples_t* put_lat, bench_samples_t* get_lat, double* out_put_us,
+                         double* out_get_us, char* get_bufs)
+{
+    static const char*      dbi_names[] = { "bench_sweep" };
+    static const dbi_type_t dbi_types[] = { DBI_TYPE_DEFAULT };
+
+    if(remove_directory(BENCH_DB_PATH) != 0)
+    {
+        fprintf(stderr, "WARNING: Failed to remove directory %s\n", BENCH_DB_PATH);
+    }
+
+    /* Room for every record, grown in steps as usual (not timed) */
+    db_env_cfg_t cfg  = g_env_cfg;
+    size_t       need = c->keys * (c->value_size + BENCH_KEY_SIZE + BENCH_PAGE_SLACK) * 2u;
+    if(cfg.map_size_max < need) cfg.map_size_max = need;
+
+    int rc = db_core_init_ex(BENCH_DB_PATH, BENCH_DB_MODE, dbi_names, dbi_types, 1u, &cfg);
+    if(rc != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_init_ex failed with rc=%d\n", rc);
+        return rc;
+    }
+
+    char   key[BENCH_KEY_SIZE];
+    size_t stride  = (c->access == ACCESS_RAND) ? rand_stride(c->keys) : 1u;
+    size_t pending = 0;
+    double t0      = get_time_us();
+    double start   = t0;
+
+    for(size_t i = 0; i < c->keys && rc == 0; ++i)
+    {
+        make_key((size_t)(((unsigned __int128)i * stride) % c->keys), key);
+        rc = db_core_add_op(0u, DB_OPERATION_PUT, key, BENCH_KEY_SIZE, g_value, c->value_size);
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: put: db_core_add_op failed (i=%zu, rc=%d)\n", i, rc);
+            break;
+        }
+        if(++pending == c->batch || i + 1 == c->keys)
+        {
+            rc      = exec_timed("put", put_lat, t0);
+            pending = 0;
+            t0      = get_time_us();
+        }
+    }
+    *out_put_us = get_time_us() - start;
+
+    pending = 0;
+    t0      = get_time_us();
+    start   = t0;
+    for(size_t i = 0; i < gets && rc == 0; ++i)
+    {
+        size_t idx = (c->access == ACCESS_RAND) ? (size_t)rand_r(&seed) % c->keys : i % c->keys;
+        make_key(idx, key);
+        rc = db_core_add_op(0u, DB_OPERATION_GET, key, BENCH_KEY_SIZE,
+                            get_bufs + pending * c->value_size, c->value_size);
+        if(rc != 0)
+        {
+            fprintf(stderr, "ERROR: get: db_core_add_op failed (i=%zu, rc=%d)\n", i, rc);
+            break;
+        }
+        if(++pending == c->batch || i + 1 == gets)
+        {
+            rc      = exec_timed("get", get_lat, t0);
+            pending = 0;
+            t0      = get_time_us();
+        }
+    }
+    *out_get_us = get_time_us() - start;
+
+    (void)db_core_shutdown();
+    return rc;
+}
+
+/**
+ * @brief All runs of @p c, both phases reported to the console and @p json.
+ */
+static int run_case(const sweep_case_t* c, const sweep_args_t* a, bench_json_t* json)
+{
+    size_t gets = a->gets ? a->gets : (c->keys < BENCH_MAX_GETS ? c->keys : BENCH_MAX_GETS);
+
+    bench_samples_t put_lat;
+    bench_samples_t get_lat;
+    char*           get_bufs = malloc(c->batch * c->value_size);
+    if(!get_bufs || bench_samples_init(&put_lat, BENCH_MAX_SAMPLES, 1u) != 0)
+    {
+        free(get_bufs);
+        return -ENOMEM;
+    }
+    if(bench_samples_init(&get_lat, BENCH_MAX_SAMPLES, 2u) != 0)
+    {
+        bench_samples_free(&put_lat);
+        free(get_bufs);
+        return -ENOMEM;
+    }
+
+    double put_rate = 0.0;
+    double get_rate = 0.0;
+    int    rc       = 0;
+    for(int run = 0; run < a->runs && rc == 0; ++run)
+    {
+        double put_us = 0.0;
+        double get_us = 0.0;
+        rc = run_case_once(c, gets, 1234u + (unsigned int)run, &put_lat, &get_lat, &put_us,
+                           &get_us, get_bufs);
+        if(rc == 0)
+        {
+            put_rate += put_us > 0.0 ? (double)c->keys * 1000000.0 / put_us : 0.0;
+            get_rate += get_us > 0.0 ? (double)gets * 1000000.0 / get_us : 0.0;
+        }
+    }
+
+    if(rc == 0)
+    {
+        bench_result_t r = {
+            .access     = g_access_names[c->access],
+            .keys       = c->keys,
+            .value_size = c->value_size,
+            .batch      = c->batch,
+        };
+
+        r.name      = "put";
+        r.ops       = c->keys * (size_t)a->runs;
+        r.ops_per_s = put_rate / (double)a->runs;
+        calculate_stats(put_lat.v, put_lat.n, &r.lat_us);
+        bench_json_result(json, &r);
+        printf("%-4s %-4s %10zu %8zu %6zu | %12.0f %10.2f %10.2f %10.2f %10.2f\n", r.name,
+               r.access, r.keys, r.value_size, r.batch, r.ops_per_s, r.lat_us.median,
+               r.lat_us.p99, r.lat_us.p999, r.lat_us.max);
+
+        r.name      = "get";
+        r.ops       = gets * (size_t)a->runs;
+        r.ops_per_s = get_rate / (double)a->runs;
+        calculate_stats(get_lat.v, get_lat.n, &r.lat_us);
+        bench_json_result(json, &r);
+        printf("%-4s %-4s %10zu %8zu %6zu | %12.0f %10.2f %10.2f %10.2f %10.2f\n", r.name,
+               r.access, r.keys, r.value_size, r.batch, r.ops_per_s, r.lat_us.median,
+               r.lat_us.p99, r.lat_us.p999, r.lat_us.max);
+        fflush(stdout);
+    }
+
+    bench_samples_free(&put_lat);
+    bench_samples_free(&get_lat);
+    free(get_bufs);
+    return rc;
+}
+
+int main(int argc, char* argv[])
+{
+    sweep_args_t args;
+    if(parse_args(argc, argv, &args) != 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if(bench_ensure_results_dir() != 0) return 1;
+
+    /* Value pattern of the largest size, shorter values use its prefix */
+    size_t max_value = 0;
+    size_t max_batch = 0;
+    for(int i = 0; i < args.n_value_sizes; ++i)
+    {
+        if(args.value_sizes[i] > max_value) max_value = args.value_sizes[i];
+    }
+    for(int i = 0; i < args.n_batches; ++i)
+    {
+        if(args.batches[i] > max_batch) max_batch = args.batches[i];
+    }
+    g_value = malloc(max_value);
+    if(!g_value)
+    {
+        fprintf(stderr, "ERROR: Failed to allocate a %zu byte value\n", max_value);
+        return 1;
+    }
+    for(size_t i = 0; i < max_value; ++i)
+    {
+        g_value[i] = (char)('A' + (i % 26));
+    }
+    /* One exec holds up to the largest batch (library default is 4096) */
+    if(db_core_set_batch_max_ops(max_batch) != 0)
+    {
+        fprintf(stderr, "ERROR: db_core_set_batch_max_ops(%zu) failed\n", max_batch);
+        free(g_value);
+        return 1;
+    }
+
+    sys_info_t sys_info = {0};
+    get_system_info(&sys_info);
+
+    char        profile_path[256];
+    const char* json_path = bench_profile_path(args.json_path, profile_path, sizeof(profile_path));
+
+    printf("=================================================================\n");
+    printf("Database PUT / GET Sweep Benchmark\n");
+    printf("=================================================================\n\n");
+    bench_print_system_info(stdout, &sys_info);
+    printf("Runs per case:  %d\n", args.runs);
+    printf("Key size:       %d bytes\n", BENCH_KEY_SIZE);
+    printf("Env profile:    %s\n", g_profile_name);
+    printf("Latency:        one exec (batch ops), microseconds\n");
+    printf("=================================================================\n\n");
+    printf("%-4s %-4s %10s %8s %6s | %12s %10s %10s %10s %10s\n", "op", "acc", "keys", "value",
+           "batch", "ops/s", "p50", "p99", "p999", "max");
+
+    bench_json_t json;
+    int          rc = bench_json_open(&json, json_path, "bench_db_sweep", &sys_info);
+    if(rc != 0)
+    {
+        free(g_value);
+        return 1;
+    }
+
+    for(int k = 0; k < args.n_keys && rc == 0; ++k)
+    {
+        for(int v = 0; v < args.n_value_sizes && rc == 0; ++v)
+        {
+            for(int b = 0; b < args.n_batches && rc == 0; ++b)
+            {
+                for(int x = 0; x < args.n_access && rc == 0; ++x)
+                {
+                    sweep_case_t c = {
+                        .keys       = args.keys[k],
+                        .value_size = args.value_sizes[v],
+                        .batch      = args.batches[b],
+                        .access     = args.access[x],
+                    };
+                    rc = run_case(&c, &args, &json);
+                    if(rc != 0)
+                    {
+                        fprintf(stderr,
+                                "ERROR: case keys=%zu value=%zu batch=%zu %s failed, rc=%d\n",
+                                c.keys, c.value_size, c.batch, g_access_names[c.access], rc);
+                    }
+                }
+            }
+        }
+    }
+
+    int jrc = bench_json_close(&json);
+    (void)remove_directory(BENCH_DB_PATH);
+    free(g_value);
+
+    if(rc != 0 || jrc != 0) return 1;
+
+    printf("\nResults written to: %s\n", json_path);
+    return 0;
+}
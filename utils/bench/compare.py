@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+#
+# compare.py - Compare benchmark JSON results against a baseline
+#
+# Cases are matched on (name, access, keys, value_size, batch). A case
+# regresses when its throughput drops or its p99 latency grows past the
+# thresholds. Exits 1 on any regression, 0 otherwise (including when the
+# baseline file does not exist yet).
+#
+# usage: compare.py BASELINE.json CURRENT.json [--max-tput-drop 15] [--max-p99-rise 25]
+#
+
+import argparse
+import json
+import os
+import sys
+
+
+def load_cases(path):
+    with open(path, encoding="utf-8") as fp:
+        doc = json.load(fp)
+    cases = {}
+    for r in doc.get("results", []):
+        key = (r["name"], r["access"], r["keys"], r["value_size"], r["batch"])
+        cases[key] = r
+    return doc, cases
+
+
+def pct(old, new):
+    return (new - old) * 100.0 / old if old > 0 else 0.0
+
+
+def main():
+    ap = argparse.ArgumentParser(description="Flag benchmark regressions against a baseline")
+    ap.add_argument("baseline")
+    ap.add_argument("current")
+    ap.add_argument("--max-tput-drop", type=float, default=15.0,
+                    help="allowed ops/s drop in percent (default 15)")
+    ap.add_argument("--max-p99-rise", type=float, default=25.0,
+                    help="allowed p99 latency rise in percent (default 25)")
+    args = ap.parse_args()
+
+    if not os.path.exists(args.baseline):
+        print(f"No baseline at {args.baseline}, nothing to compare")
+        return 0
+
+    base_doc, base = load_cases(args.baseline)
+    cur_doc, cur = load_cases(args.current)
+    if base_doc.get("profile") != cur_doc.get("profile"):
+        print(f"WARNING: profiles differ ({base_doc.get('profile')} vs {cur_doc.get('profile')})")
+
+    print(f"{'case':<36} {'ops/s base':>12} {'ops/s now':>12} {'d%':>7} "
+          f"{'p99 base':>10} {'p99 now':>10} {'d%':>7}")
+    regressions = 0
+    for key in sorted(cur, key=str):
+        if key not in base:
+            continue
+        b, c = base[key], cur[key]
+        d_tput = pct(b["ops_per_s"], c["ops_per_s"])
+        d_p99 = pct(b["lat_us"]["p99"], c["lat_us"]["p99"])
+        bad = d_tput < -args.max_tput_drop or d_p99 > args.max_p99_rise
+        regressions += bad
+        label = "{} {} k={} v={} b={}".format(*key)
+        print(f"{label:<36} {b['ops_per_s']:>12.0f} {c['ops_per_s']:>12.0f} {d_tput:>+7.1f} "
+              f"{b['lat_us']['p99']:>10.2f} {c['lat_us']['p99']:>10.2f} {d_p99:>+7.1f}"
+              f"{'  REGRESSION' if bad else ''}")
+
+    missing = [k for k in base if k not in cur]
+    if missing:
+        print(f"{len(missing)} baseline case(s) not in the current results")
+
+    if regressions:
+        print(f"{regressions} regression(s) past -{args.max_tput_drop}% ops/s "
+              f"or +{args.max_p99_rise}% p99")
+        return 1
+    print("No regressions")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
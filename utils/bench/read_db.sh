@@ -42,7 +42,7 @@ echo "Running benchmark: ${BENCHMARK}"
 echo "========================================"
 echo
 
-"${BUILD_DIR}/${BENCHMARK}"
+"${BUILD_DIR}/${BENCHMARK}" "$@"
 
 echo
 echo "========================================"
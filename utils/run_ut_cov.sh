@@ -29,8 +29,23 @@ cmake --build "${BUILD_DIR}" -j"$(nproc)"
 UT_BINS=(
     "${BUILD_DIR}/db_core_ut_security"
     "${BUILD_DIR}/db_core_ut_ops_actions"
+    "${BUILD_DIR}/db_core_ut_ops_exec"
     "${BUILD_DIR}/db_core_ut_dbi_int"
     "${BUILD_DIR}/db_core_ut_ops_init"
+    "${BUILD_DIR}/db_core_ut_ops_arena"
+    "${BUILD_DIR}/db_core_ut_ops_bulk"
+    "${BUILD_DIR}/db_core_ut_ops_group"
+    "${BUILD_DIR}/db_core_ut_ops_map"
+    "${BUILD_DIR}/db_core_ut_ops_stats"
+    "${BUILD_DIR}/db_core_ut_ops_vcache"
+    "${BUILD_DIR}/db_core_ut_ops_bloom"
+    "${BUILD_DIR}/db_core_ut_ops_index"
+    "${BUILD_DIR}/db_core_ut_ops_ttl"
+    "${BUILD_DIR}/db_core_ut_ops_zip"
+    "${BUILD_DIR}/db_core_ut_ops_async"
+    "${BUILD_DIR}/db_core_ut_ops_shard"
+    "${BUILD_DIR}/db_core_ut_ops_backup"
+    "${BUILD_DIR}/db_core_ut_ops_warm"
 )
 
 echo "${BLUE}[UT] running unit tests (with coverage)...${RESET}"
@@ -11,22 +11,26 @@ RESULTS_DIR="${ROOT_DIR}/tests/IT/results"
 
 mkdir -p "${RESULTS_DIR}"
 
-# Configure with Release flags and coverage instrumentation for the IT target.
+# Configure with Release flags and coverage instrumentation for the IT targets.
 cmake -S "${ROOT_DIR}" -B "${BUILD_DIR}" \
     -DCMAKE_BUILD_TYPE=Release \
     -DDB_LMDB_ENABLE_IT_COVERAGE=ON
 
 cmake --build "${BUILD_DIR}" -j"$(nproc)"
 
-# Run the IT binary directly so we can capture its output and exit code.
-IT_BIN="${BUILD_DIR}/db_core_it_db_core_init"
-if [[ ! -x "${IT_BIN}" ]]; then
-    echo "Integration test binary not found: ${IT_BIN}" >&2
+# Run each IT binary directly so we can capture its output and exit code.
+shopt -s nullglob
+IT_BINS=("${BUILD_DIR}"/db_core_it_db_core_*)
+if [[ ${#IT_BINS[@]} -eq 0 ]]; then
+    echo "Integration test binaries not found in ${BUILD_DIR}" >&2
     exit 1
 fi
 
-# Run tests and tee output into results.
-"${IT_BIN}" | tee "${RESULTS_DIR}/IT_db_core_init.log"
+for IT_BIN in "${IT_BINS[@]}"; do
+    # Run tests and tee output into results.
+    IT_NAME="$(basename "${IT_BIN}")"
+    "${IT_BIN}" | tee "${RESULTS_DIR}/IT_${IT_NAME#db_core_it_}.log"
+done
 
 # Collect coverage if gcov data is present.
 if command -v gcov >/dev/null 2>&1; then